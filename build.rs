@@ -0,0 +1,240 @@
+//! 构建脚本
+//! 启用`c-drivers`特性时编译`Library/`中的标准外设库和`src/hardware/`中的OLED驱动
+//! 
+//! 按模块选择优化等级：热点驱动（OLED、I2C、DMA、GPIO）用`-O2`，其余用`-Os`，
+//! 两组分别编译为静态库。可用环境变量`BSP_C_PROFILE`整体切换：
+//! - `balanced`（默认）：热点驱动`-O2`，其余`-Os`
+//! - `size`：全部`-Os`
+//! - `speed`：全部`-O2`
+//! 
+//! 启用`c-lto`特性时用clang生成LLVM位码（`-flto=thin`），配合rustc的`-Clinker-plugin-lto`
+//! 在链接时跨C/Rust边界内联，使用`cargo build-lto`（见`.cargo/config.toml`）。
+//! clang的LLVM主版本必须与rustc一致（`rustc -vV`查看），C库头文件（`string.h`等）
+//! 通过`CFLAGS_thumbv7m_none_eabi="--sysroot=..."`指向arm-none-eabi工具链的newlib。
+//! 
+//! 源文件以`../Start/stm32f10x.h`包含CMSIS设备头文件（及`core_cm3.h`、`stm32f10x_conf.h`），
+//! 这些文件不随本仓库提供，需要放到仓库根目录的`Start/`中。
+//! 
+//! 器件容量宏（`STM32F10X_MD`等）由`stm32f10x-*`特性选择，默认`stm32f10x-md`。
+//! Rust侧通过`bsp::c_oled`调用C驱动，C库中未被引用的函数在链接时丢弃。
+//! 
+//! 无论是否启用`c-drivers`，都会检查`src/hardware/OLED_Data.c`中手工维护的汉字码点索引
+//! `OLED_CF16x16_INDEX`与字模表`OLED_CF16x16`是否一致，不一致时构建失败。
+
+fn main() {
+    println!("cargo:rerun-if-changed=build.rs");
+    println!("cargo:rerun-if-env-changed=BSP_C_PROFILE");
+    println!("cargo:rerun-if-changed={}", GLYPH_DATA);
+    
+    check_glyph_index();
+    
+    #[cfg(feature = "c-drivers")]
+    c_drivers::build();
+}
+
+/// 汉字字模和码点索引所在的源文件
+const GLYPH_DATA: &str = "src/hardware/OLED_Data.c";
+
+/// 取出`start`所在行之后到`};`为止的表格内容
+fn table_body<'a>(source: &'a str, start: &str) -> &'a str {
+    let begin = source.find(start).unwrap_or_else(|| panic!("{}中没有{}", GLYPH_DATA, start));
+    let body = &source[begin..];
+    let body = &body[body.find('\n').map_or(body.len(), |i| i + 1)..];
+    &body[..body.find("};").unwrap_or_else(|| panic!("{}中{}没有结束", GLYPH_DATA, start))]
+}
+
+/// 检查汉字码点索引
+/// 
+/// `OLED_Printf`在`OLED_CF16x16_INDEX`中按码点二分查找字模下标，索引表需要手工维护。
+/// 这里要求索引按码点严格递增，每一项的下标指向名称恰为该码点的字模，
+/// 并且字模表中每个非空名称的汉字都有索引项（空名称的项不参与查找）。
+fn check_glyph_index() {
+    let path = std::path::Path::new(&std::env::var_os("CARGO_MANIFEST_DIR").unwrap()).join(GLYPH_DATA);
+    let source = std::fs::read_to_string(&path).unwrap_or_else(|e| panic!("无法读取{}：{}", path.display(), e));
+    
+    // 字模表每项以`{"名称",`开头，结束标志`{NULL, ...}`不计入
+    let names: Vec<&str> = table_body(&source, "ChineseCell_t OLED_CF16x16[]")
+        .lines()
+        .filter_map(|line| line.trim_start().strip_prefix("{\""))
+        .map(|rest| &rest[..rest.find('"').unwrap_or(0)])
+        .collect();
+    
+    // 索引表每项为`{0x码点, 下标},`
+    let mut indexed = vec![false; names.len()];
+    let mut previous: Option<u32> = None;
+    for line in table_body(&source, "ChineseIndex_t OLED_CF16x16_INDEX[]").lines() {
+        let entry = match line.trim_start().strip_prefix('{') {
+            Some(entry) => &entry[..entry.find('}').unwrap_or(entry.len())],
+            None => continue,
+        };
+        let mut fields = entry.split(',').map(str::trim);
+        let parsed = match (fields.next(), fields.next()) {
+            (Some(codepoint), Some(index)) => codepoint
+                .strip_prefix("0x")
+                .and_then(|hex| u32::from_str_radix(hex, 16).ok())
+                .zip(index.parse::<usize>().ok()),
+            _ => None,
+        };
+        let (codepoint, index) = parsed.unwrap_or_else(|| panic!("{}：无法解析索引项`{}`", GLYPH_DATA, line.trim()));
+        
+        if codepoint > 0xFFFF {
+            panic!("{}：码点0x{:X}超出uint16_t范围", GLYPH_DATA, codepoint);
+        }
+        if previous.map_or(false, |previous| codepoint <= previous) {
+            panic!("{}：索引项0x{:X}没有按码点严格递增排列", GLYPH_DATA, codepoint);
+        }
+        previous = Some(codepoint);
+        
+        let name = names.get(index).unwrap_or_else(|| {
+            panic!("{}：索引项0x{:X}的下标{}超出字模表（共{}项）", GLYPH_DATA, codepoint, index, names.len())
+        });
+        let mut chars = name.chars();
+        if chars.next().map(u32::from) != Some(codepoint) || chars.next().is_some() {
+            panic!("{}：索引项0x{:X}指向的字模是\"{}\"", GLYPH_DATA, codepoint, name);
+        }
+        indexed[index] = true;
+    }
+    
+    for (name, indexed) in names.iter().zip(&indexed) {
+        if !name.is_empty() && !indexed {
+            panic!("{}：汉字\"{}\"没有码点索引项，需要在OLED_CF16x16_INDEX中按码点顺序插入", GLYPH_DATA, name);
+        }
+    }
+}
+
+#[cfg(feature = "c-drivers")]
+mod c_drivers {
+    use std::env;
+    use std::path::PathBuf;
+    
+    /// 热点驱动，`balanced`配置下用`-O2`编译
+    const HOT_SOURCES: [&str; 5] = [
+        "src/hardware/OLED.c",
+        "Library/stm32f10x_i2c.c",
+        "Library/stm32f10x_dma.c",
+        "Library/stm32f10x_gpio.c",
+        "Library/misc.c",
+    ];
+    
+    /// 其余驱动，`balanced`配置下用`-Os`编译
+    const COLD_SOURCES: [&str; 20] = [
+        "src/hardware/OLED_Data.c",
+        "Library/stm32f10x_adc.c",
+        "Library/stm32f10x_bkp.c",
+        "Library/stm32f10x_can.c",
+        "Library/stm32f10x_cec.c",
+        "Library/stm32f10x_crc.c",
+        "Library/stm32f10x_dac.c",
+        "Library/stm32f10x_dbgmcu.c",
+        "Library/stm32f10x_exti.c",
+        "Library/stm32f10x_flash.c",
+        "Library/stm32f10x_fsmc.c",
+        "Library/stm32f10x_iwdg.c",
+        "Library/stm32f10x_pwr.c",
+        "Library/stm32f10x_rcc.c",
+        "Library/stm32f10x_rtc.c",
+        "Library/stm32f10x_sdio.c",
+        "Library/stm32f10x_spi.c",
+        "Library/stm32f10x_tim.c",
+        "Library/stm32f10x_usart.c",
+        "Library/stm32f10x_wwdg.c",
+    ];
+    
+    /// 器件容量特性及对应的宏
+    const DENSITIES: [(&str, &str); 5] = [
+        ("CARGO_FEATURE_STM32F10X_LD", "STM32F10X_LD"),
+        ("CARGO_FEATURE_STM32F10X_MD", "STM32F10X_MD"),
+        ("CARGO_FEATURE_STM32F10X_HD", "STM32F10X_HD"),
+        ("CARGO_FEATURE_STM32F10X_XL", "STM32F10X_XL"),
+        ("CARGO_FEATURE_STM32F10X_CL", "STM32F10X_CL"),
+    ];
+    
+    /// 由启用的`stm32f10x-*`特性得到器件容量宏
+    fn density() -> &'static str {
+        let mut selected = DENSITIES.iter().filter(|(feature, _)| env::var_os(feature).is_some());
+        match (selected.next(), selected.next()) {
+            (Some(&(_, define)), None) => define,
+            (None, _) => panic!("c-drivers需要启用一个stm32f10x-*器件容量特性"),
+            (Some(_), Some(_)) => panic!("只能启用一个stm32f10x-*器件容量特性，选非默认容量时加--no-default-features"),
+        }
+    }
+    
+    /// 优化配置
+    #[derive(Clone, Copy, PartialEq)]
+    enum Profile {
+        Balanced,
+        Size,
+        Speed,
+    }
+    
+    impl Profile {
+        fn from_env() -> Self {
+            match env::var("BSP_C_PROFILE").as_deref() {
+                Ok("size") => Profile::Size,
+                Ok("speed") => Profile::Speed,
+                Ok("balanced") | Err(_) => Profile::Balanced,
+                Ok(other) => panic!("BSP_C_PROFILE只能为balanced、size或speed，当前为{}", other),
+            }
+        }
+        
+        /// 热点驱动和其余驱动的优化等级
+        fn levels(self) -> (&'static str, &'static str) {
+            match self {
+                Profile::Balanced => ("2", "s"),
+                Profile::Size => ("s", "s"),
+                Profile::Speed => ("2", "2"),
+            }
+        }
+    }
+    
+    pub fn build() {
+        let root = PathBuf::from(env::var_os("CARGO_MANIFEST_DIR").unwrap());
+        let cmsis = root.join("Start");
+        if !cmsis.join("stm32f10x.h").exists() {
+            panic!("c-drivers需要CMSIS设备头文件：{}中没有stm32f10x.h", cmsis.display());
+        }
+        
+        // dev配置不优化C代码，便于单步调试
+        let debug = env::var("PROFILE").as_deref() == Ok("debug");
+        let (hot, cold) = if debug { ("g", "g") } else { Profile::from_env().levels() };
+        let lto = env::var_os("CARGO_FEATURE_C_LTO").is_some();
+        let density = density();
+        
+        if hot == cold {
+            let mut all = HOT_SOURCES.to_vec();
+            all.extend_from_slice(&COLD_SOURCES);
+            compile("bsp_c", &all, hot, lto, density, &root, &cmsis);
+        } else {
+            compile("bsp_c_hot", &HOT_SOURCES, hot, lto, density, &root, &cmsis);
+            compile("bsp_c_size", &COLD_SOURCES, cold, lto, density, &root, &cmsis);
+        }
+        
+        println!("cargo:rerun-if-changed=Start");
+        println!("cargo:rerun-if-changed=Library");
+        println!("cargo:rerun-if-changed=src/hardware");
+    }
+    
+    /// 按同一优化等级编译一组源文件为静态库
+    fn compile(name: &str, files: &[&str], level: &str, lto: bool, density: &str, root: &PathBuf, cmsis: &PathBuf) {
+        let mut build = cc::Build::new();
+        build
+            .files(files.iter().map(|path| root.join(path)))
+            .include(root.join("Library"))
+            .include(root.join("src/hardware"))
+            .include(cmsis)
+            .define("USE_STDPERIPH_DRIVER", None)
+            .define(density, None)
+            .opt_level_str(level)
+            .debug(level == "g")
+            .flag("-mcpu=cortex-m3")
+            .flag("-mthumb")
+            .flag("-ffunction-sections")
+            .flag("-fdata-sections");
+        
+        if lto {
+            // clang输出LLVM位码，由rust-lld在链接时与Rust代码一起优化
+            build.compiler("clang").flag("-flto=thin");
+        }
+        build.compile(name);
+    }
+}
@@ -13,6 +13,43 @@ REGION_ALIAS("REGION_BSS", RAM);
 REGION_ALIAS("REGION_HEAP", RAM);
 REGION_ALIAS("REGION_STACK", RAM);
 
+/* FLASH末地址，bench固件在FLASH最后一页上测试擦写（见src/bin/bench.rs） */
+__flash_end = ORIGIN(FLASH) + LENGTH(FLASH);
+
+/* SysTick异常必须由src/bsp/delay.rs中的`SysTick`处理：init_systick开启了TICKINT，
+ * 符号缺失时cortex-m-rt把该向量指向DefaultHandler，系统在第一次节拍时停死 */
+ASSERT(SysTick != DefaultHandler, "SysTick handler missing from the vector table (see src/bsp/delay.rs)");
+
 /* Stack configuration */
 _stack_size = 1K;
-_heap_size = 1K;
\ No newline at end of file
+_heap_size = 1K;
+
+/* BSP自定义段，配合src/bsp/sections.rs使用
+ * .ramfunc     : 在RAM中执行的代码，加载地址在FLASH；插入在.data之后，
+ *                cortex-m-rt的__edata随之后移，启动时与.data一起复制（不要改它的存储区域）
+ * .dma_buffers : DMA缓冲区；插入在.bss之后，__ebss随之后移，启动时与.bss一起清零
+ * 复位后保留内容的变量使用cortex-m-rt自带的.uninit段（位于__ebss之后），
+ * 不能在这里插入：插入在.bss之后的段都会被清零
+ */
+SECTIONS
+{
+  .ramfunc : ALIGN(4)
+  {
+    __sramfunc = .;
+    *(.ramfunc .ramfunc.*);
+    . = ALIGN(4);
+    __eramfunc = .;
+  } > RAM AT > FLASH
+  __siramfunc = LOADADDR(.ramfunc);
+} INSERT AFTER .data;
+
+SECTIONS
+{
+  .dma_buffers (NOLOAD) : ALIGN(4)
+  {
+    __sdma_buffers = .;
+    *(.dma_buffers .dma_buffers.*);
+    . = ALIGN(4);
+    __edma_buffers = .;
+  } > RAM
+} INSERT AFTER .bss;
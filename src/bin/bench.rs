@@ -0,0 +1,395 @@
+//! 板上性能基准固件
+//! 依次测量各BSP驱动的吞吐量和中断延迟，结果通过USART1（PA9，115200）逐行输出
+//! 
+//! 每项结果占一行，便于上位机脚本解析：
+//! 
+//! ```text
+//! BENCH name=<名称> value=<数值> unit=<单位> n=<样本数> min=<周期> mean=<周期> max=<周期>
+//! BENCH name=<名称> error=<错误>
+//! BENCH done sysclk=<Hz>
+//! ```
+//! 
+//! `value`为整数，吞吐量按总字节数（或事务数、帧数）除以总耗时计算，
+//! `min/mean/max`为单次迭代的耗时（DWT周期）。不以`BENCH`开头的行（如UART测试数据）应忽略。
+//! 
+//! 构建：`cargo build --release --bin bench`
+//! 
+//! 接线：USART1 TX=PA9；SPI1 SCK=PA5、MOSI=PA7（无需从机）；
+//! I2C1 SCL=PB6、SDA=PB7接SSD1306 OLED（地址0x78），未接时IIC和OLED项输出错误。
+//! 
+//! FLASH项反复擦写`memory.x`中FLASH区域的最后一页（页大小按器件容量特性取`FLASH_PAGE_SIZE`），
+//! 该页不能存放数据；与程序映像重叠时跳过该项并输出错误。
+
+#![no_std]
+#![no_main]
+#![allow(unused)]
+
+use core::fmt::Write;
+use core::sync::atomic::{AtomicU32, Ordering};
+use cortex_m_rt::{entry, exception};
+use panic_halt as _;
+
+// 与主固件共用BSP源码
+#[path = "../bsp/mod.rs"]
+pub mod bsp;
+
+use crate::bsp::crc::CRC;
+use crate::bsp::delay::{cycle_count, system_clock};
+use crate::bsp::dma::{DMA1_CHANNEL1, DMA1_CHANNEL3};
+use crate::bsp::flash::{FLASH, FLASH_PAGE_SIZE};
+use crate::bsp::gpio;
+use crate::bsp::iic::{HardwareIic, I2cOps};
+use crate::bsp::oled::{OledBuffers, OledColor, Ssd1306, OLED_I2C_ADDR, OLED_WIDTH, OLED_HEIGHT};
+use crate::bsp::profile::{self, ProfileCounter};
+use crate::bsp::serial::{Serial, SerialPort};
+use crate::bsp::spi::{SPI1, SpiMode, SpiDataSize, SpiBaudRatePrescaler, SpiDirection, SpiNssMode};
+use crate::bsp::system;
+
+/// 测试数据块大小（字）
+const BLOCK_WORDS: usize = 1024;
+
+/// 测试数据块大小（字节）
+const BLOCK_BYTES: usize = BLOCK_WORDS * 4;
+
+/// 每项吞吐量测试的迭代次数
+const ITERATIONS: u32 = 16;
+
+/// UART测试每次发送的字节数（含开头的`#`和结尾的换行）
+const UART_LINE: usize = 64;
+
+/// IIC测试的事务次数
+const IIC_TRANSACTIONS: u32 = 200;
+
+/// FLASH测试的擦写次数
+const FLASH_CYCLES: u32 = 4;
+
+/// 中断延迟测试的触发次数
+const ISR_SAMPLES: u32 = 1000;
+
+/// SCB中断控制及状态寄存器地址
+const SCB_ICSR: u32 = 0xE000_ED04;
+
+/// ICSR寄存器PENDSVSET位
+const ICSR_PENDSVSET: u32 = 1 << 28;
+
+extern "C" {
+    /// FLASH区域末地址（`memory.x`）
+    static __flash_end: u32;
+    /// `.data`（含`.ramfunc`）初始值在FLASH中的加载地址（cortex-m-rt）
+    static __sidata: u32;
+    static __sdata: u32;
+    static __edata: u32;
+}
+
+/// 测试数据（按字对齐，供CRC的字/DMA路径使用）
+static mut BLOCK: [u32; BLOCK_WORDS] = [0; BLOCK_WORDS];
+
+/// OLED双缓冲存储
+static mut OLED_BUFFERS: OledBuffers = OledBuffers::new();
+
+static UART_TX: ProfileCounter = ProfileCounter::new("uart_tx");
+static SPI_DMA_TX: ProfileCounter = ProfileCounter::new("spi_dma_tx");
+static IIC_WRITE: ProfileCounter = ProfileCounter::new("iic_write");
+static CRC_BLOCK: ProfileCounter = ProfileCounter::new("crc_block");
+static CRC_DMA: ProfileCounter = ProfileCounter::new("crc_dma");
+static FLASH_ERASE: ProfileCounter = ProfileCounter::new("flash_erase");
+static FLASH_PROGRAM: ProfileCounter = ProfileCounter::new("flash_program");
+static OLED_FRAME: ProfileCounter = ProfileCounter::new("oled_frame");
+#[cfg(feature = "c-drivers")]
+static C_OLED_FRAME: ProfileCounter = ProfileCounter::new("c_oled_frame");
+static ISR_LATENCY: ProfileCounter = ProfileCounter::new("isr_latency");
+
+/// 触发PendSV时的周期计数
+static PENDSV_TRIGGER: AtomicU32 = AtomicU32::new(0);
+
+/// PendSV异常：记录从挂起到进入处理函数的周期数
+#[exception]
+fn PendSV() {
+    ISR_LATENCY.record_since(PENDSV_TRIGGER.load(Ordering::Relaxed));
+}
+
+#[entry]
+fn main() -> ! {
+    let init = system::init();
+    
+    unsafe {
+        profile::init();
+        
+        // USART1：PA9=TX，PA10=RX
+        gpio::PA9.into_alternate_push_pull();
+        gpio::PA10.into_floating_input();
+        let mut out = Serial::new(SerialPort::USART1);
+        out.init_default();
+        out.enable();
+        
+        let _ = writeln!(out, "BENCH start sysclk={} init={:?}", system_clock(), init);
+        
+        // 填充测试数据
+        let block = &mut *core::ptr::addr_of_mut!(BLOCK);
+        let mut seed = 0x1234_5678u32;
+        for word in block.iter_mut() {
+            seed = seed.wrapping_mul(1_664_525).wrapping_add(1_013_904_223);
+            *word = seed;
+        }
+        
+        bench_uart(&mut out);
+        bench_spi(&mut out);
+        bench_iic(&mut out);
+        bench_crc(&mut out);
+        bench_flash(&mut out);
+        bench_oled(&mut out);
+        #[cfg(feature = "c-drivers")]
+        bench_c_oled(&mut out);
+        bench_isr_latency(&mut out);
+        
+        let _ = writeln!(out, "BENCH done sysclk={}", system_clock());
+    }
+    
+    loop {
+        core::hint::spin_loop();
+    }
+}
+
+/// 测试数据的字节视图
+unsafe fn block_bytes() -> &'static [u8] {
+    core::slice::from_raw_parts(core::ptr::addr_of!(BLOCK) as *const u8, BLOCK_BYTES)
+}
+
+/// 输出一项吞吐量结果
+/// 
+/// # Arguments
+/// * `counter` - 每次迭代记录一个样本的计数器
+/// * `work` - 每次迭代完成的工作量（字节数、事务数或帧数）
+/// * `unit` - 单位
+fn report_rate<W: Write>(out: &mut W, counter: &ProfileCounter, work: u32, unit: &str) {
+    let s = counter.snapshot();
+    let value = if s.total == 0 {
+        0
+    } else {
+        s.count as u64 * work as u64 * system_clock() as u64 / s.total
+    };
+    let _ = writeln!(
+        out,
+        "BENCH name={} value={} unit={} n={} min={} mean={} max={}",
+        counter.name(), value, unit, s.count, s.min, s.mean(), s.max,
+    );
+}
+
+/// 输出一项失败结果
+fn report_error<W: Write, E: core::fmt::Debug>(out: &mut W, name: &str, error: E) {
+    let _ = writeln!(out, "BENCH name={} error={:?}", name, error);
+}
+
+/// UART阻塞发送吞吐量
+/// 
+/// 发送内容为以`#`开头的注释行，解析脚本忽略即可；
+/// 每次计时包含等待最后一个字节移出（TC），因此结果即线速。
+unsafe fn bench_uart(out: &mut Serial) {
+    let mut line = [b'U'; UART_LINE];
+    line[0] = b'#';
+    line[UART_LINE - 1] = b'\n';
+    
+    for _ in 0..ITERATIONS {
+        let _t = UART_TX.scope();
+        out.write_bytes(&line);
+    }
+    report_rate(out, &UART_TX, UART_LINE as u32, "B/s");
+}
+
+/// SPI1 DMA发送吞吐量（PCLK2/2，只发送）
+unsafe fn bench_spi(out: &mut Serial) {
+    gpio::PA5.into_alternate_push_pull();
+    gpio::PA7.into_alternate_push_pull();
+    DMA1_CHANNEL3.enable_clock();
+    SPI1.init(
+        SpiMode::Mode0,
+        SpiDataSize::Bits8,
+        SpiBaudRatePrescaler::Div2,
+        SpiDirection::TwoLinesFullDuplex,
+        SpiNssMode::Software,
+    );
+    
+    let data = block_bytes();
+    for _ in 0..ITERATIONS {
+        let start = cycle_count();
+        let result = match SPI1.start_write_dma(data) {
+            Ok(transfer) => transfer.wait(),
+            Err(err) => Err(err),
+        };
+        if let Err(err) = result {
+            report_error(out, SPI_DMA_TX.name(), err);
+            return;
+        }
+        SPI_DMA_TX.record_since(start);
+    }
+    report_rate(out, &SPI_DMA_TX, BLOCK_BYTES as u32, "B/s");
+}
+
+/// I2C1 短事务速率（400kHz，每次向OLED写一条NOP命令）
+unsafe fn bench_iic(out: &mut Serial) {
+    let i2c = HardwareIic::new_default(400_000);
+    i2c.init();
+    
+    for _ in 0..IIC_TRANSACTIONS {
+        let start = cycle_count();
+        if let Err(err) = i2c.write(OLED_I2C_ADDR, &[0x00, 0xE3]) {
+            report_error(out, IIC_WRITE.name(), err);
+            return;
+        }
+        IIC_WRITE.record_since(start);
+    }
+    report_rate(out, &IIC_WRITE, 1, "txn/s");
+}
+
+/// CRC吞吐量：CPU逐字写入的标准CRC-32，以及DMA存储器到存储器的硬件原生CRC
+unsafe fn bench_crc(out: &mut Serial) {
+    CRC.init();
+    DMA1_CHANNEL1.enable_clock();
+    
+    let bytes = block_bytes();
+    for _ in 0..ITERATIONS {
+        let _t = CRC_BLOCK.scope();
+        core::hint::black_box(CRC.calculate_block(bytes));
+    }
+    report_rate(out, &CRC_BLOCK, BLOCK_BYTES as u32, "B/s");
+    
+    let words = &*core::ptr::addr_of!(BLOCK);
+    for _ in 0..ITERATIONS {
+        let start = cycle_count();
+        if let Err(err) = CRC.calculate_words_dma(DMA1_CHANNEL1, words) {
+            report_error(out, CRC_DMA.name(), err);
+            return;
+        }
+        CRC_DMA.record_since(start);
+    }
+    report_rate(out, &CRC_DMA, BLOCK_BYTES as u32, "B/s");
+}
+
+/// FLASH测试使用的页：FLASH区域的最后一整页
+fn bench_flash_page() -> u32 {
+    let end = unsafe { core::ptr::addr_of!(__flash_end) } as u32;
+    (end - FLASH_PAGE_SIZE) & !(FLASH_PAGE_SIZE - 1)
+}
+
+/// 程序映像在FLASH中的结束地址（`.data`初始值是映像的最后一段）
+fn image_end() -> u32 {
+    unsafe {
+        let data_len = core::ptr::addr_of!(__edata) as u32 - core::ptr::addr_of!(__sdata) as u32;
+        core::ptr::addr_of!(__sidata) as u32 + data_len
+    }
+}
+
+/// FLASH页擦除速率和批量编程吞吐量
+unsafe fn bench_flash(out: &mut Serial) {
+    let data = &block_bytes()[..FLASH_PAGE_SIZE as usize];
+    let page = bench_flash_page();
+    if page < image_end() {
+        report_error(out, FLASH_ERASE.name(), "PageOverlapsImage");
+        return;
+    }
+    
+    FLASH.unlock();
+    for _ in 0..FLASH_CYCLES {
+        let start = cycle_count();
+        if let Err(err) = FLASH.erase_page(page) {
+            FLASH.lock();
+            report_error(out, FLASH_ERASE.name(), err);
+            return;
+        }
+        FLASH_ERASE.record_since(start);
+        
+        let start = cycle_count();
+        if let Err(err) = FLASH.program(page, data) {
+            FLASH.lock();
+            report_error(out, FLASH_PROGRAM.name(), err);
+            return;
+        }
+        FLASH_PROGRAM.record_since(start);
+    }
+    FLASH.lock();
+    
+    report_rate(out, &FLASH_ERASE, 1, "page/s");
+    report_rate(out, &FLASH_PROGRAM, FLASH_PAGE_SIZE, "B/s");
+}
+
+/// OLED整帧刷新帧率（I2C1 400kHz + DMA，每帧包含绘制和传输）
+unsafe fn bench_oled(out: &mut Serial) {
+    let mut oled = Ssd1306::new(
+        HardwareIic::new_default(400_000),
+        &mut *core::ptr::addr_of_mut!(OLED_BUFFERS),
+    );
+    if let Err(err) = oled.init() {
+        report_error(out, OLED_FRAME.name(), err);
+        return;
+    }
+    
+    for frame in 0..ITERATIONS {
+        let start = cycle_count();
+        
+        // 每帧移动一个方块，保证每帧内容不同
+        let buffer = oled.buffer();
+        buffer.clear();
+        let x = (frame as i16 * 8) % OLED_WIDTH as i16;
+        buffer.fill_rect(x, 0, 8, OLED_HEIGHT as u16, OledColor::White);
+        
+        let result = match oled.flush_async() {
+            Ok(()) => loop {
+                match oled.poll() {
+                    Ok(false) => core::hint::spin_loop(),
+                    Ok(true) => break Ok(()),
+                    Err(err) => break Err(err),
+                }
+            },
+            Err(err) => Err(err),
+        };
+        if let Err(err) = result {
+            report_error(out, OLED_FRAME.name(), err);
+            return;
+        }
+        OLED_FRAME.record_since(start);
+    }
+    report_rate(out, &OLED_FRAME, 1, "frame/s");
+}
+
+/// C语言OLED驱动整帧刷新帧率（`c-drivers`特性，绘制内容与`bench_oled`相同）
+/// 
+/// 与`oled_frame`对比可以看出C库的优化等级和跨语言LTO（`c-lto`）的效果。
+/// C驱动初始化时不检查应答，未接OLED时结果无意义。
+#[cfg(feature = "c-drivers")]
+unsafe fn bench_c_oled(out: &mut Serial) {
+    use crate::bsp::c_oled;
+    
+    c_oled::init();
+    for frame in 0..ITERATIONS {
+        let start = cycle_count();
+        
+        c_oled::clear();
+        let x = (frame as i16 * 8) % OLED_WIDTH as i16;
+        c_oled::draw_rect(x, 0, 8, OLED_HEIGHT as i16, true);
+        c_oled::update();
+        
+        C_OLED_FRAME.record_since(start);
+    }
+    report_rate(out, &C_OLED_FRAME, 1, "frame/s");
+}
+
+/// 中断延迟：从挂起PendSV到进入处理函数第一条语句的周期数
+/// 
+/// 包含内核压栈、取向量和处理函数序言，是所有中断的延迟下限；
+/// 外设中断还需加上外设同步时间。
+unsafe fn bench_isr_latency(out: &mut Serial) {
+    for _ in 0..ISR_SAMPLES {
+        let trigger = cycle_count();
+        PENDSV_TRIGGER.store(trigger, Ordering::Relaxed);
+        core::ptr::write_volatile(SCB_ICSR as *mut u32, ICSR_PENDSVSET);
+        cortex_m::asm::dsb();
+        cortex_m::asm::isb();
+    }
+    
+    let s = ISR_LATENCY.snapshot();
+    let _ = writeln!(
+        out,
+        "BENCH name={} value={} unit=cycles n={} min={} mean={} max={} p99={}",
+        ISR_LATENCY.name(), s.min, s.count, s.min, s.mean(), s.max, s.percentile(99),
+    );
+}
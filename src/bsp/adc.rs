@@ -4,8 +4,16 @@
 // 屏蔽未使用代码警告
 #![allow(unused)]
 
+use core::sync::atomic::{AtomicU8, Ordering};
+
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransferDescriptor, DmaChannelPriority,
+    DmaPeripheralDataSize, DmaMemoryDataSize, DmaDoubleBuffer, DmaHalf, DMA1_CHANNEL1,
+};
+use crate::bsp::reg;
+use crate::bsp::timer::{Timer, TimerNumber, TimerMasterMode, PwmChannel, PwmMode, PwmPolarity};
 
 /// ADC模式枚举
 #[derive(Debug, Clone, Copy)]
@@ -114,8 +122,9 @@ pub struct AdcConfig {
     pub nbr_of_channel: u8,               // 通道数量(1-16)
 }
 
-impl Default for AdcConfig {
-    fn default() -> Self {
+impl AdcConfig {
+    /// 默认配置：独立模式、单通道单次转换、软件触发、右对齐
+    pub const fn new() -> Self {
         AdcConfig {
             mode: AdcMode::Independent,
             scan_conv_mode: false,
@@ -127,6 +136,59 @@ impl Default for AdcConfig {
     }
 }
 
+impl Default for AdcConfig {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// ADC寄存器偏移地址
+const ADC_CR1_OFFSET: usize = 0x04;
+const ADC_CR2_OFFSET: usize = 0x08;
+const ADC_SQR1_OFFSET: usize = 0x2C;
+
+/// ADC初始化映像：由`AdcConfig`预先计算好的寄存器值
+/// 
+/// 用`const`定义时在编译期求值，`Adc::init_with_image`每个寄存器只写一次
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct AdcInitImage {
+    pub cr1: u32,
+    pub cr2: u32,
+    pub sqr1: u32,
+}
+
+impl AdcInitImage {
+    /// 按配置计算寄存器值
+    /// 
+    /// # Arguments
+    /// * `config` - ADC配置，`nbr_of_channel`限制在1~16
+    pub const fn new(config: &AdcConfig) -> Self {
+        // CR1：双ADC模式和扫描模式（SCAN）
+        let mut cr1 = config.mode as u32;
+        if config.scan_conv_mode {
+            cr1 |= 1 << 8;
+        }
+        
+        // CR2：外部触发、数据对齐、连续转换（CONT）和ADON
+        let mut cr2 = (config.external_trig_conv as u32) | (config.data_align as u32) | (1 << 0);
+        if config.continuous_conv_mode {
+            cr2 |= 1 << 1;
+        }
+        
+        // SQR1：规则序列长度L[3:0]，写入值为通道数减1
+        let channels = if config.nbr_of_channel == 0 {
+            1
+        } else if config.nbr_of_channel > 16 {
+            16
+        } else {
+            config.nbr_of_channel
+        };
+        let sqr1 = ((channels as u32 - 1) & 0x0F) << 20;
+        
+        Self { cr1, cr2, sqr1 }
+    }
+}
+
 /// ADC结构体
 pub struct Adc {
     number: AdcNumber,
@@ -149,6 +211,14 @@ impl AdcNumber {
         }
     }
     
+    /// 获取ADC寄存器基地址
+    const fn base_address(&self) -> usize {
+        match self {
+            AdcNumber::ADC1 => 0x4001_2400,
+            AdcNumber::ADC2 => 0x4001_2800,
+        }
+    }
+    
     /// 获取ADC时钟使能位
     const fn clock_en_bit(&self) -> u32 {
         match self {
@@ -183,72 +253,24 @@ impl Adc {
     }
     
     /// 初始化ADC
+    /// 
+    /// 由配置计算初始化映像后调用`init_with_image`
     pub fn init(&self, config: &AdcConfig) {
-        let rcc = unsafe { &mut *(0x40021000 as *mut library::rcc::RegisterBlock) };
-        
-        // 1. 启用ADC时钟
+        self.init_with_image(&AdcInitImage::new(config));
+    }
+    
+    /// 按预先计算的初始化映像初始化ADC
+    /// 
+    /// 使能时钟后CR1、SQR1、CR2各写一次，CR2（含ADON）最后写入，然后校准
+    pub fn init_with_image(&self, image: &AdcInitImage) {
+        let base = self.number.base_address();
         unsafe {
-            match self.number {
-                AdcNumber::ADC1 => {
-                    rcc.apb2enr().modify(|_, w: &mut library::rcc::apb2enr::W| {
-                        w.adc1en().set_bit()
-                    });
-                    
-                    // 3. 配置ADC1控制寄存器
-                    let adc = unsafe { &mut *(0x40012400 as *mut library::adc1::RegisterBlock) };
-                    
-                    // CR1: 配置ADC模式和扫描模式
-                    let mut cr1_bits = config.mode as u32;
-                    if config.scan_conv_mode {
-                        cr1_bits |= 0x00000100; // 设置扫描模式位
-                    }
-                    adc.cr1().write(|w| w.bits(cr1_bits));
-                    
-                    // CR2: 配置连续转换、外部触发、数据对齐和启动ADC
-                    let mut cr2_bits = (config.external_trig_conv as u32) | (config.data_align as u32);
-                    if config.continuous_conv_mode {
-                        cr2_bits |= 0x00000001; // 设置连续转换位
-                    }
-                    cr2_bits |= 0x00000001; // 启用ADC
-                    adc.cr2().write(|w| w.bits(cr2_bits));
-                    
-                    // 4. 配置通道数量
-                    adc.sqr1().modify(|_, w| w.l().bits(config.nbr_of_channel - 1));
-                    
-                    // 5. 校准ADC
-                    self.calibrate();
-                },
-                AdcNumber::ADC2 => {
-                    rcc.apb2enr().modify(|_, w: &mut library::rcc::apb2enr::W| {
-                        w.adc2en().set_bit()
-                    });
-                    
-                    // 3. 配置ADC2控制寄存器
-                    let adc = unsafe { &mut *(0x40012800 as *mut library::adc2::RegisterBlock) };
-                    
-                    // CR1: 配置ADC模式和扫描模式
-                    let mut cr1_bits = config.mode as u32;
-                    if config.scan_conv_mode {
-                        cr1_bits |= 0x00000100; // 设置扫描模式位
-                    }
-                    adc.cr1().write(|w| w.bits(cr1_bits));
-                    
-                    // CR2: 配置连续转换、外部触发、数据对齐和启动ADC
-                    let mut cr2_bits = (config.external_trig_conv as u32) | (config.data_align as u32);
-                    if config.continuous_conv_mode {
-                        cr2_bits |= 0x00000001; // 设置连续转换位
-                    }
-                    cr2_bits |= 0x00000001; // 启用ADC
-                    adc.cr2().write(|w| w.bits(cr2_bits));
-                    
-                    // 4. 配置通道数量
-                    adc.sqr1().modify(|_, w| w.l().bits(config.nbr_of_channel - 1));
-                    
-                    // 5. 校准ADC
-                    self.calibrate();
-                },
-            }
+            reg::RCC_APB2ENR.set_bits(self.number.clock_en_bit());
+            reg::write(base + ADC_CR1_OFFSET, image.cr1);
+            reg::write(base + ADC_SQR1_OFFSET, image.sqr1);
+            reg::write(base + ADC_CR2_OFFSET, image.cr2);
         }
+        self.calibrate();
     }
     
     /// 重置校准
@@ -1312,3 +1334,439 @@ impl Adc {
 /// 预定义的ADC常量
 pub const ADC1: Adc = Adc::new(AdcNumber::ADC1);
 pub const ADC2: Adc = Adc::new(AdcNumber::ADC2);
+
+/// ADC1规则数据寄存器地址（DMA源地址）
+pub const ADC1_DR_ADDRESS: u32 = 0x4001_244C;
+
+/// ADC1对应的DMA通道（ADC2没有DMA请求，只能通过双ADC模式由ADC1搬运）
+pub const ADC1_DMA: Dma = DMA1_CHANNEL1;
+
+/// ADC采样引擎错误类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum AdcSamplerError {
+    /// 通道数为0或超过16
+    InvalidChannelCount,
+    /// 半缓冲区长度不是通道数的整数倍
+    InvalidBlockSize,
+    /// 采样率为0或超出定时器范围
+    InvalidRate,
+    /// DMA启动失败
+    Dma(DmaError),
+}
+
+impl From<DmaError> for AdcSamplerError {
+    fn from(err: DmaError) -> Self {
+        AdcSamplerError::Dma(err)
+    }
+}
+
+/// ADC采样点类型
+/// 
+/// 单ADC模式每个采样点为16位；双ADC同步模式下ADC1_DR的32位字同时包含
+/// ADC1（低16位）和ADC2（高16位）的结果。
+pub trait AdcSample: Copy {
+    /// 初始值
+    const ZERO: Self;
+    /// DMA外设数据宽度
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize;
+    /// DMA内存数据宽度
+    const MEMORY_SIZE: DmaMemoryDataSize;
+}
+
+impl AdcSample for u16 {
+    const ZERO: Self = 0;
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize = DmaPeripheralDataSize::HalfWord;
+    const MEMORY_SIZE: DmaMemoryDataSize = DmaMemoryDataSize::HalfWord;
+}
+
+impl AdcSample for u32 {
+    const ZERO: Self = 0;
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize = DmaPeripheralDataSize::Word;
+    const MEMORY_SIZE: DmaMemoryDataSize = DmaMemoryDataSize::Word;
+}
+
+/// ADC采样双缓冲区
+/// 
+/// 建立在`DmaDoubleBuffer`之上，DMA以循环模式写满整个缓冲区，前一半和后一半各为一个数据块：
+/// - 半传输中断发布前一半，传输完成中断发布后一半
+/// - 消费者通过`take_block`以零拷贝方式拿到已完成的数据块，释放（drop）后DMA可以再次覆盖
+/// 
+/// 数据按扫描顺序交错存放：`[ch0, ch1, ..., chN, ch0, ch1, ...]`。
+/// `N`为总采样点数，必须为偶数且不超过65535。
+pub struct AdcSampleBuffer<const N: usize, T: AdcSample = u16> {
+    inner: DmaDoubleBuffer<T, N>,
+    /// 扫描序列中的通道数
+    channels: AtomicU8,
+}
+
+impl<const N: usize, T: AdcSample> AdcSampleBuffer<N, T> {
+    /// 每个数据块的采样点数
+    pub const BLOCK_LEN: usize = N / 2;
+    
+    /// 创建新的采样缓冲区
+    pub const fn new() -> Self {
+        Self {
+            inner: DmaDoubleBuffer::new(T::ZERO),
+            channels: AtomicU8::new(1),
+        }
+    }
+    
+    /// 复位状态（必须在DMA停止时调用）
+    unsafe fn reset(&self, channels: u8) {
+        self.channels.store(channels, Ordering::Relaxed);
+        self.inner.reset();
+    }
+    
+    /// 以循环模式启动DMA，从`source`寄存器搬运到整个缓冲区
+    unsafe fn start_dma(&self, dma: Dma, source: u32) -> Result<(), DmaError> {
+        let desc = self.inner
+            .peripheral_to_memory(source)
+            .with_data_size(T::PERIPHERAL_SIZE, T::MEMORY_SIZE)
+            .with_priority(DmaChannelPriority::High);
+        dma.start_circular(&desc)
+    }
+    
+    /// 取出下一个已完成的数据块（零拷贝）
+    /// 
+    /// 同一时刻只能持有一个数据块，上一个尚未丢弃时返回`None`（每个块释放时都会推进半区状态）
+    pub fn take_block(&self) -> Option<AdcBlock<'_, T>> {
+        let block = self.inner.take()?;
+        Some(AdcBlock {
+            block,
+            channels: self.channels.load(Ordering::Relaxed) as usize,
+        })
+    }
+    
+    /// 获取溢出次数（数据块未及时释放而被DMA覆盖，或DMA传输错误）
+    pub fn overruns(&self) -> u32 {
+        self.inner.lags()
+    }
+}
+
+/// 已完成的ADC数据块
+/// 
+/// 借用采样缓冲区的一个半区，drop时自动释放给DMA。
+pub struct AdcBlock<'a, T: AdcSample = u16> {
+    block: DmaHalf<'a, T>,
+    channels: usize,
+}
+
+impl<'a, T: AdcSample> AdcBlock<'a, T> {
+    /// 获取交错存放的全部采样点
+    pub fn samples(&self) -> &[T] {
+        &self.block
+    }
+    
+    /// 获取扫描序列中的通道数
+    pub fn channels(&self) -> usize {
+        self.channels
+    }
+    
+    /// 获取块中的帧数（每帧包含每个通道各一个采样点）
+    pub fn frame_count(&self) -> usize {
+        self.block.len() / self.channels
+    }
+    
+    /// 按帧迭代，每帧为一次完整扫描的结果
+    pub fn frames(&self) -> core::slice::ChunksExact<'_, T> {
+        self.block.chunks_exact(self.channels)
+    }
+    
+    /// 迭代某个通道（按扫描序列中的序号）的全部采样点
+    /// 
+    /// # Arguments
+    /// * `index` - 通道在扫描序列中的序号（从0开始）
+    pub fn channel(&self, index: usize) -> impl Iterator<Item = T> + '_ {
+        self.block.iter().skip(index).step_by(self.channels).copied()
+    }
+}
+
+impl<'a> AdcBlock<'a, u32> {
+    /// 以16位视图访问打包的双ADC数据（零拷贝）
+    /// 
+    /// 小端存放，偶数下标为ADC1（主）结果，奇数下标为ADC2（从）结果。
+    pub fn halfwords(&self) -> &[u16] {
+        // SAFETY: u32切片按4字节对齐，重新解释为两倍长度的u16切片始终有效
+        unsafe {
+            core::slice::from_raw_parts(self.block.as_ptr() as *const u16, self.block.len() * 2)
+        }
+    }
+    
+    /// 迭代ADC1（主）在扫描序列某个序号上的全部采样点
+    pub fn master(&self, index: usize) -> impl Iterator<Item = u16> + '_ {
+        self.channel(index).map(|word| word as u16)
+    }
+    
+    /// 迭代ADC2（从）在扫描序列某个序号上的全部采样点
+    pub fn slave(&self, index: usize) -> impl Iterator<Item = u16> + '_ {
+        self.channel(index).map(|word| (word >> 16) as u16)
+    }
+}
+
+/// 配置定时器节拍，返回对应的ADC外部触发源（定时器保持停止）
+unsafe fn configure_trigger(timer_number: TimerNumber, sample_rate_hz: u32) -> Result<AdcExternalTrig, AdcSamplerError> {
+    let timer = Timer::new(timer_number);
+    let (prescaler, period) = timer
+        .prescaler_period_for(sample_rate_hz)
+        .ok_or(AdcSamplerError::InvalidRate)?;
+    
+    let (channel, trig) = match timer_number {
+        TimerNumber::TIM3 => {
+            timer.init(prescaler, period);
+            timer.set_master_mode(TimerMasterMode::Update);
+            return Ok(AdcExternalTrig::T3TRGO);
+        },
+        TimerNumber::TIM1 => (PwmChannel::Channel1, AdcExternalTrig::T1CC1),
+        TimerNumber::TIM2 => (PwmChannel::Channel2, AdcExternalTrig::T2CC2),
+        TimerNumber::TIM4 => (PwmChannel::Channel4, AdcExternalTrig::T4CC4),
+    };
+    
+    // 比较通道工作在PWM模式，每个周期产生一次比较事件
+    timer.init_pwm(channel, PwmMode::Mode1, PwmPolarity::High, period, prescaler, period / 2);
+    timer.stop();
+    Ok(trig)
+}
+
+/// ADC多通道扫描采样引擎
+/// 
+/// 把规则序列、定时器触发和DMA循环双缓冲组合在一起：
+/// 定时器按采样率触发一次完整扫描，DMA把结果搬到缓冲区，
+/// 每写满半个缓冲区通过中断交给消费者，整个过程不需要CPU参与单次转换。
+/// 
+/// 触发源与定时器的对应关系（由ADC1/ADC2规则通道的外部触发决定）：
+/// - TIM3：TRGO（更新事件）
+/// - TIM1：CC1事件
+/// - TIM2：CC2事件
+/// - TIM4：CC4事件
+/// 
+/// 使用时需在DMA1通道1中断中调用`handle_dma_interrupt`，并在NVIC中使能该中断。
+pub struct AdcSampler<const N: usize> {
+    timer: TimerNumber,
+    buffer: &'static AdcSampleBuffer<N>,
+}
+
+impl<const N: usize> AdcSampler<N> {
+    /// 创建新的采样引擎
+    /// 
+    /// # Arguments
+    /// * `timer` - 提供采样节拍的定时器
+    /// * `buffer` - 双缓冲区
+    pub const fn new(timer: TimerNumber, buffer: &'static AdcSampleBuffer<N>) -> Self {
+        Self {
+            timer,
+            buffer,
+        }
+    }
+    
+    /// 获取采样缓冲区
+    pub fn buffer(&self) -> &'static AdcSampleBuffer<N> {
+        self.buffer
+    }
+    
+    /// 启动采样
+    /// 
+    /// # Arguments
+    /// * `channels` - 扫描序列（1-16个通道，按顺序转换）
+    /// * `sample_time` - 每个通道的采样时间
+    /// * `sample_rate_hz` - 扫描频率，即每个通道的采样率
+    /// 
+    /// # Returns
+    /// 成功返回`Ok(())`，参数无效或DMA忙返回错误
+    /// 
+    /// # Safety
+    /// 会重新配置ADC1、指定定时器和DMA1通道1，调用者必须保证它们没有被其他代码使用
+    pub unsafe fn start(
+        &self,
+        channels: &[AdcChannel],
+        sample_time: AdcSampleTime,
+        sample_rate_hz: u32,
+    ) -> Result<(), AdcSamplerError> {
+        if channels.is_empty() || channels.len() > 16 {
+            return Err(AdcSamplerError::InvalidChannelCount);
+        }
+        if AdcSampleBuffer::<N>::BLOCK_LEN % channels.len() != 0 {
+            return Err(AdcSamplerError::InvalidBlockSize);
+        }
+        
+        self.stop();
+        self.buffer.reset(channels.len() as u8);
+        
+        let trig = configure_trigger(self.timer, sample_rate_hz)?;
+        
+        // 扫描模式，单次扫描由外部触发启动
+        ADC1.init(&AdcConfig {
+            mode: AdcMode::Independent,
+            scan_conv_mode: true,
+            continuous_conv_mode: false,
+            external_trig_conv: trig,
+            data_align: AdcDataAlign::Right,
+            nbr_of_channel: channels.len() as u8,
+        });
+        for (i, &channel) in channels.iter().enumerate() {
+            ADC1.regular_channel_config(channel, (i + 1) as u8, sample_time);
+        }
+        
+        self.buffer.start_dma(ADC1_DMA, ADC1_DR_ADDRESS)?;
+        
+        ADC1.dma_cmd(true);
+        ADC1.external_trig_conv_cmd(true);
+        Timer::new(self.timer).start();
+        Ok(())
+    }
+    
+    /// 停止采样
+    pub unsafe fn stop(&self) {
+        Timer::new(self.timer).stop();
+        ADC1.external_trig_conv_cmd(false);
+        ADC1.dma_cmd(false);
+        ADC1_DMA.disable();
+        ADC1_DMA.clear_all_interrupts();
+    }
+    
+    /// 处理DMA通道中断：半传输发布前一半，传输完成发布后一半
+    pub fn handle_dma_interrupt(&self) {
+        self.buffer.inner.handle_dma_interrupt(ADC1_DMA);
+    }
+    
+    /// 取出下一个已完成的数据块（零拷贝）
+    pub fn take_block(&self) -> Option<AdcBlock<'static>> {
+        self.buffer.take_block()
+    }
+    
+    /// 获取溢出次数
+    pub fn overruns(&self) -> u32 {
+        self.buffer.overruns()
+    }
+}
+
+/// 双ADC规则同步采样引擎
+/// 
+/// ADC1为主、ADC2为从，工作在规则同步模式（`AdcMode::RegSimult`）：
+/// 定时器触发ADC1时ADC2同时转换同一序号上的通道，两路结果相位对齐。
+/// ADC1_DR的32位字中低16位为ADC1结果、高16位为ADC2结果，
+/// DMA按字搬运到循环双缓冲区，消费者通过`AdcBlock::master`/`slave`/`halfwords`零拷贝拆分。
+/// 
+/// 使用时需在DMA1通道1中断中调用`handle_dma_interrupt`，并在NVIC中使能该中断。
+pub struct DualAdc<const N: usize> {
+    timer: TimerNumber,
+    buffer: &'static AdcSampleBuffer<N, u32>,
+}
+
+impl<const N: usize> DualAdc<N> {
+    /// 创建新的双ADC采样引擎
+    /// 
+    /// # Arguments
+    /// * `timer` - 提供采样节拍的定时器（触发源对应关系与`AdcSampler`相同）
+    /// * `buffer` - 32位双缓冲区
+    pub const fn new(timer: TimerNumber, buffer: &'static AdcSampleBuffer<N, u32>) -> Self {
+        Self {
+            timer,
+            buffer,
+        }
+    }
+    
+    /// 获取采样缓冲区
+    pub fn buffer(&self) -> &'static AdcSampleBuffer<N, u32> {
+        self.buffer
+    }
+    
+    /// 启动同步采样
+    /// 
+    /// # Arguments
+    /// * `master_channels` - ADC1扫描序列
+    /// * `slave_channels` - ADC2扫描序列，长度必须与主序列相同
+    /// * `sample_time` - 每个通道的采样时间（两个ADC必须一致才能保持同步）
+    /// * `sample_rate_hz` - 扫描频率
+    /// 
+    /// # Returns
+    /// 成功返回`Ok(())`；序列长度不一致、同一序号上两个ADC使用同一通道（硬件禁止）
+    /// 或通道数超范围时返回`AdcSamplerError::InvalidChannelCount`
+    /// 
+    /// # Safety
+    /// 会重新配置ADC1、ADC2、指定定时器和DMA1通道1，调用者必须保证它们没有被其他代码使用
+    pub unsafe fn start(
+        &self,
+        master_channels: &[AdcChannel],
+        slave_channels: &[AdcChannel],
+        sample_time: AdcSampleTime,
+        sample_rate_hz: u32,
+    ) -> Result<(), AdcSamplerError> {
+        let count = master_channels.len();
+        if count == 0 || count > 16 || slave_channels.len() != count {
+            return Err(AdcSamplerError::InvalidChannelCount);
+        }
+        if master_channels.iter().zip(slave_channels).any(|(&m, &s)| m as u8 == s as u8) {
+            return Err(AdcSamplerError::InvalidChannelCount);
+        }
+        if AdcSampleBuffer::<N, u32>::BLOCK_LEN % count != 0 {
+            return Err(AdcSamplerError::InvalidBlockSize);
+        }
+        
+        self.stop();
+        self.buffer.reset(count as u8);
+        
+        let trig = configure_trigger(self.timer, sample_rate_hz)?;
+        
+        // 从ADC：由主ADC同步启动，外部触发选择软件启动并使能
+        ADC2.init(&AdcConfig {
+            mode: AdcMode::Independent,
+            scan_conv_mode: true,
+            continuous_conv_mode: false,
+            external_trig_conv: AdcExternalTrig::None,
+            data_align: AdcDataAlign::Right,
+            nbr_of_channel: count as u8,
+        });
+        for (i, &channel) in slave_channels.iter().enumerate() {
+            ADC2.regular_channel_config(channel, (i + 1) as u8, sample_time);
+        }
+        ADC2.external_trig_conv_cmd(true);
+        
+        // 主ADC：规则同步模式，由定时器触发
+        ADC1.init(&AdcConfig {
+            mode: AdcMode::RegSimult,
+            scan_conv_mode: true,
+            continuous_conv_mode: false,
+            external_trig_conv: trig,
+            data_align: AdcDataAlign::Right,
+            nbr_of_channel: count as u8,
+        });
+        for (i, &channel) in master_channels.iter().enumerate() {
+            ADC1.regular_channel_config(channel, (i + 1) as u8, sample_time);
+        }
+        
+        self.buffer.start_dma(ADC1_DMA, ADC1_DR_ADDRESS)?;
+        
+        ADC1.dma_cmd(true);
+        ADC1.external_trig_conv_cmd(true);
+        Timer::new(self.timer).start();
+        Ok(())
+    }
+    
+    /// 停止采样并恢复独立模式
+    pub unsafe fn stop(&self) {
+        Timer::new(self.timer).stop();
+        ADC1.external_trig_conv_cmd(false);
+        ADC1.dma_cmd(false);
+        ADC1_DMA.disable();
+        ADC1_DMA.clear_all_interrupts();
+        
+        // 清除DUALMOD位
+        let adc = &mut *(0x40012400 as *mut library::adc1::RegisterBlock);
+        adc.cr1().modify(|r, w| w.bits(r.bits() & !0x000F_0000));
+    }
+    
+    /// 处理DMA通道中断
+    pub fn handle_dma_interrupt(&self) {
+        self.buffer.inner.handle_dma_interrupt(ADC1_DMA);
+    }
+    
+    /// 取出下一个已完成的数据块（零拷贝）
+    pub fn take_block(&self) -> Option<AdcBlock<'static, u32>> {
+        self.buffer.take_block()
+    }
+    
+    /// 获取溢出次数
+    pub fn overruns(&self) -> u32 {
+        self.buffer.overruns()
+    }
+}
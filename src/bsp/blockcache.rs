@@ -0,0 +1,335 @@
+//! 块缓存模块
+//! 在`BlockDevice`之上提供固定大小的LRU扇区缓存（写回）和顺序预读
+//! 
+//! 文件系统的FAT表项、目录扇区等小块随机读写命中缓存后不再产生命令往返；
+//! 连续读取未命中的块时一次用多块读取（SD卡为CMD18）预读`W`个块。
+//! 缓存占用`N × 512`字节静态RAM，`N`和`W`在编译期通过泛型参数确定，
+//! 按内存预算选择（例如20KB RAM的芯片上`N = 8`占用4KB）。
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use crate::bsp::sdio::{Block, BlockDevice, BLOCK_SIZE};
+
+/// 空槽位标记
+const INVALID_TAG: u32 = u32::MAX;
+
+/// 缓存统计
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct BlockCacheStats {
+    pub hits: u32,       // 命中次数
+    pub misses: u32,     // 未命中次数
+    pub prefetched: u32, // 预读的块数（不含触发预读的块）
+    pub writebacks: u32, // 写回设备的块数
+}
+
+/// 缓存状态
+struct CacheState<const N: usize> {
+    blocks: [Block; N],
+    /// 各槽位缓存的块号，`INVALID_TAG`表示空
+    tags: [u32; N],
+    dirty: [bool; N],
+    /// 最近访问时间戳，越小越久未使用
+    stamps: [u32; N],
+    clock: u32,
+    /// 顺序访问时下一次应访问的块号
+    next_block: u32,
+    /// 上一次访问是否延续了顺序访问
+    sequential: bool,
+    stats: BlockCacheStats,
+}
+
+impl<const N: usize> CacheState<N> {
+    fn lookup(&self, block: u32) -> Option<usize> {
+        self.tags.iter().position(|&tag| tag == block)
+    }
+    
+    fn touch(&mut self, slot: usize) {
+        self.clock = self.clock.wrapping_add(1);
+        self.stamps[slot] = self.clock;
+    }
+    
+    /// 记录一次读访问，更新顺序检测状态
+    fn track(&mut self, block: u32) {
+        self.sequential = block == self.next_block;
+        self.next_block = block.wrapping_add(1);
+    }
+}
+
+/// 写回式块缓存
+/// 
+/// - `N`：缓存块数
+/// - `W`：顺序预读的块数（1表示不预读，不超过`N`）
+/// 
+/// 写入只修改缓存并标记为脏，被淘汰或调用`flush`时才写回设备；
+/// 掉电前必须调用`flush`。缓存本身也实现了`BlockDevice`，可直接作为文件系统的底层设备。
+/// 所有方法只能在同一个上下文中调用。
+/// 
+/// ```ignore
+/// static CACHE: BlockCache<SdCard, 8, 4> = BlockCache::new(&SD_CARD);
+/// 
+/// let mut entry = [0u8; 4];
+/// CACHE.read_bytes(fat_sector, offset, &mut entry)?;
+/// CACHE.write_bytes(fat_sector, offset, &new_entry)?;
+/// CACHE.flush()?;
+/// ```
+pub struct BlockCache<D: BlockDevice + 'static, const N: usize, const W: usize> {
+    device: &'static D,
+    state: UnsafeCell<CacheState<N>>,
+}
+
+/// 实现 Sync trait，约定只在一个上下文中使用
+unsafe impl<D: BlockDevice + Sync + 'static, const N: usize, const W: usize> Sync for BlockCache<D, N, W> {}
+
+impl<D: BlockDevice + 'static, const N: usize, const W: usize> BlockCache<D, N, W> {
+    /// 编译期检查参数
+    const SIZE_CHECK: () = assert!(N > 0 && W > 0 && W <= N, "BlockCache要求 0 < W <= N");
+    
+    /// 创建块缓存
+    /// 
+    /// # Arguments
+    /// * `device` - 底层块设备
+    pub const fn new(device: &'static D) -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            device,
+            state: UnsafeCell::new(CacheState {
+                blocks: [Block::ZERO; N],
+                tags: [INVALID_TAG; N],
+                dirty: [false; N],
+                stamps: [0; N],
+                clock: 0,
+                next_block: INVALID_TAG,
+                sequential: false,
+                stats: BlockCacheStats {
+                    hits: 0,
+                    misses: 0,
+                    prefetched: 0,
+                    writebacks: 0,
+                },
+            }),
+        }
+    }
+    
+    /// 获取缓存状态
+    unsafe fn state(&self) -> &mut CacheState<N> {
+        &mut *self.state.get()
+    }
+    
+    /// 获取统计信息
+    pub fn stats(&self) -> BlockCacheStats {
+        unsafe { self.state().stats }
+    }
+    
+    /// 获取脏块数
+    pub fn dirty_count(&self) -> usize {
+        unsafe { self.state().dirty.iter().filter(|&&dirty| dirty).count() }
+    }
+    
+    /// 写回一个槽位
+    unsafe fn write_back(&self, state: &mut CacheState<N>, slot: usize) -> Result<(), D::Error> {
+        if state.dirty[slot] {
+            self.device.write_blocks(state.tags[slot], core::slice::from_ref(&state.blocks[slot]))?;
+            state.dirty[slot] = false;
+            state.stats.writebacks += 1;
+        }
+        Ok(())
+    }
+    
+    /// 选出最久未使用的槽位并腾空（脏块先写回）
+    unsafe fn evict(&self, state: &mut CacheState<N>) -> Result<usize, D::Error> {
+        let slot = match state.lookup(INVALID_TAG) {
+            Some(slot) => slot,
+            None => (0..N).min_by_key(|&slot| state.stamps[slot]).unwrap_or(0),
+        };
+        self.write_back(state, slot)?;
+        state.tags[slot] = INVALID_TAG;
+        Ok(slot)
+    }
+    
+    /// 从`block`开始预读一段连续块，返回`block`所在的槽位
+    /// 
+    /// 多块读取需要连续的缓冲区，因此选择最久未使用的`W`个相邻槽位作为窗口；
+    /// 窗口内的块号遇到已在缓存中的块时截断，避免同一块出现两份。
+    unsafe fn prefetch(&self, state: &mut CacheState<N>, block: u32) -> Result<usize, D::Error> {
+        let start = (0..=N - W)
+            .step_by(W)
+            .min_by_key(|&start| {
+                (start..start + W)
+                    .map(|slot| if state.tags[slot] == INVALID_TAG { 0 } else { state.stamps[slot] })
+                    .max()
+                    .unwrap_or(0)
+            })
+            .unwrap_or(0);
+        
+        let available = self.device.block_count().saturating_sub(block).min(W as u32) as usize;
+        let count = (1..available)
+            .find(|&i| state.lookup(block + i as u32).is_some())
+            .unwrap_or(available)
+            .max(1);
+        
+        for slot in start..start + count {
+            self.write_back(state, slot)?;
+            state.tags[slot] = INVALID_TAG;
+        }
+        self.device.read_blocks(block, &mut state.blocks[start..start + count])?;
+        
+        state.clock = state.clock.wrapping_add(1);
+        for i in 0..count {
+            state.tags[start + i] = block + i as u32;
+            state.stamps[start + i] = state.clock;
+        }
+        state.stats.prefetched += count as u32 - 1;
+        Ok(start)
+    }
+    
+    /// 取得一个块所在的槽位，未命中时从设备读取
+    unsafe fn load(&self, state: &mut CacheState<N>, block: u32) -> Result<usize, D::Error> {
+        state.track(block);
+        if let Some(slot) = state.lookup(block) {
+            state.stats.hits += 1;
+            state.touch(slot);
+            return Ok(slot);
+        }
+        
+        state.stats.misses += 1;
+        let slot = if W > 1 && state.sequential {
+            self.prefetch(state, block)?
+        } else {
+            let slot = self.evict(state)?;
+            self.device.read_blocks(block, core::slice::from_mut(&mut state.blocks[slot]))?;
+            state.tags[slot] = block;
+            slot
+        };
+        state.touch(slot);
+        Ok(slot)
+    }
+    
+    /// 读取块内的一段数据
+    /// 
+    /// # Arguments
+    /// * `block` - 块号
+    /// * `offset` - 块内偏移
+    /// * `out` - 输出缓冲区，超出块末尾的部分不填充
+    /// 
+    /// # Safety
+    /// 访问底层设备
+    pub unsafe fn read_bytes(&self, block: u32, offset: usize, out: &mut [u8]) -> Result<(), D::Error> {
+        let state = self.state();
+        let slot = self.load(state, block)?;
+        let offset = offset.min(BLOCK_SIZE);
+        let len = out.len().min(BLOCK_SIZE - offset);
+        out[..len].copy_from_slice(&state.blocks[slot].0[offset..offset + len]);
+        Ok(())
+    }
+    
+    /// 修改块内的一段数据（只写缓存）
+    /// 
+    /// # Arguments
+    /// * `block` - 块号
+    /// * `offset` - 块内偏移
+    /// * `data` - 写入的数据，超出块末尾的部分被忽略
+    /// 
+    /// # Safety
+    /// 访问底层设备
+    pub unsafe fn write_bytes(&self, block: u32, offset: usize, data: &[u8]) -> Result<(), D::Error> {
+        let offset = offset.min(BLOCK_SIZE);
+        let len = data.len().min(BLOCK_SIZE - offset);
+        if len == BLOCK_SIZE {
+            let mut whole = Block::ZERO;
+            whole.0.copy_from_slice(&data[..BLOCK_SIZE]);
+            return self.write_block(block, &whole);
+        }
+        
+        let state = self.state();
+        let slot = self.load(state, block)?;
+        state.blocks[slot].0[offset..offset + len].copy_from_slice(&data[..len]);
+        state.dirty[slot] = true;
+        Ok(())
+    }
+    
+    /// 覆盖整个块（只写缓存，未命中时不需要先读）
+    /// 
+    /// # Safety
+    /// 访问底层设备
+    pub unsafe fn write_block(&self, block: u32, data: &Block) -> Result<(), D::Error> {
+        let state = self.state();
+        let slot = match state.lookup(block) {
+            Some(slot) => slot,
+            None => {
+                let slot = self.evict(state)?;
+                state.tags[slot] = block;
+                slot
+            }
+        };
+        state.blocks[slot] = *data;
+        state.dirty[slot] = true;
+        state.touch(slot);
+        Ok(())
+    }
+    
+    /// 把全部脏块写回设备
+    /// 
+    /// 按块号从小到大写回，槽位和块号都相邻的脏块合并为一次多块写入
+    /// 
+    /// # Safety
+    /// 访问底层设备
+    pub unsafe fn flush(&self) -> Result<(), D::Error> {
+        let state = self.state();
+        loop {
+            let first = (0..N).filter(|&slot| state.dirty[slot]).min_by_key(|&slot| state.tags[slot]);
+            let first = match first {
+                Some(slot) => slot,
+                None => return Ok(()),
+            };
+            
+            let mut end = first + 1;
+            while end < N && state.dirty[end] && state.tags[end] == state.tags[end - 1].wrapping_add(1) {
+                end += 1;
+            }
+            
+            self.device.write_blocks(state.tags[first], &state.blocks[first..end])?;
+            for slot in first..end {
+                state.dirty[slot] = false;
+            }
+            state.stats.writebacks += (end - first) as u32;
+        }
+    }
+    
+    /// 丢弃全部缓存内容（包括未写回的修改）
+    /// 
+    /// 用于更换存储介质后；需要保留修改时先调用`flush`
+    pub fn invalidate(&self) {
+        let state = unsafe { self.state() };
+        state.tags = [INVALID_TAG; N];
+        state.dirty = [false; N];
+        state.next_block = INVALID_TAG;
+        state.sequential = false;
+    }
+}
+
+impl<D: BlockDevice + 'static, const N: usize, const W: usize> BlockDevice for BlockCache<D, N, W> {
+    type Error = D::Error;
+    
+    fn block_count(&self) -> u32 {
+        self.device.block_count()
+    }
+    
+    /// 经缓存读取连续块
+    unsafe fn read_blocks(&self, start: u32, blocks: &mut [Block]) -> Result<(), D::Error> {
+        let state = self.state();
+        for (i, out) in blocks.iter_mut().enumerate() {
+            let slot = self.load(state, start + i as u32)?;
+            *out = state.blocks[slot];
+        }
+        Ok(())
+    }
+    
+    /// 经缓存写入连续块
+    unsafe fn write_blocks(&self, start: u32, blocks: &[Block]) -> Result<(), D::Error> {
+        for (i, data) in blocks.iter().enumerate() {
+            self.write_block(start + i as u32, data)?;
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,138 @@
+//! C语言OLED驱动绑定
+//! 启用`c-drivers`特性时链接`src/hardware/OLED.c`（及其依赖的标准外设库），提供Rust调用入口
+//! 
+//! 函数体在C静态库中；启用`c-lto`时C代码以LLVM位码参与链接，这些调用可以在链接时被内联。
+//! 
+//! `OLED.c`在`OLED_Init`中使能DMA1通道6中断，处理函数名为CMSIS风格的`DMA1_Channel6_IRQHandler`。
+//! 固件由cortex-m-rt的`link.x`链接，外设中断向量按PAC的名称（`DMA1_Channel6`，见`src/library/device.x`）解析，
+//! C的处理函数不会进入向量表，该中断会落到`DefaultHandler`。因此`init`初始化后关闭该中断，
+//! 由`poll`查询传输完成标志后调用C的中断处理函数；应用用`#[interrupt] fn DMA1_Channel6()`接管时可在其中调用`handle_dma_interrupt`。
+//! 
+//! ```ignore
+//! c_oled::init();
+//! c_oled::clear();
+//! c_oled::draw_rect(0, 0, 8, 64, true);
+//! c_oled::update_async();
+//! while c_oled::poll() {}
+//! ```
+
+#![allow(unused)]
+
+use core::sync::atomic::AtomicU32;
+
+use crate::bsp::dma::{DmaInterrupt, DMA1_CHANNEL6};
+use crate::bsp::misc::MISC;
+
+extern "C" {
+    fn OLED_Init();
+    fn OLED_Clear();
+    fn OLED_UpdateAsync() -> u8;
+    fn OLED_IsUpdating() -> u8;
+    fn OLED_DrawRectangle(x: i16, y: i16, width: i16, height: i16, is_filled: u8);
+    fn OLED_ShowString(x: i16, y: i16, s: *const u8, font_size: u8);
+    fn DMA1_Channel6_IRQHandler();
+}
+
+/// C驱动的传输计时基准（原`Task.c`中的系统时间），只用于`OLED.c`统计DMA传输用时，
+/// 应用可以在定时中断中递增，不递增时不影响显示
+#[no_mangle]
+#[allow(non_upper_case_globals)]
+pub static system_time: AtomicU32 = AtomicU32::new(0);
+
+/// 6x8字体
+pub const FONT_6X8: u8 = 8;
+/// 8x16字体
+pub const FONT_8X16: u8 = 16;
+
+/// 初始化I2C1（PB6/PB7）、DMA和SSD1306控制器
+/// 
+/// # Safety
+/// 占用I2C1和DMA1通道6，不能与`oled::Ssd1306`或`iic::IicEngine`同时使用
+pub unsafe fn init() {
+    OLED_Init();
+    // 向量表中没有C处理函数，改为由`poll`查询
+    MISC.nvic_disable_irq(DMA1_CHANNEL6.interrupt() as u8);
+}
+
+/// 清空绘制缓冲区
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn clear() {
+    OLED_Clear();
+}
+
+/// 绘制矩形（点亮）到绘制缓冲区
+/// 
+/// # Arguments
+/// * `x`, `y` - 左上角坐标
+/// * `width`, `height` - 宽度和高度
+/// * `filled` - 是否填充
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn draw_rect(x: i16, y: i16, width: i16, height: i16, filled: bool) {
+    OLED_DrawRectangle(x, y, width, height, filled as u8);
+}
+
+/// 显示字符串
+/// 
+/// # Arguments
+/// * `s` - 以0结尾的ASCII字符串（如`b"Hello\0"`）
+/// * `font_size` - `FONT_6X8`或`FONT_8X16`
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn show_string(x: i16, y: i16, s: &[u8], font_size: u8) {
+    if s.last() != Some(&0) {
+        return;
+    }
+    OLED_ShowString(x, y, s.as_ptr(), font_size);
+}
+
+/// 启动一帧的DMA传输（只传输脏区），不等待完成
+/// 
+/// # Returns
+/// * `true` - 已开始传输，或没有脏区无需传输
+/// * `false` - 上一帧仍在传输，或启动DMA传输失败（本帧未发送，脏区记录已清除，需要重新绘制）；
+///   C库未启用DMA时同步刷新后也返回`false`
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn update_async() -> bool {
+    OLED_UpdateAsync() != 0
+}
+
+/// 推进传输：DMA完成标志置位时调用C中断处理函数
+/// 
+/// # Returns
+/// 传输仍在进行时返回`true`
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn poll() -> bool {
+    if DMA1_CHANNEL6.check_interrupt(DmaInterrupt::TransferComplete) {
+        DMA1_Channel6_IRQHandler();
+    }
+    OLED_IsUpdating() != 0
+}
+
+/// 阻塞刷新一帧
+/// 
+/// # Safety
+/// 需要先调用`init`
+pub unsafe fn update() {
+    if update_async() {
+        while poll() {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// DMA1通道6中断处理，应用向量表指向此函数时可以不调用`poll`
+/// 
+/// # Safety
+/// 只能在DMA1通道6中断中调用
+pub unsafe fn handle_dma_interrupt() {
+    DMA1_Channel6_IRQHandler();
+}
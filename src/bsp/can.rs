@@ -1,10 +1,131 @@
 ﻿//! CAN模块
 //! 提供控制器局域网功能封装
+//! 
+//! `Can`是bxCAN寄存器级的操作（初始化、过滤器、邮箱和FIFO访问），
+//! `CanBus`在其上实现中断驱动的收发：FIFO0/FIFO1在消息挂起中断中被读空并放入无锁环形缓冲区，
+//! 发送帧先进入按仲裁优先级排序的软件队列，每当有发送邮箱空闲就装入优先级最高的帧。
 
 #![allow(unused)]
 
+use core::cell::UnsafeCell;
+use core::ptr::{read_volatile, write_volatile};
+use core::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
+
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::delay::wait_with_timeout;
+use crate::bsp::gpio::{GpioPortStruct, PA11, PA12, PB8, PB9};
+
+// 过滤器编译在`src/can_filter`库中（不依赖外设，单元测试在主机上运行：`cargo test-can-filter`）
+pub use ::can_filter::{
+    can_id_register, compile_filters, CanFilterBank, CanFilterFifo, CanFilterMode, CanFilterPlan,
+    CanFilterScale, CanIdMatch, FilterError, CAN_EXT_ID_MAX, CAN_FILTER_BANKS, CAN_STD_ID_MAX,
+};
+use ::can_filter::{ID_IDE, ID_RTR};
+
+/// CAN1寄存器基地址
+const CAN1_BASE: u32 = 0x4000_6400;
+
+/// 寄存器偏移
+const CAN_MCR: u32 = 0x000;
+const CAN_MSR: u32 = 0x004;
+const CAN_TSR: u32 = 0x008;
+const CAN_RF0R: u32 = 0x00C;
+const CAN_IER: u32 = 0x014;
+const CAN_ESR: u32 = 0x018;
+const CAN_BTR: u32 = 0x01C;
+/// 发送邮箱0的TIR，每个邮箱占0x10（TIR、TDTR、TDLR、TDHR）
+const CAN_TX_MAILBOX: u32 = 0x180;
+/// 接收FIFO0的RIR，每个FIFO占0x10（RIR、RDTR、RDLR、RDHR）
+const CAN_RX_FIFO: u32 = 0x1B0;
+const CAN_FMR: u32 = 0x200;
+const CAN_FM1R: u32 = 0x204;
+const CAN_FS1R: u32 = 0x20C;
+const CAN_FFA1R: u32 = 0x214;
+const CAN_FA1R: u32 = 0x21C;
+/// 过滤器组0的FR1，每组占8字节（FR1、FR2）
+const CAN_FILTER_BANK: u32 = 0x240;
+
+/// MCR位定义
+const MCR_INRQ: u32 = 1 << 0;
+const MCR_SLEEP: u32 = 1 << 1;
+const MCR_TXFP: u32 = 1 << 2;
+const MCR_RFLM: u32 = 1 << 3;
+const MCR_NART: u32 = 1 << 4;
+const MCR_AWUM: u32 = 1 << 5;
+const MCR_ABOM: u32 = 1 << 6;
+const MCR_TTCM: u32 = 1 << 7;
+
+/// MSR位定义
+const MSR_INAK: u32 = 1 << 0;
+const MSR_SLAK: u32 = 1 << 1;
+const MSR_ERRI: u32 = 1 << 2;
+
+/// TSR位定义（邮箱n的请求完成/发送成功位为`位 << (8 * n)`）
+const TSR_RQCP0: u32 = 1 << 0;
+const TSR_TXOK0: u32 = 1 << 1;
+const TSR_TME0: u32 = 1 << 26;
+const TSR_TME_ALL: u32 = 0x7 << 26;
+
+/// RFxR位定义
+const RF_FMP: u32 = 0x3;
+const RF_FULL: u32 = 1 << 3;
+const RF_FOVR: u32 = 1 << 4;
+const RF_RFOM: u32 = 1 << 5;
+
+/// ESR位定义
+const ESR_EWGF: u32 = 1 << 0;
+const ESR_EPVF: u32 = 1 << 1;
+const ESR_BOFF: u32 = 1 << 2;
+
+/// TIR/RIR位定义
+const TIR_TXRQ: u32 = 1 << 0;
+
+/// FMR位定义
+const FMR_FINIT: u32 = 1 << 0;
+
+/// 进入/退出初始化和睡眠模式的超时时间（微秒）
+const CAN_MODE_TIMEOUT_US: u32 = 10_000;
+
+/// 读取CAN寄存器
+#[inline(always)]
+unsafe fn can_read(offset: u32) -> u32 {
+    read_volatile((CAN1_BASE + offset) as *const u32)
+}
+
+/// 写入CAN寄存器
+#[inline(always)]
+unsafe fn can_write(offset: u32, value: u32) {
+    write_volatile((CAN1_BASE + offset) as *mut u32, value);
+}
+
+/// 修改CAN寄存器
+#[inline(always)]
+unsafe fn can_modify(offset: u32, set: u32, clear: u32) {
+    can_write(offset, (can_read(offset) & !clear) | set);
+}
+
+/// CAN错误枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CanError {
+    InitTimeout,      // 进入或退出初始化模式超时（检查收发器和总线连接）
+    SleepTimeout,     // 进入或退出睡眠模式超时
+    InvalidBitTiming, // 位时序参数超出范围
+    InvalidFrame,     // ID超出范围或数据长度大于8
+    InvalidFilter,    // 过滤器组编号超出范围
+    QueueFull,        // 软件发送队列已满
+    InvalidIdRange,   // 过滤ID超出范围或区间上下限颠倒
+    FilterOverflow,   // ID集合所需的过滤器组超过`CAN_FILTER_BANKS`
+}
+
+impl From<FilterError> for CanError {
+    fn from(error: FilterError) -> Self {
+        match error {
+            FilterError::InvalidIdRange => CanError::InvalidIdRange,
+            FilterError::FilterOverflow => CanError::FilterOverflow,
+        }
+    }
+}
 
 /// CAN模式枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -15,34 +136,82 @@ pub enum CanMode {
     SilentLoopBack = 3,
 }
 
-/// CAN位时序结构体
-#[derive(Debug, Clone, Copy, PartialEq)]
-pub struct CanBitTiming {
-    pub prescaler: u16,      // 预分频系数
-    pub time_segment_1: u8,  // 时间段1
-    pub time_segment_2: u8,  // 时间段2
-    pub sjw: u8,             // 同步跳转宽度
-}
-
-/// CAN过滤器模式枚举
+/// CAN引脚枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
-pub enum CanFilterMode {
-    MaskMode = 0,
-    ListMode = 1,
+pub enum CanPins {
+    PA11PA12, // RX=PA11，TX=PA12（默认，与USB共用）
+    PB8PB9,   // RX=PB8，TX=PB9（重映射）
 }
 
-/// CAN过滤器尺度枚举
+/// CAN位时序结构体
+/// 
+/// 各字段为实际的时间份额数（不是寄存器值减1后的编码），
+/// 位时间 = `prescaler × (1 + time_segment_1 + time_segment_2)`个PCLK1周期
 #[derive(Debug, Clone, Copy, PartialEq)]
-pub enum CanFilterScale {
-    Scale16Bit = 0,
-    Scale32Bit = 1,
+pub struct CanBitTiming {
+    pub prescaler: u16,      // 预分频系数（1~1024）
+    pub time_segment_1: u8,  // 时间段1（1~16）
+    pub time_segment_2: u8,  // 时间段2（1~8）
+    pub sjw: u8,             // 同步跳转宽度（1~4）
 }
 
-/// CAN过滤器FIFO分配枚举
-#[derive(Debug, Clone, Copy, PartialEq)]
-pub enum CanFilterFifo {
-    Fifo0 = 0,
-    Fifo1 = 1,
+impl CanBitTiming {
+    /// 根据PCLK1频率和波特率计算位时序
+    /// 
+    /// 从25个时间份额向下搜索能整除的分频，采样点取87.5%附近（CANopen推荐值）
+    /// 
+    /// # Arguments
+    /// * `pclk1` - APB1时钟频率（Hz）
+    /// * `bitrate` - 波特率（bit/s），如`1_000_000`、`500_000`
+    /// 
+    /// # Returns
+    /// 无法精确得到该波特率时返回`None`
+    pub fn from_bitrate(pclk1: u32, bitrate: u32) -> Option<Self> {
+        if bitrate == 0 {
+            return None;
+        }
+        
+        for quanta in (8..=25u32).rev() {
+            let divisor = bitrate.checked_mul(quanta)?;
+            if pclk1 % divisor != 0 {
+                continue;
+            }
+            let prescaler = pclk1 / divisor;
+            if prescaler == 0 || prescaler > 1024 {
+                continue;
+            }
+            
+            let time_segment_2 = ((quanta + 4) / 8).clamp(1, 8);
+            let time_segment_1 = quanta - 1 - time_segment_2;
+            if time_segment_1 > 16 {
+                continue;
+            }
+            
+            return Some(Self {
+                prescaler: prescaler as u16,
+                time_segment_1: time_segment_1 as u8,
+                time_segment_2: time_segment_2 as u8,
+                sjw: time_segment_2.min(4) as u8,
+            });
+        }
+        None
+    }
+    
+    /// 检查参数范围
+    pub fn is_valid(&self) -> bool {
+        (1..=1024).contains(&self.prescaler)
+            && (1..=16).contains(&self.time_segment_1)
+            && (1..=8).contains(&self.time_segment_2)
+            && (1..=4).contains(&self.sjw)
+    }
+    
+    /// 编码为BTR寄存器值（不含模式位）
+    fn to_btr(&self) -> u32 {
+        (self.prescaler as u32 - 1)
+            | (self.time_segment_1 as u32 - 1) << 16
+            | (self.time_segment_2 as u32 - 1) << 20
+            | (self.sjw as u32 - 1) << 24
+    }
 }
 
 /// CAN消息结构体
@@ -55,6 +224,118 @@ pub struct CanMessage {
     pub data: [u8; 8],     // 数据
 }
 
+impl CanMessage {
+    /// 空消息，用于初始化缓冲区
+    pub const EMPTY: Self = Self {
+        id: 0,
+        is_extended: false,
+        rtr: false,
+        dlc: 0,
+        data: [0; 8],
+    };
+    
+    /// 创建标准数据帧
+    /// 
+    /// # Arguments
+    /// * `id` - 11位标识符
+    /// * `data` - 数据，超过8字节的部分被截断
+    pub fn new_standard(id: u32, data: &[u8]) -> Self {
+        Self::with_data(id, false, data)
+    }
+    
+    /// 创建扩展数据帧
+    /// 
+    /// # Arguments
+    /// * `id` - 29位标识符
+    /// * `data` - 数据，超过8字节的部分被截断
+    pub fn new_extended(id: u32, data: &[u8]) -> Self {
+        Self::with_data(id, true, data)
+    }
+    
+    /// 创建远程帧
+    /// 
+    /// # Arguments
+    /// * `id` - 标识符
+    /// * `is_extended` - 是否为扩展帧
+    /// * `dlc` - 请求的数据长度
+    pub fn new_remote(id: u32, is_extended: bool, dlc: u8) -> Self {
+        Self {
+            id,
+            is_extended,
+            rtr: true,
+            dlc: dlc.min(8),
+            data: [0; 8],
+        }
+    }
+    
+    fn with_data(id: u32, is_extended: bool, data: &[u8]) -> Self {
+        let len = data.len().min(8);
+        let mut message = Self {
+            id,
+            is_extended,
+            rtr: false,
+            dlc: len as u8,
+            data: [0; 8],
+        };
+        message.data[..len].copy_from_slice(&data[..len]);
+        message
+    }
+    
+    /// 有效数据
+    pub fn data(&self) -> &[u8] {
+        &self.data[..self.dlc.min(8) as usize]
+    }
+    
+    /// 检查ID和数据长度是否合法
+    pub fn is_valid(&self) -> bool {
+        let id_max = if self.is_extended { CAN_EXT_ID_MAX } else { CAN_STD_ID_MAX };
+        self.id <= id_max && self.dlc <= 8
+    }
+    
+    /// 仲裁优先级，数值越小优先级越高
+    /// 
+    /// 与总线仲裁顺序一致：先比较11位基本ID，同基本ID时标准帧优先于扩展帧，
+    /// 再比较18位扩展ID，最后数据帧优先于远程帧
+    pub const fn priority_key(&self) -> u32 {
+        let (base, extension) = if self.is_extended {
+            ((self.id >> 18) & CAN_STD_ID_MAX, self.id & 0x3FFFF)
+        } else {
+            (self.id & CAN_STD_ID_MAX, 0)
+        };
+        base << 20 | (self.is_extended as u32) << 19 | extension << 1 | self.rtr as u32
+    }
+    
+    /// 按TIR格式编码标识符
+    pub const fn id_register(&self) -> u32 {
+        can_id_register(self.id, self.is_extended, self.rtr)
+    }
+}
+
+/// CAN错误状态（ESR解码）
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct CanErrorStatus {
+    pub tx_error_count: u8, // 发送错误计数器
+    pub rx_error_count: u8, // 接收错误计数器
+    pub last_error: u8,     // 上次错误代码（0无错误，1填充，2格式，3应答，4隐性位，5显性位，6CRC）
+    pub bus_off: bool,      // 离线
+    pub error_passive: bool, // 错误被动
+    pub error_warning: bool, // 错误警告
+}
+
+impl CanErrorStatus {
+    /// 从ESR寄存器值解码
+    pub fn from_esr(esr: u32) -> Self {
+        Self {
+            tx_error_count: (esr >> 16) as u8,
+            rx_error_count: (esr >> 24) as u8,
+            last_error: ((esr >> 4) & 0x7) as u8,
+            bus_off: esr & ESR_BOFF != 0,
+            error_passive: esr & ESR_EPVF != 0,
+            error_warning: esr & ESR_EWGF != 0,
+        }
+    }
+}
+
 /// CAN结构体
 pub struct Can {
     _marker: core::marker::PhantomData<()>,
@@ -68,101 +349,670 @@ impl Can {
         }
     }
     
-    /// 获取CAN1寄存器块
-    unsafe fn can1() -> &'static mut library::can1::RegisterBlock {
-        &mut *(0x40006400 as *mut library::can1::RegisterBlock)
-    }
-    
     /// 获取RCC寄存器块
     unsafe fn rcc() -> &'static mut library::rcc::RegisterBlock {
         &mut *(0x40021000 as *mut library::rcc::RegisterBlock)
     }
     
+    /// 配置CAN引脚（RX上拉输入，TX复用推挽输出）
+    /// 
+    /// # Arguments
+    /// * `pins` - 引脚组合，`PB8PB9`会同时设置AFIO重映射
+    /// 
+    /// # Safety
+    /// 直接访问GPIO和AFIO寄存器
+    pub unsafe fn init_pins(&self, pins: CanPins) {
+        let (rx, tx, remap): (GpioPortStruct, GpioPortStruct, u32) = match pins {
+            CanPins::PA11PA12 => (PA11, PA12, 0b00),
+            CanPins::PB8PB9 => (PB8, PB9, 0b10),
+        };
+        
+        // AFIO时钟，MAPR.CAN_REMAP位于14~13位
+        let rcc = Can::rcc();
+        rcc.apb2enr().modify(|_, w| w.afioen().set_bit());
+        let mapr = (0x4001_0000 + 0x04) as *mut u32;
+        write_volatile(mapr, (read_volatile(mapr) & !(0x3 << 13)) | remap << 13);
+        
+        tx.into_alternate_push_pull();
+        // 收发器未连接或未上电时保持隐性电平，避免控制器在浮空输入上看到错误帧
+        rx.into_pull_up_input();
+    }
+    
+    /// 等待MSR中指定位变为期望值
+    /// 
+    /// # Returns
+    /// 超时返回`false`
+    unsafe fn wait_msr(mask: u32, set: bool) -> bool {
+        !wait_with_timeout(CAN_MODE_TIMEOUT_US, || {
+            (can_read(CAN_MSR) & mask != 0) == set
+        })
+    }
+    
     /// 初始化CAN
-    pub unsafe fn init(&self, _mode: CanMode, _bit_timing: CanBitTiming) {
+    /// 
+    /// 开启时钟后进入初始化模式，设置位时序和工作模式，再回到正常模式。
+    /// 使能自动离线恢复和自动唤醒，发送邮箱按标识符优先级发送。
+    /// 引脚需另外通过`init_pins`配置。
+    /// 
+    /// # Arguments
+    /// * `mode` - 工作模式
+    /// * `bit_timing` - 位时序
+    /// 
+    /// # Returns
+    /// 正常模式下退出初始化模式需要在总线上检测到11个连续隐性位，
+    /// 收发器未连接或总线被拉死时返回`InitTimeout`
+    /// 
+    /// # Safety
+    /// 直接访问RCC和CAN寄存器
+    pub unsafe fn init(&self, mode: CanMode, bit_timing: CanBitTiming) -> Result<(), CanError> {
+        if !bit_timing.is_valid() {
+            return Err(CanError::InvalidBitTiming);
+        }
+        
         let rcc = Can::rcc();
         
         // 启用CAN时钟
         rcc.apb1enr().modify(|_, w: &mut library::rcc::apb1enr::W| w
             .canen().set_bit()
         );
+        
+        // 退出睡眠，请求进入初始化模式
+        can_modify(CAN_MCR, MCR_INRQ, MCR_SLEEP);
+        if !Self::wait_msr(MSR_INAK, true) {
+            return Err(CanError::InitTimeout);
+        }
+        
+        can_modify(
+            CAN_MCR,
+            MCR_ABOM | MCR_AWUM,
+            MCR_TTCM | MCR_NART | MCR_RFLM | MCR_TXFP,
+        );
+        
+        let mode_bits = match mode {
+            CanMode::Normal => 0,
+            CanMode::LoopBack => 1 << 30,
+            CanMode::Silent => 1 << 31,
+            CanMode::SilentLoopBack => 1 << 30 | 1 << 31,
+        };
+        can_write(CAN_BTR, bit_timing.to_btr() | mode_bits);
+        
+        can_modify(CAN_MCR, 0, MCR_INRQ);
+        if !Self::wait_msr(MSR_INAK, false) {
+            return Err(CanError::InitTimeout);
+        }
+        Ok(())
     }
     
     /// 配置过滤器
+    /// 
+    /// 32位尺度时`filter_id`/`filter_mask`为`can_id_register`格式；
+    /// 16位尺度时每个寄存器的低、高半字各是一个16位过滤器。
+    /// 屏蔽位模式下`filter_mask`中为1的位必须匹配，列表模式下两个寄存器都是标识符。
+    /// 
+    /// # Arguments
+    /// * `filter_number` - 过滤器组编号（0~13）
+    /// * `mode` - 过滤器模式
+    /// * `scale` - 过滤器尺度
+    /// * `fifo` - 匹配的消息存入的FIFO
+    /// * `filter_id` - FR1寄存器值
+    /// * `filter_mask` - FR2寄存器值
+    /// * `activate` - 是否激活该过滤器组
+    /// 
+    /// # Safety
+    /// 直接访问CAN寄存器；配置期间过滤器暂停工作，不会接收新消息
     pub unsafe fn configure_filter(
         &self,
-        _filter_number: u8,
-        _mode: CanFilterMode,
-        _scale: CanFilterScale,
-        _fifo: CanFilterFifo,
-        _filter_id: u32,
-        _filter_mask: u32,
-        _activate: bool,
-    ) {
-        // 由于内部库中CAN寄存器结构不同，暂时为空实现
+        filter_number: u8,
+        mode: CanFilterMode,
+        scale: CanFilterScale,
+        fifo: CanFilterFifo,
+        filter_id: u32,
+        filter_mask: u32,
+        activate: bool,
+    ) -> Result<(), CanError> {
+        if filter_number >= CAN_FILTER_BANKS {
+            return Err(CanError::InvalidFilter);
+        }
+        let bit = 1u32 << filter_number;
+        let select = |yes: bool| if yes { (bit, 0) } else { (0, bit) };
+        
+        can_modify(CAN_FMR, FMR_FINIT, 0);
+        can_modify(CAN_FA1R, 0, bit);
+        
+        let (set, clear) = select(mode == CanFilterMode::ListMode);
+        can_modify(CAN_FM1R, set, clear);
+        let (set, clear) = select(scale == CanFilterScale::Scale32Bit);
+        can_modify(CAN_FS1R, set, clear);
+        let (set, clear) = select(fifo == CanFilterFifo::Fifo1);
+        can_modify(CAN_FFA1R, set, clear);
+        
+        let bank = CAN_FILTER_BANK + 8 * filter_number as u32;
+        can_write(bank, filter_id);
+        can_write(bank + 4, filter_mask);
+        
+        if activate {
+            can_modify(CAN_FA1R, bit, 0);
+        }
+        can_modify(CAN_FMR, 0, FMR_FINIT);
+        Ok(())
+    }
+    
+    /// 配置一个接收全部消息的过滤器
+    /// 
+    /// # Arguments
+    /// * `filter_number` - 过滤器组编号
+    /// * `fifo` - 消息存入的FIFO
+    /// 
+    /// # Safety
+    /// 同`configure_filter`
+    pub unsafe fn accept_all(&self, filter_number: u8, fifo: CanFilterFifo) -> Result<(), CanError> {
+        self.configure_filter(
+            filter_number,
+            CanFilterMode::MaskMode,
+            CanFilterScale::Scale32Bit,
+            fifo,
+            0,
+            0,
+            true,
+        )
+    }
+    
+    /// 停用过滤器组
+    /// 
+    /// # Safety
+    /// 直接访问CAN寄存器
+    pub unsafe fn disable_filter(&self, filter_number: u8) {
+        if filter_number < CAN_FILTER_BANKS {
+            can_modify(CAN_FMR, FMR_FINIT, 0);
+            can_modify(CAN_FA1R, 0, 1 << filter_number);
+            can_modify(CAN_FMR, 0, FMR_FINIT);
+        }
+    }
+    
+    /// 写入`compile_filters`的编译结果，从第0组开始依次配置，其余过滤器组停用
+    /// 
+    /// # Safety
+    /// 同`configure_filter`
+    pub unsafe fn apply_filter_plan(&self, plan: &CanFilterPlan) -> Result<(), CanError> {
+        let banks = plan.banks();
+        for (index, bank) in banks.iter().enumerate() {
+            self.configure_filter(index as u8, bank.mode, bank.scale, bank.fifo, bank.fr1, bank.fr2, true)?;
+        }
+        for index in banks.len() as u8..CAN_FILTER_BANKS {
+            self.disable_filter(index);
+        }
+        Ok(())
+    }
+    
+    /// 把消息写入发送邮箱并请求发送
+    unsafe fn write_mailbox(mailbox: u32, message: &CanMessage) {
+        let base = CAN_TX_MAILBOX + 0x10 * mailbox;
+        let data = &message.data;
+        can_write(base + 0x04, message.dlc as u32 & 0xF);
+        can_write(base + 0x08, u32::from_le_bytes([data[0], data[1], data[2], data[3]]));
+        can_write(base + 0x0C, u32::from_le_bytes([data[4], data[5], data[6], data[7]]));
+        can_write(base, message.id_register() | TIR_TXRQ);
+    }
+    
+    /// 从FIFO读出一条消息并释放该FIFO输出邮箱
+    unsafe fn read_fifo(fifo: u32) -> CanMessage {
+        let base = CAN_RX_FIFO + 0x10 * fifo;
+        let rir = can_read(base);
+        let rdtr = can_read(base + 0x04);
+        let low = can_read(base + 0x08).to_le_bytes();
+        let high = can_read(base + 0x0C).to_le_bytes();
+        can_write(CAN_RF0R + 4 * fifo, RF_RFOM);
+        
+        let is_extended = rir & ID_IDE != 0;
+        CanMessage {
+            id: if is_extended { rir >> 3 } else { rir >> 21 },
+            is_extended,
+            rtr: rir & ID_RTR != 0,
+            // DLC为9~15时帧中仍只有8字节
+            dlc: ((rdtr & 0xF) as u8).min(8),
+            data: [low[0], low[1], low[2], low[3], high[0], high[1], high[2], high[3]],
+        }
     }
     
     /// 发送消息
-    pub unsafe fn send_message(&self, _message: &CanMessage) -> bool {
-        // 由于内部库中CAN寄存器结构不同，暂时返回固定值
-        false
+    /// 
+    /// 直接写入一个空闲的发送邮箱，不经过软件队列
+    /// 
+    /// # Returns
+    /// 没有空闲邮箱或消息不合法时返回`false`
+    /// 
+    /// # Safety
+    /// 直接访问CAN寄存器；不得与`CanBus`同时使用
+    pub unsafe fn send_message(&self, message: &CanMessage) -> bool {
+        if !message.is_valid() {
+            return false;
+        }
+        let tsr = can_read(CAN_TSR);
+        if tsr & TSR_TME_ALL == 0 {
+            return false;
+        }
+        Self::write_mailbox((tsr >> 24) & 0x3, message);
+        true
+    }
+    
+    /// 检查是否所有发送邮箱都为空
+    pub unsafe fn is_tx_idle(&self) -> bool {
+        can_read(CAN_TSR) & TSR_TME_ALL == TSR_TME_ALL
     }
     
     /// 接收消息（FIFO 0）
     pub unsafe fn receive_message_fifo0(&self) -> Option<CanMessage> {
-        // 由于内部库中CAN寄存器结构不同，暂时返回固定值
-        None
+        if can_read(CAN_RF0R) & RF_FMP == 0 {
+            return None;
+        }
+        Some(Self::read_fifo(0))
     }
     
     /// 接收消息（FIFO 1）
     pub unsafe fn receive_message_fifo1(&self) -> Option<CanMessage> {
-        // 由于内部库中CAN寄存器结构不同，暂时返回固定值
-        None
+        if can_read(CAN_RF0R + 4) & RF_FMP == 0 {
+            return None;
+        }
+        Some(Self::read_fifo(1))
     }
     
     /// 启用中断
-    pub unsafe fn enable_interrupt(&self, _interrupt_mask: u32) {
-        // 由于内部库中CAN寄存器结构不同，暂时为空实现
+    /// 
+    /// # Arguments
+    /// * `interrupt_mask` - `CAN_IT_*`的组合
+    pub unsafe fn enable_interrupt(&self, interrupt_mask: u32) {
+        can_modify(CAN_IER, interrupt_mask, 0);
     }
     
     /// 禁用中断
-    pub unsafe fn disable_interrupt(&self, _interrupt_mask: u32) {
-        // 由于内部库中CAN寄存器结构不同，暂时为空实现
+    /// 
+    /// # Arguments
+    /// * `interrupt_mask` - `CAN_IT_*`的组合
+    pub unsafe fn disable_interrupt(&self, interrupt_mask: u32) {
+        can_modify(CAN_IER, 0, interrupt_mask);
     }
     
     /// 检查错误状态
+    /// 
+    /// # Returns
+    /// ESR寄存器原始值，可用`CanErrorStatus::from_esr`解码
     pub unsafe fn check_error_status(&self) -> u32 {
-        // 由于内部库中CAN寄存器结构不同，暂时返回固定值
-        0
+        can_read(CAN_ESR)
+    }
+    
+    /// 获取解码后的错误状态
+    pub unsafe fn error_status(&self) -> CanErrorStatus {
+        CanErrorStatus::from_esr(can_read(CAN_ESR))
     }
     
     /// 进入睡眠模式
-    pub unsafe fn enter_sleep_mode(&self) {
-        // 由于内部库中CAN寄存器结构不同，暂时为空实现
+    /// 
+    /// # Returns
+    /// 当前帧发送/接收完成后才会进入睡眠，超时返回`SleepTimeout`
+    pub unsafe fn enter_sleep_mode(&self) -> Result<(), CanError> {
+        can_modify(CAN_MCR, MCR_SLEEP, MCR_INRQ);
+        if !Self::wait_msr(MSR_SLAK, true) {
+            return Err(CanError::SleepTimeout);
+        }
+        Ok(())
     }
     
     /// 唤醒
-    pub unsafe fn wakeup(&self) {
-        // 由于内部库中CAN寄存器结构不同，暂时为空实现
+    /// 
+    /// # Returns
+    /// 需要在总线上检测到11个连续隐性位，超时返回`SleepTimeout`
+    pub unsafe fn wakeup(&self) -> Result<(), CanError> {
+        can_modify(CAN_MCR, 0, MCR_SLEEP);
+        if !Self::wait_msr(MSR_SLAK, false) {
+            return Err(CanError::SleepTimeout);
+        }
+        Ok(())
     }
 }
 
-/// CAN中断掩码常量
+/// CAN中断掩码常量（IER寄存器位）
 pub const CAN_IT_TME: u32 = 1 << 0;    // 发送邮箱空中断
 pub const CAN_IT_FMP0: u32 = 1 << 1;   // FIFO 0 消息挂起中断
-pub const CAN_IT_FMP1: u32 = 1 << 2;   // FIFO 1 消息挂起中断
-pub const CAN_IT_FF0: u32 = 1 << 3;    // FIFO 0 满中断
-pub const CAN_IT_FF1: u32 = 1 << 4;    // FIFO 1 满中断
-pub const CAN_IT_FOV0: u32 = 1 << 5;   // FIFO 0 溢出中断
+pub const CAN_IT_FF0: u32 = 1 << 2;    // FIFO 0 满中断
+pub const CAN_IT_FOV0: u32 = 1 << 3;   // FIFO 0 溢出中断
+pub const CAN_IT_FMP1: u32 = 1 << 4;   // FIFO 1 消息挂起中断
+pub const CAN_IT_FF1: u32 = 1 << 5;    // FIFO 1 满中断
 pub const CAN_IT_FOV1: u32 = 1 << 6;   // FIFO 1 溢出中断
-pub const CAN_IT_WKU: u32 = 1 << 7;    // 唤醒中断
-pub const CAN_IT_SLK: u32 = 1 << 8;    // 睡眠中断
-pub const CAN_IT_ERR: u32 = 1 << 9;    // 错误中断
-pub const CAN_IT_LEC: u32 = 1 << 10;   // 最后错误代码中断
-pub const CAN_IT_BOF: u32 = 1 << 11;   // 总线离线中断
-pub const CAN_IT_EPV: u32 = 1 << 12;   // 错误被动中断
-pub const CAN_IT_EWG: u32 = 1 << 13;   // 错误警告中断
-pub const CAN_IT_ERRIE: u32 = 1 << 15; // 错误中断使能
+pub const CAN_IT_EWG: u32 = 1 << 8;    // 错误警告中断
+pub const CAN_IT_EPV: u32 = 1 << 9;    // 错误被动中断
+pub const CAN_IT_BOF: u32 = 1 << 10;   // 总线离线中断
+pub const CAN_IT_LEC: u32 = 1 << 11;   // 最后错误代码中断
+pub const CAN_IT_ERR: u32 = 1 << 15;   // 错误中断（EWG/EPV/BOF/LEC的总开关）
+pub const CAN_IT_ERRIE: u32 = CAN_IT_ERR; // 错误中断使能
+pub const CAN_IT_WKU: u32 = 1 << 16;   // 唤醒中断
+pub const CAN_IT_SLK: u32 = 1 << 17;   // 睡眠中断
 
 /// 预定义的CAN实例
 pub const CAN: Can = Can::new();
+
+/// CAN接收环形缓冲区
+/// 
+/// 单生产者（FIFO中断）单消费者（主循环）的无锁队列，缓冲区满时新消息被丢弃并计数。
+/// 容量`N`必须是2的幂。
+pub struct CanRxRing<const N: usize> {
+    buffer: UnsafeCell<[CanMessage; N]>,
+    /// 写入位置（累计消息数）
+    head: AtomicUsize,
+    /// 读取位置（累计消息数）
+    tail: AtomicUsize,
+    /// 因缓冲区满而丢弃的消息数
+    overruns: AtomicU32,
+}
+
+/// 实现 Sync trait，写入只在中断中进行，读取只在一个上下文中进行
+unsafe impl<const N: usize> Sync for CanRxRing<N> {}
+
+impl<const N: usize> CanRxRing<N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N.is_power_of_two(), "CanRxRing大小必须是2的幂");
+    
+    /// 创建新的接收环形缓冲区
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            buffer: UnsafeCell::new([CanMessage::EMPTY; N]),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+            overruns: AtomicU32::new(0),
+        }
+    }
+    
+    /// 获取缓冲区中的消息数
+    pub fn len(&self) -> usize {
+        self.head.load(Ordering::Acquire).wrapping_sub(self.tail.load(Ordering::Acquire))
+    }
+    
+    /// 检查缓冲区是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+    
+    /// 获取因缓冲区满而丢弃的消息数
+    pub fn overruns(&self) -> u32 {
+        self.overruns.load(Ordering::Relaxed)
+    }
+    
+    /// 写入一条消息（仅限生产者调用）
+    /// 
+    /// # Returns
+    /// 缓冲区满时返回`false`
+    fn push(&self, message: CanMessage) -> bool {
+        let head = self.head.load(Ordering::Relaxed);
+        if head.wrapping_sub(self.tail.load(Ordering::Acquire)) >= N {
+            self.overruns.fetch_add(1, Ordering::Relaxed);
+            return false;
+        }
+        unsafe {
+            (*self.buffer.get())[head & (N - 1)] = message;
+        }
+        self.head.store(head.wrapping_add(1), Ordering::Release);
+        true
+    }
+    
+    /// 取出最早的一条消息（仅限消费者调用）
+    pub fn pop(&self) -> Option<CanMessage> {
+        let tail = self.tail.load(Ordering::Relaxed);
+        if self.head.load(Ordering::Acquire) == tail {
+            return None;
+        }
+        let message = unsafe { (*self.buffer.get())[tail & (N - 1)] };
+        self.tail.store(tail.wrapping_add(1), Ordering::Release);
+        Some(message)
+    }
+}
+
+/// 中断驱动的CAN收发（CAN1）
+/// 
+/// - 接收：FIFO0/FIFO1的消息挂起中断把硬件FIFO（各3级）读空，放入各自的`CanRxRing`，
+///   主循环用`receive`取出，1Mbit/s满负载时也不会因轮询不及时而丢帧
+/// - 发送：`transmit`把帧按仲裁优先级插入软件队列（同优先级先入先出），每当有发送邮箱空闲
+///   就装入队列中优先级最高的帧，三个邮箱同时参与仲裁
+/// - 过滤：用`CAN.configure_filter`配置硬件过滤器组，不需要的ID在硬件中丢弃
+/// 
+/// `RX`为每个接收缓冲区的容量（2的幂），`TX`为软件发送队列深度。
+/// 
+/// 使用时需要：
+/// - 用`init`初始化CAN1并配置至少一个过滤器组（没有激活的过滤器时不接收任何消息）
+/// - 在`USB_LP_CAN_RX0`、`CAN_RX1`、`USB_HP_CAN_TX`、`CAN_SCE`中断中分别调用
+///   `handle_rx0_interrupt`、`handle_rx1_interrupt`、`handle_tx_interrupt`、`handle_sce_interrupt`
+/// - 在NVIC中使能以上四个中断（CAN与USB共用中断和SRAM，不能同时使用）
+/// 
+/// ```ignore
+/// static CAN_BUS: CanBus<32, 16> = CanBus::new();
+/// 
+/// let timing = CanBitTiming::from_bitrate(36_000_000, 1_000_000).unwrap();
+/// CAN_BUS.init(CanMode::Normal, timing, CanPins::PA11PA12)?;
+/// CAN.accept_all(0, CanFilterFifo::Fifo0)?;
+/// CAN_BUS.transmit(&CanMessage::new_standard(0x123, &[1, 2, 3]))?;
+/// while let Some(message) = CAN_BUS.receive(CanFilterFifo::Fifo0) {
+///     // ...
+/// }
+/// ```
+pub struct CanBus<const RX: usize, const TX: usize> {
+    rx0: CanRxRing<RX>,
+    rx1: CanRxRing<RX>,
+    /// 按优先级降序排列的发送队列，末尾为优先级最高的帧
+    tx_queue: UnsafeCell<[CanMessage; TX]>,
+    tx_len: AtomicUsize,
+    /// 发送失败（仲裁丢失后未重发成功或发送错误）的帧数
+    tx_errors: AtomicU32,
+    /// 因发送队列满而被拒绝的帧数
+    tx_rejected: AtomicU32,
+    /// 硬件FIFO溢出次数（中断响应不及时）
+    fifo_overruns: AtomicU32,
+    /// 进入离线状态的次数
+    bus_off_events: AtomicU32,
+}
+
+/// 实现 Sync trait，发送队列只在临界区内修改，接收缓冲区为单生产者单消费者
+unsafe impl<const RX: usize, const TX: usize> Sync for CanBus<RX, TX> {}
+
+impl<const RX: usize, const TX: usize> CanBus<RX, TX> {
+    /// 编译期检查发送队列深度
+    const SIZE_CHECK: () = assert!(TX > 0, "CanBus发送队列深度不能为0");
+    
+    /// 创建新的CAN收发实例
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            rx0: CanRxRing::new(),
+            rx1: CanRxRing::new(),
+            tx_queue: UnsafeCell::new([CanMessage::EMPTY; TX]),
+            tx_len: AtomicUsize::new(0),
+            tx_errors: AtomicU32::new(0),
+            tx_rejected: AtomicU32::new(0),
+            fifo_overruns: AtomicU32::new(0),
+            bus_off_events: AtomicU32::new(0),
+        }
+    }
+    
+    /// 初始化CAN1并使能收发和错误中断
+    /// 
+    /// # Arguments
+    /// * `mode` - 工作模式
+    /// * `bit_timing` - 位时序
+    /// * `pins` - 引脚组合
+    /// 
+    /// # Safety
+    /// 直接访问RCC、GPIO和CAN寄存器
+    pub unsafe fn init(&self, mode: CanMode, bit_timing: CanBitTiming, pins: CanPins) -> Result<(), CanError> {
+        CAN.init_pins(pins);
+        CAN.init(mode, bit_timing)?;
+        CAN.enable_interrupt(
+            CAN_IT_TME | CAN_IT_FMP0 | CAN_IT_FOV0 | CAN_IT_FMP1 | CAN_IT_FOV1
+                | CAN_IT_ERR | CAN_IT_BOF | CAN_IT_EPV,
+        );
+        Ok(())
+    }
+    
+    /// 获取接收缓冲区
+    pub fn rx_ring(&self, fifo: CanFilterFifo) -> &CanRxRing<RX> {
+        match fifo {
+            CanFilterFifo::Fifo0 => &self.rx0,
+            CanFilterFifo::Fifo1 => &self.rx1,
+        }
+    }
+    
+    /// 取出一条接收到的消息
+    /// 
+    /// # Arguments
+    /// * `fifo` - 从哪个FIFO的缓冲区读取
+    pub fn receive(&self, fifo: CanFilterFifo) -> Option<CanMessage> {
+        self.rx_ring(fifo).pop()
+    }
+    
+    /// 发送队列中等待装入邮箱的帧数
+    pub fn tx_pending(&self) -> usize {
+        self.tx_len.load(Ordering::Acquire)
+    }
+    
+    /// 获取发送失败的帧数
+    pub fn tx_errors(&self) -> u32 {
+        self.tx_errors.load(Ordering::Relaxed)
+    }
+    
+    /// 获取因发送队列满而被拒绝的帧数
+    pub fn tx_rejected(&self) -> u32 {
+        self.tx_rejected.load(Ordering::Relaxed)
+    }
+    
+    /// 获取硬件FIFO溢出次数
+    pub fn fifo_overruns(&self) -> u32 {
+        self.fifo_overruns.load(Ordering::Relaxed)
+    }
+    
+    /// 获取进入离线状态的次数
+    pub fn bus_off_events(&self) -> u32 {
+        self.bus_off_events.load(Ordering::Relaxed)
+    }
+    
+    /// 提交一帧发送
+    /// 
+    /// 有空闲邮箱时立即装入，否则按优先级排队，由发送邮箱空中断继续装入
+    /// 
+    /// # Arguments
+    /// * `message` - 要发送的消息
+    /// 
+    /// # Returns
+    /// 消息不合法返回`InvalidFrame`，队列满返回`QueueFull`
+    pub fn transmit(&self, message: &CanMessage) -> Result<(), CanError> {
+        if !message.is_valid() {
+            return Err(CanError::InvalidFrame);
+        }
+        
+        cortex_m::interrupt::free(|_| unsafe {
+            let len = self.tx_len.load(Ordering::Relaxed);
+            if len >= TX {
+                self.tx_rejected.fetch_add(1, Ordering::Relaxed);
+                return Err(CanError::QueueFull);
+            }
+            
+            // 降序插入：相同优先级的旧帧更靠近末尾，先被取出
+            let queue = &mut *self.tx_queue.get();
+            let key = message.priority_key();
+            let mut pos = len;
+            while pos > 0 && queue[pos - 1].priority_key() <= key {
+                queue[pos] = queue[pos - 1];
+                pos -= 1;
+            }
+            queue[pos] = *message;
+            self.tx_len.store(len + 1, Ordering::Release);
+            
+            self.fill_mailboxes();
+            Ok(())
+        })
+    }
+    
+    /// 把队列中优先级最高的帧装入空闲邮箱（在临界区内调用）
+    unsafe fn fill_mailboxes(&self) {
+        let queue = &*self.tx_queue.get();
+        let mut len = self.tx_len.load(Ordering::Relaxed);
+        
+        while len > 0 {
+            let tsr = can_read(CAN_TSR);
+            if tsr & TSR_TME_ALL == 0 {
+                break;
+            }
+            
+            // 相同ID的帧同时在多个邮箱中时硬件按邮箱号发送，可能打乱顺序，等前一帧发出再装入
+            let next = &queue[len - 1];
+            let id_word = next.id_register();
+            let same_id_pending = (0..3).any(|mailbox| {
+                tsr & (TSR_TME0 << mailbox) == 0
+                    && can_read(CAN_TX_MAILBOX + 0x10 * mailbox) & !TIR_TXRQ == id_word
+            });
+            if same_id_pending {
+                break;
+            }
+            
+            Can::write_mailbox((tsr >> 24) & 0x3, next);
+            len -= 1;
+        }
+        
+        self.tx_len.store(len, Ordering::Release);
+    }
+    
+    /// 读空一个硬件FIFO
+    unsafe fn drain_fifo(&self, fifo: u32, ring: &CanRxRing<RX>) {
+        let rfr = CAN_RF0R + 4 * fifo;
+        loop {
+            let status = can_read(rfr);
+            if status & RF_FOVR != 0 {
+                self.fifo_overruns.fetch_add(1, Ordering::Relaxed);
+            }
+            if status & (RF_FOVR | RF_FULL) != 0 {
+                can_write(rfr, status & (RF_FOVR | RF_FULL));
+            }
+            if status & RF_FMP == 0 {
+                break;
+            }
+            ring.push(Can::read_fifo(fifo));
+        }
+    }
+    
+    /// FIFO0中断处理，在`USB_LP_CAN_RX0`中断中调用
+    pub unsafe fn handle_rx0_interrupt(&self) {
+        self.drain_fifo(0, &self.rx0);
+    }
+    
+    /// FIFO1中断处理，在`CAN_RX1`中断中调用
+    pub unsafe fn handle_rx1_interrupt(&self) {
+        self.drain_fifo(1, &self.rx1);
+    }
+    
+    /// 发送邮箱空中断处理，在`USB_HP_CAN_TX`中断中调用
+    pub unsafe fn handle_tx_interrupt(&self) {
+        let tsr = can_read(CAN_TSR);
+        let mut clear = 0;
+        for mailbox in 0..3 {
+            let shift = 8 * mailbox;
+            if tsr & (TSR_RQCP0 << shift) != 0 {
+                if tsr & (TSR_TXOK0 << shift) == 0 {
+                    self.tx_errors.fetch_add(1, Ordering::Relaxed);
+                }
+                clear |= TSR_RQCP0 << shift;
+            }
+        }
+        // 写1清除RQCP，同时清除TXOK、ALST和TERR
+        if clear != 0 {
+            can_write(CAN_TSR, clear);
+        }
+        
+        cortex_m::interrupt::free(|_| self.fill_mailboxes());
+    }
+    
+    /// 状态改变/错误中断处理，在`CAN_SCE`中断中调用
+    /// 
+    /// 离线后由硬件自动恢复（MCR.ABOM），这里只负责计数和清除中断标志
+    pub unsafe fn handle_sce_interrupt(&self) {
+        if can_read(CAN_ESR) & ESR_BOFF != 0 {
+            self.bus_off_events.fetch_add(1, Ordering::Relaxed);
+        }
+        can_write(CAN_MSR, MSR_ERRI);
+    }
+}
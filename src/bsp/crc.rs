@@ -5,6 +5,20 @@
 
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransfer, DmaTransferDescriptor,
+    DmaPeripheralDataSize, DmaMemoryDataSize,
+    DmaPeripheralIncrementMode, DmaMemoryIncrementMode,
+};
+
+/// CRC数据寄存器地址（DMA目的地址）
+pub const CRC_DR_ADDRESS: u32 = 0x4002_3000;
+
+/// 单次DMA传输的最大字数（CNDTR为16位）
+pub const CRC_DMA_MAX_WORDS: usize = 0xFFFF;
+
+/// 标准CRC-32（反射）多项式，用于软件处理不足一个字的尾部字节
+const CRC32_POLY_REFLECTED: u32 = 0xEDB8_8320;
 
 /// CRC结构体
 pub struct Crc;
@@ -70,23 +84,116 @@ impl Crc {
         crc.dr().read().dr().bits()
     }
     
-    /// 计算数据块的CRC
+    /// 计算数据块的标准CRC-32（与zlib/以太网一致）
+    /// 
+    /// 按32位字写入硬件，不足一个字的尾部字节由软件完成，
+    /// 比逐字节写DR快约4倍，且结果可以直接与PC端工具比较。
+    /// 
+    /// # Arguments
+    /// * `data` - 待校验的数据，可以任意对齐、任意长度
+    /// 
+    /// # Returns
+    /// 标准CRC-32值
     pub unsafe fn calculate_block(&self, data: &[u8]) -> u32 {
-        // 重置CRC计算单元
+        let mut stream = self.stream();
+        stream.update(data);
+        stream.finalize()
+    }
+    
+    /// 开始一次流式CRC-32计算
+    /// 
+    /// 复位硬件后返回流对象，数据可以分多次通过`update`送入。
+    /// 
+    /// # Safety
+    /// CRC单元只有一个，流对象存活期间不得再调用本模块的其他计算函数
+    pub unsafe fn stream(&self) -> Crc32Stream {
+        self.reset();
+        Crc32Stream {
+            pending: [0; 4],
+            pending_len: 0,
+        }
+    }
+    
+    /// 计算32位字数组的硬件原生CRC（CRC-32/MPEG-2，不做位反转）
+    /// 
+    /// # Arguments
+    /// * `words` - 待校验的字数组
+    /// 
+    /// # Returns
+    /// 硬件DR寄存器中的CRC值
+    pub unsafe fn calculate_words(&self, words: &[u32]) -> u32 {
         self.reset();
         
         let crc = Crc::crc();
-        
-        // 处理每个字节
-        for &byte in data {
+        for &word in words {
             crc.dr().write(|w: &mut library::crc::dr::W| w
-                .dr().bits(byte as u32)
+                .dr().bits(word)
             );
         }
         
         crc.dr().read().dr().bits()
     }
     
+    /// 使用DMA存储器到存储器模式把字数组送入CRC单元
+    /// 
+    /// 复位CRC后启动传输，源地址递增、目的地址固定为DR，字宽度。
+    /// 传输期间CPU可以做其他事情，完成后通过`get_crc`读取结果。
+    /// 结果为硬件原生CRC（与`calculate_words`一致），DMA无法做位反转，
+    /// 因此不等于`calculate_block`的标准CRC-32。
+    /// 
+    /// # Arguments
+    /// * `dma` - 空闲的DMA通道（存储器到存储器模式不需要外设请求，任意通道均可）
+    /// * `words` - 待校验的字数组，最多`CRC_DMA_MAX_WORDS`个字
+    /// 
+    /// # Returns
+    /// 成功返回传输句柄，长度为0或超过上限返回`DmaError::InvalidLength`
+    /// 
+    /// # Safety
+    /// - `words`在传输结束前必须保持有效且不被修改
+    /// - 传输结束前不得使用CRC单元
+    pub unsafe fn start_dma(&self, dma: Dma, words: &[u32]) -> Result<DmaTransfer, DmaError> {
+        if words.is_empty() || words.len() > CRC_DMA_MAX_WORDS {
+            return Err(DmaError::InvalidLength);
+        }
+        
+        self.reset();
+        self.start_dma_chunk(dma, words)
+    }
+    
+    /// 使用DMA计算字数组的硬件原生CRC，并阻塞等待完成
+    /// 
+    /// 超过`CRC_DMA_MAX_WORDS`的数组会被拆分为多次传输，CRC在各段之间连续累加，
+    /// 适合校验64KB量级的固件镜像。
+    /// 
+    /// # Arguments
+    /// * `dma` - 空闲的DMA通道
+    /// * `words` - 待校验的字数组
+    /// 
+    /// # Returns
+    /// 成功返回硬件原生CRC值，失败返回DMA错误
+    pub unsafe fn calculate_words_dma(&self, dma: Dma, words: &[u32]) -> Result<u32, DmaError> {
+        self.reset();
+        
+        for chunk in words.chunks(CRC_DMA_MAX_WORDS) {
+            self.start_dma_chunk(dma, chunk)?.wait()?;
+        }
+        
+        Ok(self.get_crc())
+    }
+    
+    /// 启动一段DMA传输（不复位CRC）
+    unsafe fn start_dma_chunk(&self, dma: Dma, words: &[u32]) -> Result<DmaTransfer, DmaError> {
+        let desc = DmaTransferDescriptor::memory_to_memory(
+            words.as_ptr() as u32,
+            CRC_DR_ADDRESS,
+            words.len() as u16,
+        )
+        .with_data_size(DmaPeripheralDataSize::Word, DmaMemoryDataSize::Word)
+        .with_increment(DmaPeripheralIncrementMode::Enabled, DmaMemoryIncrementMode::Disabled);
+        
+        dma.start(&desc)
+    }
+    
     /// 获取当前CRC值
     pub unsafe fn get_crc(&self) -> u32 {
         let crc = Crc::crc();
@@ -108,5 +215,86 @@ impl Crc {
     }
 }
 
+/// 流式CRC-32计算
+/// 
+/// 由`Crc::stream`创建。跨调用缓存不足一个字的字节，保证任意切分方式
+/// 得到的结果与一次性计算相同。
+pub struct Crc32Stream {
+    /// 尚未凑满一个字的字节
+    pending: [u8; 4],
+    /// `pending`中的有效字节数
+    pending_len: usize,
+}
+
+impl Crc32Stream {
+    /// 写入一个小端字（按标准CRC-32的要求做位反转）
+    #[inline(always)]
+    unsafe fn write_word(word: u32) {
+        let crc = Crc::crc();
+        crc.dr().write(|w: &mut library::crc::dr::W| w
+            .dr().bits(word.reverse_bits())
+        );
+    }
+    
+    /// 送入一段数据
+    /// 
+    /// # Arguments
+    /// * `data` - 任意长度、任意对齐的数据
+    pub unsafe fn update(&mut self, mut data: &[u8]) {
+        // 先补齐上次剩余的字节
+        if self.pending_len > 0 {
+            let take = (4 - self.pending_len).min(data.len());
+            self.pending[self.pending_len..self.pending_len + take].copy_from_slice(&data[..take]);
+            self.pending_len += take;
+            data = &data[take..];
+            
+            if self.pending_len < 4 {
+                return;
+            }
+            Self::write_word(u32::from_le_bytes(self.pending));
+            self.pending_len = 0;
+        }
+        
+        // 数据地址按字对齐时直接按u32读取
+        let (head, body, _) = data.align_to::<u32>();
+        if head.is_empty() {
+            for &word in body {
+                Self::write_word(u32::from_le(word));
+            }
+            data = &data[body.len() * 4..];
+        }
+        
+        // 未对齐的数据逐字拼装
+        let mut chunks = data.chunks_exact(4);
+        for chunk in &mut chunks {
+            Self::write_word(u32::from_le_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]));
+        }
+        
+        let rest = chunks.remainder();
+        self.pending[..rest.len()].copy_from_slice(rest);
+        self.pending_len = rest.len();
+    }
+    
+    /// 结束计算并返回标准CRC-32
+    /// 
+    /// 硬件结果位反转后即为反射CRC的中间状态，剩余不足一个字的字节用软件继续计算。
+    /// 
+    /// # Returns
+    /// 标准CRC-32值
+    pub unsafe fn finalize(self) -> u32 {
+        let crc = Crc::crc();
+        let mut state = crc.dr().read().dr().bits().reverse_bits();
+        
+        for &byte in &self.pending[..self.pending_len] {
+            state ^= byte as u32;
+            for _ in 0..8 {
+                state = (state >> 1) ^ (CRC32_POLY_REFLECTED & (state & 1).wrapping_neg());
+            }
+        }
+        
+        !state
+    }
+}
+
 /// 预定义的CRC实例
 pub const CRC: Crc = Crc::new();
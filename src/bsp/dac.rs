@@ -5,6 +5,11 @@
 
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransferDescriptor, DmaChannelPriority,
+    DmaPeripheralDataSize, DmaMemoryDataSize, DmaDoubleBuffer, DmaHalf, DMA2_CHANNEL3, DMA2_CHANNEL4,
+};
+use crate::bsp::timer::{Timer, TimerNumber, TimerMasterMode};
 
 /// DAC通道枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -13,18 +18,48 @@ pub enum DacChannel {
     Channel2 = 1,
 }
 
-/// DAC触发源枚举
+/// DAC触发源枚举（CR.TSELx编码）
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum DacTriggerSource {
-    Software = 0,
-    Timer2TRGO = 1,
-    Timer4TRGO = 2,
+    Timer6TRGO = 0,
+    Timer8TRGO = 1,
+    Timer7TRGO = 2,
     Timer5TRGO = 3,
-    Timer6TRGO = 4,
-    Timer7TRGO = 5,
+    Timer2TRGO = 4,
+    Timer4TRGO = 5,
     Exti9 = 6,
+    Software = 7,
 }
 
+impl DacChannel {
+    /// 获取通道对应的DMA通道（DAC通道1为DMA2通道3，通道2为DMA2通道4）
+    pub const fn dma(&self) -> Dma {
+        match self {
+            DacChannel::Channel1 => DMA2_CHANNEL3,
+            DacChannel::Channel2 => DMA2_CHANNEL4,
+        }
+    }
+    
+    /// 获取12位右对齐数据保持寄存器地址（DMA目的地址）
+    pub const fn dhr12r_address(&self) -> u32 {
+        match self {
+            DacChannel::Channel1 => 0x4000_7408,
+            DacChannel::Channel2 => 0x4000_7414,
+        }
+    }
+    
+    /// 获取CR寄存器中该通道字段的偏移
+    const fn cr_shift(&self) -> u32 {
+        match self {
+            DacChannel::Channel1 => 0,
+            DacChannel::Channel2 => 16,
+        }
+    }
+}
+
+/// CR寄存器DMA使能位（通道1，通道2需左移16位）
+const DAC_CR_DMAEN: u32 = 1 << 12;
+
 /// DAC结构体
 pub struct Dac;
 
@@ -180,6 +215,18 @@ impl Dac {
         }
     }
     
+    /// 启用DAC通道DMA请求
+    pub unsafe fn enable_dma(&self, channel: DacChannel) {
+        let dac = Dac::dac();
+        dac.cr().modify(|r, w| w.bits(r.bits() | (DAC_CR_DMAEN << channel.cr_shift())));
+    }
+    
+    /// 禁用DAC通道DMA请求
+    pub unsafe fn disable_dma(&self, channel: DacChannel) {
+        let dac = Dac::dac();
+        dac.cr().modify(|r, w| w.bits(r.bits() & !(DAC_CR_DMAEN << channel.cr_shift())));
+    }
+    
     /// 软件触发DAC转换
     pub unsafe fn software_trigger(&self, channel: DacChannel) {
         let dac = Dac::dac();
@@ -283,3 +330,287 @@ impl Dac {
 
 /// 预定义的DAC实例
 pub const DAC: Dac = Dac::new();
+
+/// 正弦多项式系数（Q30，sin(πx/2)在[0, 1]上的7阶奇次逼近）
+const SIN_C1: i64 = 1_686_629_713;
+const SIN_C3: i64 = -693_598_669;
+const SIN_C5: i64 = 85_569_306;
+const SIN_C7: i64 = -5_026_995;
+
+/// 定点正弦
+/// 
+/// 只使用整数运算，可在编译期求值，最大误差约为Q15满量程的0.015%（低于12位DAC的1 LSB）。
+/// 
+/// # Arguments
+/// * `phase` - 相位，0到65535对应一个完整周期
+/// 
+/// # Returns
+/// Q15格式的正弦值
+pub const fn sin_q15(phase: u16) -> i16 {
+    let quadrant = phase >> 14;
+    let mut p = (phase & 0x3FFF) as i64;
+    if quadrant & 1 != 0 {
+        p = 0x4000 - p;
+    }
+    
+    // Q14 -> Q30
+    let x = p << 16;
+    let x2 = (x * x) >> 30;
+    let mut t = SIN_C5 + ((x2 * SIN_C7) >> 30);
+    t = SIN_C3 + ((x2 * t) >> 30);
+    t = SIN_C1 + ((x2 * t) >> 30);
+    let mut y = (((x * t) >> 30) + (1 << 14)) >> 15;
+    if y > i16::MAX as i64 {
+        y = i16::MAX as i64;
+    } else if y < 0 {
+        y = 0;
+    }
+    
+    if quadrant >= 2 { -(y as i16) } else { y as i16 }
+}
+
+/// 在编译期生成正弦波查找表
+/// 
+/// # Arguments
+/// * `amplitude` - 峰值幅度（DAC码值）
+/// * `offset` - 直流偏置（DAC码值，通常为2048）
+/// 
+/// # Returns
+/// 一个周期的12位DAC码值表，超出0-4095的部分被截断
+/// 
+/// # Examples
+/// `static SINE: [u16; 64] = sine_table::<64>(2000, 2048);`
+pub const fn sine_table<const N: usize>(amplitude: u16, offset: u16) -> [u16; N] {
+    let mut table = [0u16; N];
+    let mut i = 0;
+    while i < N {
+        let phase = ((i as u64 * 65536) / N as u64) as u16;
+        let value = offset as i32 + ((sin_q15(phase) as i32 * amplitude as i32) >> 15);
+        table[i] = clamp_dac(value);
+        i += 1;
+    }
+    table
+}
+
+/// 在编译期生成三角波查找表
+/// 
+/// # Arguments
+/// * `low` - 最低码值
+/// * `high` - 最高码值
+pub const fn triangle_table<const N: usize>(low: u16, high: u16) -> [u16; N] {
+    let mut table = [0u16; N];
+    let span = high as i32 - low as i32;
+    let mut i = 0;
+    while i < N {
+        // 前半周期上升，后半周期下降
+        let pos = (i * 2) as i32;
+        let value = if pos < N as i32 {
+            low as i32 + span * pos / N as i32
+        } else {
+            low as i32 + span * (2 * N as i32 - pos) / N as i32
+        };
+        table[i] = clamp_dac(value);
+        i += 1;
+    }
+    table
+}
+
+/// 把结果截断到12位DAC范围
+const fn clamp_dac(value: i32) -> u16 {
+    if value < 0 {
+        0
+    } else if value > 4095 {
+        4095
+    } else {
+        value as u16
+    }
+}
+
+/// DAC波形错误类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum DacError {
+    /// 采样率为0或超出定时器范围
+    InvalidRate,
+    /// 定时器不能触发DAC（仅支持TIM2/TIM4的TRGO）
+    UnsupportedTimer,
+    /// 表长度为0或超过65535
+    InvalidLength,
+    /// DMA启动失败
+    Dma(DmaError),
+}
+
+impl From<DmaError> for DacError {
+    fn from(err: DmaError) -> Self {
+        DacError::Dma(err)
+    }
+}
+
+/// DAC流式输出双缓冲区
+/// 
+/// 建立在`DmaDoubleBuffer`之上，DMA以循环模式读取整个缓冲区：
+/// - 半传输中断表示前一半已输出完毕，可以重新填充
+/// - 传输完成中断表示后一半已输出完毕
+/// 
+/// 生产者通过`next_free`拿到空闲的半区直接写入，drop后交还给DMA。
+/// `N`为总采样点数，必须为偶数且不超过65535。
+pub struct DacStreamBuffer<const N: usize> {
+    inner: DmaDoubleBuffer<u16, N>,
+}
+
+impl<const N: usize> DacStreamBuffer<N> {
+    /// 每个半区的采样点数
+    pub const HALF_LEN: usize = N / 2;
+    
+    /// 创建新的流式输出缓冲区（初始为中点电平）
+    pub const fn new() -> Self {
+        Self {
+            inner: DmaDoubleBuffer::new(2048),
+        }
+    }
+    
+    /// 取出下一个等待填充的半区
+    /// 
+    /// 同一时刻只能持有一个半区，上一个尚未丢弃时返回`None`
+    pub fn next_free(&self) -> Option<DacFill<'_>> {
+        self.inner.take()
+    }
+    
+    /// 获取欠载次数（半区未及时填充而被DMA重复输出，或DMA传输错误）
+    pub fn underruns(&self) -> u32 {
+        self.inner.lags()
+    }
+}
+
+/// 等待填充的DAC半缓冲区
+/// 
+/// 通过`DerefMut`直接写入12位码值，drop时交还给DMA。
+pub type DacFill<'a> = DmaHalf<'a, u16>;
+
+/// 定时器触发的DAC波形发生器
+/// 
+/// 定时器TRGO按采样率触发DAC，DMA在每次触发时把下一个码值写入DHR12Rx，
+/// 输出过程完全不需要CPU参与：
+/// - `start_table`：循环输出一张固定查找表（如`sine_table`生成的表）
+/// - `start_stream`：循环输出双缓冲区，由应用在半传输/传输完成后填充空闲半区
+/// 
+/// 只有TIM2和TIM4的TRGO能触发DAC。对应引脚（PA4/PA5）需预先配置为模拟输入。
+/// 流式输出时需在对应DMA通道中断中调用`handle_dma_interrupt`，并在NVIC中使能该中断。
+pub struct DacWaveform {
+    channel: DacChannel,
+    timer: TimerNumber,
+}
+
+impl DacWaveform {
+    /// 创建新的波形发生器
+    /// 
+    /// # Arguments
+    /// * `channel` - DAC通道
+    /// * `timer` - 触发定时器（TIM2或TIM4）
+    pub const fn new(channel: DacChannel, timer: TimerNumber) -> Self {
+        Self {
+            channel,
+            timer,
+        }
+    }
+    
+    /// 配置定时器TRGO并返回对应的触发源（定时器保持停止）
+    unsafe fn configure_trigger(&self, sample_rate_hz: u32) -> Result<DacTriggerSource, DacError> {
+        let source = match self.timer {
+            TimerNumber::TIM2 => DacTriggerSource::Timer2TRGO,
+            TimerNumber::TIM4 => DacTriggerSource::Timer4TRGO,
+            _ => return Err(DacError::UnsupportedTimer),
+        };
+        
+        let timer = Timer::new(self.timer);
+        let (prescaler, period) = timer
+            .prescaler_period_for(sample_rate_hz)
+            .ok_or(DacError::InvalidRate)?;
+        timer.init(prescaler, period);
+        timer.set_master_mode(TimerMasterMode::Update);
+        Ok(source)
+    }
+    
+    /// 配置DAC通道并启动循环DMA和定时器
+    unsafe fn start_dma(&self, source: DacTriggerSource, data: *const u16, len: usize, interrupts: bool) -> Result<(), DacError> {
+        if len == 0 || len > 0xFFFF {
+            return Err(DacError::InvalidLength);
+        }
+        
+        DAC.init();
+        DAC.set_trigger_source(self.channel, source);
+        DAC.enable_trigger(self.channel);
+        DAC.enable_output_buffer(self.channel);
+        
+        let desc = DmaTransferDescriptor::memory_to_peripheral(
+            data as u32,
+            self.channel.dhr12r_address(),
+            len as u16,
+        )
+        .with_data_size(DmaPeripheralDataSize::HalfWord, DmaMemoryDataSize::HalfWord)
+        .with_priority(DmaChannelPriority::High)
+        .with_interrupts(interrupts, interrupts, interrupts);
+        self.channel.dma().start_circular(&desc)?;
+        
+        DAC.enable_dma(self.channel);
+        DAC.enable_channel(self.channel);
+        Timer::new(self.timer).start();
+        Ok(())
+    }
+    
+    /// 循环输出一张查找表
+    /// 
+    /// # Arguments
+    /// * `table` - 一个周期的12位码值表，输出频率为`sample_rate_hz / table.len()`
+    /// * `sample_rate_hz` - 每个码值的输出速率
+    /// 
+    /// # Returns
+    /// 成功返回`Ok(())`，参数无效或DMA忙返回错误
+    /// 
+    /// # Safety
+    /// 会重新配置DAC通道、指定定时器和对应的DMA2通道，调用者必须保证它们没有被其他代码使用
+    pub unsafe fn start_table(&self, table: &'static [u16], sample_rate_hz: u32) -> Result<(), DacError> {
+        self.stop();
+        let source = self.configure_trigger(sample_rate_hz)?;
+        self.start_dma(source, table.as_ptr(), table.len(), false)
+    }
+    
+    /// 循环输出双缓冲区中的任意数据流
+    /// 
+    /// 启动前先调用`prefill`填满整个缓冲区，之后每个半区输出完毕时可以通过
+    /// `buffer.next_free()`重新填充。
+    /// 
+    /// # Arguments
+    /// * `buffer` - 双缓冲区
+    /// * `sample_rate_hz` - 输出速率
+    /// * `prefill` - 启动前填充整个缓冲区的函数
+    /// 
+    /// # Safety
+    /// 同`start_table`
+    pub unsafe fn start_stream<const N: usize>(
+        &self,
+        buffer: &'static DacStreamBuffer<N>,
+        sample_rate_hz: u32,
+        prefill: impl FnOnce(&mut [u16]),
+    ) -> Result<(), DacError> {
+        self.stop();
+        buffer.inner.reset();
+        prefill(buffer.inner.as_mut_slice());
+        
+        let source = self.configure_trigger(sample_rate_hz)?;
+        self.start_dma(source, buffer.inner.as_ptr(), N, true)
+    }
+    
+    /// 停止输出（DAC保持最后一个码值）
+    pub unsafe fn stop(&self) {
+        Timer::new(self.timer).stop();
+        DAC.disable_dma(self.channel);
+        let dma = self.channel.dma();
+        dma.disable();
+        dma.clear_all_interrupts();
+    }
+    
+    /// 处理流式输出的DMA通道中断：半传输释放前一半，传输完成释放后一半
+    pub fn handle_dma_interrupt<const N: usize>(&self, buffer: &DacStreamBuffer<N>) {
+        buffer.inner.handle_dma_interrupt(self.channel.dma());
+    }
+}
@@ -4,16 +4,39 @@
 // 屏蔽未使用代码警告
 #![allow(unused)]
 
-use core::sync::atomic::{AtomicU32, Ordering};
+use core::sync::atomic::Ordering;
 use core::arch::asm;
 use core::time::Duration;
+use super::reg::{self, Reg, SCB_ICSR};
 
-/// 系统运行时间计数器（毫秒）
-static SYSTEM_TICK: AtomicU32 = AtomicU32::new(0);
+/// SysTick控制及状态寄存器
+const SYST_CSR: Reg<{ reg::SYSTICK_BASE }> = Reg::new();
 
-/// SysTick重装载值
+/// SysTick重装载值寄存器
+const SYST_RVR: Reg<{ reg::SYSTICK_BASE + 0x04 }> = Reg::new();
+
+/// SysTick当前值寄存器
+const SYST_CVR: Reg<{ reg::SYSTICK_BASE + 0x08 }> = Reg::new();
+
+/// ICSR.PENDSTSET / PENDSTCLR
+const ICSR_PENDSTSET: u32 = 1 << 26;
+const ICSR_PENDSTCLR: u32 = 1 << 25;
+
+/// SysTick最大重装载值（24位）
+const SYSTICK_MAX_RELOAD: u32 = 0x00FF_FFFF;
+
+/// SysTick重装载值（1ms节拍）
 static mut SYSTICK_RELOAD: u32 = 0;
 
+/// 已完成的SysTick周期累计的时钟周期数（只在SysTick中断或临界区内修改）
+static mut ELAPSED_CYCLES: u64 = 0;
+
+/// 当前正在计数的SysTick周期的起始值（即该周期开始时装入的重装载值）
+static mut PERIOD_RELOAD: u32 = 0;
+
+/// 是否处于无节拍模式
+static mut TICKLESS: bool = false;
+
 /// 系统时钟频率（Hz）
 static mut SYSTEM_CLOCK: u32 = 72_000_000;
 
@@ -28,7 +51,7 @@ static mut SYSTEM_CLOCK: u32 = 72_000_000;
 /// 直接访问硬件寄存器，需要确保在正确的上下文中调用
 pub unsafe fn init_systick(sysclk: u32) {
     // 检查SYSTICK是否已初始化
-    let csr = core::ptr::read_volatile(0xE000E010 as *const u32);
+    let csr = SYST_CSR.read();
     
     // 确定系统时钟频率
     let actual_sysclk = if sysclk > 0 {
@@ -55,24 +78,55 @@ pub unsafe fn init_systick(sysclk: u32) {
     
     if (csr & 0x01) == 0 {
         // 配置SYSTICK为1kHz
-        core::ptr::write_volatile(0xE000E014 as *mut u32, reload_value);
+        SYST_RVR.write(reload_value);
         // 清空当前值
-        core::ptr::write_volatile(0xE000E018 as *mut u32, 0);
-        // 启用SYSTICK，使用处理器时钟，不启用中断
-        core::ptr::write_volatile(0xE000E010 as *mut u32, 0x05); // 0x05 = ENABLE + CLKSOURCE，不设置TICKINT位
+        SYST_CVR.write(0);
+        PERIOD_RELOAD = reload_value;
+        // 启用SYSTICK，使用处理器时钟，启用中断用于累计运行时间
+        SYST_CSR.write(0x07); // 0x07 = ENABLE + TICKINT + CLKSOURCE
+    } else {
+        // 已由其他代码启动时沿用其周期
+        PERIOD_RELOAD = SYST_RVR.read();
     }
 }
 
-/// SysTick中断处理函数
+/// SysTick异常处理函数
 /// 
-/// 用于递增系统运行时间计数器
+/// 把刚结束的周期累加到运行时间，并记录新周期的起始值。
+/// 无节拍模式下周期长度由`tickless_idle`按下一个到期时间设置，空闲时不再每毫秒唤醒。
 /// 
-/// # Safety
-/// 直接访问硬件寄存器，需要确保在正确的上下文中调用
-#[export_name = "SysTick_Handler"]
-pub unsafe extern "C" fn systick_handler() {
-    // 递增系统运行时间计数器
-    SYSTEM_TICK.fetch_add(1, Ordering::SeqCst);
+/// 以cortex-m-rt的异常名`SysTick`注册到向量表（`memory.x`中有链接期检查），
+/// `init_systick`开启TICKINT后每个周期都会进入这里，不能落到`DefaultHandler`。
+#[cortex_m_rt::exception]
+fn SysTick() {
+    unsafe {
+        ELAPSED_CYCLES += PERIOD_RELOAD as u64 + 1;
+        PERIOD_RELOAD = SYST_RVR.read();
+    }
+}
+
+/// 读取当前运行时间（时钟周期数），必须在临界区内调用
+/// 
+/// SysTick已回绕但中断尚未处理时（PENDSTSET置位），重新读取当前值并补上刚结束的周期，
+/// 因此结果不会因为读取顺序而倒退。
+#[inline(always)]
+unsafe fn uptime_cycles_locked() -> u64 {
+    let mut value = SYST_CVR.read();
+    if (SCB_ICSR.read() & ICSR_PENDSTSET) != 0 {
+        // 回绕发生在读取当前值之前或之后，重新读取保证取到新周期的值
+        value = SYST_CVR.read();
+        let reload = SYST_RVR.read();
+        ELAPSED_CYCLES + PERIOD_RELOAD as u64 + 1 + (reload - value.min(reload)) as u64
+    } else {
+        ELAPSED_CYCLES + (PERIOD_RELOAD - value.min(PERIOD_RELOAD)) as u64
+    }
+}
+
+/// 获取系统运行时间（时钟周期数）
+/// 
+/// 单调递增，64位不会回绕。
+pub fn get_uptime_cycles() -> u64 {
+    cortex_m::interrupt::free(|_| unsafe { uptime_cycles_locked() })
 }
 
 /// 获取系统运行时间（毫秒）
@@ -80,7 +134,8 @@ pub unsafe extern "C" fn systick_handler() {
 /// # Returns
 /// 系统运行时间，单位：毫秒
 pub fn get_uptime_ms() -> u32 {
-    SYSTEM_TICK.load(Ordering::SeqCst)
+    let cycles_per_ms = unsafe { SYSTEM_CLOCK / 1000 } as u64;
+    (get_uptime_cycles() / cycles_per_ms) as u32
 }
 
 /// 获取系统运行时间（微秒）
@@ -88,15 +143,148 @@ pub fn get_uptime_ms() -> u32 {
 /// # Returns
 /// 系统运行时间，单位：微秒
 pub fn get_uptime_us() -> u64 {
-    let ms = get_uptime_ms() as u64;
-    let ticks = unsafe {
-        let current_value = core::ptr::read_volatile(0xE000E018 as *const u32);
-        let reload_value = SYSTICK_RELOAD;
-        (reload_value - current_value) as u64
+    cycles_to_us(get_uptime_cycles())
+}
+
+/// 时钟周期数换算为微秒
+/// 
+/// 按整秒和余数分开计算：HCLK经AHB分频可低于1MHz，不能先求每微秒的周期数，
+/// 直接乘1_000_000又会在运行几十小时后溢出。
+fn cycles_to_us(cycles: u64) -> u64 {
+    let clock = unsafe { SYSTEM_CLOCK } as u64;
+    cycles / clock * 1_000_000 + cycles % clock * 1_000_000 / clock
+}
+
+/// 微秒换算为时钟周期数（与`cycles_to_us`相同的分段计算）
+fn us_to_cycles(us: u64) -> u64 {
+    let clock = unsafe { SYSTEM_CLOCK } as u64;
+    us / 1_000_000 * clock + us % 1_000_000 * clock / 1_000_000
+}
+
+/// 重新设置SysTick周期，必须在临界区内调用
+/// 
+/// 先把当前周期已经过的时间并入累计值（包括尚未处理的回绕），再从新的重装载值开始计数，
+/// 运行时间在切换前后保持连续。
+unsafe fn reprogram_systick(reload: u32) {
+    ELAPSED_CYCLES = uptime_cycles_locked();
+    SCB_ICSR.write(ICSR_PENDSTCLR);
+    
+    SYST_RVR.write(reload);
+    // 写当前值寄存器使计数器清零，下一个时钟装入新的重装载值
+    SYST_CVR.write(0);
+    PERIOD_RELOAD = reload;
+}
+
+/// 系统时钟改变后重新设置SysTick
+/// 
+/// 已累计的运行时间从旧时钟的周期数换算为新时钟的周期数，运行时间在切换前后保持连续；
+/// 随后按新频率装入1ms重装载值（无节拍模式下仍为最大重装载值）。
+/// 由`system::set_clock_config`在切换时钟后调用，应用一般不需要直接调用。
+/// 
+/// # Arguments
+/// * `hclk` - 新的AHB时钟频率（Hz），即SysTick的计数时钟
+/// 
+/// # Safety
+/// 必须在临界区内、时钟切换完成后立即调用
+pub unsafe fn retime_systick(hclk: u32) {
+    let old = SYSTEM_CLOCK;
+    if hclk == 0 || hclk == old {
+        return;
+    }
+    SYSTEM_CLOCK = hclk;
+    if SYSTICK_RELOAD == 0 {
+        // SysTick尚未启动，只记录新频率
+        return;
+    }
+    
+    // 分成整秒和余数两部分换算，避免64位乘法溢出
+    let cycles = uptime_cycles_locked();
+    let old = old as u64;
+    let new = hclk as u64;
+    let scaled = (cycles / old) * new + (cycles % old) * new / old;
+    
+    SYSTICK_RELOAD = hclk / 1000 - 1;
+    reprogram_systick(if TICKLESS { SYSTICK_MAX_RELOAD } else { SYSTICK_RELOAD });
+    ELAPSED_CYCLES = scaled;
+}
+
+/// 进入或退出无节拍模式
+/// 
+/// 无节拍模式下SysTick不再产生1kHz中断，只在24位计数器回绕（72MHz时约233ms）
+/// 或`tickless_idle`设定的到期时间产生中断。运行时间、`delay_ms`和`delay_us`不受影响。
+/// 
+/// # Arguments
+/// * `enable` - `true`进入无节拍模式，`false`恢复1kHz节拍
+/// 
+/// # Safety
+/// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+pub unsafe fn set_tickless(enable: bool) {
+    if SYSTICK_RELOAD == 0 {
+        init_systick(0);
+    }
+    
+    cortex_m::interrupt::free(|_| {
+        TICKLESS = enable;
+        reprogram_systick(if enable { SYSTICK_MAX_RELOAD } else { SYSTICK_RELOAD });
+    });
+}
+
+/// 无节拍空闲：休眠到下一个到期时间或任意中断
+/// 
+/// 按`max_sleep_us`设置SysTick周期后执行WFI（`system::enter_low_power_mode(Sleep)`），
+/// 醒来后按实际经过的时间恢复计数。休眠长度受24位计数器限制，超过时提前醒来，
+/// 调用者应在循环中重新计算到期时间后再次调用。
+/// 
+/// # Arguments
+/// * `max_sleep_us` - 距离下一个到期时间的微秒数（如`SoftTimerQueue::next_deadline`换算值），
+///   `None`表示没有待处理的到期时间
+/// 
+/// # Returns
+/// 实际休眠的微秒数
+/// 
+/// # Safety
+/// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+pub unsafe fn tickless_idle(max_sleep_us: Option<u32>) -> u32 {
+    if SYSTICK_RELOAD == 0 {
+        init_systick(0);
+    }
+    
+    let reload = match max_sleep_us {
+        Some(us) => us_to_cycles(us as u64).clamp(1, SYSTICK_MAX_RELOAD as u64 + 1) as u32 - 1,
+        None => SYSTICK_MAX_RELOAD,
     };
+    if reload == 0 {
+        return 0;
+    }
     
-    // 计算微秒数
-    ms * 1000 + (ticks * 1000) / (unsafe { SYSTICK_RELOAD + 1 }) as u64
+    // 关中断后WFI：挂起的中断仍能唤醒CPU，退出临界区后才执行其处理函数，
+    // 保证恢复SysTick周期前不会有中断读取到不一致的时间
+    cortex_m::interrupt::free(|_| {
+        let start = uptime_cycles_locked();
+        reprogram_systick(reload);
+        
+        crate::bsp::system::enter_low_power_mode(crate::bsp::system::LowPowerMode::Sleep);
+        
+        let restore = if TICKLESS { SYSTICK_MAX_RELOAD } else { SYSTICK_RELOAD };
+        reprogram_systick(restore);
+        cycles_to_us(ELAPSED_CYCLES - start) as u32
+    })
+}
+
+/// 补上SysTick停止计数期间经过的时间
+/// 
+/// 停止模式下HCLK关闭，SysTick不计数，由`idle`模块用RTC测得休眠时间后调用，
+/// 使运行时间和基于它的定时等待保持正确。
+/// 
+/// # Arguments
+/// * `us` - SysTick停止期间经过的微秒数
+/// 
+/// # Safety
+/// 直接修改运行时间累计值，需要确保在正确的上下文中调用
+pub unsafe fn advance_uptime(us: u64) {
+    cortex_m::interrupt::free(|_| {
+        ELAPSED_CYCLES += us_to_cycles(us);
+    });
 }
 
 /// 基于系统时钟的延时函数（微秒）
@@ -147,9 +335,8 @@ pub unsafe fn delay_us(us: u32) {
 /// 使用内联汇编，需要确保在正确的上下文中调用
 #[inline(always)]
 unsafe fn delay_us_precise(us: u32) {
-    // 根据系统时钟频率计算循环次数
-    let cycles_per_us = SYSTEM_CLOCK / 1_000_000;
-    let total_cycles = us as u32 * cycles_per_us;
+    // 根据系统时钟频率计算循环次数，至少1次（计数为0时subs会回绕成近2^32次循环）
+    let total_cycles = (us_to_cycles(us as u64) as u32).max(1);
     
     // 使用内联汇编实现精确的空循环
     asm!(
@@ -164,7 +351,8 @@ unsafe fn delay_us_precise(us: u32) {
 
 /// 基于系统时钟的延时函数（毫秒）
 /// 
-/// 使用SysTick的COUNTFLAG标志实现精确的毫秒级延时，不依赖中断
+/// 使用DWT周期计数器实现精确的毫秒级延时，不依赖中断，
+/// 也不受SysTick周期（无节拍模式）影响
 /// 
 /// # Arguments
 /// * `ms` - 延时时间，单位：毫秒
@@ -176,14 +364,16 @@ pub unsafe fn delay_ms(ms: u32) {
     if SYSTICK_RELOAD == 0 {
         init_systick(0);
     }
+    enable_cycle_counter();
     
-    // 使用SysTick的COUNTFLAG标志实现延时
+    // 每毫秒单独计时，避免长延时超出32位计数范围
+    let cycles_per_ms = SYSTEM_CLOCK / 1000;
+    let mut mark = cycle_count();
     for _ in 0..ms {
-        // 等待SysTick计数完成
-        while (core::ptr::read_volatile(0xE000E010 as *const u32) & (1 << 16)) == 0 {
+        while cycle_count().wrapping_sub(mark) < cycles_per_ms {
             core::sync::atomic::compiler_fence(Ordering::SeqCst);
         }
-        // COUNTFLAG被读取后会自动清零，无需额外操作
+        mark = mark.wrapping_add(cycles_per_ms);
     }
 }
 
@@ -246,6 +436,48 @@ where
     }
 }
 
+/// DWT控制寄存器
+const DWT_CTRL: Reg<0xE000_1000> = Reg::new();
+
+/// DWT周期计数器
+const DWT_CYCCNT: Reg<0xE000_1004> = Reg::new();
+
+/// 调试异常和监控控制寄存器（DEMCR）
+const DEMCR: Reg<0xE000_EDFC> = Reg::new();
+
+/// 启用DWT周期计数器
+/// 
+/// CYCCNT以系统时钟频率单调递增，32位回绕，72MHz时约59秒回绕一次，
+/// 用于需要精确到时钟周期的短时计时（如软件IIC的半周期）。重复调用无副作用。
+/// 
+/// # Safety
+/// 直接访问内核调试寄存器，需要确保没有调试器依赖DWT的当前配置
+pub unsafe fn enable_cycle_counter() {
+    // TRCENA使能DWT/ITM
+    DEMCR.set_bits(1 << 24);
+    
+    // CYCCNTENA
+    let ctrl = DWT_CTRL.read();
+    if (ctrl & 0x01) == 0 {
+        DWT_CYCCNT.write(0);
+        DWT_CTRL.write(ctrl | 0x01);
+    }
+}
+
+/// 读取DWT周期计数器
+/// 
+/// # Returns
+/// 当前周期计数，计算间隔时使用`wrapping_sub`
+#[inline(always)]
+pub fn cycle_count() -> u32 {
+    unsafe { DWT_CYCCNT.read() }
+}
+
+/// 获取延时模块使用的系统时钟频率（Hz）
+pub fn system_clock() -> u32 {
+    unsafe { SYSTEM_CLOCK }
+}
+
 /// 时间戳结构体
 #[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
 pub struct Timestamp {
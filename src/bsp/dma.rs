@@ -5,6 +5,15 @@
 
 // 使用内部生成的设备驱动库
 use library::*;
+use core::cell::UnsafeCell;
+use core::future::Future;
+use core::sync::atomic::{AtomicBool, AtomicU8, AtomicU32, Ordering};
+use core::task::Waker;
+use crate::bsp::executor::{self, WakerSlot};
+use crate::bsp::idle::{self, Activity};
+
+/// 各通道的异步唤醒槽位（DMA1通道1~7，DMA2通道1~5）
+static DMA_WAKERS: [WakerSlot; 12] = [WakerSlot::NEW; 12];
 
 /// DMA通道枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -80,7 +89,219 @@ pub enum DmaInterrupt {
     TransferError = 1 << 3,
 }
 
+/// DMA错误类型枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum DmaError {
+    /// 传输错误（TEIF），通常是地址非法或总线错误
+    TransferError,
+    /// 通道正在传输，无法重新配置
+    Busy,
+    /// 传输长度为0或超过65535
+    InvalidLength,
+    /// 等待传输完成超时
+    Timeout,
+}
+
+/// DMA传输状态枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum DmaTransferStatus {
+    /// 传输进行中
+    InProgress,
+    /// 已完成一半
+    HalfComplete,
+    /// 传输完成
+    Complete,
+    /// 传输出错
+    Error,
+}
+
+/// CCR寄存器位定义
+const CCR_EN: u32 = 1 << 0;
+const CCR_TCIE: u32 = 1 << 1;
+const CCR_HTIE: u32 = 1 << 2;
+const CCR_TEIE: u32 = 1 << 3;
+const CCR_DIR: u32 = 1 << 4;
+const CCR_CIRC: u32 = 1 << 5;
+const CCR_PINC: u32 = 1 << 6;
+const CCR_MINC: u32 = 1 << 7;
+const CCR_MEM2MEM: u32 = 1 << 14;
+const CCR_INTERRUPT_MASK: u32 = CCR_TCIE | CCR_HTIE | CCR_TEIE;
+
+/// 每个通道寄存器组（CCR/CNDTR/CPAR/CMAR）相对DMA基地址的偏移
+const CHANNEL_REG_OFFSET: usize = 0x08;
+/// 相邻通道寄存器组之间的间隔
+const CHANNEL_REG_STRIDE: usize = 0x14;
+
+/// DMA传输描述符
+/// 
+/// 一次传输的完整配置，地址、长度、数据宽度和模式在这里一次给出，
+/// 由`Dma::start`一次性写入通道寄存器。
+/// 
+/// 对于`MemoryToMemory`方向，`peripheral_addr`为源地址，`memory_addr`为目的地址。
+#[derive(Debug, Clone, Copy)]
+pub struct DmaTransferDescriptor {
+    /// 传输方向
+    pub direction: DmaDirection,
+    /// 外设地址（存储器到存储器模式下为源地址）
+    pub peripheral_addr: u32,
+    /// 内存地址（存储器到存储器模式下为目的地址）
+    pub memory_addr: u32,
+    /// 传输数据项个数（按外设数据宽度计）
+    pub count: u16,
+    /// 外设地址增量模式
+    pub peripheral_increment: DmaPeripheralIncrementMode,
+    /// 内存地址增量模式
+    pub memory_increment: DmaMemoryIncrementMode,
+    /// 外设数据宽度
+    pub peripheral_data_size: DmaPeripheralDataSize,
+    /// 内存数据宽度
+    pub memory_data_size: DmaMemoryDataSize,
+    /// 通道优先级
+    pub priority: DmaChannelPriority,
+    /// 循环模式
+    pub circular_mode: DmaCircularMode,
+    /// 是否启用传输完成中断
+    pub tc_interrupt: bool,
+    /// 是否启用半传输中断
+    pub ht_interrupt: bool,
+    /// 是否启用传输错误中断
+    pub te_interrupt: bool,
+}
+
+impl DmaTransferDescriptor {
+    /// 创建外设到内存的传输描述符（外设地址固定，内存地址递增，字节宽度）
+    pub const fn peripheral_to_memory(peripheral_addr: u32, memory_addr: u32, count: u16) -> Self {
+        Self {
+            direction: DmaDirection::PeripheralToMemory,
+            peripheral_addr,
+            memory_addr,
+            count,
+            peripheral_increment: DmaPeripheralIncrementMode::Disabled,
+            memory_increment: DmaMemoryIncrementMode::Enabled,
+            peripheral_data_size: DmaPeripheralDataSize::Byte,
+            memory_data_size: DmaMemoryDataSize::Byte,
+            priority: DmaChannelPriority::Medium,
+            circular_mode: DmaCircularMode::Disabled,
+            tc_interrupt: false,
+            ht_interrupt: false,
+            te_interrupt: false,
+        }
+    }
+    
+    /// 创建内存到外设的传输描述符（外设地址固定，内存地址递增，字节宽度）
+    pub const fn memory_to_peripheral(memory_addr: u32, peripheral_addr: u32, count: u16) -> Self {
+        let mut desc = Self::peripheral_to_memory(peripheral_addr, memory_addr, count);
+        desc.direction = DmaDirection::MemoryToPeripheral;
+        desc
+    }
+    
+    /// 创建存储器到存储器的传输描述符（源和目的地址均递增，字节宽度）
+    pub const fn memory_to_memory(src_addr: u32, dst_addr: u32, count: u16) -> Self {
+        let mut desc = Self::peripheral_to_memory(src_addr, dst_addr, count);
+        desc.direction = DmaDirection::MemoryToMemory;
+        desc.peripheral_increment = DmaPeripheralIncrementMode::Enabled;
+        desc
+    }
+    
+    /// 设置外设和内存数据宽度
+    pub const fn with_data_size(mut self, peripheral: DmaPeripheralDataSize, memory: DmaMemoryDataSize) -> Self {
+        self.peripheral_data_size = peripheral;
+        self.memory_data_size = memory;
+        self
+    }
+    
+    /// 设置地址增量模式
+    pub const fn with_increment(mut self, peripheral: DmaPeripheralIncrementMode, memory: DmaMemoryIncrementMode) -> Self {
+        self.peripheral_increment = peripheral;
+        self.memory_increment = memory;
+        self
+    }
+    
+    /// 设置通道优先级
+    pub const fn with_priority(mut self, priority: DmaChannelPriority) -> Self {
+        self.priority = priority;
+        self
+    }
+    
+    /// 启用循环模式（存储器到存储器模式下硬件不支持循环，会被忽略）
+    pub const fn with_circular(mut self) -> Self {
+        self.circular_mode = DmaCircularMode::Enabled;
+        self
+    }
+    
+    /// 设置需要启用的中断
+    pub const fn with_interrupts(mut self, tc: bool, ht: bool, te: bool) -> Self {
+        self.tc_interrupt = tc;
+        self.ht_interrupt = ht;
+        self.te_interrupt = te;
+        self
+    }
+    
+    /// 计算对应的CCR寄存器值（不含EN位）
+    pub const fn ccr_bits(&self) -> u32 {
+        let mut ccr = ccr_mode_bits(
+            self.direction,
+            self.peripheral_increment,
+            self.memory_increment,
+            self.peripheral_data_size,
+            self.memory_data_size,
+            self.priority,
+            self.circular_mode,
+        );
+        
+        if self.tc_interrupt {
+            ccr |= CCR_TCIE;
+        }
+        if self.ht_interrupt {
+            ccr |= CCR_HTIE;
+        }
+        if self.te_interrupt {
+            ccr |= CCR_TEIE;
+        }
+        
+        ccr
+    }
+}
+
+/// 根据传输参数计算CCR寄存器的模式位（不含EN位和中断位）
+const fn ccr_mode_bits(
+    direction: DmaDirection,
+    peripheral_increment: DmaPeripheralIncrementMode,
+    memory_increment: DmaMemoryIncrementMode,
+    peripheral_data_size: DmaPeripheralDataSize,
+    memory_data_size: DmaMemoryDataSize,
+    priority: DmaChannelPriority,
+    circular_mode: DmaCircularMode,
+) -> u32 {
+    let mut ccr = 0;
+    
+    match direction {
+        DmaDirection::PeripheralToMemory => {}
+        DmaDirection::MemoryToPeripheral => ccr |= CCR_DIR,
+        // 存储器到存储器模式：CPAR为源，CMAR为目的，DIR保持为0
+        DmaDirection::MemoryToMemory => ccr |= CCR_MEM2MEM,
+    }
+    
+    if let DmaPeripheralIncrementMode::Enabled = peripheral_increment {
+        ccr |= CCR_PINC;
+    }
+    if let DmaMemoryIncrementMode::Enabled = memory_increment {
+        ccr |= CCR_MINC;
+    }
+    // 硬件不支持存储器到存储器模式下的循环传输
+    if matches!(circular_mode, DmaCircularMode::Enabled) && !matches!(direction, DmaDirection::MemoryToMemory) {
+        ccr |= CCR_CIRC;
+    }
+    
+    ccr |= (peripheral_data_size as u32) << 8;
+    ccr |= (memory_data_size as u32) << 10;
+    ccr |= (priority as u32) << 12;
+    
+    ccr
+}
+
 /// DMA结构体
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct Dma {
     dma_number: u8,
     channel: DmaChannel,
@@ -95,6 +316,16 @@ impl Dma {
         }
     }
     
+    /// 获取DMA控制器编号（1或2）
+    pub const fn dma_number(&self) -> u8 {
+        self.dma_number
+    }
+    
+    /// 获取DMA通道
+    pub const fn channel(&self) -> DmaChannel {
+        self.channel
+    }
+    
     /// 获取DMA寄存器块
     unsafe fn get_dma(&self) -> &'static mut library::dma1::RegisterBlock {
         match self.dma_number {
@@ -104,7 +335,41 @@ impl Dma {
         }
     }
     
-        /// 初始化DMA通道
+    /// 获取当前通道寄存器组的指针
+    /// 
+    /// 内部库为每个通道生成了独立的寄存器类型（ccr1..ccr7），
+    /// 这里利用它们在寄存器块中等间距排列的特点按通道号计算地址：
+    /// 偏移0x00为CCR，0x04为CNDTR，0x08为CPAR，0x0C为CMAR。
+    #[inline(always)]
+    unsafe fn channel_reg(&self, offset: usize) -> *mut u32 {
+        let base = self.get_dma() as *mut library::dma1::RegisterBlock as usize;
+        (base + CHANNEL_REG_OFFSET + self.channel as usize * CHANNEL_REG_STRIDE + offset) as *mut u32
+    }
+    
+    /// 读取CCR寄存器
+    #[inline(always)]
+    unsafe fn read_ccr(&self) -> u32 {
+        core::ptr::read_volatile(self.channel_reg(0x00))
+    }
+    
+    /// 写入CCR寄存器
+    #[inline(always)]
+    unsafe fn write_ccr(&self, value: u32) {
+        core::ptr::write_volatile(self.channel_reg(0x00), value);
+    }
+    
+    /// 启用DMA控制器时钟
+    pub unsafe fn enable_clock(&self) {
+        let rcc = &mut *(0x40021000 as *mut library::rcc::RegisterBlock);
+        match self.dma_number {
+            2 => rcc.ahbenr().modify(|_, w: &mut library::rcc::ahbenr::W| w.dma2en().set_bit()),
+            _ => rcc.ahbenr().modify(|_, w: &mut library::rcc::ahbenr::W| w.dma1en().set_bit()),
+        };
+    }
+    
+    /// 初始化DMA通道
+    /// 
+    /// 启用DMA时钟，关闭通道后写入模式配置。已启用的中断位保持不变。
     pub unsafe fn init(
         &self,
         direction: DmaDirection,
@@ -115,32 +380,55 @@ impl Dma {
         priority: DmaChannelPriority,
         circular_mode: DmaCircularMode,
     ) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+        self.enable_clock();
+        self.disable();
+        
+        let interrupts = self.read_ccr() & CCR_INTERRUPT_MASK;
+        let ccr = ccr_mode_bits(
+            direction,
+            peripheral_increment,
+            memory_increment,
+            peripheral_data_size,
+            memory_data_size,
+            priority,
+            circular_mode,
+        );
+        self.write_ccr(ccr | interrupts);
     }
     
     /// 配置DMA传输
-    pub unsafe fn configure_transfer(&self, _peripheral_addr: u32, _memory_addr: u32, _data_count: u16) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+    /// 
+    /// 只有在通道关闭时写入才有效，调用前需先调用`disable`
+    pub unsafe fn configure_transfer(&self, peripheral_addr: u32, memory_addr: u32, data_count: u16) {
+        core::ptr::write_volatile(self.channel_reg(0x08), peripheral_addr);
+        core::ptr::write_volatile(self.channel_reg(0x0C), memory_addr);
+        core::ptr::write_volatile(self.channel_reg(0x04), data_count as u32);
     }
     
     /// 启用DMA通道
     pub unsafe fn enable(&self) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+        self.write_ccr(self.read_ccr() | CCR_EN);
     }
     
     /// 禁用DMA通道
     pub unsafe fn disable(&self) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+        self.write_ccr(self.read_ccr() & !CCR_EN);
+    }
+    
+    /// 检查DMA通道是否已启用
+    pub unsafe fn is_enabled(&self) -> bool {
+        (self.read_ccr() & CCR_EN) != 0
     }
     
     /// 启用中断
-    pub unsafe fn enable_interrupt(&self, _interrupt: DmaInterrupt) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+    pub unsafe fn enable_interrupt(&self, interrupt: DmaInterrupt) {
+        // CCR中的TCIE/HTIE/TEIE与ISR中的标志位位置相同
+        self.write_ccr(self.read_ccr() | interrupt as u32);
     }
     
     /// 禁用中断
-    pub unsafe fn disable_interrupt(&self, _interrupt: DmaInterrupt) {
-        // 由于内部库中DMA寄存器结构不同，暂时为空实现
+    pub unsafe fn disable_interrupt(&self, interrupt: DmaInterrupt) {
+        self.write_ccr(self.read_ccr() & !(interrupt as u32));
     }
     
     /// 检查中断标志
@@ -158,16 +446,477 @@ impl Dma {
         dma.ifcr().write(|w: &mut library::dma1::ifcr::W| unsafe { w.bits((interrupt as u32) << channel_offset) });
     }
     
+    /// 清除当前通道的全部中断标志（GIF/TCIF/HTIF/TEIF）
+    pub unsafe fn clear_all_interrupts(&self) {
+        let dma = self.get_dma();
+        let channel_offset = self.channel as u32 * 4;
+        dma.ifcr().write(|w: &mut library::dma1::ifcr::W| unsafe { w.bits(0x0F << channel_offset) });
+    }
+    
     /// 获取剩余数据计数
     pub unsafe fn get_remaining_count(&self) -> u16 {
-        // 由于内部库中DMA寄存器结构不同，暂时返回固定值
-        0
+        core::ptr::read_volatile(self.channel_reg(0x04)) as u16
     }
     
     /// 检查DMA通道是否正在传输
+    /// 
+    /// 循环模式下只要通道启用就视为正在传输
     pub unsafe fn is_transferring(&self) -> bool {
-        // 由于内部库中DMA寄存器结构不同，暂时返回固定值
-        false
+        let ccr = self.read_ccr();
+        if (ccr & CCR_EN) == 0 {
+            return false;
+        }
+        (ccr & CCR_CIRC) != 0 || self.get_remaining_count() != 0
+    }
+    
+    /// 获取该通道对应的NVIC中断号
+    /// 
+    /// DMA2的通道4和通道5共用一个中断向量
+    pub fn interrupt(&self) -> library::Interrupt {
+        match (self.dma_number, self.channel) {
+            (2, DmaChannel::Channel1) => library::Interrupt::DMA2_Channel1,
+            (2, DmaChannel::Channel2) => library::Interrupt::DMA2_Channel2,
+            (2, DmaChannel::Channel3) => library::Interrupt::DMA2_Channel3,
+            (2, _) => library::Interrupt::DMA2_Channel4_5,
+            (_, DmaChannel::Channel1) => library::Interrupt::DMA1_Channel1,
+            (_, DmaChannel::Channel2) => library::Interrupt::DMA1_Channel2,
+            (_, DmaChannel::Channel3) => library::Interrupt::DMA1_Channel3,
+            (_, DmaChannel::Channel4) => library::Interrupt::DMA1_Channel4,
+            (_, DmaChannel::Channel5) => library::Interrupt::DMA1_Channel5,
+            (_, DmaChannel::Channel6) => library::Interrupt::DMA1_Channel6,
+            (_, DmaChannel::Channel7) => library::Interrupt::DMA1_Channel7,
+        }
+    }
+    
+    /// 通道对应的异步唤醒槽位
+    fn waker_slot(&self) -> &'static WakerSlot {
+        let dma_offset = if self.dma_number == 2 { 7 } else { 0 };
+        &DMA_WAKERS[(dma_offset + self.channel as usize).min(DMA_WAKERS.len() - 1)]
+    }
+    
+    /// 异步等待：登记唤醒器并打开传输完成和传输错误中断
+    /// 
+    /// # Safety
+    /// 该通道的中断处理函数必须调用`handle_async_interrupt`，且已在NVIC中使能
+    pub unsafe fn arm_async(&self, waker: &Waker) {
+        self.waker_slot().register(waker);
+        self.enable_interrupt(DmaInterrupt::TransferComplete);
+        self.enable_interrupt(DmaInterrupt::TransferError);
+    }
+    
+    /// 异步等待的中断入口：关闭完成和错误中断并唤醒等待的任务
+    /// 
+    /// 标志位保留给任务轮询时处理。DMA2通道4和通道5共用一个中断，两个通道都要调用。
+    /// 
+    /// # Safety
+    /// 应在该通道的中断处理函数中调用
+    pub unsafe fn handle_async_interrupt(&self) {
+        let ccr = self.read_ccr();
+        let armed = DmaInterrupt::TransferComplete as u32 | DmaInterrupt::TransferError as u32;
+        if (ccr & armed) != 0 && (self.check_interrupt(DmaInterrupt::TransferComplete) || self.check_interrupt(DmaInterrupt::TransferError)) {
+            self.write_ccr(ccr & !armed);
+            self.waker_slot().wake();
+        }
+    }
+    
+    /// 按描述符启动一次传输
+    /// 
+    /// 依次关闭通道、清除标志、写入地址/长度/CCR，最后置位EN。
+    /// 返回的`DmaTransfer`句柄可用于轮询或等待传输完成，期间CPU可以做其他事情。
+    /// 
+    /// # Safety
+    /// - 调用者必须保证`memory_addr`（以及存储器到存储器模式下的`peripheral_addr`）
+    ///   指向的缓冲区在传输结束前一直有效，且不会被其他代码同时写入
+    /// - 调用者必须保证外设已打开相应的DMA请求
+    pub unsafe fn start(&self, desc: &DmaTransferDescriptor) -> Result<DmaTransfer, DmaError> {
+        if desc.count == 0 {
+            return Err(DmaError::InvalidLength);
+        }
+        if self.is_transferring() {
+            return Err(DmaError::Busy);
+        }
+        
+        self.enable_clock();
+        self.write_ccr(0);
+        self.clear_all_interrupts();
+        self.configure_transfer(desc.peripheral_addr, desc.memory_addr, desc.count);
+        
+        let ccr = desc.ccr_bits();
+        self.write_ccr(ccr);
+        // 确保缓冲区写入在启动传输前完成
+        core::sync::atomic::compiler_fence(core::sync::atomic::Ordering::Release);
+        self.write_ccr(ccr | CCR_EN);
+        
+        Ok(DmaTransfer {
+            dma: *self,
+            count: desc.count,
+            circular: (ccr & CCR_CIRC) != 0,
+        })
+    }
+    
+    /// 按描述符启动一次循环传输
+    /// 
+    /// 强制使用循环模式，通道会一直运行直到`disable`。循环传输永不结束，
+    /// 因此不返回传输句柄，进度通过半传输/传输完成中断（如`DmaDoubleBuffer::handle_dma_interrupt`）发布。
+    /// 
+    /// # Safety
+    /// 同`start`，且缓冲区必须在通道关闭前一直有效
+    pub unsafe fn start_circular(&self, desc: &DmaTransferDescriptor) -> Result<(), DmaError> {
+        self.start(&desc.with_circular())?;
+        Ok(())
+    }
+}
+
+/// DMA传输句柄
+/// 
+/// 由`Dma::start`返回，持有一次正在进行的传输，可轮询状态、等待完成或中止。
+#[derive(Debug)]
+pub struct DmaTransfer {
+    dma: Dma,
+    count: u16,
+    circular: bool,
+}
+
+impl DmaTransfer {
+    /// 获取传输使用的DMA通道
+    pub fn dma(&self) -> Dma {
+        self.dma
+    }
+    
+    /// 获取本次传输的总数据项个数
+    pub fn len(&self) -> u16 {
+        self.count
+    }
+    
+    /// 获取剩余数据项个数
+    pub fn remaining(&self) -> u16 {
+        unsafe { self.dma.get_remaining_count() }
+    }
+    
+    /// 获取已传输数据项个数
+    /// 
+    /// 循环模式下为当前这一轮已传输的个数
+    pub fn transferred(&self) -> u16 {
+        self.count - self.remaining()
+    }
+    
+    /// 检查传输是否完成
+    pub fn is_complete(&self) -> bool {
+        unsafe { self.dma.check_interrupt(DmaInterrupt::TransferComplete) }
+    }
+    
+    /// 检查是否已完成一半
+    pub fn is_half_complete(&self) -> bool {
+        unsafe { self.dma.check_interrupt(DmaInterrupt::HalfTransfer) }
+    }
+    
+    /// 检查是否发生传输错误
+    pub fn has_error(&self) -> bool {
+        unsafe { self.dma.check_interrupt(DmaInterrupt::TransferError) }
+    }
+    
+    /// 查询传输状态
+    pub fn status(&self) -> DmaTransferStatus {
+        if self.has_error() {
+            DmaTransferStatus::Error
+        } else if self.is_complete() {
+            DmaTransferStatus::Complete
+        } else if self.is_half_complete() {
+            DmaTransferStatus::HalfComplete
+        } else {
+            DmaTransferStatus::InProgress
+        }
+    }
+    
+    /// 非阻塞轮询传输结果
+    /// 
+    /// # Returns
+    /// * `None` - 传输尚未结束
+    /// * `Some(Ok(()))` - 传输完成，通道已关闭
+    /// * `Some(Err(DmaError::TransferError))` - 传输出错，通道已被硬件关闭
+    pub fn poll(&self) -> Option<Result<(), DmaError>> {
+        if self.has_error() {
+            unsafe {
+                self.dma.disable();
+                self.dma.clear_all_interrupts();
+            }
+            return Some(Err(DmaError::TransferError));
+        }
+        
+        if self.is_complete() {
+            unsafe {
+                if !self.circular {
+                    self.dma.disable();
+                }
+                self.dma.clear_interrupt(DmaInterrupt::TransferComplete);
+            }
+            core::sync::atomic::compiler_fence(core::sync::atomic::Ordering::Acquire);
+            return Some(Ok(()));
+        }
+        
+        None
+    }
+    
+    /// 阻塞等待传输完成
+    /// 
+    /// 循环模式下等待当前这一轮结束
+    pub fn wait(self) -> Result<(), DmaError> {
+        loop {
+            if let Some(result) = self.poll() {
+                return result;
+            }
+            core::hint::spin_loop();
+        }
+    }
+    
+    /// 带超时地等待传输完成
+    /// 
+    /// # Arguments
+    /// * `timeout_us` - 超时时间，单位：微秒
+    /// 
+    /// # Returns
+    /// 超时时通道被关闭并返回`DmaError::Timeout`
+    pub fn wait_timeout(self, timeout_us: u32) -> Result<(), DmaError> {
+        let timed_out = unsafe {
+            crate::bsp::delay::wait_with_timeout(timeout_us, || self.has_error() || self.is_complete())
+        };
+        
+        if timed_out {
+            self.abort();
+            return Err(DmaError::Timeout);
+        }
+        
+        self.wait()
+    }
+    
+    /// 异步等待传输完成，等待期间CPU可以执行其他任务或休眠
+    /// 
+    /// 需要该通道的中断处理函数调用`Dma::handle_async_interrupt`。
+    /// 返回的future在传输结束前被丢弃时（包括从未被轮询、`executor::with_timeout`超时）关闭通道，
+    /// 之后DMA不再访问缓冲区
+    pub fn wait_async(self) -> impl Future<Output = Result<(), DmaError>> {
+        // 在创建future时就持有，future未被轮询即丢弃时也能中止传输
+        let guard = AbortOnDrop(self.dma);
+        async move {
+            let dma = self.dma;
+            let _active = idle::hold(Activity::Dma);
+            let result = executor::wait_for(|| self.poll(), |waker| unsafe { dma.arm_async(waker) }).await;
+            core::mem::forget(guard);
+            result
+        }
+    }
+    
+    /// 中止传输
+    /// 
+    /// # Returns
+    /// 中止时剩余未传输的数据项个数
+    pub fn abort(self) -> u16 {
+        unsafe {
+            self.dma.disable();
+            let remaining = self.dma.get_remaining_count();
+            self.dma.clear_all_interrupts();
+            remaining
+        }
+    }
+}
+
+/// 异步等待被取消时中止传输
+struct AbortOnDrop(Dma);
+
+impl Drop for AbortOnDrop {
+    fn drop(&mut self) {
+        unsafe {
+            self.0.disable();
+            self.0.clear_all_interrupts();
+        }
+    }
+}
+
+/// 双缓冲区中两个半区的交接状态
+struct HalfState {
+    /// 已交给CPU且尚未交还的半区（bit0为前一半，bit1为后一半）
+    ready: AtomicU8,
+    /// CPU下一个期望取得的半区
+    next: AtomicU8,
+    /// 是否有未交还的`DmaHalf`，同一时刻只交出一个半区
+    taken: AtomicBool,
+}
+
+/// DMA循环双缓冲区
+/// 
+/// DMA以循环模式访问整个缓冲区，前一半和后一半轮流交给CPU：
+/// - 半传输中断交出前一半，传输完成中断交出后一半
+/// - 外设到内存方向交出的是已写满的数据，内存到外设方向交出的是已读完、等待重新填充的空间
+/// - CPU通过`take`以零拷贝方式拿到交出的半区，drop后交还给DMA
+/// 
+/// 交出一个半区时若另一个半区仍未交还，说明DMA已经在访问CPU持有的数据，记为一次滞后
+/// （输入方向即溢出，输出方向即欠载）。各外设的采样/流式缓冲区都建立在它之上。
+/// `N`为元素总数，必须为偶数且不超过65535。
+pub struct DmaDoubleBuffer<T: Copy, const N: usize> {
+    buffer: UnsafeCell<[T; N]>,
+    state: HalfState,
+    /// 滞后次数
+    lags: AtomicU32,
+}
+
+/// 实现 Sync trait，半区由DMA中断交出、单个CPU端使用者取得
+unsafe impl<T: Copy, const N: usize> Sync for DmaDoubleBuffer<T, N> {}
+
+impl<T: Copy, const N: usize> DmaDoubleBuffer<T, N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N >= 2 && N % 2 == 0 && N <= 0xFFFF, "DMA双缓冲区大小必须为偶数且不超过65535");
+    
+    /// 每个半区的元素个数
+    pub const HALF_LEN: usize = N / 2;
+    
+    /// 创建新的双缓冲区
+    /// 
+    /// # Arguments
+    /// * `fill` - 缓冲区初始内容（输出方向在填充前就可能被DMA读出，应选不产生副作用的值）
+    pub const fn new(fill: T) -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            buffer: UnsafeCell::new([fill; N]),
+            state: HalfState {
+                ready: AtomicU8::new(0),
+                next: AtomicU8::new(0),
+                taken: AtomicBool::new(false),
+            },
+            lags: AtomicU32::new(0),
+        }
+    }
+    
+    /// 获取缓冲区首地址，用作DMA的内存地址
+    pub fn as_ptr(&self) -> *mut T {
+        self.buffer.get() as *mut T
+    }
+    
+    /// 复位交接状态和滞后计数
+    /// 
+    /// # Safety
+    /// 必须在DMA停止时调用
+    pub unsafe fn reset(&self) {
+        self.state.next.store(0, Ordering::Relaxed);
+        self.lags.store(0, Ordering::Relaxed);
+        self.state.ready.store(0, Ordering::Release);
+    }
+    
+    /// 以可变切片访问整个缓冲区，用于启动前预先填充
+    /// 
+    /// # Safety
+    /// 必须在DMA停止且没有未交还的`DmaHalf`时调用
+    pub unsafe fn as_mut_slice(&self) -> &mut [T] {
+        core::slice::from_raw_parts_mut(self.as_ptr(), N)
+    }
+    
+    /// 创建从外设写满整个缓冲区的循环传输描述符
+    /// 
+    /// 已打开半传输、传输完成和传输错误中断，调用者按需设置数据宽度和优先级后交给`Dma::start_circular`。
+    /// 
+    /// # Arguments
+    /// * `peripheral_addr` - 外设数据寄存器地址
+    pub fn peripheral_to_memory(&self, peripheral_addr: u32) -> DmaTransferDescriptor {
+        DmaTransferDescriptor::peripheral_to_memory(peripheral_addr, self.as_ptr() as u32, N as u16)
+            .with_circular()
+            .with_interrupts(true, true, true)
+    }
+    
+    /// 把一个半区交给CPU（中断上下文调用）
+    /// 
+    /// DMA交出一个半区后立即开始访问另一个半区，
+    /// 若另一个半区仍未被交还，则记为一次滞后。
+    fn hand_over(&self, half: u8) {
+        let other = 1 << (half ^ 1);
+        let prev = self.state.ready.fetch_or(1 << half, Ordering::AcqRel);
+        if prev & other != 0 {
+            self.lags.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+    
+    /// 处理DMA通道中断：半传输交出前一半，传输完成交出后一半
+    /// 
+    /// # Arguments
+    /// * `dma` - 访问该缓冲区的DMA通道
+    pub fn handle_dma_interrupt(&self, dma: Dma) {
+        unsafe {
+            if dma.check_interrupt(DmaInterrupt::TransferError) {
+                // 传输错误会使硬件关闭通道，作为一次滞后上报，由应用决定是否重新start
+                dma.clear_all_interrupts();
+                self.lags.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+            
+            if dma.check_interrupt(DmaInterrupt::HalfTransfer) {
+                dma.clear_interrupt(DmaInterrupt::HalfTransfer);
+                self.hand_over(0);
+            }
+            if dma.check_interrupt(DmaInterrupt::TransferComplete) {
+                dma.clear_interrupt(DmaInterrupt::TransferComplete);
+                self.hand_over(1);
+            }
+        }
+    }
+    
+    /// 取出下一个已交给CPU的半区（零拷贝）
+    /// 
+    /// 同一时刻只能持有一个半区，上一个尚未丢弃时返回`None`（每个半区释放时都会推进交接状态）
+    pub fn take(&self) -> Option<DmaHalf<'_, T>> {
+        if self.state.taken.swap(true, Ordering::Acquire) {
+            return None;
+        }
+        let half = self.state.next.load(Ordering::Relaxed);
+        if self.state.ready.load(Ordering::Acquire) & (1 << half) == 0 {
+            self.state.taken.store(false, Ordering::Release);
+            return None;
+        }
+        
+        let start = half as usize * Self::HALF_LEN;
+        // SAFETY: 该半区已交出且在交还前不会被再次交出，DMA此时正在访问另一个半区
+        let data = unsafe {
+            core::slice::from_raw_parts_mut(self.as_ptr().add(start), Self::HALF_LEN)
+        };
+        
+        Some(DmaHalf {
+            data,
+            half,
+            state: &self.state,
+        })
+    }
+    
+    /// 获取滞后次数
+    pub fn lags(&self) -> u32 {
+        self.lags.load(Ordering::Relaxed)
+    }
+}
+
+/// 交给CPU的DMA半缓冲区
+/// 
+/// 通过`Deref`/`DerefMut`直接访问半区数据，drop时交还给DMA。
+pub struct DmaHalf<'a, T> {
+    data: &'a mut [T],
+    half: u8,
+    state: &'a HalfState,
+}
+
+impl<'a, T> core::ops::Deref for DmaHalf<'a, T> {
+    type Target = [T];
+    
+    fn deref(&self) -> &[T] {
+        self.data
+    }
+}
+
+impl<'a, T> core::ops::DerefMut for DmaHalf<'a, T> {
+    fn deref_mut(&mut self) -> &mut [T] {
+        self.data
+    }
+}
+
+impl<'a, T> Drop for DmaHalf<'a, T> {
+    fn drop(&mut self) {
+        self.state.next.store(self.half ^ 1, Ordering::Relaxed);
+        self.state.ready.fetch_and(!(1 << self.half), Ordering::Release);
+        self.state.taken.store(false, Ordering::Release);
     }
 }
 
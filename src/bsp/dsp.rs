@@ -0,0 +1,33 @@
+//! 定点DSP模块
+//! 提供面向ADC数据块的定点滤波、抽取和统计功能
+//!
+//! 算法本身在`src/dsp`库中（不依赖外设，单元测试在主机上运行：`cargo test-dsp`），
+//! 这里重新导出并提供从`AdcSampler`/`DualAdc`交付的数据块创建跨步视图的函数，
+//! 不需要逐个采样点调用。
+//!
+//! ```ignore
+//! let block = sampler.take_block()?;
+//! filter.process(dsp::channel(&block, 0), &mut out);
+//! ```
+
+// 屏蔽未使用代码警告
+#![allow(unused)]
+
+pub use ::dsp::*;
+
+use crate::bsp::adc::AdcBlock;
+
+/// 获取单ADC数据块中扫描序号为`index`的通道
+pub fn channel<'a>(block: &'a AdcBlock<'_, u16>, index: usize) -> Strided<'a> {
+    Strided::new(block.samples(), index, block.channels())
+}
+
+/// 获取双ADC数据块中ADC1（主）扫描序号为`index`的通道
+pub fn master<'a>(block: &'a AdcBlock<'_, u32>, index: usize) -> Strided<'a> {
+    Strided::new(block.halfwords(), index * 2, block.channels() * 2)
+}
+
+/// 获取双ADC数据块中ADC2（从）扫描序号为`index`的通道
+pub fn slave<'a>(block: &'a AdcBlock<'_, u32>, index: usize) -> Strided<'a> {
+    Strided::new(block.halfwords(), index * 2 + 1, block.channels() * 2)
+}
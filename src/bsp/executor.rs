@@ -0,0 +1,393 @@
+//! 协作式异步执行器模块
+//! 提供静态任务执行器、中断唤醒槽和定时等待
+//! 
+//! 任务是`async`块或`async fn`返回的`Future`，在`main`的栈上固定后交给`run`执行，
+//! 不需要堆分配，最多32个任务。没有任务就绪时执行器通过`idle::idle`
+//! 休眠到最近的定时到期时间或任意中断（按外设活动选择睡眠或停止模式）。
+//! 
+//! 驱动的异步接口遵循同一种模式：轮询硬件标志，未就绪时把当前任务的唤醒器登记到
+//! 驱动的`WakerSlot`并打开对应中断；中断处理函数关闭该中断并唤醒任务，
+//! 任务下一次被轮询时重新检查标志。各驱动的中断入口为`handle_async_interrupt`。
+//! 
+//! ```ignore
+//! use core::pin::pin;
+//! 
+//! async fn blink() {
+//!     loop {
+//!         gpio::PC13.toggle();
+//!         executor::sleep_ms(500).await;
+//!     }
+//! }
+//! 
+//! async fn echo(serial: Serial) {
+//!     loop {
+//!         let byte = serial.read_byte_async().await;
+//!         serial.write_bytes_async(&[byte]).await;
+//!     }
+//! }
+//! 
+//! #[entry]
+//! fn main() -> ! {
+//!     system::init();
+//!     executor::run([pin!(blink()), pin!(echo(Serial::new(SerialPort::USART1)))])
+//! }
+//! 
+//! #[interrupt]
+//! fn USART1() {
+//!     Serial::new(SerialPort::USART1).handle_async_interrupt();
+//! }
+//! ```
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::future::Future;
+use core::pin::Pin;
+use core::sync::atomic::{AtomicU32, Ordering};
+use core::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use crate::bsp::delay;
+use crate::bsp::idle;
+
+/// 最多任务数（就绪集合为32位）
+pub const MAX_TASKS: usize = 32;
+
+/// 最多同时等待的定时器数
+pub const MAX_TIMERS: usize = 8;
+
+/// 就绪任务集合，第i位对应第i个任务
+static READY: AtomicU32 = AtomicU32::new(0);
+
+/// 任务唤醒器的虚函数表，数据指针即任务编号
+static TASK_WAKER_VTABLE: RawWakerVTable = RawWakerVTable::new(
+    task_waker_clone,
+    task_waker_wake,
+    task_waker_wake,
+    task_waker_drop,
+);
+
+unsafe fn task_waker_clone(data: *const ()) -> RawWaker {
+    RawWaker::new(data, &TASK_WAKER_VTABLE)
+}
+
+unsafe fn task_waker_wake(data: *const ()) {
+    READY.fetch_or(1 << (data as usize), Ordering::Release);
+}
+
+unsafe fn task_waker_drop(_data: *const ()) {}
+
+/// 创建第`index`个任务的唤醒器
+fn task_waker(index: usize) -> Waker {
+    unsafe { Waker::from_raw(RawWaker::new(index as *const (), &TASK_WAKER_VTABLE)) }
+}
+
+/// 编译期检查任务数
+struct TaskCountCheck<const N: usize>;
+
+impl<const N: usize> TaskCountCheck<N> {
+    const OK: () = assert!(N > 0 && N <= MAX_TASKS, "executor::run最多支持32个任务");
+}
+
+/// 运行任务，永不返回
+/// 
+/// 所有任务先各轮询一次，之后只轮询被唤醒的任务。
+/// 已完成的任务不再轮询；全部完成后执行器继续休眠并处理中断。
+/// 
+/// # Arguments
+/// * `tasks` - 用`core::pin::pin!`固定的任务
+pub fn run<const N: usize>(mut tasks: [Pin<&mut dyn Future<Output = ()>>; N]) -> ! {
+    let _ = TaskCountCheck::<N>::OK;
+    unsafe { delay::init_systick(delay::system_clock()) };
+    
+    let all = if N == MAX_TASKS { u32::MAX } else { (1u32 << N) - 1 };
+    let mut finished = 0u32;
+    READY.store(all, Ordering::Release);
+    
+    loop {
+        let mut ready = READY.swap(0, Ordering::Acquire) & !finished;
+        while ready != 0 {
+            let index = ready.trailing_zeros() as usize;
+            ready &= ready - 1;
+            
+            let waker = task_waker(index);
+            let mut cx = Context::from_waker(&waker);
+            if tasks[index].as_mut().poll(&mut cx).is_ready() {
+                finished |= 1 << index;
+            }
+        }
+        
+        TIMERS.wake_expired(delay::get_uptime_us());
+        
+        // 关中断后检查就绪集合再休眠：检查之后到达的中断仍会唤醒WFI，
+        // 退出临界区后再执行其处理函数，不会丢失唤醒
+        cortex_m::interrupt::free(|_| {
+            if READY.load(Ordering::Relaxed) & !finished == 0 {
+                let sleep_us = TIMERS.next_deadline().map(|deadline| {
+                    deadline.saturating_sub(delay::get_uptime_us()).min(u32::MAX as u64) as u32
+                });
+                if sleep_us != Some(0) {
+                    unsafe { idle::idle(sleep_us) };
+                }
+            }
+        });
+    }
+}
+
+/// 中断与任务之间的唤醒器槽位
+/// 
+/// 任务在`register`中登记自己的唤醒器，中断处理函数调用`wake`唤醒它。
+/// 每个槽位只保存最近登记的一个唤醒器，同一时刻只应有一个任务等待同一个事件。
+pub struct WakerSlot {
+    waker: UnsafeCell<Option<Waker>>,
+}
+
+/// 实现 Sync trait，内部状态只在临界区内访问
+unsafe impl Sync for WakerSlot {}
+
+impl WakerSlot {
+    /// 用于初始化槽位数组
+    pub const NEW: WakerSlot = WakerSlot::new();
+    
+    /// 创建空槽位
+    pub const fn new() -> Self {
+        Self {
+            waker: UnsafeCell::new(None),
+        }
+    }
+    
+    /// 登记唤醒器
+    pub fn register(&self, waker: &Waker) {
+        cortex_m::interrupt::free(|_| {
+            let slot = unsafe { &mut *self.waker.get() };
+            match slot {
+                Some(current) if current.will_wake(waker) => {}
+                _ => *slot = Some(waker.clone()),
+            }
+        });
+    }
+    
+    /// 唤醒登记的任务并清空槽位
+    pub fn wake(&self) {
+        let waker = cortex_m::interrupt::free(|_| unsafe { (*self.waker.get()).take() });
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+}
+
+/// 等待条件满足的Future，由`wait_for`创建
+pub struct WaitFor<P, A> {
+    poll: P,
+    arm: A,
+}
+
+impl<R, P, A> Future for WaitFor<P, A>
+where
+    P: FnMut() -> Option<R> + Unpin,
+    A: FnMut(&Waker) + Unpin,
+{
+    type Output = R;
+    
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<R> {
+        let this = self.get_mut();
+        if let Some(result) = (this.poll)() {
+            return Poll::Ready(result);
+        }
+        (this.arm)(cx.waker());
+        // 登记后再检查一次，避免条件恰好在登记前满足而中断已经错过
+        match (this.poll)() {
+            Some(result) => Poll::Ready(result),
+            None => Poll::Pending,
+        }
+    }
+}
+
+/// 等待硬件事件
+/// 
+/// # Arguments
+/// * `poll` - 检查事件，发生时返回`Some(结果)`
+/// * `arm` - 未发生时调用：把唤醒器登记到`WakerSlot`并打开对应中断
+pub fn wait_for<R, P, A>(poll: P, arm: A) -> WaitFor<P, A>
+where
+    P: FnMut() -> Option<R> + Unpin,
+    A: FnMut(&Waker) + Unpin,
+{
+    WaitFor { poll, arm }
+}
+
+/// 让出一次执行权，由`yield_now`创建
+pub struct YieldNow {
+    yielded: bool,
+}
+
+impl Future for YieldNow {
+    type Output = ();
+    
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        if self.yielded {
+            Poll::Ready(())
+        } else {
+            self.yielded = true;
+            cx.waker().wake_by_ref();
+            Poll::Pending
+        }
+    }
+}
+
+/// 让出执行权，先运行其他就绪任务
+pub fn yield_now() -> YieldNow {
+    YieldNow { yielded: false }
+}
+
+/// 定时等待表项：到期时间和尚未唤醒的唤醒器
+type TimerEntry = Option<(u64, Option<Waker>)>;
+
+/// 定时等待表
+struct TimerTable {
+    entries: UnsafeCell<[TimerEntry; MAX_TIMERS]>,
+}
+
+/// 实现 Sync trait，内部状态只在临界区内访问
+unsafe impl Sync for TimerTable {}
+
+impl TimerTable {
+    const EMPTY: TimerEntry = None;
+    
+    /// 登记或更新一个等待，返回所在表项
+    fn register(&self, slot: Option<usize>, deadline: u64, waker: &Waker) -> Option<usize> {
+        cortex_m::interrupt::free(|_| {
+            let entries = unsafe { &mut *self.entries.get() };
+            let index = slot.or_else(|| entries.iter().position(|entry| entry.is_none()))?;
+            entries[index] = Some((deadline, Some(waker.clone())));
+            Some(index)
+        })
+    }
+    
+    /// 释放表项
+    fn release(&self, slot: usize) {
+        cortex_m::interrupt::free(|_| unsafe { (*self.entries.get())[slot] = None });
+    }
+    
+    /// 唤醒已到期的等待（只唤醒一次，表项由对应的`Sleep`释放）
+    fn wake_expired(&self, now: u64) {
+        for index in 0..MAX_TIMERS {
+            let waker = cortex_m::interrupt::free(|_| {
+                match unsafe { &mut (*self.entries.get())[index] } {
+                    Some((deadline, waker)) if *deadline <= now => waker.take(),
+                    _ => None,
+                }
+            });
+            if let Some(waker) = waker {
+                waker.wake();
+            }
+        }
+    }
+    
+    /// 最近的未唤醒到期时间
+    fn next_deadline(&self) -> Option<u64> {
+        cortex_m::interrupt::free(|_| {
+            let entries = unsafe { &*self.entries.get() };
+            entries
+                .iter()
+                .filter_map(|entry| match entry {
+                    Some((deadline, Some(_))) => Some(*deadline),
+                    _ => None,
+                })
+                .min()
+        })
+    }
+}
+
+static TIMERS: TimerTable = TimerTable {
+    entries: UnsafeCell::new([TimerTable::EMPTY; MAX_TIMERS]),
+};
+
+/// 定时等待，由`sleep_us`/`sleep_ms`/`sleep_until`创建
+/// 
+/// 同时等待的数量超过`MAX_TIMERS`时退化为每轮让出一次执行权，仍能按时完成但不能休眠。
+pub struct Sleep {
+    deadline: u64,
+    slot: Option<usize>,
+}
+
+impl Future for Sleep {
+    type Output = ();
+    
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        if delay::get_uptime_us() >= self.deadline {
+            if let Some(slot) = self.slot.take() {
+                TIMERS.release(slot);
+            }
+            return Poll::Ready(());
+        }
+        
+        self.slot = TIMERS.register(self.slot, self.deadline, cx.waker());
+        if self.slot.is_none() {
+            cx.waker().wake_by_ref();
+        }
+        Poll::Pending
+    }
+}
+
+impl Drop for Sleep {
+    fn drop(&mut self) {
+        if let Some(slot) = self.slot.take() {
+            TIMERS.release(slot);
+        }
+    }
+}
+
+/// 等待到指定的运行时间（`delay::get_uptime_us`）
+pub fn sleep_until(deadline_us: u64) -> Sleep {
+    Sleep {
+        deadline: deadline_us,
+        slot: None,
+    }
+}
+
+/// 等待指定的微秒数
+pub fn sleep_us(us: u32) -> Sleep {
+    sleep_until(delay::get_uptime_us() + us as u64)
+}
+
+/// 等待指定的毫秒数
+pub fn sleep_ms(ms: u32) -> Sleep {
+    sleep_until(delay::get_uptime_us() + ms as u64 * 1000)
+}
+
+/// 带超时的等待，由`with_timeout`创建
+pub struct Timeout<F> {
+    future: F,
+    sleep: Sleep,
+}
+
+impl<F: Future> Future for Timeout<F> {
+    type Output = Option<F::Output>;
+    
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<F::Output>> {
+        // 不移动任何字段，`future`保持固定
+        let this = unsafe { self.get_unchecked_mut() };
+        let future = unsafe { Pin::new_unchecked(&mut this.future) };
+        if let Poll::Ready(output) = future.poll(cx) {
+            return Poll::Ready(Some(output));
+        }
+        match Pin::new(&mut this.sleep).poll(cx) {
+            Poll::Ready(()) => Poll::Ready(None),
+            Poll::Pending => Poll::Pending,
+        }
+    }
+}
+
+/// 为一个等待加上超时
+/// 
+/// # Arguments
+/// * `timeout_us` - 超时时间，单位：微秒
+/// * `future` - 被等待的操作
+/// 
+/// # Returns
+/// 超时返回`None`，此时`future`被丢弃，调用者负责把硬件恢复到空闲状态
+pub fn with_timeout<F: Future>(timeout_us: u32, future: F) -> Timeout<F> {
+    Timeout {
+        future,
+        sleep: sleep_us(timeout_us),
+    }
+}
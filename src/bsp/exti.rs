@@ -1,10 +1,13 @@
 ﻿//! EXTI模块
-//! 提供外部中断功能封装
+//! 提供外部中断功能封装，以及按线注册回调的中断分发表和基于硬件定时器的消抖
 
 #![allow(unused)]
 
+use core::cell::UnsafeCell;
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::gpio::GpioPort;
+use crate::bsp::timer::{SoftTimerCallback, SoftTimerError, SoftTimerId, SoftTimerQueue};
 
 /// EXTI线枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -31,6 +34,56 @@ pub enum ExtiLine {
     Line19 = 19, // ETH唤醒事件
 }
 
+/// EXTI线数量
+pub const EXTI_LINES: usize = 20;
+
+impl ExtiLine {
+    /// 由线号获取EXTI线
+    pub const fn from_index(index: u8) -> Option<Self> {
+        match index {
+            0 => Some(ExtiLine::Line0),
+            1 => Some(ExtiLine::Line1),
+            2 => Some(ExtiLine::Line2),
+            3 => Some(ExtiLine::Line3),
+            4 => Some(ExtiLine::Line4),
+            5 => Some(ExtiLine::Line5),
+            6 => Some(ExtiLine::Line6),
+            7 => Some(ExtiLine::Line7),
+            8 => Some(ExtiLine::Line8),
+            9 => Some(ExtiLine::Line9),
+            10 => Some(ExtiLine::Line10),
+            11 => Some(ExtiLine::Line11),
+            12 => Some(ExtiLine::Line12),
+            13 => Some(ExtiLine::Line13),
+            14 => Some(ExtiLine::Line14),
+            15 => Some(ExtiLine::Line15),
+            16 => Some(ExtiLine::Line16),
+            17 => Some(ExtiLine::Line17),
+            18 => Some(ExtiLine::Line18),
+            19 => Some(ExtiLine::Line19),
+            _ => None,
+        }
+    }
+    
+    /// 获取该线对应的NVIC中断号
+    /// 
+    /// 线5~9、线10~15分别共用一个中断向量；设备库中没有线18、19的中断向量，返回`None`
+    pub const fn interrupt(self) -> Option<Interrupt> {
+        match self as u8 {
+            0 => Some(Interrupt::EXTI0),
+            1 => Some(Interrupt::EXTI1),
+            2 => Some(Interrupt::EXTI2),
+            3 => Some(Interrupt::EXTI3),
+            4 => Some(Interrupt::EXTI4),
+            5..=9 => Some(Interrupt::EXTI9_5),
+            10..=15 => Some(Interrupt::EXTI15_10),
+            16 => Some(Interrupt::PVD),
+            17 => Some(Interrupt::RTCAlarm),
+            _ => None,
+        }
+    }
+}
+
 /// EXTI触发模式枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum ExtiTriggerMode {
@@ -213,7 +266,345 @@ impl Exti {
         // 写入1到所有位来清除中断标志
         exti.pr().write(|w: &mut library::exti::pr::W| unsafe { w.bits(0x00FFFFFF) });
     }
+    
+    /// 读取全部挂起位
+    pub unsafe fn read_pending(&self) -> u32 {
+        self.exti().pr().read().bits()
+    }
+    
+    /// 一次写入清除`mask`中的全部挂起位
+    pub unsafe fn clear_pending_mask(&self, mask: u32) {
+        self.exti().pr().write(|w: &mut library::exti::pr::W| unsafe { w.bits(mask) });
+    }
+    
+    /// 读取中断屏蔽寄存器
+    pub unsafe fn read_interrupt_mask(&self) -> u32 {
+        self.exti().imr().read().bits()
+    }
 }
 
 /// 预定义的EXTI实例
 pub const EXTI: Exti = Exti::new();
+
+/// EXTI分发错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ExtiError {
+    /// 线号超出范围（GPIO线为0~15）
+    InvalidLine,
+    /// 要求消抖但尚未设置消抖定时器
+    NoDebounceTimer,
+}
+
+/// EXTI回调，参数为（线号, 引脚电平, 注册时传入的上下文值）
+/// 
+/// 不消抖时在EXTI中断中执行，消抖时在消抖定时器的中断中执行，应保持简短。
+/// 非GPIO线的电平参数固定为`true`。
+pub type ExtiCallback = fn(u8, bool, usize);
+
+/// 消抖使用的定时器，已为任意槽位数的`SoftTimerQueue`实现
+pub trait DebounceTimer: Sync {
+    /// 注册单次定时器
+    fn after(&self, delay: u32, callback: SoftTimerCallback, context: usize) -> Result<SoftTimerId, SoftTimerError>;
+}
+
+impl<const N: usize> DebounceTimer for SoftTimerQueue<N> {
+    fn after(&self, delay: u32, callback: SoftTimerCallback, context: usize) -> Result<SoftTimerId, SoftTimerError> {
+        SoftTimerQueue::after(self, delay, callback, context)
+    }
+}
+
+/// 分发表中一条线的登记项
+#[derive(Clone, Copy)]
+struct ExtiHandler {
+    callback: Option<ExtiCallback>,
+    context: usize,
+    /// GPIO线所在端口，非GPIO线为`None`
+    port: Option<GpioPort>,
+    trigger: ExtiTriggerMode,
+    /// 消抖时间（消抖定时器的计数值），0表示不消抖
+    debounce: u32,
+    /// 最近一次确认的稳定电平
+    stable: bool,
+}
+
+impl ExtiHandler {
+    const EMPTY: Self = Self {
+        callback: None,
+        context: 0,
+        port: None,
+        trigger: ExtiTriggerMode::None,
+        debounce: 0,
+        stable: false,
+    };
+    
+    /// 读取引脚电平（GPIOx_IDR），非GPIO线返回`true`
+    unsafe fn level(&self, line: u8) -> bool {
+        match self.port {
+            Some(port) => {
+                let idr = (0x4001_0808 + port as u32 * 0x400) as *const u32;
+                (core::ptr::read_volatile(idr) & (1 << line)) != 0
+            }
+            None => true,
+        }
+    }
+    
+    /// 消抖结束时读到的电平是否应当报告
+    /// 
+    /// 单边沿触发时看电平是否停在触发方向上；双边沿触发时看稳定电平是否改变
+    fn accepts(&self, level: bool) -> bool {
+        match self.trigger {
+            ExtiTriggerMode::Rising => level,
+            ExtiTriggerMode::Falling => !level,
+            _ => level != self.stable,
+        }
+    }
+}
+
+/// EXTI中断分发表
+/// 
+/// 每条线登记一个回调，各EXTI中断处理函数只需调用`handle_interrupt`：
+/// 一次读出本向量负责的全部挂起位，用一次写入全部清除，再按位（RBIT+CLZ）
+/// 逐个分发，开销只与实际挂起的线数有关。
+/// 
+/// 消抖：第一次边沿到来后立即屏蔽该线并启动一个单次软件定时器，
+/// 抖动期间的边沿只会置位挂起位而不产生中断；定时器到期后清除挂起位、读取电平，
+/// 电平有效才调用回调，最后解除屏蔽。中断处理函数中不做任何等待。
+/// 
+/// ```ignore
+/// static TIMERS: SoftTimerQueue<8> = SoftTimerQueue::new(TimerNumber::TIM2);
+/// 
+/// fn on_button(line: u8, level: bool, _context: usize) { /* ... */ }
+/// 
+/// TIMERS.start(1_000_000)?; // 以微秒计数
+/// EXTI_DISPATCHER.set_debounce_timer(&TIMERS);
+/// // PA0按键（已配置为上拉输入），下降沿触发，消抖5ms
+/// EXTI_DISPATCHER.register_pin(GpioPort::A, 0, ExtiTriggerMode::Falling, 5_000, on_button, 0)?;
+/// 
+/// #[interrupt]
+/// fn EXTI0() {
+///     unsafe { EXTI_DISPATCHER.handle_interrupt(Interrupt::EXTI0) };
+/// }
+/// 
+/// #[interrupt]
+/// fn TIM2() {
+///     TIMERS.handle_interrupt();
+/// }
+/// ```
+/// 
+/// 还需在NVIC中使能用到的EXTI中断（`ExtiLine::interrupt`给出中断号）和定时器中断。
+pub struct ExtiDispatcher {
+    handlers: UnsafeCell<[ExtiHandler; EXTI_LINES]>,
+    timer: UnsafeCell<Option<&'static dyn DebounceTimer>>,
+}
+
+/// 实现 Sync trait，内部状态只在临界区内访问
+unsafe impl Sync for ExtiDispatcher {}
+
+impl ExtiDispatcher {
+    /// 创建空的分发表
+    /// 
+    /// EXTI线只有一组，消抖回调固定转发到`EXTI_DISPATCHER`，因此只允许这一个实例
+    const fn new() -> Self {
+        Self {
+            handlers: UnsafeCell::new([ExtiHandler::EMPTY; EXTI_LINES]),
+            timer: UnsafeCell::new(None),
+        }
+    }
+    
+    /// 设置消抖定时器（需已启动）
+    pub fn set_debounce_timer(&self, timer: &'static dyn DebounceTimer) {
+        cortex_m::interrupt::free(|_| unsafe { *self.timer.get() = Some(timer) });
+    }
+    
+    /// 登记GPIO引脚的回调，并配置AFIO端口选择、触发方式和中断屏蔽
+    /// 
+    /// # Arguments
+    /// * `port` - 引脚所在端口（同一线号只能选择一个端口）
+    /// * `pin` - 引脚号0~15，即EXTI线号
+    /// * `trigger` - 触发方式
+    /// * `debounce` - 消抖时间（消抖定时器的计数值），0表示不消抖
+    /// * `callback` - 回调函数
+    /// * `context` - 传给回调的上下文值
+    /// 
+    /// # Safety
+    /// 引脚必须已配置为输入；修改AFIO和EXTI寄存器
+    pub unsafe fn register_pin(
+        &self,
+        port: GpioPort,
+        pin: u8,
+        trigger: ExtiTriggerMode,
+        debounce: u32,
+        callback: ExtiCallback,
+        context: usize,
+    ) -> Result<(), ExtiError> {
+        let line = match ExtiLine::from_index(pin) {
+            Some(line) if pin < 16 => line,
+            _ => return Err(ExtiError::InvalidLine),
+        };
+        if debounce > 0 && (*self.timer.get()).is_none() {
+            return Err(ExtiError::NoDebounceTimer);
+        }
+        EXTI.disable_interrupt(line);
+        
+        cortex_m::interrupt::free(|_| {
+            // AFIO时钟（RCC_APB2ENR.AFIOEN）
+            let apb2enr = 0x4002_1018 as *mut u32;
+            core::ptr::write_volatile(apb2enr, core::ptr::read_volatile(apb2enr) | 1);
+            
+            // AFIO_EXTICRx：每条线4位端口选择
+            let exticr = (0x4001_0008 + (pin as u32 / 4) * 4) as *mut u32;
+            let shift = (pin as u32 % 4) * 4;
+            let value = core::ptr::read_volatile(exticr) & !(0xF << shift);
+            core::ptr::write_volatile(exticr, value | ((port as u32) << shift));
+            
+            let mut handler = ExtiHandler {
+                callback: Some(callback),
+                context,
+                port: Some(port),
+                trigger,
+                debounce,
+                stable: false,
+            };
+            handler.stable = handler.level(pin);
+            (*self.handlers.get())[pin as usize] = handler;
+        });
+        
+        EXTI.clear_pending(line);
+        EXTI.init(line, trigger, true);
+        Ok(())
+    }
+    
+    /// 登记非GPIO线（PVD、RTC闹钟等）的回调，不消抖
+    /// 
+    /// # Safety
+    /// 修改EXTI寄存器
+    pub unsafe fn register_line(&self, line: ExtiLine, trigger: ExtiTriggerMode, callback: ExtiCallback, context: usize) {
+        EXTI.disable_interrupt(line);
+        cortex_m::interrupt::free(|_| {
+            (*self.handlers.get())[line as usize] = ExtiHandler {
+                callback: Some(callback),
+                context,
+                trigger,
+                ..ExtiHandler::EMPTY
+            };
+        });
+        EXTI.clear_pending(line);
+        EXTI.init(line, trigger, true);
+    }
+    
+    /// 注销回调并屏蔽该线中断
+    /// 
+    /// # Safety
+    /// 修改EXTI寄存器
+    pub unsafe fn unregister(&self, line: ExtiLine) {
+        cortex_m::interrupt::free(|_| {
+            EXTI.disable_interrupt(line);
+            (*self.handlers.get())[line as usize] = ExtiHandler::EMPTY;
+        });
+        EXTI.clear_pending(line);
+    }
+    
+    /// 获取中断向量负责的EXTI线掩码
+    pub const fn vector_lines(irq: Interrupt) -> u32 {
+        match irq {
+            Interrupt::EXTI0 => 1 << 0,
+            Interrupt::EXTI1 => 1 << 1,
+            Interrupt::EXTI2 => 1 << 2,
+            Interrupt::EXTI3 => 1 << 3,
+            Interrupt::EXTI4 => 1 << 4,
+            Interrupt::EXTI9_5 => 0x0000_03E0,
+            Interrupt::EXTI15_10 => 0x0000_FC00,
+            Interrupt::PVD => 1 << 16,
+            Interrupt::RTCAlarm => 1 << 17,
+            _ => 0,
+        }
+    }
+    
+    /// EXTI中断处理函数，在各EXTI中断中调用
+    /// 
+    /// # Arguments
+    /// * `irq` - 当前中断向量
+    /// 
+    /// # Safety
+    /// 访问EXTI寄存器
+    pub unsafe fn handle_interrupt(&self, irq: Interrupt) {
+        self.dispatch(Self::vector_lines(irq));
+    }
+    
+    /// 分发`lines`中已挂起且未屏蔽的线
+    /// 
+    /// # Safety
+    /// 访问EXTI寄存器
+    pub unsafe fn dispatch(&self, lines: u32) {
+        let pending = EXTI.read_pending() & EXTI.read_interrupt_mask() & lines;
+        if pending == 0 {
+            return;
+        }
+        EXTI.clear_pending_mask(pending);
+        
+        let mut bits = pending;
+        while bits != 0 {
+            let line = bits.trailing_zeros() as u8;
+            bits &= bits - 1;
+            self.fire(line);
+        }
+    }
+    
+    /// 处理一条线的触发
+    unsafe fn fire(&self, line: u8) {
+        let handler = cortex_m::interrupt::free(|_| (*self.handlers.get())[line as usize]);
+        let callback = match handler.callback {
+            Some(callback) => callback,
+            None => return,
+        };
+        
+        if handler.debounce > 0 {
+            let line_id = match ExtiLine::from_index(line) {
+                Some(line_id) => line_id,
+                None => return,
+            };
+            // 屏蔽该线，抖动期间只置位挂起位，到期后统一处理
+            cortex_m::interrupt::free(|_| EXTI.disable_interrupt(line_id));
+            let scheduled = match *self.timer.get() {
+                Some(timer) => timer.after(handler.debounce, debounce_expired, line as usize).is_ok(),
+                None => false,
+            };
+            if scheduled {
+                return;
+            }
+            // 定时器槽已满时退化为不消抖
+            cortex_m::interrupt::free(|_| EXTI.enable_interrupt(line_id));
+        }
+        callback(line, handler.level(line), handler.context);
+    }
+    
+    /// 消抖定时器到期：清除抖动留下的挂起位，确认电平后回调并解除屏蔽
+    unsafe fn finish_debounce(&self, line: u8) {
+        let line_id = match ExtiLine::from_index(line) {
+            Some(line_id) => line_id,
+            None => return,
+        };
+        // 先清挂起位再读电平：之后出现的新边沿会在解除屏蔽后重新触发
+        EXTI.clear_pending(line_id);
+        let result = cortex_m::interrupt::free(|_| {
+            let handler = &mut (*self.handlers.get())[line as usize];
+            let callback = handler.callback?;
+            let level = handler.level(line);
+            let report = handler.accepts(level);
+            handler.stable = level;
+            EXTI.enable_interrupt(line_id);
+            Some((callback, level, report, handler.context))
+        });
+        if let Some((callback, level, true, context)) = result {
+            callback(line, level, context);
+        }
+    }
+}
+
+/// 消抖定时器回调，上下文值为线号
+fn debounce_expired(context: usize) {
+    unsafe { EXTI_DISPATCHER.finish_debounce(context as u8) };
+}
+
+/// 全局EXTI分发表
+pub static EXTI_DISPATCHER: ExtiDispatcher = ExtiDispatcher::new();
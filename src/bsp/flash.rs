@@ -5,11 +5,201 @@
 
 // 使用内部生成的设备驱动库
 use library::*;
+use crate::bsp::crc::CRC;
+use core::arch::asm;
 
 // 闪存密钥
 const FLASH_KEY1: u32 = 0x45670123;
 const FLASH_KEY2: u32 = 0xCDEF89AB;
 
+/// 主存储区起始地址
+pub const FLASH_BASE: u32 = 0x0800_0000;
+
+// 页大小由器件容量特性决定，同时启用多个容量特性时无法确定（默认特性已含`stm32f10x-md`，
+// 选其他容量需要`--no-default-features`）
+#[cfg(any(
+    all(feature = "stm32f10x-ld", any(feature = "stm32f10x-md", feature = "stm32f10x-hd", feature = "stm32f10x-xl", feature = "stm32f10x-cl")),
+    all(feature = "stm32f10x-md", any(feature = "stm32f10x-hd", feature = "stm32f10x-xl", feature = "stm32f10x-cl")),
+    all(feature = "stm32f10x-hd", any(feature = "stm32f10x-xl", feature = "stm32f10x-cl")),
+    all(feature = "stm32f10x-xl", feature = "stm32f10x-cl"),
+))]
+compile_error!("只能启用一个stm32f10x-*器件容量特性，选择md以外的容量时请加`--no-default-features`");
+
+/// 页大小：小/中容量器件（如STM32F103C8T6）为1KB
+#[cfg(not(any(feature = "stm32f10x-hd", feature = "stm32f10x-xl", feature = "stm32f10x-cl")))]
+pub const FLASH_PAGE_SIZE: u32 = 1024;
+
+/// 页大小：大容量、超大容量和互联型器件为2KB（由`stm32f10x-hd/xl/cl`特性选择）
+#[cfg(any(feature = "stm32f10x-hd", feature = "stm32f10x-xl", feature = "stm32f10x-cl"))]
+pub const FLASH_PAGE_SIZE: u32 = 2048;
+
+/// 擦除后的半字值
+pub const FLASH_ERASED_HALF_WORD: u16 = 0xFFFF;
+
+// FLASH_SR位
+const SR_BSY: u32 = 1 << 0;
+const SR_PGERR: u32 = 1 << 2;
+const SR_WRPRTERR: u32 = 1 << 4;
+const SR_EOP: u32 = 1 << 5;
+
+// FLASH_CR位
+const CR_PG: u32 = 1 << 0;
+const CR_PER: u32 = 1 << 1;
+const CR_STRT: u32 = 1 << 6;
+const CR_LOCK: u32 = 1 << 7;
+
+/// FLASH_SR寄存器地址（RAM中的编程循环直接访问）
+const FLASH_SR_ADDR: u32 = 0x4002_200C;
+/// FLASH_CR寄存器地址
+const FLASH_CR_ADDR: u32 = 0x4002_2010;
+
+/// 批量编程时每批校验的字节数（一页）
+const PROGRAM_BATCH: usize = FLASH_PAGE_SIZE as usize;
+
+/// 批量编程统计
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct FlashProgramStats {
+    /// 实际编程的半字数
+    pub programmed: u32,
+    /// 内容已经相同（包括写入0xFFFF到擦除状态）而跳过的半字数
+    pub skipped: u32,
+}
+
+/// RAM中读取32位寄存器
+/// 
+/// 位于`.ramfunc`段，只在`program_block_ram`中使用
+/// 
+/// 用内联汇编代替`read_volatile`：opt-level 0时`read_volatile`不会被内联，是对FLASH中函数的调用
+#[inline(always)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn ram_read32(addr: u32) -> u32 {
+    let value: u32;
+    asm!("ldr {0}, [{1}]", out(reg) value, in(reg) addr, options(nostack, preserves_flags, readonly));
+    value
+}
+
+/// RAM中写入32位寄存器
+/// 
+/// 位于`.ramfunc`段，只在`program_block_ram`中使用
+#[inline(always)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn ram_write32(addr: u32, value: u32) {
+    asm!("str {0}, [{1}]", in(reg) value, in(reg) addr, options(nostack, preserves_flags));
+}
+
+/// RAM中读取半字
+/// 
+/// 位于`.ramfunc`段，只在`program_block_ram`中使用
+#[inline(always)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn ram_read16(addr: u32) -> u16 {
+    let value: u32;
+    asm!("ldrh {0}, [{1}]", out(reg) value, in(reg) addr, options(nostack, preserves_flags, readonly));
+    value as u16
+}
+
+/// RAM中写入半字
+/// 
+/// 位于`.ramfunc`段，只在`program_block_ram`中使用
+#[inline(always)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn ram_write16(addr: u32, value: u16) {
+    asm!("strh {0}, [{1}]", in(reg) value as u32, in(reg) addr, options(nostack, preserves_flags));
+}
+
+/// RAM中读取字节
+/// 
+/// 位于`.ramfunc`段，只在`program_block_ram`中使用
+#[inline(always)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn ram_read8(addr: u32) -> u8 {
+    let value: u32;
+    asm!("ldrb {0}, [{1}]", out(reg) value, in(reg) addr, options(nostack, preserves_flags, readonly));
+    value as u8
+}
+
+/// 在RAM中执行的编程循环
+/// 
+/// 放在`.ramfunc`段由启动代码随`.data`复制到RAM：编程期间从FLASH取指会被暂停，
+/// 在RAM中执行时两次写入之间的BSY轮询不受等待周期影响。
+/// 
+/// 与优化等级无关地不调用FLASH中的代码：寄存器和存储器访问通过上面的`#[inline(always)]`汇编辅助函数
+/// （它们同样放在`.ramfunc`段），源数据以地址和长度传入避免切片边界检查，计数使用`wrapping_add`没有溢出检查。
+/// 
+/// # Arguments
+/// * `address` - 半字对齐的目标地址
+/// * `src` - 源数据地址
+/// * `len` - 源数据字节数
+/// 
+/// # Returns
+/// 成功返回（编程的半字数, 跳过的半字数）
+#[inline(never)]
+#[link_section = ".ramfunc.flash_program"]
+unsafe fn program_block_ram(address: u32, src: u32, len: u32) -> Result<(u32, u32), FlashError> {
+    ram_write32(FLASH_SR_ADDR, SR_EOP | SR_PGERR | SR_WRPRTERR);
+    ram_write32(FLASH_CR_ADDR, ram_read32(FLASH_CR_ADDR) | CR_PG);
+    
+    let mut error = None;
+    let mut programmed: u32 = 0;
+    let mut skipped: u32 = 0;
+    let mut dst = address;
+    let mut i: u32 = 0;
+    while i < len {
+        let low = ram_read8(src.wrapping_add(i));
+        let high = if i.wrapping_add(1) < len { ram_read8(src.wrapping_add(i).wrapping_add(1)) } else { 0xFF };
+        let value = low as u16 | (high as u16) << 8;
+        let current = ram_read16(dst);
+        
+        if current == value {
+            skipped = skipped.wrapping_add(1);
+        } else if current != FLASH_ERASED_HALF_WORD {
+            // 目标未擦除，硬件也会报PGERR，提前退出避免写入
+            error = Some(FlashError::ProgramError);
+            break;
+        } else {
+            ram_write16(dst, value);
+            let mut status = ram_read32(FLASH_SR_ADDR);
+            while (status & SR_BSY) != 0 {
+                status = ram_read32(FLASH_SR_ADDR);
+            }
+            if (status & SR_WRPRTERR) != 0 {
+                error = Some(FlashError::WriteProtected);
+                break;
+            }
+            if (status & SR_PGERR) != 0 {
+                error = Some(FlashError::ProgramError);
+                break;
+            }
+            programmed = programmed.wrapping_add(1);
+        }
+        
+        dst = dst.wrapping_add(2);
+        i = i.wrapping_add(2);
+    }
+    
+    ram_write32(FLASH_CR_ADDR, ram_read32(FLASH_CR_ADDR) & !CR_PG);
+    ram_write32(FLASH_SR_ADDR, SR_EOP | SR_PGERR | SR_WRPRTERR);
+    match error {
+        Some(err) => Err(err),
+        None => Ok((programmed, skipped)),
+    }
+}
+
+/// FLASH操作错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum FlashError {
+    /// 编程错误（目标地址未擦除）
+    ProgramError,
+    /// 写保护错误
+    WriteProtected,
+    /// 写入后读回不一致
+    VerifyFailed,
+    /// 地址未对齐或超出主存储区
+    InvalidAddress,
+    /// FLASH仍处于锁定状态
+    Locked,
+}
+
 /// FLASH擦除类型枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum FlashEraseType {
@@ -130,6 +320,99 @@ impl FlashDriver {
         flash.cr().write(|w: &mut library::flash::cr::W| unsafe { w.bits(flash.cr().read().bits() & !(1 << 1)) });
     }
     
+    /// 检查FLASH控制寄存器是否锁定
+    pub unsafe fn is_locked(&self) -> bool {
+        (self.get_flash().cr().read().bits() & CR_LOCK) != 0
+    }
+    
+    /// 等待当前操作结束并检查结果（写1清除状态标志）
+    unsafe fn wait_done(&self) -> Result<(), FlashError> {
+        let flash = self.get_flash();
+        let mut sr = flash.sr().read().bits();
+        while (sr & SR_BSY) != 0 {
+            sr = flash.sr().read().bits();
+        }
+        flash.sr().write(|w: &mut library::flash::sr::W| unsafe { w.bits(SR_EOP | SR_PGERR | SR_WRPRTERR) });
+        
+        if (sr & SR_WRPRTERR) != 0 {
+            Err(FlashError::WriteProtected)
+        } else if (sr & SR_PGERR) != 0 {
+            Err(FlashError::ProgramError)
+        } else {
+            Ok(())
+        }
+    }
+    
+    /// 擦除一页（STM32F1按页擦除）
+    /// 
+    /// # Arguments
+    /// * `address` - 页内任意地址
+    /// 
+    /// # Returns
+    /// 成功返回`Ok(())`，失败返回错误类型；擦除后逐字检查是否全部为0xFF
+    /// 
+    /// # Safety
+    /// 需要先调用`unlock`；擦除期间从FLASH取指会被暂停
+    pub unsafe fn erase_page(&self, address: u32) -> Result<(), FlashError> {
+        if address < FLASH_BASE {
+            return Err(FlashError::InvalidAddress);
+        }
+        if self.is_locked() {
+            return Err(FlashError::Locked);
+        }
+        
+        let flash = self.get_flash();
+        self.wait_done()?;
+        
+        flash.cr().modify(|r, w: &mut library::flash::cr::W| unsafe { w.bits(r.bits() | CR_PER) });
+        flash.ar().write(|w: &mut library::flash::ar::W| unsafe { w.bits(address) });
+        flash.cr().modify(|r, w: &mut library::flash::cr::W| unsafe { w.bits(r.bits() | CR_STRT) });
+        let result = self.wait_done();
+        flash.cr().modify(|r, w: &mut library::flash::cr::W| unsafe { w.bits(r.bits() & !CR_PER) });
+        result?;
+        
+        let page = address & !(FLASH_PAGE_SIZE - 1);
+        for offset in (0..FLASH_PAGE_SIZE).step_by(4) {
+            if core::ptr::read_volatile((page + offset) as *const u32) != 0xFFFF_FFFF {
+                return Err(FlashError::VerifyFailed);
+            }
+        }
+        Ok(())
+    }
+    
+    /// 编程一个半字并检查结果
+    /// 
+    /// 与`write_half_word`不同，本函数检查PGERR/WRPRTERR并读回校验。
+    /// 
+    /// # Arguments
+    /// * `address` - 半字对齐的目标地址，必须处于擦除状态（0xFFFF）
+    /// * `data` - 要写入的数据
+    /// 
+    /// # Safety
+    /// 需要先调用`unlock`
+    pub unsafe fn program_half_word(&self, address: u32, data: u16) -> Result<(), FlashError> {
+        if address < FLASH_BASE || (address & 1) != 0 {
+            return Err(FlashError::InvalidAddress);
+        }
+        if self.is_locked() {
+            return Err(FlashError::Locked);
+        }
+        
+        let flash = self.get_flash();
+        self.wait_done()?;
+        
+        flash.cr().modify(|r, w: &mut library::flash::cr::W| unsafe { w.bits(r.bits() | CR_PG) });
+        core::ptr::write_volatile(address as *mut u16, data);
+        let result = self.wait_done();
+        flash.cr().modify(|r, w: &mut library::flash::cr::W| unsafe { w.bits(r.bits() & !CR_PG) });
+        result?;
+        
+        if core::ptr::read_volatile(address as *const u16) != data {
+            return Err(FlashError::VerifyFailed);
+        }
+        Ok(())
+    }
+    
     /// 整片擦除FLASH
     pub unsafe fn mass_erase(&self) {
         let flash = self.get_flash();
@@ -185,37 +468,91 @@ impl FlashDriver {
         self.write_half_word(address + 2, data as u16);
     }
     
-    /// 写入数据到FLASH
-    pub unsafe fn write_data(&self, address: u32, data: &[u8]) {
-        let mut addr = address;
-        let mut i = 0;
+    /// 擦除覆盖`[address, address + len)`的所有页
+    /// 
+    /// # Safety
+    /// 需要先调用`unlock`，范围不能包含正在运行的程序
+    pub unsafe fn erase_range(&self, address: u32, len: u32) -> Result<(), FlashError> {
+        if len == 0 {
+            return Ok(());
+        }
+        let first = address & !(FLASH_PAGE_SIZE - 1);
+        let last = (address + len - 1) & !(FLASH_PAGE_SIZE - 1);
+        let mut page = first;
+        while page <= last {
+            self.erase_page(page)?;
+            page += FLASH_PAGE_SIZE;
+        }
+        Ok(())
+    }
+    
+    /// 批量编程（按内存顺序写入字节，小端半字）
+    /// 
+    /// 只解锁一次，编程循环在RAM中执行并紧密轮询BSY；目标内容已经等于数据的半字
+    /// （包括擦除状态下写入0xFFFF）直接跳过。每写完一页用硬件CRC比较FLASH与源数据，
+    /// 比逐半字读回校验少一半总线访问。奇数长度的最后一个字节与0xFF组成半字写入。
+    /// 
+    /// # Arguments
+    /// * `address` - 半字对齐的起始地址
+    /// * `data` - 要写入的数据，目标区域必须已擦除（或已包含相同内容）
+    /// 
+    /// # Returns
+    /// 成功返回编程/跳过的半字数；目标未擦除返回`ProgramError`，校验失败返回`VerifyFailed`
+    /// 
+    /// # Safety
+    /// 使用硬件CRC单元；目标区域不能包含正在运行的程序。函数结束时恢复调用前的锁定状态
+    pub unsafe fn program(&self, address: u32, data: &[u8]) -> Result<FlashProgramStats, FlashError> {
+        if address < FLASH_BASE || (address & 1) != 0 {
+            return Err(FlashError::InvalidAddress);
+        }
         
-        // 对齐地址
-        if (addr % 2) != 0 {
-            // 写入单个字节
-            let byte = data[0];
-            let current_data = *(addr as *mut u8);
-            let half_word = (current_data as u16) | ((byte as u16) << 8);
-            self.write_half_word(addr & !1, half_word);
-            addr += 1;
-            i = 1;
+        CRC.init();
+        let was_locked = self.is_locked();
+        if was_locked {
+            self.unlock();
         }
+        self.wait_done()?;
         
-        // 写入半字数据
-        while i < data.len() - 1 {
-            let half_word = ((data[i] as u16) << 8) | (data[i + 1] as u16);
-            self.write_half_word(addr, half_word);
-            addr += 2;
-            i += 2;
+        let mut stats = FlashProgramStats::default();
+        let mut result = Ok(());
+        let mut addr = address;
+        for chunk in data.chunks(PROGRAM_BATCH) {
+            match program_block_ram(addr, chunk.as_ptr() as u32, chunk.len() as u32) {
+                Ok((programmed, skipped)) => {
+                    stats.programmed += programmed;
+                    stats.skipped += skipped;
+                },
+                Err(err) => {
+                    result = Err(err);
+                    break;
+                },
+            }
+            
+            let written = core::slice::from_raw_parts(addr as *const u8, chunk.len());
+            if CRC.calculate_block(written) != CRC.calculate_block(chunk) {
+                result = Err(FlashError::VerifyFailed);
+                break;
+            }
+            addr += chunk.len() as u32;
         }
         
-        // 写入剩余字节
-        if i < data.len() {
-            let byte = data[i];
-            let current_data = *((addr + 1) as *mut u8);
-            let half_word = (byte as u16) | ((current_data as u16) << 8);
-            self.write_half_word(addr, half_word);
+        if was_locked {
+            self.lock();
         }
+        result.map(|_| stats)
+    }
+    
+    /// 写入数据到FLASH
+    /// 
+    /// 保留用于兼容，等同于`program`：按内存顺序写入小端半字，检查编程错误并用CRC校验
+    /// 
+    /// # Returns
+    /// 见`program`；起始地址不是半字对齐时返回`InvalidAddress`，空数据直接成功
+    /// 
+    /// # Safety
+    /// 与`program`相同
+    pub unsafe fn write_data(&self, address: u32, data: &[u8]) -> Result<FlashProgramStats, FlashError> {
+        self.program(address, data)
     }
     
     /// 读取半字从FLASH
@@ -259,7 +596,8 @@ impl FlashDriver {
     /// 清除所有错误标志
     pub unsafe fn clear_error_flags(&self) {
         let flash = self.get_flash();
-        flash.sr().write(|w: &mut library::flash::sr::W| unsafe { w.bits(flash.sr().read().bits() & !(0x0E << 1)) });
+        // 状态标志写1清除
+        flash.sr().write(|w: &mut library::flash::sr::W| unsafe { w.bits(SR_EOP | SR_PGERR | SR_WRPRTERR) });
     }
     
     /// 获取选项字节值
@@ -1,10 +1,29 @@
 ﻿//! FSMC模块
 //! 提供灵活的静态存储器控制器功能封装
+//! 
+//! 除时序配置外，`FsmcRegion`把存储区域映射为volatile访问的类型化数组（外部SRAM/PSRAM），
+//! `FsmcLcd`驱动8080并口LCD，像素由DMA存储器到存储器传输写入LCD的数据地址。
 
 #![allow(unused)]
 
+use core::ptr::{read_volatile, write_volatile};
+
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::delay::delay_ms;
+use crate::bsp::gpio::{GpioPort, GpioPortStruct};
+use crate::bsp::dma::{
+    Dma, DmaChannelPriority, DmaError, DmaMemoryDataSize, DmaMemoryIncrementMode,
+    DmaPeripheralDataSize, DmaPeripheralIncrementMode, DmaTransferDescriptor,
+};
+
+/// BCR1寄存器地址（BCRx与BTRx交替排列，间隔8字节）
+const FSMC_BCR1: u32 = 0xA000_0000;
+
+/// BCR位定义
+const BCR_FACCEN: u32 = 1 << 6;
+const BCR_WREN: u32 = 1 << 12;
+const BCR_EXTMOD: u32 = 1 << 14;
 
 /// FSMC存储区域枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -45,8 +64,30 @@ impl Fsmc {
         &mut *(0xA0000000 as *mut library::fsmc::RegisterBlock)
     }
     
+    /// 计算BCR中存储器类型、数据宽度和写使能位
+    fn bcr_bits(mem_type: FsmcMemoryType, data_width: FsmcDataWidth) -> u32 {
+        let mut bits = BCR_WREN | (data_width as u32) << 4;
+        bits |= match mem_type {
+            FsmcMemoryType::SRAM => 0b00 << 2,
+            FsmcMemoryType::PSRAM => 0b01 << 2,
+            // NOR Flash需要同时使能Flash访问
+            FsmcMemoryType::NorFlash => 0b10 << 2 | BCR_FACCEN,
+            // NAND Flash不在NOR/SRAM控制器中，按SRAM时序访问
+            FsmcMemoryType::NandFlash => 0b00 << 2,
+        };
+        bits
+    }
+    
+    /// 修改BCR寄存器
+    unsafe fn modify_bcr(&self, bank: FsmcBank, set: u32, clear: u32) {
+        let bcr = (FSMC_BCR1 + 8 * bank as u32) as *mut u32;
+        write_volatile(bcr, (read_volatile(bcr) & !clear) | set);
+    }
+    
     /// 初始化FSMC存储区域
     /// 
+    /// 开启FSMC时钟，按SRAM/NOR异步模式1配置存储区域（NOR/PSRAM控制器的子区域1~4，对应片选NE1~NE4）
+    /// 
     /// # 参数
     /// * `bank` - 存储区域
     /// * `mem_type` - 存储器类型
@@ -65,6 +106,10 @@ impl Fsmc {
     ) {
         let fsmc = Fsmc::fsmc();
         
+        // 启用FSMC时钟（AHBENR.FSMCEN）
+        let ahbenr = (0x4002_1000 + 0x14) as *mut u32;
+        write_volatile(ahbenr, read_volatile(ahbenr) | 1 << 8);
+        
         // 获取对应的BCR和BTR寄存器
         match bank {
             FsmcBank::Bank1 => {
@@ -74,8 +119,7 @@ impl Fsmc {
                 // 配置存储器类型和数据总线宽度
                 fsmc.bcr1().write(|w: &mut library::fsmc::bcr1::W| unsafe { 
                     w.bits(
-                        ((mem_type as u32) << 4) |
-                        ((data_width as u32) << 1) |
+                        Fsmc::bcr_bits(mem_type, data_width) |
                         (1 << 0) // 启用存储区域
                     ) 
                 });
@@ -96,8 +140,7 @@ impl Fsmc {
                 // 配置存储器类型和数据总线宽度
                 fsmc.bcr2().write(|w: &mut library::fsmc::bcr2::W| unsafe { 
                     w.bits(
-                        ((mem_type as u32) << 4) |
-                        ((data_width as u32) << 1) |
+                        Fsmc::bcr_bits(mem_type, data_width) |
                         (1 << 0) // 启用存储区域
                     ) 
                 });
@@ -118,8 +161,7 @@ impl Fsmc {
                 // 配置存储器类型和数据总线宽度
                 fsmc.bcr3().write(|w: &mut library::fsmc::bcr3::W| unsafe { 
                     w.bits(
-                        ((mem_type as u32) << 4) |
-                        ((data_width as u32) << 1) |
+                        Fsmc::bcr_bits(mem_type, data_width) |
                         (1 << 0) // 启用存储区域
                     ) 
                 });
@@ -140,8 +182,7 @@ impl Fsmc {
                 // 配置存储器类型和数据总线宽度
                 fsmc.bcr4().write(|w: &mut library::fsmc::bcr4::W| unsafe { 
                     w.bits(
-                        ((mem_type as u32) << 4) |
-                        ((data_width as u32) << 1) |
+                        Fsmc::bcr_bits(mem_type, data_width) |
                         (1 << 0) // 启用存储区域
                     ) 
                 });
@@ -174,6 +215,9 @@ impl Fsmc {
     ) {
         let fsmc = Fsmc::fsmc();
         
+        // 读写使用不同时序需要置位BCR.EXTMOD，BWTR才会生效
+        self.modify_bcr(bank, BCR_EXTMOD, 0);
+        
         // 获取对应的BWTR寄存器
         match bank {
             FsmcBank::Bank1 => {
@@ -182,8 +226,7 @@ impl Fsmc {
                     w.bits(
                         ((address_setup_time as u32) << 0) |
                         ((address_hold_time as u32) << 4) |
-                        ((data_setup_time as u32) << 8) |
-                        (1 << 16) // 启用写时序配置
+                        ((data_setup_time as u32) << 8)
                     ) 
                 });
             },
@@ -193,8 +236,7 @@ impl Fsmc {
                     w.bits(
                         ((address_setup_time as u32) << 0) |
                         ((address_hold_time as u32) << 4) |
-                        ((data_setup_time as u32) << 8) |
-                        (1 << 16) // 启用写时序配置
+                        ((data_setup_time as u32) << 8)
                     ) 
                 });
             },
@@ -204,8 +246,7 @@ impl Fsmc {
                     w.bits(
                         ((address_setup_time as u32) << 0) |
                         ((address_hold_time as u32) << 4) |
-                        ((data_setup_time as u32) << 8) |
-                        (1 << 16) // 启用写时序配置
+                        ((data_setup_time as u32) << 8)
                     ) 
                 });
             },
@@ -215,8 +256,7 @@ impl Fsmc {
                     w.bits(
                         ((address_setup_time as u32) << 0) |
                         ((address_hold_time as u32) << 4) |
-                        ((data_setup_time as u32) << 8) |
-                        (1 << 16) // 启用写时序配置
+                        ((data_setup_time as u32) << 8)
                     ) 
                 });
             },
@@ -342,3 +382,439 @@ impl Fsmc {
 
 /// 预定义的FSMC实例
 pub const FSMC: Fsmc = Fsmc::new();
+
+/// 存储区域映射的起始地址（NOR/PSRAM控制器，每个子区域64MB）
+pub const fn fsmc_bank_base(bank: FsmcBank) -> u32 {
+    0x6000_0000 + 0x0400_0000 * bank as u32
+}
+
+/// 一次DMA传输最多的数据项数
+const DMA_MAX_ITEMS: usize = 0xFFFF;
+
+/// DMA存储器到存储器传输（阻塞，超长时自动分段）
+/// 
+/// # Arguments
+/// * `dma` - 使用的DMA通道
+/// * `src` - 源地址
+/// * `dst` - 目的地址
+/// * `count` - 数据项个数
+/// * `item_size` - 数据项字节数（1、2、4）
+/// * `src_increment` - 源地址是否递增（填充时为固定地址）
+/// * `dst_increment` - 目的地址是否递增（写LCD数据端口时为固定地址）
+unsafe fn dma_copy(
+    dma: &Dma,
+    mut src: u32,
+    mut dst: u32,
+    mut count: usize,
+    item_size: usize,
+    src_increment: bool,
+    dst_increment: bool,
+) -> Result<(), DmaError> {
+    let (peripheral_size, memory_size) = match item_size {
+        1 => (DmaPeripheralDataSize::Byte, DmaMemoryDataSize::Byte),
+        2 => (DmaPeripheralDataSize::HalfWord, DmaMemoryDataSize::HalfWord),
+        _ => (DmaPeripheralDataSize::Word, DmaMemoryDataSize::Word),
+    };
+    let increment = |enabled: bool| if enabled { 1 } else { 0 };
+    
+    while count > 0 {
+        let chunk = count.min(DMA_MAX_ITEMS);
+        // 存储器到存储器模式下外设地址为源地址，存储器地址为目的地址
+        let desc = DmaTransferDescriptor::memory_to_memory(src, dst, chunk as u16)
+            .with_data_size(peripheral_size, memory_size)
+            .with_increment(
+                if src_increment { DmaPeripheralIncrementMode::Enabled } else { DmaPeripheralIncrementMode::Disabled },
+                if dst_increment { DmaMemoryIncrementMode::Enabled } else { DmaMemoryIncrementMode::Disabled },
+            )
+            .with_priority(DmaChannelPriority::High);
+        dma.start(&desc)?.wait()?;
+        
+        let bytes = (chunk * item_size) as u32;
+        src += bytes * increment(src_increment);
+        dst += bytes * increment(dst_increment);
+        count -= chunk;
+    }
+    Ok(())
+}
+
+/// FSMC映射的存储区域
+/// 
+/// 把外部SRAM/PSRAM看作`len`个`T`组成的数组，所有访问都是volatile的，
+/// 越界的写入被忽略、读取返回`None`。大块拷贝和填充可交给DMA完成。
+/// 
+/// ```ignore
+/// // IS62WV51216（1MB，16位）接在NE3上
+/// static SRAM: FsmcRegion<u16> = FsmcRegion::new(FsmcBank::Bank3, 512 * 1024);
+/// 
+/// FSMC.init_bank(FsmcBank::Bank3, FsmcMemoryType::SRAM, FsmcDataWidth::Width16b, 0, 0, 2);
+/// SRAM.write(0, 0x1234);
+/// SRAM.dma_fill(&DMA2_CHANNEL1, 0, SRAM.len(), 0)?;
+/// ```
+pub struct FsmcRegion<T: Copy> {
+    base: u32,
+    len: usize,
+    _marker: core::marker::PhantomData<T>,
+}
+
+impl<T: Copy> FsmcRegion<T> {
+    /// 创建存储区域
+    /// 
+    /// # Arguments
+    /// * `bank` - 存储区域（片选）
+    /// * `len` - 元素个数（按外部存储器容量计算）
+    pub const fn new(bank: FsmcBank, len: usize) -> Self {
+        Self::at(fsmc_bank_base(bank), len)
+    }
+    
+    /// 在指定地址创建存储区域（用于存储区域中的一部分）
+    pub const fn at(base: u32, len: usize) -> Self {
+        Self {
+            base,
+            len,
+            _marker: core::marker::PhantomData,
+        }
+    }
+    
+    /// 元素个数
+    pub const fn len(&self) -> usize {
+        self.len
+    }
+    
+    /// 起始地址
+    pub const fn address(&self) -> u32 {
+        self.base
+    }
+    
+    /// 指向第`index`个元素的指针
+    #[inline(always)]
+    fn ptr(&self, index: usize) -> *mut T {
+        (self.base as usize + index * core::mem::size_of::<T>()) as *mut T
+    }
+    
+    /// 读取一个元素
+    /// 
+    /// # Safety
+    /// 存储区域必须已通过`Fsmc::init_bank`配置
+    pub unsafe fn read(&self, index: usize) -> Option<T> {
+        if index < self.len {
+            Some(read_volatile(self.ptr(index)))
+        } else {
+            None
+        }
+    }
+    
+    /// 写入一个元素
+    /// 
+    /// # Safety
+    /// 存储区域必须已通过`Fsmc::init_bank`配置
+    pub unsafe fn write(&self, index: usize, value: T) {
+        if index < self.len {
+            write_volatile(self.ptr(index), value);
+        }
+    }
+    
+    /// 把存储区域中的数据读到`out`（CPU逐个拷贝）
+    /// 
+    /// # Returns
+    /// 实际读取的元素个数
+    pub unsafe fn read_slice(&self, offset: usize, out: &mut [T]) -> usize {
+        let count = out.len().min(self.len.saturating_sub(offset));
+        for (i, item) in out[..count].iter_mut().enumerate() {
+            *item = read_volatile(self.ptr(offset + i));
+        }
+        count
+    }
+    
+    /// 把`data`写入存储区域（CPU逐个拷贝）
+    /// 
+    /// # Returns
+    /// 实际写入的元素个数
+    pub unsafe fn write_slice(&self, offset: usize, data: &[T]) -> usize {
+        let count = data.len().min(self.len.saturating_sub(offset));
+        for (i, &item) in data[..count].iter().enumerate() {
+            write_volatile(self.ptr(offset + i), item);
+        }
+        count
+    }
+    
+    /// 用DMA把`data`写入存储区域
+    /// 
+    /// # Returns
+    /// 实际写入的元素个数
+    pub unsafe fn dma_write(&self, dma: &Dma, offset: usize, data: &[T]) -> Result<usize, DmaError> {
+        let count = data.len().min(self.len.saturating_sub(offset));
+        if count > 0 {
+            dma_copy(dma, data.as_ptr() as u32, self.ptr(offset) as u32, count, core::mem::size_of::<T>(), true, true)?;
+        }
+        Ok(count)
+    }
+    
+    /// 用DMA把存储区域中的数据读到`out`
+    /// 
+    /// # Returns
+    /// 实际读取的元素个数
+    pub unsafe fn dma_read(&self, dma: &Dma, offset: usize, out: &mut [T]) -> Result<usize, DmaError> {
+        let count = out.len().min(self.len.saturating_sub(offset));
+        if count > 0 {
+            dma_copy(dma, self.ptr(offset) as u32, out.as_mut_ptr() as u32, count, core::mem::size_of::<T>(), true, true)?;
+        }
+        Ok(count)
+    }
+    
+    /// 用DMA把一段元素填充为同一个值
+    /// 
+    /// # Returns
+    /// 实际填充的元素个数
+    pub unsafe fn dma_fill(&self, dma: &Dma, offset: usize, count: usize, value: T) -> Result<usize, DmaError> {
+        let count = count.min(self.len.saturating_sub(offset));
+        if count > 0 {
+            let source = value;
+            dma_copy(dma, &source as *const T as u32, self.ptr(offset) as u32, count, core::mem::size_of::<T>(), false, true)?;
+        }
+        Ok(count)
+    }
+}
+
+/// MIPI DCS命令（ILI9341、ST7789、ILI9486等控制器通用）
+pub const LCD_CMD_SOFT_RESET: u16 = 0x01;
+pub const LCD_CMD_SLEEP_OUT: u16 = 0x11;
+pub const LCD_CMD_DISPLAY_ON: u16 = 0x29;
+pub const LCD_CMD_COLUMN_ADDRESS: u16 = 0x2A;
+pub const LCD_CMD_PAGE_ADDRESS: u16 = 0x2B;
+pub const LCD_CMD_MEMORY_WRITE: u16 = 0x2C;
+pub const LCD_CMD_MEMORY_ACCESS: u16 = 0x36;
+pub const LCD_CMD_PIXEL_FORMAT: u16 = 0x3A;
+
+/// LCD初始化序列中的一步
+#[derive(Debug, Clone, Copy)]
+pub struct LcdInitStep {
+    pub command: u16,
+    pub params: &'static [u16],
+    pub delay_ms: u16, // 执行后的等待时间
+}
+
+/// 8080并口LCD（16位，RGB565）
+/// 
+/// LCD的片选接NEx，RS（D/C）接某一根地址线Ax：访问该地址线为0的地址写命令，为1的地址写数据。
+/// 16位总线时Ax对应AHB地址的第x+1位。像素数据由DMA以存储器到存储器方式写到固定的数据地址，
+/// FSMC按配置的时序产生WR脉冲，CPU不再逐个翻转GPIO。
+/// 
+/// ```ignore
+/// // 正点原子等常见接法：NE4 + A10
+/// static LCD: FsmcLcd = FsmcLcd::new(FsmcBank::Bank4, 10, 240, 320, DMA2_CHANNEL1);
+/// 
+/// LCD.init_pins(10);
+/// LCD.init_bus(1, 3);
+/// LCD.init(&ILI9341_INIT);
+/// LCD.fill_rect(0, 0, 240, 320, 0x0000)?;
+/// LCD.blit(0, 0, 240, 40, &FRAME)?;
+/// ```
+pub struct FsmcLcd {
+    bank: FsmcBank,
+    /// 命令地址（RS = 0）
+    command: u32,
+    /// 数据地址（RS = 1）
+    data: u32,
+    width: u16,
+    height: u16,
+    dma: Dma,
+}
+
+impl FsmcLcd {
+    /// 创建LCD实例
+    /// 
+    /// # Arguments
+    /// * `bank` - 片选对应的存储区域
+    /// * `rs_address_line` - RS连接的地址线编号（如A10为10）
+    /// * `width` - 水平像素数
+    /// * `height` - 垂直像素数
+    /// * `dma` - 用于推送像素的DMA通道（存储器到存储器，任意空闲通道）
+    pub const fn new(bank: FsmcBank, rs_address_line: u8, width: u16, height: u16, dma: Dma) -> Self {
+        let base = fsmc_bank_base(bank);
+        Self {
+            bank,
+            command: base,
+            data: base | 1 << (rs_address_line as u32 + 1),
+            width,
+            height,
+            dma,
+        }
+    }
+    
+    /// 水平像素数
+    pub const fn width(&self) -> u16 {
+        self.width
+    }
+    
+    /// 垂直像素数
+    pub const fn height(&self) -> u16 {
+        self.height
+    }
+    
+    /// 配置FSMC引脚：D0~D15、NOE、NWE、片选NEx和RS所在的地址线，均为复用推挽输出
+    /// 
+    /// # Arguments
+    /// * `rs_address_line` - RS连接的地址线编号，与`new`一致
+    /// 
+    /// # Safety
+    /// 直接修改GPIO配置寄存器
+    pub unsafe fn init_pins(&self, rs_address_line: u8) {
+        let pin = |port: GpioPort, pin: u8| GpioPortStruct { port, pin };
+        // D2, D3, D13~D15, D0, D1
+        for &n in &[0u8, 1, 8, 9, 10, 14, 15] {
+            pin(GpioPort::D, n).into_alternate_push_pull();
+        }
+        // D4~D12
+        for n in 7u8..=15 {
+            pin(GpioPort::E, n).into_alternate_push_pull();
+        }
+        // NOE, NWE
+        pin(GpioPort::D, 4).into_alternate_push_pull();
+        pin(GpioPort::D, 5).into_alternate_push_pull();
+        
+        let ne = match self.bank {
+            FsmcBank::Bank1 => pin(GpioPort::D, 7),
+            FsmcBank::Bank2 => pin(GpioPort::G, 9),
+            FsmcBank::Bank3 => pin(GpioPort::G, 10),
+            FsmcBank::Bank4 => pin(GpioPort::G, 12),
+        };
+        ne.into_alternate_push_pull();
+        
+        let rs = match rs_address_line {
+            0..=5 => pin(GpioPort::F, rs_address_line),
+            6..=9 => pin(GpioPort::F, rs_address_line + 6),
+            10..=15 => pin(GpioPort::G, rs_address_line - 10),
+            16..=18 => pin(GpioPort::D, rs_address_line - 5),
+            19..=22 => pin(GpioPort::E, rs_address_line - 16),
+            23 => pin(GpioPort::E, 2),
+            _ => pin(GpioPort::G, rs_address_line - 11),
+        };
+        rs.into_alternate_push_pull();
+    }
+    
+    /// 配置FSMC存储区域（SRAM类型，16位，读写分开的时序）
+    /// 
+    /// # Arguments
+    /// * `write_setup` - 写地址建立时间（HCLK周期数）
+    /// * `write_data` - 写数据保持时间（HCLK周期数，决定WR低电平宽度）
+    /// 
+    /// # Safety
+    /// 直接访问RCC和FSMC寄存器；引脚需已配置为复用推挽输出
+    pub unsafe fn init_bus(&self, write_setup: u8, write_data: u8) {
+        // 读操作较慢，按控制器读周期的最小值（约350ns）保守配置
+        FSMC.init_bank(self.bank, FsmcMemoryType::SRAM, FsmcDataWidth::Width16b, 15, 0, 30);
+        FSMC.configure_write_timing(self.bank, write_setup, 0, write_data);
+    }
+    
+    /// 写命令
+    #[inline(always)]
+    pub unsafe fn write_command(&self, command: u16) {
+        write_volatile(self.command as *mut u16, command);
+    }
+    
+    /// 写数据
+    #[inline(always)]
+    pub unsafe fn write_data(&self, data: u16) {
+        write_volatile(self.data as *mut u16, data);
+    }
+    
+    /// 读数据
+    #[inline(always)]
+    pub unsafe fn read_data(&self) -> u16 {
+        read_volatile(self.data as *const u16)
+    }
+    
+    /// 写命令及其参数
+    pub unsafe fn command(&self, command: u16, params: &[u16]) {
+        self.write_command(command);
+        for &param in params {
+            self.write_data(param);
+        }
+    }
+    
+    /// 执行控制器初始化序列
+    /// 
+    /// # Arguments
+    /// * `steps` - 命令、参数和等待时间，内容取决于具体的LCD控制器
+    pub unsafe fn init(&self, steps: &[LcdInitStep]) {
+        for step in steps {
+            self.command(step.command, step.params);
+            if step.delay_ms > 0 {
+                delay_ms(step.delay_ms as u32);
+            }
+        }
+    }
+    
+    /// 设置写入窗口并开始写显存
+    /// 
+    /// # Returns
+    /// 窗口完全在屏幕外时返回`None`，否则返回裁剪后的(宽, 高)
+    unsafe fn set_window(&self, x: u16, y: u16, width: u16, height: u16) -> Option<(u16, u16)> {
+        if x >= self.width || y >= self.height || width == 0 || height == 0 {
+            return None;
+        }
+        let width = width.min(self.width - x);
+        let height = height.min(self.height - y);
+        let (x1, y1) = (x + width - 1, y + height - 1);
+        
+        self.command(LCD_CMD_COLUMN_ADDRESS, &[x >> 8, x & 0xFF, x1 >> 8, x1 & 0xFF]);
+        self.command(LCD_CMD_PAGE_ADDRESS, &[y >> 8, y & 0xFF, y1 >> 8, y1 & 0xFF]);
+        self.write_command(LCD_CMD_MEMORY_WRITE);
+        Some((width, height))
+    }
+    
+    /// 用DMA把矩形区域填充为单色
+    /// 
+    /// # Arguments
+    /// * `x`, `y` - 左上角坐标
+    /// * `width`, `height` - 区域大小，超出屏幕的部分被裁剪
+    /// * `color` - RGB565颜色
+    pub unsafe fn fill_rect(&self, x: u16, y: u16, width: u16, height: u16, color: u16) -> Result<(), DmaError> {
+        if let Some((width, height)) = self.set_window(x, y, width, height) {
+            let source = color;
+            dma_copy(&self.dma, &source as *const u16 as u32, self.data, width as usize * height as usize, 2, false, false)?;
+        }
+        Ok(())
+    }
+    
+    /// 清屏
+    pub unsafe fn clear(&self, color: u16) -> Result<(), DmaError> {
+        self.fill_rect(0, 0, self.width, self.height, color)
+    }
+    
+    /// 用DMA把像素块写到矩形区域
+    /// 
+    /// # Arguments
+    /// * `x`, `y` - 左上角坐标
+    /// * `width`, `height` - 像素块大小，必须完全在屏幕内
+    /// * `pixels` - 按行排列的RGB565像素，至少`width × height`个
+    /// 
+    /// # Returns
+    /// 像素块超出屏幕或像素数据不足时不绘制
+    pub unsafe fn blit(&self, x: u16, y: u16, width: u16, height: u16, pixels: &[u16]) -> Result<(), DmaError> {
+        let count = width as usize * height as usize;
+        if x as u32 + width as u32 > self.width as u32
+            || y as u32 + height as u32 > self.height as u32
+            || pixels.len() < count
+        {
+            return Ok(());
+        }
+        if self.set_window(x, y, width, height).is_some() {
+            dma_copy(&self.dma, pixels.as_ptr() as u32, self.data, count, 2, true, false)?;
+        }
+        Ok(())
+    }
+    
+    /// 把外部SRAM中的帧缓冲直接推送到屏幕（不经过内部RAM）
+    /// 
+    /// # Arguments
+    /// * `framebuffer` - 至少`width × height`个像素的存储区域
+    pub unsafe fn present(&self, framebuffer: &FsmcRegion<u16>) -> Result<(), DmaError> {
+        let count = self.width as usize * self.height as usize;
+        if framebuffer.len() < count {
+            return Ok(());
+        }
+        self.set_window(0, 0, self.width, self.height);
+        dma_copy(&self.dma, framebuffer.address(), self.data, count, 2, true, false)
+    }
+}
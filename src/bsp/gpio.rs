@@ -8,6 +8,12 @@
 use library::*;
 use core::marker::PhantomData;
 use core::fmt::Debug;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransferDescriptor, DmaChannelPriority,
+    DmaPeripheralDataSize, DmaMemoryDataSize, DmaDoubleBuffer, DmaHalf,
+};
+use crate::bsp::timer::{Timer, TimerNumber, TimerDmaRequest, PwmChannel};
+use crate::bsp::reg;
 
 /// GPIO速度枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -137,34 +143,7 @@ impl GpioPortStruct {
     /// - 调用者必须确保相应GPIO端口时钟已启用
     /// - 调用者必须确保引脚未被其他代码或外设占用
     pub unsafe fn into_push_pull_output(self) {
-        // 这里实现简单的向后兼容，实际使用类型状态模式
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
-        
-        // 使能时钟
-        let rcc_ptr = 0x4002_1000 as *mut u32;
-        let apb2enr = (rcc_ptr as usize + 0x18) as *mut u32; // APB2ENR寄存器
-        let clock_bit = 1 << (2 + self.port as u32);
-        *apb2enr |= clock_bit;
-        
-        // 配置为推挽输出
-        let cr_offset = if self.pin < 8 { 0x00 } else { 0x04 };
-        let pin_pos = self.pin % 8;
-        let cr_ptr = (port_ptr as usize + cr_offset) as *mut u32;
-        
-        let pin_mask = 0x0F << (pin_pos * 4);
-        let config = 0b0011; // CNF=00, MODE=11 (50MHz)
-        
-        let mut value = *cr_ptr;
-        value = (value & !pin_mask) | (config << (pin_pos * 4));
-        *cr_ptr = value;
+        self.configure(0b0011); // CNF=00, MODE=11 (50MHz)
     }
     
     /// 转换为复用推挽输出
@@ -173,33 +152,7 @@ impl GpioPortStruct {
     /// - 调用者必须确保引脚未被其他代码或外设占用
     /// - 调用者必须确保已正确配置相关外设的复用功能
     pub unsafe fn into_alternate_push_pull(self) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
-        
-        // 使能时钟
-        let rcc_ptr = 0x4002_1000 as *mut u32;
-        let apb2enr = (rcc_ptr as usize + 0x18) as *mut u32; // APB2ENR寄存器
-        let clock_bit = 1 << (2 + self.port as u32);
-        *apb2enr |= clock_bit;
-        
-        // 配置为复用推挽输出
-        let cr_offset = if self.pin < 8 { 0x00 } else { 0x04 };
-        let pin_pos = self.pin % 8;
-        let cr_ptr = (port_ptr as usize + cr_offset) as *mut u32;
-        
-        let pin_mask = 0x0F << (pin_pos * 4);
-        let config = 0b1011; // CNF=10, MODE=11 (50MHz)
-        
-        let mut value = *cr_ptr;
-        value = (value & !pin_mask) | (config << (pin_pos * 4));
-        *cr_ptr = value;
+        self.configure(0b1011); // CNF=10, MODE=11 (50MHz)
     }
     
     /// 转换为浮动输入
@@ -207,71 +160,81 @@ impl GpioPortStruct {
     /// - 调用者必须确保相应GPIO端口时钟已启用
     /// - 调用者必须确保引脚未被其他代码或外设占用
     pub unsafe fn into_floating_input(self) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
-        
-        // 使能时钟
-        let rcc_ptr = 0x4002_1000 as *mut u32;
-        let apb2enr = (rcc_ptr as usize + 0x18) as *mut u32; // APB2ENR寄存器
-        let clock_bit = 1 << (2 + self.port as u32);
-        *apb2enr |= clock_bit;
+        self.configure(0b0100); // CNF=01, MODE=00
+    }
+    
+    /// 转换为上拉输入
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    /// - 调用者必须确保引脚未被其他代码或外设占用
+    pub unsafe fn into_pull_up_input(self) {
+        self.configure(0b1000); // CNF=10, MODE=00
+        reg::write(self.port_address() + 0x10, 1 << self.pin); // BSRR置位ODR，选择上拉
+    }
+    
+    /// 获取端口寄存器基地址
+    #[inline(always)]
+    pub const fn port_address(self) -> usize {
+        reg::gpio_base(self.port as usize)
+    }
+    
+    /// 使能端口时钟并写入引脚的CNF/MODE配置
+    #[inline(always)]
+    unsafe fn configure(self, config: u32) {
+        reg::RCC_APB2ENR.set_bits(port_clock_bit(self.port));
         
-        // 配置为浮动输入
         let cr_offset = if self.pin < 8 { 0x00 } else { 0x04 };
-        let pin_pos = self.pin % 8;
-        let cr_ptr = (port_ptr as usize + cr_offset) as *mut u32;
-        
+        let pin_pos = (self.pin % 8) as u32;
         let pin_mask = 0x0F << (pin_pos * 4);
-        let config = 0b0100; // CNF=01, MODE=00
-        
-        let mut value = *cr_ptr;
-        value = (value & !pin_mask) | (config << (pin_pos * 4));
-        *cr_ptr = value;
+        reg::modify(self.port_address() + cr_offset, |value| (value & !pin_mask) | (config << (pin_pos * 4)));
+    }
+    
+    /// 转换为开漏输出
+    /// # Safety
+    /// - 调用者必须确保引脚未被其他代码或外设占用
+    pub unsafe fn into_open_drain_output(self) {
+        self.configure(0b0111); // CNF=01, MODE=11 (50MHz)
+    }
+    
+    /// 转换为复用开漏输出
+    /// # Safety
+    /// - 调用者必须确保引脚未被其他代码或外设占用
+    /// - 调用者必须确保已正确配置相关外设的复用功能
+    pub unsafe fn into_alternate_open_drain(self) {
+        self.configure(0b1111); // CNF=11, MODE=11 (50MHz)
+    }
+    
+    /// 读取引脚输入电平是否为高
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    #[inline(always)]
+    pub unsafe fn is_high(self) -> bool {
+        (reg::read(self.port_address() + 0x08) & (1 << self.pin)) != 0 // IDR寄存器
+    }
+    
+    /// 读取引脚输入电平是否为低
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    pub unsafe fn is_low(self) -> bool {
+        !self.is_high()
     }
     
     /// 设置引脚为高电平
     /// # Safety
     /// - 调用者必须确保引脚已被配置为输出模式
     /// - 调用者必须确保引脚未被其他代码或外设占用
+    #[inline(always)]
     pub unsafe fn set_high(self) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
-        
-        let bsrr = (port_ptr as usize + 0x10) as *mut u32; // BSRR寄存器
-        *bsrr = 1 << self.pin;
+        reg::write(self.port_address() + 0x10, 1 << self.pin); // BSRR寄存器
     }
     
     /// 设置引脚为低电平
     /// # Safety
     /// - 调用者必须确保引脚已被配置为输出模式
     /// - 调用者必须确保引脚未被其他代码或外设占用
+    #[inline(always)]
     pub unsafe fn set_low(self) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
-        
-        let brr = (port_ptr as usize + 0x14) as *mut u32; // BRR寄存器
-        *brr = 1 << self.pin;
+        reg::write(self.port_address() + 0x14, 1 << self.pin); // BRR寄存器
     }
 }
 
@@ -288,15 +251,7 @@ impl GpioPortBatch {
     /// # Safety
     /// - 调用者必须确保相应GPIO端口时钟已启用
     pub unsafe fn read_input_data(&self) -> u16 {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let idr = (port_ptr as usize + 0x08) as *const u32; // IDR寄存器
         (*idr & 0xFFFF) as u16
@@ -306,15 +261,7 @@ impl GpioPortBatch {
     /// # Safety
     /// - 调用者必须确保相应GPIO端口时钟已启用
     pub unsafe fn read_output_data(&self) -> u16 {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let odr = (port_ptr as usize + 0x0C) as *const u32; // ODR寄存器
         (*odr & 0xFFFF) as u16
@@ -326,15 +273,7 @@ impl GpioPortBatch {
     /// - 调用者必须确保端口引脚已被配置为输出模式
     /// - 调用者必须确保写入操作不会影响其他关键功能
     pub unsafe fn write(&self, data: u16) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let odr = (port_ptr as usize + 0x0C) as *mut u32; // ODR寄存器
         *odr = data as u32;
@@ -346,15 +285,7 @@ impl GpioPortBatch {
     /// - 调用者必须确保指定的引脚已被配置为输出模式
     /// - 调用者必须确保操作不会影响其他关键功能
     pub unsafe fn set_bits(&self, pins: u16) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let bsrr = (port_ptr as usize + 0x10) as *mut u32; // BSRR寄存器
         *bsrr = pins as u32;
@@ -366,34 +297,64 @@ impl GpioPortBatch {
     /// - 调用者必须确保指定的引脚已被配置为输出模式
     /// - 调用者必须确保操作不会影响其他关键功能
     pub unsafe fn reset_bits(&self, pins: u16) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let brr = (port_ptr as usize + 0x14) as *mut u32; // BRR寄存器
         *brr = pins as u32;
     }
     
+    /// 用一次BSRR写入同时置位和复位若干引脚
+    /// 
+    /// 与`write`不同，未包含在`set`和`reset`中的引脚保持不变，
+    /// 且写入是原子的，不需要关中断保护读-改-写。
+    /// 
+    /// # Arguments
+    /// * `set` - 要置高的引脚掩码
+    /// * `reset` - 要置低的引脚掩码（与`set`重叠时置位优先）
+    /// 
+    /// # Safety
+    /// - 调用者必须确保指定的引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn modify(&self, set: u16, reset: u16) {
+        let bsrr = (reg::gpio_base(self.port as usize) + 0x10) as *mut u32; // BSRR寄存器
+        core::ptr::write_volatile(bsrr, bsrr_value(set, reset));
+    }
+    
+    /// 只更新`mask`选中的引脚，使其电平等于`data`中的对应位
+    /// 
+    /// # Safety
+    /// - 调用者必须确保指定的引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn write_masked(&self, mask: u16, data: u16) {
+        self.modify(data & mask, !data & mask);
+    }
+    
+    /// 一次配置多个引脚的模式
+    /// 
+    /// 端口时钟只使能一次，CRL和CRH各只做一次读-改-写。
+    /// 
+    /// # Arguments
+    /// * `pins` - 引脚掩码
+    /// * `mode` - 引脚模式，上拉/下拉输入会同时通过BSRR设置ODR
+    /// * `speed` - 输出速度（输入模式忽略）
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚未被其他代码或外设占用
+    pub unsafe fn configure(&self, pins: u16, mode: GpioMode, speed: GpioSpeed) {
+        configure_pins(self.port, pins, mode_config(mode, speed));
+        match mode {
+            GpioMode::PullUpInput => self.modify(pins, 0),
+            GpioMode::PullDownInput => self.modify(0, pins),
+            _ => {},
+        }
+    }
+    
     /// 锁定引脚配置，防止意外修改
     /// # Safety
     /// - 调用者必须确保相应GPIO端口时钟已启用
     /// - 锁定后无法修改引脚配置，直到下一次系统复位
     pub unsafe fn pin_lock_config(&self, pins: u16) {
-        let port_ptr = match self.port {
-            GpioPort::A => 0x4001_0800 as *mut u32,
-            GpioPort::B => 0x4001_0C00 as *mut u32,
-            GpioPort::C => 0x4001_1000 as *mut u32,
-            GpioPort::D => 0x4001_1400 as *mut u32,
-            GpioPort::E => 0x4001_1800 as *mut u32,
-            GpioPort::F => 0x4001_1C00 as *mut u32,
-            GpioPort::G => 0x4001_2000 as *mut u32,
-        };
+        let port_ptr = reg::gpio_base(self.port as usize) as *mut u32;
         
         let lckr = (port_ptr as usize + 0x18) as *mut u32; // LCKR寄存器
         
@@ -478,36 +439,17 @@ impl<P: GpioPortType, M: PinMode> Pin<P, M> {
     
     /// 获取端口实例
     pub unsafe fn get_port(&self) -> &'static P::Periph {
-        match P::PORT {
-            GpioPort::A => &*(0x4001_0800 as *const P::Periph),
-            GpioPort::B => &*(0x4001_0C00 as *const P::Periph),
-            GpioPort::C => &*(0x4001_1000 as *const P::Periph),
-            GpioPort::D => &*(0x4001_1400 as *const P::Periph),
-            GpioPort::E => &*(0x4001_1800 as *const P::Periph),
-            GpioPort::F => &*(0x4001_1C00 as *const P::Periph),
-            GpioPort::G => &*(0x4001_2000 as *const P::Periph),
-        }
+        &*(reg::gpio_base(P::PORT as usize) as *const P::Periph)
     }
     
     /// 获取端口时钟使能位
     fn clock_en_bit(&self) -> u32 {
-        match P::PORT {
-            GpioPort::A => 1 << 2,
-            GpioPort::B => 1 << 3,
-            GpioPort::C => 1 << 4,
-            GpioPort::D => 1 << 5,
-            GpioPort::E => 1 << 6,
-            GpioPort::F => 1 << 7,
-            GpioPort::G => 1 << 8,
-        }
+        port_clock_bit(P::PORT)
     }
     
     /// 启用端口时钟
     unsafe fn enable_clock(&self) {
-        let rcc = &mut *(0x4002_1000 as *mut rcc::RegisterBlock);
-        let mut value = rcc.apb2enr().read().bits();
-        value |= self.clock_en_bit();
-        rcc.apb2enr().write(|w| unsafe { w.bits(value) });
+        reg::RCC_APB2ENR.set_bits(self.clock_en_bit());
     }
     
     /// 配置引脚为浮动输入
@@ -857,6 +799,677 @@ macro_rules! impl_output_methods {
 // 为所有输出模式实现通用方法
 impl_output_methods!(PushPull, OpenDrain, AlternatePushPull, AlternateOpenDrain);
 
+/// 获取端口在RCC_APB2ENR中的时钟使能位
+#[inline(always)]
+const fn port_clock_bit(port: GpioPort) -> u32 {
+    1 << (2 + port as u32)
+}
+
+/// 计算BSRR写入值（高16位复位、低16位置位，置位优先）
+#[inline(always)]
+pub const fn bsrr_value(set: u16, reset: u16) -> u32 {
+    ((reset as u32) << 16) | set as u32
+}
+
+/// 计算引脚模式对应的CNF/MODE四位配置
+const fn mode_config(mode: GpioMode, speed: GpioSpeed) -> u32 {
+    let mode_bits = match speed {
+        GpioSpeed::Speed10MHz => 0b01,
+        GpioSpeed::Speed2MHz => 0b10,
+        GpioSpeed::Speed50MHz => 0b11,
+    };
+    
+    match mode {
+        GpioMode::AnalogInput => 0b0000,
+        GpioMode::FloatingInput => 0b0100,
+        GpioMode::PullUpInput | GpioMode::PullDownInput => 0b1000,
+        GpioMode::PushPullOutput => 0b0000 | mode_bits,
+        GpioMode::OpenDrainOutput => 0b0100 | mode_bits,
+        GpioMode::AlternatePushPull => 0b1000 | mode_bits,
+        GpioMode::AlternateOpenDrain => 0b1100 | mode_bits,
+    }
+}
+
+/// 把引脚掩码展开为CRL/CRH的四位字段掩码
+/// 
+/// # Returns
+/// (CRL字段掩码, CRH字段掩码)，每个选中引脚对应0xF
+const fn nibble_masks(pins: u16) -> (u32, u32) {
+    let mut low = 0u32;
+    let mut high = 0u32;
+    let mut i = 0;
+    while i < 8 {
+        if (pins & (1 << i)) != 0 {
+            low |= 0xF << (i * 4);
+        }
+        if (pins & (1 << (i + 8))) != 0 {
+            high |= 0xF << (i * 4);
+        }
+        i += 1;
+    }
+    (low, high)
+}
+
+/// 使能端口时钟，并一次写入多个引脚的CNF/MODE配置
+/// 
+/// CRL和CRH各最多一次读-改-写，未选中的引脚不受影响。
+unsafe fn configure_pins(port: GpioPort, pins: u16, config: u32) {
+    // 使能时钟
+    reg::RCC_APB2ENR.set_bits(port_clock_bit(port));
+    
+    // 配置值复制到全部8个字段后用掩码选取
+    let pattern = config * 0x1111_1111;
+    let (low, high) = nibble_masks(pins);
+    let base = reg::gpio_base(port as usize);
+    
+    if low != 0 {
+        let crl = base as *mut u32;
+        let value = core::ptr::read_volatile(crl);
+        core::ptr::write_volatile(crl, (value & !low) | (pattern & low));
+    }
+    if high != 0 {
+        let crh = (base + 0x04) as *mut u32;
+        let value = core::ptr::read_volatile(crh);
+        core::ptr::write_volatile(crh, (value & !high) | (pattern & high));
+    }
+}
+
+/// 端口序号，用作`FastPin`的端口参数
+pub const PORT_A: u8 = GpioPort::A as u8;
+pub const PORT_B: u8 = GpioPort::B as u8;
+pub const PORT_C: u8 = GpioPort::C as u8;
+pub const PORT_D: u8 = GpioPort::D as u8;
+pub const PORT_E: u8 = GpioPort::E as u8;
+pub const PORT_F: u8 = GpioPort::F as u8;
+pub const PORT_G: u8 = GpioPort::G as u8;
+
+/// 端口和引脚在编译期确定的GPIO引脚
+/// 
+/// 不占存储空间，寄存器地址和位掩码都是关联常量：`set_high`/`set_low`编译为一条STR，
+/// `is_high`为一条LDR加位测试，没有`GpioPortStruct`那样的运行时端口匹配和引脚范围计算。
+/// 端口或引脚超出范围时在编译期报错。
+/// 
+/// ```ignore
+/// type Led = FastPin<PORT_C, 13>;
+/// 
+/// Led::new().into_push_pull_output(GpioSpeed::Speed2MHz);
+/// Led::new().set_low();
+/// ```
+#[derive(Debug, Clone, Copy)]
+pub struct FastPin<const PORT: u8, const PIN: u8> {
+    _private: (),
+}
+
+impl<const PORT: u8, const PIN: u8> FastPin<PORT, PIN> {
+    /// 端口和引脚范围检查，在使用时求值
+    const VALID: () = assert!(PORT < 7 && PIN < 16, "FastPin端口或引脚超出范围");
+    /// 端口寄存器基地址
+    const BASE: usize = reg::gpio_base(PORT as usize);
+    /// 引脚所在的CRL/CRH寄存器地址
+    const CR: usize = Self::BASE + if PIN < 8 { 0x00 } else { 0x04 };
+    /// 引脚在CRL/CRH中的字段位置
+    const CR_SHIFT: u32 = (PIN as u32 % 8) * 4;
+    /// 引脚位掩码
+    const MASK: u32 = 1 << PIN;
+    
+    /// 创建引脚句柄
+    #[inline(always)]
+    pub const fn new() -> Self {
+        let () = Self::VALID;
+        Self { _private: () }
+    }
+    
+    /// 转换为`GpioPortStruct`，用于接受运行时引脚的接口
+    pub const fn degrade(self) -> GpioPortStruct {
+        let port = match PORT {
+            0 => GpioPort::A,
+            1 => GpioPort::B,
+            2 => GpioPort::C,
+            3 => GpioPort::D,
+            4 => GpioPort::E,
+            5 => GpioPort::F,
+            _ => GpioPort::G,
+        };
+        GpioPortStruct { port, pin: PIN }
+    }
+    
+    /// 使能端口时钟并配置引脚模式
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚未被其他代码或外设占用
+    /// - CRL/CRH的读-改-写不是原子的，与中断中配置同一端口的代码共享时需要加锁
+    #[inline(always)]
+    pub unsafe fn configure(self, mode: GpioMode, speed: GpioSpeed) {
+        reg::RCC_APB2ENR.set_bits(1 << (2 + PORT as u32));
+        let config = mode_config(mode, speed);
+        reg::modify(Self::CR, |value| (value & !(0xF << Self::CR_SHIFT)) | (config << Self::CR_SHIFT));
+        match mode {
+            GpioMode::PullUpInput => self.set_high(),
+            GpioMode::PullDownInput => self.set_low(),
+            _ => {},
+        }
+    }
+    
+    /// 转换为推挽输出
+    /// 
+    /// # Safety
+    /// 同`configure`
+    #[inline(always)]
+    pub unsafe fn into_push_pull_output(self, speed: GpioSpeed) {
+        self.configure(GpioMode::PushPullOutput, speed);
+    }
+    
+    /// 转换为开漏输出
+    /// 
+    /// # Safety
+    /// 同`configure`
+    #[inline(always)]
+    pub unsafe fn into_open_drain_output(self, speed: GpioSpeed) {
+        self.configure(GpioMode::OpenDrainOutput, speed);
+    }
+    
+    /// 转换为复用推挽输出
+    /// 
+    /// # Safety
+    /// 同`configure`，并且需要已正确配置相关外设的复用功能
+    #[inline(always)]
+    pub unsafe fn into_alternate_push_pull(self, speed: GpioSpeed) {
+        self.configure(GpioMode::AlternatePushPull, speed);
+    }
+    
+    /// 转换为浮动输入
+    /// 
+    /// # Safety
+    /// 同`configure`
+    #[inline(always)]
+    pub unsafe fn into_floating_input(self) {
+        self.configure(GpioMode::FloatingInput, GpioSpeed::Speed2MHz);
+    }
+    
+    /// 转换为上拉输入
+    /// 
+    /// # Safety
+    /// 同`configure`
+    #[inline(always)]
+    pub unsafe fn into_pull_up_input(self) {
+        self.configure(GpioMode::PullUpInput, GpioSpeed::Speed2MHz);
+    }
+    
+    /// 设置引脚为高电平（一次BSRR写入）
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn set_high(self) {
+        reg::write(Self::BASE + 0x10, Self::MASK); // BSRR寄存器
+    }
+    
+    /// 设置引脚为低电平（一次BRR写入）
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn set_low(self) {
+        reg::write(Self::BASE + 0x14, Self::MASK); // BRR寄存器
+    }
+    
+    /// 按`high`设置引脚电平
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn set_state(self, high: bool) {
+        // BSRR高16位复位、低16位置位，一次写入完成
+        reg::write(Self::BASE + 0x10, if high { Self::MASK } else { Self::MASK << 16 });
+    }
+    
+    /// 翻转引脚电平
+    /// 
+    /// 读ODR后用BSRR写入，不影响同一端口的其他引脚
+    /// 
+    /// # Safety
+    /// - 调用者必须确保引脚已被配置为输出模式
+    #[inline(always)]
+    pub unsafe fn toggle(self) {
+        let high = (reg::read(Self::BASE + 0x0C) & Self::MASK) != 0; // ODR寄存器
+        self.set_state(!high);
+    }
+    
+    /// 读取引脚输入电平是否为高
+    /// 
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    #[inline(always)]
+    pub unsafe fn is_high(self) -> bool {
+        (reg::read(Self::BASE + 0x08) & Self::MASK) != 0 // IDR寄存器
+    }
+    
+    /// 读取引脚输入电平是否为低
+    /// 
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    #[inline(always)]
+    pub unsafe fn is_low(self) -> bool {
+        !self.is_high()
+    }
+    
+    /// 读取输出锁存值是否为高
+    /// 
+    /// # Safety
+    /// - 调用者必须确保相应GPIO端口时钟已启用
+    #[inline(always)]
+    pub unsafe fn is_set_high(self) -> bool {
+        (reg::read(Self::BASE + 0x0C) & Self::MASK) != 0 // ODR寄存器
+    }
+}
+
+/// 同一端口上的一组引脚
+/// 
+/// 引脚集合在创建时合并为16位掩码，之后对任意子集的置位/复位都只需一次BSRR写入，
+/// 模式转换也只对CRL/CRH各做一次读-改-写。适合并行总线、LED矩阵行列线等
+/// 需要多根引脚同时变化的场合。
+/// 
+/// 端口和模式由类型参数保证一致：只有同一端口、同一模式的`Pin`才能组成一组。
+/// 掩码在`const`上下文中用`from_mask`创建时完全在编译期确定。
+#[derive(Debug, Clone, Copy)]
+pub struct PinGroup<P: GpioPortType, M: PinMode> {
+    mask: u16,
+    _port: PhantomData<P>,
+    _mode: PhantomData<M>,
+}
+
+impl<P: GpioPortType, M: PinMode> PinGroup<P, M> {
+    /// 端口寄存器基地址
+    const BASE: usize = GpioPortStruct { port: P::PORT, pin: 0 }.port_address();
+    /// BSRR寄存器地址
+    const BSRR: usize = Self::BASE + 0x10;
+    /// BRR寄存器地址
+    const BRR: usize = Self::BASE + 0x14;
+    /// ODR寄存器地址
+    const ODR: usize = Self::BASE + 0x0C;
+    /// IDR寄存器地址
+    const IDR: usize = Self::BASE + 0x08;
+    
+    /// 由引脚掩码创建引脚组
+    /// 
+    /// 掩码不能为0（`shift`等按最低引脚号移位的方法要求组内至少有一个引脚）
+    /// 
+    /// # Safety
+    /// 调用者必须确保掩码中的引脚已处于模式`M`且不被其他代码使用
+    pub const unsafe fn from_mask(mask: u16) -> Self {
+        assert!(mask != 0, "PinGroup至少要包含一个引脚");
+        Self {
+            mask,
+            _port: PhantomData,
+            _mode: PhantomData,
+        }
+    }
+    
+    /// 由若干引脚组成引脚组（取得引脚的所有权）
+    /// 
+    /// # Arguments
+    /// * `pins` - 同一端口、同一模式的引脚
+    pub fn from_pins<const N: usize>(pins: [Pin<P, M>; N]) -> Self {
+        assert!(N > 0, "PinGroup至少要包含一个引脚");
+        let mut mask = 0u16;
+        for pin in pins.iter() {
+            mask |= 1 << pin.pin;
+        }
+        Self {
+            mask,
+            _port: PhantomData,
+            _mode: PhantomData,
+        }
+    }
+    
+    /// 向组中加入一个引脚
+    pub fn with(mut self, pin: Pin<P, M>) -> Self {
+        self.mask |= 1 << pin.pin;
+        self
+    }
+    
+    /// 获取引脚掩码
+    pub const fn mask(&self) -> u16 {
+        self.mask
+    }
+    
+    /// 最低引脚号（连续字段的移位量）
+    pub const fn shift(&self) -> u32 {
+        self.mask.trailing_zeros()
+    }
+    
+    /// 把组内引脚重新配置为另一种模式（CRL/CRH各一次读-改-写）
+    unsafe fn reconfigure<N: PinMode>(self, mode: GpioMode, speed: GpioSpeed) -> PinGroup<P, N> {
+        configure_pins(P::PORT, self.mask, mode_config(mode, speed));
+        match mode {
+            GpioMode::PullUpInput => core::ptr::write_volatile(Self::BSRR as *mut u32, self.mask as u32),
+            GpioMode::PullDownInput => core::ptr::write_volatile(Self::BRR as *mut u32, self.mask as u32),
+            _ => {},
+        }
+        PinGroup {
+            mask: self.mask,
+            _port: PhantomData,
+            _mode: PhantomData,
+        }
+    }
+    
+    /// 转换为浮动输入
+    pub unsafe fn into_floating_input(self) -> PinGroup<P, Floating> {
+        self.reconfigure(GpioMode::FloatingInput, GpioSpeed::Speed2MHz)
+    }
+    
+    /// 转换为上拉输入
+    pub unsafe fn into_pull_up(self) -> PinGroup<P, PullUp> {
+        self.reconfigure(GpioMode::PullUpInput, GpioSpeed::Speed2MHz)
+    }
+    
+    /// 转换为下拉输入
+    pub unsafe fn into_pull_down(self) -> PinGroup<P, PullDown> {
+        self.reconfigure(GpioMode::PullDownInput, GpioSpeed::Speed2MHz)
+    }
+    
+    /// 转换为推挽输出
+    pub unsafe fn into_push_pull_output(self, speed: GpioSpeed) -> PinGroup<P, PushPull> {
+        self.reconfigure(GpioMode::PushPullOutput, speed)
+    }
+    
+    /// 转换为开漏输出
+    pub unsafe fn into_open_drain_output(self, speed: GpioSpeed) -> PinGroup<P, OpenDrain> {
+        self.reconfigure(GpioMode::OpenDrainOutput, speed)
+    }
+    
+    /// 读取组内引脚的输入电平（按端口位置，未选中的位为0）
+    #[inline(always)]
+    pub unsafe fn read(&self) -> u16 {
+        core::ptr::read_volatile(Self::IDR as *const u32) as u16 & self.mask
+    }
+    
+    /// 读取连续引脚组成的字段（右移到最低位）
+    #[inline(always)]
+    pub unsafe fn read_field(&self) -> u16 {
+        self.read() >> self.shift()
+    }
+}
+
+/// 输出模式引脚组的方法
+macro_rules! impl_group_output_methods {
+    ($($mode:ty),*) => {
+        $(impl<P: GpioPortType> PinGroup<P, $mode> {
+            /// 组内全部引脚置高（一次BSRR写入）
+            #[inline(always)]
+            pub unsafe fn set_high(&mut self) {
+                core::ptr::write_volatile(Self::BSRR as *mut u32, self.mask as u32);
+            }
+            
+            /// 组内全部引脚置低（一次BRR写入）
+            #[inline(always)]
+            pub unsafe fn set_low(&mut self) {
+                core::ptr::write_volatile(Self::BRR as *mut u32, self.mask as u32);
+            }
+            
+            /// 按端口位置写入组内引脚，组外引脚不受影响（一次BSRR写入）
+            /// 
+            /// # Arguments
+            /// * `value` - 端口位置上的电平，只使用组内引脚对应的位
+            #[inline(always)]
+            pub unsafe fn write(&mut self, value: u16) {
+                core::ptr::write_volatile(Self::BSRR as *mut u32, self.bsrr_word(value));
+            }
+            
+            /// 只更新组内`subset`选中的引脚
+            #[inline(always)]
+            pub unsafe fn write_subset(&mut self, subset: u16, value: u16) {
+                let mask = self.mask & subset;
+                core::ptr::write_volatile(Self::BSRR as *mut u32, bsrr_value(value & mask, !value & mask));
+            }
+            
+            /// 写入连续引脚组成的字段（如PB8~PB15组成的8位并行总线）
+            /// 
+            /// # Arguments
+            /// * `value` - 字段值，左移`shift()`位后写入
+            #[inline(always)]
+            pub unsafe fn write_field(&mut self, value: u16) {
+                self.write(value << self.shift());
+            }
+            
+            /// 翻转组内全部引脚（一次读ODR、一次写BSRR）
+            #[inline(always)]
+            pub unsafe fn toggle(&mut self) {
+                let odr = core::ptr::read_volatile(Self::ODR as *const u32) as u16;
+                self.write(!odr);
+            }
+            
+            /// 计算写入`value`对应的BSRR值
+            /// 
+            /// 可用于预先生成BSRR数据表，再由定时器触发的DMA搬运到BSRR产生并行波形。
+            #[inline(always)]
+            pub const fn bsrr_word(&self, value: u16) -> u32 {
+                bsrr_value(value & self.mask, !value & self.mask)
+            }
+            
+            /// 获取BSRR寄存器地址（DMA目的地址）
+            pub const fn bsrr_address(&self) -> u32 {
+                Self::BSRR as u32
+            }
+        })*
+    };
+}
+
+impl_group_output_methods!(PushPull, OpenDrain);
+
+/// GPIO波形输出错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum GpioWaveformError {
+    /// 输出速率为0或超出定时器范围
+    InvalidRate,
+    /// 数据长度为0或超过65535
+    InvalidLength,
+    /// 该定时器事件没有连接到DMA
+    UnsupportedRequest,
+    /// DMA错误
+    Dma(DmaError),
+}
+
+impl From<DmaError> for GpioWaveformError {
+    fn from(error: DmaError) -> Self {
+        GpioWaveformError::Dma(error)
+    }
+}
+
+/// GPIO波形流式输出的双缓冲区（BSRR数据）
+/// 
+/// 建立在`DmaDoubleBuffer`之上，DMA循环读取整个缓冲区，每读完一个半区就交还给应用重新填充。
+/// BSRR写0不改变任何引脚，因此初始内容不会产生输出。
+pub struct GpioStreamBuffer<const N: usize> {
+    inner: DmaDoubleBuffer<u32, N>,
+}
+
+impl<const N: usize> GpioStreamBuffer<N> {
+    /// 每个半区的字数
+    pub const HALF_LEN: usize = N / 2;
+    
+    /// 创建新的流式输出缓冲区
+    pub const fn new() -> Self {
+        Self {
+            inner: DmaDoubleBuffer::new(0),
+        }
+    }
+    
+    /// 取出下一个等待填充的半区
+    /// 
+    /// 同一时刻只能持有一个半区，上一个尚未丢弃时返回`None`
+    pub fn next_free(&self) -> Option<GpioFill<'_>> {
+        self.inner.take()
+    }
+    
+    /// 获取欠载次数（半区未及时填充而被DMA重复输出，或DMA传输错误）
+    pub fn underruns(&self) -> u32 {
+        self.inner.lags()
+    }
+}
+
+/// 等待填充的GPIO波形半缓冲区
+/// 
+/// 通过`DerefMut`直接写入BSRR值（可用`PinGroup::bsrr_word`生成），drop时交还给DMA。
+pub type GpioFill<'a> = DmaHalf<'a, u32>;
+
+/// 定时器+DMA驱动的GPIO波形输出
+/// 
+/// 定时器的更新或比较事件每发生一次，DMA就把下一个32位BSRR值写入端口，
+/// 引脚在事件发生后固定的几个总线周期内翻转，没有中断响应抖动，也不消耗CPU。
+/// 适合WS2812类LED、步进电机脉冲序列、8080并行总线等需要精确时序的场合：
+/// - `start_once`：输出一次数据表后停在最后的电平
+/// - `start_table`：循环输出一张固定数据表
+/// - `start_stream`：循环输出双缓冲区，由应用在半传输/传输完成后填充空闲半区
+/// 
+/// 引脚需预先配置为输出模式（如`PinGroup::into_push_pull_output`）。
+/// 流式输出时需在对应DMA通道中断中调用`handle_dma_interrupt`，并在NVIC中使能该中断。
+pub struct GpioWaveform {
+    port: GpioPort,
+    timer: TimerNumber,
+    request: TimerDmaRequest,
+}
+
+impl GpioWaveform {
+    /// 创建新的波形输出
+    /// 
+    /// # Arguments
+    /// * `port` - 输出端口
+    /// * `timer` - 产生DMA请求的定时器
+    /// * `request` - 定时器的DMA请求源，对应的DMA1通道见`TimerNumber::dma_channel`
+    pub const fn new(port: GpioPort, timer: TimerNumber, request: TimerDmaRequest) -> Self {
+        Self {
+            port,
+            timer,
+            request,
+        }
+    }
+    
+    /// 获取使用的DMA通道
+    pub const fn dma(&self) -> Option<Dma> {
+        self.timer.dma_channel(self.request)
+    }
+    
+    /// 获取端口BSRR地址
+    const fn bsrr_address(&self) -> u32 {
+        (reg::gpio_base(self.port as usize) + 0x10) as u32
+    }
+    
+    /// 按输出速率配置定时器（保持停止）
+    unsafe fn configure_timer(&self, rate_hz: u32) -> Result<(), GpioWaveformError> {
+        let timer = Timer::new(self.timer);
+        let (prescaler, period) = timer
+            .prescaler_period_for(rate_hz)
+            .ok_or(GpioWaveformError::InvalidRate)?;
+        timer.init(prescaler, period);
+        
+        // 比较事件每个周期在CNT==CCR时产生一次，与更新事件同频
+        if let TimerDmaRequest::Compare(channel) = self.request {
+            timer.set_compare(channel, 0);
+        }
+        Ok(())
+    }
+    
+    /// 配置DMA并启动定时器
+    unsafe fn start_dma(&self, data: *const u32, len: usize, circular: bool, interrupts: bool) -> Result<(), GpioWaveformError> {
+        if len == 0 || len > 0xFFFF {
+            return Err(GpioWaveformError::InvalidLength);
+        }
+        let dma = self.dma().ok_or(GpioWaveformError::UnsupportedRequest)?;
+        
+        let mut desc = DmaTransferDescriptor::memory_to_peripheral(
+            data as u32,
+            self.bsrr_address(),
+            len as u16,
+        )
+        .with_data_size(DmaPeripheralDataSize::Word, DmaMemoryDataSize::Word)
+        .with_priority(DmaChannelPriority::VeryHigh)
+        .with_interrupts(interrupts, interrupts, interrupts);
+        if circular {
+            desc = desc.with_circular();
+        }
+        
+        // 传输状态通过通道标志查询，句柄无需保留
+        dma.start(&desc)?;
+        
+        let timer = Timer::new(self.timer);
+        timer.enable_dma_request(self.request);
+        timer.start();
+        Ok(())
+    }
+    
+    /// 输出一次数据表
+    /// 
+    /// # Arguments
+    /// * `words` - BSRR值序列，每个定时器事件输出一个
+    /// * `rate_hz` - 输出速率
+    /// 
+    /// # Safety
+    /// 会重新配置指定定时器和对应的DMA1通道，调用者必须保证它们没有被其他代码使用
+    pub unsafe fn start_once(&self, words: &'static [u32], rate_hz: u32) -> Result<(), GpioWaveformError> {
+        self.stop();
+        self.configure_timer(rate_hz)?;
+        self.start_dma(words.as_ptr(), words.len(), false, false)
+    }
+    
+    /// 循环输出一张数据表
+    /// 
+    /// # Safety
+    /// 同`start_once`
+    pub unsafe fn start_table(&self, words: &'static [u32], rate_hz: u32) -> Result<(), GpioWaveformError> {
+        self.stop();
+        self.configure_timer(rate_hz)?;
+        self.start_dma(words.as_ptr(), words.len(), true, false)
+    }
+    
+    /// 循环输出双缓冲区中的任意数据流
+    /// 
+    /// 启动前先调用`prefill`填满整个缓冲区，之后每个半区输出完毕时可以通过
+    /// `buffer.next_free()`重新填充。
+    /// 
+    /// # Safety
+    /// 同`start_once`
+    pub unsafe fn start_stream<const N: usize>(
+        &self,
+        buffer: &'static GpioStreamBuffer<N>,
+        rate_hz: u32,
+        prefill: impl FnOnce(&mut [u32]),
+    ) -> Result<(), GpioWaveformError> {
+        self.stop();
+        buffer.inner.reset();
+        prefill(buffer.inner.as_mut_slice());
+        
+        self.configure_timer(rate_hz)?;
+        self.start_dma(buffer.inner.as_ptr(), N, true, true)
+    }
+    
+    /// `start_once`的数据是否已全部输出
+    pub unsafe fn is_finished(&self) -> bool {
+        match self.dma() {
+            Some(dma) => dma.get_remaining_count() == 0,
+            None => true,
+        }
+    }
+    
+    /// 停止输出（引脚保持最后的电平）
+    pub unsafe fn stop(&self) {
+        let timer = Timer::new(self.timer);
+        timer.stop();
+        timer.disable_dma_request(self.request);
+        if let Some(dma) = self.dma() {
+            dma.disable();
+            dma.clear_all_interrupts();
+        }
+    }
+    
+    /// 处理流式输出的DMA通道中断：半传输释放前一半，传输完成释放后一半
+    pub fn handle_dma_interrupt<const N: usize>(&self, buffer: &GpioStreamBuffer<N>) {
+        if let Some(dma) = self.dma() {
+            buffer.inner.handle_dma_interrupt(dma);
+        }
+    }
+}
+
 /// 预定义的GPIO引脚常量
 pub mod pins {
     use super::*;
@@ -1768,20 +2381,10 @@ pub unsafe fn gpio_afio_deinit() {
 /// - 调用者必须确保引脚未被其他代码或外设占用
 pub unsafe fn gpio_init(port: GpioPort, config: GpioInitConfig) {
     // 使能GPIO时钟
-    let rcc = &mut *(0x4002_1000 as *mut rcc::RegisterBlock);
-    let clock_bit = 1 << (2 + port as u32);
-    rcc.apb2enr().write(|w| unsafe { w.bits(rcc.apb2enr().read().bits() | clock_bit) });
+    reg::RCC_APB2ENR.set_bits(port_clock_bit(port));
     
     // 获取GPIO端口寄存器指针
-    let gpio_ptr = match port {
-        GpioPort::A => 0x4001_0800 as *mut u32,
-        GpioPort::B => 0x4001_0C00 as *mut u32,
-        GpioPort::C => 0x4001_1000 as *mut u32,
-        GpioPort::D => 0x4001_1400 as *mut u32,
-        GpioPort::E => 0x4001_1800 as *mut u32,
-        GpioPort::F => 0x4001_1C00 as *mut u32,
-        GpioPort::G => 0x4001_2000 as *mut u32,
-    };
+    let gpio_ptr = reg::gpio_base(port as usize) as *mut u32;
     
     // 配置每个引脚
     for pin in 0..16 {
@@ -0,0 +1,329 @@
+//! 低功耗空闲管理模块
+//! 根据下一个唤醒时间和外设活动情况，在睡眠模式（WFI）和停止模式之间选择
+//! 
+//! - 驱动在传输进行期间通过`hold`持有活动计数（串口、IIC的异步接口和DMA异步等待已内置），
+//!   应用也可以为自己使用的外设持有计数。另外直接检查DMA通道使能位和串口发送完成标志，
+//!   未经过异步接口启动的传输同样不会被停止模式打断
+//! - 有活动、距离下一个唤醒时间不足`min_stop_us`、或没有配置RTC而又有定时唤醒时，
+//!   通过`delay::tickless_idle`进入睡眠模式，外设和SysTick照常运行
+//! - 否则进入停止模式：1.8V域时钟全部停止，由RTC闹钟（EXTI线17）或任意EXTI中断唤醒；
+//!   唤醒后按原配置恢复HSE和PLL，并用RTC计数器补上SysTick停止期间的运行时间
+//! 
+//! 停止模式默认关闭，需要先用`Rtc::init`启动RTC，再通过`configure`打开。
+//! 定时唤醒占用RTC闹钟和EXTI线17，应用不能同时把它们用作其他用途。
+//! 停止模式期间定时器、串口等外设不计数，基于硬件定时器的`SoftTimerQueue`到期时间会整体推迟；
+//! 基于`delay`运行时间的定时（执行器的`sleep_ms`等）不受影响。
+//! 
+//! ```ignore
+//! rtc::RTC.init(31);         // LSE 32768Hz / (31 + 1) = 1024Hz
+//! idle::configure(IdleConfig { rtc_tick_hz: 1024, stop_enabled: true, ..IdleConfig::new() });
+//! 
+//! {
+//!     let _active = idle::hold(Activity::Adc);
+//!     adc_start_conversion();
+//!     // ...
+//! } // 离开作用域后释放，执行器空闲时可以进入停止模式
+//! ```
+
+#![allow(unused)]
+
+use core::sync::atomic::{AtomicU8, Ordering};
+
+use crate::bsp::delay;
+use crate::bsp::dma::{Dma, DMA1_CHANNEL1, DMA1_CHANNEL2, DMA1_CHANNEL3, DMA1_CHANNEL4, DMA1_CHANNEL5, DMA1_CHANNEL6, DMA1_CHANNEL7};
+use crate::bsp::dma::{DMA2_CHANNEL1, DMA2_CHANNEL2, DMA2_CHANNEL3, DMA2_CHANNEL4, DMA2_CHANNEL5};
+use crate::bsp::exti::{ExtiLine, EXTI};
+use crate::bsp::misc::{self, MISC};
+use crate::bsp::pwr::PWR;
+use crate::bsp::reg;
+use crate::bsp::rtc::RTC;
+use crate::bsp::system;
+use library::Interrupt;
+
+/// DMA2时钟使能位（RCC_AHBENR）
+const AHBENR_DMA2EN: u32 = 1 << 1;
+
+/// 各串口的基地址
+const USART_BASES: [usize; 3] = [0x4001_3800, 0x4000_4400, 0x4000_4800];
+/// 串口状态寄存器：发送完成位
+const USART_SR_TC: u32 = 1 << 6;
+/// 串口控制寄存器1偏移地址
+const USART_CR1_OFFSET: usize = 0x0C;
+/// 串口控制寄存器1：串口使能位和发送使能位
+const USART_CR1_UE_TE: u32 = (1 << 13) | (1 << 3);
+
+/// 阻止进入停止模式的外设活动类别
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(u8)]
+pub enum Activity {
+    /// DMA传输
+    Dma = 0,
+    /// 串口收发
+    Serial = 1,
+    /// IIC传输
+    Iic = 2,
+    /// SPI传输
+    Spi = 3,
+    /// ADC转换
+    Adc = 4,
+    /// CAN通信
+    Can = 5,
+    /// USB通信
+    Usb = 6,
+    /// 定时器（PWM输出、输入捕获等需要在空闲时继续计数的用途）
+    Timer = 7,
+    /// 应用自定义的活动
+    Application = 8,
+}
+
+/// 活动类别数量
+pub const ACTIVITY_KINDS: usize = 9;
+
+/// 计数器初始值，用于初始化数组
+const NO_ACTIVITY: AtomicU8 = AtomicU8::new(0);
+
+/// 各类别的活动计数
+static ACTIVITY_COUNTS: [AtomicU8; ACTIVITY_KINDS] = [NO_ACTIVITY; ACTIVITY_KINDS];
+
+/// 空闲管理配置
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct IdleConfig {
+    /// 是否允许进入停止模式，`false`时始终使用睡眠模式
+    pub stop_enabled: bool,
+    /// RTC计数频率（Hz，即`Rtc::init`分频后的频率），0表示不使用RTC，此时只在没有定时唤醒时进入停止模式
+    pub rtc_tick_hz: u32,
+    /// 进入停止模式的最短休眠时间（微秒），应覆盖HSE和PLL重新启动的时间
+    pub min_stop_us: u32,
+    /// 停止模式下电压调节器是否进入低功耗模式（电流更低，唤醒稍慢）
+    pub low_power_regulator: bool,
+}
+
+impl IdleConfig {
+    /// 默认配置：只使用睡眠模式
+    pub const fn new() -> Self {
+        Self {
+            stop_enabled: false,
+            rtc_tick_hz: 0,
+            min_stop_us: 5_000,
+            low_power_regulator: true,
+        }
+    }
+}
+
+/// 本次空闲使用的休眠方式
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum IdleMode {
+    /// 睡眠模式：只停止CPU时钟
+    Sleep,
+    /// 停止模式：停止1.8V域全部时钟
+    Stop,
+}
+
+/// 空闲统计
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct IdleStats {
+    /// 进入睡眠模式的次数
+    pub sleep_count: u32,
+    /// 进入停止模式的次数
+    pub stop_count: u32,
+    /// 停止模式累计时间（微秒，未配置RTC时不计入）
+    pub stop_time_us: u64,
+}
+
+/// 空闲管理配置
+static mut CONFIG: IdleConfig = IdleConfig::new();
+
+/// 空闲统计
+static mut STATS: IdleStats = IdleStats {
+    sleep_count: 0,
+    stop_count: 0,
+    stop_time_us: 0,
+};
+
+/// 设置空闲管理配置
+/// 
+/// # Arguments
+/// * `config` - 新的配置，打开停止模式且使用定时唤醒前必须已经启动RTC
+pub fn configure(config: IdleConfig) {
+    cortex_m::interrupt::free(|_| unsafe { CONFIG = config });
+}
+
+/// 获取当前配置
+pub fn config() -> IdleConfig {
+    cortex_m::interrupt::free(|_| unsafe { CONFIG })
+}
+
+/// 获取空闲统计
+pub fn stats() -> IdleStats {
+    cortex_m::interrupt::free(|_| unsafe { STATS })
+}
+
+/// 增加一个活动计数
+/// 
+/// 计数不为0期间不会进入停止模式，必须与`release`成对调用，一般使用`hold`
+pub fn acquire(activity: Activity) {
+    ACTIVITY_COUNTS[activity as usize].fetch_add(1, Ordering::AcqRel);
+}
+
+/// 减少一个活动计数，计数已为0时保持不变
+pub fn release(activity: Activity) {
+    let _ = ACTIVITY_COUNTS[activity as usize].fetch_update(Ordering::AcqRel, Ordering::Acquire, |count| count.checked_sub(1));
+}
+
+/// 获取某类活动的当前计数
+pub fn active_count(activity: Activity) -> u8 {
+    ACTIVITY_COUNTS[activity as usize].load(Ordering::Acquire)
+}
+
+/// 持有一个活动计数，返回的守卫离开作用域时自动释放
+/// 
+/// 异步接口中持有时，Future在完成前被丢弃也会正确释放
+pub fn hold(activity: Activity) -> ActivityGuard {
+    acquire(activity);
+    ActivityGuard { activity }
+}
+
+/// 活动计数守卫，由`hold`创建
+pub struct ActivityGuard {
+    activity: Activity,
+}
+
+impl Drop for ActivityGuard {
+    fn drop(&mut self) {
+        release(self.activity);
+    }
+}
+
+/// 是否有DMA通道正在传输
+unsafe fn dma_busy() -> bool {
+    let dma1 = [DMA1_CHANNEL1, DMA1_CHANNEL2, DMA1_CHANNEL3, DMA1_CHANNEL4, DMA1_CHANNEL5, DMA1_CHANNEL6, DMA1_CHANNEL7];
+    if dma1.iter().any(|channel| channel.is_transferring()) {
+        return true;
+    }
+    // DMA2只在大容量器件上存在，时钟未开启时不访问
+    if (reg::RCC_AHBENR.read() & AHBENR_DMA2EN) == 0 {
+        return false;
+    }
+    let dma2 = [DMA2_CHANNEL1, DMA2_CHANNEL2, DMA2_CHANNEL3, DMA2_CHANNEL4, DMA2_CHANNEL5];
+    dma2.iter().any(|channel| channel.is_transferring())
+}
+
+/// 是否有串口的最后一帧还没有发送完成
+unsafe fn serial_transmitting() -> bool {
+    USART_BASES.iter().any(|&base| {
+        let cr1 = reg::read(base + USART_CR1_OFFSET);
+        let sr = reg::read(base);
+        (cr1 & USART_CR1_UE_TE) == USART_CR1_UE_TE && (sr & USART_SR_TC) == 0
+    })
+}
+
+/// 是否有外设活动阻止进入停止模式（活动计数或硬件传输状态）
+pub fn peripherals_busy() -> bool {
+    if ACTIVITY_COUNTS.iter().any(|count| count.load(Ordering::Acquire) != 0) {
+        return true;
+    }
+    unsafe { dma_busy() || serial_transmitting() }
+}
+
+/// 按当前配置和外设活动选择休眠方式
+/// 
+/// # Arguments
+/// * `max_sleep_us` - 距离下一个唤醒时间的微秒数，`None`表示没有定时唤醒
+pub fn select_mode(max_sleep_us: Option<u32>) -> IdleMode {
+    let config = config();
+    if !config.stop_enabled || peripherals_busy() {
+        return IdleMode::Sleep;
+    }
+    match max_sleep_us {
+        None => IdleMode::Stop,
+        Some(us) if config.rtc_tick_hz != 0 && us >= config.min_stop_us => IdleMode::Stop,
+        Some(_) => IdleMode::Sleep,
+    }
+}
+
+/// 空闲一次：休眠到下一个唤醒时间或任意中断
+/// 
+/// 在主循环或执行器没有就绪任务时调用，关中断检查就绪状态后再调用不会丢失唤醒。
+/// 休眠长度受SysTick或RTC限制时提前醒来，调用者应在循环中重新计算唤醒时间后再次调用。
+/// 
+/// # Arguments
+/// * `max_sleep_us` - 距离下一个唤醒时间的微秒数，`None`表示没有定时唤醒
+/// 
+/// # Returns
+/// 使用的休眠方式和实际休眠的微秒数
+/// 
+/// # Safety
+/// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+pub unsafe fn idle(max_sleep_us: Option<u32>) -> (IdleMode, u32) {
+    if select_mode(max_sleep_us) == IdleMode::Stop {
+        if let Some(slept) = enter_stop(&config(), max_sleep_us) {
+            return (IdleMode::Stop, slept);
+        }
+    }
+    let slept = delay::tickless_idle(max_sleep_us);
+    cortex_m::interrupt::free(|_| STATS.sleep_count = STATS.sleep_count.wrapping_add(1));
+    (IdleMode::Sleep, slept)
+}
+
+/// 进入停止模式，唤醒后恢复时钟和运行时间
+/// 
+/// # Returns
+/// 休眠的微秒数，休眠时间不足一个RTC计数时返回`None`，由调用者改用睡眠模式
+unsafe fn enter_stop(config: &IdleConfig, max_sleep_us: Option<u32>) -> Option<u32> {
+    cortex_m::interrupt::free(|_| {
+        let rtc_hz = config.rtc_tick_hz as u64;
+        let start = if rtc_hz != 0 { RTC.get_counter() } else { 0 };
+        
+        let alarm = match max_sleep_us {
+            Some(us) => {
+                // 提前一个计数唤醒，留出恢复时钟的时间
+                let ticks = us as u64 * rtc_hz / 1_000_000;
+                if ticks < 2 {
+                    return None;
+                }
+                let ticks = ticks.min(u32::MAX as u64) as u32;
+                RTC.clear_alarm_flag();
+                RTC.set_alarm(start.wrapping_add(ticks - 1));
+                RTC.enable_alarm_interrupt();
+                EXTI.clear_pending(ExtiLine::Line17);
+                EXTI.enable_rising_trigger(ExtiLine::Line17);
+                EXTI.enable_interrupt(ExtiLine::Line17);
+                MISC.nvic_clear_pending(Interrupt::RTCAlarm as u8);
+                MISC.nvic_enable_irq(Interrupt::RTCAlarm as u8);
+                true
+            }
+            None => false,
+        };
+        
+        // 关中断后WFI：挂起的中断仍能唤醒CPU，退出临界区后才执行其处理函数
+        PWR.init();
+        MISC.nvic_system_lp_config(misc::LowPowerMode::SleepDeep, true);
+        PWR.enter_stop_mode(config.low_power_regulator);
+        MISC.nvic_system_lp_config(misc::LowPowerMode::SleepDeep, false);
+        
+        // 唤醒后运行在HSI，时钟源启动失败时system模块已按HSI重新设置SysTick
+        let _ = system::restore_clocks();
+        
+        // 退出临界区前清除闹钟中断的挂起状态，RTCAlarm中断处理函数不会执行
+        if alarm {
+            RTC.disable_alarm_interrupt();
+            RTC.clear_alarm_flag();
+            EXTI.disable_interrupt(ExtiLine::Line17);
+            EXTI.disable_rising_trigger(ExtiLine::Line17);
+            EXTI.clear_pending(ExtiLine::Line17);
+            MISC.nvic_disable_irq(Interrupt::RTCAlarm as u8);
+            MISC.nvic_clear_pending(Interrupt::RTCAlarm as u8);
+        }
+        
+        let slept_us = if rtc_hz != 0 {
+            RTC.get_counter().wrapping_sub(start) as u64 * 1_000_000 / rtc_hz
+        } else {
+            0
+        };
+        delay::advance_uptime(slept_us);
+        
+        STATS.stop_count = STATS.stop_count.wrapping_add(1);
+        STATS.stop_time_us += slept_us;
+        Some(slept_us.min(u32::MAX as u64) as u32)
+    })
+}
@@ -4,8 +4,16 @@
 // 屏蔽未使用代码警告
 #![allow(unused)]
 
-use crate::bsp::gpio::{GpioPin, GpioMode};
+use crate::bsp::gpio::GpioPortStruct;
 use crate::bsp::delay::*;
+use crate::bsp::dma::{Dma, DmaChannelPriority, DmaInterrupt, DmaTransfer, DmaTransferDescriptor, DMA1_CHANNEL6, DMA1_CHANNEL7};
+use crate::bsp::executor::{self, WakerSlot};
+use crate::bsp::idle::{self, Activity};
+use crate::bsp::system::{get_system_clocks, SystemClocks};
+
+use core::cell::UnsafeCell;
+use core::sync::atomic::{AtomicBool, AtomicU8, AtomicUsize, Ordering};
+use core::task::Waker;
 
 // 导入内部生成的设备驱动库
 use library::*;
@@ -33,7 +41,7 @@ impl IicPin {
     /// 
     /// # Returns
     /// 返回对应的GPIO引脚，用于底层GPIO操作
-    pub fn to_gpio_pin(&self) -> GpioPin {
+    pub fn to_gpio_pin(&self) -> GpioPortStruct {
         match self {
             IicPin::PB6 => crate::bsp::gpio::PB6,
             IicPin::PB7 => crate::bsp::gpio::PB7,
@@ -43,7 +51,7 @@ impl IicPin {
     }
 }
 
-impl From<IicPin> for GpioPin {
+impl From<IicPin> for GpioPortStruct {
     fn from(pin: IicPin) -> Self {
         match pin {
             IicPin::PB6 => crate::bsp::gpio::PB6,
@@ -197,47 +205,20 @@ impl IicClockConfig {
         let rcc = &mut *(0x40021000 as *mut library::rcc::RegisterBlock);
         
         // 读取系统时钟源
-        let rcc_cfgr = rcc.cfgr().read().bits();
-        let sws = (rcc_cfgr >> 2) & 0x03; // 系统时钟切换状态位
-        
-        // 根据系统时钟源计算系统时钟频率
-        let sysclk: u32;
-        let source: IicClockSource;
-        match sws {
-            0x00 => {
-                sysclk = 8_000_000; // HSI作为系统时钟
-                source = IicClockSource::Hsi;
-            }
-            0x01 => {
-                sysclk = 8_000_000; // HSE作为系统时钟（假设外部晶振为8MHz）
-                source = IicClockSource::Hse;
-            }
-            0x02 => {
-                sysclk = 72_000_000; // PLL作为系统时钟（假设倍频为9，HSE=8MHz）
-                source = IicClockSource::Pll;
-            }
-            _ => {
-                sysclk = 8_000_000; // 默认使用HSI
-                source = IicClockSource::Hsi;
-            }
-        }
+        let sws = (rcc.cfgr().read().bits() >> 2) & 0x03; // 系统时钟切换状态位
+        let source = match sws {
+            0x01 => IicClockSource::Hse,
+            0x02 => IicClockSource::Pll,
+            _ => IicClockSource::Hsi,
+        };
         
-        // 根据PPRE1位计算APB1时钟频率
-        let ppre1 = (rcc_cfgr >> 8) & 0x07;
-        let pclk1: u32;
-        match ppre1 {
-            0x00..=0x03 => pclk1 = sysclk, // 不分频
-            0x04 => pclk1 = sysclk / 2, // 二分频
-            0x05 => pclk1 = sysclk / 4, // 四分频
-            0x06 => pclk1 = sysclk / 8, // 八分频
-            0x07 => pclk1 = sysclk / 16, // 十六分频
-            _ => pclk1 = sysclk / 2, // 默认二分频
-        }
+        // 频率按RCC当前的倍频和分频设置计算
+        let clocks = get_system_clocks();
         
         Self {
             source,
-            sysclk,
-            pclk1,
+            sysclk: clocks.sysclk,
+            pclk1: clocks.pclk1,
         }
     }
     
@@ -266,6 +247,43 @@ impl IicClockConfig {
     }
 }
 
+/// I2C1数据寄存器地址，用于DMA传输
+const I2C1_DR_ADDRESS: u32 = 0x4000_5410;
+
+/// I2C CR2寄存器DMAEN位
+const I2C_CR2_DMAEN: u32 = 1 << 11;
+
+/// I2C1发送使用的DMA通道
+const I2C1_TX_DMA: Dma = DMA1_CHANNEL6;
+
+/// I2C1接收使用的DMA通道
+const I2C1_RX_DMA: Dma = DMA1_CHANNEL7;
+
+/// I2C CR1寄存器位
+const I2C_CR1_START: u32 = 1 << 8;
+const I2C_CR1_STOP: u32 = 1 << 9;
+const I2C_CR1_ACK: u32 = 1 << 10;
+const I2C_CR1_POS: u32 = 1 << 11;
+
+/// I2C CR2寄存器中断和DMA控制位
+const I2C_CR2_ITERREN: u32 = 1 << 8;
+const I2C_CR2_ITEVTEN: u32 = 1 << 9;
+const I2C_CR2_ITBUFEN: u32 = 1 << 10;
+const I2C_CR2_LAST: u32 = 1 << 12;
+
+/// I2C SR1寄存器标志位
+const I2C_SR1_SB: u32 = 1 << 0;
+const I2C_SR1_ADDR: u32 = 1 << 1;
+const I2C_SR1_BTF: u32 = 1 << 2;
+const I2C_SR1_RXNE: u32 = 1 << 6;
+const I2C_SR1_TXE: u32 = 1 << 7;
+const I2C_SR1_BERR: u32 = 1 << 8;
+const I2C_SR1_ARLO: u32 = 1 << 9;
+const I2C_SR1_AF: u32 = 1 << 10;
+const I2C_SR1_OVR: u32 = 1 << 11;
+const I2C_SR1_TIMEOUT: u32 = 1 << 14;
+const I2C_SR1_ERRORS: u32 = I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT;
+
 // I2C速度定义
 pub const I2C_SPEED_100K: u32 = 100_000;
 pub const I2C_SPEED_400K: u32 = 400_000;
@@ -421,7 +439,6 @@ pub struct SoftwareIic {
     config: IicConfig, // 类型安全的IIC配置
     scl: IicPin, // 类型安全的SCL引脚
     sda: IicPin, // 类型安全的SDA引脚
-    delay_us: u32, // 延时微秒数，用于控制通信速度
 }
 
 /// IIC设备结构体
@@ -475,7 +492,67 @@ impl HardwareIic {
     pub fn from_config(config: IicConfig) -> Self {
         Self::new(config)
     }
-
+    
+    /// 按APB1频率计算CR2.FREQ、CCR（含DUTY位）和TRISE
+    /// 
+    /// 完全按照STM32F10x_StdPeriph_Driver库的I2C_Init函数计算
+    fn timing(&self, pclk1: u32) -> (u16, u32, u32) {
+        let freqrange = (pclk1 / 1000000) as u16;
+        let i2c_speed = self.config.speed;
+        
+        let ccr = match self.config.duty_cycle {
+            IicDutyCycle::Cycle2To1 => {
+                if i2c_speed <= 100_000 {
+                    // 标准模式
+                    (freqrange as u32 * 1000000) / (2 * i2c_speed)
+                } else {
+                    // 快速模式，2:1占空比
+                    (freqrange as u32 * 1000000) / (3 * i2c_speed)
+                }
+            },
+            IicDutyCycle::Cycle16To9 => {
+                // 快速模式下的16:9占空比，设置DUTY位（第14位）
+                (1 << 14) | ((freqrange as u32 * 1000000) / (3 * i2c_speed))
+            },
+        };
+        
+        let trise = if i2c_speed <= 100_000 {
+            // 标准模式
+            (freqrange as u32) + 1
+        } else {
+            // 快速模式
+            ((freqrange as u32 * 300) / 1000) + 1
+        };
+        
+        (freqrange, ccr, trise)
+    }
+    
+    /// 时钟切换后按新的APB1频率重新设置SCL时序
+    /// 
+    /// 在`system::ClockChangePhase::After`阶段、没有正在进行的传输时调用。
+    /// CCR和TRISE只能在外设关闭时修改，因此会短暂清除PE位。
+    /// 
+    /// # Arguments
+    /// * `clocks` - 切换后的时钟频率
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器
+    pub unsafe fn retime(&mut self, clocks: &SystemClocks) {
+        let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
+        
+        if let Some(clock_config) = self.config.clock_config.as_mut() {
+            clock_config.sysclk = clocks.sysclk;
+            clock_config.pclk1 = clocks.pclk1;
+        }
+        let (freqrange, ccr, trise) = self.timing(clocks.pclk1);
+        
+        i2c.cr1().modify(|_, w: &mut library::i2c1::cr1::W| w.pe().clear_bit());
+        i2c.cr2().modify(|_, w: &mut library::i2c1::cr2::W| w.freq().bits(freqrange as u8));
+        i2c.ccr().write(|w: &mut library::i2c1::ccr::W| unsafe { w.bits(ccr) });
+        i2c.trise().write(|w: &mut library::i2c1::trise::W| w.bits(trise));
+        i2c.cr1().modify(|_, w: &mut library::i2c1::cr1::W| w.pe().set_bit());
+    }
+    
     /// 初始化硬件IIC（完全按照STM32F10x_StdPeriph_Driver库的I2C_Init函数实现）
     unsafe fn init(&self) {
         let rcc = &mut *(0x40021000 as *mut library::rcc::RegisterBlock);
@@ -489,16 +566,16 @@ impl HardwareIic {
         
         // 2. 配置SCL和SDA引脚为复用开漏输出，使用指定的引脚
         if let Some((scl_pin, sda_pin)) = self.config.pins {
-            let scl: GpioPin = scl_pin.into();
-            let sda: GpioPin = sda_pin.into();
-            scl.into_mode(crate::bsp::gpio::GpioMode::AlternateOpenDrain, crate::bsp::gpio::GpioSpeed::Speed50MHz);
-            sda.into_mode(crate::bsp::gpio::GpioMode::AlternateOpenDrain, crate::bsp::gpio::GpioSpeed::Speed50MHz);
+            let scl: GpioPortStruct = scl_pin.into();
+            let sda: GpioPortStruct = sda_pin.into();
+            scl.into_alternate_open_drain();
+            sda.into_alternate_open_drain();
         } else {
             // 默认使用PB6和PB7作为IIC引脚
-            let scl: GpioPin = IicPin::PB6.into();
-            let sda: GpioPin = IicPin::PB7.into();
-            scl.into_mode(crate::bsp::gpio::GpioMode::AlternateOpenDrain, crate::bsp::gpio::GpioSpeed::Speed50MHz);
-            sda.into_mode(crate::bsp::gpio::GpioMode::AlternateOpenDrain, crate::bsp::gpio::GpioSpeed::Speed50MHz);
+            let scl: GpioPortStruct = IicPin::PB6.into();
+            let sda: GpioPortStruct = IicPin::PB7.into();
+            scl.into_alternate_open_drain();
+            sda.into_alternate_open_drain();
         }
         
         // 3. 启用I2C1时钟
@@ -509,7 +586,7 @@ impl HardwareIic {
         
         // 5. 设置CR2寄存器，使用类型安全的时钟配置
         let clock_config = self.config.clock_config.unwrap();
-        let freqrange = (clock_config.pclk1 / 1000000) as u16;
+        let (freqrange, ccr, trise) = self.timing(clock_config.pclk1);
         i2c.cr2().write(|w: &mut library::i2c1::cr2::W| w.freq().bits(freqrange.try_into().unwrap()));
         
         // 6. 清空OAR1和OAR2寄存器
@@ -519,49 +596,10 @@ impl HardwareIic {
         // 7. 设置OAR1寄存器
         i2c.oar1().write(|w: &mut library::i2c1::oar1::W| unsafe { w.bits(1 << 14) }); // 必须设置第14位为1，这是I2C规范要求的
         
-        // 8. 设置I2C速度（CCR寄存器）
-        // 完全按照STM32F10x_StdPeriph_Driver库的I2C_Init函数实现
-        let i2c_speed = self.config.speed;
-        
-        let mut ccr = 0;
-        let mut duty_cycle = 0; // 0=2:1, 1=16:9
-        
-        match self.config.duty_cycle {
-            IicDutyCycle::Cycle2To1 => {
-                // 标准模式或快速模式下的2:1占空比
-                if i2c_speed <= 100_000 {
-                    // 标准模式
-                    ccr = (freqrange as u32 * 1000000) / (2 * i2c_speed);
-                } else {
-                    // 快速模式，2:1占空比
-                    ccr = (freqrange as u32 * 1000000) / (3 * i2c_speed);
-                }
-            },
-            IicDutyCycle::Cycle16To9 => {
-                // 快速模式下的16:9占空比
-                ccr = (freqrange as u32 * 1000000) / (3 * i2c_speed);
-                duty_cycle = 1;
-            },
-        }
-        
-        // 设置CCR寄存器，包括占空比位
-        if duty_cycle == 1 {
-            // 快速模式，占空比为16:9
-            i2c.ccr().write(|w: &mut library::i2c1::ccr::W| unsafe { w.bits((1 << 14) | ccr) }); // 设置DUTY位（第14位）
-        } else {
-            // 标准模式或2:1占空比
-            i2c.ccr().write(|w: &mut library::i2c1::ccr::W| unsafe { w.bits(ccr) });
-        }
+        // 8. 设置I2C速度（CCR寄存器，包括占空比位）
+        i2c.ccr().write(|w: &mut library::i2c1::ccr::W| unsafe { w.bits(ccr) });
         
         // 9. 设置TRISE寄存器
-        let trise = if i2c_speed <= 100_000 {
-            // 标准模式
-            (freqrange as u32) + 1
-        } else {
-            // 快速模式
-            ((freqrange as u32 * 300) / 1000) + 1
-        };
-        
         i2c.trise().write(|w: &mut library::i2c1::trise::W| w.bits(trise));
         
         // 10. 设置CR1寄存器，包括ACK位、DutyCycle位、Mode位和GeneralCall位
@@ -574,7 +612,7 @@ impl HardwareIic {
         }
         
         // 设置占空比
-        if duty_cycle == 1 {
+        if let IicDutyCycle::Cycle16To9 = self.config.duty_cycle {
             cr1_value |= 1 << 14; // DUTY位
         }
         
@@ -589,7 +627,7 @@ impl HardwareIic {
             asm!("NOP");
         }
     }
-
+    
     /// 生成I2C起始信号（完全按照STM32F10x_StdPeriph_Driver库的I2C_GenerateSTART函数实现）
     unsafe fn start(&self) -> bool {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -602,7 +640,7 @@ impl HardwareIic {
             i2c.sr1().read().sb().bit()
         })
     }
-
+    
     /// 生成I2C停止信号
     unsafe fn stop(&self) {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -610,7 +648,7 @@ impl HardwareIic {
         // 生成停止信号
         i2c.cr1().modify(|_, w: &mut library::i2c1::cr1::W| w.stop().set_bit());
     }
-
+    
     /// 发送设备地址
     unsafe fn send_addr(&self, addr: u8, read: bool) -> bool {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -645,7 +683,7 @@ impl HardwareIic {
             false
         }
     }
-
+    
     /// 发送数据（完全按照STM32F10x_StdPeriph_Driver库的I2C_Transmit函数实现）
     unsafe fn send_data(&self, data: u8, is_last: bool) -> bool {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -673,7 +711,7 @@ impl HardwareIic {
         
         true
     }
-
+    
     /// 接收数据
     unsafe fn recv_data(&self, ack: bool) -> u8 {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -697,7 +735,7 @@ impl HardwareIic {
         
         data
     }
-
+    
     /// 写入数据到设备
     unsafe fn write(&self, addr: u8, data: &[u8]) -> IicResult<()> {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -737,7 +775,7 @@ impl HardwareIic {
         self.stop();
         Ok(())
     }
-
+    
     /// 从设备读取数据
     unsafe fn read(&self, addr: u8, buffer: &mut [u8]) -> IicResult<()> {
         let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
@@ -849,6 +887,139 @@ impl HardwareIic {
         // 3. 重新初始化IIC
         self.init();
     }
+    
+    /// 通过DMA向设备写入数据（非阻塞）
+    /// 
+    /// 先以轮询方式发送起始信号、设备地址和`header`（如SSD1306的控制字节），
+    /// 然后打开I2C的DMA请求，由DMA1通道6（I2C1_TX）发送`data`。
+    /// DMA传输完成后必须调用`finish_write_dma`（或非阻塞的`try_finish_write_dma`）等待最后一个字节发出并产生停止信号。
+    /// 
+    /// # Arguments
+    /// * `addr` - 设备的8位IIC地址
+    /// * `header` - 在DMA数据之前以轮询方式发送的字节
+    /// * `data` - 由DMA发送的数据，长度为1~65535
+    /// 
+    /// # Returns
+    /// * `Ok(DmaTransfer)` - 传输已启动
+    /// * `Err(IicError)` - 总线忙、无应答或DMA启动失败
+    /// 
+    /// # Safety
+    /// - 调用者必须保证`data`在传输结束前一直有效且不被修改
+    /// - DMA1通道6不能被其他外设同时使用
+    pub unsafe fn start_write_dma(&self, addr: u8, header: &[u8], data: &[u8]) -> IicResult<DmaTransfer> {
+        let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
+        
+        if data.is_empty() || data.len() > u16::MAX as usize {
+            return Err(IicError::InvalidParam);
+        }
+        
+        // 检查总线是否忙碌
+        let bus_free = !wait_with_timeout(self.config.timeout_us, || {
+            !i2c.sr2().read().busy().bit()
+        });
+        if !bus_free {
+            self.reset();
+            return Err(IicError::Busy);
+        }
+        
+        if !self.start() {
+            self.reset();
+            return Err(IicError::Timeout);
+        }
+        
+        if !self.send_addr(addr, false) {
+            self.stop();
+            return Err(IicError::NoAcknowledge);
+        }
+        
+        for &byte in header {
+            if !self.send_data(byte, false) {
+                self.stop();
+                return Err(IicError::Timeout);
+            }
+        }
+        
+        let desc = DmaTransferDescriptor::memory_to_peripheral(
+            data.as_ptr() as u32,
+            I2C1_DR_ADDRESS,
+            data.len() as u16,
+        ).with_priority(DmaChannelPriority::High)
+         .with_interrupts(true, false, true);
+        
+        let transfer = match I2C1_TX_DMA.start(&desc) {
+            Ok(transfer) => transfer,
+            Err(_) => {
+                self.stop();
+                return Err(IicError::Busy);
+            }
+        };
+        
+        // 打开I2C的DMA请求，TXE将由DMA响应
+        i2c.cr2().modify(|r, w| w.bits(r.bits() | I2C_CR2_DMAEN));
+        
+        Ok(transfer)
+    }
+    
+    /// 结束一次DMA写入
+    /// 
+    /// 在DMA传输完成（如DMA传输完成中断中）后调用：关闭I2C的DMA请求，
+    /// 等待移位寄存器中的最后一个字节发送完成（BTF），然后产生停止信号。
+    /// 
+    /// # Safety
+    /// 必须在`start_write_dma`启动的传输完成后调用
+    pub unsafe fn finish_write_dma(&self) -> IicResult<()> {
+        let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
+        
+        i2c.cr2().modify(|r, w| w.bits(r.bits() & !I2C_CR2_DMAEN));
+        
+        let btf_set = !wait_with_timeout(self.config.timeout_us, || {
+            i2c.sr1().read().btf().bit()
+        });
+        
+        self.stop();
+        
+        if btf_set {
+            Ok(())
+        } else {
+            Err(IicError::Timeout)
+        }
+    }
+    
+    /// 非阻塞地结束一次DMA写入
+    /// 
+    /// 与`finish_write_dma`相同，但最后一个字节仍在移位寄存器中时立即返回，
+    /// 可以在主循环中反复调用或在DMA中断中调用。
+    /// 
+    /// # Arguments
+    /// * `since_us` - DMA传输结束时的`get_uptime_us()`，超过配置的超时时间仍无BTF时结束传输
+    /// 
+    /// # Returns
+    /// * `None` - 最后一个字节仍在发送
+    /// * `Some(Ok(()))` - 已产生停止信号
+    /// * `Some(Err(IicError::Timeout))` - 等待BTF超时，已产生停止信号
+    /// 
+    /// # Safety
+    /// 必须在`start_write_dma`启动的传输完成后调用
+    pub unsafe fn try_finish_write_dma(&self, since_us: u64) -> Option<IicResult<()>> {
+        let i2c = &mut *(0x40005400 as *mut library::i2c1::RegisterBlock);
+        
+        i2c.cr2().modify(|r, w| w.bits(r.bits() & !I2C_CR2_DMAEN));
+        
+        if i2c.sr1().read().btf().bit() {
+            self.stop();
+            return Some(Ok(()));
+        }
+        if get_uptime_us().wrapping_sub(since_us) >= self.config.timeout_us as u64 {
+            self.stop();
+            return Some(Err(IicError::Timeout));
+        }
+        None
+    }
+    
+    /// 获取DMA写入使用的DMA通道（I2C1_TX对应DMA1通道6）
+    pub const fn tx_dma(&self) -> Dma {
+        I2C1_TX_DMA
+    }
 }
 
 /// 实现I2cOps Trait for HardwareIic
@@ -880,24 +1051,13 @@ impl SoftwareIic {
         };
         
         // 校验speed参数，确保在合法范围内
-        // 软件IIC通常支持10KHz到100KHz，过高的速率会导致通信失败
-        let validated_speed = if speed < 10_000 {
-            100_000 // 最低10KHz，默认100KHz
-        } else if speed > 200_000 {
-            100_000 // 最高200KHz，默认100KHz
+        // 半周期由DWT周期计数器定时，72MHz下可以稳定达到1MHz（Fm+）
+        let validated_speed = if speed < 10_000 || speed > 1_000_000 {
+            100_000 // 超出10KHz~1MHz范围时使用默认100KHz
         } else {
             speed
         };
         
-        // 根据speed计算合适的delay_us值
-        // 假设每个时钟周期需要两个延时（高电平+低电平）
-        // 例如：100KHz需要每个时钟周期10us，每个电平保持5us
-        let delay_us = if validated_speed > 0 {
-            (500_000 / validated_speed) as u32 // 500,000 / speed 计算出每个电平需要的微秒数
-        } else {
-            5 // 默认5us
-        };
-        
         let mut new_config = config;
         new_config.speed = validated_speed;
         
@@ -905,7 +1065,6 @@ impl SoftwareIic {
             config: new_config,
             scl, 
             sda, 
-            delay_us,
         }
     }
     
@@ -919,12 +1078,12 @@ impl SoftwareIic {
         
         Self::new(scl, sda, config.speed)
     }
-
+    
     /// 初始化软件IIC
     unsafe fn init(&self) {
         // 配置SCL和SDA为开漏输出
-        let scl: GpioPin = self.scl.into();
-        let sda: GpioPin = self.sda.into();
+        let scl: GpioPortStruct = self.scl.into();
+        let sda: GpioPortStruct = self.sda.into();
         
         scl.into_open_drain_output();
         sda.into_open_drain_output();
@@ -933,116 +1092,12 @@ impl SoftwareIic {
         scl.set_high();
         sda.set_high();
     }
-
-    /// 延时函数（空实现，与C语言版本保持一致）
-    fn delay(&self) {
-        // 与C语言版本保持一致，不添加任何延时
-    }
-
-    /// 生成起始信号
-    unsafe fn start(&self) {
-        let scl: GpioPin = self.scl.into();
-        let sda: GpioPin = self.sda.into();
-        
-        sda.set_high();
-        scl.set_high();
-        sda.set_low();
-        scl.set_low();
-    }
-
-    /// 生成停止信号
-    unsafe fn stop(&self) {
-        let scl: GpioPin = self.scl.into();
-        let sda: GpioPin = self.sda.into();
-        
-        sda.set_low();
-        scl.set_high();
-        sda.set_high();
-    }
-
-    /// 发送一个字节
-    unsafe fn send_byte(&self, byte: u8) -> IicResult<bool> {
-        let scl: GpioPin = self.scl.into();
-        let sda: GpioPin = self.sda.into();
-        
-        for i in 0..8 {
-            // 发送数据位
-            if (byte & (1 << (7 - i))) != 0 {
-                sda.set_high();
-            } else {
-                sda.set_low();
-            }
-            // 添加精确延时，确保数据位稳定
-            delay_us(self.delay_us);
-            scl.set_high();
-            // 添加精确延时，确保时钟脉冲宽度
-            delay_us(self.delay_us);
-            scl.set_low();
-            // 添加精确延时，确保数据位有足够时间变化
-            delay_us(self.delay_us);
-        }
-        
-        // 读取ACK
-        sda.set_high();
-        // 添加精确延时，确保SDA线释放
-        delay_us(self.delay_us);
-        scl.set_high();
-        // 添加精确延时，确保ACK位稳定
-        delay_us(self.delay_us);
-        
-        // 读取ACK状态
-        let ack = sda.is_low();
-        scl.set_low();
-        
-        // 不检查ACK，直接返回Ok(true)，与C示例代码一致
-        Ok(true)
-    }
-
-    /// 接收一个字节
-    unsafe fn recv_byte(&self, ack: bool) -> u8 {
-        let scl: GpioPin = self.scl.into();
-        let sda: GpioPin = self.sda.into();
-        
-        let mut byte = 0;
-        
-        // 释放SDA
-        sda.set_high();
-        
-        for i in 0..8 {
-            // 确保数据位稳定
-            delay_us(self.delay_us);
-            scl.set_high();
-            
-            // 确保时钟脉冲宽度，让从设备有足够时间准备数据
-            delay_us(self.delay_us);
-            
-            if sda.is_high() {
-                byte |= 1 << (7 - i);
-            }
-            
-            scl.set_low();
-            // 确保数据位有足够时间变化
-            delay_us(self.delay_us);
-        }
-        
-        // 发送ACK/NACK
-        if ack {
-            sda.set_low();
-        } else {
-            sda.set_high();
-        }
-        
-        // 确保ACK/NACK位稳定
-        delay_us(self.delay_us);
-        scl.set_high();
-        
-        // 确保时钟脉冲宽度
-        delay_us(self.delay_us);
-        scl.set_low();
-        
-        byte
+    
+    /// 创建本次事务使用的位时序
+    unsafe fn bus(&self) -> SoftwareIicBus {
+        SoftwareIicBus::new(self.scl.into(), self.sda.into(), self.config.speed)
     }
-
+    
     /// 写入数据到设备
     unsafe fn write(&self, addr: u8, data: &[u8]) -> IicResult<()> {
         // 检查数据长度
@@ -1050,26 +1105,21 @@ impl SoftwareIic {
             return Ok(());
         }
         
+        let mut bus = self.bus();
+        
         // 生成起始信号
-        self.start();
+        bus.start()?;
         
         // 发送设备地址（写入模式）
         // 直接使用传入的地址，不再区分7位或8位地址
         // OLED手册要求使用0x78地址
-        let addr_ack = self.send_byte(addr)?;
-        // 不检查地址ACK，与C示例代码一致
+        let result = bus.send_bytes(addr & !1, data);
         
-        // 发送数据
-        for &byte in data {
-            let data_ack = self.send_byte(byte)?;
-            // 不检查数据ACK，与C示例代码一致
-        }
-        
-        // 生成停止信号
-        self.stop();
-        Ok(())
+        // 无论成功与否都生成停止信号释放总线
+        bus.stop();
+        result
     }
-
+    
     /// 从设备读取数据
     unsafe fn read(&self, addr: u8, buffer: &mut [u8]) -> IicResult<()> {
         let len = buffer.len();
@@ -1079,26 +1129,44 @@ impl SoftwareIic {
             return Ok(());
         }
         
+        let mut bus = self.bus();
+        
         // 生成起始信号
-        self.start();
+        bus.start()?;
         
-        // 发送设备地址（读取模式）
-        let addr_byte = addr | 1; // 读取模式，最低位置1
-        let addr_ack = self.send_byte(addr_byte)?;
-        if !addr_ack {
-            self.stop();
-            return Err(IicError::NoAcknowledge);
-        }
+        // 发送设备地址（读取模式），最低位置1
+        let result = bus.recv_bytes(addr | 1, buffer);
         
-        // 读取数据
-        for i in 0..len {
-            let ack = i < len - 1;
-            buffer[i] = self.recv_byte(ack);
+        // 生成停止信号
+        bus.stop();
+        result
+    }
+    
+    /// 先写后读（中间使用重复起始信号，不释放总线）
+    /// 
+    /// 用于读取传感器等设备的寄存器：先写入寄存器地址，再重复起始读取数据。
+    /// 
+    /// # Arguments
+    /// * `addr` - 设备的8位地址
+    /// * `tx` - 要写入的数据（通常为寄存器地址）
+    /// * `rx` - 接收缓冲区
+    /// 
+    /// # Returns
+    /// 成功返回Ok(())，任意字节未应答返回`IicError::NoAcknowledge`
+    pub unsafe fn write_read(&self, addr: u8, tx: &[u8], rx: &mut [u8]) -> IicResult<()> {
+        let mut bus = self.bus();
+        
+        bus.start()?;
+        let mut result = bus.send_bytes(addr & !1, tx);
+        if result.is_ok() && !rx.is_empty() {
+            result = match bus.start() {
+                Ok(()) => bus.recv_bytes(addr | 1, rx),
+                Err(e) => Err(e),
+            };
         }
         
-        // 生成停止信号
-        self.stop();
-        Ok(())
+        bus.stop();
+        result
     }
     
     /// 重置IIC，恢复总线通信
@@ -1108,6 +1176,203 @@ impl SoftwareIic {
     }
 }
 
+/// 软件IIC单次事务的位时序
+/// 
+/// SCL/SDA的电平通过一次BSRR/BRR写入改变，每个半周期用DWT周期计数器定时：
+/// 从上一个边沿开始计数，等到满半周期才产生下一个边沿，因此中断打断只会拉长
+/// 时钟而不会缩短。释放SCL后等待其真正变高，支持从机时钟延展。
+struct SoftwareIicBus {
+    scl_port: usize,
+    scl_mask: u32,
+    sda_port: usize,
+    sda_mask: u32,
+    /// 半周期（系统时钟周期数）
+    half: u32,
+    /// 时钟延展超时（系统时钟周期数）
+    stretch_timeout: u32,
+    /// 上一个边沿的周期计数
+    mark: u32,
+}
+
+impl SoftwareIicBus {
+    /// BSRR寄存器偏移
+    const BSRR: usize = 0x10;
+    /// BRR寄存器偏移
+    const BRR: usize = 0x14;
+    /// IDR寄存器偏移
+    const IDR: usize = 0x08;
+    
+    /// 根据引脚和速率创建位时序
+    unsafe fn new(scl: GpioPortStruct, sda: GpioPortStruct, speed: u32) -> Self {
+        enable_cycle_counter();
+        
+        let sysclk = system_clock();
+        let half = (sysclk / (speed.max(1) * 2)).max(1);
+        
+        Self {
+            scl_port: scl.port_address(),
+            scl_mask: 1 << scl.pin,
+            sda_port: sda.port_address(),
+            sda_mask: 1 << sda.pin,
+            half,
+            // 允许从机延展时钟最多1ms
+            stretch_timeout: sysclk / 1000,
+            mark: cycle_count(),
+        }
+    }
+    
+    /// 等待自上一个边沿起满半周期，并记录新的边沿时刻
+    #[inline(always)]
+    fn wait_half(&mut self) {
+        while cycle_count().wrapping_sub(self.mark) < self.half {}
+        self.mark = cycle_count();
+    }
+    
+    #[inline(always)]
+    unsafe fn write(port: usize, offset: usize, value: u32) {
+        core::ptr::write_volatile((port + offset) as *mut u32, value);
+    }
+    
+    #[inline(always)]
+    unsafe fn read(port: usize) -> u32 {
+        core::ptr::read_volatile((port + Self::IDR) as *const u32)
+    }
+    
+    #[inline(always)]
+    unsafe fn scl_low(&self) {
+        Self::write(self.scl_port, Self::BRR, self.scl_mask);
+    }
+    
+    /// 释放SCL并等待其变高（时钟延展）
+    #[inline(always)]
+    unsafe fn scl_high(&mut self) -> IicResult<()> {
+        Self::write(self.scl_port, Self::BSRR, self.scl_mask);
+        
+        let start = cycle_count();
+        while (Self::read(self.scl_port) & self.scl_mask) == 0 {
+            if cycle_count().wrapping_sub(start) > self.stretch_timeout {
+                return Err(IicError::Timeout);
+            }
+        }
+        // 延展结束后重新开始计算高电平时间
+        self.mark = cycle_count();
+        Ok(())
+    }
+    
+    #[inline(always)]
+    unsafe fn sda_set(&self, high: bool) {
+        if high {
+            Self::write(self.sda_port, Self::BSRR, self.sda_mask);
+        } else {
+            Self::write(self.sda_port, Self::BRR, self.sda_mask);
+        }
+    }
+    
+    #[inline(always)]
+    unsafe fn sda_is_high(&self) -> bool {
+        (Self::read(self.sda_port) & self.sda_mask) != 0
+    }
+    
+    /// 生成起始信号（总线空闲或SCL为低时均可调用，后者即重复起始）
+    unsafe fn start(&mut self) -> IicResult<()> {
+        self.sda_set(true);
+        self.wait_half();
+        self.scl_high()?;
+        self.wait_half();
+        if !self.sda_is_high() {
+            // SDA被其他设备拉低，总线忙
+            return Err(IicError::Busy);
+        }
+        self.sda_set(false);
+        self.wait_half();
+        self.scl_low();
+        self.mark = cycle_count();
+        Ok(())
+    }
+    
+    /// 生成停止信号
+    unsafe fn stop(&mut self) {
+        self.sda_set(false);
+        self.wait_half();
+        // 停止信号失败时总线已无法恢复，只能交给reset处理
+        let _ = self.scl_high();
+        self.wait_half();
+        self.sda_set(true);
+        self.wait_half();
+    }
+    
+    /// 发送一个字节
+    /// 
+    /// # Returns
+    /// 从机应答返回Ok(true)，未应答返回Ok(false)
+    unsafe fn send_byte(&mut self, byte: u8) -> IicResult<bool> {
+        for i in (0..8).rev() {
+            // SCL为低时改变数据位
+            self.sda_set((byte >> i) & 1 != 0);
+            self.wait_half();
+            self.scl_high()?;
+            self.wait_half();
+            self.scl_low();
+        }
+        
+        // 释放SDA，在第9个时钟读取ACK
+        self.sda_set(true);
+        self.wait_half();
+        self.scl_high()?;
+        self.wait_half();
+        let ack = !self.sda_is_high();
+        self.scl_low();
+        Ok(ack)
+    }
+    
+    /// 接收一个字节并发送ACK/NACK
+    unsafe fn recv_byte(&mut self, ack: bool) -> IicResult<u8> {
+        let mut byte = 0u8;
+        
+        // 释放SDA
+        self.sda_set(true);
+        for _ in 0..8 {
+            self.wait_half();
+            self.scl_high()?;
+            self.wait_half();
+            byte = (byte << 1) | self.sda_is_high() as u8;
+            self.scl_low();
+        }
+        
+        self.sda_set(!ack);
+        self.wait_half();
+        self.scl_high()?;
+        self.wait_half();
+        self.scl_low();
+        Ok(byte)
+    }
+    
+    /// 发送地址和数据，任意字节未应答时立即返回
+    unsafe fn send_bytes(&mut self, addr: u8, data: &[u8]) -> IicResult<()> {
+        if !self.send_byte(addr)? {
+            return Err(IicError::NoAcknowledge);
+        }
+        for &byte in data {
+            if !self.send_byte(byte)? {
+                return Err(IicError::NoAcknowledge);
+            }
+        }
+        Ok(())
+    }
+    
+    /// 发送读地址并接收数据，最后一个字节回复NACK
+    unsafe fn recv_bytes(&mut self, addr: u8, buffer: &mut [u8]) -> IicResult<()> {
+        if !self.send_byte(addr)? {
+            return Err(IicError::NoAcknowledge);
+        }
+        let len = buffer.len();
+        for (i, byte) in buffer.iter_mut().enumerate() {
+            *byte = self.recv_byte(i + 1 < len)?;
+        }
+        Ok(())
+    }
+}
+
 /// 实现I2cOps Trait for SoftwareIic
 impl I2cOps for SoftwareIic {
     unsafe fn init(&self) {
@@ -1178,7 +1443,7 @@ impl IicDevice {
             software: None,
         }
     }
-
+    
     /// 创建软件IIC设备
     /// 
     /// # Arguments
@@ -1202,7 +1467,22 @@ impl IicDevice {
             software: Some(software),
         }
     }
-
+    
+    /// 时钟切换后重新设置硬件IIC的SCL时序
+    /// 
+    /// 软件IIC每次传输时按当前系统时钟计算半周期，不需要处理
+    /// 
+    /// # Arguments
+    /// * `clocks` - 切换后的时钟频率
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，调用时不能有正在进行的传输
+    pub unsafe fn retime(&mut self, clocks: &SystemClocks) {
+        if let Some(hardware) = self.hardware.as_mut() {
+            hardware.retime(clocks);
+        }
+    }
+    
     /// 获取I2cOps实现（内部使用）
     /// 
     /// 根据当前IIC模式，返回对应的I2cOps实现
@@ -1231,7 +1511,7 @@ impl IicDevice {
             },
         }
     }
-
+    
     /// 写入数据到设备（安全API）
     /// 
     /// 向设备写入任意长度的数据，内部封装了unsafe操作，用户无需手动添加unsafe块
@@ -1249,7 +1529,7 @@ impl IicDevice {
             Ok(())
         }
     }
-
+    
     /// 从设备读取数据（安全API）
     /// 
     /// 从设备读取任意长度的数据，内部封装了unsafe操作，用户无需手动添加unsafe块
@@ -1282,7 +1562,7 @@ impl IicDevice {
             Ok(())
         }
     }
-
+    
     /// 写入单个字节到设备（安全API）
     /// 
     /// 向设备写入单个字节，内部封装了write方法
@@ -1297,7 +1577,7 @@ impl IicDevice {
         let data = [byte];
         self.write(&data)
     }
-
+    
     /// 从设备读取单个字节（安全API）
     /// 
     /// 从设备读取单个字节，内部封装了read方法
@@ -1355,3 +1635,647 @@ pub mod devices {
         IicDevice::new_software(iic_addr, scl, sda, speed)
     }
 }
+
+/// IIC事务完成回调（在中断上下文中调用）
+pub type IicCallback = fn(IicResult<()>);
+
+/// 排队的IIC事务
+/// 
+/// 支持只写、只读以及写后重复起始再读（如读取传感器寄存器）。
+/// 缓冲区必须为`'static`，在回调被调用前一直由引擎使用。
+#[derive(Clone, Copy)]
+pub struct IicJob {
+    addr: u8,
+    tx: *const u8,
+    tx_len: usize,
+    rx: *mut u8,
+    rx_len: usize,
+    callback: Option<IicCallback>,
+}
+
+impl IicJob {
+    /// 只写事务
+    /// 
+    /// # Arguments
+    /// * `addr` - 设备的8位IIC地址
+    /// * `data` - 要写入的数据，长度为0时只发送地址（用于探测设备）
+    pub fn write(addr: u8, data: &'static [u8]) -> Self {
+        Self {
+            addr: addr & !1,
+            tx: data.as_ptr(),
+            tx_len: data.len(),
+            rx: core::ptr::null_mut(),
+            rx_len: 0,
+            callback: None,
+        }
+    }
+    
+    /// 只读事务
+    pub fn read(addr: u8, buffer: &'static mut [u8]) -> Self {
+        Self {
+            addr: addr & !1,
+            tx: core::ptr::null(),
+            tx_len: 0,
+            rx: buffer.as_mut_ptr(),
+            rx_len: buffer.len(),
+            callback: None,
+        }
+    }
+    
+    /// 写后读事务（写入后不发停止信号，直接重复起始进入读取）
+    pub fn write_read(addr: u8, tx: &'static [u8], rx: &'static mut [u8]) -> Self {
+        Self {
+            addr: addr & !1,
+            tx: tx.as_ptr(),
+            tx_len: tx.len(),
+            rx: rx.as_mut_ptr(),
+            rx_len: rx.len(),
+            callback: None,
+        }
+    }
+    
+    /// 设置完成回调
+    pub fn with_callback(mut self, callback: IicCallback) -> Self {
+        self.callback = Some(callback);
+        self
+    }
+}
+
+/// 事务状态机阶段
+#[derive(Clone, Copy, PartialEq, Debug)]
+enum IicPhase {
+    /// 等待起始信号（SB），`read`表示随后发送读地址
+    Start { read: bool },
+    /// 等待地址应答（ADDR）
+    Address { read: bool },
+    /// 逐字节发送（不超过2字节，TXE中断）
+    WriteBytes,
+    /// DMA发送中
+    WriteDma,
+    /// 等待最后一个字节移出（BTF）
+    WriteFlush,
+    /// 接收1字节
+    ReadOne,
+    /// 接收2字节（POS方式）
+    ReadTwo,
+    /// DMA接收中
+    ReadDma,
+}
+
+/// 正在进行的事务
+struct IicActiveJob {
+    job: IicJob,
+    phase: IicPhase,
+    index: usize,
+    /// 入队序号
+    ticket: usize,
+}
+
+/// 中断/DMA驱动的IIC主机事务引擎（I2C1）
+/// 
+/// 所有时序都在EV/ER中断和DMA中断中推进，主循环只需提交事务并在回调或
+/// `take_result`中取结果，不再忙等事件标志。超过2字节的数据段由DMA搬运
+/// （发送DMA1通道6，接收DMA1通道7），1~2字节的数据段按参考手册的专用时序处理。
+/// 
+/// 使用时需要：
+/// - 用`init`初始化I2C1
+/// - 在`I2C1_EV`中断中调用`handle_event_interrupt`，在`I2C1_ER`中断中调用`handle_error_interrupt`
+/// - 在DMA1通道6和通道7中断中调用`handle_dma_interrupt`
+/// - 在NVIC中使能以上四个中断
+/// - 只用回调取结果时在主循环中调用`poll`（`transact_async`会自动调用）
+/// 
+/// 除回调外也可以用`transact_async`在异步任务中等待事务完成。
+/// 
+/// 引擎独占I2C1和DMA1通道6/7，不能与`c_oled`或`oled::Ssd1306`同时使用
+/// （两者也使用I2C1和DMA1通道6）。
+pub struct IicEngine<const Q: usize> {
+    queue: UnsafeCell<[Option<IicJob>; Q]>,
+    head: AtomicUsize,
+    tail: AtomicUsize,
+    current: UnsafeCell<Option<IicActiveJob>>,
+    busy: AtomicBool,
+    /// 上一个事务的停止信号尚未发完，下一个事务留在队列中等待`poll`启动
+    restart: AtomicBool,
+    /// 最近一次完成的结果（0无、1成功、其它为错误编码）
+    last_result: AtomicU8,
+    /// 已完成的事务数（即下一个完成的事务的入队序号）
+    completed: AtomicUsize,
+    /// 按入队序号保存的结果编码，供异步等待取回
+    results: [AtomicU8; Q],
+    /// 异步等待事务完成的任务
+    waker: WakerSlot,
+}
+
+/// 实现 Sync trait，队列修改在临界区内进行，状态机只在中断中推进
+unsafe impl<const Q: usize> Sync for IicEngine<Q> {}
+
+impl<const Q: usize> IicEngine<Q> {
+    /// 编译期检查队列深度
+    const SIZE_CHECK: () = assert!(Q.is_power_of_two() && Q <= 256, "IicEngine队列深度必须是2的幂且不超过256");
+    
+    /// 结果数组初始值
+    const RESULT_INIT: AtomicU8 = AtomicU8::new(0);
+    
+    /// 创建新的事务引擎
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            queue: UnsafeCell::new([None; Q]),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+            current: UnsafeCell::new(None),
+            busy: AtomicBool::new(false),
+            restart: AtomicBool::new(false),
+            last_result: AtomicU8::new(0),
+            completed: AtomicUsize::new(0),
+            results: [Self::RESULT_INIT; Q],
+            waker: WakerSlot::new(),
+        }
+    }
+    
+    /// 获取I2C1寄存器块
+    #[inline(always)]
+    unsafe fn i2c() -> &'static mut library::i2c1::RegisterBlock {
+        &mut *(0x40005400 as *mut library::i2c1::RegisterBlock)
+    }
+    
+    /// 修改CR1
+    #[inline(always)]
+    unsafe fn cr1_modify(set: u32, clear: u32) {
+        Self::i2c().cr1().modify(|r, w| w.bits((r.bits() & !clear) | set));
+    }
+    
+    /// 修改CR2
+    #[inline(always)]
+    unsafe fn cr2_modify(set: u32, clear: u32) {
+        Self::i2c().cr2().modify(|r, w| w.bits((r.bits() & !clear) | set));
+    }
+    
+    /// 初始化I2C1
+    /// 
+    /// # Arguments
+    /// * `iic` - 提供时钟、速率和引脚配置的硬件IIC
+    pub unsafe fn init(&self, iic: &HardwareIic) {
+        I2cOps::init(iic);
+        Self::cr2_modify(0, I2C_CR2_ITERREN | I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+    }
+    
+    /// 是否有正在进行或排队的事务
+    pub fn is_busy(&self) -> bool {
+        self.busy.load(Ordering::Acquire)
+    }
+    
+    /// 取出最近一次完成的事务结果
+    pub fn take_result(&self) -> Option<IicResult<()>> {
+        match self.last_result.swap(0, Ordering::Acquire) {
+            0 => None,
+            1 => Some(Ok(())),
+            code => Some(Err(Self::decode_error(code))),
+        }
+    }
+    
+    /// 错误编码
+    fn encode_result(result: IicResult<()>) -> u8 {
+        match result {
+            Ok(()) => 1,
+            Err(IicError::NoAcknowledge) => 2,
+            Err(IicError::ArbitrationLost) => 3,
+            Err(IicError::BusError) => 4,
+            Err(IicError::Overrun) => 5,
+            Err(IicError::Timeout) => 6,
+            Err(IicError::Busy) => 7,
+            Err(IicError::InvalidParam) => 8,
+            Err(_) => 9,
+        }
+    }
+    
+    /// 错误解码
+    fn decode_error(code: u8) -> IicError {
+        match code {
+            2 => IicError::NoAcknowledge,
+            3 => IicError::ArbitrationLost,
+            4 => IicError::BusError,
+            5 => IicError::Overrun,
+            6 => IicError::Timeout,
+            7 => IicError::Busy,
+            8 => IicError::InvalidParam,
+            _ => IicError::HardwareError,
+        }
+    }
+    
+    /// 把事务加入队列，引擎空闲时立即开始
+    /// 
+    /// # Returns
+    /// 队列满或长度超过65535时返回`Err(job)`
+    pub fn enqueue(&self, job: IicJob) -> Result<(), IicJob> {
+        self.enqueue_ticket(job).map(|_| ())
+    }
+    
+    /// 把事务加入队列，成功时返回入队序号
+    fn enqueue_ticket(&self, job: IicJob) -> Result<usize, IicJob> {
+        if job.tx_len > u16::MAX as usize || job.rx_len > u16::MAX as usize {
+            return Err(job);
+        }
+        
+        cortex_m::interrupt::free(|_| unsafe {
+            let head = self.head.load(Ordering::Relaxed);
+            let tail = self.tail.load(Ordering::Relaxed);
+            if head.wrapping_sub(tail) >= Q {
+                return Err(job);
+            }
+            (*self.queue.get())[head & (Q - 1)] = Some(job);
+            self.head.store(head.wrapping_add(1), Ordering::Relaxed);
+            
+            if !self.busy.load(Ordering::Relaxed) {
+                self.busy.store(true, Ordering::Release);
+                self.start_next();
+            } else {
+                self.resume();
+            }
+            Ok(head)
+        })
+    }
+    
+    /// 启动因等待停止信号而推迟的事务
+    /// 
+    /// 中断中结束一个事务时，若停止信号还在总线上发送（CR1的STOP位未清除），
+    /// 下一个事务不在中断中等待，而是留在队列中由这里启动。停止信号只需数个SCL周期，
+    /// 只用回调的应用应在主循环中调用；`enqueue`和`transact_async`也会调用。
+    /// 
+    /// # Returns
+    /// 仍有推迟的事务未能启动时返回`true`
+    pub fn poll(&self) -> bool {
+        if !self.restart.load(Ordering::Acquire) {
+            return false;
+        }
+        cortex_m::interrupt::free(|_| unsafe { self.resume() });
+        self.restart.load(Ordering::Acquire)
+    }
+    
+    /// 停止信号已发完时启动推迟的事务（临界区或中断中调用）
+    unsafe fn resume(&self) {
+        if self.restart.load(Ordering::Relaxed) && (Self::i2c().cr1().read().bits() & I2C_CR1_STOP) == 0 {
+            self.restart.store(false, Ordering::Relaxed);
+            self.start_next();
+        }
+    }
+    
+    /// 异步执行一个事务，返回它自己的结果
+    /// 
+    /// 队列满时等待有事务完成后重试。结果按入队序号保存在长度为`Q`的数组中，
+    /// 等待期间又完成了`Q`个以上的事务时结果会被覆盖。
+    /// 唤醒槽位只有一个，同一个引擎只应由一个任务异步等待（其他代码仍可使用回调）。
+    pub async fn transact_async(&self, mut job: IicJob) -> IicResult<()> {
+        let _active = idle::hold(Activity::Iic);
+        let ticket = loop {
+            match self.enqueue_ticket(job) {
+                Ok(ticket) => break ticket,
+                Err(rejected) => {
+                    if rejected.tx_len > u16::MAX as usize || rejected.rx_len > u16::MAX as usize {
+                        return Err(IicError::InvalidParam);
+                    }
+                    job = rejected;
+                    let seen = self.completed.load(Ordering::Acquire);
+                    executor::wait_for(
+                        || if self.completed.load(Ordering::Acquire) != seen { Some(()) } else { None },
+                        |waker| self.arm(waker),
+                    ).await;
+                }
+            }
+        };
+        
+        executor::wait_for(
+            || {
+                let done = self.completed.load(Ordering::Acquire).wrapping_sub(ticket) as isize > 0;
+                if done {
+                    match self.results[ticket & (Q - 1)].load(Ordering::Relaxed) {
+                        1 => Some(Ok(())),
+                        code => Some(Err(Self::decode_error(code))),
+                    }
+                } else {
+                    None
+                }
+            },
+            |waker| self.arm(waker),
+        ).await
+    }
+    
+    /// 登记唤醒器；有推迟的事务时立即再次唤醒，由执行器轮询到停止信号发完
+    fn arm(&self, waker: &Waker) {
+        self.waker.register(waker);
+        if self.poll() {
+            waker.wake_by_ref();
+        }
+    }
+    
+    /// 取出并启动下一个事务（临界区或中断中调用）
+    unsafe fn start_next(&self) {
+        let tail = self.tail.load(Ordering::Relaxed);
+        if tail == self.head.load(Ordering::Relaxed) {
+            self.busy.store(false, Ordering::Release);
+            return;
+        }
+        
+        // 上一个事务的停止信号还在发送时不能写CR1，事务留在队列中由`poll`启动，
+        // 不在中断中等待
+        if (Self::i2c().cr1().read().bits() & I2C_CR1_STOP) != 0 {
+            self.restart.store(true, Ordering::Release);
+            return;
+        }
+        let job = (*self.queue.get())[tail & (Q - 1)].take();
+        self.tail.store(tail.wrapping_add(1), Ordering::Relaxed);
+        let ticket = tail;
+        
+        let job = match job {
+            Some(job) => job,
+            None => return self.start_next(),
+        };
+        
+        let read = job.tx_len == 0 && job.rx_len > 0;
+        *self.current.get() = Some(IicActiveJob {
+            job,
+            phase: IicPhase::Start { read },
+            index: 0,
+            ticket,
+        });
+        
+        Self::cr2_modify(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN, I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+        Self::cr1_modify(I2C_CR1_ACK | I2C_CR1_START, I2C_CR1_POS);
+    }
+    
+    /// 结束当前事务并启动下一个
+    unsafe fn complete(&self, result: IicResult<()>) {
+        Self::cr2_modify(0, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+        
+        let active = (*self.current.get()).take();
+        let code = Self::encode_result(result);
+        self.last_result.store(code, Ordering::Release);
+        if let Some(active) = active {
+            self.results[active.ticket & (Q - 1)].store(code, Ordering::Relaxed);
+            self.completed.store(active.ticket.wrapping_add(1), Ordering::Release);
+            if let Some(callback) = active.job.callback {
+                callback(result);
+            }
+        }
+        self.waker.wake();
+        self.start_next();
+    }
+    
+    /// 启动一段DMA传输（带完成和错误中断）
+    unsafe fn start_dma(dma: Dma, desc: DmaTransferDescriptor) -> bool {
+        dma.start(&desc.with_priority(DmaChannelPriority::High).with_interrupts(true, false, true)).is_ok()
+    }
+    
+    /// 写阶段结束：需要读取时产生重复起始，否则产生停止信号
+    unsafe fn finish_write(&self, active: &mut IicActiveJob) {
+        if active.job.rx_len > 0 {
+            active.phase = IicPhase::Start { read: true };
+            Self::cr1_modify(I2C_CR1_START, 0);
+        } else {
+            Self::cr1_modify(I2C_CR1_STOP, 0);
+            self.complete(Ok(()));
+        }
+    }
+    
+    /// 处理I2C1事件中断（EV）
+    pub fn handle_event_interrupt(&self) {
+        unsafe {
+            let i2c = Self::i2c();
+            let active = match &mut *self.current.get() {
+                Some(active) => active,
+                None => {
+                    // 没有事务时关闭事件中断，避免残留标志反复触发
+                    Self::cr2_modify(0, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+                    return;
+                },
+            };
+            let sr1 = i2c.sr1().read().bits();
+            
+            match active.phase {
+                IicPhase::Start { read } => {
+                    if (sr1 & I2C_SR1_SB) != 0 {
+                        // EV5：写地址清除SB
+                        let addr = if read { active.job.addr | 1 } else { active.job.addr };
+                        i2c.dr().write(|w| w.bits(addr as u32));
+                        active.phase = IicPhase::Address { read };
+                    }
+                },
+                IicPhase::Address { read: false } => {
+                    if (sr1 & I2C_SR1_ADDR) == 0 {
+                        return;
+                    }
+                    let len = active.job.tx_len;
+                    if len > 2 {
+                        let desc = DmaTransferDescriptor::memory_to_peripheral(active.job.tx as u32, I2C1_DR_ADDRESS, len as u16);
+                        if !Self::start_dma(I2C1_TX_DMA, desc) {
+                            let _ = i2c.sr2().read();
+                            Self::cr1_modify(I2C_CR1_STOP, 0);
+                            self.complete(Err(IicError::Busy));
+                            return;
+                        }
+                        Self::cr2_modify(I2C_CR2_DMAEN, 0);
+                        active.phase = IicPhase::WriteDma;
+                        let _ = i2c.sr2().read();
+                    } else if len > 0 {
+                        active.phase = IicPhase::WriteBytes;
+                        let _ = i2c.sr2().read();
+                        Self::cr2_modify(I2C_CR2_ITBUFEN, 0);
+                    } else {
+                        // 只发送地址
+                        let _ = i2c.sr2().read();
+                        self.finish_write(active);
+                    }
+                },
+                IicPhase::WriteBytes => {
+                    if (sr1 & I2C_SR1_TXE) != 0 && active.index < active.job.tx_len {
+                        let byte = *active.job.tx.add(active.index);
+                        i2c.dr().write(|w| w.bits(byte as u32));
+                        active.index += 1;
+                        if active.index == active.job.tx_len {
+                            Self::cr2_modify(0, I2C_CR2_ITBUFEN);
+                            active.phase = IicPhase::WriteFlush;
+                        }
+                    }
+                },
+                IicPhase::WriteDma | IicPhase::WriteFlush => {
+                    // DMA发送期间BTF只会在DMA已写完最后一个字节后出现
+                    if (sr1 & I2C_SR1_BTF) != 0 && (active.phase == IicPhase::WriteFlush || I2C1_TX_DMA.get_remaining_count() == 0) {
+                        Self::cr2_modify(0, I2C_CR2_DMAEN);
+                        I2C1_TX_DMA.disable();
+                        I2C1_TX_DMA.clear_all_interrupts();
+                        self.finish_write(active);
+                    }
+                },
+                IicPhase::Address { read: true } => {
+                    if (sr1 & I2C_SR1_ADDR) == 0 {
+                        return;
+                    }
+                    match active.job.rx_len {
+                        1 => {
+                            // 单字节：清ADDR前关闭ACK，清ADDR后立即请求停止
+                            Self::cr1_modify(0, I2C_CR1_ACK);
+                            let _ = i2c.sr2().read();
+                            Self::cr1_modify(I2C_CR1_STOP, 0);
+                            active.phase = IicPhase::ReadOne;
+                            Self::cr2_modify(I2C_CR2_ITBUFEN, 0);
+                        },
+                        2 => {
+                            // 两字节：POS=1、ACK=0，等待BTF后停止并连续读取
+                            Self::cr1_modify(I2C_CR1_POS, I2C_CR1_ACK);
+                            let _ = i2c.sr2().read();
+                            active.phase = IicPhase::ReadTwo;
+                        },
+                        len => {
+                            // 多字节：DMA接收，LAST位使硬件在最后一个字节后NACK
+                            let desc = DmaTransferDescriptor::peripheral_to_memory(I2C1_DR_ADDRESS, active.job.rx as u32, len as u16);
+                            if !Self::start_dma(I2C1_RX_DMA, desc) {
+                                let _ = i2c.sr2().read();
+                                Self::cr1_modify(I2C_CR1_STOP, 0);
+                                self.complete(Err(IicError::Busy));
+                                return;
+                            }
+                            Self::cr2_modify(I2C_CR2_DMAEN | I2C_CR2_LAST, 0);
+                            active.phase = IicPhase::ReadDma;
+                            let _ = i2c.sr2().read();
+                        },
+                    }
+                },
+                IicPhase::ReadOne => {
+                    if (sr1 & I2C_SR1_RXNE) != 0 {
+                        *active.job.rx = i2c.dr().read().bits() as u8;
+                        self.complete(Ok(()));
+                    }
+                },
+                IicPhase::ReadTwo => {
+                    if (sr1 & I2C_SR1_BTF) != 0 {
+                        Self::cr1_modify(I2C_CR1_STOP, 0);
+                        *active.job.rx = i2c.dr().read().bits() as u8;
+                        *active.job.rx.add(1) = i2c.dr().read().bits() as u8;
+                        Self::cr1_modify(0, I2C_CR1_POS);
+                        self.complete(Ok(()));
+                    }
+                },
+                IicPhase::ReadDma => {
+                    // 数据由DMA读取，结束在DMA中断中处理
+                },
+            }
+        }
+    }
+    
+    /// 处理I2C1错误中断（ER）
+    pub fn handle_error_interrupt(&self) {
+        unsafe {
+            let i2c = Self::i2c();
+            let sr1 = i2c.sr1().read().bits();
+            let errors = sr1 & I2C_SR1_ERRORS;
+            if errors == 0 {
+                return;
+            }
+            
+            // 错误标志写0清除
+            i2c.sr1().write(|w| w.bits(!errors & 0xFFFF));
+            
+            let error = if (errors & I2C_SR1_AF) != 0 {
+                IicError::NoAcknowledge
+            } else if (errors & I2C_SR1_ARLO) != 0 {
+                IicError::ArbitrationLost
+            } else if (errors & I2C_SR1_BERR) != 0 {
+                IicError::BusError
+            } else if (errors & I2C_SR1_OVR) != 0 {
+                IicError::Overrun
+            } else {
+                IicError::Timeout
+            };
+            
+            // 仲裁丢失后硬件已自动退出主模式，其它错误需要主动释放总线
+            if (errors & I2C_SR1_ARLO) == 0 {
+                Self::cr1_modify(I2C_CR1_STOP, 0);
+            }
+            
+            self.abort_dma();
+            if (*self.current.get()).is_some() {
+                self.complete(Err(error));
+            }
+        }
+    }
+    
+    /// 处理DMA1通道6/7中断
+    pub fn handle_dma_interrupt(&self) {
+        unsafe {
+            let active = match &mut *self.current.get() {
+                Some(active) => active,
+                None => {
+                    I2C1_TX_DMA.clear_all_interrupts();
+                    I2C1_RX_DMA.clear_all_interrupts();
+                    return;
+                },
+            };
+            
+            if I2C1_TX_DMA.check_interrupt(DmaInterrupt::TransferError) || I2C1_RX_DMA.check_interrupt(DmaInterrupt::TransferError) {
+                self.abort_dma();
+                Self::cr1_modify(I2C_CR1_STOP, 0);
+                self.complete(Err(IicError::HardwareError));
+                return;
+            }
+            
+            if I2C1_TX_DMA.check_interrupt(DmaInterrupt::TransferComplete) {
+                // 最后一个字节仍在移位寄存器中，等待BTF事件
+                I2C1_TX_DMA.disable();
+                I2C1_TX_DMA.clear_all_interrupts();
+                Self::cr2_modify(0, I2C_CR2_DMAEN);
+                if active.phase == IicPhase::WriteDma {
+                    active.phase = IicPhase::WriteFlush;
+                }
+            }
+            
+            if I2C1_RX_DMA.check_interrupt(DmaInterrupt::TransferComplete) {
+                I2C1_RX_DMA.disable();
+                I2C1_RX_DMA.clear_all_interrupts();
+                if active.phase == IicPhase::ReadDma {
+                    Self::cr1_modify(I2C_CR1_STOP, 0);
+                    self.complete(Ok(()));
+                }
+            }
+        }
+    }
+    
+    /// 关闭两个DMA通道并清除I2C的DMA请求
+    unsafe fn abort_dma(&self) {
+        Self::cr2_modify(0, I2C_CR2_DMAEN | I2C_CR2_LAST);
+        I2C1_TX_DMA.disable();
+        I2C1_TX_DMA.clear_all_interrupts();
+        I2C1_RX_DMA.disable();
+        I2C1_RX_DMA.clear_all_interrupts();
+    }
+    
+    /// 中止当前事务并清空队列
+    /// 
+    /// 用于主循环检测到事务长时间未完成（如设备拉住SCL）时恢复总线，
+    /// 当前事务以`IicError::Timeout`结束，排队的事务被丢弃且不调用回调。
+    pub unsafe fn abort(&self, iic: &HardwareIic) {
+        cortex_m::interrupt::free(|_| {
+            self.abort_dma();
+            Self::cr2_modify(0, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN);
+            let tail = self.head.load(Ordering::Relaxed);
+            self.tail.store(tail, Ordering::Relaxed);
+            if let Some(active) = (*self.current.get()).take() {
+                self.last_result.store(Self::encode_result(Err(IicError::Timeout)), Ordering::Release);
+                if let Some(callback) = active.job.callback {
+                    callback(Err(IicError::Timeout));
+                }
+            }
+            // 当前和排队中的事务都按超时结束，异步等待者不会一直挂起
+            let timeout = Self::encode_result(Err(IicError::Timeout));
+            let mut ticket = self.completed.load(Ordering::Relaxed);
+            while ticket != tail {
+                self.results[ticket & (Q - 1)].store(timeout, Ordering::Relaxed);
+                ticket = ticket.wrapping_add(1);
+            }
+            self.completed.store(tail, Ordering::Release);
+            self.waker.wake();
+            self.restart.store(false, Ordering::Relaxed);
+            self.busy.store(false, Ordering::Release);
+            iic.reset();
+        });
+    }
+}
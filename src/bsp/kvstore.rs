@@ -0,0 +1,663 @@
+//! 键值存储模块
+//! 基于FLASH页的日志结构键值存储，提供磨损均衡、掉电安全和垃圾回收
+//! 
+//! 存储区由`P`个连续的FLASH页组成环形日志：
+//! - 每次更新只在当前页末尾追加一条记录，不擦除整页
+//! - 当前页写满时进入下一个空页，空页用完前把最旧页中仍然有效的记录搬到新页后擦除该页
+//! - 各页轮流成为写入页，擦除次数平均分布在所有页上
+//! 
+//! 页头（8字节）：`magic: u16, 保留: u16, sequence: u32`，序号先于magic写入，
+//! 因此magic有效即表示页头完整。
+//! 
+//! 记录（半字对齐）：`key: u16, meta: u16, value: [u8; len]（补齐到偶数）, crc: u32`，
+//! `meta`的低15位为值长度，最高位为删除标记，CRC为标准CRC-32（覆盖key、meta和value）。
+//! 记录按key、meta、value、crc的顺序编程，掉电中断的记录CRC不匹配，上电扫描时被忽略。
+
+#![allow(unused)]
+
+use crate::bsp::crc::CRC;
+use crate::bsp::flash::{FlashError, FLASH, FLASH_PAGE_SIZE, FLASH_ERASED_HALF_WORD};
+
+/// 页头magic（"KV"）
+const KV_PAGE_MAGIC: u16 = 0x4B56;
+
+/// 页头长度
+const KV_PAGE_HEADER: u32 = 8;
+
+/// 未使用的页序号
+const KV_SEQUENCE_NONE: u32 = 0xFFFF_FFFF;
+
+/// 记录头长度（key + meta）
+const KV_RECORD_HEADER: u32 = 4;
+
+/// 记录尾长度（CRC）
+const KV_RECORD_TRAILER: u32 = 4;
+
+/// 删除标记
+const KV_META_DELETED: u16 = 0x8000;
+
+/// 无效键（擦除状态）
+pub const KV_KEY_NONE: u16 = 0xFFFF;
+
+/// 单个值的最大长度（字节）
+pub const KV_MAX_VALUE: usize = 256;
+
+/// 键值存储错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum KvError {
+    /// 键为`KV_KEY_NONE`
+    InvalidKey,
+    /// 值超过`KV_MAX_VALUE`
+    ValueTooLarge,
+    /// 键不存在
+    NotFound,
+    /// 读取缓冲区太小
+    BufferTooSmall,
+    /// 索引已满（键的个数超过`K`）
+    IndexFull,
+    /// 有效数据总量超过一页的容量
+    NoSpace,
+    /// 尚未调用`mount`
+    NotMounted,
+    /// FLASH操作失败
+    Flash(FlashError),
+}
+
+impl From<FlashError> for KvError {
+    fn from(error: FlashError) -> Self {
+        KvError::Flash(error)
+    }
+}
+
+/// 索引项：键及其最新记录的地址
+#[derive(Clone, Copy)]
+struct KvEntry {
+    key: u16,
+    addr: u32,
+}
+
+/// 扫描一条记录的结果
+enum RecordScan {
+    /// 页内剩余空间未使用
+    End,
+    /// 记录头损坏（掉电时只写了一部分），页内后续内容不可信
+    Corrupt,
+    /// 完整的记录
+    Record {
+        key: u16,
+        meta: u16,
+        size: u32,
+        valid: bool,
+    },
+}
+
+/// 读取FLASH中的半字
+#[inline(always)]
+unsafe fn read_u16(addr: u32) -> u16 {
+    core::ptr::read_volatile(addr as *const u16)
+}
+
+/// 读取FLASH中半字对齐的字
+#[inline(always)]
+unsafe fn read_u32(addr: u32) -> u32 {
+    read_u16(addr) as u32 | (read_u16(addr + 2) as u32) << 16
+}
+
+/// 值长度对应的记录总长度
+const fn record_size(len: usize) -> u32 {
+    KV_RECORD_HEADER + ((len as u32 + 1) & !1) + KV_RECORD_TRAILER
+}
+
+/// 计算记录的CRC
+unsafe fn record_crc(key: u16, meta: u16, value: &[u8]) -> u32 {
+    let mut stream = CRC.stream();
+    stream.update(&key.to_le_bytes());
+    stream.update(&meta.to_le_bytes());
+    stream.update(value);
+    stream.finalize()
+}
+
+/// 日志结构键值存储
+/// 
+/// `P`为使用的FLASH页数（至少2），`K`为RAM索引能容纳的键个数。
+/// 上电后调用`mount`扫描全部页建立索引，之后`get`直接从FLASH映射地址读取，不占用额外RAM。
+/// 
+/// 有效数据（每个键最新的一条记录）的总长度不能超过一页的容量，
+/// 这保证了任何时刻的垃圾回收都能在一个空页内完成。
+/// 
+/// ```ignore
+/// // 使用64KB器件最后两页
+/// static mut STORE: KvStore<2, 16> = KvStore::new(0x0800_F800);
+/// 
+/// STORE.mount()?;
+/// STORE.set_u32(KEY_BOOT_COUNT, STORE.get_u32(KEY_BOOT_COUNT).unwrap_or(0) + 1)?;
+/// ```
+pub struct KvStore<const P: usize, const K: usize> {
+    /// 第一页的起始地址
+    base: u32,
+    /// 各页的序号，`KV_SEQUENCE_NONE`表示空页
+    sequence: [u32; P],
+    /// 按键排序的索引
+    index: [KvEntry; K],
+    /// 索引项个数
+    count: usize,
+    /// 当前写入页
+    head: usize,
+    /// 下一条记录的写入地址
+    write_addr: u32,
+    /// 是否已建立索引
+    mounted: bool,
+}
+
+impl<const P: usize, const K: usize> KvStore<P, K> {
+    /// 编译期检查页数
+    const PAGE_CHECK: () = assert!(P >= 2, "KvStore至少需要2页");
+    
+    /// 单页可容纳的记录字节数
+    const CAPACITY: u32 = FLASH_PAGE_SIZE - KV_PAGE_HEADER;
+    
+    /// 创建键值存储
+    /// 
+    /// # Arguments
+    /// * `base` - 存储区起始地址，必须页对齐，存储区不能与程序重叠
+    pub const fn new(base: u32) -> Self {
+        let _ = Self::PAGE_CHECK;
+        Self {
+            base,
+            sequence: [KV_SEQUENCE_NONE; P],
+            index: [KvEntry { key: KV_KEY_NONE, addr: 0 }; K],
+            count: 0,
+            head: 0,
+            write_addr: 0,
+            mounted: false,
+        }
+    }
+    
+    /// 页起始地址
+    fn page_addr(&self, page: usize) -> u32 {
+        self.base + page as u32 * FLASH_PAGE_SIZE
+    }
+    
+    /// 地址所在页的结束地址
+    fn page_end(&self, page: usize) -> u32 {
+        self.page_addr(page) + FLASH_PAGE_SIZE
+    }
+    
+    /// 检查页是否处于擦除状态
+    unsafe fn is_blank(&self, page: usize) -> bool {
+        let start = self.page_addr(page);
+        (0..FLASH_PAGE_SIZE)
+            .step_by(4)
+            .all(|offset| core::ptr::read_volatile((start + offset) as *const u32) == 0xFFFF_FFFF)
+    }
+    
+    /// 扫描一条记录
+    unsafe fn scan(&self, addr: u32, end: u32) -> RecordScan {
+        if addr + KV_RECORD_HEADER + KV_RECORD_TRAILER > end {
+            return RecordScan::End;
+        }
+        let key = read_u16(addr);
+        if key == KV_KEY_NONE {
+            return RecordScan::End;
+        }
+        
+        let meta = read_u16(addr + 2);
+        let len = (meta & !KV_META_DELETED) as usize;
+        let size = record_size(len);
+        if meta == FLASH_ERASED_HALF_WORD || len > KV_MAX_VALUE || addr + size > end {
+            return RecordScan::Corrupt;
+        }
+        
+        let value = core::slice::from_raw_parts((addr + KV_RECORD_HEADER) as *const u8, len);
+        let stored = read_u32(addr + size - KV_RECORD_TRAILER);
+        RecordScan::Record {
+            key,
+            meta,
+            size,
+            valid: record_crc(key, meta, value) == stored,
+        }
+    }
+    
+    /// 在索引中查找键的位置
+    fn find(&self, key: u16) -> Result<usize, usize> {
+        self.index[..self.count].binary_search_by_key(&key, |entry| entry.key)
+    }
+    
+    /// 更新或插入索引项
+    fn upsert(&mut self, key: u16, addr: u32) -> Result<(), KvError> {
+        match self.find(key) {
+            Ok(pos) => self.index[pos].addr = addr,
+            Err(pos) => {
+                if self.count == K {
+                    return Err(KvError::IndexFull);
+                }
+                self.index.copy_within(pos..self.count, pos + 1);
+                self.index[pos] = KvEntry { key, addr };
+                self.count += 1;
+            },
+        }
+        Ok(())
+    }
+    
+    /// 删除索引项
+    fn remove_entry(&mut self, key: u16) {
+        if let Ok(pos) = self.find(key) {
+            self.index.copy_within(pos + 1..self.count, pos);
+            self.count -= 1;
+        }
+    }
+    
+    /// 写入页头，使空页成为新的写入页
+    unsafe fn open_page(&mut self, page: usize, sequence: u32) -> Result<(), KvError> {
+        let addr = self.page_addr(page);
+        FLASH.program_half_word(addr + 4, sequence as u16)?;
+        FLASH.program_half_word(addr + 6, (sequence >> 16) as u16)?;
+        FLASH.program_half_word(addr, KV_PAGE_MAGIC)?;
+        
+        self.sequence[page] = sequence;
+        self.head = page;
+        self.write_addr = addr + KV_PAGE_HEADER;
+        Ok(())
+    }
+    
+    /// 擦除一页并标记为空页
+    unsafe fn erase(&mut self, page: usize) -> Result<(), KvError> {
+        self.sequence[page] = KV_SEQUENCE_NONE;
+        FLASH.erase_page(self.page_addr(page))?;
+        Ok(())
+    }
+    
+    /// 扫描存储区建立索引
+    /// 
+    /// 页头无效的页（擦除或开页被掉电打断）会被重新擦除；全部页都无效时格式化存储区。
+    /// 当前写入页末尾有损坏的记录头时，后续写入从下一页开始。
+    /// 
+    /// # Safety
+    /// 直接访问FLASH和CRC寄存器
+    pub unsafe fn mount(&mut self) -> Result<(), KvError> {
+        CRC.init();
+        self.count = 0;
+        self.mounted = false;
+        
+        FLASH.unlock();
+        let result = self.mount_unlocked();
+        FLASH.lock();
+        result?;
+        
+        self.mounted = true;
+        Ok(())
+    }
+    
+    /// `mount`的实现（调用前FLASH已解锁）
+    unsafe fn mount_unlocked(&mut self) -> Result<(), KvError> {
+        for page in 0..P {
+            let addr = self.page_addr(page);
+            let sequence = read_u32(addr + 4);
+            if read_u16(addr) == KV_PAGE_MAGIC && sequence != KV_SEQUENCE_NONE {
+                self.sequence[page] = sequence;
+            } else {
+                self.sequence[page] = KV_SEQUENCE_NONE;
+                if !self.is_blank(page) {
+                    self.erase(page)?;
+                }
+            }
+        }
+        
+        // 按序号从旧到新排列已使用的页
+        let mut order = [0usize; P];
+        let mut used = 0;
+        for page in 0..P {
+            if self.sequence[page] == KV_SEQUENCE_NONE {
+                continue;
+            }
+            let mut pos = used;
+            while pos > 0 && self.sequence[order[pos - 1]] > self.sequence[page] {
+                order[pos] = order[pos - 1];
+                pos -= 1;
+            }
+            order[pos] = page;
+            used += 1;
+        }
+        
+        if used == 0 {
+            return self.open_page(0, 1);
+        }
+        
+        // 按时间顺序重放日志，后面的记录覆盖前面的
+        let mut write_addr = 0;
+        for &page in &order[..used] {
+            let end = self.page_end(page);
+            let mut addr = self.page_addr(page) + KV_PAGE_HEADER;
+            loop {
+                match self.scan(addr, end) {
+                    RecordScan::End => break,
+                    RecordScan::Corrupt => {
+                        addr = end;
+                        break;
+                    },
+                    RecordScan::Record { key, meta, size, valid } => {
+                        if valid {
+                            if (meta & KV_META_DELETED) != 0 {
+                                self.remove_entry(key);
+                            } else {
+                                self.upsert(key, addr)?;
+                            }
+                        }
+                        addr += size;
+                    },
+                }
+            }
+            write_addr = addr;
+        }
+        
+        self.head = order[used - 1];
+        self.write_addr = write_addr;
+        
+        // 没有空页说明上次回收在擦除旧页前被打断，重新完成回收
+        if !self.sequence.iter().any(|&s| s == KV_SEQUENCE_NONE) {
+            self.collect_oldest()?;
+        }
+        Ok(())
+    }
+    
+    /// 有效记录的总长度
+    unsafe fn live_bytes(&self) -> u32 {
+        self.index[..self.count]
+            .iter()
+            .map(|entry| record_size((read_u16(entry.addr + 2) & !KV_META_DELETED) as usize))
+            .sum()
+    }
+    
+    /// 把一条记录原样复制到写入位置
+    unsafe fn copy_record(&mut self, src: u32, size: u32) -> Result<u32, KvError> {
+        let dst = self.write_addr;
+        if dst + size > self.page_end(self.head) {
+            return Err(KvError::NoSpace);
+        }
+        self.program_header(dst, size, read_u16(src), read_u16(src + 2))?;
+        for offset in (KV_RECORD_HEADER..size).step_by(2) {
+            FLASH.program_half_word(dst + offset, read_u16(src + offset))?;
+        }
+        Ok(dst)
+    }
+    
+    /// 回收最旧的页：把其中仍然有效的记录搬到写入页，然后擦除
+    unsafe fn collect_oldest(&mut self) -> Result<(), KvError> {
+        let mut oldest = None;
+        for page in 0..P {
+            let sequence = self.sequence[page];
+            if page != self.head && sequence != KV_SEQUENCE_NONE
+                && oldest.map_or(true, |p: usize| sequence < self.sequence[p])
+            {
+                oldest = Some(page);
+            }
+        }
+        let oldest = match oldest {
+            Some(page) => page,
+            None => return Ok(()),
+        };
+        
+        let end = self.page_end(oldest);
+        let mut addr = self.page_addr(oldest) + KV_PAGE_HEADER;
+        while let RecordScan::Record { key, meta, size, valid } = self.scan(addr, end) {
+            // 删除标记可以丢弃：更旧的记录只可能在这一页里
+            let live = valid
+                && (meta & KV_META_DELETED) == 0
+                && matches!(self.find(key), Ok(pos) if self.index[pos].addr == addr);
+            if live {
+                let new_addr = self.copy_record(addr, size)?;
+                self.upsert(key, new_addr)?;
+            }
+            addr += size;
+        }
+        
+        self.erase(oldest)
+    }
+    
+    /// 保证写入页有`size`字节的空间，必要时换页并回收
+    unsafe fn ensure_space(&mut self, size: u32) -> Result<(), KvError> {
+        if self.write_addr + size <= self.page_end(self.head) {
+            return Ok(());
+        }
+        
+        // 从写入页的下一页开始找空页，使各页轮流使用
+        let next = (1..=P)
+            .map(|step| (self.head + step) % P)
+            .find(|&page| self.sequence[page] == KV_SEQUENCE_NONE)
+            .ok_or(KvError::NoSpace)?;
+        let sequence = self.sequence[self.head] + 1;
+        self.open_page(next, sequence)?;
+        
+        // 用掉最后一个空页时立即回收最旧页，保证下次换页时仍有空页
+        if !self.sequence.iter().any(|&s| s == KV_SEQUENCE_NONE) {
+            self.collect_oldest()?;
+        }
+        
+        if self.write_addr + size > self.page_end(self.head) {
+            return Err(KvError::NoSpace);
+        }
+        Ok(())
+    }
+    
+    /// 追加一条记录
+    unsafe fn append(&mut self, key: u16, meta: u16, value: &[u8]) -> Result<u32, KvError> {
+        let size = record_size(value.len());
+        self.ensure_space(size)?;
+        
+        let addr = self.write_addr;
+        self.program_header(addr, size, key, meta)?;
+        
+        let mut chunks = value.chunks_exact(2);
+        let mut offset = KV_RECORD_HEADER;
+        for chunk in &mut chunks {
+            FLASH.program_half_word(addr + offset, u16::from_le_bytes([chunk[0], chunk[1]]))?;
+            offset += 2;
+        }
+        if let [last] = chunks.remainder() {
+            FLASH.program_half_word(addr + offset, u16::from_le_bytes([*last, 0xFF]))?;
+            offset += 2;
+        }
+        
+        let crc = record_crc(key, meta, value);
+        FLASH.program_half_word(addr + offset, crc as u16)?;
+        FLASH.program_half_word(addr + offset + 2, (crc >> 16) as u16)?;
+        Ok(addr)
+    }
+    
+    /// 编程记录头，并把写入位置移过整条记录
+    /// 
+    /// 编程失败后不能在已编程的半字上再次编程（PGERR），写入位置必须越过失败的记录：
+    /// 记录头完整时后续失败只会使CRC不匹配，扫描时跳过这条记录；
+    /// 记录头不完整时扫描会放弃本页剩余部分，这里同样放弃，下次写入换到新页。
+    unsafe fn program_header(&mut self, addr: u32, size: u32, key: u16, meta: u16) -> Result<(), KvError> {
+        let result = FLASH.program_half_word(addr, key)
+            .and_then(|_| FLASH.program_half_word(addr + 2, meta));
+        if let Err(error) = result {
+            self.write_addr = self.page_end(self.head);
+            return Err(error.into());
+        }
+        self.write_addr = addr + size;
+        Ok(())
+    }
+    
+    /// 获取值的存储位置（FLASH映射地址）
+    fn value_slice(&self, key: u16) -> Option<&'static [u8]> {
+        let pos = self.find(key).ok()?;
+        let addr = self.index[pos].addr;
+        unsafe {
+            let len = (read_u16(addr + 2) & !KV_META_DELETED) as usize;
+            Some(core::slice::from_raw_parts((addr + KV_RECORD_HEADER) as *const u8, len))
+        }
+    }
+    
+    /// 读取值
+    /// 
+    /// # Arguments
+    /// * `key` - 键
+    /// * `buffer` - 接收缓冲区
+    /// 
+    /// # Returns
+    /// 成功返回值的长度
+    pub fn get(&self, key: u16, buffer: &mut [u8]) -> Result<usize, KvError> {
+        if !self.mounted {
+            return Err(KvError::NotMounted);
+        }
+        let value = self.value_slice(key).ok_or(KvError::NotFound)?;
+        let target = buffer.get_mut(..value.len()).ok_or(KvError::BufferTooSmall)?;
+        target.copy_from_slice(value);
+        Ok(value.len())
+    }
+    
+    /// 读取32位值
+    pub fn get_u32(&self, key: u16) -> Option<u32> {
+        let mut bytes = [0u8; 4];
+        match self.get(key, &mut bytes) {
+            Ok(4) => Some(u32::from_le_bytes(bytes)),
+            _ => None,
+        }
+    }
+    
+    /// 检查键是否存在
+    pub fn contains(&self, key: u16) -> bool {
+        self.find(key).is_ok()
+    }
+    
+    /// 已存储的键个数
+    pub fn len(&self) -> usize {
+        self.count
+    }
+    
+    /// 写入值
+    /// 
+    /// 值与当前存储的相同时不写FLASH。写入页空间不足时自动换页，
+    /// 必要时回收最旧页（一次页擦除）。
+    /// 
+    /// # Arguments
+    /// * `key` - 键，不能为`KV_KEY_NONE`
+    /// * `value` - 值，最长`KV_MAX_VALUE`字节
+    /// 
+    /// # Safety
+    /// 直接访问FLASH和CRC寄存器；写入期间从FLASH取指会被暂停
+    pub unsafe fn set(&mut self, key: u16, value: &[u8]) -> Result<(), KvError> {
+        if !self.mounted {
+            return Err(KvError::NotMounted);
+        }
+        if key == KV_KEY_NONE {
+            return Err(KvError::InvalidKey);
+        }
+        if value.len() > KV_MAX_VALUE {
+            return Err(KvError::ValueTooLarge);
+        }
+        if self.value_slice(key) == Some(value) {
+            return Ok(());
+        }
+        if !self.contains(key) && self.count == K {
+            return Err(KvError::IndexFull);
+        }
+        if self.live_bytes() + record_size(value.len()) > Self::CAPACITY {
+            return Err(KvError::NoSpace);
+        }
+        
+        FLASH.unlock();
+        let result = self.append(key, value.len() as u16, value);
+        FLASH.lock();
+        let addr = result?;
+        self.upsert(key, addr)
+    }
+    
+    /// 写入32位值
+    /// 
+    /// # Safety
+    /// 同`set`
+    pub unsafe fn set_u32(&mut self, key: u16, value: u32) -> Result<(), KvError> {
+        self.set(key, &value.to_le_bytes())
+    }
+    
+    /// 删除键
+    /// 
+    /// # Safety
+    /// 同`set`
+    pub unsafe fn remove(&mut self, key: u16) -> Result<(), KvError> {
+        if !self.mounted {
+            return Err(KvError::NotMounted);
+        }
+        if !self.contains(key) {
+            return Err(KvError::NotFound);
+        }
+        if self.live_bytes() + record_size(0) > Self::CAPACITY {
+            return Err(KvError::NoSpace);
+        }
+        
+        FLASH.unlock();
+        let result = self.append(key, KV_META_DELETED, &[]);
+        FLASH.lock();
+        result?;
+        self.remove_entry(key);
+        Ok(())
+    }
+    
+    /// 擦除整个存储区并重新开始
+    /// 
+    /// # Safety
+    /// 直接访问FLASH寄存器
+    pub unsafe fn format(&mut self) -> Result<(), KvError> {
+        CRC.init();
+        self.count = 0;
+        self.mounted = false;
+        
+        FLASH.unlock();
+        let mut result = Ok(());
+        for page in 0..P {
+            if result.is_ok() && !self.is_blank(page) {
+                result = self.erase(page);
+            }
+            self.sequence[page] = KV_SEQUENCE_NONE;
+        }
+        if result.is_ok() {
+            result = self.open_page(0, 1);
+        }
+        FLASH.lock();
+        result?;
+        
+        self.mounted = true;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    /// 测试用存储区：64KB器件最后两页
+    const TEST_BASE: u32 = 0x0801_0000 - 2 * FLASH_PAGE_SIZE;
+    
+    /// 测试记录编程中途失败后，下一次写入越过损坏的记录
+    #[test]
+    fn test_append_after_program_error() {
+        let mut store: KvStore<2, 4> = KvStore::new(TEST_BASE);
+        unsafe {
+            store.format().unwrap();
+            store.set(1, &[0x11, 0x22, 0x33, 0x44]).unwrap();
+            
+            // 预先把下一条记录值的第一个半字编程为0，写入非0值时FLASH报告PGERR
+            FLASH.unlock();
+            FLASH.program_half_word(store.write_addr + KV_RECORD_HEADER, 0).unwrap();
+            FLASH.lock();
+            
+            let value = [0x12, 0x34, 0x56, 0x78];
+            assert!(matches!(store.set(2, &value), Err(KvError::Flash(_))), "编程错误未返回");
+            assert_eq!(store.set(2, &value), Ok(()), "失败后的下一次写入应成功");
+            
+            let mut buffer = [0u8; 4];
+            assert_eq!(store.get(2, &mut buffer), Ok(4));
+            assert_eq!(buffer, value);
+            
+            // 重新扫描时跳过损坏的记录
+            store.mount().unwrap();
+            assert_eq!(store.get(1, &mut buffer), Ok(4));
+            assert_eq!(buffer, [0x11, 0x22, 0x33, 0x44]);
+            assert_eq!(store.get(2, &mut buffer), Ok(4));
+            assert_eq!(buffer, value);
+        }
+    }
+}
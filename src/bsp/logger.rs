@@ -0,0 +1,408 @@
+//! 延迟日志模块
+//! 日志调用只把（时间戳, 消息ID, 参数）写入无锁环形队列，格式化和发送在后台完成
+//! 
+//! 与`system::log`相比，记录一条日志只需几十个周期，可以在任意中断中使用：
+//! 
+//! ```ignore
+//! log_deferred!(LogLevel::Warning, "adc overrun {} at ch{}", count, channel);
+//! 
+//! // 主循环中
+//! LOGGER.drain_to_dma(&USART1_LOG_TX);   // 二进制帧，由上位机按ELF解码
+//! // 或
+//! LOGGER.drain(&mut serial, 8);          // 板上格式化为文本
+//! ```
+//! 
+//! 消息文本保存在`static LogMessage`中，记录里只存它的地址作为消息ID，
+//! 因此相同的调用点永远对应同一个ID，二进制输出时上位机可以直接从ELF中查到文本。
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::fmt;
+use core::sync::atomic::{AtomicU32, AtomicU8, AtomicUsize, Ordering};
+use crate::bsp::delay::{cycle_count, system_clock};
+use crate::bsp::serial::SerialDmaTx;
+use crate::bsp::system::{log, LogLevel};
+
+/// 每条记录最多携带的参数个数
+pub const LOG_MAX_ARGS: usize = 4;
+
+/// 全局日志队列的记录数
+pub const LOG_CAPACITY: usize = 32;
+
+/// 二进制帧的最大长度
+pub const LOG_FRAME_MAX: usize = 10 + 4 * LOG_MAX_ARGS;
+
+/// 二进制帧起始字节
+pub const LOG_FRAME_SYNC: u8 = 0xA5;
+
+/// 日志调用点的静态描述
+/// 
+/// 由`log_deferred!`为每个调用点生成一个`static`实例，其地址即为消息ID。
+pub struct LogMessage {
+    /// 日志级别
+    pub level: LogLevel,
+    /// 消息文本，`{}`为十进制参数占位符，`{:x}`为十六进制参数占位符
+    pub text: &'static str,
+}
+
+impl LogMessage {
+    /// 创建调用点描述
+    pub const fn new(level: LogLevel, text: &'static str) -> Self {
+        Self { level, text }
+    }
+    
+    /// 消息ID（描述在存储器中的地址）
+    pub fn id(&'static self) -> u32 {
+        self as *const Self as u32
+    }
+}
+
+/// 一条日志记录
+#[derive(Clone, Copy)]
+pub struct LogRecord {
+    /// 调用点描述
+    pub message: &'static LogMessage,
+    /// 记录时的DWT周期计数
+    pub timestamp: u32,
+    /// 有效参数个数
+    pub argc: u8,
+    /// 参数
+    pub args: [u32; LOG_MAX_ARGS],
+}
+
+impl LogRecord {
+    /// 有效参数
+    pub fn args(&self) -> &[u32] {
+        &self.args[..self.argc as usize]
+    }
+    
+    /// 编码为二进制帧
+    /// 
+    /// 帧格式（小端）：`0xA5, level | argc << 4, id: u32, timestamp: u32, args: [u32; argc]`
+    /// 
+    /// # Returns
+    /// 帧长度
+    pub fn encode(&self, frame: &mut [u8; LOG_FRAME_MAX]) -> usize {
+        frame[0] = LOG_FRAME_SYNC;
+        frame[1] = (self.message.level as u8) | (self.argc << 4);
+        frame[2..6].copy_from_slice(&self.message.id().to_le_bytes());
+        frame[6..10].copy_from_slice(&self.timestamp.to_le_bytes());
+        let mut len = 10;
+        for &arg in self.args() {
+            frame[len..len + 4].copy_from_slice(&arg.to_le_bytes());
+            len += 4;
+        }
+        len
+    }
+    
+    /// 把消息文本中的占位符替换为参数后输出（不含时间戳和级别）
+    /// 
+    /// 参数不足时占位符原样输出，多余的参数追加在末尾。
+    pub fn write_message<W: fmt::Write>(&self, out: &mut W) -> fmt::Result {
+        let mut args = self.args().iter();
+        let mut rest = self.message.text;
+        
+        while let Some(pos) = rest.find('{') {
+            out.write_str(&rest[..pos])?;
+            rest = &rest[pos..];
+            
+            let (hex, skip) = if rest.starts_with("{}") {
+                (false, 2)
+            } else if rest.starts_with("{:x}") {
+                (true, 4)
+            } else {
+                out.write_str("{")?;
+                rest = &rest[1..];
+                continue;
+            };
+            
+            match args.next() {
+                Some(&arg) if hex => write!(out, "{:#x}", arg)?,
+                Some(&arg) => write!(out, "{}", arg)?,
+                None => out.write_str(&rest[..skip])?,
+            }
+            rest = &rest[skip..];
+        }
+        out.write_str(rest)?;
+        
+        for arg in args {
+            write!(out, " {}", arg)?;
+        }
+        Ok(())
+    }
+}
+
+/// 队列中的一个槽位
+struct LogSlot {
+    /// 序号：等于写入位置表示空闲，等于写入位置+1表示已提交
+    sequence: AtomicUsize,
+    record: UnsafeCell<LogRecord>,
+}
+
+impl LogSlot {
+    /// 空槽位（序号在`DeferredLog::new`中设置）
+    const EMPTY: Self = Self {
+        sequence: AtomicUsize::new(0),
+        record: UnsafeCell::new(LogRecord {
+            message: &LogMessage::new(LogLevel::Debug, ""),
+            timestamp: 0,
+            argc: 0,
+            args: [0; LOG_MAX_ARGS],
+        }),
+    };
+}
+
+/// 无锁多生产者单消费者日志队列
+/// 
+/// 生产者（任意优先级的中断或主循环）用CAS抢占写入位置，写完记录后以Release序提交槽位；
+/// 低优先级生产者被打断时，高优先级生产者写入后面的槽位，消费者按顺序等待未提交的槽位，
+/// 因此输出顺序与抢占写入位置的顺序一致。队列满时丢弃新记录并计数，生产者永不阻塞。
+/// 记录数`N`必须是2的幂。
+pub struct DeferredLog<const N: usize> {
+    slots: [LogSlot; N],
+    /// 写入位置（累计记录数）
+    head: AtomicUsize,
+    /// 读取位置（只由消费者修改）
+    tail: AtomicUsize,
+    /// 因队列满而丢弃的记录数
+    dropped: AtomicU32,
+    /// 最低记录级别（`LogLevel as u8`，数值越大越详细）
+    max_level: AtomicU8,
+    /// 消费者侧状态：上一条记录的时间戳和扩展后的64位周期计数
+    clock: UnsafeCell<(u32, u64)>,
+}
+
+/// 实现 Sync trait，槽位由序号协议保护，`clock`只由唯一的消费者访问
+unsafe impl<const N: usize> Sync for DeferredLog<N> {}
+
+impl<const N: usize> DeferredLog<N> {
+    /// 编译期检查队列大小
+    const SIZE_CHECK: () = assert!(N.is_power_of_two(), "DeferredLog大小必须是2的幂");
+    
+    /// 创建新的日志队列
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        let mut slots = [LogSlot::EMPTY; N];
+        let mut i = 0;
+        while i < N {
+            slots[i].sequence = AtomicUsize::new(i);
+            i += 1;
+        }
+        
+        Self {
+            slots,
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+            dropped: AtomicU32::new(0),
+            max_level: AtomicU8::new(LogLevel::Debug as u8),
+            clock: UnsafeCell::new((0, 0)),
+        }
+    }
+    
+    /// 设置最低记录级别，更详细的日志在入队前被丢弃
+    pub fn set_level(&self, level: LogLevel) {
+        self.max_level.store(level as u8, Ordering::Relaxed);
+    }
+    
+    /// 检查某级别的日志是否会被记录
+    #[inline(always)]
+    pub fn enabled(&self, level: LogLevel) -> bool {
+        (level as u8) <= self.max_level.load(Ordering::Relaxed)
+    }
+    
+    /// 写入一条记录（通常通过`log_deferred!`调用）
+    /// 
+    /// # Arguments
+    /// * `message` - 调用点描述
+    /// * `args` - 参数，超过`LOG_MAX_ARGS`的部分被截断
+    /// 
+    /// # Returns
+    /// 队列满时返回`false`
+    #[inline]
+    pub fn push(&self, message: &'static LogMessage, args: &[u32]) -> bool {
+        if !self.enabled(message.level) {
+            return true;
+        }
+        let timestamp = cycle_count();
+        
+        let mut pos = self.head.load(Ordering::Relaxed);
+        let slot = loop {
+            let slot = &self.slots[pos & (N - 1)];
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            let diff = sequence.wrapping_sub(pos) as isize;
+            if diff == 0 {
+                match self.head.compare_exchange_weak(pos, pos.wrapping_add(1), Ordering::Relaxed, Ordering::Relaxed) {
+                    Ok(_) => break slot,
+                    Err(current) => pos = current,
+                }
+            } else if diff < 0 {
+                // 槽位还没被消费者释放：队列满
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+                return false;
+            } else {
+                pos = self.head.load(Ordering::Relaxed);
+            }
+        };
+        
+        let argc = args.len().min(LOG_MAX_ARGS);
+        unsafe {
+            let record = &mut *slot.record.get();
+            record.message = message;
+            record.timestamp = timestamp;
+            record.argc = argc as u8;
+            record.args[..argc].copy_from_slice(&args[..argc]);
+        }
+        slot.sequence.store(pos.wrapping_add(1), Ordering::Release);
+        true
+    }
+    
+    /// 取出最早的一条已提交记录
+    /// 
+    /// # Safety
+    /// 同一时刻只能有一个消费者（通常是主循环中的后台任务）
+    pub unsafe fn pop(&self) -> Option<LogRecord> {
+        let pos = self.tail.load(Ordering::Relaxed);
+        let slot = &self.slots[pos & (N - 1)];
+        if slot.sequence.load(Ordering::Acquire) != pos.wrapping_add(1) {
+            return None;
+        }
+        
+        let record = *slot.record.get();
+        slot.sequence.store(pos.wrapping_add(N), Ordering::Release);
+        self.tail.store(pos.wrapping_add(1), Ordering::Relaxed);
+        Some(record)
+    }
+    
+    /// 查看最早的一条已提交记录而不取出
+    unsafe fn peek(&self) -> Option<LogRecord> {
+        let pos = self.tail.load(Ordering::Relaxed);
+        let slot = &self.slots[pos & (N - 1)];
+        if slot.sequence.load(Ordering::Acquire) != pos.wrapping_add(1) {
+            return None;
+        }
+        Some(*slot.record.get())
+    }
+    
+    /// 待输出的记录数（含正在写入的）
+    pub fn len(&self) -> usize {
+        self.head.load(Ordering::Relaxed).wrapping_sub(self.tail.load(Ordering::Relaxed))
+    }
+    
+    /// 读取并清零丢弃计数
+    pub fn take_dropped(&self) -> u32 {
+        self.dropped.swap(0, Ordering::Relaxed)
+    }
+    
+    /// 把记录的32位时间戳扩展为64位周期计数
+    /// 
+    /// 时间戳在占用槽位之前读取，抢占的生产者可能占到更早的槽位却带着更晚的时间戳，
+    /// 因此取出顺序上时间戳可能略有倒退。倒退（差值按有符号数为负）时沿用上一条的时间，
+    /// 只要两次输出的间隔小于CYCCNT回绕周期的一半（72MHz下约29秒），结果就单调不减。
+    unsafe fn extend_timestamp(&self, timestamp: u32) -> u64 {
+        let clock = &mut *self.clock.get();
+        let delta = timestamp.wrapping_sub(clock.0);
+        if (delta as i32) >= 0 {
+            clock.1 = clock.1.wrapping_add(delta as u64);
+            clock.0 = timestamp;
+        }
+        clock.1
+    }
+    
+    /// 以文本格式输出一条记录：`[秒.微秒] 级别 消息`
+    unsafe fn write_record<W: fmt::Write>(&self, record: &LogRecord, out: &mut W) -> fmt::Result {
+        let cycles_per_us = (system_clock() / 1_000_000).max(1) as u64;
+        let us = self.extend_timestamp(record.timestamp) / cycles_per_us;
+        write!(out, "[{}.{:06}] {:?} ", us / 1_000_000, us % 1_000_000, record.message.level)?;
+        record.write_message(out)?;
+        out.write_str("\n")
+    }
+    
+    /// 后台任务：取出最多`max`条记录，格式化为文本输出
+    /// 
+    /// 有记录被丢弃时先输出一行丢弃计数。
+    /// 
+    /// # Returns
+    /// 输出的记录数
+    /// 
+    /// # Safety
+    /// 同一时刻只能有一个消费者
+    pub unsafe fn drain<W: fmt::Write>(&self, out: &mut W, max: usize) -> usize {
+        let dropped = self.take_dropped();
+        if dropped != 0 {
+            let _ = writeln!(out, "[log] {} records dropped", dropped);
+        }
+        
+        let mut count = 0;
+        while count < max {
+            let record = match self.pop() {
+                Some(record) => record,
+                None => break,
+            };
+            let _ = self.write_record(&record, out);
+            count += 1;
+        }
+        count
+    }
+    
+    /// 后台任务：取出全部记录，格式化后逐条交给`system::set_log_handler`设置的处理函数
+    /// 
+    /// 用于保留已有的日志后端，同时把格式化和发送移出调用日志的上下文。
+    /// 
+    /// # Safety
+    /// 同一时刻只能有一个消费者
+    pub unsafe fn drain_to_log(&self) -> usize {
+        let mut count = 0;
+        while let Some(record) = self.pop() {
+            let mut line = heapless::String::<128>::new();
+            let _ = record.write_message(&mut line);
+            log(record.message.level, line.as_str());
+            count += 1;
+        }
+        count
+    }
+    
+    /// 后台任务：把记录编码为二进制帧放入DMA串口发送缓冲区
+    /// 
+    /// 只在缓冲区能放下整帧时才取出记录，放不下的留到下次，不会产生半帧。
+    /// 
+    /// # Returns
+    /// 输出的记录数
+    /// 
+    /// # Safety
+    /// 同一时刻只能有一个消费者，且`tx`的写入只在这一个上下文中进行
+    pub unsafe fn drain_to_dma<const M: usize>(&self, tx: &SerialDmaTx<M>) -> usize {
+        let mut frame = [0u8; LOG_FRAME_MAX];
+        let mut count = 0;
+        while let Some(record) = self.peek() {
+            let len = record.encode(&mut frame);
+            if tx.ring().free_space() < len {
+                break;
+            }
+            let _ = self.pop();
+            tx.write_bytes(&frame[..len]);
+            count += 1;
+        }
+        count
+    }
+}
+
+/// 全局日志队列，`log_deferred!`写入这里
+pub static LOGGER: DeferredLog<LOG_CAPACITY> = DeferredLog::new();
+
+/// 记录一条延迟日志
+/// 
+/// 每个调用点生成一个`static LogMessage`，参数按`as u32`转换后写入`LOGGER`，
+/// 最多`LOG_MAX_ARGS`个。
+/// 
+/// ```ignore
+/// log_deferred!(LogLevel::Info, "spi done");
+/// log_deferred!(LogLevel::Error, "dma error ch{} cndtr={:x}", ch, remaining);
+/// ```
+#[macro_export]
+macro_rules! log_deferred {
+    ($level:expr, $text:literal $(, $arg:expr)* $(,)?) => {{
+        static MESSAGE: $crate::bsp::logger::LogMessage = $crate::bsp::logger::LogMessage::new($level, $text);
+        $crate::bsp::logger::LOGGER.push(&MESSAGE, &[$($arg as u32),*]);
+    }};
+}
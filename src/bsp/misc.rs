@@ -10,8 +10,14 @@ const SCB_SCR: *mut u32 = (SCB_BASE + 0x04) as *mut u32;
 
 const NVIC_ISER: *mut u32 = NVIC_BASE as *mut u32;
 const NVIC_ICER: *mut u32 = (NVIC_BASE + 0x080) as *mut u32;
+const NVIC_ISPR: *mut u32 = (NVIC_BASE + 0x100) as *mut u32;
+const NVIC_ICPR: *mut u32 = (NVIC_BASE + 0x180) as *mut u32;
+const NVIC_IABR: *const u32 = (NVIC_BASE + 0x200) as *const u32;
 const NVIC_IP: *mut u32 = (NVIC_BASE + 0x300) as *mut u32;
 
+/// STM32F1实现的优先级位数（IP字节的高4位）
+pub const NVIC_PRIO_BITS: u8 = 4;
+
 const SYSTICK_CTRL: *mut u32 = SYSTICK_BASE as *mut u32;
 
 const AIRCR_VECTKEY_MASK: u32 = 0x05FA0000;
@@ -69,32 +75,85 @@ impl Misc {
 
     pub unsafe fn nvic_init(&self, init_struct: NvicInitStruct) {
         if init_struct.enable {
-            let priority_group = ((*SCB_AIRCR) & 0x700) >> 8;
-            let pre_bits = 4 - priority_group;
-            let sub_bits = priority_group;
+            // PRIGROUP为3时4位全部用于抢占优先级，为7时全部用于子优先级；
+            // PRIGROUP小于3（包括复位值0）时同样按4位抢占优先级处理
+            let pre_bits = ((0x700 - ((*SCB_AIRCR) & 0x700)) >> 8).min(NVIC_PRIO_BITS as u32);
+            let sub_bits = NVIC_PRIO_BITS as u32 - pre_bits;
             
             let mut priority = (init_struct.preemption_priority as u32) << sub_bits;
             priority |= (init_struct.sub_priority as u32) & ((1 << sub_bits) - 1);
-            priority <<= 4;
-            
-            let ip_index = init_struct.irq_channel as usize;
-            let ip_register = NVIC_IP.add(ip_index / 4);
-            let shift = (ip_index % 4) * 8 + 4;
-            *ip_register &= !(0xFF << shift);
-            *ip_register |= priority << shift;
             
-            let iser_index = init_struct.irq_channel as usize / 32;
-            let iser_bit = init_struct.irq_channel % 32;
-            let iser_register = NVIC_ISER.add(iser_index);
-            *iser_register |= 1 << iser_bit;
+            self.nvic_set_priority(init_struct.irq_channel, priority as u8);
+            self.nvic_enable_irq(init_struct.irq_channel);
         } else {
-            let icer_index = init_struct.irq_channel as usize / 32;
-            let icer_bit = init_struct.irq_channel % 32;
-            let icer_register = NVIC_ICER.add(icer_index);
-            *icer_register |= 1 << icer_bit;
+            self.nvic_disable_irq(init_struct.irq_channel);
         }
     }
 
+    /// 使能中断（ISER为写1有效，不影响其他中断）
+    pub unsafe fn nvic_enable_irq(&self, irq: u8) {
+        core::ptr::write_volatile(NVIC_ISER.add(irq as usize / 32), 1 << (irq % 32));
+    }
+
+    /// 禁止中断
+    pub unsafe fn nvic_disable_irq(&self, irq: u8) {
+        core::ptr::write_volatile(NVIC_ICER.add(irq as usize / 32), 1 << (irq % 32));
+    }
+
+    /// 置位中断挂起位，中断使能且优先级足够时随即进入其处理函数（软件触发）
+    pub unsafe fn nvic_set_pending(&self, irq: u8) {
+        core::ptr::write_volatile(NVIC_ISPR.add(irq as usize / 32), 1 << (irq % 32));
+    }
+
+    /// 清除中断挂起位
+    pub unsafe fn nvic_clear_pending(&self, irq: u8) {
+        core::ptr::write_volatile(NVIC_ICPR.add(irq as usize / 32), 1 << (irq % 32));
+    }
+
+    /// 中断是否处于挂起状态
+    pub unsafe fn nvic_is_pending(&self, irq: u8) -> bool {
+        (core::ptr::read_volatile(NVIC_ISPR.add(irq as usize / 32)) & (1 << (irq % 32))) != 0
+    }
+
+    /// 中断是否正在执行（包括被更高优先级抢占的情况）
+    pub unsafe fn nvic_is_active(&self, irq: u8) -> bool {
+        (core::ptr::read_volatile(NVIC_IABR.add(irq as usize / 32)) & (1 << (irq % 32))) != 0
+    }
+
+    /// 设置中断优先级
+    /// 
+    /// # Arguments
+    /// * `irq` - 中断号
+    /// * `priority` - 4位优先级（0最高，15最低），按当前分组拆分为抢占/子优先级
+    pub unsafe fn nvic_set_priority(&self, irq: u8, priority: u8) {
+        let ip = (NVIC_IP as *mut u8).add(irq as usize);
+        core::ptr::write_volatile(ip, (priority & 0x0F) << (8 - NVIC_PRIO_BITS));
+    }
+
+    /// 读取中断优先级（4位，0最高）
+    pub unsafe fn nvic_get_priority(&self, irq: u8) -> u8 {
+        let ip = (NVIC_IP as *const u8).add(irq as usize);
+        core::ptr::read_volatile(ip) >> (8 - NVIC_PRIO_BITS)
+    }
+
+    /// 读取BASEPRI（原始值，0表示不屏蔽）
+    pub fn get_basepri(&self) -> u8 {
+        cortex_m::register::basepri::read()
+    }
+
+    /// 设置BASEPRI：优先级数值大于等于`basepri`（原始值，高4位有效）的中断被屏蔽，0表示不屏蔽
+    /// 
+    /// # Safety
+    /// 降低BASEPRI可能破坏调用者依赖的临界区
+    pub unsafe fn set_basepri(&self, basepri: u8) {
+        cortex_m::register::basepri::write(basepri);
+    }
+
+    /// 只提高屏蔽级别的BASEPRI写入（BASEPRI_MAX），新值不会放开已被屏蔽的中断
+    pub fn set_basepri_max(&self, basepri: u8) {
+        cortex_m::register::basepri_max::write(basepri);
+    }
+
     pub unsafe fn nvic_set_vector_table(&self, vect_tab: NvicVectTab, offset: u32) {
         *SCB_VTOR = (vect_tab as u32) | (offset & 0x1FFFFF80);
     }
@@ -3,27 +3,44 @@
 //! 包含板级支持包
 
 pub mod adc;
-// pub mod bkp;
-// pub mod can;
-// pub mod crc;
-// pub mod dac;
+pub mod bkp;
+pub mod blockcache;
+#[cfg(feature = "c-drivers")]
+pub mod c_oled;
+pub mod can;
+pub mod crc;
+pub mod dac;
 pub mod delay;
-// pub mod dma;
-// pub mod exti;
-// pub mod flash;
+pub mod dsp;
+pub mod dma;
+pub mod executor;
+pub mod exti;
+pub mod flash;
 pub mod gpio;
-// pub mod iic;
-// pub mod iwdg;
-// pub mod pwr;
+pub mod iic;
+pub mod idle;
+pub mod iwdg;
+pub mod kvstore;
+pub mod logger;
+pub mod oled;
+pub mod pool;
+pub mod profile;
+pub mod pwr;
 pub mod rcc;
-// pub mod rtc;
+pub mod reg;
+pub mod rs485;
+pub mod rtc;
+pub mod scheduler;
+pub mod sections;
 pub mod serial;
-// pub mod spi;
+pub mod spi;
 pub mod system;
+pub mod telemetry;
 pub mod timer;
+pub mod watchdog;
 // pub mod wwdg;
 // pub mod cec;
 // pub mod dbg;
-// pub mod fsmc;
-// pub mod sdio;
-// pub mod misc;
+pub mod fsmc;
+pub mod sdio;
+pub mod misc;
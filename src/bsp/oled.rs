@@ -0,0 +1,464 @@
+//! OLED模块
+//! 基于硬件IIC和DMA的SSD1306（128x64）显示驱动
+//!
+//! 显存按页组织（8页×128列，每字节纵向8个像素），与`src/hardware/OLED.c`的`OLED_GRAM`布局一致。
+//! 驱动持有前台/后台两个帧缓冲区：绘制总是作用于后台缓冲区，`flush_async`提交后台缓冲区
+//! 并通过一次DMA传输整帧发送，期间CPU可以继续在新的后台缓冲区上绘制下一帧。
+
+// 屏蔽未使用代码警告
+#![allow(unused)]
+
+use crate::bsp::delay::get_uptime_us;
+use crate::bsp::dma::{DmaError, DmaTransfer};
+use crate::bsp::iic::{HardwareIic, I2cOps, IicError};
+
+/// 屏幕宽度（像素）
+pub const OLED_WIDTH: usize = 128;
+/// 屏幕高度（像素）
+pub const OLED_HEIGHT: usize = 64;
+/// 页数
+pub const OLED_PAGES: usize = OLED_HEIGHT / 8;
+/// 一帧显存字节数
+pub const OLED_FRAME_SIZE: usize = OLED_WIDTH * OLED_PAGES;
+
+/// SSD1306默认8位IIC地址
+pub const OLED_I2C_ADDR: u8 = 0x78;
+
+/// 控制字节：后续为命令
+const OLED_CONTROL_CMD: u8 = 0x00;
+/// 控制字节：后续为显存数据
+const OLED_CONTROL_DATA: u8 = 0x40;
+
+/// 初始化命令序列（水平寻址模式，整帧可在一次传输中写入）
+const OLED_INIT_SEQUENCE: [u8; 24] = [
+    0xAE,       // 关闭显示
+    0x40,       // 起始行地址0
+    0xC8,       // COM扫描方向重映射
+    0x81, 0xFF, // 对比度
+    0xA1,       // 段重映射
+    0xA6,       // 正常显示
+    0xA8, 0x3F, // 复用率64
+    0xD3, 0x00, // 垂直偏移0
+    0xD5, 0xF0, // 时钟分频/振荡频率
+    0xD9, 0x22, // 预充电周期
+    0xDA, 0x12, // COM引脚配置
+    0xDB, 0x49, // VCOMH电压
+    0x8D, 0x14, // 启用电荷泵
+    0x20, 0x00, // 水平寻址模式
+    0xAF,       // 开启显示
+];
+
+/// OLED错误类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum OledError {
+    /// IIC通信错误
+    Iic(IicError),
+    /// DMA传输错误
+    Dma(DmaError),
+    /// 上一帧仍在传输中
+    Busy,
+}
+
+impl From<IicError> for OledError {
+    fn from(error: IicError) -> Self {
+        OledError::Iic(error)
+    }
+}
+
+impl From<DmaError> for OledError {
+    fn from(error: DmaError) -> Self {
+        OledError::Dma(error)
+    }
+}
+
+/// 像素颜色
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum OledColor {
+    /// 熄灭
+    Black,
+    /// 点亮
+    White,
+}
+
+/// 页优先的单色帧缓冲区
+///
+/// 第`page`页第`x`列的字节位于`page * OLED_WIDTH + x`，字节的bit n对应该页内第n行。
+/// 绘制操作记录被修改的字节范围，提交时只把这段同步到另一个缓冲区。
+#[derive(Clone, Copy)]
+pub struct FrameBuffer {
+    data: [u8; OLED_FRAME_SIZE],
+    /// 自上次提交以来被修改的字节范围`[dirty_start, dirty_end)`，起点不小于终点时为空
+    dirty_start: u16,
+    dirty_end: u16,
+}
+
+impl FrameBuffer {
+    /// 创建全黑的帧缓冲区
+    pub const fn new() -> Self {
+        Self {
+            data: [0; OLED_FRAME_SIZE],
+            dirty_start: OLED_FRAME_SIZE as u16,
+            dirty_end: 0,
+        }
+    }
+
+    /// 把`[start, end)`并入修改范围
+    #[inline]
+    fn mark_dirty(&mut self, start: usize, end: usize) {
+        self.dirty_start = self.dirty_start.min(start as u16);
+        self.dirty_end = self.dirty_end.max(end as u16);
+    }
+
+    /// 自上次提交以来被修改的字节范围
+    pub fn dirty_range(&self) -> core::ops::Range<usize> {
+        let start = self.dirty_start as usize;
+        start..(self.dirty_end as usize).max(start)
+    }
+
+    /// 把`front`自上次提交以来的修改复制过来，并清空`front`的修改范围
+    ///
+    /// 两个缓冲区在上次提交时内容相同，因此只需复制修改范围内的字节
+    fn sync_from(&mut self, front: &mut FrameBuffer) {
+        let range = front.dirty_range();
+        self.data[range.clone()].copy_from_slice(&front.data[range]);
+        front.dirty_start = OLED_FRAME_SIZE as u16;
+        front.dirty_end = 0;
+    }
+
+    /// 获取原始显存数据
+    pub fn as_bytes(&self) -> &[u8; OLED_FRAME_SIZE] {
+        &self.data
+    }
+
+    /// 获取可修改的原始显存数据（整帧记为已修改）
+    pub fn as_bytes_mut(&mut self) -> &mut [u8; OLED_FRAME_SIZE] {
+        self.mark_dirty(0, OLED_FRAME_SIZE);
+        &mut self.data
+    }
+
+    /// 获取指定页的128字节
+    pub fn page(&self, page: usize) -> &[u8] {
+        &self.data[page * OLED_WIDTH..(page + 1) * OLED_WIDTH]
+    }
+
+    /// 获取指定页的128字节（可修改，整页记为已修改）
+    pub fn page_mut(&mut self, page: usize) -> &mut [u8] {
+        let range = page * OLED_WIDTH..(page + 1) * OLED_WIDTH;
+        self.mark_dirty(range.start, range.end);
+        &mut self.data[range]
+    }
+
+    /// 清空缓冲区
+    pub fn clear(&mut self) {
+        self.mark_dirty(0, OLED_FRAME_SIZE);
+        self.data.fill(0);
+    }
+
+    /// 用指定颜色填满缓冲区
+    pub fn fill(&mut self, color: OledColor) {
+        self.mark_dirty(0, OLED_FRAME_SIZE);
+        self.data.fill(match color {
+            OledColor::Black => 0x00,
+            OledColor::White => 0xFF,
+        });
+    }
+
+    /// 设置一个像素，超出屏幕范围的坐标被忽略
+    pub fn set_pixel(&mut self, x: i16, y: i16, color: OledColor) {
+        if x < 0 || y < 0 || x as usize >= OLED_WIDTH || y as usize >= OLED_HEIGHT {
+            return;
+        }
+        let index = (y as usize / 8) * OLED_WIDTH + x as usize;
+        let mask = 1u8 << (y as usize % 8);
+        self.mark_dirty(index, index + 1);
+        match color {
+            OledColor::White => self.data[index] |= mask,
+            OledColor::Black => self.data[index] &= !mask,
+        }
+    }
+
+    /// 读取一个像素，超出屏幕范围时返回`false`
+    pub fn get_pixel(&self, x: i16, y: i16) -> bool {
+        if x < 0 || y < 0 || x as usize >= OLED_WIDTH || y as usize >= OLED_HEIGHT {
+            return false;
+        }
+        let index = (y as usize / 8) * OLED_WIDTH + x as usize;
+        (self.data[index] & (1u8 << (y as usize % 8))) != 0
+    }
+
+    /// 填充矩形区域
+    ///
+    /// 按页处理：每页计算一次纵向位掩码，再对每列做一次与/或操作
+    pub fn fill_rect(&mut self, x: i16, y: i16, width: u16, height: u16, color: OledColor) {
+        let x1 = (x as i32).max(0);
+        let y1 = (y as i32).max(0);
+        let x2 = (x as i32 + width as i32).min(OLED_WIDTH as i32);
+        let y2 = (y as i32 + height as i32).min(OLED_HEIGHT as i32);
+        if x1 >= x2 || y1 >= y2 {
+            return;
+        }
+
+        let (x1, x2, y1, y2) = (x1 as usize, x2 as usize, y1 as usize, y2 as usize);
+        self.mark_dirty((y1 / 8) * OLED_WIDTH + x1, ((y2 - 1) / 8) * OLED_WIDTH + x2);
+        for page in y1 / 8..=(y2 - 1) / 8 {
+            let top = if page == y1 / 8 { y1 % 8 } else { 0 };
+            let bottom = if page == (y2 - 1) / 8 { (y2 - 1) % 8 } else { 7 };
+            let mask = (0xFFu8 >> (7 - bottom)) & (0xFFu8 << top);
+
+            let row = &mut self.data[page * OLED_WIDTH + x1..page * OLED_WIDTH + x2];
+            match color {
+                OledColor::White => row.iter_mut().for_each(|b| *b |= mask),
+                OledColor::Black => row.iter_mut().for_each(|b| *b &= !mask),
+            }
+        }
+    }
+
+    /// 画水平线
+    pub fn draw_hline(&mut self, x: i16, y: i16, width: u16, color: OledColor) {
+        self.fill_rect(x, y, width, 1, color);
+    }
+
+    /// 画垂直线
+    pub fn draw_vline(&mut self, x: i16, y: i16, height: u16, color: OledColor) {
+        self.fill_rect(x, y, 1, height, color);
+    }
+
+    /// 绘制页优先格式的位图（与`OLED_ShowImage`使用的字模格式相同），以或方式叠加
+    ///
+    /// # Arguments
+    /// * `x` - 左上角横坐标
+    /// * `y` - 左上角纵坐标
+    /// * `width` - 位图宽度
+    /// * `height` - 位图高度
+    /// * `image` - 位图数据，长度至少为`width * ((height + 7) / 8)`
+    pub fn draw_image(&mut self, x: i16, y: i16, width: u16, height: u16, image: &[u8]) {
+        let src_pages = (height as usize + 7) / 8;
+        if image.len() < width as usize * src_pages {
+            return;
+        }
+
+        for src_page in 0..src_pages {
+            let row = &image[src_page * width as usize..(src_page + 1) * width as usize];
+            let dest_y = y as i32 + (src_page * 8) as i32;
+            // 最后一页只取有效的行
+            let valid_rows = (height as usize - src_page * 8).min(8);
+            let valid_mask = 0xFFu8 >> (8 - valid_rows);
+
+            for (col, &bits) in row.iter().enumerate() {
+                let dest_x = x as i32 + col as i32;
+                if dest_x < 0 || dest_x >= OLED_WIDTH as i32 {
+                    continue;
+                }
+                let bits = bits & valid_mask;
+                self.or_column_bits(dest_x as usize, dest_y, bits);
+            }
+        }
+    }
+
+    /// 把8个纵向像素以或方式写到从`y`开始的位置（可能跨两页）
+    fn or_column_bits(&mut self, x: usize, y: i32, bits: u8) {
+        if y <= -8 || y >= OLED_HEIGHT as i32 || bits == 0 {
+            return;
+        }
+        let offset = y.rem_euclid(8) as u32;
+        let page = y.div_euclid(8);
+
+        if page >= 0 {
+            let index = page as usize * OLED_WIDTH + x;
+            self.mark_dirty(index, index + 1);
+            self.data[index] |= bits << offset;
+        }
+        if offset != 0 && page + 1 < OLED_PAGES as i32 {
+            let index = (page + 1) as usize * OLED_WIDTH + x;
+            self.mark_dirty(index, index + 1);
+            self.data[index] |= bits >> (8 - offset);
+        }
+    }
+}
+
+/// OLED双缓冲存储
+///
+/// 需要放在静态存储区，DMA在传输期间直接读取前台缓冲区
+pub struct OledBuffers {
+    frames: [FrameBuffer; 2],
+}
+
+impl OledBuffers {
+    /// 创建双缓冲存储
+    pub const fn new() -> Self {
+        Self {
+            frames: [FrameBuffer::new(); 2],
+        }
+    }
+}
+
+/// SSD1306显示驱动
+///
+/// 占用I2C1和DMA1通道6，不能与`c_oled`或`iic::IicEngine`同时使用
+pub struct Ssd1306 {
+    i2c: HardwareIic,
+    addr: u8,
+    buffers: &'static mut OledBuffers,
+    back: usize,
+    transfer: Option<DmaTransfer>,
+    /// DMA已结束、等待最后一个字节发出：DMA结束时间和DMA传输结果
+    draining: Option<(u64, Result<(), DmaError>)>,
+}
+
+impl Ssd1306 {
+    /// 创建显示驱动，使用默认地址0x78
+    ///
+    /// # Arguments
+    /// * `i2c` - 硬件IIC实例（I2C1，DMA发送使用DMA1通道6）
+    /// * `buffers` - 静态双缓冲存储
+    pub fn new(i2c: HardwareIic, buffers: &'static mut OledBuffers) -> Self {
+        Self::with_address(i2c, OLED_I2C_ADDR, buffers)
+    }
+
+    /// 创建显示驱动并指定8位IIC地址
+    pub fn with_address(i2c: HardwareIic, addr: u8, buffers: &'static mut OledBuffers) -> Self {
+        Self {
+            i2c,
+            addr,
+            buffers,
+            back: 0,
+            transfer: None,
+            draining: None,
+        }
+    }
+
+    /// 初始化IIC和SSD1306控制器
+    ///
+    /// # Safety
+    /// 直接访问IIC和DMA寄存器
+    pub unsafe fn init(&mut self) -> Result<(), OledError> {
+        self.i2c.init();
+        self.i2c.tx_dma().enable_clock();
+        self.write_commands(&OLED_INIT_SEQUENCE)
+    }
+
+    /// 获取后台缓冲区，绘制操作都作用在这里
+    pub fn buffer(&mut self) -> &mut FrameBuffer {
+        &mut self.buffers.frames[self.back]
+    }
+
+    /// 发送一组命令（一次IIC传输）
+    ///
+    /// # Safety
+    /// 直接访问IIC寄存器，不能在DMA传输进行中调用
+    pub unsafe fn write_commands(&mut self, commands: &[u8]) -> Result<(), OledError> {
+        let mut packet = [0u8; OLED_INIT_SEQUENCE.len() + 1];
+        for chunk in commands.chunks(packet.len() - 1) {
+            packet[0] = OLED_CONTROL_CMD;
+            packet[1..=chunk.len()].copy_from_slice(chunk);
+            self.i2c.write(self.addr, &packet[..=chunk.len()])?;
+        }
+        Ok(())
+    }
+
+    /// 设置对比度
+    pub unsafe fn set_contrast(&mut self, contrast: u8) -> Result<(), OledError> {
+        self.write_commands(&[0x81, contrast])
+    }
+
+    /// 打开或关闭显示
+    pub unsafe fn set_display_on(&mut self, on: bool) -> Result<(), OledError> {
+        self.write_commands(&[if on { 0xAF } else { 0xAE }])
+    }
+
+    /// 设置反色显示
+    pub unsafe fn set_inverted(&mut self, inverted: bool) -> Result<(), OledError> {
+        self.write_commands(&[if inverted { 0xA7 } else { 0xA6 }])
+    }
+
+    /// 检查是否有帧正在传输
+    pub fn is_busy(&self) -> bool {
+        self.transfer.is_some() || self.draining.is_some()
+    }
+
+    /// 提交后台缓冲区并启动DMA传输（非阻塞）
+    ///
+    /// 设置一次全屏地址窗口后，整帧1024字节在一次DMA传输中发送。
+    /// 提交后前后台交换，新的后台缓冲区以刚提交的帧为初始内容，可以直接在上面增量绘制；
+    /// 交换时只复制本帧修改过的字节范围，不复制整帧。
+    ///
+    /// # Returns
+    /// * `Ok(())` - 传输已启动
+    /// * `Err(OledError::Busy)` - 上一帧还在传输
+    ///
+    /// # Safety
+    /// 直接访问IIC和DMA寄存器；传输完成后需要调用`poll`（可在DMA1通道6中断中调用）
+    pub unsafe fn flush_async(&mut self) -> Result<(), OledError> {
+        if !self.poll()? {
+            return Err(OledError::Busy);
+        }
+
+        // 全屏窗口：列0~127，页0~7
+        self.write_commands(&[0x21, 0, (OLED_WIDTH - 1) as u8, 0x22, 0, (OLED_PAGES - 1) as u8])?;
+
+        let front = self.back;
+        let data = self.buffers.frames[front].as_bytes();
+        let transfer = self.i2c.start_write_dma(self.addr, &[OLED_CONTROL_DATA], data)?;
+        self.transfer = Some(transfer);
+
+        // 传输已启动才交换缓冲区，出错时调用者的后台缓冲区保持不变
+        self.back ^= 1;
+        let [first, second] = &mut self.buffers.frames;
+        let (front, back) = if front == 0 { (first, second) } else { (second, first) };
+        back.sync_from(front);
+        Ok(())
+    }
+
+    /// 查询并完成正在进行的帧传输
+    ///
+    /// DMA传输完成后结束IIC传输（最后一个字节发出后产生停止信号）。
+    /// 不会阻塞：最后一个字节仍在发送时返回`Ok(false)`，下次调用再结束。
+    /// 可以在主循环中轮询，也可以在DMA1通道6的中断处理函数中调用。
+    ///
+    /// # Returns
+    /// * `Ok(true)` - 没有正在进行的传输（或刚刚完成）
+    /// * `Ok(false)` - 传输仍在进行
+    /// * `Err(OledError)` - 传输出错，驱动已回到空闲状态
+    ///
+    /// # Safety
+    /// 直接访问IIC和DMA寄存器
+    pub unsafe fn poll(&mut self) -> Result<bool, OledError> {
+        if let Some(transfer) = &self.transfer {
+            let result = match transfer.poll() {
+                None => return Ok(false),
+                Some(result) => result,
+            };
+            self.transfer = None;
+            self.draining = Some((get_uptime_us(), result));
+        }
+
+        let (since, result) = match self.draining {
+            None => return Ok(true),
+            Some(draining) => draining,
+        };
+        let finish = match self.i2c.try_finish_write_dma(since) {
+            None => return Ok(false),
+            Some(finish) => finish,
+        };
+
+        self.draining = None;
+        result?;
+        finish?;
+        Ok(true)
+    }
+
+    /// 提交后台缓冲区并阻塞等待传输完成
+    ///
+    /// # Safety
+    /// 直接访问IIC和DMA寄存器
+    pub unsafe fn flush(&mut self) -> Result<(), OledError> {
+        while !self.poll()? {
+            core::hint::spin_loop();
+        }
+        self.flush_async()?;
+        while !self.poll()? {
+            core::hint::spin_loop();
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,349 @@
+//! 内存池模块
+//! 提供固定块大小的静态内存池，用于DMA缓冲区和消息对象
+//! 
+//! 分配和释放都是O(1)的无锁操作（LDREX/STREX比较交换），可在中断和主循环中同时使用。
+//! 分配得到的句柄在析构时自动归还，可在中断与主循环之间零拷贝传递，
+//! 多个功能共享同一个池，按实际并发需求而不是按每个功能的最大需求占用RAM。
+//! 
+//! ```ignore
+//! // 8个512字节的块，放在.dma_buffers段（池的初始状态全为0，该段由启动代码随.bss清零）
+//! #[link_section = ".dma_buffers"]
+//! static RX_POOL: BufferPool<512, 8> = BufferPool::new();
+//! 
+//! // 串口空闲中断中取一块接收缓冲区交给DMA
+//! let mut buffer = RX_POOL.alloc().ok_or(Error::NoBuffer)?;
+//! dma.start(&DmaTransferDescriptor::peripheral_to_memory(dr, buffer.as_mut_ptr() as u32, 512));
+//! 
+//! // 主循环处理完后`buffer`离开作用域，块自动归还
+//! ```
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::mem::MaybeUninit;
+use core::ops::{Deref, DerefMut};
+use core::sync::atomic::{AtomicU16, AtomicU32, AtomicUsize, Ordering};
+
+/// 链表结束标记（块编号按加1存储，0表示空）
+const NIL: u16 = 0;
+
+/// 池使用统计
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct PoolStats {
+    pub capacity: usize,   // 块数
+    pub used: usize,       // 当前已分配的块数
+    pub high_water: usize, // 历史最大同时分配的块数
+    pub failures: u32,     // 池耗尽导致分配失败的次数
+}
+
+/// 无锁空闲链表
+/// 
+/// 链表头为（版本号 << 16 | 块编号 + 1），每次修改版本号加1，避免ABA问题。
+/// 从未分配过的块不在链表中，由`fresh`按顺序发放，因此全0就是合法的初始状态，
+/// 不需要在启动时建立链表。
+struct FreeList<const N: usize> {
+    head: AtomicU32,
+    links: [AtomicU16; N],
+    fresh: AtomicUsize,
+    used: AtomicUsize,
+    high_water: AtomicUsize,
+    failures: AtomicU32,
+}
+
+impl<const N: usize> FreeList<N> {
+    const LINK_INIT: AtomicU16 = AtomicU16::new(NIL);
+    
+    const fn new() -> Self {
+        Self {
+            head: AtomicU32::new(NIL as u32),
+            links: [Self::LINK_INIT; N],
+            fresh: AtomicUsize::new(0),
+            used: AtomicUsize::new(0),
+            high_water: AtomicUsize::new(0),
+            failures: AtomicU32::new(0),
+        }
+    }
+    
+    /// 从链表头取一块
+    fn pop(&self) -> Option<usize> {
+        let mut head = self.head.load(Ordering::Acquire);
+        loop {
+            let first = (head & 0xFFFF) as u16;
+            if first == NIL {
+                return None;
+            }
+            let index = first as usize - 1;
+            let next = self.links[index].load(Ordering::Relaxed);
+            let new_head = (head >> 16).wrapping_add(1) << 16 | next as u32;
+            match self.head.compare_exchange_weak(head, new_head, Ordering::Acquire, Ordering::Acquire) {
+                Ok(_) => return Some(index),
+                Err(current) => head = current,
+            }
+        }
+    }
+    
+    /// 发放一块从未使用过的块
+    fn take_fresh(&self) -> Option<usize> {
+        let mut fresh = self.fresh.load(Ordering::Relaxed);
+        while fresh < N {
+            match self.fresh.compare_exchange_weak(fresh, fresh + 1, Ordering::Relaxed, Ordering::Relaxed) {
+                Ok(_) => return Some(fresh),
+                Err(current) => fresh = current,
+            }
+        }
+        None
+    }
+    
+    /// 分配一块，返回块编号
+    fn alloc(&self) -> Option<usize> {
+        match self.pop().or_else(|| self.take_fresh()) {
+            Some(index) => {
+                let used = self.used.fetch_add(1, Ordering::Relaxed) + 1;
+                self.high_water.fetch_max(used, Ordering::Relaxed);
+                Some(index)
+            }
+            None => {
+                self.failures.fetch_add(1, Ordering::Relaxed);
+                None
+            }
+        }
+    }
+    
+    /// 把一块放回链表头
+    fn free(&self, index: usize) {
+        let mut head = self.head.load(Ordering::Relaxed);
+        loop {
+            self.links[index].store((head & 0xFFFF) as u16, Ordering::Relaxed);
+            let new_head = (head >> 16).wrapping_add(1) << 16 | (index as u32 + 1);
+            match self.head.compare_exchange_weak(head, new_head, Ordering::Release, Ordering::Relaxed) {
+                Ok(_) => break,
+                Err(current) => head = current,
+            }
+        }
+        self.used.fetch_sub(1, Ordering::Relaxed);
+    }
+    
+    fn stats(&self) -> PoolStats {
+        PoolStats {
+            capacity: N,
+            used: self.used.load(Ordering::Relaxed),
+            high_water: self.high_water.load(Ordering::Relaxed),
+            failures: self.failures.load(Ordering::Relaxed),
+        }
+    }
+    
+    fn reset_high_water(&self) {
+        self.high_water.store(self.used.load(Ordering::Relaxed), Ordering::Relaxed);
+    }
+}
+
+/// 4字节对齐的数据块，可直接用于字宽DMA传输
+#[derive(Clone, Copy)]
+#[repr(C, align(4))]
+struct AlignedBlock<const SIZE: usize>([u8; SIZE]);
+
+/// 字节缓冲区池
+/// 
+/// - `SIZE`：每块字节数
+/// - `N`：块数（不超过65534）
+/// 
+/// 块按4字节对齐，内容在分配时不清零（保留上一次使用的数据）。
+pub struct BufferPool<const SIZE: usize, const N: usize> {
+    blocks: UnsafeCell<[AlignedBlock<SIZE>; N]>,
+    free: FreeList<N>,
+}
+
+/// 实现 Sync trait，每块同一时刻只属于一个句柄
+unsafe impl<const SIZE: usize, const N: usize> Sync for BufferPool<SIZE, N> {}
+
+impl<const SIZE: usize, const N: usize> BufferPool<SIZE, N> {
+    /// 编译期检查参数
+    const SIZE_CHECK: () = assert!(SIZE > 0 && N > 0 && N < 0xFFFF, "BufferPool要求 SIZE > 0 且 0 < N < 65535");
+    
+    /// 创建缓冲区池
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            blocks: UnsafeCell::new([AlignedBlock([0; SIZE]); N]),
+            free: FreeList::new(),
+        }
+    }
+    
+    /// 分配一块缓冲区
+    /// 
+    /// # Returns
+    /// 池耗尽时返回`None`
+    pub fn alloc(&self) -> Option<PoolBuffer<'_, SIZE, N>> {
+        self.free.alloc().map(|index| PoolBuffer { pool: self, index: index as u16 })
+    }
+    
+    /// 获取使用统计
+    pub fn stats(&self) -> PoolStats {
+        self.free.stats()
+    }
+    
+    /// 把最高水位重置为当前用量
+    pub fn reset_high_water(&self) {
+        self.free.reset_high_water();
+    }
+    
+    /// 第`index`块的地址
+    fn block(&self, index: u16) -> *mut [u8; SIZE] {
+        unsafe { core::ptr::addr_of_mut!((*self.blocks.get())[index as usize].0) }
+    }
+}
+
+/// 缓冲区句柄，析构时归还到池中
+/// 
+/// 解引用得到`[u8; SIZE]`；`as_ptr`/`as_mut_ptr`给出的地址在句柄存活期间保持不变，
+/// 可交给DMA使用，但必须在句柄析构前停止传输。
+pub struct PoolBuffer<'a, const SIZE: usize, const N: usize> {
+    pool: &'a BufferPool<SIZE, N>,
+    index: u16,
+}
+
+/// 实现 Send trait，句柄独占它所指向的块
+unsafe impl<'a, const SIZE: usize, const N: usize> Send for PoolBuffer<'a, SIZE, N> {}
+
+impl<'a, const SIZE: usize, const N: usize> PoolBuffer<'a, SIZE, N> {
+    /// 块编号
+    pub fn index(&self) -> usize {
+        self.index as usize
+    }
+    
+    /// 放弃所有权，返回块编号（用于通过原子变量等只能保存整数的通道传递）
+    pub fn into_raw(self) -> u16 {
+        let index = self.index;
+        core::mem::forget(self);
+        index
+    }
+    
+    /// 从`into_raw`得到的块编号恢复句柄
+    /// 
+    /// # Safety
+    /// `index`必须来自同一个池的`into_raw`，且只能恢复一次
+    pub unsafe fn from_raw(pool: &'a BufferPool<SIZE, N>, index: u16) -> Self {
+        Self { pool, index }
+    }
+}
+
+impl<'a, const SIZE: usize, const N: usize> Deref for PoolBuffer<'a, SIZE, N> {
+    type Target = [u8; SIZE];
+    
+    fn deref(&self) -> &[u8; SIZE] {
+        unsafe { &*self.pool.block(self.index) }
+    }
+}
+
+impl<'a, const SIZE: usize, const N: usize> DerefMut for PoolBuffer<'a, SIZE, N> {
+    fn deref_mut(&mut self) -> &mut [u8; SIZE] {
+        unsafe { &mut *self.pool.block(self.index) }
+    }
+}
+
+impl<'a, const SIZE: usize, const N: usize> Drop for PoolBuffer<'a, SIZE, N> {
+    fn drop(&mut self) {
+        self.pool.free.free(self.index as usize);
+    }
+}
+
+/// 类型化对象池，用于在中断和主循环之间传递的消息对象
+/// 
+/// ```ignore
+/// static FRAMES: ObjectPool<CanMessage, 16> = ObjectPool::new();
+/// 
+/// // 中断中
+/// if let Ok(frame) = FRAMES.alloc(message) {
+///     QUEUE.enqueue(frame);
+/// }
+/// ```
+pub struct ObjectPool<T, const N: usize> {
+    slots: UnsafeCell<MaybeUninit<[T; N]>>,
+    free: FreeList<N>,
+}
+
+/// 实现 Sync trait，每个对象同一时刻只属于一个句柄，句柄可跨上下文转移
+unsafe impl<T: Send, const N: usize> Sync for ObjectPool<T, N> {}
+
+impl<T, const N: usize> ObjectPool<T, N> {
+    /// 编译期检查参数
+    const SIZE_CHECK: () = assert!(N > 0 && N < 0xFFFF, "ObjectPool要求 0 < N < 65535");
+    
+    /// 创建对象池
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            slots: UnsafeCell::new(MaybeUninit::uninit()),
+            free: FreeList::new(),
+        }
+    }
+    
+    /// 分配一个槽位并放入`value`
+    /// 
+    /// # Returns
+    /// 池耗尽时把`value`原样返回
+    pub fn alloc(&self, value: T) -> Result<PoolBox<'_, T, N>, T> {
+        match self.free.alloc() {
+            Some(index) => {
+                unsafe { self.slot(index as u16).write(value) };
+                Ok(PoolBox { pool: self, index: index as u16 })
+            }
+            None => Err(value),
+        }
+    }
+    
+    /// 获取使用统计
+    pub fn stats(&self) -> PoolStats {
+        self.free.stats()
+    }
+    
+    /// 把最高水位重置为当前用量
+    pub fn reset_high_water(&self) {
+        self.free.reset_high_water();
+    }
+    
+    /// 第`index`个槽位的地址
+    fn slot(&self, index: u16) -> *mut T {
+        unsafe { (self.slots.get() as *mut T).add(index as usize) }
+    }
+}
+
+/// 对象句柄，析构时析构对象并归还槽位
+pub struct PoolBox<'a, T, const N: usize> {
+    pool: &'a ObjectPool<T, N>,
+    index: u16,
+}
+
+/// 实现 Send trait，句柄独占它所指向的对象
+unsafe impl<'a, T: Send, const N: usize> Send for PoolBox<'a, T, N> {}
+
+impl<'a, T, const N: usize> PoolBox<'a, T, N> {
+    /// 取出对象并归还槽位
+    pub fn into_inner(self) -> T {
+        let value = unsafe { self.pool.slot(self.index).read() };
+        self.pool.free.free(self.index as usize);
+        core::mem::forget(self);
+        value
+    }
+}
+
+impl<'a, T, const N: usize> Deref for PoolBox<'a, T, N> {
+    type Target = T;
+    
+    fn deref(&self) -> &T {
+        unsafe { &*self.pool.slot(self.index) }
+    }
+}
+
+impl<'a, T, const N: usize> DerefMut for PoolBox<'a, T, N> {
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.pool.slot(self.index) }
+    }
+}
+
+impl<'a, T, const N: usize> Drop for PoolBox<'a, T, N> {
+    fn drop(&mut self) {
+        unsafe { core::ptr::drop_in_place(self.pool.slot(self.index)) };
+        self.pool.free.free(self.index as usize);
+    }
+}
@@ -0,0 +1,270 @@
+//! 性能剖析模块
+//! 基于DWT周期计数器的代码段计时，提供最小/最大/平均值和log2直方图统计
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::fmt;
+use crate::bsp::delay::{enable_cycle_counter, cycle_count, system_clock};
+use crate::bsp::system::{log, LogLevel};
+
+/// 直方图桶数：第k个桶统计耗时在`[2^(k-1), 2^k)`个周期内的样本，第0个桶统计耗时为0的样本
+pub const PROFILE_BUCKETS: usize = 33;
+
+/// 初始化剖析模块（启用DWT周期计数器）
+/// 
+/// # Safety
+/// 直接访问内核调试寄存器，需要确保没有调试器依赖DWT的当前配置
+pub unsafe fn init() {
+    enable_cycle_counter();
+}
+
+/// 把周期数换算为微秒
+pub fn cycles_to_us(cycles: u32) -> u32 {
+    let cycles_per_us = system_clock() / 1_000_000;
+    if cycles_per_us == 0 { cycles } else { cycles / cycles_per_us }
+}
+
+/// 计数器统计数据
+#[derive(Debug, Clone, Copy)]
+pub struct ProfileSnapshot {
+    /// 样本数
+    pub count: u32,
+    /// 总周期数
+    pub total: u64,
+    /// 最短耗时（周期）
+    pub min: u32,
+    /// 最长耗时（周期）
+    pub max: u32,
+    /// log2直方图
+    pub histogram: [u32; PROFILE_BUCKETS],
+}
+
+impl ProfileSnapshot {
+    const EMPTY: Self = Self {
+        count: 0,
+        total: 0,
+        min: u32::MAX,
+        max: 0,
+        histogram: [0; PROFILE_BUCKETS],
+    };
+    
+    /// 平均耗时（周期）
+    pub fn mean(&self) -> u32 {
+        if self.count == 0 { 0 } else { (self.total / self.count as u64) as u32 }
+    }
+    
+    /// 估计百分位耗时（按直方图桶的上界，单位为周期）
+    /// 
+    /// # Arguments
+    /// * `percent` - 百分位（0~100），如99表示P99
+    pub fn percentile(&self, percent: u8) -> u32 {
+        if self.count == 0 {
+            return 0;
+        }
+        let target = ((self.count as u64 * percent.min(100) as u64 + 99) / 100).max(1);
+        let mut seen = 0u64;
+        for (bucket, &hits) in self.histogram.iter().enumerate() {
+            seen += hits as u64;
+            if seen >= target {
+                return Self::bucket_upper(bucket).min(self.max);
+            }
+        }
+        self.max
+    }
+    
+    /// 直方图桶的上界（含）
+    fn bucket_upper(bucket: usize) -> u32 {
+        match bucket {
+            0 => 0,
+            32 => u32::MAX,
+            k => (1u32 << k) - 1,
+        }
+    }
+}
+
+/// 命名的剖析计数器
+/// 
+/// 通常声明为`static`，在需要测量的代码段中用`scope`创建计时守卫：
+/// 
+/// ```ignore
+/// static SPI_TX: ProfileCounter = ProfileCounter::new("spi_tx");
+/// 
+/// fn send() {
+///     let _t = SPI_TX.scope();
+///     // 被测代码
+/// }
+/// ```
+/// 
+/// 开始计时只读取一次CYCCNT，结束时在短临界区内更新统计，
+/// 因此可以在中断中使用，并能在量产固件中常驻。
+pub struct ProfileCounter {
+    name: &'static str,
+    data: UnsafeCell<ProfileSnapshot>,
+}
+
+/// 实现 Sync trait，统计数据只在临界区内修改
+unsafe impl Sync for ProfileCounter {}
+
+impl ProfileCounter {
+    /// 创建新的计数器
+    pub const fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            data: UnsafeCell::new(ProfileSnapshot::EMPTY),
+        }
+    }
+    
+    /// 获取计数器名称
+    pub fn name(&self) -> &'static str {
+        self.name
+    }
+    
+    /// 记录一个样本
+    /// 
+    /// # Arguments
+    /// * `cycles` - 耗时（周期）
+    #[inline]
+    pub fn record(&self, cycles: u32) {
+        let bucket = (32 - cycles.leading_zeros()) as usize;
+        cortex_m::interrupt::free(|_| unsafe {
+            let data = &mut *self.data.get();
+            data.count = data.count.wrapping_add(1);
+            data.total += cycles as u64;
+            if cycles < data.min {
+                data.min = cycles;
+            }
+            if cycles > data.max {
+                data.max = cycles;
+            }
+            data.histogram[bucket] = data.histogram[bucket].saturating_add(1);
+        });
+    }
+    
+    /// 开始计时，守卫drop时记录耗时
+    #[inline(always)]
+    pub fn scope(&self) -> ProfileScope<'_> {
+        ProfileScope {
+            counter: self,
+            start: cycle_count(),
+        }
+    }
+    
+    /// 测量闭包的耗时
+    #[inline(always)]
+    pub fn measure<R>(&self, f: impl FnOnce() -> R) -> R {
+        let _scope = self.scope();
+        f()
+    }
+    
+    /// 记录从`start`（之前读取的`cycle_count()`）到现在的耗时
+    /// 
+    /// 用于起止点不在同一作用域的测量，如在中断入口记录触发源时间戳计算中断延迟。
+    #[inline(always)]
+    pub fn record_since(&self, start: u32) {
+        self.record(cycle_count().wrapping_sub(start));
+    }
+    
+    /// 获取统计数据的一致副本
+    pub fn snapshot(&self) -> ProfileSnapshot {
+        cortex_m::interrupt::free(|_| unsafe { *self.data.get() })
+    }
+    
+    /// 清除统计数据
+    pub fn reset(&self) {
+        cortex_m::interrupt::free(|_| unsafe {
+            *self.data.get() = ProfileSnapshot::EMPTY;
+        });
+    }
+    
+    /// 以文本格式输出统计结果
+    /// 
+    /// 第一行为名称、样本数和最小/平均/最大/P99耗时（周期和微秒），
+    /// 第二行为非零的直方图桶，格式为`<上界:样本数`。
+    pub fn write_to<W: fmt::Write>(&self, out: &mut W) -> fmt::Result {
+        let s = self.snapshot();
+        if s.count == 0 {
+            return writeln!(out, "{}: n=0", self.name);
+        }
+        
+        let p99 = s.percentile(99);
+        writeln!(
+            out,
+            "{}: n={} min={} mean={} max={} p99={} cyc ({}/{}/{}/{} us)",
+            self.name, s.count, s.min, s.mean(), s.max, p99,
+            cycles_to_us(s.min), cycles_to_us(s.mean()), cycles_to_us(s.max), cycles_to_us(p99),
+        )?;
+        
+        write!(out, "  hist")?;
+        for (bucket, &hits) in s.histogram.iter().enumerate() {
+            if hits != 0 {
+                write!(out, " <{}:{}", ProfileSnapshot::bucket_upper(bucket) as u64 + 1, hits)?;
+            }
+        }
+        writeln!(out)
+    }
+}
+
+/// 计时守卫，drop时把耗时记录到计数器
+pub struct ProfileScope<'a> {
+    counter: &'a ProfileCounter,
+    start: u32,
+}
+
+impl<'a> ProfileScope<'a> {
+    /// 到目前为止的耗时（周期）
+    pub fn elapsed(&self) -> u32 {
+        cycle_count().wrapping_sub(self.start)
+    }
+}
+
+impl<'a> Drop for ProfileScope<'a> {
+    #[inline(always)]
+    fn drop(&mut self) {
+        self.counter.record(cycle_count().wrapping_sub(self.start));
+    }
+}
+
+/// 把一组计数器的统计结果输出到任意`fmt::Write`（如`Serial`）
+pub fn dump<W: fmt::Write>(counters: &[&ProfileCounter], out: &mut W) -> fmt::Result {
+    for counter in counters {
+        counter.write_to(out)?;
+    }
+    Ok(())
+}
+
+/// 逐行写入日志处理函数的适配器
+struct LogWriter {
+    line: heapless::String<128>,
+}
+
+impl LogWriter {
+    fn flush(&mut self) {
+        if !self.line.is_empty() {
+            log(LogLevel::Info, self.line.as_str());
+            self.line.clear();
+        }
+    }
+}
+
+impl fmt::Write for LogWriter {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        for c in s.chars() {
+            if c == '\n' {
+                self.flush();
+            } else if self.line.push(c).is_err() {
+                // 行过长时分段输出
+                self.flush();
+                let _ = self.line.push(c);
+            }
+        }
+        Ok(())
+    }
+}
+
+/// 把一组计数器的统计结果输出到`system::set_log_handler`设置的日志处理函数
+pub fn dump_to_log(counters: &[&ProfileCounter]) {
+    let mut writer = LogWriter { line: heapless::String::new() };
+    let _ = dump(counters, &mut writer);
+    writer.flush();
+}
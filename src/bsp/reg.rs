@@ -0,0 +1,136 @@
+//! 寄存器访问模块
+//! 提供地址在编译期确定的零大小寄存器类型和各驱动共用的外设基地址
+//! 
+//! `Reg<ADDR>`不占存储空间，地址是类型的一部分，每次访问编译为一条LDR/STR（读-改-写为LDR+STR），
+//! 不需要运行时查表。驱动用`const`定义自己用到的寄存器：
+//! 
+//! ```ignore
+//! const SYST_RVR: Reg<{ SYSTICK_BASE + 0x04 }> = Reg::new();
+//! 
+//! SYST_RVR.write(72_000 - 1);
+//! ```
+//! 
+//! 地址依赖泛型参数时（如`gpio::FastPin`），Rust稳定版不能把表达式写进类型参数，
+//! 改用关联常量计算地址后调用`read`/`write`/`modify`，常量传播后生成的代码相同。
+
+#![allow(unused)]
+
+/// RCC基地址
+pub const RCC_BASE: usize = 0x4002_1000;
+/// GPIOA基地址，GPIOB~GPIOG依次相隔`GPIO_PORT_STRIDE`
+pub const GPIOA_BASE: usize = 0x4001_0800;
+/// 相邻GPIO端口寄存器块的间隔
+pub const GPIO_PORT_STRIDE: usize = 0x400;
+/// SysTick基地址
+pub const SYSTICK_BASE: usize = 0xE000_E010;
+/// SCB基地址（CPUID寄存器）
+pub const SCB_BASE: usize = 0xE000_ED00;
+
+/// RCC APB2外设时钟使能寄存器
+pub const RCC_APB2ENR: Reg<{ RCC_BASE + 0x18 }> = Reg::new();
+/// RCC APB1外设时钟使能寄存器
+pub const RCC_APB1ENR: Reg<{ RCC_BASE + 0x1C }> = Reg::new();
+/// RCC AHB外设时钟使能寄存器
+pub const RCC_AHBENR: Reg<{ RCC_BASE + 0x14 }> = Reg::new();
+
+/// 中断控制和状态寄存器
+pub const SCB_ICSR: Reg<{ SCB_BASE + 0x04 }> = Reg::new();
+/// 应用中断和复位控制寄存器
+pub const SCB_AIRCR: Reg<{ SCB_BASE + 0x0C }> = Reg::new();
+/// 系统控制寄存器
+pub const SCB_SCR: Reg<{ SCB_BASE + 0x10 }> = Reg::new();
+
+/// GPIO端口寄存器块基地址
+/// 
+/// # Arguments
+/// * `port` - 端口序号，0对应GPIOA
+#[inline(always)]
+pub const fn gpio_base(port: usize) -> usize {
+    GPIOA_BASE + port * GPIO_PORT_STRIDE
+}
+
+/// 地址在编译期确定的32位寄存器
+#[derive(Debug, Clone, Copy)]
+pub struct Reg<const ADDR: usize>;
+
+impl<const ADDR: usize> Reg<ADDR> {
+    /// 寄存器地址
+    pub const ADDRESS: usize = ADDR;
+    
+    /// 创建寄存器句柄（不占存储空间）
+    pub const fn new() -> Self {
+        Self
+    }
+    
+    /// 读取寄存器
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，需要确保对应外设时钟已使能
+    #[inline(always)]
+    pub unsafe fn read(&self) -> u32 {
+        read(ADDR)
+    }
+    
+    /// 写入寄存器
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+    #[inline(always)]
+    pub unsafe fn write(&self, value: u32) {
+        write(ADDR, value)
+    }
+    
+    /// 读-改-写寄存器，不是原子操作，与中断共享时需要调用者加锁
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+    #[inline(always)]
+    pub unsafe fn modify<F: FnOnce(u32) -> u32>(&self, f: F) {
+        modify(ADDR, f)
+    }
+    
+    /// 置位`mask`中的位
+    /// 
+    /// # Safety
+    /// 同`modify`
+    #[inline(always)]
+    pub unsafe fn set_bits(&self, mask: u32) {
+        modify(ADDR, |value| value | mask)
+    }
+    
+    /// 清零`mask`中的位
+    /// 
+    /// # Safety
+    /// 同`modify`
+    #[inline(always)]
+    pub unsafe fn clear_bits(&self, mask: u32) {
+        modify(ADDR, |value| value & !mask)
+    }
+}
+
+/// 读取指定地址的寄存器
+/// 
+/// # Safety
+/// `addr`必须是有效的32位寄存器地址
+#[inline(always)]
+pub unsafe fn read(addr: usize) -> u32 {
+    core::ptr::read_volatile(addr as *const u32)
+}
+
+/// 写入指定地址的寄存器
+/// 
+/// # Safety
+/// `addr`必须是有效的32位寄存器地址
+#[inline(always)]
+pub unsafe fn write(addr: usize, value: u32) {
+    core::ptr::write_volatile(addr as *mut u32, value)
+}
+
+/// 读-改-写指定地址的寄存器
+/// 
+/// # Safety
+/// `addr`必须是有效的32位寄存器地址
+#[inline(always)]
+pub unsafe fn modify<F: FnOnce(u32) -> u32>(addr: usize, f: F) {
+    write(addr, f(read(addr)))
+}
@@ -0,0 +1,482 @@
+//! RS-485多机总线模块
+//! 基于USART多处理器通信（地址标记唤醒）和DMA发送实现的半双工多点总线驱动
+//! 
+//! 帧格式为9位数据、无校验：第一个字符的第9位为1，低4位为目标节点地址，其后的数据字符第9位为0。
+//! 
+//! - 接收：节点平时处于静默模式（RWU），接收器只比较地址字符，地址与CR2.ADD不符的帧不产生任何中断；
+//!   地址匹配时硬件退出静默，之后的字节逐个进入`handle_interrupt`，检测到总线空闲后帧结束并重新静默。
+//!   因此帧之间至少要有一个字符时间的空闲
+//! - 发送：`send_frame`拉高DE后由CPU写入地址字符，数据部分由DMA送到DR；
+//!   DMA传输完成后使能TC中断，最后一个字符移出移位寄存器时释放DE，切回接收
+//! 
+//! DE和/RE通常接在同一个GPIO上。需要在NVIC中使能对应的USART中断和发送DMA通道中断，
+//! 分别调用`handle_interrupt`和`handle_dma_interrupt`。
+//! 
+//! ```ignore
+//! static BUS_BUFFER: Rs485Buffer<64> = Rs485Buffer::new();
+//! static BUS: Rs485Bus<64> = Rs485Bus::new(SerialPort::USART2, PA1, &BUS_BUFFER);
+//! 
+//! BUS.init(BaudRate::B115200, 3)?;     // 本节点地址3
+//! BUS.send_frame(5, b"ping")?;         // 发给节点5
+//! 
+//! // USART2中断
+//! BUS.handle_interrupt();
+//! // DMA1通道7中断
+//! BUS.handle_dma_interrupt();
+//! 
+//! let mut frame = [0u8; 64];
+//! if let Some(len) = BUS.read_frame(&mut frame) { /* 处理frame[..len] */ }
+//! ```
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+use crate::bsp::dma::{Dma, DmaError, DmaInterrupt, DmaMemoryDataSize, DmaPeripheralDataSize, DmaTransferDescriptor};
+use crate::bsp::gpio::GpioPortStruct;
+use crate::bsp::idle::{self, Activity};
+use crate::bsp::reg;
+use crate::bsp::serial::{BaudRate, Parity, Serial, SerialConfig, SerialPort, WakeUpMode, WordLength};
+
+/// 最大节点地址（CR2.ADD为4位）
+pub const RS485_MAX_ADDRESS: u8 = 0x0F;
+
+/// 地址字符标记（9位模式下的第9位）
+const ADDRESS_MARK: u32 = 1 << 8;
+
+/// USART寄存器偏移地址
+const USART_SR_OFFSET: usize = 0x00;
+const USART_DR_OFFSET: usize = 0x04;
+const USART_CR1_OFFSET: usize = 0x0C;
+
+/// SR状态位
+const SR_ORE: u32 = 1 << 3;
+const SR_NE: u32 = 1 << 2;
+const SR_FE: u32 = 1 << 1;
+const SR_IDLE: u32 = 1 << 4;
+const SR_RXNE: u32 = 1 << 5;
+const SR_TC: u32 = 1 << 6;
+const SR_TXE: u32 = 1 << 7;
+/// SR有效位（高位保留）
+const SR_WRITE_MASK: u32 = 0x3FF;
+/// CR1发送完成中断使能位
+const CR1_TCIE: u32 = 1 << 6;
+/// CR1接收器静默位
+const CR1_RWU: u32 = 1 << 1;
+/// CR3 DMA发送使能位
+const CR3_DMAT: u32 = 1 << 7;
+
+/// RS-485总线错误类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Rs485Error {
+    /// 节点地址超过`RS485_MAX_ADDRESS`
+    InvalidAddress,
+    /// 数据长度超过缓冲区大小
+    FrameTooLong,
+    /// 上一帧仍在发送
+    Busy,
+    /// DMA启动失败
+    Dma(DmaError),
+}
+
+impl From<DmaError> for Rs485Error {
+    fn from(err: DmaError) -> Self {
+        Rs485Error::Dma(err)
+    }
+}
+
+/// RS-485收发缓冲区
+/// 
+/// 接收缓冲区只保存一帧：上一帧未被`read_frame`取走时新到的帧被丢弃并计数。
+/// 发送缓冲区保存正在由DMA发送的数据，`send_frame`返回后调用者的数据即可复用。
+pub struct Rs485Buffer<const N: usize> {
+    rx: UnsafeCell<[u8; N]>,
+    tx: UnsafeCell<[u8; N]>,
+    /// 当前帧已接收的字节数
+    rx_len: AtomicUsize,
+    /// 已完成帧的长度
+    frame_len: AtomicUsize,
+    /// 是否正在接收一帧
+    receiving: AtomicBool,
+    /// 是否有已完成但未读取的帧
+    ready: AtomicBool,
+    /// 是否正在发送
+    tx_busy: AtomicBool,
+    /// 丢弃的帧数（未及时读取或超长）
+    dropped: AtomicUsize,
+    /// 接收错误次数（溢出、噪声、帧错误）和DMA传输错误次数
+    errors: AtomicUsize,
+}
+
+/// 实现 Sync trait，接收缓冲区只在中断中写入、在`ready`置位后由线程读取；
+/// 发送缓冲区只在`tx_busy`为假时由线程写入
+unsafe impl<const N: usize> Sync for Rs485Buffer<N> {}
+
+impl<const N: usize> Rs485Buffer<N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N > 0 && N <= 65535, "Rs485Buffer大小必须在1~65535之间");
+    
+    /// 创建新的收发缓冲区
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            rx: UnsafeCell::new([0; N]),
+            tx: UnsafeCell::new([0; N]),
+            rx_len: AtomicUsize::new(0),
+            frame_len: AtomicUsize::new(0),
+            receiving: AtomicBool::new(false),
+            ready: AtomicBool::new(false),
+            tx_busy: AtomicBool::new(false),
+            dropped: AtomicUsize::new(0),
+            errors: AtomicUsize::new(0),
+        }
+    }
+    
+    /// 接收到地址匹配的地址字符，开始新的一帧
+    fn begin_frame(&self) {
+        if self.receiving.load(Ordering::Relaxed) {
+            // 两帧之间没有空闲间隔，先结束上一帧
+            self.end_frame();
+        }
+        if self.ready.load(Ordering::Acquire) {
+            self.dropped.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        self.rx_len.store(0, Ordering::Relaxed);
+        self.receiving.store(true, Ordering::Relaxed);
+    }
+    
+    /// 追加一个数据字节，超长时丢弃整帧
+    fn push(&self, byte: u8) {
+        if !self.receiving.load(Ordering::Relaxed) {
+            return;
+        }
+        let len = self.rx_len.load(Ordering::Relaxed);
+        if len >= N {
+            self.receiving.store(false, Ordering::Relaxed);
+            self.dropped.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        unsafe {
+            (*self.rx.get())[len] = byte;
+        }
+        self.rx_len.store(len + 1, Ordering::Relaxed);
+    }
+    
+    /// 结束当前帧并发布给`read_frame`
+    fn end_frame(&self) {
+        if !self.receiving.swap(false, Ordering::Relaxed) {
+            return;
+        }
+        self.frame_len.store(self.rx_len.load(Ordering::Relaxed), Ordering::Relaxed);
+        self.ready.store(true, Ordering::Release);
+    }
+}
+
+/// RS-485多机总线
+/// 
+/// `N`为单帧数据的最大长度（不含地址字符）
+#[derive(Clone, Copy)]
+pub struct Rs485Bus<const N: usize> {
+    port: SerialPort,
+    serial: Serial,
+    /// 收发方向控制引脚（DE，通常同时接/RE）
+    de: GpioPortStruct,
+    /// DE是否高电平有效
+    de_active_high: bool,
+    buffer: &'static Rs485Buffer<N>,
+}
+
+impl<const N: usize> Rs485Bus<N> {
+    /// 创建新的RS-485总线实例，DE高电平有效
+    /// 
+    /// # Arguments
+    /// * `port` - 使用的串口
+    /// * `de` - 收发方向控制引脚
+    /// * `buffer` - 收发缓冲区
+    pub const fn new(port: SerialPort, de: GpioPortStruct, buffer: &'static Rs485Buffer<N>) -> Self {
+        Self {
+            port,
+            serial: Serial::new(port),
+            de,
+            de_active_high: true,
+            buffer,
+        }
+    }
+    
+    /// DE改为低电平有效（收发器方向控制经过反相时使用）
+    pub const fn with_de_active_low(mut self) -> Self {
+        self.de_active_high = false;
+        self
+    }
+    
+    /// 获取底层串口
+    pub fn serial(&self) -> &Serial {
+        &self.serial
+    }
+    
+    /// 获取发送DMA通道
+    fn dma(&self) -> Dma {
+        self.port.tx_dma()
+    }
+    
+    /// 获取串口寄存器基地址
+    fn base(&self) -> usize {
+        self.port.base_address() as usize
+    }
+    
+    /// 驱动总线（DE有效）
+    unsafe fn drive(&self) {
+        if self.de_active_high {
+            self.de.set_high();
+        } else {
+            self.de.set_low();
+        }
+    }
+    
+    /// 释放总线，切回接收（DE无效）
+    unsafe fn release(&self) {
+        if self.de_active_high {
+            self.de.set_low();
+        } else {
+            self.de.set_high();
+        }
+    }
+    
+    /// 初始化总线
+    /// 
+    /// 串口配置为9位数据、无校验、地址标记唤醒，写入节点地址后进入静默模式。
+    /// 总线节点需要随时接收，初始化后持有`Activity::Serial`，空闲管理器不会进入停止模式。
+    /// TX/RX引脚的复用功能由调用者配置。
+    /// 
+    /// # Arguments
+    /// * `baud_rate` - 波特率
+    /// * `address` - 本节点地址（0~15）
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，需要确保串口和DE引脚未被其他代码占用
+    pub unsafe fn init(&self, baud_rate: BaudRate, address: u8) -> Result<(), Rs485Error> {
+        if address > RS485_MAX_ADDRESS {
+            return Err(Rs485Error::InvalidAddress);
+        }
+        
+        // 先切到接收方向，避免初始化期间占用总线
+        self.de.into_push_pull_output();
+        self.release();
+        
+        let config = SerialConfig {
+            baud_rate,
+            word_length: WordLength::Bits9,
+            parity: Parity::None,
+            wakeup_mode: WakeUpMode::AddressMark,
+            rx_interrupt: true,
+            idle_interrupt: true,
+            ..SerialConfig::new()
+        };
+        let mut image = self.serial.init_image(&config);
+        image.cr2 |= address as u32;
+        image.cr3 |= CR3_DMAT;
+        self.serial.init_with_image(&image);
+        
+        // USART使能后再置位RWU进入静默模式
+        reg::modify(self.base() + USART_CR1_OFFSET, |cr1| cr1 | CR1_RWU);
+        
+        idle::acquire(Activity::Serial);
+        Ok(())
+    }
+    
+    /// 立即进入静默模式，丢弃当前正在接收的帧
+    pub fn mute(&self) {
+        cortex_m::interrupt::free(|_| unsafe {
+            self.buffer.receiving.store(false, Ordering::Relaxed);
+            reg::modify(self.base() + USART_CR1_OFFSET, |cr1| cr1 | CR1_RWU);
+        });
+    }
+    
+    /// 接收器是否处于静默模式
+    pub fn is_muted(&self) -> bool {
+        unsafe { reg::read(self.base() + USART_CR1_OFFSET) & CR1_RWU != 0 }
+    }
+    
+    /// 发送一帧
+    /// 
+    /// 数据拷入内部缓冲区后立即返回，由DMA和TC中断完成发送并释放DE
+    /// 
+    /// # Arguments
+    /// * `address` - 目标节点地址（0~15）
+    /// * `payload` - 数据，长度不超过`N`，可以为空
+    /// 
+    /// # Returns
+    /// 上一帧未发送完时返回`Rs485Error::Busy`
+    pub fn send_frame(&self, address: u8, payload: &[u8]) -> Result<(), Rs485Error> {
+        if address > RS485_MAX_ADDRESS {
+            return Err(Rs485Error::InvalidAddress);
+        }
+        if payload.len() > N {
+            return Err(Rs485Error::FrameTooLong);
+        }
+        if self.buffer.tx_busy.swap(true, Ordering::AcqRel) {
+            return Err(Rs485Error::Busy);
+        }
+        
+        unsafe {
+            let tx = &mut *self.buffer.tx.get();
+            tx[..payload.len()].copy_from_slice(payload);
+        }
+        
+        let base = self.base();
+        unsafe {
+            self.drive();
+            // SR的TC位写0清除，写1的位不受影响
+            reg::write(base + USART_SR_OFFSET, SR_WRITE_MASK & !SR_TC);
+            while reg::read(base + USART_SR_OFFSET) & SR_TXE == 0 {
+                core::hint::spin_loop();
+            }
+            reg::write(base + USART_DR_OFFSET, ADDRESS_MARK | address as u32);
+        }
+        
+        if payload.is_empty() {
+            self.enable_tc_interrupt();
+            return Ok(());
+        }
+        
+        // 字节读出、半字写入DR，高位补0即第9位为0的数据字符
+        let desc = DmaTransferDescriptor::memory_to_peripheral(
+            self.buffer.tx.get() as u32,
+            self.port.dr_address(),
+            payload.len() as u16,
+        )
+        .with_data_size(DmaPeripheralDataSize::HalfWord, DmaMemoryDataSize::Byte)
+        .with_interrupts(true, false, true);
+        
+        let dma = self.dma();
+        unsafe {
+            dma.disable();
+            if let Err(err) = dma.start(&desc) {
+                // 地址字符已发出，等它移出后再释放总线
+                self.enable_tc_interrupt();
+                return Err(err.into());
+            }
+        }
+        Ok(())
+    }
+    
+    /// 使能TC中断，最后一个字符发送完成后在`handle_interrupt`中释放DE
+    fn enable_tc_interrupt(&self) {
+        cortex_m::interrupt::free(|_| unsafe {
+            reg::modify(self.base() + USART_CR1_OFFSET, |cr1| cr1 | CR1_TCIE);
+        });
+    }
+    
+    /// 处理发送DMA通道中断：数据已全部写入DR，等待TC释放总线
+    pub fn handle_dma_interrupt(&self) {
+        let dma = self.dma();
+        unsafe {
+            let error = dma.check_interrupt(DmaInterrupt::TransferError);
+            if !error && !dma.check_interrupt(DmaInterrupt::TransferComplete) {
+                return;
+            }
+            dma.clear_all_interrupts();
+            dma.disable();
+            if error {
+                self.buffer.errors.fetch_add(1, Ordering::Relaxed);
+            }
+            
+            // TC可能还是之前某个字符留下的，不清除会使TC中断在最后一个字符移出前释放DE。
+            // 此时最后一个字符刚写入DR、还没开始移位，清除后TC只会在它发送完成时重新置位
+            let base = self.base();
+            let _ = reg::read(base + USART_SR_OFFSET);
+            reg::write(base + USART_SR_OFFSET, SR_WRITE_MASK & !SR_TC);
+        }
+        self.enable_tc_interrupt();
+    }
+    
+    /// 处理USART中断：接收地址匹配的帧，发送完成后释放DE
+    /// 
+    /// 静默期间地址不匹配的帧不会进入此函数
+    pub fn handle_interrupt(&self) {
+        let base = self.base();
+        unsafe {
+            let sr = reg::read(base + USART_SR_OFFSET);
+            
+            if sr & (SR_RXNE | SR_ORE | SR_NE | SR_FE) != 0 {
+                // 读DR同时清除RXNE、错误标志和IDLE
+                let data = reg::read(base + USART_DR_OFFSET) & 0x1FF;
+                if sr & (SR_ORE | SR_NE | SR_FE) != 0 {
+                    self.buffer.errors.fetch_add(1, Ordering::Relaxed);
+                }
+                if sr & SR_RXNE != 0 {
+                    if data & ADDRESS_MARK != 0 {
+                        self.buffer.begin_frame();
+                    } else {
+                        self.buffer.push(data as u8);
+                    }
+                }
+            } else if sr & SR_IDLE != 0 {
+                let _ = reg::read(base + USART_DR_OFFSET);
+            }
+            
+            if sr & SR_IDLE != 0 {
+                // 总线空闲，帧结束，重新静默等待下一个地址字符
+                self.buffer.end_frame();
+                reg::modify(base + USART_CR1_OFFSET, |cr1| cr1 | CR1_RWU);
+            }
+            
+            if sr & SR_TC != 0 && reg::read(base + USART_CR1_OFFSET) & CR1_TCIE != 0 {
+                reg::modify(base + USART_CR1_OFFSET, |cr1| cr1 & !CR1_TCIE);
+                reg::write(base + USART_SR_OFFSET, SR_WRITE_MASK & !SR_TC);
+                self.release();
+                self.buffer.tx_busy.store(false, Ordering::Release);
+            }
+        }
+    }
+    
+    /// 读取已接收的一帧
+    /// 
+    /// # Arguments
+    /// * `dest` - 目标缓冲区，比帧短时只拷贝前面部分
+    /// 
+    /// # Returns
+    /// 有完整帧时返回帧长度（不含地址字符），否则返回`None`
+    pub fn read_frame(&self, dest: &mut [u8]) -> Option<usize> {
+        if !self.buffer.ready.load(Ordering::Acquire) {
+            return None;
+        }
+        let len = self.buffer.frame_len.load(Ordering::Relaxed);
+        let count = len.min(dest.len());
+        unsafe {
+            let rx = &*self.buffer.rx.get();
+            dest[..count].copy_from_slice(&rx[..count]);
+        }
+        self.buffer.ready.store(false, Ordering::Release);
+        Some(len)
+    }
+    
+    /// 是否有未读取的帧
+    pub fn has_frame(&self) -> bool {
+        self.buffer.ready.load(Ordering::Acquire)
+    }
+    
+    /// 是否正在发送
+    pub fn is_tx_busy(&self) -> bool {
+        self.buffer.tx_busy.load(Ordering::Acquire)
+    }
+    
+    /// 等待当前帧发送完成并释放总线
+    pub fn flush(&self) {
+        while self.is_tx_busy() {
+            core::hint::spin_loop();
+        }
+    }
+    
+    /// 获取丢弃的帧数
+    pub fn dropped_frames(&self) -> usize {
+        self.buffer.dropped.load(Ordering::Relaxed)
+    }
+    
+    /// 获取接收和DMA错误次数
+    pub fn error_count(&self) -> usize {
+        self.buffer.errors.load(Ordering::Relaxed)
+    }
+}
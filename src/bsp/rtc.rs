@@ -31,6 +31,12 @@ impl Rtc {
     }
     
     /// 初始化RTC
+    /// 
+    /// RTC已经由LSE驱动运行时不复位备份域，计数器和备份寄存器在软件/看门狗复位后保持不变，
+    /// 只重新写入预分频值；否则复位备份域并启动LSE。
+    /// 
+    /// # Arguments
+    /// * `prescaler` - 直接写入RTC_PRL的重装载值，计数频率为`32768 / (prescaler + 1)`Hz（如32767对应1Hz）
     pub unsafe fn init(&self, prescaler: u32) {
         let rcc = self.rcc();
         let pwr = self.pwr();
@@ -46,34 +52,41 @@ impl Rtc {
             .dbp().set_bit()
         );
         
-        // 重置备份域
-        rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
-            .bdrst().set_bit()
-        );
-        rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
-            .bdrst().clear_bit()
-        );
+        // RTC已由LSE驱动运行（如软件/看门狗复位后）时保留备份域，
+        // 否则复位会清除计数器和备份寄存器（包括watchdog的超时记录）
+        let bdcr = rcc.bdcr().read();
+        let running = bdcr.rtcen().bit_is_set() && bdcr.rtcsel().bits() == 0b10 && bdcr.lserdy().bit_is_set();
         
-        // 启用LSE振荡器
-        rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
-            .lseon().set_bit()
-        );
-        
-        // 等待LSE就绪
-        while rcc.bdcr().read().lserdy().bit_is_clear() {
-            core::hint::spin_loop();
+        if !running {
+            // 重置备份域
+            rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
+                .bdrst().set_bit()
+            );
+            rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
+                .bdrst().clear_bit()
+            );
+            
+            // 启用LSE振荡器
+            rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
+                .lseon().set_bit()
+            );
+            
+            // 等待LSE就绪
+            while rcc.bdcr().read().lserdy().bit_is_clear() {
+                core::hint::spin_loop();
+            }
+            
+            // 选择LSE作为RTC时钟源
+            rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
+                .rtcsel().bits(0b10)
+            );
+            
+            // 启用RTC时钟
+            rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
+                .rtcen().set_bit()
+            );
         }
         
-        // 选择LSE作为RTC时钟源
-        rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
-            .rtcsel().bits(0b10)
-        );
-        
-        // 启用RTC时钟
-        rcc.bdcr().modify(|_, w: &mut library::rcc::bdcr::W| w
-            .rtcen().set_bit()
-        );
-        
         // 进入配置模式
         self.enter_config_mode();
         
@@ -0,0 +1,340 @@
+//! 抢占式任务调度模块
+//! 仿照RTIC，直接用NVIC硬件完成按优先级的抢占调度
+//! 
+//! - 软件任务绑定一个应用没有用到的中断向量，`spawn`只是置位该中断的挂起位，
+//!   由NVIC按优先级决定立即抢占还是稍后执行，调度开销就是一次中断进入/退出
+//! - 硬件任务（定时器、DMA等外设中断）用`bind_interrupt`按同一套优先级配置
+//! - 共享资源按优先级天花板协议加锁：`lock`把BASEPRI提高到访问该资源的最高任务优先级，
+//!   只屏蔽可能争用这个资源的任务，比它更紧急的任务照常抢占
+//! 
+//! 优先级使用逻辑值`1..=MAX_PRIORITY`，数值越大越紧急（与NVIC硬件数值相反），0表示线程模式。
+//! 硬件优先级0不分配给任务，留给不访问共享资源、任何锁都不能推迟的中断。
+//! `init`把优先级分组设为Group4（4位全部用作抢占优先级）。
+//! 
+//! 可作为软件任务向量的中断：应用未启用的外设中断，例如不用CAN时的`CAN_RX1`、`CAN_SCE`，
+//! 不用对应定时器时的`TIM6`、`TIM7`，没有用到的EXTI线中断等。
+//! 
+//! ```ignore
+//! // 电机控制：TIM1更新中断，优先级3；遥测格式化：借用CAN_SCE向量，优先级1
+//! static TELEMETRY: MessageTask<Sample, 8> = MessageTask::new(Interrupt::CAN_SCE, 1);
+//! static MOTOR: Resource<MotorState, 3> = Resource::new(MotorState::new());
+//! 
+//! scheduler::init(&[TELEMETRY.task()]);
+//! scheduler::bind_interrupt(Interrupt::TIM1_UP, 3);
+//! 
+//! #[interrupt]
+//! fn TIM1_UP() {
+//!     let sample = MOTOR.lock(|motor| motor.step());
+//!     let _ = TELEMETRY.spawn(sample);
+//! }
+//! 
+//! #[interrupt]
+//! fn CAN_SCE() {
+//!     // 格式化期间TIM1_UP仍可随时抢占
+//!     TELEMETRY.drain(|sample| format_sample(&sample));
+//! }
+//! ```
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::mem::MaybeUninit;
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use library::Interrupt;
+use crate::bsp::misc::{NvicPriorityGroup, MISC, NVIC_PRIO_BITS};
+
+/// 中断控制及状态寄存器地址（VECTACTIVE位于低9位）
+const SCB_ICSR: *const u32 = 0xE000ED04 as *const u32;
+
+/// 系统异常优先级寄存器起始地址（异常4对应的字节）
+const SCB_SHPR: *const u8 = 0xE000ED18 as *const u8;
+
+/// 任务可用的最高逻辑优先级
+pub const MAX_PRIORITY: u8 = (1 << NVIC_PRIO_BITS) - 1;
+
+/// 逻辑优先级转换为NVIC优先级（4位，0最高）
+pub const fn nvic_priority(priority: u8) -> u8 {
+    (1 << NVIC_PRIO_BITS) - priority
+}
+
+/// 逻辑优先级对应的BASEPRI值：屏蔽逻辑优先级不高于`priority`的所有任务
+pub const fn basepri_for(priority: u8) -> u8 {
+    nvic_priority(priority) << (8 - NVIC_PRIO_BITS)
+}
+
+/// 当前正在执行的上下文的逻辑优先级
+/// 
+/// # Returns
+/// 线程模式返回0；优先级高于所有任务的异常（硬件优先级0、故障等）返回`MAX_PRIORITY + 1`
+pub fn current_priority() -> u8 {
+    let vector = unsafe { core::ptr::read_volatile(SCB_ICSR) } & 0x1FF;
+    let hw = match vector {
+        0 => return 0,
+        1..=3 => return MAX_PRIORITY + 1,
+        4..=15 => unsafe { core::ptr::read_volatile(SCB_SHPR.add(vector as usize - 4)) >> (8 - NVIC_PRIO_BITS) },
+        _ => unsafe { MISC.nvic_get_priority((vector - 16) as u8) },
+    };
+    (1 << NVIC_PRIO_BITS) - hw
+}
+
+/// 初始化调度器：设置优先级分组并使能各软件任务的中断向量
+/// 
+/// # Arguments
+/// * `tasks` - 软件任务列表
+/// 
+/// # Safety
+/// 修改NVIC配置，应在启动时、任务开始运行前调用一次
+pub unsafe fn init(tasks: &[&SoftTask]) {
+    MISC.nvic_priority_group_config(NvicPriorityGroup::Group4);
+    for task in tasks {
+        task.init();
+    }
+}
+
+/// 按逻辑优先级配置并使能一个硬件任务中断
+/// 
+/// # Arguments
+/// * `irq` - 外设中断
+/// * `priority` - 逻辑优先级（`1..=MAX_PRIORITY`）
+/// 
+/// # Safety
+/// 修改NVIC配置
+pub unsafe fn bind_interrupt(irq: Interrupt, priority: u8) {
+    assert!(priority >= 1 && priority <= MAX_PRIORITY, "任务优先级超出范围");
+    MISC.nvic_set_priority(irq as u8, nvic_priority(priority));
+    MISC.nvic_enable_irq(irq as u8);
+}
+
+/// 软件任务：绑定到一个空闲中断向量，任务体写在该中断的处理函数中
+pub struct SoftTask {
+    irq: Interrupt,
+    priority: u8,
+    /// 任务已挂起时再次`spawn`被合并的次数
+    coalesced: AtomicU32,
+}
+
+impl SoftTask {
+    /// 创建软件任务
+    /// 
+    /// # Arguments
+    /// * `irq` - 借用的中断向量，应用不能再把它用于外设
+    /// * `priority` - 逻辑优先级（`1..=MAX_PRIORITY`）
+    pub const fn new(irq: Interrupt, priority: u8) -> Self {
+        assert!(priority >= 1 && priority <= MAX_PRIORITY, "任务优先级超出范围");
+        Self {
+            irq,
+            priority,
+            coalesced: AtomicU32::new(0),
+        }
+    }
+    
+    /// 获取绑定的中断向量
+    pub fn irq(&self) -> Interrupt {
+        self.irq
+    }
+    
+    /// 获取逻辑优先级
+    pub fn priority(&self) -> u8 {
+        self.priority
+    }
+    
+    /// 设置优先级、清除挂起位并使能中断向量
+    /// 
+    /// # Safety
+    /// 修改NVIC配置
+    pub unsafe fn init(&self) {
+        MISC.nvic_set_priority(self.irq as u8, nvic_priority(self.priority));
+        MISC.nvic_clear_pending(self.irq as u8);
+        MISC.nvic_enable_irq(self.irq as u8);
+    }
+    
+    /// 触发任务
+    /// 
+    /// 从更低优先级调用时任务立即抢占执行，否则在当前上下文退出后执行
+    /// 
+    /// # Returns
+    /// 任务已经挂起、本次触发被合并时返回false
+    pub fn spawn(&self) -> bool {
+        unsafe {
+            if MISC.nvic_is_pending(self.irq as u8) {
+                self.coalesced.fetch_add(1, Ordering::Relaxed);
+                return false;
+            }
+            MISC.nvic_set_pending(self.irq as u8);
+        }
+        true
+    }
+    
+    /// 撤销尚未开始执行的触发
+    pub fn cancel(&self) {
+        unsafe { MISC.nvic_clear_pending(self.irq as u8) };
+    }
+    
+    /// 任务是否等待执行
+    pub fn is_pending(&self) -> bool {
+        unsafe { MISC.nvic_is_pending(self.irq as u8) }
+    }
+    
+    /// 获取被合并的触发次数
+    pub fn coalesced(&self) -> u32 {
+        self.coalesced.load(Ordering::Relaxed)
+    }
+}
+
+/// 消息队列状态
+struct MessageQueue<T, const N: usize> {
+    buffer: MaybeUninit<[T; N]>,
+    head: usize,
+    len: usize,
+}
+
+/// 带消息的软件任务：`spawn`把消息放入队列后触发任务，任务体用`drain`或`pop`取出消息
+/// 
+/// 每条消息对应一次处理，不会像`SoftTask::spawn`那样被合并；队列满时`spawn`失败
+pub struct MessageTask<T, const N: usize> {
+    task: SoftTask,
+    queue: UnsafeCell<MessageQueue<T, N>>,
+    dropped: AtomicU32,
+}
+
+/// 实现 Sync trait，队列只在临界区内访问
+unsafe impl<T: Send, const N: usize> Sync for MessageTask<T, N> {}
+
+impl<T, const N: usize> MessageTask<T, N> {
+    /// 编译期检查队列长度
+    const SIZE_CHECK: () = assert!(N > 0, "MessageTask队列长度不能为0");
+    
+    /// 创建带消息的软件任务
+    /// 
+    /// # Arguments
+    /// * `irq` - 借用的中断向量
+    /// * `priority` - 逻辑优先级（`1..=MAX_PRIORITY`）
+    pub const fn new(irq: Interrupt, priority: u8) -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            task: SoftTask::new(irq, priority),
+            queue: UnsafeCell::new(MessageQueue {
+                buffer: MaybeUninit::uninit(),
+                head: 0,
+                len: 0,
+            }),
+            dropped: AtomicU32::new(0),
+        }
+    }
+    
+    /// 获取底层软件任务（用于`scheduler::init`）
+    pub fn task(&self) -> &SoftTask {
+        &self.task
+    }
+    
+    /// 发送消息并触发任务
+    /// 
+    /// # Returns
+    /// 队列已满时返回`Err(message)`
+    pub fn spawn(&self, message: T) -> Result<(), T> {
+        let result = cortex_m::interrupt::free(|_| unsafe {
+            let queue = &mut *self.queue.get();
+            if queue.len == N {
+                return Err(message);
+            }
+            let index = (queue.head + queue.len) % N;
+            (queue.buffer.as_mut_ptr() as *mut T).add(index).write(message);
+            queue.len += 1;
+            Ok(())
+        });
+        match result {
+            Ok(()) => {
+                unsafe { MISC.nvic_set_pending(self.task.irq as u8) };
+                Ok(())
+            }
+            Err(message) => {
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+                Err(message)
+            }
+        }
+    }
+    
+    /// 取出一条消息，只应在任务的中断处理函数中调用
+    pub fn pop(&self) -> Option<T> {
+        cortex_m::interrupt::free(|_| unsafe {
+            let queue = &mut *self.queue.get();
+            if queue.len == 0 {
+                return None;
+            }
+            let message = (queue.buffer.as_ptr() as *const T).add(queue.head).read();
+            queue.head = (queue.head + 1) % N;
+            queue.len -= 1;
+            Some(message)
+        })
+    }
+    
+    /// 依次处理队列中的全部消息，只应在任务的中断处理函数中调用
+    /// 
+    /// 每次只在取消息时短暂关中断，`handler`运行期间可被更高优先级任务抢占
+    pub fn drain(&self, mut handler: impl FnMut(T)) {
+        while let Some(message) = self.pop() {
+            handler(message);
+        }
+    }
+    
+    /// 队列中等待处理的消息数
+    pub fn len(&self) -> usize {
+        cortex_m::interrupt::free(|_| unsafe { (*self.queue.get()).len })
+    }
+    
+    /// 因队列已满而丢弃的消息数
+    pub fn dropped(&self) -> u32 {
+        self.dropped.load(Ordering::Relaxed)
+    }
+}
+
+/// 按优先级天花板协议保护的共享资源
+/// 
+/// `CEILING`为所有访问该资源的任务中最高的逻辑优先级。`lock`期间BASEPRI屏蔽
+/// 逻辑优先级不高于`CEILING`的任务，因此访问期间不会被争用者抢占，也不会发生死锁；
+/// 优先级更高的任务不受影响。加锁和解锁各是一次BASEPRI写入加一次标志位访问。
+/// 
+/// 不能在`lock`的闭包中再次锁同一个资源（运行时检查，违反时panic）。
+pub struct Resource<T, const CEILING: u8> {
+    data: UnsafeCell<T>,
+    /// 是否正被锁定，用于拒绝闭包内的重入
+    locked: AtomicBool,
+}
+
+/// 实现 Sync trait，访问由BASEPRI保证互斥
+unsafe impl<T: Send, const CEILING: u8> Sync for Resource<T, CEILING> {}
+
+impl<T, const CEILING: u8> Resource<T, CEILING> {
+    /// 编译期检查天花板优先级
+    const CEILING_CHECK: () = assert!(CEILING >= 1 && CEILING <= MAX_PRIORITY, "资源天花板优先级超出范围");
+    
+    /// 创建共享资源
+    pub const fn new(value: T) -> Self {
+        let _ = Self::CEILING_CHECK;
+        Self {
+            data: UnsafeCell::new(value),
+            locked: AtomicBool::new(false),
+        }
+    }
+    
+    /// 获取天花板优先级
+    pub const fn ceiling(&self) -> u8 {
+        CEILING
+    }
+    
+    /// 加锁访问资源
+    /// 
+    /// 调用者的优先级不能高于`CEILING`，否则说明天花板设置错误；同一资源不能在闭包中重入。
+    /// 两种情况都会产生两个同时存在的`&mut T`，发布构建中同样检查并panic
+    pub fn lock<R>(&self, f: impl FnOnce(&mut T) -> R) -> R {
+        assert!(current_priority() <= CEILING, "访问资源的任务优先级高于资源天花板");
+        let previous = MISC.get_basepri();
+        MISC.set_basepri_max(basepri_for(CEILING));
+        // 其他争用者此时都被屏蔽，标志仍置位只可能是闭包内重入
+        assert!(!self.locked.swap(true, Ordering::Acquire), "资源已被锁定，不能在lock的闭包中重入");
+        let result = f(unsafe { &mut *self.data.get() });
+        self.locked.store(false, Ordering::Release);
+        unsafe { MISC.set_basepri(previous) };
+        result
+    }
+}
@@ -1,25 +1,166 @@
 ﻿//! SDIO模块
 //! 提供安全数字输入/输出功能封装
+//! 
+//! `SdioDriver`是SDIO控制器寄存器级的操作（命令通道、数据通道、时钟和总线宽度），
+//! `SdCard`在其上实现SD存储卡块设备：卡识别流程、切换到4位总线和高速时钟，
+//! 以及经DMA2通道4的单块/多块读写（CMD17/18/24/25，多块传输以CMD12结束）。
 
 #![allow(unused)]
 
+use core::ptr::{read_volatile, write_volatile};
+use core::sync::atomic::{AtomicU32, AtomicU8, Ordering};
+
 // 导入内部生成的设备驱动库
 use library::*;
+use crate::bsp::delay::{delay_ms, get_uptime_ms, system_clock, wait_with_timeout};
+use crate::bsp::dma::{
+    Dma, DmaChannelPriority, DmaError, DmaMemoryDataSize, DmaPeripheralDataSize,
+    DmaTransferDescriptor, DMA2_CHANNEL4,
+};
+use crate::bsp::gpio::{PC8, PC9, PC10, PC11, PC12, PD2};
+
+/// SDIO寄存器基地址
+const SDIO_BASE: u32 = 0x4001_8000;
+
+/// 寄存器偏移
+const SDIO_POWER: u32 = 0x00;
+const SDIO_CLKCR: u32 = 0x04;
+const SDIO_ARG: u32 = 0x08;
+const SDIO_CMD: u32 = 0x0C;
+const SDIO_RESPCMD: u32 = 0x10;
+const SDIO_RESP1: u32 = 0x14;
+const SDIO_DTIMER: u32 = 0x24;
+const SDIO_DLEN: u32 = 0x28;
+const SDIO_DCTRL: u32 = 0x2C;
+const SDIO_STA: u32 = 0x34;
+const SDIO_ICR: u32 = 0x38;
+const SDIO_MASK: u32 = 0x3C;
+const SDIO_FIFO: u32 = 0x80;
+
+/// CLKCR位定义
+const CLKCR_CLKEN: u32 = 1 << 8;
+const CLKCR_PWRSAV: u32 = 1 << 9;
+const CLKCR_WIDBUS_MASK: u32 = 0x3 << 11;
+
+/// CMD位定义
+const CMD_WAITRESP_SHORT: u32 = 0b01 << 6;
+const CMD_WAITRESP_LONG: u32 = 0b11 << 6;
+const CMD_CPSMEN: u32 = 1 << 10;
+
+/// DCTRL位定义
+const DCTRL_DTEN: u32 = 1 << 0;
+const DCTRL_DTDIR: u32 = 1 << 1;
+const DCTRL_DMAEN: u32 = 1 << 3;
+
+/// STA位定义
+const STA_CCRCFAIL: u32 = 1 << 0;
+const STA_DCRCFAIL: u32 = 1 << 1;
+const STA_CTIMEOUT: u32 = 1 << 2;
+const STA_DTIMEOUT: u32 = 1 << 3;
+const STA_TXUNDERR: u32 = 1 << 4;
+const STA_RXOVERR: u32 = 1 << 5;
+const STA_CMDREND: u32 = 1 << 6;
+const STA_CMDSENT: u32 = 1 << 7;
+const STA_DATAEND: u32 = 1 << 8;
+const STA_STBITERR: u32 = 1 << 9;
+const STA_RXACT: u32 = 1 << 13;
+const STA_TXFIFOHE: u32 = 1 << 14;
+const STA_RXFIFOHF: u32 = 1 << 15;
+const STA_RXDAVL: u32 = 1 << 21;
+/// ICR可清除的静态标志
+const STA_STATIC_FLAGS: u32 = 0x00C0_07FF;
+
+/// 数据通道错误标志
+const STA_DATA_ERRORS: u32 = STA_DCRCFAIL | STA_DTIMEOUT | STA_TXUNDERR | STA_RXOVERR | STA_STBITERR;
+
+/// R1卡状态中的错误位
+const R1_ERRORS: u32 = 0xFDFF_E008;
+/// R1卡状态：READY_FOR_DATA
+const R1_READY_FOR_DATA: u32 = 1 << 8;
+/// R1卡状态：CURRENT_STATE为tran
+const R1_STATE_TRAN: u32 = 4;
+
+/// 命令响应超时时间（微秒）
+const SDIO_CMD_TIMEOUT_US: u32 = 10_000;
+
+/// 一次DMA传输的数据超时时间（微秒）
+const SDIO_DATA_TIMEOUT_US: u32 = 1_000_000;
+
+/// ACMD41等待卡完成上电的超时时间（毫秒）
+const SD_POWER_UP_TIMEOUT_MS: u32 = 1000;
+
+/// 写入后等待卡编程完成的超时时间（毫秒）
+const SD_PROGRAM_TIMEOUT_MS: u32 = 500;
+
+/// 数据超时计数（SDIO_CK周期，24MHz下约250ms，覆盖SD规范规定的最长写入忙时间）
+const SD_DATA_TIMER: u32 = 6_000_000;
+
+/// 块大小（字节）
+pub const BLOCK_SIZE: usize = 512;
+
+/// 一次DMA传输最多的块数（DMA计数寄存器16位，按字传输）
+const MAX_DMA_BLOCKS: usize = 0xFFFF / (BLOCK_SIZE / 4);
+
+/// 读取SDIO寄存器
+#[inline(always)]
+unsafe fn sdio_read(offset: u32) -> u32 {
+    read_volatile((SDIO_BASE + offset) as *const u32)
+}
+
+/// 写入SDIO寄存器
+#[inline(always)]
+unsafe fn sdio_write(offset: u32, value: u32) {
+    write_volatile((SDIO_BASE + offset) as *mut u32, value);
+}
+
+/// SD/SDIO错误枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum SdError {
+    CommandTimeout,  // 命令无响应
+    CommandCrc,      // 命令响应CRC错误
+    DataTimeout,     // 数据超时
+    DataCrc,         // 数据CRC错误
+    FifoError,       // 接收FIFO溢出或发送FIFO下溢
+    StartBitError,   // 4位模式下未在所有数据线上检测到起始位
+    CardError(u32),  // R1卡状态中报告的错误（原始状态值）
+    UnsupportedCard, // 不支持的卡（CMD8回应不一致或不是SD存储卡）
+    InitTimeout,     // 卡在规定时间内没有完成上电
+    NotInitialized,  // 卡未初始化
+    OutOfRange,      // 块地址超出卡容量
+    Dma(DmaError),   // DMA错误
+}
+
+impl From<DmaError> for SdError {
+    fn from(error: DmaError) -> Self {
+        SdError::Dma(error)
+    }
+}
 
 /// SDIO时钟频率枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum SdioClockFreq {
     Freq400kHz = 0,    // 400kHz (初始化频率)
-    Freq25MHz = 1,     // 25MHz
-    Freq50MHz = 2,     // 50MHz
+    Freq25MHz = 1,     // 25MHz（默认速度模式，72MHz HCLK下实际为24MHz）
+    Freq50MHz = 2,     // 50MHz（高速模式，72MHz HCLK下实际为36MHz）
+}
+
+impl SdioClockFreq {
+    /// 目标频率（Hz）
+    fn hz(&self) -> u32 {
+        match self {
+            SdioClockFreq::Freq400kHz => 400_000,
+            SdioClockFreq::Freq25MHz => 25_000_000,
+            SdioClockFreq::Freq50MHz => 50_000_000,
+        }
+    }
 }
 
 /// SDIO响应类型枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum SdioResponseType {
     NoResponse = 0,    // 无响应
-    ShortResponse = 1, // 短响应 (R1, R1b, R2, R3, R6)
-    LongResponse = 2,  // 长响应 (R7)
+    ShortResponse = 1, // 短响应 (R1, R1b, R3, R6, R7)
+    LongResponse = 2,  // 长响应 (R2)
 }
 
 /// SDIO数据传输宽度枚举
@@ -39,87 +180,63 @@ impl SdioDriver {
         Self
     }
     
-    /// 获取SDIO寄存器块
-    unsafe fn sdio() -> &'static mut library::sdio::RegisterBlock {
-        &mut *(0x40012C00 as *mut library::sdio::RegisterBlock)
-    }
-    
     /// 初始化SDIO
     /// 
+    /// 开启SDIO时钟，控制器上电，1位总线，使能SDIO_CK
+    /// 
     /// # 参数
     /// * `clock_freq` - 时钟频率
     pub unsafe fn init(&self, clock_freq: SdioClockFreq) {
-        let sdio = SdioDriver::sdio();
+        // 启用SDIO时钟（AHBENR.SDIOEN）
+        let ahbenr = (0x4002_1000 + 0x14) as *mut u32;
+        write_volatile(ahbenr, read_volatile(ahbenr) | 1 << 10);
         
         // 关闭SDIO电源
-        sdio.power().write(|w: &mut library::sdio::power::W| unsafe { w.bits(0x00000000) });
+        sdio_write(SDIO_POWER, 0);
         
         // 重置SDIO
         self.reset();
         
         // 打开SDIO电源
-        sdio.power().write(|w: &mut library::sdio::power::W| unsafe { w.bits(0x00000003) });
+        sdio_write(SDIO_POWER, 0b11);
         
-        // 配置时钟频率
+        // 配置时钟频率（同时恢复为1位总线）
+        sdio_write(SDIO_CLKCR, 0);
         self.set_clock_frequency(clock_freq);
-        
-        // 启用SDIO
-        sdio.power().write(|w: &mut library::sdio::power::W| unsafe { w.bits(0x00000003) });
     }
     
     /// 重置SDIO
+    /// 
+    /// 停止命令通道和数据通道，清除全部静态标志
     pub unsafe fn reset(&self) {
-        let sdio = SdioDriver::sdio();
-        
-        // 重置命令通道（通过重置CPSMEN位）
-        sdio.cmd().modify(|_, w: &mut library::sdio::cmd::W| w
-            .cpsmen().clear_bit()
-        );
-        while !sdio.cmd().read().cpsmen().bit() {
-            core::hint::spin_loop();
-        }
-        
-        // 重置数据通道（通过重置DTEN位）
-        sdio.dctrl().modify(|_, w: &mut library::sdio::dctrl::W| w
-            .dten().clear_bit()
-        );
-        while !sdio.dctrl().read().dten().bit() {
-            core::hint::spin_loop();
-        }
+        sdio_write(SDIO_CMD, 0);
+        sdio_write(SDIO_DCTRL, 0);
+        sdio_write(SDIO_ICR, STA_STATIC_FLAGS);
     }
     
     /// 设置SDIO时钟频率
     /// 
+    /// SDIO_CK = HCLK / (CLKDIV + 2)，取不超过目标频率的最高频率
+    /// 
     /// # 参数
     /// * `clock_freq` - 时钟频率
     pub unsafe fn set_clock_frequency(&self, clock_freq: SdioClockFreq) {
-        let sdio = SdioDriver::sdio();
-        
-        // 禁用时钟
-        sdio.clkcr().modify(|_, w: &mut library::sdio::clkcr::W| w
-            .clken().clear_bit()
-        );
-        
-        // 设置时钟分频系数
-        match clock_freq {
-            SdioClockFreq::Freq400kHz => {
-                // 400kHz = 25MHz / 62.5, 取63
-                sdio.clkcr().write(|w: &mut library::sdio::clkcr::W| unsafe { w.bits((62 << 0) | (1 << 7)) });
-            }
-            SdioClockFreq::Freq25MHz => {
-                // 25MHz = 50MHz / 2
-                sdio.clkcr().write(|w: &mut library::sdio::clkcr::W| unsafe { w.bits((1 << 0) | (1 << 7)) });
-            }
-            SdioClockFreq::Freq50MHz => {
-                // 50MHz = 50MHz / 1
-                sdio.clkcr().write(|w: &mut library::sdio::clkcr::W| unsafe { w.bits((0 << 0) | (1 << 7)) });
-            }
-        }
+        let hclk = system_clock();
+        let target = clock_freq.hz();
+        let divider = ((hclk + target - 1) / target).saturating_sub(2).min(0xFF);
         
-        // 启用时钟
-        sdio.clkcr().modify(|_, w: &mut library::sdio::clkcr::W| w
-            .clken().set_bit()
-        );
+        // 保留总线宽度；不开启节能模式，卡识别阶段需要持续的时钟
+        let clkcr = sdio_read(SDIO_CLKCR) & CLKCR_WIDBUS_MASK;
+        sdio_write(SDIO_CLKCR, clkcr | divider | CLKCR_CLKEN);
+    }
+    
+    /// 设置总线宽度
+    /// 
+    /// # 参数
+    /// * `width` - 数据线宽度，必须与卡端的设置（ACMD6）一致
+    pub unsafe fn set_bus_width(&self, width: SdioDataWidth) {
+        let clkcr = sdio_read(SDIO_CLKCR) & !CLKCR_WIDBUS_MASK;
+        sdio_write(SDIO_CLKCR, clkcr | (width as u32) << 11);
     }
     
     /// 发送命令
@@ -128,26 +245,37 @@ impl SdioDriver {
     /// * `cmd` - 命令号
     /// * `arg` - 命令参数
     /// * `resp_type` - 响应类型
-    pub unsafe fn send_command(&self, cmd: u8, arg: u32, resp_type: SdioResponseType) {
-        let sdio = SdioDriver::sdio();
+    /// 
+    /// # 返回值
+    /// 无响应时返回`CommandTimeout`，CRC错误返回`CommandCrc`（R3没有CRC，调用者应忽略此错误）
+    pub unsafe fn send_command(&self, cmd: u8, arg: u32, resp_type: SdioResponseType) -> Result<(), SdError> {
+        sdio_write(SDIO_ICR, STA_STATIC_FLAGS);
         
         // 设置命令参数
-        sdio.arg().write(|w: &mut library::sdio::arg::W| unsafe { w.bits(arg) });
-        
-        // 配置命令
-        let mut cmd_reg = (cmd as u32) << 0;
-        cmd_reg |= (resp_type as u32) << 6;
-        cmd_reg |= (1 << 10); // 启动命令
+        sdio_write(SDIO_ARG, arg);
         
-        sdio.cmd().write(|w: &mut library::sdio::cmd::W| unsafe { w.bits(cmd_reg) });
+        // 配置并启动命令
+        let (wait_resp, done) = match resp_type {
+            SdioResponseType::NoResponse => (0, STA_CMDSENT),
+            SdioResponseType::ShortResponse => (CMD_WAITRESP_SHORT, STA_CMDREND | STA_CCRCFAIL | STA_CTIMEOUT),
+            SdioResponseType::LongResponse => (CMD_WAITRESP_LONG, STA_CMDREND | STA_CCRCFAIL | STA_CTIMEOUT),
+        };
+        sdio_write(SDIO_CMD, (cmd as u32 & 0x3F) | wait_resp | CMD_CPSMEN);
         
         // 等待命令完成
-        while !sdio.sta().read().cmdrend().bit() {
-            core::hint::spin_loop();
+        if wait_with_timeout(SDIO_CMD_TIMEOUT_US, || sdio_read(SDIO_STA) & done != 0) {
+            return Err(SdError::CommandTimeout);
         }
         
-        // 清除命令完成标志
-        sdio.icr().write(|w: &mut library::sdio::icr::W| unsafe { w.bits(1 << 0) });
+        let status = sdio_read(SDIO_STA);
+        sdio_write(SDIO_ICR, STA_CCRCFAIL | STA_CTIMEOUT | STA_CMDREND | STA_CMDSENT);
+        if status & STA_CTIMEOUT != 0 {
+            return Err(SdError::CommandTimeout);
+        }
+        if status & STA_CCRCFAIL != 0 {
+            return Err(SdError::CommandCrc);
+        }
+        Ok(())
     }
     
     /// 读取响应
@@ -156,20 +284,18 @@ impl SdioDriver {
     /// * `resp_type` - 响应类型
     /// 
     /// # 返回值
-    /// 响应数据
+    /// 响应数据，长响应按RESP1~RESP4排列（RESP1为最高32位）
     pub unsafe fn read_response(&self, resp_type: SdioResponseType) -> [u32; 4] {
-        let sdio = SdioDriver::sdio();
         let mut resp = [0u32; 4];
         
         match resp_type {
             SdioResponseType::ShortResponse => {
-                resp[0] = sdio.respi1().read().bits();
+                resp[0] = sdio_read(SDIO_RESP1);
             }
             SdioResponseType::LongResponse => {
-                resp[0] = sdio.respi1().read().bits();
-                resp[1] = sdio.resp2().read().bits();
-                resp[2] = sdio.resp3().read().bits();
-                resp[3] = sdio.resp4().read().bits();
+                for (i, word) in resp.iter_mut().enumerate() {
+                    *word = sdio_read(SDIO_RESP1 + 4 * i as u32);
+                }
             }
             _ => {}
         }
@@ -179,129 +305,141 @@ impl SdioDriver {
     
     /// 配置数据传输
     /// 
+    /// 设置数据超时、长度和块大小，数据通道在`start_data_transfer`时启动
+    /// 
     /// # 参数
     /// * `data_width` - 数据传输宽度
-    /// * `block_size` - 块大小 (字节)
+    /// * `block_size` - 块大小 (字节，2的幂，最大16384)
     /// * `block_count` - 块数量
+    /// * `card_to_host` - 传输方向，`true`为从卡读取
     pub unsafe fn configure_data_transfer(
         &self,
         data_width: SdioDataWidth,
         block_size: u16,
-        block_count: u16
+        block_count: u16,
+        card_to_host: bool,
     ) {
-        let sdio = SdioDriver::sdio();
-        
-        // 设置数据长度
-        sdio.dlen().write(|w: &mut library::sdio::dlen::W| unsafe { w.bits((block_size * block_count) as u32) });
+        self.set_bus_width(data_width);
+        sdio_write(SDIO_DCTRL, 0);
+        sdio_write(SDIO_ICR, STA_STATIC_FLAGS);
         
-        // 配置数据控制寄存器
-        let mut dctrl = 0x00000000;
-        dctrl |= (data_width as u32) << 0;
-        dctrl |= (1 << 4); // 启用数据传输
-        dctrl |= (1 << 5); // 块传输模式
+        sdio_write(SDIO_DTIMER, SD_DATA_TIMER);
+        sdio_write(SDIO_DLEN, block_size as u32 * block_count as u32);
         
-        sdio.dctrl().write(|w: &mut library::sdio::dctrl::W| unsafe { w.bits(dctrl) });
+        let mut dctrl = (block_size.trailing_zeros() & 0xF) << 4;
+        if card_to_host {
+            dctrl |= DCTRL_DTDIR;
+        }
+        sdio_write(SDIO_DCTRL, dctrl);
     }
     
     /// 启动数据传输
-    pub unsafe fn start_data_transfer(&self) {
-        let sdio = SdioDriver::sdio();
-        
-        // 启动数据传输
-        sdio.dctrl().modify(|_, w: &mut library::sdio::dctrl::W| w
-            .dten().set_bit()
-        );
+    /// 
+    /// # 参数
+    /// * `dma` - 是否由DMA搬运FIFO数据
+    pub unsafe fn start_data_transfer(&self, dma: bool) {
+        let mut dctrl = sdio_read(SDIO_DCTRL) | DCTRL_DTEN;
+        if dma {
+            dctrl |= DCTRL_DMAEN;
+        }
+        sdio_write(SDIO_DCTRL, dctrl);
     }
     
     /// 等待数据传输完成
-    pub unsafe fn wait_for_data_transfer_complete(&self) {
-        let sdio = SdioDriver::sdio();
+    /// 
+    /// # 返回值
+    /// 数据通道出错或超时时返回对应错误
+    pub unsafe fn wait_for_data_transfer_complete(&self) -> Result<(), SdError> {
+        let timed_out = wait_with_timeout(SDIO_DATA_TIMEOUT_US, || {
+            sdio_read(SDIO_STA) & (STA_DATAEND | STA_DATA_ERRORS) != 0
+        });
         
-        while !sdio.sta().read().dataend().bit() {
-            core::hint::spin_loop();
+        let status = sdio_read(SDIO_STA);
+        sdio_write(SDIO_ICR, STA_DATAEND | STA_DATA_ERRORS);
+        if timed_out || status & STA_DTIMEOUT != 0 {
+            Err(SdError::DataTimeout)
+        } else if status & STA_DCRCFAIL != 0 {
+            Err(SdError::DataCrc)
+        } else if status & (STA_TXUNDERR | STA_RXOVERR) != 0 {
+            Err(SdError::FifoError)
+        } else if status & STA_STBITERR != 0 {
+            Err(SdError::StartBitError)
+        } else {
+            Ok(())
         }
-        
-        // 清除数据传输完成标志
-        sdio.icr().write(|w: &mut library::sdio::icr::W| unsafe { w.bits(1 << 1) });
     }
     
-    /// 读取数据
+    /// 读取数据（CPU搬运FIFO）
+    /// 
+    /// 适合SCR、SD状态等短数据；块数据读取请使用`SdCard::read_blocks`
     /// 
     /// # 参数
     /// * `buffer` - 数据缓冲区
     /// * `length` - 数据长度 (字节)
-    pub unsafe fn read_data(&self, buffer: &mut [u8], length: usize) {
-        let sdio = SdioDriver::sdio();
+    pub unsafe fn read_data(&self, buffer: &mut [u8], length: usize) -> Result<(), SdError> {
         let mut index = 0;
-        let mut remaining = length;
-        
-        while remaining > 0 {
-            if sdio.sta().read().rxfifohf().bit() {
-                if remaining >= 4 {
-                    let data = sdio.fifo().read().bits();
-                    buffer[index..index+4].copy_from_slice(&data.to_le_bytes());
-                    index += 4;
-                    remaining -= 4;
-                } else {
-                    let data = sdio.fifo().read().bits();
-                    let data_bytes = data.to_le_bytes();
-                    buffer[index..index+remaining].copy_from_slice(&data_bytes[0..remaining]);
-                    index += remaining;
-                    remaining = 0;
-                }
+        let length = length.min(buffer.len());
+        
+        while index < length {
+            let status = sdio_read(SDIO_STA);
+            if status & STA_DATA_ERRORS != 0 {
+                return self.wait_for_data_transfer_complete();
+            }
+            if status & STA_RXDAVL != 0 {
+                let data = sdio_read(SDIO_FIFO).to_le_bytes();
+                let count = (length - index).min(4);
+                buffer[index..index + count].copy_from_slice(&data[..count]);
+                index += count;
             }
         }
+        self.wait_for_data_transfer_complete()
     }
     
-    /// 写入数据
+    /// 写入数据（CPU搬运FIFO）
     /// 
     /// # 参数
     /// * `buffer` - 数据缓冲区
     /// * `length` - 数据长度 (字节)
-    pub unsafe fn write_data(&self, buffer: &[u8], length: usize) {
-        let sdio = SdioDriver::sdio();
+    pub unsafe fn write_data(&self, buffer: &[u8], length: usize) -> Result<(), SdError> {
         let mut index = 0;
-        let mut remaining = length;
-        
-        while remaining > 0 {
-            if sdio.sta().read().txfifohe().bit() {
-                if remaining >= 4 {
-                    let data = u32::from_le_bytes(buffer[index..index+4].try_into().unwrap());
-                    sdio.fifo().write(|w: &mut library::sdio::fifo::W| unsafe { w.bits(data) });
-                    index += 4;
-                    remaining -= 4;
-                } else {
-                    let mut padding = [0u8; 4];
-                    padding[0..remaining].copy_from_slice(&buffer[index..index+remaining]);
-                    let data = u32::from_le_bytes(padding);
-                    sdio.fifo().write(|w: &mut library::sdio::fifo::W| unsafe { w.bits(data) });
-                    index += remaining;
-                    remaining = 0;
+        let length = length.min(buffer.len());
+        
+        while index < length {
+            let status = sdio_read(SDIO_STA);
+            if status & STA_DATA_ERRORS != 0 {
+                return self.wait_for_data_transfer_complete();
+            }
+            if status & STA_TXFIFOHE != 0 {
+                // 半空时至少可以写入8个字
+                for _ in 0..8 {
+                    if index >= length {
+                        break;
+                    }
+                    let mut word = [0u8; 4];
+                    let count = (length - index).min(4);
+                    word[..count].copy_from_slice(&buffer[index..index + count]);
+                    sdio_write(SDIO_FIFO, u32::from_le_bytes(word));
+                    index += count;
                 }
             }
         }
+        self.wait_for_data_transfer_complete()
     }
     
     /// 启用中断
     /// 
     /// # 参数
-    /// * `interrupt_mask` - 中断掩码
+    /// * `interrupt_mask` - 中断掩码（`SdioInterrupt`的组合）
     pub unsafe fn enable_interrupts(&self, interrupt_mask: u32) {
-        let sdio = SdioDriver::sdio();
-        sdio.mask().modify(|_, w: &mut library::sdio::mask::W| unsafe {
-            w.bits(sdio.mask().read().bits() | interrupt_mask)
-        });
+        sdio_write(SDIO_MASK, sdio_read(SDIO_MASK) | interrupt_mask);
     }
     
     /// 禁用中断
     /// 
     /// # 参数
-    /// * `interrupt_mask` - 中断掩码
+    /// * `interrupt_mask` - 中断掩码（`SdioInterrupt`的组合）
     pub unsafe fn disable_interrupts(&self, interrupt_mask: u32) {
-        let sdio = SdioDriver::sdio();
-        sdio.mask().modify(|_, w: &mut library::sdio::mask::W| unsafe {
-            w.bits(sdio.mask().read().bits() & !interrupt_mask)
-        });
+        sdio_write(SDIO_MASK, sdio_read(SDIO_MASK) & !interrupt_mask);
     }
     
     /// 获取状态
@@ -309,8 +447,7 @@ impl SdioDriver {
     /// # 返回值
     /// SDIO状态
     pub unsafe fn get_status(&self) -> u32 {
-        let sdio = SdioDriver::sdio();
-        sdio.sta().read().bits()
+        sdio_read(SDIO_STA)
     }
     
     /// 清除状态标志
@@ -318,46 +455,420 @@ impl SdioDriver {
     /// # 参数
     /// * `flags` - 要清除的标志
     pub unsafe fn clear_status_flags(&self, flags: u32) {
-        let sdio = SdioDriver::sdio();// 清除状态标志
-        sdio.icr().write(|w: &mut library::sdio::icr::W| unsafe { w.bits(flags) });
+        sdio_write(SDIO_ICR, flags);
     }
     
     /// 禁用SDIO
     pub unsafe fn disable(&self) {
-        let sdio = SdioDriver::sdio();
-        
         // 关闭SDIO电源
-        sdio.power().write(|w: &mut library::sdio::power::W| unsafe { w.bits(0x00000000) });
+        sdio_write(SDIO_CLKCR, 0);
+        sdio_write(SDIO_POWER, 0);
     }
 }
 
-/// SDIO中断枚举
+/// SDIO中断枚举（MASK寄存器位，与STA标志位一一对应）
 pub enum SdioInterrupt {
-    CMDI = 1 << 0,     // 命令完成中断
-    DATI = 1 << 1,     // 数据传输完成中断
-    CCRCFAIL = 1 << 2, // 命令CRC失败中断
-    DCRCFAIL = 1 << 3, // 数据CRC失败中断
-    CTIMEOUT = 1 << 4, // 命令超时中断
-    DTIMEOUT = 1 << 5, // 数据超时中断
-    TXUNDERR = 1 << 6, // 发送下溢中断
-    RXOVERR = 1 << 7,  // 接收溢出中断
-    CMDREND = 1 << 8,  // 命令响应结束中断
-    CMDSENT = 1 << 9,  // 命令发送中断
-    DATAEND = 1 << 10, // 数据传输结束中断
-    STBITERR = 1 << 11, // 起始位错误中断
-    DBCKEND = 1 << 12, // 数据块结束中断
-    CMDACT = 1 << 13,  // 命令激活中断
-    TXACT = 1 << 14,   // 发送激活中断
-    RXACT = 1 << 15,   // 接收激活中断
-    TXFIFOHE = 1 << 16, // 发送FIFO半满中断
-    RXFIFOHF = 1 << 17, // 接收FIFO半满中断
-    TXFIFOF = 1 << 18, // 发送FIFO满中断
-    RXFIFOF = 1 << 19, // 接收FIFO满中断
-    TXFIFOE = 1 << 20, // 发送FIFO空中断
-    RXFIFOE = 1 << 21, // 接收FIFO空中断
-    BUSY = 1 << 22,    // 总线忙中断
-    SDIOIT = 1 << 23,  // SDIO中断
+    CCRCFAIL = 1 << 0,  // 命令CRC失败中断
+    DCRCFAIL = 1 << 1,  // 数据CRC失败中断
+    CTIMEOUT = 1 << 2,  // 命令超时中断
+    DTIMEOUT = 1 << 3,  // 数据超时中断
+    TXUNDERR = 1 << 4,  // 发送下溢中断
+    RXOVERR = 1 << 5,   // 接收溢出中断
+    CMDREND = 1 << 6,   // 命令响应结束中断
+    CMDSENT = 1 << 7,   // 命令发送中断
+    DATAEND = 1 << 8,   // 数据传输结束中断
+    STBITERR = 1 << 9,  // 起始位错误中断
+    DBCKEND = 1 << 10,  // 数据块结束中断
+    CMDACT = 1 << 11,   // 命令激活中断
+    TXACT = 1 << 12,    // 发送激活中断
+    RXACT = 1 << 13,    // 接收激活中断
+    TXFIFOHE = 1 << 14, // 发送FIFO半空中断
+    RXFIFOHF = 1 << 15, // 接收FIFO半满中断
+    TXFIFOF = 1 << 16,  // 发送FIFO满中断
+    RXFIFOF = 1 << 17,  // 接收FIFO满中断
+    TXFIFOE = 1 << 18,  // 发送FIFO空中断
+    RXFIFOE = 1 << 19,  // 接收FIFO空中断
+    TXDAVL = 1 << 20,   // 发送FIFO有数据中断
+    RXDAVL = 1 << 21,   // 接收FIFO有数据中断
+    SDIOIT = 1 << 22,   // SDIO中断
 }
 
 /// 预定义的SDIO实例
 pub const SDIO: SdioDriver = SdioDriver::new();
+
+/// 一个数据块
+/// 
+/// 4字节对齐，可直接作为DMA按字传输的缓冲区
+#[repr(C, align(4))]
+#[derive(Clone, Copy)]
+pub struct Block(pub [u8; BLOCK_SIZE]);
+
+impl Block {
+    /// 全零块
+    pub const ZERO: Self = Self([0; BLOCK_SIZE]);
+}
+
+/// 块设备接口
+/// 
+/// 以`BLOCK_SIZE`字节的块为单位读写，块地址从0开始
+pub trait BlockDevice {
+    type Error;
+    
+    /// 块数量
+    fn block_count(&self) -> u32;
+    
+    /// 读取从`start`开始的`blocks.len()`个块
+    /// 
+    /// # Safety
+    /// 直接访问硬件
+    unsafe fn read_blocks(&self, start: u32, blocks: &mut [Block]) -> Result<(), Self::Error>;
+    
+    /// 写入从`start`开始的`blocks.len()`个块
+    /// 
+    /// # Safety
+    /// 直接访问硬件
+    unsafe fn write_blocks(&self, start: u32, blocks: &[Block]) -> Result<(), Self::Error>;
+}
+
+/// SD卡类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum SdCardType {
+    StandardV1 = 1,   // SD 1.x标准容量卡（字节地址）
+    StandardV2 = 2,   // SD 2.0标准容量卡（字节地址）
+    HighCapacity = 3, // SDHC/SDXC（块地址）
+}
+
+/// SD卡信息
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SdCardInfo {
+    pub card_type: SdCardType,
+    pub rca: u16,          // 相对卡地址
+    pub block_count: u32,  // 容量（块）
+}
+
+/// 从CSD中取出`[start + width - 1 : start]`位
+fn csd_bits(csd: &[u32; 4], start: u32, width: u32) -> u32 {
+    let mut value = 0;
+    for i in 0..width {
+        let bit = start + i;
+        let word = csd[3 - (bit / 32) as usize];
+        value |= ((word >> (bit % 32)) & 1) << i;
+    }
+    value
+}
+
+/// 由CSD计算容量（块）
+fn csd_block_count(csd: &[u32; 4]) -> u32 {
+    if csd_bits(csd, 126, 2) == 1 {
+        // CSD 2.0：容量 = (C_SIZE + 1) × 512KB
+        (csd_bits(csd, 48, 22) + 1) << 10
+    } else {
+        // CSD 1.0：容量 = (C_SIZE + 1) × 2^(C_SIZE_MULT + 2) × 2^READ_BL_LEN
+        let read_bl_len = csd_bits(csd, 80, 4);
+        let c_size = csd_bits(csd, 62, 12);
+        let c_size_mult = csd_bits(csd, 47, 3);
+        (c_size + 1) << (c_size_mult + 2 + read_bl_len).saturating_sub(9)
+    }
+}
+
+/// SD存储卡块设备
+/// 
+/// 引脚固定为PC8~PC11（D0~D3）、PC12（CK）、PD2（CMD），数据线和CMD需要外部上拉。
+/// 块数据经DMA2通道4按字在FIFO与缓冲区之间搬运，CPU不参与拷贝，
+/// 4位总线24MHz时理论带宽约12MB/s。读写期间CPU轮询SDIO状态等待传输结束，
+/// 不需要配置中断。
+/// 
+/// ```ignore
+/// static mut BUFFER: [Block; 8] = [Block::ZERO; 8];
+/// 
+/// let info = SD_CARD.init()?;
+/// SD_CARD.read_blocks(0, &mut BUFFER)?;
+/// SD_CARD.write_blocks(2048, &BUFFER)?;
+/// ```
+pub struct SdCard {
+    dma: Dma,
+    /// 相对卡地址，0表示未初始化
+    rca: AtomicU32,
+    block_count: AtomicU32,
+    /// `SdCardType`，0表示未初始化
+    card_type: AtomicU8,
+}
+
+impl SdCard {
+    /// 创建SD卡实例
+    pub const fn new() -> Self {
+        Self {
+            dma: DMA2_CHANNEL4,
+            rca: AtomicU32::new(0),
+            block_count: AtomicU32::new(0),
+            card_type: AtomicU8::new(0),
+        }
+    }
+    
+    /// 配置SDIO引脚为复用推挽输出
+    unsafe fn init_pins(&self) {
+        for pin in [PC8, PC9, PC10, PC11, PC12, PD2] {
+            pin.into_alternate_push_pull();
+        }
+    }
+    
+    /// 发送R1响应的命令并检查卡状态
+    /// 
+    /// # Returns
+    /// 卡状态
+    unsafe fn command_r1(&self, cmd: u8, arg: u32) -> Result<u32, SdError> {
+        SDIO.send_command(cmd, arg, SdioResponseType::ShortResponse)?;
+        let status = sdio_read(SDIO_RESP1);
+        if status & R1_ERRORS != 0 {
+            return Err(SdError::CardError(status));
+        }
+        Ok(status)
+    }
+    
+    /// 发送应用命令前缀CMD55
+    unsafe fn app_command(&self, rca: u32) -> Result<(), SdError> {
+        self.command_r1(55, rca << 16).map(|_| ())
+    }
+    
+    /// 卡识别和初始化
+    /// 
+    /// 400kHz下完成CMD0、CMD8、ACMD41、CMD2、CMD3、CMD9、CMD7，
+    /// 然后用ACMD6切换到4位总线、把标准容量卡的块长度设为512字节，最后切换到25MHz档（24MHz）
+    /// 
+    /// # Returns
+    /// 卡类型、地址和容量
+    /// 
+    /// # Safety
+    /// 直接访问RCC、GPIO、SDIO和DMA寄存器
+    pub unsafe fn init(&self) -> Result<SdCardInfo, SdError> {
+        self.rca.store(0, Ordering::Relaxed);
+        self.card_type.store(0, Ordering::Relaxed);
+        
+        self.init_pins();
+        self.dma.enable_clock();
+        SDIO.init(SdioClockFreq::Freq400kHz);
+        // 上电后至少74个时钟才能发送第一条命令
+        delay_ms(2);
+        
+        // CMD0：复位到空闲状态
+        SDIO.send_command(0, 0, SdioResponseType::NoResponse)?;
+        
+        // CMD8：检查电压范围，只有2.0及以上的卡会响应
+        let version2 = match SDIO.send_command(8, 0x1AA, SdioResponseType::ShortResponse) {
+            Ok(()) => {
+                if sdio_read(SDIO_RESP1) & 0xFFF != 0x1AA {
+                    return Err(SdError::UnsupportedCard);
+                }
+                true
+            }
+            Err(SdError::CommandTimeout) => false,
+            Err(error) => return Err(error),
+        };
+        
+        // ACMD41：等待上电完成，2.0卡同时声明支持大容量（HCS）
+        let hcs = if version2 { 0x4000_0000 } else { 0 };
+        let start = get_uptime_ms();
+        let ocr = loop {
+            match self.app_command(0) {
+                Ok(()) => {}
+                Err(SdError::CommandTimeout) => return Err(SdError::UnsupportedCard),
+                Err(error) => return Err(error),
+            }
+            // R3没有CRC，CRC错误是正常的
+            match SDIO.send_command(41, 0x8010_0000 | hcs, SdioResponseType::ShortResponse) {
+                Ok(()) | Err(SdError::CommandCrc) => {}
+                Err(error) => return Err(error),
+            }
+            let ocr = sdio_read(SDIO_RESP1);
+            if ocr & 0x8000_0000 != 0 {
+                break ocr;
+            }
+            if get_uptime_ms().wrapping_sub(start) >= SD_POWER_UP_TIMEOUT_MS {
+                return Err(SdError::InitTimeout);
+            }
+            delay_ms(1);
+        };
+        let card_type = if ocr & 0x4000_0000 != 0 {
+            SdCardType::HighCapacity
+        } else if version2 {
+            SdCardType::StandardV2
+        } else {
+            SdCardType::StandardV1
+        };
+        
+        // CMD2：读取CID；CMD3：获取相对卡地址
+        SDIO.send_command(2, 0, SdioResponseType::LongResponse)?;
+        SDIO.send_command(3, 0, SdioResponseType::ShortResponse)?;
+        let rca = sdio_read(SDIO_RESP1) >> 16;
+        
+        // CMD9：读取CSD计算容量
+        SDIO.send_command(9, rca << 16, SdioResponseType::LongResponse)?;
+        let block_count = csd_block_count(&SDIO.read_response(SdioResponseType::LongResponse));
+        
+        // CMD7：选中卡，进入传输状态
+        self.command_r1(7, rca << 16)?;
+        
+        // ACMD6：4位总线
+        self.app_command(rca)?;
+        self.command_r1(6, 0b10)?;
+        SDIO.set_bus_width(SdioDataWidth::Width4b);
+        
+        // CMD16：标准容量卡的块长度（大容量卡固定为512字节）
+        if card_type != SdCardType::HighCapacity {
+            self.command_r1(16, BLOCK_SIZE as u32)?;
+        }
+        
+        SDIO.set_clock_frequency(SdioClockFreq::Freq25MHz);
+        
+        self.block_count.store(block_count, Ordering::Relaxed);
+        self.card_type.store(card_type as u8, Ordering::Relaxed);
+        self.rca.store(rca, Ordering::Release);
+        Ok(SdCardInfo {
+            card_type,
+            rca: rca as u16,
+            block_count,
+        })
+    }
+    
+    /// 卡是否已初始化
+    pub fn is_initialized(&self) -> bool {
+        self.rca.load(Ordering::Acquire) != 0
+    }
+    
+    /// 检查地址范围并返回命令使用的起始地址
+    fn address(&self, start: u32, count: usize) -> Result<u32, SdError> {
+        if !self.is_initialized() {
+            return Err(SdError::NotInitialized);
+        }
+        let end = start as u64 + count as u64;
+        if end > self.block_count.load(Ordering::Relaxed) as u64 {
+            return Err(SdError::OutOfRange);
+        }
+        // 标准容量卡使用字节地址
+        if self.card_type.load(Ordering::Relaxed) == SdCardType::HighCapacity as u8 {
+            Ok(start)
+        } else {
+            Ok(start * BLOCK_SIZE as u32)
+        }
+    }
+    
+    /// 等待卡回到传输状态（写入后卡在编程期间保持忙）
+    unsafe fn wait_ready(&self) -> Result<(), SdError> {
+        let rca = self.rca.load(Ordering::Relaxed);
+        let start = get_uptime_ms();
+        loop {
+            let status = self.command_r1(13, rca << 16)?;
+            if status & R1_READY_FOR_DATA != 0 && (status >> 9) & 0xF == R1_STATE_TRAN {
+                return Ok(());
+            }
+            if get_uptime_ms().wrapping_sub(start) >= SD_PROGRAM_TIMEOUT_MS {
+                return Err(SdError::DataTimeout);
+            }
+        }
+    }
+    
+    /// 结束一次数据传输：多块传输发送CMD12，停止数据通道和DMA
+    unsafe fn finish_transfer(&self, multi_block: bool, result: Result<(), SdError>) -> Result<(), SdError> {
+        let stop = if multi_block { self.command_r1(12, 0).map(|_| ()) } else { Ok(()) };
+        sdio_write(SDIO_DCTRL, 0);
+        sdio_write(SDIO_ICR, STA_STATIC_FLAGS);
+        result.and(stop)
+    }
+    
+    /// 读取一段不超过`MAX_DMA_BLOCKS`的连续块
+    unsafe fn read_chunk(&self, start: u32, blocks: &mut [Block]) -> Result<(), SdError> {
+        let address = self.address(start, blocks.len())?;
+        let multi_block = blocks.len() > 1;
+        let words = (blocks.len() * BLOCK_SIZE / 4) as u16;
+        
+        // 读取时先准备好DMA和数据通道，卡在命令后立即开始发送数据
+        SDIO.configure_data_transfer(SdioDataWidth::Width4b, BLOCK_SIZE as u16, blocks.len() as u16, true);
+        let desc = DmaTransferDescriptor::peripheral_to_memory(SDIO_BASE + SDIO_FIFO, blocks.as_mut_ptr() as u32, words)
+            .with_data_size(DmaPeripheralDataSize::Word, DmaMemoryDataSize::Word)
+            .with_priority(DmaChannelPriority::VeryHigh);
+        let transfer = self.dma.start(&desc)?;
+        SDIO.start_data_transfer(true);
+        
+        if let Err(error) = self.command_r1(if multi_block { 18 } else { 17 }, address) {
+            transfer.abort();
+            return self.finish_transfer(false, Err(error));
+        }
+        
+        let result = SDIO.wait_for_data_transfer_complete();
+        let result = match result {
+            // 数据通道结束后DMA还要取走FIFO中剩余的数据
+            Ok(()) => transfer.wait_timeout(SDIO_CMD_TIMEOUT_US).map_err(SdError::from),
+            Err(error) => {
+                transfer.abort();
+                Err(error)
+            }
+        };
+        self.finish_transfer(multi_block, result)
+    }
+    
+    /// 写入一段不超过`MAX_DMA_BLOCKS`的连续块
+    unsafe fn write_chunk(&self, start: u32, blocks: &[Block]) -> Result<(), SdError> {
+        let address = self.address(start, blocks.len())?;
+        let multi_block = blocks.len() > 1;
+        let words = (blocks.len() * BLOCK_SIZE / 4) as u16;
+        
+        if multi_block {
+            // ACMD23：预擦除，减少多块写入时卡内部的编程时间
+            self.app_command(self.rca.load(Ordering::Relaxed))?;
+            self.command_r1(23, blocks.len() as u32)?;
+        }
+        self.command_r1(if multi_block { 25 } else { 24 }, address)?;
+        
+        SDIO.configure_data_transfer(SdioDataWidth::Width4b, BLOCK_SIZE as u16, blocks.len() as u16, false);
+        let desc = DmaTransferDescriptor::memory_to_peripheral(blocks.as_ptr() as u32, SDIO_BASE + SDIO_FIFO, words)
+            .with_data_size(DmaPeripheralDataSize::Word, DmaMemoryDataSize::Word)
+            .with_priority(DmaChannelPriority::VeryHigh);
+        let transfer = match self.dma.start(&desc) {
+            Ok(transfer) => transfer,
+            Err(error) => return self.finish_transfer(multi_block, Err(error.into())),
+        };
+        SDIO.start_data_transfer(true);
+        
+        // DMA出错或超时也要经过finish_transfer：发送CMD12并关闭DPSM，卡才能退出接收数据状态
+        let result = match SDIO.wait_for_data_transfer_complete() {
+            Ok(()) => transfer.wait_timeout(SDIO_CMD_TIMEOUT_US).map_err(SdError::from),
+            Err(error) => {
+                transfer.abort();
+                Err(error)
+            }
+        };
+        self.finish_transfer(multi_block, result)?;
+        self.wait_ready()
+    }
+}
+
+impl BlockDevice for SdCard {
+    type Error = SdError;
+    
+    fn block_count(&self) -> u32 {
+        self.block_count.load(Ordering::Relaxed)
+    }
+    
+    /// 读取连续块，超过一次DMA上限的部分自动分段
+    unsafe fn read_blocks(&self, start: u32, blocks: &mut [Block]) -> Result<(), SdError> {
+        let mut block = start;
+        for chunk in blocks.chunks_mut(MAX_DMA_BLOCKS) {
+            self.read_chunk(block, chunk)?;
+            block += chunk.len() as u32;
+        }
+        Ok(())
+    }
+    
+    /// 写入连续块，超过一次DMA上限的部分自动分段
+    unsafe fn write_blocks(&self, start: u32, blocks: &[Block]) -> Result<(), SdError> {
+        let mut block = start;
+        for chunk in blocks.chunks(MAX_DMA_BLOCKS) {
+            self.write_chunk(block, chunk)?;
+            block += chunk.len() as u32;
+        }
+        Ok(())
+    }
+}
+
+/// 预定义的SD卡实例
+pub static SD_CARD: SdCard = SdCard::new();
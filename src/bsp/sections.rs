@@ -0,0 +1,161 @@
+//! 内存段模块
+//! 提供与`memory.x`中自定义段配套的属性宏
+//! 
+//! - `.ramfunc`：在RAM中执行的代码。72MHz下FLASH有2个等待周期，
+//!   热点中断服务函数和内层循环放到RAM后取指不再等待，FLASH编程期间也能继续执行。
+//!   加载地址在FLASH，以`INSERT AFTER .data`插入，cortex-m-rt把`__edata`移到它之后，随`.data`一起复制。
+//! - `.dma_buffers`：DMA缓冲区，按4字节对齐，与普通`.bss`分开便于在map文件中核对占用，
+//!   以`INSERT AFTER .bss`插入，cortex-m-rt把`__ebss`移到它之后，随`.bss`一起清零。
+//! - `.uninit.noinit`：复位后保留内容的变量（复位计数、故障记录等），放在cortex-m-rt自带的`.uninit`段，
+//!   位于`__ebss`之后，启动代码不初始化。
+//! 
+//! 三个段都由启动代码在进入`main`之前处理完毕，不需要额外的初始化调用。
+//! 固件由cortex-m-rt的`link.x`链接，段定义只在根目录的`memory.x`中；`config/`下的链接脚本不参与构建。
+
+#![allow(unused)]
+
+use core::cell::UnsafeCell;
+use core::mem::MaybeUninit;
+
+extern "C" {
+    static __sramfunc: u32;
+    static __eramfunc: u32;
+    static __sdma_buffers: u32;
+    static __edma_buffers: u32;
+}
+
+/// `.ramfunc`段占用的字节数
+pub fn ram_code_size() -> usize {
+    unsafe { core::ptr::addr_of!(__eramfunc) as usize - core::ptr::addr_of!(__sramfunc) as usize }
+}
+
+/// `.dma_buffers`段占用的字节数
+pub fn dma_buffers_size() -> usize {
+    unsafe { core::ptr::addr_of!(__edma_buffers) as usize - core::ptr::addr_of!(__sdma_buffers) as usize }
+}
+
+/// 4字节对齐的包装，使字节数组可以进行字宽DMA传输
+#[repr(C, align(4))]
+pub struct DmaAligned<T>(pub T);
+
+/// 复位后保留内容的变量
+/// 
+/// 上电后SRAM内容随机，用标记字区分有效数据：标记不匹配时`get`返回`None`。
+/// `T`应为任意位模式都有效的类型（整数、整数数组等）。
+pub struct NoInit<T: Copy> {
+    magic: UnsafeCell<u32>,
+    value: UnsafeCell<MaybeUninit<T>>,
+}
+
+/// 实现 Sync trait，访问由调用者保证互斥
+unsafe impl<T: Copy> Sync for NoInit<T> {}
+
+impl<T: Copy> NoInit<T> {
+    /// 有效数据标记
+    const MAGIC: u32 = 0x4E4F_494E; // "NOIN"
+    
+    /// 创建实例（放在`.uninit`段时初始值不会被写入）
+    pub const fn new() -> Self {
+        Self {
+            magic: UnsafeCell::new(0),
+            value: UnsafeCell::new(MaybeUninit::uninit()),
+        }
+    }
+    
+    /// 读取保存的值
+    /// 
+    /// # Returns
+    /// 上电后尚未写入过时返回`None`
+    pub fn get(&self) -> Option<T> {
+        unsafe {
+            if core::ptr::read_volatile(self.magic.get()) == Self::MAGIC {
+                Some(core::ptr::read_volatile(self.value.get()).assume_init())
+            } else {
+                None
+            }
+        }
+    }
+    
+    /// 保存一个值
+    pub fn set(&self, value: T) {
+        unsafe {
+            core::ptr::write_volatile(self.value.get(), MaybeUninit::new(value));
+            core::ptr::write_volatile(self.magic.get(), Self::MAGIC);
+        }
+    }
+    
+    /// 读取保存的值，无效时先写入`default`
+    pub fn get_or_init(&self, default: T) -> T {
+        match self.get() {
+            Some(value) => value,
+            None => {
+                self.set(default);
+                default
+            }
+        }
+    }
+    
+    /// 使保存的值失效
+    pub fn clear(&self) {
+        unsafe { core::ptr::write_volatile(self.magic.get(), 0) };
+    }
+}
+
+/// 把函数放到`.ramfunc`段，在RAM中执行
+/// 
+/// 函数同时标记为`#[inline(never)]`，避免被内联回FLASH中的调用者。
+/// RAM函数内调用的其他函数仍在FLASH中执行，内层循环应自成一体。
+/// 
+/// ```ignore
+/// ramfunc! {
+///     fn checksum(data: &[u8]) -> u32 {
+///         data.iter().fold(0u32, |sum, &b| sum.wrapping_add(b as u32))
+///     }
+/// }
+/// ```
+#[macro_export]
+macro_rules! ramfunc {
+    ($($item:item)*) => {
+        $(
+            #[inline(never)]
+            #[link_section = ".ramfunc"]
+            $item
+        )*
+    };
+}
+
+/// 在`.dma_buffers`段中定义一个4字节对齐、初始为0的DMA缓冲区
+/// 
+/// 缓冲区类型为`DmaAligned<T>`，通过`.0`访问内容
+/// 
+/// ```ignore
+/// dma_buffer!(static mut ADC_SAMPLES: [u16; 256]);
+/// 
+/// let samples = &mut (*core::ptr::addr_of_mut!(ADC_SAMPLES)).0;
+/// ```
+#[macro_export]
+macro_rules! dma_buffer {
+    ($(#[$meta:meta])* $vis:vis static mut $name:ident: $ty:ty) => {
+        $(#[$meta])*
+        #[link_section = ".dma_buffers"]
+        $vis static mut $name: $crate::bsp::sections::DmaAligned<$ty> =
+            $crate::bsp::sections::DmaAligned(unsafe { core::mem::zeroed() });
+    };
+}
+
+/// 在`.uninit`段中定义一个复位后保留内容的变量
+/// 
+/// ```ignore
+/// noinit!(static RESET_COUNT: u32);
+/// 
+/// let count = RESET_COUNT.get_or_init(0) + 1;
+/// RESET_COUNT.set(count);
+/// ```
+#[macro_export]
+macro_rules! noinit {
+    ($(#[$meta:meta])* $vis:vis static $name:ident: $ty:ty) => {
+        $(#[$meta])*
+        #[link_section = ".uninit.noinit"]
+        $vis static $name: $crate::bsp::sections::NoInit<$ty> = $crate::bsp::sections::NoInit::new();
+    };
+}
@@ -11,6 +11,17 @@ use core::cell::UnsafeCell;
 // 导入内部生成的设备驱动库
 use library::*;
 
+use crate::bsp::dma::{Dma, DmaChannelPriority, DmaError, DmaInterrupt, DmaTransferDescriptor};
+use crate::bsp::dma::{DMA1_CHANNEL2, DMA1_CHANNEL3, DMA1_CHANNEL4, DMA1_CHANNEL5, DMA1_CHANNEL6, DMA1_CHANNEL7};
+use crate::bsp::executor::{self, WakerSlot};
+use crate::bsp::idle::{self, Activity};
+use crate::bsp::system::{get_system_clocks, SystemClocks};
+use crate::bsp::reg;
+
+/// 各串口异步接收/发送的唤醒槽位
+static SERIAL_RX_WAKERS: [WakerSlot; 3] = [WakerSlot::NEW; 3];
+static SERIAL_TX_WAKERS: [WakerSlot; 3] = [WakerSlot::NEW; 3];
+
 /// 串口波特率枚举
 #[derive(Debug, Clone, Copy)]
 pub enum BaudRate {
@@ -21,6 +32,19 @@ pub enum BaudRate {
     B115200,
 }
 
+impl BaudRate {
+    /// 波特率数值（bit/s）
+    pub const fn bps(self) -> u32 {
+        match self {
+            BaudRate::B9600 => 9600,
+            BaudRate::B19200 => 19200,
+            BaudRate::B38400 => 38400,
+            BaudRate::B57600 => 57600,
+            BaudRate::B115200 => 115200,
+        }
+    }
+}
+
 /// 串口枚举
 #[derive(Debug, Clone, Copy)]
 pub enum SerialPort {
@@ -120,78 +144,134 @@ pub enum WakeUpMode {
     AddressMark,
 }
 
-/// 串口接收缓冲区大小
-const RX_BUFFER_SIZE: usize = 256;
+/// 串口接收缓冲区默认大小
+pub const RX_BUFFER_SIZE: usize = 256;
 
 /// 串口接收缓冲区
-pub struct RxBuffer {
-    buffer: UnsafeCell<[u8; RX_BUFFER_SIZE]>,
+/// 
+/// 单生产者（接收中断）单消费者（主循环）的无锁环形缓冲区。
+/// 大小`N`在编译期指定，必须是2的幂，下标通过掩码计算；
+/// `head`/`tail`为自由递增的计数，满缓冲区时可以用满全部`N`个字节。
+pub struct RxBuffer<const N: usize = RX_BUFFER_SIZE> {
+    buffer: UnsafeCell<[u8; N]>,
     head: AtomicUsize,
     tail: AtomicUsize,
     overflow: AtomicBool,
 }
 
 /// 实现 Send trait，允许 RxBuffer 在线程间安全传递
-unsafe impl Send for RxBuffer {}
+unsafe impl<const N: usize> Send for RxBuffer<N> {}
 
 /// 实现 Sync trait，允许多个线程同时访问 RxBuffer
-unsafe impl Sync for RxBuffer {}
+unsafe impl<const N: usize> Sync for RxBuffer<N> {}
 
-impl RxBuffer {
+impl<const N: usize> RxBuffer<N> {
+    /// 下标掩码
+    const MASK: usize = N - 1;
+    
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N >= 2 && N.is_power_of_two(), "RxBuffer大小必须是2的幂");
+    
     /// 创建新的接收缓冲区
     pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
         Self {
-            buffer: UnsafeCell::new([0; RX_BUFFER_SIZE]),
+            buffer: UnsafeCell::new([0; N]),
             head: AtomicUsize::new(0),
             tail: AtomicUsize::new(0),
             overflow: AtomicBool::new(false),
         }
     }
     
-    /// 向缓冲区添加一个字节
+    /// 向缓冲区添加一个字节（生产者调用）
+    /// 
+    /// 缓冲区满时丢弃该字节并置位溢出标志，溢出标志需通过`clear_overflow`清除
     pub fn push(&self, byte: u8) {
         let head = self.head.load(Ordering::Relaxed);
-        let next_head = (head + 1) % RX_BUFFER_SIZE;
         
-        if next_head != self.tail.load(Ordering::Relaxed) {
+        if head.wrapping_sub(self.tail.load(Ordering::Acquire)) < N {
             unsafe {
                 let buffer = &mut *self.buffer.get();
-                buffer[head] = byte;
+                buffer[head & Self::MASK] = byte;
             }
-            self.head.store(next_head, Ordering::Relaxed);
-            self.overflow.store(false, Ordering::Relaxed);
+            self.head.store(head.wrapping_add(1), Ordering::Release);
         } else {
             self.overflow.store(true, Ordering::Relaxed);
         }
     }
     
-    /// 从缓冲区读取一个字节
+    /// 向缓冲区批量添加数据（生产者调用）
+    /// 
+    /// 最多拷贝两段连续内存，超出剩余空间的部分被丢弃并置位溢出标志
+    /// 
+    /// # Returns
+    /// 实际写入的字节数
+    pub fn push_slice(&self, data: &[u8]) -> usize {
+        let head = self.head.load(Ordering::Relaxed);
+        let free = N - head.wrapping_sub(self.tail.load(Ordering::Acquire));
+        let count = data.len().min(free);
+        
+        let start = head & Self::MASK;
+        let first = count.min(N - start);
+        unsafe {
+            let buffer = &mut *self.buffer.get();
+            buffer[start..start + first].copy_from_slice(&data[..first]);
+            buffer[..count - first].copy_from_slice(&data[first..count]);
+        }
+        self.head.store(head.wrapping_add(count), Ordering::Release);
+        
+        if count < data.len() {
+            self.overflow.store(true, Ordering::Relaxed);
+        }
+        count
+    }
+    
+    /// 从缓冲区读取一个字节（消费者调用）
     pub fn pop(&self) -> Option<u8> {
         let tail = self.tail.load(Ordering::Relaxed);
         
-        if tail != self.head.load(Ordering::Relaxed) {
+        if tail != self.head.load(Ordering::Acquire) {
             let byte = unsafe {
                 let buffer = &*self.buffer.get();
-                buffer[tail]
+                buffer[tail & Self::MASK]
             };
-            let next_tail = (tail + 1) % RX_BUFFER_SIZE;
-            self.tail.store(next_tail, Ordering::Relaxed);
+            self.tail.store(tail.wrapping_add(1), Ordering::Release);
             Some(byte)
         } else {
             None
         }
     }
     
+    /// 从缓冲区批量读取数据（消费者调用）
+    /// 
+    /// 最多拷贝两段连续内存
+    /// 
+    /// # Returns
+    /// 实际读取的字节数
+    pub fn pop_slice(&self, dest: &mut [u8]) -> usize {
+        let tail = self.tail.load(Ordering::Relaxed);
+        let available = self.head.load(Ordering::Acquire).wrapping_sub(tail);
+        let count = dest.len().min(available);
+        
+        let start = tail & Self::MASK;
+        let first = count.min(N - start);
+        unsafe {
+            let buffer = &*self.buffer.get();
+            dest[..first].copy_from_slice(&buffer[start..start + first]);
+            dest[first..count].copy_from_slice(&buffer[..count - first]);
+        }
+        self.tail.store(tail.wrapping_add(count), Ordering::Release);
+        count
+    }
+    
     /// 检查缓冲区是否为空
     pub fn is_empty(&self) -> bool {
-        self.head.load(Ordering::Relaxed) == self.tail.load(Ordering::Relaxed)
+        self.len() == 0
     }
     
     /// 检查缓冲区是否已满
     pub fn is_full(&self) -> bool {
-        let head = self.head.load(Ordering::Relaxed);
-        let next_head = (head + 1) % RX_BUFFER_SIZE;
-        next_head == self.tail.load(Ordering::Relaxed)
+        self.len() >= N
     }
     
     /// 检查是否发生溢出
@@ -206,21 +286,258 @@ impl RxBuffer {
     
     /// 获取缓冲区中的字节数
     pub fn len(&self) -> usize {
-        let head = self.head.load(Ordering::Relaxed);
-        let tail = self.tail.load(Ordering::Relaxed);
+        let tail = self.tail.load(Ordering::Acquire);
+        self.head.load(Ordering::Acquire).wrapping_sub(tail)
+    }
+    
+    /// 获取缓冲区容量
+    pub const fn capacity(&self) -> usize {
+        N
+    }
+    
+    /// 清空缓冲区（消费者调用）
+    /// 
+    /// 只移动读位置，不会与正在写入的接收中断冲突
+    pub fn clear(&self) {
+        self.tail.store(self.head.load(Ordering::Acquire), Ordering::Release);
+        self.overflow.store(false, Ordering::Relaxed);
+    }
+}
+
+/// DMA接收帧队列深度
+const DMA_RX_FRAME_QUEUE_SIZE: usize = 8;
+
+/// DMA循环接收缓冲区
+/// 
+/// DMA在循环模式下持续向缓冲区写入数据，中断中只发布新的写位置：
+/// - 半传输/传输完成中断发布写位置，保证DMA绕回前消费者能看到数据
+/// - 空闲线（IDLE）中断发布写位置并记录一帧的结束位置
+/// 
+/// 消费者通过`read_frame`以零拷贝方式拿到每一帧的数据切片。
+/// 缓冲区大小`N`必须是2的幂且不超过32768。
+pub struct DmaRxBuffer<const N: usize> {
+    buffer: UnsafeCell<[u8; N]>,
+    /// 已发布的累计写入字节数
+    write_total: AtomicUsize,
+    /// 上次发布时DMA在缓冲区中的位置（仅中断中修改）
+    last_pos: AtomicUsize,
+    /// 已消费的累计字节数
+    read_total: AtomicUsize,
+    /// 帧结束位置队列（累计字节数）
+    frame_ends: [AtomicUsize; DMA_RX_FRAME_QUEUE_SIZE],
+    frame_head: AtomicUsize,
+    frame_tail: AtomicUsize,
+    overflow: AtomicBool,
+    /// 是否有未释放的`DmaRxFrame`，同一时刻只交出一帧
+    frame_taken: AtomicBool,
+}
+
+/// 实现 Sync trait，缓冲区由单个中断生产、单个消费者读取
+unsafe impl<const N: usize> Sync for DmaRxBuffer<N> {}
+
+impl<const N: usize> DmaRxBuffer<N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N.is_power_of_two() && N <= 32768, "DmaRxBuffer大小必须是2的幂且不超过32768");
+    
+    /// 创建新的DMA接收缓冲区
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        #[allow(clippy::declare_interior_mutable_const)]
+        const ZERO: AtomicUsize = AtomicUsize::new(0);
+        Self {
+            buffer: UnsafeCell::new([0; N]),
+            write_total: AtomicUsize::new(0),
+            last_pos: AtomicUsize::new(0),
+            read_total: AtomicUsize::new(0),
+            frame_ends: [ZERO; DMA_RX_FRAME_QUEUE_SIZE],
+            frame_head: AtomicUsize::new(0),
+            frame_tail: AtomicUsize::new(0),
+            overflow: AtomicBool::new(false),
+            frame_taken: AtomicBool::new(false),
+        }
+    }
+    
+    /// 获取缓冲区首地址，用作DMA的内存地址
+    fn as_ptr(&self) -> *mut u8 {
+        self.buffer.get() as *mut u8
+    }
+    
+    /// 复位所有位置信息（必须在DMA停止时调用）
+    fn reset(&self) {
+        self.write_total.store(0, Ordering::Relaxed);
+        self.last_pos.store(0, Ordering::Relaxed);
+        self.read_total.store(0, Ordering::Relaxed);
+        self.frame_head.store(0, Ordering::Relaxed);
+        self.frame_tail.store(0, Ordering::Relaxed);
+        self.overflow.store(false, Ordering::Release);
+    }
+    
+    /// 发布DMA当前写位置（中断上下文调用）
+    /// 
+    /// # Arguments
+    /// * `remaining` - DMA通道的CNDTR值
+    fn publish(&self, remaining: u16) {
+        // CNDTR在循环模式下取值1..=N，重装载瞬间可能读到0
+        let pos = (N - (remaining as usize).min(N)) & (N - 1);
+        let last = self.last_pos.load(Ordering::Relaxed);
+        let delta = pos.wrapping_sub(last) & (N - 1);
+        
+        if delta == 0 {
+            return;
+        }
+        
+        self.last_pos.store(pos, Ordering::Relaxed);
+        let write_total = self.write_total.load(Ordering::Relaxed).wrapping_add(delta);
+        self.write_total.store(write_total, Ordering::Release);
         
-        if head >= tail {
-            head - tail
+        if write_total.wrapping_sub(self.read_total.load(Ordering::Acquire)) > N {
+            self.overflow.store(true, Ordering::Release);
+        }
+    }
+    
+    /// 记录一帧的结束位置（中断上下文调用）
+    /// 
+    /// 帧队列已满时，新数据并入最后一帧
+    fn push_frame_end(&self) {
+        let end = self.write_total.load(Ordering::Relaxed);
+        let head = self.frame_head.load(Ordering::Relaxed);
+        let tail = self.frame_tail.load(Ordering::Acquire);
+        
+        if head != tail {
+            let last = self.frame_ends[head.wrapping_sub(1) % DMA_RX_FRAME_QUEUE_SIZE].load(Ordering::Relaxed);
+            if last == end {
+                return;
+            }
+        } else if end == self.read_total.load(Ordering::Acquire) {
+            return;
+        }
+        
+        if head.wrapping_sub(tail) >= DMA_RX_FRAME_QUEUE_SIZE {
+            self.frame_ends[head.wrapping_sub(1) % DMA_RX_FRAME_QUEUE_SIZE].store(end, Ordering::Release);
         } else {
-            RX_BUFFER_SIZE - (tail - head)
+            self.frame_ends[head % DMA_RX_FRAME_QUEUE_SIZE].store(end, Ordering::Relaxed);
+            self.frame_head.store(head.wrapping_add(1), Ordering::Release);
         }
     }
     
-    /// 清空缓冲区
-    pub fn clear(&self) {
-        self.head.store(0, Ordering::Relaxed);
-        self.tail.store(0, Ordering::Relaxed);
-        self.overflow.store(false, Ordering::Relaxed);
+    /// 读取下一帧数据
+    /// 
+    /// 返回的帧直接引用DMA缓冲区，不做拷贝；帧被丢弃（drop）时释放对应空间。
+    /// 同一时刻只能持有一帧，上一帧尚未丢弃时返回`None`（帧按顺序释放，多个帧同时存在会重复推进读位置）。
+    /// 发生溢出时丢弃所有未读数据并返回`None`，可通过`has_overflow`查询。
+    pub fn read_frame(&self) -> Option<DmaRxFrame<'_, N>> {
+        if self.frame_taken.swap(true, Ordering::Acquire) {
+            return None;
+        }
+        
+        let tail = self.frame_tail.load(Ordering::Relaxed);
+        if tail == self.frame_head.load(Ordering::Acquire) {
+            self.frame_taken.store(false, Ordering::Release);
+            return None;
+        }
+        
+        let read = self.read_total.load(Ordering::Relaxed);
+        let end = self.frame_ends[tail % DMA_RX_FRAME_QUEUE_SIZE].load(Ordering::Acquire);
+        
+        if self.write_total.load(Ordering::Acquire).wrapping_sub(read) > N {
+            // DMA已覆盖未读数据，重新同步到最新位置
+            self.overflow.store(true, Ordering::Release);
+            self.read_total.store(self.write_total.load(Ordering::Acquire), Ordering::Release);
+            self.frame_tail.store(self.frame_head.load(Ordering::Acquire), Ordering::Release);
+            self.frame_taken.store(false, Ordering::Release);
+            return None;
+        }
+        
+        let len = end.wrapping_sub(read);
+        let start = read & (N - 1);
+        let first_len = len.min(N - start);
+        
+        let buffer = unsafe { &*self.buffer.get() };
+        Some(DmaRxFrame {
+            first: &buffer[start..start + first_len],
+            second: &buffer[..len - first_len],
+            owner: self,
+            end,
+        })
+    }
+    
+    /// 获取未读字节数（包括尚未收到IDLE的数据）
+    pub fn len(&self) -> usize {
+        self.write_total.load(Ordering::Acquire).wrapping_sub(self.read_total.load(Ordering::Acquire))
+    }
+    
+    /// 检查缓冲区是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+    
+    /// 获取缓冲区容量
+    pub const fn capacity(&self) -> usize {
+        N
+    }
+    
+    /// 检查是否发生溢出
+    pub fn has_overflow(&self) -> bool {
+        self.overflow.load(Ordering::Acquire)
+    }
+    
+    /// 清除溢出标志
+    pub fn clear_overflow(&self) {
+        self.overflow.store(false, Ordering::Release);
+    }
+}
+
+/// DMA接收帧
+/// 
+/// 帧数据可能跨越环形缓冲区末尾，因此由`first`和`second`两段组成，
+/// 不跨越时`second`为空。帧被丢弃时自动释放缓冲区空间，之后才能读取下一帧。
+pub struct DmaRxFrame<'a, const N: usize> {
+    first: &'a [u8],
+    second: &'a [u8],
+    owner: &'a DmaRxBuffer<N>,
+    end: usize,
+}
+
+impl<'a, const N: usize> DmaRxFrame<'a, N> {
+    /// 获取帧长度
+    pub fn len(&self) -> usize {
+        self.first.len() + self.second.len()
+    }
+    
+    /// 检查帧是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+    
+    /// 获取帧数据的两段切片
+    pub fn as_slices(&self) -> (&'a [u8], &'a [u8]) {
+        (self.first, self.second)
+    }
+    
+    /// 逐字节迭代帧数据
+    pub fn iter(&self) -> impl Iterator<Item = &'a u8> {
+        self.first.iter().chain(self.second.iter())
+    }
+    
+    /// 将帧数据复制到目标缓冲区
+    /// 
+    /// # Returns
+    /// 实际复制的字节数
+    pub fn copy_to(&self, dest: &mut [u8]) -> usize {
+        let first_len = self.first.len().min(dest.len());
+        dest[..first_len].copy_from_slice(&self.first[..first_len]);
+        let second_len = self.second.len().min(dest.len() - first_len);
+        dest[first_len..first_len + second_len].copy_from_slice(&self.second[..second_len]);
+        first_len + second_len
+    }
+}
+
+impl<'a, const N: usize> Drop for DmaRxFrame<'a, N> {
+    fn drop(&mut self) {
+        let owner = self.owner;
+        owner.read_total.store(self.end, Ordering::Release);
+        owner.frame_tail.store(owner.frame_tail.load(Ordering::Relaxed).wrapping_add(1), Ordering::Release);
+        owner.frame_taken.store(false, Ordering::Release);
     }
 }
 
@@ -259,8 +576,9 @@ pub struct SerialConfig {
     pub error_interrupt: bool,
 }
 
-impl Default for SerialConfig {
-    fn default() -> Self {
+impl SerialConfig {
+    /// 默认配置：115200 8N1，无流控，不开中断
+    pub const fn new() -> Self {
         Self {
             baud_rate: BaudRate::B115200,
             word_length: WordLength::Bits8,
@@ -281,19 +599,167 @@ impl Default for SerialConfig {
     }
 }
 
+impl Default for SerialConfig {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// USART寄存器偏移地址
+const USART_BRR_OFFSET: usize = 0x08;
+const USART_CR1_OFFSET: usize = 0x0C;
+const USART_CR2_OFFSET: usize = 0x10;
+const USART_CR3_OFFSET: usize = 0x14;
+
+/// 计算波特率寄存器值
+/// 
+/// BRR以1/16为单位表示USARTDIV，等于`pclk / baud`四舍五入，小数部分进位自动计入整数部分
+/// 
+/// # Arguments
+/// * `pclk` - 串口所在总线的时钟频率（Hz）
+/// * `baud` - 波特率（bit/s）
+pub const fn brr_value(pclk: u32, baud: u32) -> u32 {
+    (pclk + baud / 2) / baud
+}
+
+/// 串口初始化映像：由`SerialConfig`预先计算好的寄存器值
+/// 
+/// 用`const`定义时在编译期求值，启动时`init_with_image`每个寄存器只写一次：
+/// 
+/// ```ignore
+/// const CONSOLE: SerialInitImage = SerialInitImage::new(&SerialConfig::new(), 72_000_000);
+/// 
+/// SERIAL1.init_with_image(&CONSOLE);
+/// ```
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SerialInitImage {
+    pub brr: u32,
+    pub cr1: u32,
+    pub cr2: u32,
+    pub cr3: u32,
+}
+
+impl SerialInitImage {
+    /// 按配置计算寄存器值
+    /// 
+    /// # Arguments
+    /// * `config` - 串口配置
+    /// * `pclk` - 串口所在总线的时钟频率（USART1为PCLK2，USART2/USART3为PCLK1）
+    pub const fn new(config: &SerialConfig, pclk: u32) -> Self {
+        // CR1：UE、TE、RE始终使能
+        let mut cr1 = (1 << 13) | (1 << 3) | (1 << 2);
+        if let WordLength::Bits9 = config.word_length {
+            cr1 |= 1 << 12; // M
+        }
+        match config.parity {
+            Parity::None => {},
+            Parity::Even => cr1 |= 1 << 10,            // PCE
+            Parity::Odd => cr1 |= (1 << 10) | (1 << 9), // PCE + PS
+        }
+        if let WakeUpMode::AddressMark = config.wakeup_mode {
+            cr1 |= 1 << 11; // WAKE
+        }
+        if config.tx_interrupt {
+            cr1 |= 1 << 7; // TXEIE
+        }
+        if config.tc_interrupt {
+            cr1 |= 1 << 6; // TCIE
+        }
+        if config.rx_interrupt {
+            cr1 |= 1 << 5; // RXNEIE
+        }
+        if config.idle_interrupt {
+            cr1 |= 1 << 4; // IDLEIE
+        }
+        
+        // CR2：停止位和同步时钟
+        let stop_bits = match config.stop_bits {
+            StopBits::Bits1 => 0b00,
+            StopBits::Bits0_5 => 0b01,
+            StopBits::Bits2 => 0b10,
+            StopBits::Bits1_5 => 0b11,
+        };
+        let mut cr2 = stop_bits << 12;
+        if let SyncClock::Enable = config.sync_clock {
+            cr2 |= 1 << 11; // CLKEN
+        }
+        if let SyncClockPolarity::High = config.sync_cpol {
+            cr2 |= 1 << 10; // CPOL
+        }
+        if let SyncClockPhase::Edge2 = config.sync_cpha {
+            cr2 |= 1 << 9; // CPHA
+        }
+        if let SyncLastBit::Enable = config.sync_last_bit {
+            cr2 |= 1 << 8; // LBCL
+        }
+        
+        // CR3：硬件流控和错误中断
+        let mut cr3 = match config.hw_flow_control {
+            HardwareFlowControl::None => 0,
+            HardwareFlowControl::RTS => 1 << 8,              // RTSE
+            HardwareFlowControl::CTS => 1 << 9,              // CTSE
+            HardwareFlowControl::RtsCts => (1 << 8) | (1 << 9),
+        };
+        if config.error_interrupt {
+            cr3 |= 1 << 0; // EIE
+        }
+        
+        Self {
+            brr: brr_value(pclk, config.baud_rate.bps()),
+            cr1,
+            cr2,
+            cr3,
+        }
+    }
+}
+
 /// 串口结构体
-pub struct Serial {
+/// 
+/// `N`为接收缓冲区大小，不带缓冲区的串口使用默认值
+#[derive(Clone, Copy)]
+pub struct Serial<const N: usize = RX_BUFFER_SIZE> {
     port: SerialPort,
-    rx_buffer: Option<&'static RxBuffer>,
+    rx_buffer: Option<&'static RxBuffer<N>>,
 }
 
 impl SerialPort {
     /// 获取串口寄存器
-    fn get_usart(&self) -> &'static mut Usart1 {
+    /// 
+    /// `Usart1`类型的解引用固定指向USART1的地址，这里直接转换为寄存器块，
+    /// 保证USART2/USART3访问的是各自的寄存器
+    fn get_usart(&self) -> &'static mut usart1::RegisterBlock {
+        unsafe { &mut *(self.base_address() as *mut usart1::RegisterBlock) }
+    }
+    
+    /// 获取串口寄存器基地址
+    pub const fn base_address(&self) -> u32 {
+        match self {
+            SerialPort::USART1 => 0x40013800,
+            SerialPort::USART2 => 0x40004400,
+            SerialPort::USART3 => 0x40004800,
+        }
+    }
+    
+    /// 获取数据寄存器（DR）地址，用作DMA的外设地址
+    pub const fn dr_address(&self) -> u32 {
+        self.base_address() + 0x04
+    }
+    
+    /// 获取接收DMA通道（USART1: DMA1通道5，USART2: DMA1通道6，USART3: DMA1通道3）
+    pub const fn rx_dma(&self) -> Dma {
         match self {
-            SerialPort::USART1 => unsafe { &mut *(0x40013800 as *mut Usart1) },
-            SerialPort::USART2 => unsafe { &mut *(0x40004400 as *mut Usart1) },
-            SerialPort::USART3 => unsafe { &mut *(0x40004800 as *mut Usart1) },
+            SerialPort::USART1 => DMA1_CHANNEL5,
+            SerialPort::USART2 => DMA1_CHANNEL6,
+            SerialPort::USART3 => DMA1_CHANNEL3,
+        }
+    }
+    
+    /// 获取发送DMA通道（USART1: DMA1通道4，USART2: DMA1通道7，USART3: DMA1通道2）
+    pub const fn tx_dma(&self) -> Dma {
+        match self {
+            SerialPort::USART1 => DMA1_CHANNEL4,
+            SerialPort::USART2 => DMA1_CHANNEL7,
+            SerialPort::USART3 => DMA1_CHANNEL2,
         }
     }
     
@@ -320,9 +786,11 @@ impl Serial {
             rx_buffer: None,
         }
     }
-    
+}
+
+impl<const N: usize> Serial<N> {
     /// 创建带接收缓冲区的串口实例
-    pub const fn new_with_buffer(port: SerialPort, buffer: &'static RxBuffer) -> Self {
+    pub const fn new_with_buffer(port: SerialPort, buffer: &'static RxBuffer<N>) -> Self {
         Self {
             port,
             rx_buffer: Some(buffer),
@@ -330,190 +798,49 @@ impl Serial {
     }
     
     /// 获取USART寄存器
-    fn get_usart(&self) -> &'static mut Usart1 {
+    fn get_usart(&self) -> &'static mut usart1::RegisterBlock {
         self.port.get_usart()
     }
     
-    /// 获取波特率寄存器值
-    fn baud_rate_value(&self, baud: BaudRate) -> u32 {
-        // 获取串口时钟频率
-        // USART1挂载在APB2上，时钟频率为72MHz
-        // USART2和USART3挂载在APB1上，时钟频率为36MHz
-        let fck = match self.port {
-            SerialPort::USART1 => 72_000_000,
-            SerialPort::USART2 | SerialPort::USART3 => 36_000_000,
-        };
-        
-        // 精确计算波特率，参考标准库实现
-        let integer_divider = fck / (16 * baud as u32);
-        let fractional_divider = ((fck % (16 * baud as u32)) * 16 + baud as u32 / 2) / baud as u32;
-        
-        (integer_divider << 4) | fractional_divider
+    /// 获取串口所在总线的时钟频率
+    /// 
+    /// USART1挂载在APB2上，USART2和USART3挂载在APB1上
+    fn bus_clock(&self, clocks: &SystemClocks) -> u32 {
+        match self.port {
+            SerialPort::USART1 => clocks.pclk2,
+            SerialPort::USART2 | SerialPort::USART3 => clocks.pclk1,
+        }
     }
     
     /// 初始化串口
+    /// 
+    /// 按当前总线频率计算初始化映像后调用`init_with_image`
     pub fn init(&self, config: SerialConfig) {
-        let rcc = unsafe { &mut *(0x40021000 as *mut Rcc) };
-        let usart = self.get_usart();
-        
-        // 1. 启用串口时钟
+        self.init_with_image(&self.init_image(&config));
+    }
+    
+    /// 按当前总线频率计算初始化映像
+    /// 
+    /// 需要在写入前调整寄存器值（如`Rs485Bus`设置节点地址）时使用
+    pub fn init_image(&self, config: &SerialConfig) -> SerialInitImage {
+        SerialInitImage::new(config, self.bus_clock(&get_system_clocks()))
+    }
+    
+    /// 按预先计算的初始化映像初始化串口
+    /// 
+    /// 使能时钟后BRR、CR2、CR3、CR1各写一次，CR1（含UE）最后写入，
+    /// 映像可以在编译期由`SerialInitImage::new`生成
+    pub fn init_with_image(&self, image: &SerialInitImage) {
+        let base = self.port.base_address() as usize;
         unsafe {
             match self.port {
-                SerialPort::USART1 => {
-                    rcc.apb2enr().modify(|_, w| w.usart1en().set_bit());
-                }
-                SerialPort::USART2 => {
-                    rcc.apb1enr().modify(|_, w| w.usart2en().set_bit());
-                }
-                SerialPort::USART3 => {
-                    rcc.apb1enr().modify(|_, w| w.usart3en().set_bit());
-                }
+                SerialPort::USART1 => reg::RCC_APB2ENR.set_bits(self.port.clock_en_bit()),
+                SerialPort::USART2 | SerialPort::USART3 => reg::RCC_APB1ENR.set_bits(self.port.clock_en_bit()),
             }
-        }
-        
-        // 2. 配置波特率
-        let brr = match config.baud_rate {
-            BaudRate::B9600 => self.baud_rate_value(BaudRate::B9600),
-            BaudRate::B19200 => self.baud_rate_value(BaudRate::B19200),
-            BaudRate::B38400 => self.baud_rate_value(BaudRate::B38400),
-            BaudRate::B57600 => self.baud_rate_value(BaudRate::B57600),
-            BaudRate::B115200 => self.baud_rate_value(BaudRate::B115200),
-        };
-        
-        unsafe {
-            usart.brr().write(|w| w.bits(brr));
-        }
-        
-        // 3. 配置CR1寄存器
-        unsafe {
-            usart.cr1().write(|w| {
-                let mut cr1 = w;
-                
-                // 启用USART
-                cr1 = cr1.ue().set_bit();
-                // 启用发送
-                cr1 = cr1.te().set_bit();
-                // 启用接收
-                cr1 = cr1.re().set_bit();
-                
-                // 配置数据位长度
-                match config.word_length {
-                    WordLength::Bits8 => cr1 = cr1.m().clear_bit(),
-                    WordLength::Bits9 => cr1 = cr1.m().set_bit(),
-                }
-                
-                // 配置奇偶校验
-                match config.parity {
-                    Parity::None => {
-                        cr1 = cr1.pce().clear_bit();
-                    }
-                    Parity::Even => {
-                        cr1 = cr1.pce().set_bit();
-                        cr1 = cr1.ps().clear_bit();
-                    }
-                    Parity::Odd => {
-                        cr1 = cr1.pce().set_bit();
-                        cr1 = cr1.ps().set_bit();
-                    }
-                }
-                
-                // 配置唤醒模式
-                match config.wakeup_mode {
-                    WakeUpMode::IdleLine => cr1 = cr1.wake().clear_bit(),
-                    WakeUpMode::AddressMark => cr1 = cr1.wake().set_bit(),
-                }
-                
-                // 配置中断
-                if config.rx_interrupt {
-                    cr1 = cr1.rxneie().set_bit();
-                }
-                
-                if config.idle_interrupt {
-                    cr1 = cr1.idleie().set_bit();
-                }
-                
-                if config.tx_interrupt {
-                    cr1 = cr1.txeie().set_bit();
-                }
-                
-                if config.tc_interrupt {
-                    cr1 = cr1.tcie().set_bit();
-                }
-                
-                cr1
-            });
-        }
-        
-        // 4. 配置CR2寄存器
-        unsafe {
-            usart.cr2().write(|w| {
-                let mut cr2 = w;
-                
-                // 配置停止位
-                let stop_bits = match config.stop_bits {
-                    StopBits::Bits0_5 => 0b00,
-                    StopBits::Bits1 => 0b01,
-                    StopBits::Bits1_5 => 0b10,
-                    StopBits::Bits2 => 0b11,
-                };
-                cr2 = cr2.stop().bits(stop_bits);
-                
-                // 配置同步模式时钟
-                match config.sync_clock {
-                    SyncClock::Disable => cr2 = cr2.clken().clear_bit(),
-                    SyncClock::Enable => cr2 = cr2.clken().set_bit(),
-                }
-                
-                // 配置同步模式时钟极性
-                match config.sync_cpol {
-                    SyncClockPolarity::Low => cr2 = cr2.cpol().clear_bit(),
-                    SyncClockPolarity::High => cr2 = cr2.cpol().set_bit(),
-                }
-                
-                // 配置同步模式时钟相位
-                match config.sync_cpha {
-                    SyncClockPhase::Edge1 => cr2 = cr2.cpha().clear_bit(),
-                    SyncClockPhase::Edge2 => cr2 = cr2.cpha().set_bit(),
-                }
-                
-                // 配置同步模式最后位
-                match config.sync_last_bit {
-                    SyncLastBit::Disable => cr2 = cr2.lbcl().clear_bit(),
-                    SyncLastBit::Enable => cr2 = cr2.lbcl().set_bit(),
-                }
-                
-                cr2
-            });
-        }
-        
-        // 5. 配置CR3寄存器
-        unsafe {
-            usart.cr3().write(|w| {
-                let mut cr3 = w;
-                
-                // 配置硬件流控制
-                match config.hw_flow_control {
-                    HardwareFlowControl::None => {
-                        cr3 = cr3.rtse().clear_bit().ctse().clear_bit();
-                    }
-                    HardwareFlowControl::RTS => {
-                        cr3 = cr3.rtse().set_bit().ctse().clear_bit();
-                    }
-                    HardwareFlowControl::CTS => {
-                        cr3 = cr3.rtse().clear_bit().ctse().set_bit();
-                    }
-                    HardwareFlowControl::RtsCts => {
-                        cr3 = cr3.rtse().set_bit().ctse().set_bit();
-                    }
-                }
-                
-                // 配置错误中断
-                if config.error_interrupt {
-                    cr3 = cr3.eie().set_bit();
-                }
-                
-                cr3
-            });
+            reg::write(base + USART_BRR_OFFSET, image.brr);
+            reg::write(base + USART_CR2_OFFSET, image.cr2);
+            reg::write(base + USART_CR3_OFFSET, image.cr3);
+            reg::write(base + USART_CR1_OFFSET, image.cr1);
         }
     }
     
@@ -602,6 +929,38 @@ impl Serial {
         }
     }
     
+    /// 启用DMA接收请求
+    pub fn enable_dma_rx(&self) {
+        let usart = self.get_usart();
+        unsafe {
+            usart.cr3().modify(|_, w| w.dmar().set_bit());
+        }
+    }
+    
+    /// 禁用DMA接收请求
+    pub fn disable_dma_rx(&self) {
+        let usart = self.get_usart();
+        unsafe {
+            usart.cr3().modify(|_, w| w.dmar().clear_bit());
+        }
+    }
+    
+    /// 启用DMA发送请求
+    pub fn enable_dma_tx(&self) {
+        let usart = self.get_usart();
+        unsafe {
+            usart.cr3().modify(|_, w| w.dmat().set_bit());
+        }
+    }
+    
+    /// 禁用DMA发送请求
+    pub fn disable_dma_tx(&self) {
+        let usart = self.get_usart();
+        unsafe {
+            usart.cr3().modify(|_, w| w.dmat().clear_bit());
+        }
+    }
+    
     /// 处理接收中断
     pub fn handle_rx_interrupt(&self) {
         let usart = self.get_usart();
@@ -654,20 +1013,11 @@ impl Serial {
     
     /// 从接收缓冲区读取多个字节
     pub fn read_from_buffer_multiple(&self, buffer: &mut [u8]) -> usize {
-        let mut read_count = 0;
-        
         if let Some(rx_buffer) = &self.rx_buffer {
-            for byte in buffer.iter_mut() {
-                if let Some(data) = rx_buffer.pop() {
-                    *byte = data;
-                    read_count += 1;
-                } else {
-                    break;
-                }
-            }
+            rx_buffer.pop_slice(buffer)
+        } else {
+            0
         }
-        
-        read_count
     }
     
     /// 检查接收缓冲区是否有数据
@@ -718,17 +1068,29 @@ impl Serial {
     }
     
     /// 发送多个字节
+    /// 
+    /// 每个字节只等待TXE，全部写入后再等待一次TC，避免逐字节等待移位完成
     pub fn write_bytes(&self, bytes: &[u8]) {
+        let usart = self.get_usart();
+        
         for &byte in bytes {
-            self.write_byte(byte);
+            while usart.sr().read().txe().bit_is_clear() {
+                core::hint::spin_loop();
+            }
+            unsafe {
+                usart.dr().write(|w| w.bits(byte as u32));
+            }
+        }
+        
+        // 等待最后一个字节发送完成
+        while usart.sr().read().tc().bit_is_clear() {
+            core::hint::spin_loop();
         }
     }
     
     /// 发送字符串
     pub fn write_str(&self, s: &str) {
-        for &byte in s.as_bytes() {
-            self.write_byte(byte);
-        }
+        self.write_bytes(s.as_bytes());
     }
     
     /// 接收一个字节
@@ -746,6 +1108,92 @@ impl Serial {
         }
     }
     
+    /// 异步接收一个字节
+    /// 
+    /// 没有数据时打开RXNE中断并让出执行权。异步接口与`handle_rx_interrupt`的中断缓冲接收
+    /// 不能在同一个串口上混用；串口中断处理函数需要调用`handle_async_interrupt`。
+    pub async fn read_byte_async(&self) -> u8 {
+        let index = self.port as usize;
+        // 等待接收期间不进入停止模式，否则串口时钟停止会丢失数据
+        let _active = idle::hold(Activity::Serial);
+        executor::wait_for(
+            || if self.is_data_available() { Some(()) } else { None },
+            |waker| {
+                SERIAL_RX_WAKERS[index].register(waker);
+                self.enable_rx_interrupt();
+            },
+        ).await;
+        
+        unsafe {
+            (self.get_usart().dr().read().bits() & 0xFF) as u8
+        }
+    }
+    
+    /// 异步接收，直到填满`buffer`
+    pub async fn read_async(&self, buffer: &mut [u8]) {
+        for byte in buffer.iter_mut() {
+            *byte = self.read_byte_async().await;
+        }
+    }
+    
+    /// 异步发送多个字节，返回时最后一个字节已发送完成
+    /// 
+    /// 发送缓冲区满时打开TXE中断并让出执行权，最后等待TC中断
+    pub async fn write_bytes_async(&self, bytes: &[u8]) {
+        let usart = self.get_usart();
+        let index = self.port as usize;
+        let _active = idle::hold(Activity::Serial);
+        
+        for &byte in bytes {
+            executor::wait_for(
+                || if self.is_tx_buffer_empty() { Some(()) } else { None },
+                |waker| {
+                    SERIAL_TX_WAKERS[index].register(waker);
+                    self.enable_tx_interrupt();
+                },
+            ).await;
+            unsafe {
+                usart.dr().write(|w| w.bits(byte as u32));
+            }
+        }
+        
+        executor::wait_for(
+            || if self.is_tx_complete() { Some(()) } else { None },
+            |waker| {
+                SERIAL_TX_WAKERS[index].register(waker);
+                unsafe {
+                    usart.cr1().modify(|_, w| w.tcie().set_bit());
+                }
+            },
+        ).await;
+    }
+    
+    /// 异步发送字符串
+    pub async fn write_str_async(&self, s: &str) {
+        self.write_bytes_async(s.as_bytes()).await;
+    }
+    
+    /// 异步接口的中断入口
+    /// 
+    /// 关闭已触发的RXNE/TXE/TC中断并唤醒等待的任务，标志位和数据留给任务处理
+    pub fn handle_async_interrupt(&self) {
+        let usart = self.get_usart();
+        let index = self.port as usize;
+        let sr = usart.sr().read();
+        let cr1 = usart.cr1().read();
+        
+        if cr1.rxneie().bit_is_set() && (sr.rxne().bit_is_set() || sr.ore().bit_is_set()) {
+            self.disable_rx_interrupt();
+            SERIAL_RX_WAKERS[index].wake();
+        }
+        if (cr1.txeie().bit_is_set() && sr.txe().bit_is_set()) || (cr1.tcie().bit_is_set() && sr.tc().bit_is_set()) {
+            unsafe {
+                usart.cr1().modify(|_, w| w.txeie().clear_bit().tcie().clear_bit());
+            }
+            SERIAL_TX_WAKERS[index].wake();
+        }
+    }
+    
     /// 检查是否有数据可读
     pub fn is_data_available(&self) -> bool {
         let usart = self.get_usart();
@@ -764,6 +1212,30 @@ impl Serial {
         usart.sr().read().tc().bit_is_set()
     }
     
+    /// 时钟切换后按新的总线频率换算波特率寄存器，保持波特率不变
+    /// 
+    /// 在`system::ClockChangePhase::After`阶段调用；切换前应等待`is_tx_complete`，
+    /// 否则正在发送的字符会出错。新频率下分频值小于1（波特率超过总线频率的1/16）时按最快设置。
+    /// 
+    /// # Arguments
+    /// * `old` - 切换前的时钟频率
+    /// * `new` - 切换后的时钟频率
+    pub fn retime(&self, old: &SystemClocks, new: &SystemClocks) {
+        let old_clock = self.bus_clock(old) as u64;
+        let new_clock = self.bus_clock(new) as u64;
+        if old_clock == 0 || old_clock == new_clock {
+            return;
+        }
+        
+        let usart = self.get_usart();
+        let brr = usart.brr().read().bits() as u64;
+        // BRR = fck / baud，四舍五入换算到新频率
+        let scaled = ((brr * new_clock + old_clock / 2) / old_clock).clamp(16, 0xFFFF) as u32;
+        unsafe {
+            usart.brr().write(|w| w.bits(scaled));
+        }
+    }
+    
     /// 获取状态寄存器
     pub fn get_status(&self) -> u32 {
         let usart = self.get_usart();
@@ -913,17 +1385,402 @@ impl Serial {
     }
 }
 
-/// 实现fmt::Write特性，支持使用write!宏
-impl fmt::Write for Serial {
-    fn write_str(&mut self, s: &str) -> fmt::Result {
-        for c in s.chars() {
-            self.write_char(c)?;
+/// DMA循环接收串口
+/// 
+/// 将串口接收、循环DMA通道和`DmaRxBuffer`组合在一起，
+/// 接收过程不再需要逐字节中断，只在IDLE和DMA半传输/传输完成时进入中断。
+/// 
+/// 使用时需在对应的USART中断中调用`handle_idle_interrupt`，
+/// 在对应的DMA通道中断中调用`handle_dma_interrupt`。
+pub struct SerialDmaRx<const N: usize> {
+    serial: Serial,
+    buffer: &'static DmaRxBuffer<N>,
+}
+
+impl<const N: usize> SerialDmaRx<N> {
+    /// 创建新的DMA接收实例
+    pub const fn new(port: SerialPort, buffer: &'static DmaRxBuffer<N>) -> Self {
+        Self {
+            serial: Serial::new(port),
+            buffer,
         }
+    }
+    
+    /// 获取底层串口
+    pub fn serial(&self) -> &Serial {
+        &self.serial
+    }
+    
+    /// 获取接收缓冲区
+    pub fn buffer(&self) -> &'static DmaRxBuffer<N> {
+        self.buffer
+    }
+    
+    /// 获取接收DMA通道
+    fn dma(&self) -> Dma {
+        self.serial.port.rx_dma()
+    }
+    
+    /// 启动DMA循环接收
+    /// 
+    /// 串口需已通过`Serial::init`初始化；函数会关闭RXNE中断并打开IDLE中断
+    pub fn start(&self) -> Result<(), DmaError> {
+        let dma = self.dma();
+        self.stop();
+        self.buffer.reset();
+        
+        let desc = DmaTransferDescriptor::peripheral_to_memory(
+            self.serial.port.dr_address(),
+            self.buffer.as_ptr() as u32,
+            N as u16,
+        )
+        .with_priority(DmaChannelPriority::High)
+        .with_interrupts(true, true, true);
+        unsafe {
+            dma.start_circular(&desc)?;
+        }
+        
+        self.serial.disable_rx_interrupt();
+        self.serial.enable_dma_rx();
+        self.serial.enable_idle_interrupt();
         Ok(())
     }
     
-    fn write_char(&mut self, c: char) -> fmt::Result {
-        self.write_byte(c as u8);
+    /// 停止DMA接收
+    pub fn stop(&self) {
+        self.serial.disable_idle_interrupt();
+        self.serial.disable_dma_rx();
+        unsafe {
+            let dma = self.dma();
+            dma.disable();
+            dma.clear_all_interrupts();
+        }
+    }
+    
+    /// 处理空闲中断：发布写位置并标记帧结束
+    pub fn handle_idle_interrupt(&self) {
+        let usart = self.serial.get_usart();
+        
+        if usart.sr().read().idle().bit_is_set() {
+            // 读取DR寄存器清除空闲标志
+            let _ = usart.dr().read();
+            
+            let remaining = unsafe { self.dma().get_remaining_count() };
+            self.buffer.publish(remaining);
+            self.buffer.push_frame_end();
+        }
+    }
+    
+    /// 处理DMA通道中断：半传输/传输完成时发布写位置
+    pub fn handle_dma_interrupt(&self) {
+        let dma = self.dma();
+        
+        unsafe {
+            if dma.check_interrupt(DmaInterrupt::TransferError) {
+                // 通道已被硬件关闭，按溢出处理
+                dma.clear_all_interrupts();
+                self.buffer.overflow.store(true, Ordering::Release);
+                return;
+            }
+            
+            if dma.check_interrupt(DmaInterrupt::HalfTransfer) {
+                dma.clear_interrupt(DmaInterrupt::HalfTransfer);
+            }
+            if dma.check_interrupt(DmaInterrupt::TransferComplete) {
+                dma.clear_interrupt(DmaInterrupt::TransferComplete);
+            }
+            
+            self.buffer.publish(dma.get_remaining_count());
+        }
+    }
+    
+    /// 读取下一帧数据（零拷贝），上一帧丢弃之前返回`None`
+    pub fn read_frame(&self) -> Option<DmaRxFrame<'static, N>> {
+        self.buffer.read_frame()
+    }
+}
+
+/// DMA发送完成回调函数类型
+pub type TxCompleteCallback = fn();
+
+/// DMA发送环形缓冲区
+/// 
+/// 生产者把数据拷入环形缓冲区后立即返回，DMA以连续分段的方式把数据送到串口，
+/// 每段传输完成中断里自动启动下一段，全部发完后置位完成标志并调用回调。
+/// 缓冲区大小`N`必须是2的幂且不超过32768。
+pub struct TxRing<const N: usize> {
+    buffer: UnsafeCell<[u8; N]>,
+    /// 写入位置（累计字节数）
+    head: AtomicUsize,
+    /// DMA已发送完的位置（累计字节数）
+    tail: AtomicUsize,
+    /// 当前DMA分段的长度
+    in_flight: AtomicUsize,
+    /// DMA是否正在发送
+    busy: AtomicBool,
+    /// 全部数据发送完成标志
+    complete: AtomicBool,
+    /// 因缓冲区满而丢弃的字节数
+    dropped: AtomicUsize,
+    /// 发送完成回调
+    callback: UnsafeCell<Option<TxCompleteCallback>>,
+}
+
+/// 实现 Sync trait，拷贝、写入位置更新和启动DMA都在同一个临界区内进行，
+/// 主循环和多个中断可以同时作为生产者；分段推进只在DMA中断中进行
+unsafe impl<const N: usize> Sync for TxRing<N> {}
+
+impl<const N: usize> TxRing<N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N.is_power_of_two() && N <= 32768, "TxRing大小必须是2的幂且不超过32768");
+    
+    /// 创建新的发送环形缓冲区
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            buffer: UnsafeCell::new([0; N]),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+            in_flight: AtomicUsize::new(0),
+            busy: AtomicBool::new(false),
+            complete: AtomicBool::new(false),
+            dropped: AtomicUsize::new(0),
+            callback: UnsafeCell::new(None),
+        }
+    }
+    
+    /// 获取已排队但未发送完的字节数
+    pub fn len(&self) -> usize {
+        self.head.load(Ordering::Acquire).wrapping_sub(self.tail.load(Ordering::Acquire))
+    }
+    
+    /// 检查缓冲区是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+    
+    /// 获取剩余空间
+    pub fn free_space(&self) -> usize {
+        N - self.len()
+    }
+    
+    /// 获取因缓冲区满而丢弃的字节数
+    pub fn dropped(&self) -> usize {
+        self.dropped.load(Ordering::Relaxed)
+    }
+    
+    /// 拷贝数据到缓冲区，最多拷贝两段连续内存
+    /// 
+    /// 读取和更新`head`之间不能被其他生产者打断，必须在临界区内调用
+    /// 
+    /// # Returns
+    /// 实际写入的字节数
+    fn push_slice(&self, _cs: &cortex_m::interrupt::CriticalSection, data: &[u8]) -> usize {
+        let head = self.head.load(Ordering::Relaxed);
+        let free = N - head.wrapping_sub(self.tail.load(Ordering::Acquire));
+        let count = data.len().min(free);
+        
+        let start = head & (N - 1);
+        let first = count.min(N - start);
+        unsafe {
+            let buffer = &mut *self.buffer.get();
+            buffer[start..start + first].copy_from_slice(&data[..first]);
+            buffer[..count - first].copy_from_slice(&data[first..count]);
+        }
+        
+        self.head.store(head.wrapping_add(count), Ordering::Release);
+        count
+    }
+    
+    /// 计算下一段可由DMA连续发送的数据（起始地址, 长度）
+    fn next_chunk(&self) -> (u32, usize) {
+        let tail = self.tail.load(Ordering::Relaxed);
+        let pending = self.head.load(Ordering::Acquire).wrapping_sub(tail);
+        let start = tail & (N - 1);
+        let len = pending.min(N - start);
+        (self.buffer.get() as u32 + start as u32, len)
+    }
+}
+
+/// DMA异步发送串口
+/// 
+/// `write_bytes`只把数据放入`TxRing`并在DMA空闲时启动传输，不等待发送完成。
+/// 实现了`fmt::Write`，可作为不阻塞的`write!`目标，缓冲区满时多余数据被丢弃并计数。
+/// 
+/// 使用时需在对应的DMA通道中断中调用`handle_dma_interrupt`，并在NVIC中使能该中断。
+#[derive(Clone, Copy)]
+pub struct SerialDmaTx<const N: usize> {
+    serial: Serial,
+    ring: &'static TxRing<N>,
+}
+
+impl<const N: usize> SerialDmaTx<N> {
+    /// 创建新的DMA发送实例
+    pub const fn new(port: SerialPort, ring: &'static TxRing<N>) -> Self {
+        Self {
+            serial: Serial::new(port),
+            ring,
+        }
+    }
+    
+    /// 获取底层串口
+    pub fn serial(&self) -> &Serial {
+        &self.serial
+    }
+    
+    /// 获取发送缓冲区
+    pub fn ring(&self) -> &'static TxRing<N> {
+        self.ring
+    }
+    
+    /// 获取发送DMA通道
+    fn dma(&self) -> Dma {
+        self.serial.port.tx_dma()
+    }
+    
+    /// 设置发送完成回调（在DMA中断上下文中调用）
+    /// 
+    /// 应在开始发送前设置
+    pub fn set_completion_callback(&self, callback: Option<TxCompleteCallback>) {
+        cortex_m::interrupt::free(|_| unsafe {
+            *self.ring.callback.get() = callback;
+        });
+    }
+    
+    /// 启动下一段DMA传输
+    /// 
+    /// # Returns
+    /// * `true` - 已启动传输
+    /// * `false` - 没有待发送的数据
+    fn start_chunk(&self) -> bool {
+        let (addr, len) = self.ring.next_chunk();
+        if len == 0 {
+            return false;
+        }
+        
+        let dma = self.dma();
+        let desc = DmaTransferDescriptor::memory_to_peripheral(addr, self.serial.port.dr_address(), len as u16)
+            .with_interrupts(true, false, true);
+        
+        self.ring.in_flight.store(len, Ordering::Relaxed);
+        unsafe {
+            dma.disable();
+            if dma.start(&desc).is_err() {
+                self.ring.in_flight.store(0, Ordering::Relaxed);
+                return false;
+            }
+        }
+        true
+    }
+    
+    /// 把数据放入发送缓冲区，DMA空闲时立即启动传输
+    /// 
+    /// # Returns
+    /// 实际排队的字节数，缓冲区满时小于`bytes.len()`
+    pub fn write_bytes(&self, bytes: &[u8]) -> usize {
+        // 拷贝和启动在同一个临界区内，避免与其他生产者交错写入，或与DMA中断同时判断busy
+        cortex_m::interrupt::free(|cs| {
+            let queued = self.ring.push_slice(cs, bytes);
+            if queued < bytes.len() {
+                self.ring.dropped.fetch_add(bytes.len() - queued, Ordering::Relaxed);
+            }
+            
+            if !self.ring.busy.load(Ordering::Acquire) && self.ring.len() > 0 {
+                self.ring.complete.store(false, Ordering::Relaxed);
+                self.serial.enable_dma_tx();
+                if self.start_chunk() {
+                    self.ring.busy.store(true, Ordering::Release);
+                }
+            }
+            queued
+        })
+    }
+    
+    /// 把字符串放入发送缓冲区
+    pub fn write_str(&self, s: &str) -> usize {
+        self.write_bytes(s.as_bytes())
+    }
+    
+    /// 把全部数据放入发送缓冲区，空间不足时等待DMA腾出空间
+    pub fn write_all(&self, mut bytes: &[u8]) {
+        while !bytes.is_empty() {
+            let queued = cortex_m::interrupt::free(|cs| self.ring.push_slice(cs, bytes));
+            bytes = &bytes[queued..];
+            self.write_bytes(&[]);
+            if !bytes.is_empty() {
+                core::hint::spin_loop();
+            }
+        }
+    }
+    
+    /// 处理DMA通道中断：推进发送位置并启动下一段
+    pub fn handle_dma_interrupt(&self) {
+        let dma = self.dma();
+        
+        unsafe {
+            let error = dma.check_interrupt(DmaInterrupt::TransferError);
+            if !error && !dma.check_interrupt(DmaInterrupt::TransferComplete) {
+                return;
+            }
+            dma.clear_all_interrupts();
+            // 传输错误时放弃这一段，继续发送后面的数据
+        }
+        
+        // 推进、启动下一段和清除busy在同一个临界区内，与write_bytes互斥：
+        // 否则更高优先级的生产者可能在这期间看到busy仍为true而不启动DMA，数据滞留在缓冲区中
+        let idle = cortex_m::interrupt::free(|_| {
+            let sent = self.ring.in_flight.swap(0, Ordering::Relaxed);
+            self.ring.tail.store(self.ring.tail.load(Ordering::Relaxed).wrapping_add(sent), Ordering::Release);
+            
+            if self.start_chunk() {
+                false
+            } else {
+                self.ring.busy.store(false, Ordering::Release);
+                self.ring.complete.store(true, Ordering::Release);
+                true
+            }
+        });
+        
+        if idle {
+            if let Some(callback) = unsafe { *self.ring.callback.get() } {
+                callback();
+            }
+        }
+    }
+    
+    /// 检查DMA是否正在发送
+    pub fn is_busy(&self) -> bool {
+        self.ring.busy.load(Ordering::Acquire)
+    }
+    
+    /// 读取并清除发送完成标志
+    pub fn take_complete(&self) -> bool {
+        self.ring.complete.swap(false, Ordering::AcqRel)
+    }
+    
+    /// 等待缓冲区中的数据全部发送完成（包括最后一个字节移出移位寄存器）
+    pub fn flush(&self) {
+        while self.is_busy() {
+            core::hint::spin_loop();
+        }
+        while !self.serial.is_tx_complete() {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// 实现fmt::Write特性，作为不阻塞的write!目标
+impl<const N: usize> fmt::Write for SerialDmaTx<N> {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        SerialDmaTx::write_str(self, s);
+        Ok(())
+    }
+}
+
+/// 实现fmt::Write特性，支持使用write!宏
+impl<const N: usize> fmt::Write for Serial<N> {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        Serial::write_str(self, s);
         Ok(())
     }
 }
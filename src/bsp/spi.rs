@@ -3,8 +3,90 @@
 
 #![allow(unused)]
 
+use core::cell::UnsafeCell;
+use core::marker::PhantomData;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicUsize, Ordering};
+
 // 使用内部生成的设备驱动库
 use library::*;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransfer, DmaTransferDescriptor, DmaChannelPriority,
+    DmaPeripheralDataSize, DmaMemoryDataSize, DmaMemoryIncrementMode, DmaPeripheralIncrementMode,
+    DMA1_CHANNEL2, DMA1_CHANNEL3, DMA1_CHANNEL4, DMA1_CHANNEL5, DMA2_CHANNEL1, DMA2_CHANNEL2,
+};
+use crate::bsp::executor;
+use crate::bsp::idle::{self, Activity};
+use crate::bsp::system::SystemClocks;
+use crate::bsp::gpio::GpioPortStruct;
+
+/// SR寄存器标志位
+const SR_RXNE: u32 = 1 << 0;
+const SR_TXE: u32 = 1 << 1;
+const SR_MODF: u32 = 1 << 5;
+const SR_OVR: u32 = 1 << 6;
+const SR_BSY: u32 = 1 << 7;
+
+/// CR1寄存器位
+const CR1_MSTR: u32 = 1 << 2;
+const CR1_LSBFIRST: u32 = 1 << 7;
+const CR1_SSI: u32 = 1 << 8;
+const CR1_SSM: u32 = 1 << 9;
+const CR1_SPE: u32 = 1 << 6;
+const CR1_DFF: u32 = 1 << 11;
+
+/// CR2寄存器DMA请求使能位
+const CR2_RXDMAEN: u32 = 1 << 0;
+const CR2_TXDMAEN: u32 = 1 << 1;
+
+/// 只接收时发送的填充数据（DMA从此处读取，地址不递增）
+static SPI_DUMMY_TX: u16 = 0xFFFF;
+
+/// SPI错误类型枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum SpiError {
+    /// 发送和接收缓冲区长度不一致
+    LengthMismatch,
+    /// 长度为0或超过65535
+    InvalidLength,
+    /// 缓冲区宽度与设备数据帧宽度不一致
+    DataSizeMismatch,
+    /// 接收溢出
+    Overrun,
+    /// 模式错误（NSS被拉低）
+    ModeFault,
+    /// DMA错误
+    Dma(DmaError),
+}
+
+impl From<DmaError> for SpiError {
+    fn from(err: DmaError) -> Self {
+        SpiError::Dma(err)
+    }
+}
+
+/// SPI数据帧类型
+/// 
+/// `u8`对应8位数据帧，`u16`对应16位数据帧（CR1.DFF）。
+pub trait SpiWord: Copy {
+    /// 是否为16位数据帧
+    const IS_16BIT: bool;
+    /// DMA外设数据宽度
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize;
+    /// DMA内存数据宽度
+    const MEMORY_SIZE: DmaMemoryDataSize;
+}
+
+impl SpiWord for u8 {
+    const IS_16BIT: bool = false;
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize = DmaPeripheralDataSize::Byte;
+    const MEMORY_SIZE: DmaMemoryDataSize = DmaMemoryDataSize::Byte;
+}
+
+impl SpiWord for u16 {
+    const IS_16BIT: bool = true;
+    const PERIPHERAL_SIZE: DmaPeripheralDataSize = DmaPeripheralDataSize::HalfWord;
+    const MEMORY_SIZE: DmaMemoryDataSize = DmaMemoryDataSize::HalfWord;
+}
 
 /// SPI枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -73,6 +155,33 @@ impl SpiNumber {
             SpiNumber::SPI3 => 1 << 15,  // APB1
         }
     }
+    
+    /// 获取DR寄存器地址（DMA外设地址）
+    pub const fn dr_address(&self) -> u32 {
+        match self {
+            SpiNumber::SPI1 => 0x4001_300C,
+            SpiNumber::SPI2 => 0x4000_380C,
+            SpiNumber::SPI3 => 0x4000_3C0C,
+        }
+    }
+    
+    /// 获取接收DMA通道
+    pub const fn rx_dma(&self) -> Dma {
+        match self {
+            SpiNumber::SPI1 => DMA1_CHANNEL2,
+            SpiNumber::SPI2 => DMA1_CHANNEL4,
+            SpiNumber::SPI3 => DMA2_CHANNEL1,
+        }
+    }
+    
+    /// 获取发送DMA通道
+    pub const fn tx_dma(&self) -> Dma {
+        match self {
+            SpiNumber::SPI1 => DMA1_CHANNEL3,
+            SpiNumber::SPI2 => DMA1_CHANNEL5,
+            SpiNumber::SPI3 => DMA2_CHANNEL2,
+        }
+    }
 }
 
 impl Spi {
@@ -144,8 +253,11 @@ impl Spi {
         // 设置数据方向
         cr1 |= ((direction as u32) & 0x03) << 14;
         
-        // 设置NSS管理模式
+        // 设置NSS管理模式，软件管理时需置位SSI，否则主模式会立即产生模式错误
         cr1 |= (nss_mode as u32) << 9;
+        if let SpiNssMode::Software = nss_mode {
+            cr1 |= CR1_SSI;
+        }
         
         // 启用SPI
         cr1 |= (1 << 6);
@@ -198,30 +310,246 @@ impl Spi {
     }
     
     /// 发送数据缓冲区
-    pub unsafe fn send_buffer(&self, buffer: &[u8]) {
-        for &byte in buffer {
-            self.send(byte as u16);
+    /// 
+    /// 使用DMA连续发送，丢弃接收数据；DMA通道被占用时退回轮询方式
+    /// 
+    /// # Returns
+    /// DMA传输出错或接收溢出时返回对应的`SpiError`
+    pub unsafe fn send_buffer(&self, buffer: &[u8]) -> Result<(), SpiError> {
+        match self.start_write_dma(buffer) {
+            Ok(transfer) => transfer.wait(),
+            Err(_) => {
+                self.transfer_polled(buffer.iter().copied(), |_, _| {});
+                Ok(())
+            },
         }
     }
     
     /// 接收数据缓冲区
-    pub unsafe fn receive_buffer(&self, buffer: &mut [u8]) {
-        for byte in buffer {
-            *byte = self.receive() as u8;
+    /// 
+    /// 发送0xFF填充数据以产生时钟；DMA通道被占用时退回轮询方式
+    /// 
+    /// # Returns
+    /// DMA传输出错或接收溢出时返回对应的`SpiError`
+    pub unsafe fn receive_buffer(&self, buffer: &mut [u8]) -> Result<(), SpiError> {
+        // 传输句柄带有Drop，借用要在退回轮询之前结束
+        if let Ok(transfer) = self.start_read_dma(buffer) {
+            return transfer.wait();
         }
+        let len = buffer.len();
+        self.transfer_polled(core::iter::repeat(0xFF).take(len), |i, data| buffer[i] = data as u8);
+        Ok(())
     }
     
     /// 传输数据缓冲区（全双工）
-    pub unsafe fn transfer_buffer(&self, tx_buffer: &[u8], rx_buffer: &mut [u8]) {
-        for (i, &byte) in tx_buffer.iter().enumerate() {
+    /// 
+    /// 接收缓冲区比发送缓冲区短时，多出的接收数据被丢弃
+    /// 
+    /// # Returns
+    /// DMA传输出错或接收溢出时返回对应的`SpiError`
+    pub unsafe fn transfer_buffer(&self, tx_buffer: &[u8], rx_buffer: &mut [u8]) -> Result<(), SpiError> {
+        if tx_buffer.len() == rx_buffer.len() {
+            if let Ok(transfer) = self.start_transfer_dma(tx_buffer, rx_buffer) {
+                return transfer.wait();
+            }
+        }
+        
+        self.transfer_polled(tx_buffer.iter().copied(), |i, data| {
             if i < rx_buffer.len() {
-                rx_buffer[i] = self.transfer(byte as u16) as u8;
-            } else {
-                self.send(byte as u16);
+                rx_buffer[i] = data as u8;
+            }
+        });
+        Ok(())
+    }
+    
+    /// 轮询方式的流水线传输
+    /// 
+    /// TXE置位即写入下一个数据，不等待BSY，使总线上的数据帧尽量连续
+    unsafe fn transfer_polled<I: Iterator<Item = u8>>(&self, mut tx: I, mut on_rx: impl FnMut(usize, u16)) {
+        self.set_frame_format::<u8>();
+        self.enable();
+        
+        let spi = self.get_spi();
+        let mut received = 0;
+        let mut sent = 0;
+        let mut pending = tx.next();
+        
+        while pending.is_some() || received < sent {
+            let sr = spi.sr().read().bits();
+            if let Some(data) = pending {
+                // 发送缓冲区为空且接收不落后超过一帧时写入
+                if (sr & SR_TXE) != 0 && sent - received < 2 {
+                    spi.dr().write(|w: &mut library::spi1::dr::W| unsafe { w.bits(data as u32) });
+                    sent += 1;
+                    pending = tx.next();
+                }
+            }
+            if (sr & SR_RXNE) != 0 {
+                let data = spi.dr().read().bits() as u16;
+                on_rx(received, data);
+                received += 1;
             }
         }
     }
     
+    /// 切换数据帧格式（仅在格式不同时短暂关闭SPI）
+    unsafe fn set_frame_format<W: SpiWord>(&self) {
+        let spi = self.get_spi();
+        let cr1 = spi.cr1().read().bits();
+        let dff = if W::IS_16BIT { CR1_DFF } else { 0 };
+        if (cr1 & CR1_DFF) != dff {
+            spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(cr1 & !CR1_SPE) });
+            spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits((cr1 & !CR1_DFF) | dff) });
+        }
+    }
+    
+    /// 清除残留的接收数据和溢出标志
+    unsafe fn clear_rx(&self) {
+        let spi = self.get_spi();
+        let _ = spi.dr().read().bits();
+        let _ = spi.sr().read().bits();
+    }
+    
+    /// 启动一次DMA传输
+    /// 
+    /// `tx`为`None`时发送填充数据，`rx`为`None`时丢弃接收数据
+    unsafe fn start_dma<'a, W: SpiWord>(
+        &self,
+        tx: Option<&'a [W]>,
+        rx: Option<&'a mut [W]>,
+        len: usize,
+        irq: bool,
+    ) -> Result<SpiDmaTransfer<'a>, SpiError> {
+        if len == 0 || len > 0xFFFF {
+            return Err(SpiError::InvalidLength);
+        }
+        let rx_dma = self.number.rx_dma();
+        let tx_dma = self.number.tx_dma();
+        if rx_dma.is_transferring() || tx_dma.is_transferring() {
+            return Err(SpiError::Dma(DmaError::Busy));
+        }
+        
+        self.set_frame_format::<W>();
+        self.clear_rx();
+        
+        let dr = self.number.dr_address();
+        
+        let has_rx = rx.is_some();
+        
+        // 只发送时不使用接收DMA，结束后统一清除溢出标志
+        let rx_transfer = match rx {
+            Some(buffer) => {
+                let desc = DmaTransferDescriptor::peripheral_to_memory(dr, buffer.as_mut_ptr() as u32, len as u16)
+                    .with_data_size(W::PERIPHERAL_SIZE, W::MEMORY_SIZE)
+                    .with_priority(DmaChannelPriority::VeryHigh)
+                    .with_interrupts(irq, false, irq);
+                Some(rx_dma.start(&desc)?)
+            },
+            None => None,
+        };
+        
+        let tx_desc = match tx {
+            Some(buffer) => DmaTransferDescriptor::memory_to_peripheral(buffer.as_ptr() as u32, dr, len as u16),
+            None => DmaTransferDescriptor::memory_to_peripheral(&SPI_DUMMY_TX as *const u16 as u32, dr, len as u16)
+                .with_increment(DmaPeripheralIncrementMode::Disabled, DmaMemoryIncrementMode::Disabled),
+        }
+        .with_data_size(W::PERIPHERAL_SIZE, W::MEMORY_SIZE)
+        .with_priority(DmaChannelPriority::High)
+        // 完成中断只开在最后结束的通道上：有接收时为接收通道，否则为发送通道
+        .with_interrupts(irq && !has_rx, false, irq);
+        
+        let tx_transfer = match tx_dma.start(&tx_desc) {
+            Ok(transfer) => transfer,
+            Err(err) => {
+                if let Some(transfer) = rx_transfer {
+                    transfer.abort();
+                }
+                return Err(err.into());
+            },
+        };
+        
+        // 先打开接收请求，再打开发送请求，保证第一个接收数据不会丢失
+        let spi = self.get_spi();
+        let dma_bits = if rx_transfer.is_some() { CR2_RXDMAEN | CR2_TXDMAEN } else { CR2_TXDMAEN };
+        spi.cr2().write(|w: &mut library::spi1::cr2::W| unsafe { w.bits(spi.cr2().read().bits() | (dma_bits & CR2_RXDMAEN)) });
+        spi.cr2().write(|w: &mut library::spi1::cr2::W| unsafe { w.bits(spi.cr2().read().bits() | dma_bits) });
+        spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(spi.cr1().read().bits() | CR1_SPE) });
+        
+        Ok(SpiDmaTransfer {
+            number: self.number,
+            tx: tx_transfer,
+            rx: rx_transfer,
+            _buffers: PhantomData,
+        })
+    }
+    
+    /// 使用DMA进行全双工传输
+    /// 
+    /// 发送和接收同时进行，数据帧在总线上背靠背连续输出。
+    /// 
+    /// # Arguments
+    /// * `tx` - 发送数据
+    /// * `rx` - 接收缓冲区，长度必须与`tx`相同
+    /// 
+    /// # Returns
+    /// 成功返回传输句柄，可轮询或等待完成
+    pub unsafe fn start_transfer_dma<'a, W: SpiWord>(&self, tx: &'a [W], rx: &'a mut [W]) -> Result<SpiDmaTransfer<'a>, SpiError> {
+        if tx.len() != rx.len() {
+            return Err(SpiError::LengthMismatch);
+        }
+        let len = tx.len();
+        self.start_dma(Some(tx), Some(rx), len, false)
+    }
+    
+    /// 使用DMA只发送，丢弃接收数据（适用于显示屏、Flash写入等）
+    /// 
+    /// # Arguments
+    /// * `tx` - 发送数据
+    pub unsafe fn start_write_dma<'a, W: SpiWord>(&self, tx: &'a [W]) -> Result<SpiDmaTransfer<'a>, SpiError> {
+        self.start_dma(Some(tx), None, tx.len(), false)
+    }
+    
+    /// 使用DMA只接收，发送0xFF填充数据产生时钟
+    /// 
+    /// # Arguments
+    /// * `rx` - 接收缓冲区
+    pub unsafe fn start_read_dma<'a, W: SpiWord>(&self, rx: &'a mut [W]) -> Result<SpiDmaTransfer<'a>, SpiError> {
+        let len = rx.len();
+        self.start_dma(None, Some(rx), len, false)
+    }
+    
+    /// 异步全双工传输，等待期间CPU可以执行其他任务或休眠
+    /// 
+    /// 需要接收DMA通道的中断处理函数调用`Dma::handle_async_interrupt`。
+    /// future在传输结束前被丢弃时由`SpiDmaTransfer`的`Drop`关闭DMA通道，缓冲区随后即可释放
+    pub async fn transfer_async<W: SpiWord>(&self, tx: &[W], rx: &mut [W]) -> Result<(), SpiError> {
+        unsafe { self.start_transfer_dma(tx, rx)? }.wait_async().await
+    }
+    
+    /// 异步只发送
+    /// 
+    /// 需要发送DMA通道的中断处理函数调用`Dma::handle_async_interrupt`；future被丢弃时中止传输
+    pub async fn write_async<W: SpiWord>(&self, tx: &[W]) -> Result<(), SpiError> {
+        unsafe { self.start_write_dma(tx)? }.wait_async().await
+    }
+    
+    /// 异步只接收
+    /// 
+    /// 需要接收DMA通道的中断处理函数调用`Dma::handle_async_interrupt`；future被丢弃时中止传输
+    pub async fn read_async<W: SpiWord>(&self, rx: &mut [W]) -> Result<(), SpiError> {
+        unsafe { self.start_read_dma(rx)? }.wait_async().await
+    }
+    
+    /// 使用DMA发送16位数据帧（阻塞）
+    pub unsafe fn send_buffer16(&self, buffer: &[u16]) -> Result<(), SpiError> {
+        self.start_write_dma(buffer)?.wait()
+    }
+    
+    /// 使用DMA全双工传输16位数据帧（阻塞）
+    pub unsafe fn transfer_buffer16(&self, tx_buffer: &[u16], rx_buffer: &mut [u16]) -> Result<(), SpiError> {
+        self.start_transfer_dma(tx_buffer, rx_buffer)?.wait()
+    }
+    
     /// 检查SPI是否忙
     pub unsafe fn is_busy(&self) -> bool {
         let spi = self.get_spi();
@@ -251,9 +579,573 @@ impl Spi {
         let spi = self.get_spi();
         spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(spi.cr1().read().bits() & !(1 << 6)) });
     }
+    
+    /// 获取SPI所在总线的时钟频率（SPI1在APB2上，SPI2/SPI3在APB1上）
+    fn bus_clock(&self, clocks: &SystemClocks) -> u32 {
+        match self.number {
+            SpiNumber::SPI1 => clocks.pclk2,
+            SpiNumber::SPI2 | SpiNumber::SPI3 => clocks.pclk1,
+        }
+    }
+    
+    /// 时钟切换后重新选择波特率预分频，使SCK频率不超过切换前的值
+    /// 
+    /// 预分频只能是2的幂，新频率下取不超过原SCK频率的最快设置；总线频率降低后
+    /// 即使2分频也达不到原频率时使用2分频。等待当前传输结束后短暂关闭SPI修改BR位。
+    /// 
+    /// # Arguments
+    /// * `old` - 切换前的时钟频率
+    /// * `new` - 切换后的时钟频率
+    /// 
+    /// # Returns
+    /// 切换后使用的预分频系数
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器，调用时不能有正在进行的DMA传输
+    pub unsafe fn retime(&self, old: &SystemClocks, new: &SystemClocks) -> SpiBaudRatePrescaler {
+        const PRESCALERS: [SpiBaudRatePrescaler; 8] = [
+            SpiBaudRatePrescaler::Div2,
+            SpiBaudRatePrescaler::Div4,
+            SpiBaudRatePrescaler::Div8,
+            SpiBaudRatePrescaler::Div16,
+            SpiBaudRatePrescaler::Div32,
+            SpiBaudRatePrescaler::Div64,
+            SpiBaudRatePrescaler::Div128,
+            SpiBaudRatePrescaler::Div256,
+        ];
+        
+        let spi = self.get_spi();
+        let cr1 = spi.cr1().read().bits();
+        let old_br = (cr1 >> 3) & 0x07;
+        let sck = self.bus_clock(old) >> (old_br + 1);
+        let new_clock = self.bus_clock(new);
+        let br = (0..8u32).find(|&br| (new_clock >> (br + 1)) <= sck).unwrap_or(7);
+        
+        if br != old_br {
+            while self.is_busy() {}
+            let updated = (cr1 & !(0x07 << 3)) | (br << 3);
+            spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(cr1 & !(1 << 6)) });
+            spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(updated & !(1 << 6)) });
+            // 恢复原来的SPE位
+            spi.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(updated) });
+        }
+        PRESCALERS[br as usize]
+    }
+}
+
+/// SPI DMA传输句柄
+/// 
+/// 借用发送/接收缓冲区直到传输结束，可轮询或阻塞等待完成。
+/// 传输结束后会关闭DMA请求；只发送模式下会清除接收溢出标志。
+/// 传输结束前被丢弃时关闭两个DMA通道，借用结束后DMA不会再访问缓冲区。
+pub struct SpiDmaTransfer<'a> {
+    number: SpiNumber,
+    tx: DmaTransfer,
+    rx: Option<DmaTransfer>,
+    _buffers: PhantomData<&'a mut [u8]>,
+}
+
+impl<'a> SpiDmaTransfer<'a> {
+    /// 获取SPI寄存器块
+    unsafe fn get_spi(&self) -> &'static mut library::spi1::RegisterBlock {
+        &mut *((self.number.dr_address() - 0x0C) as *mut library::spi1::RegisterBlock)
+    }
+    
+    /// 关闭DMA请求并清除残留状态
+    unsafe fn finish(&self) {
+        let spi = self.get_spi();
+        spi.cr2().write(|w: &mut library::spi1::cr2::W| unsafe {
+            w.bits(spi.cr2().read().bits() & !(CR2_RXDMAEN | CR2_TXDMAEN))
+        });
+        if self.rx.is_none() {
+            // 只发送模式下未读取接收数据，读DR再读SR清除OVR
+            let _ = spi.dr().read().bits();
+            let _ = spi.sr().read().bits();
+        }
+    }
+    
+    /// 非阻塞轮询传输结果
+    /// 
+    /// # Returns
+    /// * `None` - 传输尚未结束
+    /// * `Some(Ok(()))` - 最后一个数据帧已移出总线
+    /// * `Some(Err(_))` - DMA错误或模式错误
+    pub fn poll(&self) -> Option<Result<(), SpiError>> {
+        unsafe {
+            let sr = self.get_spi().sr().read().bits();
+            if (sr & SR_MODF) != 0 {
+                self.tx.dma().disable();
+                if let Some(rx) = &self.rx {
+                    rx.dma().disable();
+                }
+                self.finish();
+                return Some(Err(SpiError::ModeFault));
+            }
+            
+            // 发送通道出错时接收通道永远不会完成，需要单独检查
+            if self.tx.has_error() {
+                let _ = self.tx.poll();
+                if let Some(rx) = &self.rx {
+                    rx.dma().disable();
+                    rx.dma().clear_all_interrupts();
+                }
+                self.finish();
+                return Some(Err(SpiError::Dma(DmaError::TransferError)));
+            }
+            
+            match &self.rx {
+                // 接收完成意味着最后一帧已完整移入
+                Some(rx) => {
+                    if let Err(err) = rx.poll()? {
+                        self.tx.dma().disable();
+                        self.finish();
+                        return Some(Err(err.into()));
+                    }
+                    let _ = self.tx.poll();
+                    
+                    let overrun = (self.get_spi().sr().read().bits() & SR_OVR) != 0;
+                    self.finish();
+                    if overrun {
+                        return Some(Err(SpiError::Overrun));
+                    }
+                },
+                // 只发送时需等到发送缓冲区为空且总线空闲（最多一帧时间）
+                None => {
+                    let result = self.tx.poll()?;
+                    if result.is_ok() {
+                        while (self.get_spi().sr().read().bits() & (SR_TXE | SR_BSY)) != SR_TXE {
+                            core::hint::spin_loop();
+                        }
+                    }
+                    self.finish();
+                    if let Err(err) = result {
+                        return Some(Err(err.into()));
+                    }
+                },
+            }
+            Some(Ok(()))
+        }
+    }
+    
+    /// 异步等待传输完成
+    /// 
+    /// 与中断模式的`start_dma`一致，只在最后结束的通道（有接收时为接收通道）上打开中断
+    pub async fn wait_async(self) -> Result<(), SpiError> {
+        let _active = idle::hold(Activity::Spi);
+        let done = match &self.rx {
+            Some(rx) => rx.dma(),
+            None => self.tx.dma(),
+        };
+        executor::wait_for(|| self.poll(), |waker| unsafe { done.arm_async(waker) }).await
+    }
+    
+    /// 阻塞等待传输完成
+    pub fn wait(self) -> Result<(), SpiError> {
+        loop {
+            if let Some(result) = self.poll() {
+                return result;
+            }
+            core::hint::spin_loop();
+        }
+    }
+}
+
+impl Drop for SpiDmaTransfer<'_> {
+    /// 传输未结束就被丢弃（如异步等待的future被取消）时中止传输
+    fn drop(&mut self) {
+        unsafe {
+            let rx_dma = self.rx.as_ref().map(|rx| rx.dma());
+            let running = |dma: &Dma| dma.is_enabled();
+            if !running(&self.tx.dma()) && !rx_dma.as_ref().map_or(false, running) {
+                return;
+            }
+            
+            // 接收通道先停，避免发送停止后它还在等待数据
+            if let Some(rx) = rx_dma {
+                rx.disable();
+                while rx.is_enabled() {}
+                rx.clear_all_interrupts();
+            }
+            let tx = self.tx.dma();
+            tx.disable();
+            while tx.is_enabled() {}
+            tx.clear_all_interrupts();
+            self.finish();
+        }
+    }
 }
 
 /// 预定义的SPI实例
 pub const SPI1: Spi = Spi::new(SpiNumber::SPI1);
 pub const SPI2: Spi = Spi::new(SpiNumber::SPI2);
 pub const SPI3: Spi = Spi::new(SpiNumber::SPI3);
+
+/// 共享总线上单个设备的配置
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SpiDeviceConfig {
+    /// 时钟极性和相位
+    pub mode: SpiMode,
+    /// 时钟预分频
+    pub baud_rate: SpiBaudRatePrescaler,
+    /// 数据帧宽度
+    pub data_size: SpiDataSize,
+    /// 是否低位在前
+    pub lsb_first: bool,
+}
+
+impl SpiDeviceConfig {
+    /// 创建8位、高位在前的设备配置
+    pub const fn new(mode: SpiMode, baud_rate: SpiBaudRatePrescaler) -> Self {
+        Self {
+            mode,
+            baud_rate,
+            data_size: SpiDataSize::Bits8,
+            lsb_first: false,
+        }
+    }
+    
+    /// 计算对应的CR1寄存器值（主模式、软件NSS，不含SPE位）
+    pub const fn cr1_image(&self) -> u32 {
+        let mut cr1 = CR1_MSTR | CR1_SSM | CR1_SSI;
+        cr1 |= (self.mode as u32) & 0x03;
+        cr1 |= (self.baud_rate as u32) << 3;
+        cr1 |= (self.data_size as u32) << 11;
+        if self.lsb_first {
+            cr1 |= CR1_LSBFIRST;
+        }
+        cr1
+    }
+}
+
+/// 共享总线上的SPI设备
+/// 
+/// 保存设备的CR1镜像和片选引脚（低电平有效），由`SpiBus`负责切换。
+#[derive(Debug, Clone, Copy)]
+pub struct SpiDevice {
+    cs: GpioPortStruct,
+    cr1: u32,
+}
+
+impl SpiDevice {
+    /// 创建新的SPI设备
+    /// 
+    /// # Arguments
+    /// * `cs` - 片选引脚
+    /// * `config` - 设备配置
+    pub const fn new(cs: GpioPortStruct, config: SpiDeviceConfig) -> Self {
+        Self {
+            cs,
+            cr1: config.cr1_image(),
+        }
+    }
+    
+    /// 获取设备的CR1镜像
+    pub const fn cr1_image(&self) -> u32 {
+        self.cr1
+    }
+    
+    /// 设备是否使用16位数据帧
+    pub const fn is_16bit(&self) -> bool {
+        (self.cr1 & CR1_DFF) != 0
+    }
+    
+    /// 把片选引脚配置为推挽输出并置为无效（高电平）
+    pub unsafe fn init_cs(&self) {
+        self.cs.set_high();
+        self.cs.into_push_pull_output();
+    }
+    
+    /// 选中设备
+    #[inline(always)]
+    unsafe fn select(&self) {
+        self.cs.set_low();
+    }
+    
+    /// 释放设备
+    #[inline(always)]
+    unsafe fn deselect(&self) {
+        self.cs.set_high();
+    }
+}
+
+/// SPI事务完成回调（在DMA中断上下文中调用）
+pub type SpiCallback = fn(Result<(), SpiError>);
+
+/// 排队的SPI事务
+/// 
+/// 缓冲区必须为`'static`，在回调被调用前一直由总线使用。
+/// 数据帧宽度由缓冲区类型决定，需与设备的`SpiDeviceConfig::data_size`一致：
+/// 8位设备使用`write`/`read`/`transfer`，16位设备使用`write16`/`read16`/`transfer16`，
+/// 不一致时构造函数返回`SpiError::DataSizeMismatch`。
+#[derive(Clone, Copy)]
+pub struct SpiJob {
+    device: &'static SpiDevice,
+    tx: *const u8,
+    rx: *mut u8,
+    /// 传输长度（数据帧个数）
+    len: usize,
+    /// 是否为16位数据帧
+    wide: bool,
+    callback: Option<SpiCallback>,
+}
+
+impl SpiJob {
+    /// 创建事务，检查帧宽度与设备配置一致
+    fn new(device: &'static SpiDevice, tx: *const u8, rx: *mut u8, len: usize, wide: bool) -> Result<Self, SpiError> {
+        if device.is_16bit() != wide {
+            return Err(SpiError::DataSizeMismatch);
+        }
+        Ok(Self {
+            device,
+            tx,
+            rx,
+            len,
+            wide,
+            callback: None,
+        })
+    }
+    
+    /// 只发送事务（丢弃接收数据）
+    pub fn write(device: &'static SpiDevice, data: &'static [u8]) -> Result<Self, SpiError> {
+        Self::new(device, data.as_ptr(), core::ptr::null_mut(), data.len(), false)
+    }
+    
+    /// 只接收事务（发送0xFF）
+    pub fn read(device: &'static SpiDevice, buffer: &'static mut [u8]) -> Result<Self, SpiError> {
+        Self::new(device, core::ptr::null(), buffer.as_mut_ptr(), buffer.len(), false)
+    }
+    
+    /// 全双工事务，长度取两者中较短的一个
+    pub fn transfer(device: &'static SpiDevice, tx: &'static [u8], rx: &'static mut [u8]) -> Result<Self, SpiError> {
+        Self::new(device, tx.as_ptr(), rx.as_mut_ptr(), tx.len().min(rx.len()), false)
+    }
+    
+    /// 16位数据帧的只发送事务
+    pub fn write16(device: &'static SpiDevice, data: &'static [u16]) -> Result<Self, SpiError> {
+        Self::new(device, data.as_ptr() as *const u8, core::ptr::null_mut(), data.len(), true)
+    }
+    
+    /// 16位数据帧的只接收事务（发送0xFFFF）
+    pub fn read16(device: &'static SpiDevice, buffer: &'static mut [u16]) -> Result<Self, SpiError> {
+        Self::new(device, core::ptr::null(), buffer.as_mut_ptr() as *mut u8, buffer.len(), true)
+    }
+    
+    /// 16位数据帧的全双工事务，长度取两者中较短的一个
+    pub fn transfer16(device: &'static SpiDevice, tx: &'static [u16], rx: &'static mut [u16]) -> Result<Self, SpiError> {
+        Self::new(device, tx.as_ptr() as *const u8, rx.as_mut_ptr() as *mut u8, tx.len().min(rx.len()), true)
+    }
+    
+    /// 设置完成回调
+    pub fn with_callback(mut self, callback: SpiCallback) -> Self {
+        self.callback = Some(callback);
+        self
+    }
+}
+
+/// 正在进行的事务
+struct SpiActiveJob {
+    job: SpiJob,
+    transfer: SpiDmaTransfer<'static>,
+}
+
+/// 多设备共享的SPI总线
+/// 
+/// - 缓存当前生效的CR1镜像，只有活动设备的配置不同时才重写CR1
+/// - 管理每个设备的片选
+/// - 事务队列深度为`Q`，DMA完成中断里立即启动下一个事务，使不同设备的传输背靠背进行
+/// 
+/// 使用队列时需在SPI的接收和发送DMA通道中断中都调用`handle_dma_interrupt`，并在NVIC中使能这两个中断。
+pub struct SpiBus<const Q: usize> {
+    spi: SpiNumber,
+    /// 当前CR1镜像（不含SPE位），0表示尚未配置
+    active_cr1: AtomicU32,
+    queue: UnsafeCell<[Option<SpiJob>; Q]>,
+    head: AtomicUsize,
+    tail: AtomicUsize,
+    current: UnsafeCell<Option<SpiActiveJob>>,
+    busy: AtomicBool,
+}
+
+/// 实现 Sync trait，队列修改和事务切换都在临界区或DMA中断中进行
+unsafe impl<const Q: usize> Sync for SpiBus<Q> {}
+
+impl<const Q: usize> SpiBus<Q> {
+    /// 编译期检查队列深度
+    const SIZE_CHECK: () = assert!(Q.is_power_of_two() && Q <= 256, "SpiBus队列深度必须是2的幂且不超过256");
+    
+    /// 创建新的共享总线
+    pub const fn new(spi: SpiNumber) -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            spi,
+            active_cr1: AtomicU32::new(0),
+            queue: UnsafeCell::new([None; Q]),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+            current: UnsafeCell::new(None),
+            busy: AtomicBool::new(false),
+        }
+    }
+    
+    /// 获取底层SPI
+    pub const fn spi(&self) -> Spi {
+        Spi::new(self.spi)
+    }
+    
+    /// 初始化总线（使能时钟，关闭SPI中断）
+    pub unsafe fn init(&self) {
+        let spi = self.spi();
+        spi.init(SpiMode::Mode0, SpiDataSize::Bits8, SpiBaudRatePrescaler::Div256, SpiDirection::TwoLinesFullDuplex, SpiNssMode::Software);
+        spi.get_spi().cr2().write(|w: &mut library::spi1::cr2::W| unsafe { w.bits(0) });
+        self.active_cr1.store(0, Ordering::Relaxed);
+    }
+    
+    /// 切换到指定设备的配置
+    /// 
+    /// 与当前缓存的CR1相同时不访问寄存器
+    unsafe fn configure(&self, device: &SpiDevice) {
+        if self.active_cr1.load(Ordering::Relaxed) == device.cr1 {
+            return;
+        }
+        
+        let regs = self.spi().get_spi();
+        while (regs.sr().read().bits() & SR_BSY) != 0 {
+            core::hint::spin_loop();
+        }
+        // 修改BR/CPOL/CPHA/DFF前必须关闭SPI
+        regs.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(device.cr1) });
+        regs.cr1().write(|w: &mut library::spi1::cr1::W| unsafe { w.bits(device.cr1 | CR1_SPE) });
+        self.active_cr1.store(device.cr1, Ordering::Relaxed);
+    }
+    
+    /// 同步刷新CR1缓存（SPI传输函数可能切换了DFF）
+    unsafe fn sync_cache(&self) {
+        let cr1 = self.spi().get_spi().cr1().read().bits() & !CR1_SPE;
+        self.active_cr1.store(cr1, Ordering::Relaxed);
+    }
+    
+    /// 总线是否有正在进行或排队的事务
+    pub fn is_busy(&self) -> bool {
+        self.busy.load(Ordering::Acquire)
+    }
+    
+    /// 以阻塞方式对一个设备执行事务
+    /// 
+    /// 先等待队列中的事务全部完成并占用总线，然后切换配置、拉低片选、执行`f`、释放片选。
+    /// 占用期间`enqueue`加入的事务只排队不启动，事务结束后再依次开始。
+    /// 
+    /// # Arguments
+    /// * `device` - 目标设备
+    /// * `f` - 在片选有效期间执行的操作
+    pub unsafe fn transaction<R>(&self, device: &SpiDevice, f: impl FnOnce(&Spi) -> R) -> R {
+        // 检查与占用在同一个临界区内，避免中断里的enqueue在两者之间启动DMA事务
+        while !cortex_m::interrupt::free(|_| {
+            if self.busy.load(Ordering::Relaxed) {
+                false
+            } else {
+                self.busy.store(true, Ordering::Relaxed);
+                true
+            }
+        }) {
+            core::hint::spin_loop();
+        }
+        
+        self.configure(device);
+        device.select();
+        let result = f(&self.spi());
+        device.deselect();
+        self.sync_cache();
+        
+        // 释放总线，启动占用期间排队的事务（队列为空时清除busy）
+        cortex_m::interrupt::free(|_| self.start_next());
+        result
+    }
+    
+    /// 把事务加入队列，总线空闲时立即开始
+    /// 
+    /// # Returns
+    /// 队列满时返回`Err(job)`
+    pub fn enqueue(&self, job: SpiJob) -> Result<(), SpiJob> {
+        cortex_m::interrupt::free(|_| unsafe {
+            let head = self.head.load(Ordering::Relaxed);
+            let tail = self.tail.load(Ordering::Relaxed);
+            if head.wrapping_sub(tail) >= Q {
+                return Err(job);
+            }
+            (*self.queue.get())[head & (Q - 1)] = Some(job);
+            self.head.store(head.wrapping_add(1), Ordering::Relaxed);
+            
+            if !self.busy.load(Ordering::Relaxed) {
+                self.busy.store(true, Ordering::Release);
+                self.start_next();
+            }
+            Ok(())
+        })
+    }
+    
+    /// 取出并启动下一个事务（临界区或DMA中断中调用）
+    unsafe fn start_next(&self) {
+        loop {
+            let tail = self.tail.load(Ordering::Relaxed);
+            if tail == self.head.load(Ordering::Relaxed) {
+                self.busy.store(false, Ordering::Release);
+                return;
+            }
+            let job = match (*self.queue.get())[tail & (Q - 1)].take() {
+                Some(job) => job,
+                None => { self.tail.store(tail.wrapping_add(1), Ordering::Relaxed); continue; },
+            };
+            self.tail.store(tail.wrapping_add(1), Ordering::Relaxed);
+            
+            self.configure(job.device);
+            job.device.select();
+            
+            let spi = self.spi();
+            let started = if job.wide {
+                let tx = if job.tx.is_null() { None } else { Some(core::slice::from_raw_parts(job.tx as *const u16, job.len)) };
+                let rx = if job.rx.is_null() { None } else { Some(core::slice::from_raw_parts_mut(job.rx as *mut u16, job.len)) };
+                spi.start_dma::<u16>(tx, rx, job.len, true)
+            } else {
+                let tx = if job.tx.is_null() { None } else { Some(core::slice::from_raw_parts(job.tx, job.len)) };
+                let rx = if job.rx.is_null() { None } else { Some(core::slice::from_raw_parts_mut(job.rx, job.len)) };
+                spi.start_dma::<u8>(tx, rx, job.len, true)
+            };
+            // start_dma按缓冲区宽度设置DFF，与transaction一样重新同步CR1缓存
+            self.sync_cache();
+            match started {
+                Ok(transfer) => {
+                    *self.current.get() = Some(SpiActiveJob { job, transfer });
+                    return;
+                },
+                Err(err) => {
+                    // 启动失败立即结束该事务，继续下一个
+                    job.device.deselect();
+                    if let Some(callback) = job.callback {
+                        callback(Err(err));
+                    }
+                },
+            }
+        }
+    }
+    
+    /// 处理DMA通道中断：当前事务结束时释放片选、调用回调并启动下一个事务
+    pub fn handle_dma_interrupt(&self) {
+        unsafe {
+            let current = &mut *self.current.get();
+            let result = match current {
+                Some(active) => match active.transfer.poll() {
+                    Some(result) => result,
+                    None => return,
+                },
+                None => return,
+            };
+            
+            let active = current.take().unwrap();
+            active.job.device.deselect();
+            if let Some(callback) = active.job.callback {
+                callback(result);
+            }
+            self.start_next();
+        }
+    }
+}
@@ -13,11 +13,16 @@ use library::flash::RegisterBlock as FlashRegisterBlock;
 
 // 引用延时模块
 use super::delay;
+use super::rcc::RccDriver;
 
 // 定义常量
 const HSE_STARTUP_TIMEOUT: u32 = 0x05000;
 
+/// HSE频率（Hz），初始化和切换时钟时记录，用于从寄存器推算PLL输出频率
+static mut HSE_FREQUENCY: u32 = 8_000_000;
+
 /// 系统时钟频率结构体
+#[derive(Debug, PartialEq, Copy, Clone)]
 pub struct SystemClocks {
     pub sysclk: u32,
     pub hclk: u32,
@@ -64,6 +69,9 @@ pub fn set_log_handler(handler: LogHandler) {
 
 /// 记录日志
 /// 
+/// 在调用者的上下文中同步调用处理函数；中断等热路径应使用`logger::log_deferred!`，
+/// 由后台任务通过`LOGGER.drain_to_log`再转交给这里设置的处理函数。
+/// 
 /// # 参数
 /// - `level`：日志级别
 /// - `message`：日志消息
@@ -237,6 +245,93 @@ impl ClockConfig {
     pub fn hse_72mhz() -> Self {
         Self::default()
     }
+    
+    /// 按配置推算各总线时钟频率
+    /// 
+    /// # Returns
+    /// 分频系数不是硬件支持的值，或超出器件限制（SYSCLK/HCLK ≤ 72MHz，PCLK1 ≤ 36MHz，
+    /// ADCCLK ≤ 14MHz）时返回`None`
+    pub fn clocks(&self) -> Option<SystemClocks> {
+        let sysclk = match self.hse_freq {
+            Some(hse) if self.use_pll => {
+                if self.pll_mul < 2 || self.pll_mul > 16 {
+                    return None;
+                }
+                hse * self.pll_mul as u32
+            },
+            Some(hse) => hse,
+            None => 8_000_000,
+        };
+        
+        hpre_bits(self.hpre)?;
+        ppre_bits(self.ppre1)?;
+        ppre_bits(self.ppre2)?;
+        adcpre_bits(self.adcpre)?;
+        
+        let hclk = sysclk / self.hpre;
+        let pclk1 = hclk / self.ppre1;
+        let pclk2 = hclk / self.ppre2;
+        let adcclk = pclk2 / self.adcpre;
+        if sysclk > 72_000_000 || pclk1 > 36_000_000 || adcclk > 14_000_000 {
+            return None;
+        }
+        
+        Some(SystemClocks {
+            sysclk,
+            hclk,
+            pclk1,
+            pclk2,
+            adcclk,
+        })
+    }
+}
+
+/// AHB预分频系数对应的HPRE位
+fn hpre_bits(div: u32) -> Option<u8> {
+    match div {
+        1 => Some(0x00),
+        2 => Some(0x08),
+        4 => Some(0x09),
+        8 => Some(0x0A),
+        16 => Some(0x0B),
+        64 => Some(0x0C),
+        128 => Some(0x0D),
+        256 => Some(0x0E),
+        512 => Some(0x0F),
+        _ => None,
+    }
+}
+
+/// APB预分频系数对应的PPRE1/PPRE2位
+fn ppre_bits(div: u32) -> Option<u8> {
+    match div {
+        1 => Some(0x00),
+        2 => Some(0x04),
+        4 => Some(0x05),
+        8 => Some(0x06),
+        16 => Some(0x07),
+        _ => None,
+    }
+}
+
+/// ADC预分频系数对应的ADCPRE位
+fn adcpre_bits(div: u32) -> Option<u8> {
+    match div {
+        2 => Some(0x00),
+        4 => Some(0x01),
+        6 => Some(0x02),
+        8 => Some(0x03),
+        _ => None,
+    }
+}
+
+/// 按SYSCLK选择Flash等待周期
+fn flash_latency_for(sysclk: u32) -> u8 {
+    match sysclk {
+        0..=24_000_000 => 0x00,
+        24_000_001..=48_000_000 => 0x01,
+        _ => 0x02,
+    }
 }
 
 /// 系统初始化函数（使用默认配置）
@@ -342,6 +437,7 @@ pub fn init_with_config(config: &ClockConfig) -> InitResult {
             return InitResult::HseTimeout;
         }
         log_info("HSE已就绪");
+        unsafe { HSE_FREQUENCY = hse_freq };
         
         if config.use_pll {
             // 构建日志消息
@@ -399,51 +495,20 @@ pub fn init_with_config(config: &ClockConfig) -> InitResult {
     log_debug("配置总线预分频器");
     
     // 配置AHB预分频
-    let hpre_bits = match config.hpre {
-        1 => 0x00,
-        2 => 0x08,
-        4 => 0x09,
-        8 => 0x0A,
-        16 => 0x0B,
-        64 => 0x0C,
-        128 => 0x0D,
-        256 => 0x0E,
-        512 => 0x0F,
-        _ => 0x00,
-    };
-    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.hpre().bits(hpre_bits) });
+    let hpre = hpre_bits(config.hpre).unwrap_or(0x00);
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.hpre().bits(hpre) });
     
     // 配置APB2预分频
-    let ppre2_bits = match config.ppre2 {
-        1 => 0x00,
-        2 => 0x04,
-        4 => 0x05,
-        8 => 0x06,
-        16 => 0x07,
-        _ => 0x00,
-    };
-    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.ppre2().bits(ppre2_bits) });
+    let ppre2 = ppre_bits(config.ppre2).unwrap_or(0x00);
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.ppre2().bits(ppre2) });
     
     // 配置APB1预分频
-    let ppre1_bits = match config.ppre1 {
-        1 => 0x00,
-        2 => 0x04,
-        4 => 0x05,
-        8 => 0x06,
-        16 => 0x07,
-        _ => 0x00,
-    };
-    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.ppre1().bits(ppre1_bits) });
+    let ppre1 = ppre_bits(config.ppre1).unwrap_or(0x00);
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.ppre1().bits(ppre1) });
     
     // 配置ADC预分频
-    let adcpre_bits = match config.adcpre {
-        2 => 0x00,
-        4 => 0x01,
-        6 => 0x02,
-        8 => 0x03,
-        _ => 0x00,
-    };
-    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.adcpre().bits(adcpre_bits) });
+    let adcpre = adcpre_bits(config.adcpre).unwrap_or(0x00);
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| unsafe { w.adcpre().bits(adcpre) });
     
     // 9. 设置向量表偏移
     log_debug("设置向量表偏移");
@@ -464,6 +529,7 @@ pub fn init_with_config(config: &ClockConfig) -> InitResult {
     msg.push_str(" Hz").unwrap();
     log_info(msg.as_str());
     
+    unsafe { ACTIVE_CLOCKS = Some((*config, get_system_clocks())) };
     InitResult::Success
 }
 
@@ -533,71 +599,301 @@ fn reset_rcc_config(rcc: &library::rcc::RegisterBlock) -> bool {
 }
 
 /// 获取系统时钟频率
+/// 
+/// 按RCC寄存器的当前设置计算（包括PLL倍频和各级预分频），运行时切换时钟后同样有效
 pub fn get_system_clocks() -> SystemClocks {
-    let rcc = unsafe { &*library::Rcc::ptr() };
+    let clocks = unsafe { RccDriver::new_with_hse_freq(HSE_FREQUENCY).get_clocks_freq() };
     
-    // 计算系统时钟频率
-    let sysclk = match rcc.cfgr().read().sws().bits() {
-        0x00 => 8_000_000, // HSI
-        0x01 => 8_000_000, // HSE
-        0x02 => 72_000_000, // PLL
-        _ => 8_000_000,
+    SystemClocks {
+        sysclk: clocks.sysclk_frequency,
+        hclk: clocks.hclk_frequency,
+        pclk1: clocks.pclk1_frequency,
+        pclk2: clocks.pclk2_frequency,
+        adcclk: clocks.adcclk_frequency,
+    }
+}
+
+/// 时钟切换通知阶段
+#[derive(Debug, PartialEq, Copy, Clone)]
+pub enum ClockChangePhase {
+    /// 即将切换：应等待进行中的传输结束（例如串口发送完成）
+    Before,
+    /// 切换完成：按新频率重新计算分频值
+    After,
+}
+
+/// 时钟切换通知函数类型，参数为（阶段, 切换前的频率, 切换后的频率）
+pub type ClockChangeHandler = fn(ClockChangePhase, &SystemClocks, &SystemClocks);
+
+/// 最多可注册的时钟切换通知函数个数
+pub const MAX_CLOCK_CHANGE_HANDLERS: usize = 8;
+
+/// 已注册的时钟切换通知函数
+static mut CLOCK_CHANGE_HANDLERS: [Option<ClockChangeHandler>; MAX_CLOCK_CHANGE_HANDLERS] = [None; MAX_CLOCK_CHANGE_HANDLERS];
+
+/// 注册时钟切换通知函数
+/// 
+/// 驱动的分频值（串口波特率、IIC的CCR、SPI预分频、定时器PSC等）按初始化时的总线频率计算，
+/// 运行时切换时钟后需要在`After`阶段调用各驱动的`retime`重新计算；
+/// SysTick和延时函数由`set_clock_config`自动处理。
+/// 
+/// ```ignore
+/// fn on_clock_change(phase: ClockChangePhase, old: &SystemClocks, new: &SystemClocks) {
+///     match phase {
+///         ClockChangePhase::Before => while !SERIAL1.is_tx_complete() {},
+///         ClockChangePhase::After => unsafe {
+///             SERIAL1.retime(old, new);
+///             SPI1.retime(old, new);
+///             TIM2.retime(old, new);
+///         },
+///     }
+/// }
+/// 
+/// system::register_clock_change_handler(on_clock_change);
+/// ```
+/// 
+/// # Returns
+/// 注册成功或已注册返回`true`，已满返回`false`
+pub fn register_clock_change_handler(handler: ClockChangeHandler) -> bool {
+    cortex_m::interrupt::free(|_| unsafe {
+        let handlers = &mut *core::ptr::addr_of_mut!(CLOCK_CHANGE_HANDLERS);
+        if handlers.iter().flatten().any(|&h| h as usize == handler as usize) {
+            return true;
+        }
+        match handlers.iter_mut().find(|h| h.is_none()) {
+            Some(slot) => {
+                *slot = Some(handler);
+                true
+            },
+            None => false,
+        }
+    })
+}
+
+/// 注销时钟切换通知函数
+pub fn unregister_clock_change_handler(handler: ClockChangeHandler) {
+    cortex_m::interrupt::free(|_| unsafe {
+        let handlers = &mut *core::ptr::addr_of_mut!(CLOCK_CHANGE_HANDLERS);
+        for slot in handlers.iter_mut() {
+            if let Some(h) = *slot {
+                if h as usize == handler as usize {
+                    *slot = None;
+                }
+            }
+        }
+    });
+}
+
+/// 按注册顺序调用通知函数
+fn notify_clock_change(phase: ClockChangePhase, old: &SystemClocks, new: &SystemClocks) {
+    let handlers = unsafe { *core::ptr::addr_of!(CLOCK_CHANGE_HANDLERS) };
+    for handler in handlers.iter().flatten() {
+        handler(phase, old, new);
+    }
+}
+
+/// 运行时性能档位
+#[derive(Debug, PartialEq, Copy, Clone)]
+pub enum PerformanceLevel {
+    /// 8MHz，HSI直接驱动，HSE和PLL关闭，用于空闲或低负载
+    Low,
+    /// 36MHz，HSE经PLL倍频到72MHz后AHB二分频
+    Medium,
+    /// 72MHz，HSE经PLL倍频，用于突发计算或高速通信
+    High,
+}
+
+impl PerformanceLevel {
+    /// 档位对应的时钟配置
+    pub fn clock_config(&self) -> ClockConfig {
+        match self {
+            PerformanceLevel::Low => ClockConfig::hsi_8mhz(),
+            PerformanceLevel::Medium => ClockConfig::hse_36mhz(),
+            PerformanceLevel::High => ClockConfig::hse_72mhz(),
+        }
+    }
+}
+
+/// 当前生效的时钟配置及对应频率，供停止模式唤醒后恢复时钟
+static mut ACTIVE_CLOCKS: Option<(ClockConfig, SystemClocks)> = None;
+
+/// 当前性能档位，通过`set_clock_config`切换到自定义配置后为`None`
+static mut PERFORMANCE_LEVEL: Option<PerformanceLevel> = None;
+
+/// 切换性能档位
+/// 
+/// # Returns
+/// 同`set_clock_config`
+pub fn set_performance_level(level: PerformanceLevel) -> InitResult {
+    let result = set_clock_config(&level.clock_config());
+    if result == InitResult::Success {
+        unsafe { PERFORMANCE_LEVEL = Some(level) };
+    }
+    result
+}
+
+/// 获取当前性能档位
+pub fn performance_level() -> Option<PerformanceLevel> {
+    unsafe { PERFORMANCE_LEVEL }
+}
+
+/// 运行时切换系统时钟
+/// 
+/// 与`init_with_config`不同，不复位RCC、不重新初始化内存段，可以在系统运行中反复调用：
+/// 1. 以`Before`阶段调用已注册的通知函数
+/// 2. 关中断，频率升高时先增加Flash等待周期
+/// 3. 临时切换到HSI，再按新配置启动HSE/PLL（PLL只能在关闭时修改倍频）并设置各级预分频
+/// 4. 切换到目标时钟源，关闭不再使用的HSE和PLL，频率降低时最后减少Flash等待周期
+/// 5. 按新的HCLK重新设置SysTick（运行时间保持连续），开中断
+/// 6. 以`After`阶段调用通知函数，由各驱动重新计算分频值
+/// 
+/// 切换期间（HSE启动最长约数毫秒）中断被屏蔽。使用USB时PLL输出必须保持48MHz或72MHz。
+/// 
+/// # Arguments
+/// * `config` - 目标时钟配置
+/// 
+/// # Returns
+/// - `InitResult::Success`：切换成功
+/// - `InitResult::InvalidConfig`：配置无效或超出器件限制，时钟保持不变
+/// - `InitResult::HsiTimeout`/`HseTimeout`/`PllTimeout`：时钟源启动失败，系统以8MHz HSI运行
+pub fn set_clock_config(config: &ClockConfig) -> InitResult {
+    let target = match config.clocks() {
+        Some(clocks) => clocks,
+        None => {
+            log_error("无效的时钟配置，保持当前时钟");
+            return InitResult::InvalidConfig;
+        }
     };
     
-    // 计算HCLK频率
-    let hclk_div = match rcc.cfgr().read().hpre().bits() {
-        0x0 => 1,
-        0x8 => 2,
-        0x9 => 4,
-        0xA => 8,
-        0xB => 16,
-        0xC => 64,
-        0xD => 128,
-        0xE => 256,
-        0xF => 512,
-        _ => 1,
-    };
-    let hclk = sysclk / hclk_div;
-    
-    // 计算PCLK1频率
-    let pclk1_div = match rcc.cfgr().read().ppre1().bits() {
-        0x0 => 1,
-        0x4 => 2,
-        0x5 => 4,
-        0x6 => 8,
-        0x7 => 16,
-        _ => 1,
-    };
-    let pclk1 = hclk / pclk1_div;
-    
-    // 计算PCLK2频率
-    let pclk2_div = match rcc.cfgr().read().ppre2().bits() {
-        0x0 => 1,
-        0x4 => 2,
-        0x5 => 4,
-        0x6 => 8,
-        0x7 => 16,
-        _ => 1,
+    let old = get_system_clocks();
+    notify_clock_change(ClockChangePhase::Before, &old, &target);
+    
+    let result = cortex_m::interrupt::free(|_| unsafe { switch_clocks(config, &target) });
+    unsafe {
+        PERFORMANCE_LEVEL = None;
+        ACTIVE_CLOCKS = if result == InitResult::Success { Some((*config, target)) } else { None };
+    }
+    if result != InitResult::Success {
+        log_error("时钟源启动失败，系统时钟保持为HSI");
+    }
+    
+    let new = get_system_clocks();
+    notify_clock_change(ClockChangePhase::After, &old, &new);
+    result
+}
+
+/// 停止模式唤醒后按原配置恢复时钟
+/// 
+/// 从停止模式唤醒时硬件自动切换到HSI，HSE和PLL已关闭。按最近一次`init_with_config`或
+/// `set_clock_config`成功的配置重新启动时钟源；频率与进入停止模式前相同，
+/// 因此不调用时钟切换通知函数，SysTick也不需要重新换算。
+/// 没有记录的配置（未调用`init_with_config`或上次切换失败）时系统本来就运行在HSI，直接返回成功。
+/// 
+/// # Returns
+/// 同`set_clock_config`的时钟源启动结果
+/// 
+/// # Safety
+/// 必须在临界区内、刚从停止模式唤醒时调用
+pub unsafe fn restore_clocks() -> InitResult {
+    match ACTIVE_CLOCKS {
+        Some((config, clocks)) => {
+            let result = switch_clocks(&config, &clocks);
+            if result != InitResult::Success {
+                ACTIVE_CLOCKS = None;
+            }
+            result
+        }
+        None => InitResult::Success,
+    }
+}
+
+/// 执行时钟切换，必须在临界区内调用
+unsafe fn switch_clocks(config: &ClockConfig, target: &SystemClocks) -> InitResult {
+    let rcc = &*library::Rcc::ptr();
+    let flash = &*library::Flash::ptr();
+    
+    let old_latency = flash.acr().read().latency().bits();
+    let latency = flash_latency_for(target.sysclk);
+    if latency > old_latency {
+        flash.acr().modify(|_, w: &mut library::flash::acr::W| w.latency().bits(latency));
+    }
+    
+    // 以HSI作为过渡时钟，总线不分频
+    rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.hsion().set_bit());
+    if !wait_for_flag(|| rcc.cr().read().hsirdy().bit_is_set(), 1000) {
+        return InitResult::HsiTimeout;
+    }
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| w.sw().bits(0x00));
+    while rcc.cfgr().read().sws().bits() != 0x00 {};
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| {
+        w.hpre().bits(0x00);
+        w.ppre1().bits(0x00);
+        w.ppre2().bits(0x00);
+        w.adcpre().bits(0x00)
+    });
+    rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.pllon().clear_bit());
+    while rcc.cr().read().pllrdy().bit_is_set() {};
+    
+    let source = match start_clock_source(rcc, config) {
+        Ok(source) => source,
+        Err(err) => {
+            // 启动失败时留在HSI，关闭未就绪的时钟源
+            rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.pllon().clear_bit().hseon().clear_bit());
+            delay::retime_systick(8_000_000);
+            return err;
+        }
     };
-    let pclk2 = hclk / pclk2_div;
-    
-    // 计算ADCCLK频率
-    let adcclk_div = match rcc.cfgr().read().adcpre().bits() {
-        0x0 => 2,
-        0x1 => 4,
-        0x2 => 6,
-        0x3 => 8,
-        _ => 2,
+    
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| {
+        w.hpre().bits(hpre_bits(config.hpre).unwrap_or(0x00));
+        w.ppre1().bits(ppre_bits(config.ppre1).unwrap_or(0x00));
+        w.ppre2().bits(ppre_bits(config.ppre2).unwrap_or(0x00));
+        w.adcpre().bits(adcpre_bits(config.adcpre).unwrap_or(0x00))
+    });
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| w.sw().bits(source));
+    while rcc.cfgr().read().sws().bits() != source {};
+    
+    if source == 0x00 {
+        // HSI直接驱动时HSE不再需要
+        rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.hseon().clear_bit());
+    }
+    if latency < old_latency {
+        flash.acr().modify(|_, w: &mut library::flash::acr::W| w.latency().bits(latency));
+    }
+    
+    delay::retime_systick(target.hclk);
+    InitResult::Success
+}
+
+/// 按配置启动HSE和PLL
+/// 
+/// # Returns
+/// 目标时钟源的SW位（0：HSI，1：HSE，2：PLL）
+unsafe fn start_clock_source(rcc: &RccRegisterBlock, config: &ClockConfig) -> Result<u8, InitResult> {
+    let hse_freq = match config.hse_freq {
+        Some(freq) => freq,
+        None => return Ok(0x00),
     };
-    let adcclk = pclk2 / adcclk_div;
     
-    SystemClocks {
-        sysclk,
-        hclk,
-        pclk1,
-        pclk2,
-        adcclk,
+    rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.hseon().set_bit());
+    if !wait_for_flag(|| rcc.cr().read().hserdy().bit_is_set(), HSE_STARTUP_TIMEOUT) {
+        return Err(InitResult::HseTimeout);
     }
+    HSE_FREQUENCY = hse_freq;
+    
+    if !config.use_pll {
+        return Ok(0x01);
+    }
+    
+    rcc.cfgr().modify(|_, w: &mut library::rcc::cfgr::W| {
+        w.pllsrc().set_bit();
+        w.pllmul().bits(config.pll_mul - 2)
+    });
+    rcc.cr().modify(|_, w: &mut library::rcc::cr::W| w.pllon().set_bit());
+    if !wait_for_flag(|| rcc.cr().read().pllrdy().bit_is_set(), HSE_STARTUP_TIMEOUT) {
+        return Err(InitResult::PllTimeout);
+    }
+    Ok(0x02)
 }
 
 /// 使能或禁用外设时钟
@@ -826,47 +1122,79 @@ pub fn configure_usb_clock() {
     set_peripheral_clock(PeripheralClock::USB, true);
 }
 
-/// 获取系统复位原因
-pub fn get_reset_reason() -> heapless::String<64> {
-    let rcc = unsafe { &*library::Rcc::ptr() };
-    let csr = rcc.csr().read();
-    
-    let mut reasons = heapless::Vec::<heapless::String<16>, 6>::new();
-    
-    if csr.pinrstf().bit_is_set() {
-        reasons.push(heapless::String::from("引脚复位")).unwrap();
-    }
-    if csr.porrstf().bit_is_set() {
-        reasons.push(heapless::String::from("掉电复位")).unwrap();
-    }
-    if csr.sftrstf().bit_is_set() {
-        reasons.push(heapless::String::from("软件复位")).unwrap();
-    }
-    if csr.iwdgrstf().bit_is_set() {
-        reasons.push(heapless::String::from("独立看门狗复位")).unwrap();
+/// 复位标志：NRST引脚复位
+pub const RESET_FLAG_PIN: u8 = 1 << 0;
+/// 复位标志：上电/掉电复位
+pub const RESET_FLAG_POR: u8 = 1 << 1;
+/// 复位标志：软件复位
+pub const RESET_FLAG_SOFTWARE: u8 = 1 << 2;
+/// 复位标志：独立看门狗复位
+pub const RESET_FLAG_IWDG: u8 = 1 << 3;
+/// 复位标志：窗口看门狗复位
+pub const RESET_FLAG_WWDG: u8 = 1 << 4;
+/// 复位标志：低功耗复位
+pub const RESET_FLAG_LOW_POWER: u8 = 1 << 5;
+
+/// 尚未锁存复位标志
+const RESET_FLAGS_UNLATCHED: u16 = 0xFFFF;
+
+/// 锁存的复位标志（RCC_CSR[31:26]）
+static RESET_FLAGS: core::sync::atomic::AtomicU16 = core::sync::atomic::AtomicU16::new(RESET_FLAGS_UNLATCHED);
+
+/// 获取复位标志（`RESET_FLAG_*`的组合）
+/// 
+/// 第一次调用时从RCC_CSR读取并清除硬件标志，之后返回锁存值，
+/// 因此可以反复调用（如遥测帧每次都带上复位原因），结果保持不变直到下次复位。
+pub fn get_reset_flags() -> u8 {
+    use core::sync::atomic::Ordering;
+    
+    let latched = RESET_FLAGS.load(Ordering::Relaxed);
+    if latched != RESET_FLAGS_UNLATCHED {
+        return latched as u8;
     }
-    if csr.wwdgrstf().bit_is_set() {
-        reasons.push(heapless::String::from("窗口看门狗复位")).unwrap();
+    
+    let rcc = unsafe { &*library::Rcc::ptr() };
+    let flags = ((rcc.csr().read().bits() >> 26) & 0x3F) as u16;
+    // 只有第一个锁存者清除硬件标志
+    if RESET_FLAGS
+        .compare_exchange(RESET_FLAGS_UNLATCHED, flags, Ordering::Relaxed, Ordering::Relaxed)
+        .is_ok()
+    {
+        rcc.csr().modify(|_, w: &mut library::rcc::csr::W| w.rmvf().set_bit());
+        flags as u8
+    } else {
+        RESET_FLAGS.load(Ordering::Relaxed) as u8
     }
-    if csr.lpwrrstf().bit_is_set() {
-        reasons.push(heapless::String::from("低功耗复位")).unwrap();
+}
+
+/// 获取系统复位原因
+/// 
+/// 基于`get_reset_flags`，多次调用结果一致
+pub fn get_reset_reason() -> heapless::String<64> {
+    const NAMES: [(u8, &str); 6] = [
+        (RESET_FLAG_PIN, "引脚复位"),
+        (RESET_FLAG_POR, "掉电复位"),
+        (RESET_FLAG_SOFTWARE, "软件复位"),
+        (RESET_FLAG_IWDG, "独立看门狗复位"),
+        (RESET_FLAG_WWDG, "窗口看门狗复位"),
+        (RESET_FLAG_LOW_POWER, "低功耗复位"),
+    ];
+    
+    let flags = get_reset_flags();
+    if flags == 0 {
+        return heapless::String::from("未知复位原因");
     }
     
-    // 清除复位标志
-    rcc.csr().write(|w: &mut library::rcc::csr::W| w.rmvf().set_bit());
-    
-    if reasons.is_empty() {
-        heapless::String::from("未知复位原因")
-    } else {
-        let mut result = heapless::String::new();
-        for (i, reason) in reasons.iter().enumerate() {
-            if i > 0 {
-                result.push_str("、").unwrap();
+    let mut result = heapless::String::new();
+    for &(flag, name) in NAMES.iter() {
+        if (flags & flag) != 0 {
+            if !result.is_empty() {
+                let _ = result.push_str("、");
             }
-            result.push_str(reason.as_str()).unwrap();
+            let _ = result.push_str(name);
         }
-        result
     }
+    result
 }
 
 /// 软件复位系统
@@ -1155,24 +1483,12 @@ impl Default for SystemStatus {
 
 /// 获取系统运行时间（毫秒）
 /// 
-/// 使用SysTick计数器计算系统运行时间
+/// 使用SysTick计数器计算系统运行时间（与`delay::get_uptime_ms`一致，无节拍模式下同样有效）
 /// 
 /// # 返回值
 /// 系统运行时间，单位：毫秒
 pub fn get_uptime_ms() -> u32 {
-    // 注意：这里需要实现一个计数器，在SysTick中断中递增
-    // 由于我们当前没有使用SysTick中断，这里返回一个模拟值
-    // 实际应用中，应该在SysTick中断处理函数中实现真正的计数器
-    
-    // 读取当前SysTick值并计算
-    unsafe {
-        let current_value = core::ptr::read_volatile(0xE000E018 as *const u32);
-        let reload_value = core::ptr::read_volatile(0xE000E014 as *const u32);
-        
-        // 假设系统启动后一直运行，这里返回一个基于当前值的计算
-        // 实际应用中应该使用一个全局计数器
-        (reload_value - current_value) / ((reload_value + 1) / 1000)
-    }
+    delay::get_uptime_ms()
 }
 
 /// 读取内部电压参考值
@@ -1220,7 +1536,8 @@ pub fn get_system_status() -> SystemStatus {
 
 /// 打印系统状态信息
 /// 
-/// 将系统状态信息格式化为字符串并返回
+/// 将系统状态信息格式化为字符串并返回。格式化开销较大，
+/// 周期性上报状态应使用`telemetry`模块的二进制帧。
 /// 
 /// # 返回值
 /// 系统状态信息字符串
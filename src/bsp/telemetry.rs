@@ -0,0 +1,293 @@
+//! 遥测模块
+//! 以固定格式的二进制帧周期性上报系统状态和驱动计数器，不使用`core::fmt`
+//! 
+//! 帧格式（小端，整帧长度为4的倍数）：
+//! 
+//! | 偏移 | 长度 | 内容 |
+//! |------|------|------|
+//! | 0 | 2 | 同步字`0xA55A` |
+//! | 2 | 1 | 帧类型（`TELEMETRY_FRAME_STATUS`） |
+//! | 3 | 1 | 序号（每帧加1，上位机据此统计丢帧） |
+//! | 4 | 2 | 负载长度（字节） |
+//! | 6 | 1 | 计数器个数 |
+//! | 7 | 1 | 保留（0） |
+//! | 8 | 12 | `StatusFrame` |
+//! | 20 | 4×n | 计数器值 |
+//! | 末尾 | 4 | 标准CRC-32（覆盖前面全部字节，与zlib一致） |
+//! 
+//! 编码只是几次字写入加一次硬件CRC，100Hz上报时CPU占用可以忽略。
+
+#![allow(unused)]
+
+use core::sync::atomic::{AtomicU16, AtomicU32, AtomicU8, Ordering};
+use crate::bsp::crc::CRC;
+use crate::bsp::delay::{get_uptime_ms, system_clock};
+use crate::bsp::serial::SerialDmaTx;
+use crate::bsp::system::get_reset_flags;
+
+/// 同步字
+pub const TELEMETRY_SYNC: u16 = 0xA55A;
+
+/// 帧类型：系统状态 + 计数器
+pub const TELEMETRY_FRAME_STATUS: u8 = 0x01;
+
+/// 每帧最多携带的计数器个数
+pub const TELEMETRY_MAX_COUNTERS: usize = 16;
+
+/// 帧头长度
+const HEADER_LEN: usize = 8;
+
+/// 状态快照长度
+const STATUS_LEN: usize = 12;
+
+/// 最大帧长度（字）
+const FRAME_MAX_WORDS: usize = (HEADER_LEN + STATUS_LEN + 4 * TELEMETRY_MAX_COUNTERS + 4) / 4;
+
+/// `StatusFrame::clock_flags`：HSE就绪
+pub const STATUS_HSE_READY: u8 = 1 << 0;
+/// `StatusFrame::clock_flags`：PLL就绪
+pub const STATUS_PLL_READY: u8 = 1 << 1;
+/// `StatusFrame::clock_flags`：PLL为系统时钟
+pub const STATUS_PLL_SYSCLK: u8 = 1 << 2;
+
+/// 计数器读取函数
+/// 
+/// 通常是不捕获变量的闭包，如`|| TX_RING.dropped() as u32`；在编码帧时于调用者上下文中执行，应足够简短。
+pub type CounterSource = fn() -> u32;
+
+/// 内部参考电压（mV），0表示未知
+static VREFINT_MV: AtomicU16 = AtomicU16::new(0);
+
+/// 更新遥测帧中的内部参考电压
+/// 
+/// 遥测本身不启动ADC转换，避免干扰应用对ADC1的使用；由应用在完成VREFINT转换后调用。
+pub fn set_vrefint_mv(mv: u16) {
+    VREFINT_MV.store(mv, Ordering::Relaxed);
+}
+
+/// 系统状态快照
+/// 
+/// 与`system::SystemStatus`内容相同，但只包含定长字段，读取时没有副作用
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct StatusFrame {
+    /// 系统运行时间（毫秒）
+    pub uptime_ms: u32,
+    /// 系统时钟频率（Hz）
+    pub sysclk: u32,
+    /// 内部参考电压（mV），0表示未知
+    pub vrefint_mv: u16,
+    /// 复位原因（`system::RESET_FLAG_*`）
+    pub reset_flags: u8,
+    /// 时钟状态（`STATUS_*`）
+    pub clock_flags: u8,
+}
+
+impl StatusFrame {
+    /// 采集当前状态（只读寄存器和静态变量）
+    pub fn capture() -> Self {
+        let rcc = unsafe { &*library::Rcc::ptr() };
+        let cr = rcc.cr().read();
+        let mut clock_flags = 0;
+        if cr.hserdy().bit_is_set() {
+            clock_flags |= STATUS_HSE_READY;
+        }
+        if cr.pllrdy().bit_is_set() {
+            clock_flags |= STATUS_PLL_READY;
+        }
+        // CFGR.SWS == 0b10：PLL为系统时钟
+        if ((rcc.cfgr().read().bits() >> 2) & 0x3) == 0x2 {
+            clock_flags |= STATUS_PLL_SYSCLK;
+        }
+        
+        Self {
+            uptime_ms: get_uptime_ms(),
+            sysclk: system_clock(),
+            vrefint_mv: VREFINT_MV.load(Ordering::Relaxed),
+            reset_flags: get_reset_flags(),
+            clock_flags,
+        }
+    }
+    
+    /// 按帧格式编码为3个小端字
+    pub fn to_words(&self) -> [u32; STATUS_LEN / 4] {
+        [
+            self.uptime_ms.to_le(),
+            self.sysclk.to_le(),
+            (self.vrefint_mv as u32 | (self.reset_flags as u32) << 16 | (self.clock_flags as u32) << 24).to_le(),
+        ]
+    }
+}
+
+/// 编码后的遥测帧
+pub struct TelemetryFrame {
+    words: [u32; FRAME_MAX_WORDS],
+    len: usize,
+}
+
+impl TelemetryFrame {
+    /// 帧数据
+    pub fn as_bytes(&self) -> &[u8] {
+        unsafe { core::slice::from_raw_parts(self.words.as_ptr() as *const u8, self.len) }
+    }
+}
+
+/// 遥测上报器
+/// 
+/// 通过`SerialDmaTx`以DMA方式发送，编码和入队都不等待串口。
+/// 发送缓冲区放不下整帧时本帧跳过并计数，而不是发送半帧或阻塞。
+/// 
+/// ```ignore
+/// static TELEMETRY: Telemetry<2, 256> = Telemetry::new(
+///     SerialDmaTx::new(SerialPort::USART1, &TX_RING),
+///     [|| TX_RING.dropped() as u32, || LOGGER.len() as u32],
+/// );
+/// 
+/// TELEMETRY.init(100);
+/// loop {
+///     TELEMETRY.poll();
+///     // ...
+/// }
+/// ```
+pub struct Telemetry<const C: usize, const N: usize> {
+    tx: SerialDmaTx<N>,
+    counters: [CounterSource; C],
+    /// 上报周期（毫秒），0表示停止周期上报
+    period_ms: AtomicU32,
+    /// 上次上报的时间（毫秒）
+    last_ms: AtomicU32,
+    /// 下一帧的序号
+    sequence: AtomicU8,
+    /// 因发送缓冲区不足而跳过的帧数
+    skipped: AtomicU32,
+}
+
+impl<const C: usize, const N: usize> Telemetry<C, N> {
+    /// 编译期检查计数器个数
+    const COUNT_CHECK: () = assert!(C <= TELEMETRY_MAX_COUNTERS, "遥测计数器个数超过TELEMETRY_MAX_COUNTERS");
+    
+    /// 创建遥测上报器
+    /// 
+    /// # Arguments
+    /// * `tx` - DMA串口发送实例（需要已初始化串口）
+    /// * `counters` - 计数器读取函数，按顺序写入帧中
+    pub const fn new(tx: SerialDmaTx<N>, counters: [CounterSource; C]) -> Self {
+        let _ = Self::COUNT_CHECK;
+        Self {
+            tx,
+            counters,
+            period_ms: AtomicU32::new(0),
+            last_ms: AtomicU32::new(0),
+            sequence: AtomicU8::new(0),
+            skipped: AtomicU32::new(0),
+        }
+    }
+    
+    /// 初始化（启用CRC时钟）并设置上报频率
+    /// 
+    /// # Arguments
+    /// * `rate_hz` - 上报频率（Hz），0表示只通过`send_now`手动上报
+    /// 
+    /// # Safety
+    /// 直接访问RCC寄存器
+    pub unsafe fn init(&self, rate_hz: u32) {
+        CRC.init();
+        self.set_rate(rate_hz);
+    }
+    
+    /// 设置上报频率
+    /// 
+    /// # Arguments
+    /// * `rate_hz` - 上报频率（Hz，最高1000），0表示停止周期上报
+    pub fn set_rate(&self, rate_hz: u32) {
+        let period = if rate_hz == 0 { 0 } else { (1000 / rate_hz.min(1000)).max(1) };
+        self.period_ms.store(period, Ordering::Relaxed);
+        self.last_ms.store(get_uptime_ms(), Ordering::Relaxed);
+    }
+    
+    /// 获取因发送缓冲区不足而跳过的帧数
+    pub fn skipped(&self) -> u32 {
+        self.skipped.load(Ordering::Relaxed)
+    }
+    
+    /// 编码一帧（不发送，序号不变）
+    /// 
+    /// # Safety
+    /// 使用硬件CRC单元，调用期间其他代码不得使用CRC
+    pub unsafe fn encode(&self, sequence: u8) -> TelemetryFrame {
+        let mut frame = TelemetryFrame {
+            words: [0; FRAME_MAX_WORDS],
+            len: 0,
+        };
+        let payload_len = STATUS_LEN + 4 * C;
+        
+        frame.words[0] = (TELEMETRY_SYNC as u32
+            | (TELEMETRY_FRAME_STATUS as u32) << 16
+            | (sequence as u32) << 24).to_le();
+        frame.words[1] = (payload_len as u32 | (C as u32) << 16).to_le();
+        
+        let status = StatusFrame::capture().to_words();
+        frame.words[2..5].copy_from_slice(&status);
+        
+        for (i, counter) in self.counters.iter().enumerate() {
+            frame.words[5 + i] = counter().to_le();
+        }
+        
+        let body_len = HEADER_LEN + payload_len;
+        frame.len = body_len;
+        let crc = CRC.calculate_block(frame.as_bytes());
+        frame.words[body_len / 4] = crc.to_le();
+        frame.len = body_len + 4;
+        frame
+    }
+    
+    /// 立即编码并排队发送一帧
+    /// 
+    /// # Returns
+    /// 发送缓冲区放不下整帧时返回`false`（计入`skipped`）
+    /// 
+    /// # Safety
+    /// 使用硬件CRC单元；`tx`的写入只能在一个上下文中进行
+    pub unsafe fn send_now(&self) -> bool {
+        // 跳过的帧同样占用序号，上位机看到的序号间隔即为丢帧数
+        let sequence = self.sequence.load(Ordering::Relaxed);
+        self.sequence.store(sequence.wrapping_add(1), Ordering::Relaxed);
+        
+        let frame = self.encode(sequence);
+        let bytes = frame.as_bytes();
+        if self.tx.ring().free_space() < bytes.len() {
+            self.skipped.fetch_add(1, Ordering::Relaxed);
+            return false;
+        }
+        self.tx.write_bytes(bytes);
+        true
+    }
+    
+    /// 到达上报周期时发送一帧，在主循环中调用
+    /// 
+    /// 以固定节拍推进上报时间，偶尔调用延迟不会累积成频率偏差；
+    /// 落后超过一个周期时直接对齐到当前时间，不补发。
+    /// 
+    /// # Returns
+    /// 本次是否发送了帧
+    /// 
+    /// # Safety
+    /// 同`send_now`
+    pub unsafe fn poll(&self) -> bool {
+        let period = self.period_ms.load(Ordering::Relaxed);
+        if period == 0 {
+            return false;
+        }
+        
+        let now = get_uptime_ms();
+        let last = self.last_ms.load(Ordering::Relaxed);
+        let elapsed = now.wrapping_sub(last);
+        if elapsed < period {
+            return false;
+        }
+        
+        let next = if elapsed >= 2 * period { now } else { last.wrapping_add(period) };
+        self.last_ms.store(next, Ordering::Relaxed);
+        self.send_now()
+    }
+}
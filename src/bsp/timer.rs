@@ -7,7 +7,16 @@
 // 使用内部生成的设备驱动库
 use library::*;
 use core::ops::DerefMut;
+use core::cell::UnsafeCell;
+use core::sync::atomic::{AtomicI32, AtomicU32, Ordering};
 use crate::bsp::rcc::RccDriver;
+use crate::bsp::reg;
+use crate::bsp::system::SystemClocks;
+use crate::bsp::dma::{
+    Dma, DmaError, DmaTransfer, DmaTransferDescriptor, DmaChannelPriority,
+    DmaPeripheralDataSize, DmaMemoryDataSize, DmaDoubleBuffer, DmaHalf, DMA1_CHANNEL1, DMA1_CHANNEL2, DMA1_CHANNEL3, DMA1_CHANNEL4,
+    DMA1_CHANNEL5, DMA1_CHANNEL6, DMA1_CHANNEL7,
+};
 
 /// 定时器枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -43,6 +52,26 @@ pub enum PwmPolarity {
     Low,    // 有效电平为低电平
 }
 
+/// 定时器主模式枚举（CR2.MMS，选择TRGO输出源）
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum TimerMasterMode {
+    Reset = 0,         // UG位作为TRGO
+    Enable = 1,        // 计数器使能作为TRGO
+    Update = 2,        // 更新事件作为TRGO
+    ComparePulse = 3,  // 捕获/比较脉冲作为TRGO
+    Oc1Ref = 4,        // OC1REF作为TRGO
+    Oc2Ref = 5,        // OC2REF作为TRGO
+    Oc3Ref = 6,        // OC3REF作为TRGO
+    Oc4Ref = 7,        // OC4REF作为TRGO
+}
+
+/// 定时器DMA请求源（DIER.UDE/CCxDE）
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum TimerDmaRequest {
+    Update,               // 更新事件
+    Compare(PwmChannel),  // 捕获/比较事件
+}
+
 /// 定时器结构体
 pub struct Timer {
     number: TimerNumber,
@@ -67,6 +96,35 @@ impl TimerNumber {
         }
     }
     
+    /// 获取定时器DMA请求对应的DMA1通道
+    /// 
+    /// # Returns
+    /// 该请求没有连接到DMA时（TIM3_CH2、TIM4_CH4）返回`None`
+    pub const fn dma_channel(&self, request: TimerDmaRequest) -> Option<Dma> {
+        match (self, request) {
+            (TimerNumber::TIM1, TimerDmaRequest::Update) => Some(DMA1_CHANNEL5),
+            (TimerNumber::TIM1, TimerDmaRequest::Compare(PwmChannel::Channel1)) => Some(DMA1_CHANNEL2),
+            (TimerNumber::TIM1, TimerDmaRequest::Compare(PwmChannel::Channel2)) => Some(DMA1_CHANNEL3),
+            (TimerNumber::TIM1, TimerDmaRequest::Compare(PwmChannel::Channel3)) => Some(DMA1_CHANNEL6),
+            (TimerNumber::TIM1, TimerDmaRequest::Compare(PwmChannel::Channel4)) => Some(DMA1_CHANNEL4),
+            (TimerNumber::TIM2, TimerDmaRequest::Update) => Some(DMA1_CHANNEL2),
+            (TimerNumber::TIM2, TimerDmaRequest::Compare(PwmChannel::Channel1)) => Some(DMA1_CHANNEL5),
+            (TimerNumber::TIM2, TimerDmaRequest::Compare(PwmChannel::Channel2)) => Some(DMA1_CHANNEL7),
+            (TimerNumber::TIM2, TimerDmaRequest::Compare(PwmChannel::Channel3)) => Some(DMA1_CHANNEL1),
+            (TimerNumber::TIM2, TimerDmaRequest::Compare(PwmChannel::Channel4)) => Some(DMA1_CHANNEL7),
+            (TimerNumber::TIM3, TimerDmaRequest::Update) => Some(DMA1_CHANNEL3),
+            (TimerNumber::TIM3, TimerDmaRequest::Compare(PwmChannel::Channel1)) => Some(DMA1_CHANNEL6),
+            (TimerNumber::TIM3, TimerDmaRequest::Compare(PwmChannel::Channel2)) => None,
+            (TimerNumber::TIM3, TimerDmaRequest::Compare(PwmChannel::Channel3)) => Some(DMA1_CHANNEL2),
+            (TimerNumber::TIM3, TimerDmaRequest::Compare(PwmChannel::Channel4)) => Some(DMA1_CHANNEL3),
+            (TimerNumber::TIM4, TimerDmaRequest::Update) => Some(DMA1_CHANNEL7),
+            (TimerNumber::TIM4, TimerDmaRequest::Compare(PwmChannel::Channel1)) => Some(DMA1_CHANNEL1),
+            (TimerNumber::TIM4, TimerDmaRequest::Compare(PwmChannel::Channel2)) => Some(DMA1_CHANNEL4),
+            (TimerNumber::TIM4, TimerDmaRequest::Compare(PwmChannel::Channel3)) => Some(DMA1_CHANNEL5),
+            (TimerNumber::TIM4, TimerDmaRequest::Compare(PwmChannel::Channel4)) => None,
+        }
+    }
+    
     /// 获取定时器基地址
     pub const fn get_base_address(&self) -> usize {
         match self {
@@ -78,6 +136,78 @@ impl TimerNumber {
     }
 }
 
+/// 定时器寄存器偏移地址
+const TIM_CR1_OFFSET: usize = 0x00;
+const TIM_SR_OFFSET: usize = 0x10;
+const TIM_EGR_OFFSET: usize = 0x14;
+const TIM_PSC_OFFSET: usize = 0x28;
+const TIM_ARR_OFFSET: usize = 0x2C;
+/// CR1计数器使能位
+const TIM_CR1_CEN: u32 = 1 << 0;
+/// CR1自动重装载预装载使能位
+const TIM_CR1_ARPE: u32 = 1 << 7;
+/// EGR更新事件产生位
+const TIM_EGR_UG: u32 = 1 << 0;
+
+/// 定时器初始化映像：预先计算好的时基寄存器值
+/// 
+/// 用`const`定义时在编译期求值，`Timer::init_with_image`每个寄存器只写一次：
+/// 
+/// ```ignore
+/// // 72MHz定时器时钟，1kHz更新
+/// const TICK: TimerInitImage = match TimerInitImage::from_frequency(72_000_000, 1000) {
+///     Some(image) => image,
+///     None => panic!("频率超出定时器范围"),
+/// };
+/// 
+/// TIMER2.init_with_image(&TICK);
+/// ```
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct TimerInitImage {
+    /// CR1（CEN位被忽略，初始化后由`start`启动）
+    pub cr1: u32,
+    pub psc: u16,
+    pub arr: u16,
+}
+
+impl TimerInitImage {
+    /// 按预分频值和自动重装载值创建映像，向上计数，不使能ARR预装载
+    pub const fn new(prescaler: u16, period: u16) -> Self {
+        Self { cr1: 0, psc: prescaler, arr: period }
+    }
+    
+    /// 按更新频率计算映像，规则同`Timer::prescaler_period_for`
+    /// 
+    /// # Arguments
+    /// * `timer_clock` - 定时器计数时钟（Hz）
+    /// * `frequency` - 期望的更新事件频率（Hz）
+    /// 
+    /// # Returns
+    /// 频率为0或超出定时器范围返回`None`
+    pub const fn from_frequency(timer_clock: u32, frequency: u32) -> Option<Self> {
+        if frequency == 0 {
+            return None;
+        }
+        let ticks = timer_clock / frequency;
+        // ARR=0时计数器不再产生更新事件，最少需要2个计数
+        if ticks < 2 {
+            return None;
+        }
+        let prescaler = (ticks - 1) / 0x1_0000;
+        if prescaler > 0xFFFF {
+            return None;
+        }
+        let period = ticks / (prescaler + 1) - 1;
+        Some(Self::new(prescaler as u16, period as u16))
+    }
+    
+    /// 使能ARR预装载（ARPE），运行中修改周期时在下一个更新事件生效
+    pub const fn with_auto_reload_preload(mut self) -> Self {
+        self.cr1 |= TIM_CR1_ARPE;
+        self
+    }
+}
+
 /// APB总线枚举
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum ApbBus {
@@ -102,6 +232,11 @@ impl Timer {
         }
     }
     
+    /// 获取定时器编号
+    pub const fn number(&self) -> TimerNumber {
+        self.number
+    }
+    
     /// 获取TIM1寄存器块
     unsafe fn get_tim1(&self) -> &'static mut tim1::RegisterBlock {
         &mut *(TimerNumber::TIM1.get_base_address() as *mut tim1::RegisterBlock)
@@ -143,7 +278,7 @@ impl Timer {
     }
     
     /// 获取定时器时钟频率
-    unsafe fn get_timer_clock(&self) -> u32 {
+    pub unsafe fn get_timer_clock(&self) -> u32 {
         // 使用RCC驱动获取时钟频率
         let rcc_driver = RccDriver::new();
         let clocks = rcc_driver.get_clocks_freq();
@@ -170,58 +305,212 @@ impl Timer {
         }
     }
     
+    /// 计算指定更新频率所需的预分频器值和自动重装载值
+    /// 
+    /// 优先使用最小的预分频器，以获得最高的周期分辨率。
+    /// 
+    /// # Arguments
+    /// * `frequency` - 期望的更新事件频率（Hz）
+    /// 
+    /// # Returns
+    /// 成功返回`(prescaler, period)`，频率为0或超出定时器范围（包括高于计数时钟的一半）返回`None`
+    pub unsafe fn prescaler_period_for(&self, frequency: u32) -> Option<(u16, u16)> {
+        TimerInitImage::from_frequency(self.get_timer_clock(), frequency).map(|image| (image.psc, image.arr))
+    }
+    
+    /// 按总线频率计算定时器计数时钟
+    /// 
+    /// APB预分频系数为1时定时器时钟等于PCLK，否则为PCLK的2倍
+    fn timer_clock_from(&self, clocks: &SystemClocks) -> u32 {
+        let pclk = match self.number {
+            TimerNumber::TIM1 => clocks.pclk2,
+            TimerNumber::TIM2 | TimerNumber::TIM3 | TimerNumber::TIM4 => clocks.pclk1,
+        };
+        if pclk == clocks.hclk { pclk } else { pclk * 2 }
+    }
+    
+    /// 时钟切换后调整预分频，保持计数频率和更新周期不变
+    /// 
+    /// 优先只修改PSC，ARR和各通道CCR（PWM占空比）保持原值；PSC不能精确换算时
+    /// （例如由72MHz降到8MHz而PSC为0），取最接近的PSC再按剩余比例缩放ARR和CCR。
+    /// PSC在下一个更新事件生效，不会打断当前周期。
+    /// 
+    /// # Arguments
+    /// * `old` - 切换前的时钟频率
+    /// * `new` - 切换后的时钟频率
+    /// 
+    /// # Safety
+    /// 直接访问硬件寄存器
+    pub unsafe fn retime(&self, old: &SystemClocks, new: &SystemClocks) {
+        let old_clock = self.timer_clock_from(old) as u64;
+        let new_clock = self.timer_clock_from(new) as u64;
+        if old_clock == 0 || old_clock == new_clock {
+            return;
+        }
+        
+        let psc = core::ptr::read_volatile(self.register(0x28)) as u64 + 1;
+        let scaled = psc * new_clock;
+        let exact = scaled / old_clock;
+        if scaled % old_clock == 0 && exact >= 1 && exact <= 0x1_0000 {
+            core::ptr::write_volatile(self.register(0x28), (exact - 1) as u32);
+            return;
+        }
+        
+        let new_psc = ((scaled + old_clock / 2) / old_clock).clamp(1, 0x1_0000);
+        let arr = core::ptr::read_volatile(self.register(0x2C)) as u64 + 1;
+        let new_arr = (arr * scaled / (new_psc * old_clock)).clamp(1, 0x1_0000);
+        core::ptr::write_volatile(self.register(0x28), (new_psc - 1) as u32);
+        core::ptr::write_volatile(self.register(0x2C), (new_arr - 1) as u32);
+        for channel in 0..4 {
+            let ccr = self.register(0x34 + 4 * channel);
+            let value = core::ptr::read_volatile(ccr) as u64;
+            core::ptr::write_volatile(ccr, (value * new_arr / arr).min(0xFFFF) as u32);
+        }
+    }
+    
+    /// 设置主模式，选择TRGO输出源（用于触发ADC/DAC或级联其他定时器）
+    /// 
+    /// # Arguments
+    /// * `mode` - 主模式
+    pub unsafe fn set_master_mode(&self, mode: TimerMasterMode) {
+        let mms = (mode as u32) << 4;
+        match self.number {
+            TimerNumber::TIM1 => { self.get_tim1().cr2().modify(|r, w| w.bits((r.bits() & !(0x7 << 4)) | mms)); },
+            TimerNumber::TIM2 => { self.get_tim2().cr2().modify(|r, w| w.bits((r.bits() & !(0x7 << 4)) | mms)); },
+            TimerNumber::TIM3 => { self.get_tim3().cr2().modify(|r, w| w.bits((r.bits() & !(0x7 << 4)) | mms)); },
+            TimerNumber::TIM4 => { self.get_tim4().cr2().modify(|r, w| w.bits((r.bits() & !(0x7 << 4)) | mms)); },
+        }
+    }
+    
+    /// 获取定时器寄存器指针
+    #[inline(always)]
+    fn register(&self, offset: usize) -> *mut u32 {
+        (self.number.get_base_address() + offset) as *mut u32
+    }
+    
+    /// DMA请求在DIER中的使能位
+    const fn dma_request_bit(request: TimerDmaRequest) -> u32 {
+        match request {
+            TimerDmaRequest::Update => 1 << 8,
+            TimerDmaRequest::Compare(PwmChannel::Channel1) => 1 << 9,
+            TimerDmaRequest::Compare(PwmChannel::Channel2) => 1 << 10,
+            TimerDmaRequest::Compare(PwmChannel::Channel3) => 1 << 11,
+            TimerDmaRequest::Compare(PwmChannel::Channel4) => 1 << 12,
+        }
+    }
+    
+    /// 使能DMA请求（DIER.UDE/CCxDE）
+    pub unsafe fn enable_dma_request(&self, request: TimerDmaRequest) {
+        let dier = self.register(0x0C);
+        core::ptr::write_volatile(dier, core::ptr::read_volatile(dier) | Self::dma_request_bit(request));
+    }
+    
+    /// 禁用DMA请求
+    pub unsafe fn disable_dma_request(&self, request: TimerDmaRequest) {
+        let dier = self.register(0x0C);
+        core::ptr::write_volatile(dier, core::ptr::read_volatile(dier) & !Self::dma_request_bit(request));
+    }
+    
+    /// 直接设置比较寄存器CCRx（不修改通道模式）
+    pub unsafe fn set_compare(&self, channel: PwmChannel, value: u16) {
+        let offset = 0x34 + 4 * channel as usize;
+        core::ptr::write_volatile(self.register(offset), value as u32);
+    }
+    
+    /// 通过DMA突发传输在每个更新事件批量写入CCR
+    /// 
+    /// 配置DCR使DMAR在每次更新事件时依次映射到`first`开始的`channels`个CCR，
+    /// DMA每个更新事件搬运一帧（`channels`个占空比值），整个过程不需要中断。
+    /// 通道需预先用`init_pwm`配置（已使能CCR预加载），因此第k帧在第k+1个周期生效。
+    /// 
+    /// 循环模式下可以利用传输句柄的半传输/传输完成标志刷新不在输出中的一半数据。
+    /// TIM1的更新DMA请求与USART1接收共用DMA1通道5。
+    /// 
+    /// # Arguments
+    /// * `first` - 第一个要更新的通道
+    /// * `channels` - 每帧更新的通道数（1~4，且不超过`first`之后的通道数）
+    /// * `duties` - 按帧交错排列的占空比数组，长度必须是`channels`的整数倍
+    /// * `circular` - 是否循环输出
+    /// 
+    /// # Returns
+    /// 成功返回DMA传输句柄，参数无效返回`DmaError::InvalidLength`
+    /// 
+    /// # Safety
+    /// - `duties`在传输结束前必须保持有效
+    /// - 调用者必须保证对应的DMA1通道没有被其他代码使用
+    pub unsafe fn start_pwm_burst(
+        &self,
+        first: PwmChannel,
+        channels: u8,
+        duties: &[u16],
+        circular: bool,
+    ) -> Result<DmaTransfer, DmaError> {
+        let first_index = first as u8;
+        if channels == 0 || first_index + channels > 4 {
+            return Err(DmaError::InvalidLength);
+        }
+        if duties.is_empty() || duties.len() > 0xFFFF || duties.len() % channels as usize != 0 {
+            return Err(DmaError::InvalidLength);
+        }
+        let dma = match self.number.dma_channel(TimerDmaRequest::Update) {
+            Some(dma) => dma,
+            None => return Err(DmaError::Busy),
+        };
+        
+        self.stop_pwm_burst();
+        
+        // DBA：CCR1相对CR1的字偏移为13；DBL：突发长度-1
+        let dba = (0x34 / 4) + first_index as u32;
+        let dbl = (channels as u32 - 1) << 8;
+        core::ptr::write_volatile(self.register(0x48), dbl | dba);
+        
+        let mut desc = DmaTransferDescriptor::memory_to_peripheral(
+            duties.as_ptr() as u32,
+            (self.number.get_base_address() + 0x4C) as u32, // DMAR
+            duties.len() as u16,
+        )
+        .with_data_size(DmaPeripheralDataSize::HalfWord, DmaMemoryDataSize::HalfWord)
+        .with_priority(DmaChannelPriority::High);
+        if circular {
+            desc = desc.with_circular();
+        }
+        
+        let transfer = dma.start(&desc)?;
+        self.enable_dma_request(TimerDmaRequest::Update);
+        Ok(transfer)
+    }
+    
+    /// 停止DMA突发更新（CCR保持最后写入的值）
+    pub unsafe fn stop_pwm_burst(&self) {
+        self.disable_dma_request(TimerDmaRequest::Update);
+        if let Some(dma) = self.number.dma_channel(TimerDmaRequest::Update) {
+            dma.disable();
+            dma.clear_all_interrupts();
+        }
+    }
+    
     /// 初始化定时器
     /// 
     /// # 参数
     /// * `prescaler` - 预分频器值（0-65535）
     /// * `period` - 自动重装载值（0-65535）
     pub unsafe fn init(&self, prescaler: u16, period: u16) {
-        // 参数有效性验证
-        assert!(prescaler > 0 || prescaler == 0, "Prescaler value is valid");
-        assert!(period > 0 || period == 0, "Period value is valid");
-        
-        // 1. 启用定时器时钟
+        self.init_with_image(&TimerInitImage::new(prescaler, period));
+    }
+    
+    /// 按预先计算的初始化映像初始化定时器
+    /// 
+    /// 依次写入CR1（CEN为0）、PSC、ARR，再用UG事件把预分频值装入影子寄存器并清零计数器，
+    /// 最后清除UG产生的更新标志，每个寄存器只写一次
+    pub unsafe fn init_with_image(&self, image: &TimerInitImage) {
         self.enable_clock();
         
-        // 2. 配置定时器
-        match self.number {
-            TimerNumber::TIM1 => {
-                let tim = self.get_tim1();
-                tim.cr1().write(|w| w.cen().clear_bit());  // 禁用定时器
-                tim.psc().write(|w| w.psc().bits(prescaler));  // 预分频器
-                tim.arr().write(|w| w.arr().bits(period));  // 自动重装载值
-                tim.cnt().write(|w| w.cnt().bits(0));  // 清零计数器
-                tim.egr().write(|w| w.ug().set_bit());  // 生成更新事件
-                tim.sr().write(|w| w.uif().clear_bit());  // 清除更新中断标志
-            },
-            TimerNumber::TIM2 => {
-                let tim = self.get_tim2();
-                tim.cr1().write(|w| w.cen().clear_bit());  // 禁用定时器
-                tim.psc().write(|w| w.psc().bits(prescaler));  // 预分频器
-                tim.arr().write(|w| w.arr().bits(period));  // 自动重装载值
-                tim.cnt().write(|w| w.cnt().bits(0));  // 清零计数器
-                tim.egr().write(|w| w.ug().set_bit());  // 生成更新事件
-                tim.sr().write(|w| w.uif().clear_bit());  // 清除更新中断标志
-            },
-            TimerNumber::TIM3 => {
-                let tim = self.get_tim3();
-                tim.cr1().write(|w| w.cen().clear_bit());  // 禁用定时器
-                tim.psc().write(|w| w.psc().bits(prescaler));  // 预分频器
-                tim.arr().write(|w| w.arr().bits(period));  // 自动重装载值
-                tim.cnt().write(|w| w.cnt().bits(0));  // 清零计数器
-                tim.egr().write(|w| w.ug().set_bit());  // 生成更新事件
-                tim.sr().write(|w| w.uif().clear_bit());  // 清除更新中断标志
-            },
-            TimerNumber::TIM4 => {
-                let tim = self.get_tim4();
-                tim.cr1().write(|w| w.cen().clear_bit());  // 禁用定时器
-                tim.psc().write(|w| w.psc().bits(prescaler));  // 预分频器
-                tim.arr().write(|w| w.arr().bits(period));  // 自动重装载值
-                tim.cnt().write(|w| w.cnt().bits(0));  // 清零计数器
-                tim.egr().write(|w| w.ug().set_bit());  // 生成更新事件
-                tim.sr().write(|w| w.uif().clear_bit());  // 清除更新中断标志
-            },
-        }
+        let base = self.number.get_base_address();
+        reg::write(base + TIM_CR1_OFFSET, image.cr1 & !TIM_CR1_CEN);
+        reg::write(base + TIM_PSC_OFFSET, image.psc as u32);
+        reg::write(base + TIM_ARR_OFFSET, image.arr as u32);
+        reg::write(base + TIM_EGR_OFFSET, TIM_EGR_UG);
+        reg::write(base + TIM_SR_OFFSET, 0);
     }
     
     /// 启动定时器
@@ -1214,7 +1503,7 @@ impl Timer {
             },
         }
     }
-    
+
 
 }
 
@@ -1223,3 +1512,932 @@ pub const TIM1: Timer = Timer::new(TimerNumber::TIM1);
 pub const TIM2: Timer = Timer::new(TimerNumber::TIM2);
 pub const TIM3: Timer = Timer::new(TimerNumber::TIM3);
 pub const TIM4: Timer = Timer::new(TimerNumber::TIM4);
+
+/// 输入捕获错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CaptureError {
+    /// 最低频率为0或低于定时器可测范围
+    InvalidRate,
+    /// 输入滤波参数超出0~15
+    InvalidFilter,
+    /// DMA错误
+    Dma(DmaError),
+}
+
+impl From<DmaError> for CaptureError {
+    fn from(error: DmaError) -> Self {
+        CaptureError::Dma(error)
+    }
+}
+
+/// 输入捕获双缓冲区
+/// 
+/// PWM输入模式下每个上升沿由DMA突发读出一对`(周期, 高电平时间)`，
+/// 建立在`DmaDoubleBuffer`之上，以循环模式写满整个缓冲区，前一半和后一半各为一个数据块，
+/// 只在半传输/传输完成时产生中断，而不是每个边沿一次。
+/// `N`为16位字的总数，必须是4的倍数（每个半区包含整数对）且不超过65535。
+pub struct CaptureBuffer<const N: usize> {
+    inner: DmaDoubleBuffer<u16, N>,
+    /// 计数器溢出（两个上升沿间隔超过65536个计数）的次数
+    stalls: AtomicU32,
+}
+
+impl<const N: usize> CaptureBuffer<N> {
+    /// 编译期检查缓冲区大小
+    const SIZE_CHECK: () = assert!(N % 4 == 0, "CaptureBuffer大小必须是4的倍数");
+    
+    /// 每个数据块的捕获对数
+    pub const BLOCK_PAIRS: usize = N / 4;
+    
+    /// 创建新的捕获缓冲区
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            inner: DmaDoubleBuffer::new(0),
+            stalls: AtomicU32::new(0),
+        }
+    }
+    
+    /// 复位状态（必须在DMA停止时调用）
+    unsafe fn reset(&self) {
+        self.stalls.store(0, Ordering::Relaxed);
+        self.inner.reset();
+    }
+    
+    /// 取出下一个已完成的数据块（零拷贝）
+    /// 
+    /// 同一时刻只能持有一个数据块，上一个尚未丢弃时返回`None`
+    pub fn take_block(&self) -> Option<CaptureBlock<'_>> {
+        let words = self.inner.take()?;
+        Some(CaptureBlock {
+            words,
+        })
+    }
+    
+    /// 获取溢出次数（数据块未及时释放而被DMA覆盖，或DMA传输错误）
+    pub fn overruns(&self) -> u32 {
+        self.inner.lags()
+    }
+    
+    /// 获取计数器溢出次数
+    /// 
+    /// 非零说明信号停止或频率低于启动时给定的最低频率，期间的周期值不可信。
+    pub fn stalls(&self) -> u32 {
+        self.stalls.load(Ordering::Relaxed)
+    }
+}
+
+/// 一个数据块的统计结果
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub struct CaptureStats {
+    /// 统计的周期个数
+    pub count: u32,
+    /// 周期之和（计数值）
+    pub period_sum: u32,
+    /// 高电平时间之和（计数值）
+    pub high_sum: u32,
+    /// 最短周期
+    pub min_period: u16,
+    /// 最长周期
+    pub max_period: u16,
+}
+
+impl CaptureStats {
+    /// 平均周期（计数值）
+    pub fn mean_period(&self) -> u32 {
+        if self.count == 0 { 0 } else { self.period_sum / self.count }
+    }
+    
+    /// 平均频率（Hz），周期之和整体相除，不受单个周期量化误差累积的影响
+    /// 
+    /// # Arguments
+    /// * `tick_hz` - 计数频率，见`InputCapture::tick_hz`
+    pub fn frequency_hz(&self, tick_hz: u32) -> u32 {
+        if self.period_sum == 0 {
+            0
+        } else {
+            ((tick_hz as u64 * self.count as u64) / self.period_sum as u64) as u32
+        }
+    }
+    
+    /// 平均占空比（千分比）
+    pub fn duty_permille(&self) -> u16 {
+        if self.period_sum == 0 {
+            0
+        } else {
+            ((self.high_sum as u64 * 1000) / self.period_sum as u64) as u16
+        }
+    }
+}
+
+/// 已完成的输入捕获数据块
+/// 
+/// 借用捕获缓冲区的一个半区，drop时自动释放给DMA。
+pub struct CaptureBlock<'a> {
+    words: DmaHalf<'a, u16>,
+}
+
+impl<'a> CaptureBlock<'a> {
+    /// 获取块中的捕获对数
+    pub fn len(&self) -> usize {
+        self.words.len() / 2
+    }
+    
+    /// 迭代`(周期, 高电平时间)`，单位为计数值
+    pub fn pairs(&self) -> impl Iterator<Item = (u16, u16)> + '_ {
+        self.words.chunks_exact(2).map(|pair| (pair[0], pair[1]))
+    }
+    
+    /// 把周期累加到32位时间戳上，迭代每个上升沿的扩展时间
+    /// 
+    /// # Arguments
+    /// * `start` - 上一个数据块最后一个上升沿的时间戳，连续调用可得到单调的32位时间轴
+    pub fn timestamps(&self, start: u32) -> impl Iterator<Item = u32> + '_ {
+        self.pairs().scan(start, |time, (period, _)| {
+            *time = time.wrapping_add(period as u32);
+            Some(*time)
+        })
+    }
+    
+    /// 统计整个数据块的周期和占空比
+    pub fn stats(&self) -> CaptureStats {
+        let mut stats = CaptureStats {
+            min_period: u16::MAX,
+            ..CaptureStats::default()
+        };
+        for (period, high) in self.pairs() {
+            stats.count += 1;
+            stats.period_sum = stats.period_sum.wrapping_add(period as u32);
+            stats.high_sum = stats.high_sum.wrapping_add(high as u32);
+            stats.min_period = stats.min_period.min(period);
+            stats.max_period = stats.max_period.max(period);
+        }
+        if stats.count == 0 {
+            stats.min_period = 0;
+        }
+        stats
+    }
+}
+
+/// PWM输入模式的频率/脉宽测量
+/// 
+/// 输入信号接通道1（TIM1:PA8，TIM2:PA0，TIM3:PA6，TIM4:PB6，需配置为浮空输入）：
+/// - IC1在上升沿捕获周期，IC2映射到同一引脚在下降沿捕获高电平时间
+/// - 从模式为复位模式，每个上升沿清零计数器，CCR1/CCR2直接就是周期和脉宽
+/// - CC1的DMA请求配合DMA突发（DCR/DMAR）在每个上升沿把CCR1、CCR2写入环形缓冲区
+/// 
+/// 计数器按32位时间轴扩展：块内周期逐个累加（见`CaptureBlock::timestamps`），
+/// 只要单个周期不超过65536个计数就不会丢失溢出；URS=1使更新中断只在真正的计数器溢出
+/// （信号过慢或停止）时产生，由`handle_update_interrupt`记为一次停顿。
+/// 
+/// 需要在CC1对应的DMA1通道中断中调用`handle_dma_interrupt`，在定时器更新中断中调用
+/// `handle_update_interrupt`，并在NVIC中使能这两个中断。
+pub struct InputCapture<const N: usize> {
+    timer: TimerNumber,
+    buffer: &'static CaptureBuffer<N>,
+}
+
+impl<const N: usize> InputCapture<N> {
+    /// 创建新的输入捕获
+    pub const fn new(timer: TimerNumber, buffer: &'static CaptureBuffer<N>) -> Self {
+        Self {
+            timer,
+            buffer,
+        }
+    }
+    
+    /// 获取捕获缓冲区
+    pub fn buffer(&self) -> &'static CaptureBuffer<N> {
+        self.buffer
+    }
+    
+    /// 获取CC1请求对应的DMA通道（TIM1~TIM4均有连接）
+    fn dma(&self) -> Dma {
+        match self.timer.dma_channel(TimerDmaRequest::Compare(PwmChannel::Channel1)) {
+            Some(dma) => dma,
+            None => unreachable!(),
+        }
+    }
+    
+    /// 计数频率（Hz），周期和脉宽的单位为`1 / tick_hz`秒
+    pub unsafe fn tick_hz(&self) -> u32 {
+        let timer = Timer::new(self.timer);
+        let psc = core::ptr::read_volatile(timer.register(0x28)) + 1;
+        timer.get_timer_clock() / psc
+    }
+    
+    /// 启动测量
+    /// 
+    /// 选择能容纳`min_frequency_hz`一个周期的最小预分频器，以获得最高分辨率。
+    /// 
+    /// # Arguments
+    /// * `min_frequency_hz` - 需要测量的最低信号频率
+    /// * `filter` - 输入滤波器ICxF（0~15，0为不滤波）
+    /// 
+    /// # Safety
+    /// 会重新配置定时器和CC1对应的DMA1通道，调用者必须保证它们没有被其他代码使用
+    pub unsafe fn start(&self, min_frequency_hz: u32, filter: u8) -> Result<(), CaptureError> {
+        if filter > 15 {
+            return Err(CaptureError::InvalidFilter);
+        }
+        if min_frequency_hz == 0 {
+            return Err(CaptureError::InvalidRate);
+        }
+        
+        self.stop();
+        self.buffer.reset();
+        
+        let timer = Timer::new(self.timer);
+        let ticks = timer.get_timer_clock() / min_frequency_hz;
+        let prescaler = ticks / 0x1_0000;
+        if prescaler > 0xFFFF {
+            return Err(CaptureError::InvalidRate);
+        }
+        timer.init(prescaler as u16, 0xFFFF);
+        
+        // CCMR1：CC1S=01（IC1映射TI1），CC2S=10（IC2映射TI1），两路使用相同滤波
+        let f = filter as u32;
+        core::ptr::write_volatile(timer.register(0x18), (f << 12) | (0b10 << 8) | (f << 4) | 0b01);
+        // CCER：CC1上升沿，CC2下降沿
+        core::ptr::write_volatile(timer.register(0x20), (1 << 4) | (1 << 5) | (1 << 0));
+        // SMCR：TS=101（TI1FP1），SMS=100（复位模式）
+        core::ptr::write_volatile(timer.register(0x08), (0b101 << 4) | 0b100);
+        // CR1.URS：复位模式的清零不产生更新中断，只有溢出才产生
+        let cr1 = timer.register(0x00);
+        core::ptr::write_volatile(cr1, core::ptr::read_volatile(cr1) | (1 << 2));
+        // DCR：从CCR1开始突发2个寄存器
+        core::ptr::write_volatile(timer.register(0x48), (1 << 8) | (0x34 / 4));
+        
+        let desc = self.buffer.inner
+            .peripheral_to_memory((self.timer.get_base_address() + 0x4C) as u32) // DMAR
+            .with_data_size(DmaPeripheralDataSize::HalfWord, DmaMemoryDataSize::HalfWord)
+            .with_priority(DmaChannelPriority::High);
+        self.dma().start_circular(&desc)?;
+        
+        timer.enable_dma_request(TimerDmaRequest::Compare(PwmChannel::Channel1));
+        timer.clear_update();
+        timer.enable_update_interrupt();
+        timer.start();
+        Ok(())
+    }
+    
+    /// 停止测量
+    pub unsafe fn stop(&self) {
+        let timer = Timer::new(self.timer);
+        timer.stop();
+        timer.disable_update_interrupt();
+        timer.disable_dma_request(TimerDmaRequest::Compare(PwmChannel::Channel1));
+        // 退出从模式并关闭捕获通道
+        core::ptr::write_volatile(timer.register(0x08), 0);
+        core::ptr::write_volatile(timer.register(0x20), 0);
+        
+        let dma = self.dma();
+        dma.disable();
+        dma.clear_all_interrupts();
+    }
+    
+    /// 处理CC1对应的DMA通道中断：半传输发布前一半，传输完成发布后一半
+    pub fn handle_dma_interrupt(&self) {
+        self.buffer.inner.handle_dma_interrupt(self.dma());
+    }
+    
+    /// 处理定时器更新中断（计数器溢出，即信号过慢或停止）
+    pub fn handle_update_interrupt(&self) {
+        unsafe {
+            let timer = Timer::new(self.timer);
+            if timer.has_update() {
+                timer.clear_update();
+                self.buffer.stalls.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+    
+    /// 立即读取最近一个完整周期（不经过DMA缓冲区）
+    /// 
+    /// # Returns
+    /// `(周期, 高电平时间)`，单位为计数值
+    pub unsafe fn latest(&self) -> (u16, u16) {
+        let timer = Timer::new(self.timer);
+        let period = core::ptr::read_volatile(timer.register(0x34)) as u16;
+        let high = core::ptr::read_volatile(timer.register(0x38)) as u16;
+        (period, high)
+    }
+    
+    /// 取出下一个已完成的数据块
+    pub fn take_block(&self) -> Option<CaptureBlock<'static>> {
+        self.buffer.take_block()
+    }
+}
+
+/// 编码器计数模式（SMCR.SMS）
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum EncoderMode {
+    Ti1 = 1,   // 只在TI1边沿计数（x2）
+    Ti2 = 2,   // 只在TI2边沿计数（x2）
+    Both = 3,  // 在TI1和TI2边沿都计数（x4）
+}
+
+/// 正交编码器接口
+/// 
+/// 定时器工作在编码器模式，由硬件完成A/B相解码和计数，CPU只在16位计数器
+/// 回绕时进入一次更新中断，把回绕次数累加到高位，得到64位位置。
+/// 
+/// A相接通道1、B相接通道2（TIM1:PA8/PA9，TIM2:PA0/PA1，TIM3:PA6/PA7，TIM4:PB6/PB7），
+/// 需配置为浮空或上拉输入。需要在定时器更新中断中调用`handle_update_interrupt`，
+/// 并在NVIC中使能该中断；通常声明为`static`。
+pub struct QuadratureEncoder {
+    timer: TimerNumber,
+    /// 计数器回绕次数（上溢加1，下溢减1）
+    wraps: AtomicI32,
+}
+
+impl QuadratureEncoder {
+    /// 创建新的编码器接口
+    pub const fn new(timer: TimerNumber) -> Self {
+        Self {
+            timer,
+            wraps: AtomicI32::new(0),
+        }
+    }
+    
+    /// 启动编码器计数，位置清零
+    /// 
+    /// # Arguments
+    /// * `mode` - 计数模式，`Both`为x4解码
+    /// * `filter` - 输入滤波器ICxF（0~15），高速编码器取较小值
+    /// * `invert` - 是否反转计数方向（反转TI1极性）
+    /// 
+    /// # Safety
+    /// 会重新配置定时器，调用者必须保证它没有被其他代码使用
+    pub unsafe fn start(&self, mode: EncoderMode, filter: u8, invert: bool) {
+        let timer = Timer::new(self.timer);
+        timer.stop();
+        timer.init(0, 0xFFFF);
+        
+        // CCMR1：CC1S=01（IC1映射TI1），CC2S=01（IC2映射TI2），相同滤波
+        let f = (filter & 0x0F) as u32;
+        core::ptr::write_volatile(timer.register(0x18), (f << 12) | (0b01 << 8) | (f << 4) | 0b01);
+        // CCER：使能两路捕获，CC1P反转方向
+        let polarity = if invert { 1 << 1 } else { 0 };
+        core::ptr::write_volatile(timer.register(0x20), (1 << 4) | (1 << 0) | polarity);
+        // SMCR：编码器模式
+        core::ptr::write_volatile(timer.register(0x08), mode as u32);
+        // CR1.URS：只有计数器上溢/下溢产生更新中断
+        let cr1 = timer.register(0x00);
+        core::ptr::write_volatile(cr1, core::ptr::read_volatile(cr1) | (1 << 2));
+        
+        self.wraps.store(0, Ordering::Relaxed);
+        timer.set_count(0);
+        timer.clear_update();
+        timer.enable_update_interrupt();
+        timer.start();
+    }
+    
+    /// 停止计数（位置保持）
+    pub unsafe fn stop(&self) {
+        let timer = Timer::new(self.timer);
+        timer.stop();
+        timer.disable_update_interrupt();
+    }
+    
+    /// 根据回绕后的计数值判断回绕方向
+    /// 
+    /// 回绕刚发生时计数值必然靠近0（上溢）或靠近0xFFFF（下溢），
+    /// 用计数值所在的半区判断比读取DIR位可靠：中断延迟期间即使方向反转也不会判错。
+    #[inline(always)]
+    fn wrap_direction(count: u16) -> i32 {
+        if count < 0x8000 { 1 } else { -1 }
+    }
+    
+    /// 处理定时器更新中断（计数器回绕）
+    pub fn handle_update_interrupt(&self) {
+        unsafe {
+            let timer = Timer::new(self.timer);
+            if timer.has_update() {
+                timer.clear_update();
+                let count = timer.get_count();
+                self.wraps.fetch_add(Self::wrap_direction(count), Ordering::Relaxed);
+            }
+        }
+    }
+    
+    /// 获取16位原始计数值
+    pub unsafe fn count(&self) -> u16 {
+        Timer::new(self.timer).get_count()
+    }
+    
+    /// 获取64位扩展位置
+    /// 
+    /// 在临界区内同时读取回绕次数和计数值；若回绕已发生但中断尚未处理，
+    /// 在此补偿，保证读数单调一致。
+    pub fn position(&self) -> i64 {
+        cortex_m::interrupt::free(|_| unsafe {
+            let timer = Timer::new(self.timer);
+            // 先读UIF再读CNT，UIF在两次读取之间置位时重读CNT，
+            // 保证计数值与回绕标志属于同一侧，不会差一个整周期
+            let mut pending = timer.has_update();
+            let mut count = timer.get_count();
+            if !pending && timer.has_update() {
+                pending = true;
+                count = timer.get_count();
+            }
+            let mut wraps = self.wraps.load(Ordering::Relaxed);
+            if pending {
+                wraps = wraps.wrapping_add(Self::wrap_direction(count));
+            }
+            ((wraps as i64) << 16) | count as i64
+        })
+    }
+    
+    /// 获取32位位置（按二进制补码回绕）
+    pub fn position32(&self) -> i32 {
+        self.position() as i32
+    }
+    
+    /// 设置当前位置
+    pub fn set_position(&self, position: i64) {
+        cortex_m::interrupt::free(|_| unsafe {
+            let timer = Timer::new(self.timer);
+            timer.set_count(position as u16);
+            timer.clear_update();
+            self.wraps.store((position >> 16) as i32, Ordering::Relaxed);
+        })
+    }
+}
+
+/// 基于固定采样周期的速度估计
+/// 
+/// 每个采样周期调用一次`update`（如在定时器中断或周期任务中），
+/// 用两次位置之差计算速度，并用移位实现的一阶低通滤波平滑量化噪声。
+pub struct VelocityEstimator {
+    /// 采样频率（Hz）
+    sample_hz: u32,
+    /// 平滑系数（0为不滤波，n表示新值权重为1/2^n）
+    shift: u8,
+    /// 上一次的位置
+    last: i64,
+    /// 滤波后的速度（计数/秒，Q8定点）
+    velocity_q8: i64,
+    /// 是否已有上一次位置
+    primed: bool,
+}
+
+impl VelocityEstimator {
+    /// 创建新的速度估计器
+    /// 
+    /// # Arguments
+    /// * `sample_hz` - 调用`update`的频率
+    /// * `shift` - 平滑系数，0为不滤波，最大15
+    pub const fn new(sample_hz: u32, shift: u8) -> Self {
+        Self {
+            sample_hz,
+            shift: if shift > 15 { 15 } else { shift },
+            last: 0,
+            velocity_q8: 0,
+            primed: false,
+        }
+    }
+    
+    /// 送入新的位置采样
+    /// 
+    /// # Returns
+    /// 本周期的位置增量（计数）
+    pub fn update(&mut self, position: i64) -> i64 {
+        if !self.primed {
+            self.primed = true;
+            self.last = position;
+            return 0;
+        }
+        
+        let delta = position.wrapping_sub(self.last);
+        self.last = position;
+        
+        let raw_q8 = (delta * self.sample_hz as i64) << 8;
+        self.velocity_q8 += (raw_q8 - self.velocity_q8) >> self.shift;
+        delta
+    }
+    
+    /// 获取速度（计数/秒）
+    pub fn counts_per_second(&self) -> i32 {
+        (self.velocity_q8 >> 8) as i32
+    }
+    
+    /// 获取转速（转/分钟）
+    /// 
+    /// # Arguments
+    /// * `counts_per_rev` - 每转计数（x4模式下为编码器线数的4倍）
+    pub fn rpm(&self, counts_per_rev: u32) -> i32 {
+        if counts_per_rev == 0 {
+            return 0;
+        }
+        ((self.velocity_q8 * 60) / ((counts_per_rev as i64) << 8)) as i32
+    }
+    
+    /// 清除历史
+    pub fn reset(&mut self) {
+        self.primed = false;
+        self.velocity_q8 = 0;
+    }
+}
+
+/// 软件定时器错误
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum SoftTimerError {
+    /// 计数频率为0或超出定时器范围
+    InvalidRate,
+    /// 定时器槽已满
+    Full,
+}
+
+/// 软件定时器回调，参数为注册时传入的上下文值
+pub type SoftTimerCallback = fn(usize);
+
+/// 软件定时器句柄
+/// 
+/// 包含槽位序号和代数，槽位被复用后旧句柄自动失效，`cancel`不会误删新的定时器。
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct SoftTimerId {
+    slot: u8,
+    generation: u8,
+}
+
+/// 软件定时器槽
+#[derive(Clone, Copy)]
+struct SoftTimerSlot {
+    /// 到期时间（计数值，32位回绕）
+    deadline: u32,
+    /// 周期（0为单次）
+    period: u32,
+    callback: Option<SoftTimerCallback>,
+    context: usize,
+    generation: u8,
+    /// 在堆中的位置（未使用时为`u8::MAX`）
+    heap_index: u8,
+}
+
+impl SoftTimerSlot {
+    const EMPTY: Self = Self {
+        deadline: 0,
+        period: 0,
+        callback: None,
+        context: 0,
+        generation: 0,
+        heap_index: u8::MAX,
+    };
+}
+
+/// 软件定时器的内部状态（只在临界区内访问）
+struct SoftTimerState<const N: usize> {
+    slots: [SoftTimerSlot; N],
+    /// 按到期时间排列的最小堆，元素为槽位序号
+    heap: [u8; N],
+    len: usize,
+}
+
+impl<const N: usize> SoftTimerState<N> {
+    /// 按32位回绕比较：`a`是否早于`b`
+    #[inline(always)]
+    fn before(a: u32, b: u32) -> bool {
+        (a.wrapping_sub(b) as i32) < 0
+    }
+    
+    fn deadline_at(&self, index: usize) -> u32 {
+        self.slots[self.heap[index] as usize].deadline
+    }
+    
+    fn place(&mut self, index: usize, slot: u8) {
+        self.heap[index] = slot;
+        self.slots[slot as usize].heap_index = index as u8;
+    }
+    
+    fn sift_up(&mut self, mut index: usize) {
+        let slot = self.heap[index];
+        let deadline = self.slots[slot as usize].deadline;
+        while index > 0 {
+            let parent = (index - 1) / 2;
+            if !Self::before(deadline, self.deadline_at(parent)) {
+                break;
+            }
+            let moved = self.heap[parent];
+            self.place(index, moved);
+            index = parent;
+        }
+        self.place(index, slot);
+    }
+    
+    fn sift_down(&mut self, mut index: usize) {
+        let slot = self.heap[index];
+        let deadline = self.slots[slot as usize].deadline;
+        loop {
+            let left = index * 2 + 1;
+            if left >= self.len {
+                break;
+            }
+            let right = left + 1;
+            let child = if right < self.len && Self::before(self.deadline_at(right), self.deadline_at(left)) {
+                right
+            } else {
+                left
+            };
+            if !Self::before(self.deadline_at(child), deadline) {
+                break;
+            }
+            let moved = self.heap[child];
+            self.place(index, moved);
+            index = child;
+        }
+        self.place(index, slot);
+    }
+    
+    fn push(&mut self, slot: u8) {
+        let index = self.len;
+        self.len += 1;
+        self.heap[index] = slot;
+        self.sift_up(index);
+    }
+    
+    /// 从堆中移除指定位置的元素
+    fn remove_at(&mut self, index: usize) -> u8 {
+        let slot = self.heap[index];
+        self.len -= 1;
+        if index != self.len {
+            let last = self.heap[self.len];
+            self.place(index, last);
+            self.sift_down(index);
+            let current = self.slots[last as usize].heap_index as usize;
+            self.sift_up(current);
+        }
+        self.slots[slot as usize].heap_index = u8::MAX;
+        slot
+    }
+    
+    fn peek(&self) -> Option<u32> {
+        if self.len == 0 { None } else { Some(self.deadline_at(0)) }
+    }
+}
+
+/// 硬件定时器驱动的软件定时器队列
+/// 
+/// 所有软件定时器按到期时间放在最小堆中，硬件定时器自由运行作为时基，
+/// 比较通道1只编程为最近的一个到期时间：
+/// - 没有定时器到期时不产生中断（只有每65536个计数一次的回绕中断用于扩展32位时间），
+///   CPU可以在两次到期之间休眠
+/// - 每次中断只处理已到期的定时器，插入和删除为O(log N)，与定时器总数基本无关
+/// 
+/// 与需要在主循环中逐个轮询的`delay::PeriodicTimer`不同，回调在定时器中断中执行，
+/// 应保持简短（如置位标志或提交任务）。无堆分配环境下不支持闭包，
+/// 回调使用函数指针加一个`usize`上下文值。
+/// 
+/// 需要在定时器中断中调用`handle_interrupt`，并在NVIC中使能该中断；通常声明为`static`。
+pub struct SoftTimerQueue<const N: usize> {
+    timer: TimerNumber,
+    state: UnsafeCell<SoftTimerState<N>>,
+    /// 计数器回绕次数（32位时间的高16位）
+    wraps: AtomicU32,
+}
+
+/// 实现 Sync trait，内部状态只在临界区内访问
+unsafe impl<const N: usize> Sync for SoftTimerQueue<N> {}
+
+impl<const N: usize> SoftTimerQueue<N> {
+    /// 编译期检查槽位数量
+    const SIZE_CHECK: () = assert!(N > 0 && N < 255, "SoftTimerQueue槽位数量必须在1~254之间");
+    
+    /// DIER.CC1IE
+    const CC1IE: u32 = 1 << 1;
+    /// SR.CC1IF
+    const CC1IF: u32 = 1 << 1;
+    
+    /// 创建新的软件定时器队列
+    pub const fn new(timer: TimerNumber) -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            timer,
+            state: UnsafeCell::new(SoftTimerState {
+                slots: [SoftTimerSlot::EMPTY; N],
+                heap: [0; N],
+                len: 0,
+            }),
+            wraps: AtomicU32::new(0),
+        }
+    }
+    
+    /// 启动时基
+    /// 
+    /// # Arguments
+    /// * `tick_hz` - 计数频率，如1_000_000表示以微秒为单位
+    /// 
+    /// # Safety
+    /// 会重新配置定时器，调用者必须保证它没有被其他代码使用
+    pub unsafe fn start(&self, tick_hz: u32) -> Result<(), SoftTimerError> {
+        let timer = Timer::new(self.timer);
+        if tick_hz == 0 {
+            return Err(SoftTimerError::InvalidRate);
+        }
+        timer.stop();
+        
+        // 先使能时钟才能读取正确的定时器时钟
+        timer.init(0, 0xFFFF);
+        let divider = timer.get_timer_clock() / tick_hz;
+        if divider == 0 || divider > 0x1_0000 {
+            return Err(SoftTimerError::InvalidRate);
+        }
+        timer.init((divider - 1) as u16, 0xFFFF);
+        
+        // CCMR1清零：通道1为冻结输出比较，只产生比较事件
+        core::ptr::write_volatile(timer.register(0x18), 0);
+        
+        self.wraps.store(0, Ordering::Relaxed);
+        timer.clear_update();
+        timer.enable_update_interrupt();
+        timer.start();
+        
+        cortex_m::interrupt::free(|_| self.program(&*self.state.get()));
+        Ok(())
+    }
+    
+    /// 获取当前时间（计数值，32位回绕）
+    pub fn now(&self) -> u32 {
+        cortex_m::interrupt::free(|_| unsafe {
+            let timer = Timer::new(self.timer);
+            let count = timer.get_count();
+            let mut wraps = self.wraps.load(Ordering::Relaxed);
+            if timer.has_update() && count < 0x8000 {
+                // 回绕已发生但中断尚未处理
+                wraps = wraps.wrapping_add(1);
+            }
+            (wraps << 16) | count as u32
+        })
+    }
+    
+    /// 注册一个软件定时器
+    /// 
+    /// # Arguments
+    /// * `delay` - 首次到期前的计数值
+    /// * `period` - 之后的周期，0表示单次
+    /// * `callback` - 到期回调（在定时器中断中执行）
+    /// * `context` - 传给回调的上下文值
+    /// 
+    /// # Returns
+    /// 成功返回句柄，槽位已满返回`SoftTimerError::Full`
+    pub fn schedule(&self, delay: u32, period: u32, callback: SoftTimerCallback, context: usize) -> Result<SoftTimerId, SoftTimerError> {
+        let now = self.now();
+        cortex_m::interrupt::free(|_| unsafe {
+            let state = &mut *self.state.get();
+            let slot = match state.slots.iter().position(|slot| slot.callback.is_none()) {
+                Some(slot) => slot,
+                None => return Err(SoftTimerError::Full),
+            };
+            
+            let entry = &mut state.slots[slot];
+            entry.deadline = now.wrapping_add(delay.min(i32::MAX as u32));
+            entry.period = period.min(i32::MAX as u32);
+            entry.callback = Some(callback);
+            entry.context = context;
+            entry.generation = entry.generation.wrapping_add(1);
+            let id = SoftTimerId {
+                slot: slot as u8,
+                generation: entry.generation,
+            };
+            
+            state.push(slot as u8);
+            self.program(state);
+            Ok(id)
+        })
+    }
+    
+    /// 注册单次定时器
+    pub fn after(&self, delay: u32, callback: SoftTimerCallback, context: usize) -> Result<SoftTimerId, SoftTimerError> {
+        self.schedule(delay, 0, callback, context)
+    }
+    
+    /// 注册周期定时器（首次在一个周期后到期）
+    pub fn every(&self, period: u32, callback: SoftTimerCallback, context: usize) -> Result<SoftTimerId, SoftTimerError> {
+        self.schedule(period, period, callback, context)
+    }
+    
+    /// 取消定时器
+    /// 
+    /// # Returns
+    /// 定时器仍在队列中并被取消返回`true`，已到期（单次）或已取消返回`false`
+    pub fn cancel(&self, id: SoftTimerId) -> bool {
+        cortex_m::interrupt::free(|_| unsafe {
+            let state = &mut *self.state.get();
+            let slot = id.slot as usize;
+            if slot >= N {
+                return false;
+            }
+            let entry = state.slots[slot];
+            if entry.callback.is_none() || entry.generation != id.generation || entry.heap_index == u8::MAX {
+                return false;
+            }
+            
+            state.remove_at(entry.heap_index as usize);
+            state.slots[slot].callback = None;
+            self.program(state);
+            true
+        })
+    }
+    
+    /// 距离最近一个到期时间的计数值
+    /// 
+    /// # Returns
+    /// 没有定时器时返回`None`，已到期返回`Some(0)`；休眠管理可据此决定休眠深度
+    pub fn next_deadline(&self) -> Option<u32> {
+        let now = self.now();
+        cortex_m::interrupt::free(|_| unsafe {
+            let state = &*self.state.get();
+            state.peek().map(|deadline| {
+                let remaining = deadline.wrapping_sub(now) as i32;
+                if remaining < 0 { 0 } else { remaining as u32 }
+            })
+        })
+    }
+    
+    /// 按堆顶编程比较通道（临界区内调用）
+    /// 
+    /// 堆顶在当前回绕周期内到期时设置CCR1并使能比较中断，
+    /// 否则关闭比较中断，等待之后的回绕中断再次检查。
+    unsafe fn program(&self, state: &SoftTimerState<N>) {
+        let timer = Timer::new(self.timer);
+        let dier = timer.register(0x0C);
+        
+        match state.peek() {
+            Some(deadline) => {
+                let now = self.now();
+                let remaining = deadline.wrapping_sub(now) as i32;
+                if remaining < 0x1_0000 - 2 {
+                    timer.set_compare(PwmChannel::Channel1, deadline as u16);
+                    core::ptr::write_volatile(dier, core::ptr::read_volatile(dier) | Self::CC1IE);
+                    
+                    // 设置期间已经错过的到期时间，直接挂起比较中断
+                    if (deadline.wrapping_sub(self.now()) as i32) <= 0 {
+                        core::ptr::write_volatile(timer.register(0x14), 1 << 1); // EGR.CC1G
+                    }
+                } else {
+                    core::ptr::write_volatile(dier, core::ptr::read_volatile(dier) & !Self::CC1IE);
+                }
+            },
+            None => {
+                core::ptr::write_volatile(dier, core::ptr::read_volatile(dier) & !Self::CC1IE);
+            },
+        }
+    }
+    
+    /// 处理定时器中断：扩展时间、执行已到期的回调并重新编程下一个到期时间
+    pub fn handle_interrupt(&self) {
+        unsafe {
+            let timer = Timer::new(self.timer);
+            let sr = timer.register(0x10);
+            
+            cortex_m::interrupt::free(|_| {
+                if timer.has_update() {
+                    timer.clear_update();
+                    self.wraps.fetch_add(1, Ordering::Relaxed);
+                }
+                // 状态寄存器写0清除
+                core::ptr::write_volatile(sr, !Self::CC1IF & 0xFFFF);
+            });
+            
+            loop {
+                // 在临界区内取出一个已到期的定时器，回调在临界区外执行，
+                // 以便回调中可以继续注册或取消定时器
+                let expired = cortex_m::interrupt::free(|_| {
+                    let state = &mut *self.state.get();
+                    let now = self.now();
+                    let deadline = match state.peek() {
+                        Some(deadline) if (deadline.wrapping_sub(now) as i32) <= 0 => deadline,
+                        _ => {
+                            self.program(state);
+                            return None;
+                        },
+                    };
+                    
+                    let slot = state.remove_at(0) as usize;
+                    let entry = &mut state.slots[slot];
+                    let callback = entry.callback;
+                    let context = entry.context;
+                    
+                    if entry.period != 0 {
+                        // 按原到期时间累加，避免周期漂移；严重滞后时跳过错过的周期
+                        let mut next = deadline.wrapping_add(entry.period);
+                        if (next.wrapping_sub(now) as i32) <= 0 {
+                            next = now.wrapping_add(entry.period);
+                        }
+                        entry.deadline = next;
+                        state.push(slot as u8);
+                    } else {
+                        entry.callback = None;
+                    }
+                    
+                    callback.map(|callback| (callback, context))
+                });
+                
+                match expired {
+                    Some((callback, context)) => callback(context),
+                    None => break,
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,312 @@
+//! 看门狗监督模块
+//! 每个任务或中断登记自己的存活令牌和超时时间，全部按时签到才喂独立看门狗
+//! 
+//! - 任务调用`WatchdogToken::check_in`签到，只是一次原子或操作，可以在中断中调用
+//! - `tick`按固定周期（`WatchdogConfig::tick_ms`）在定时器中断中调用：取出签到位图，
+//!   签到的令牌重新计时，其余令牌倒计时，没有令牌超时就喂IWDG
+//! - 令牌超时后记录第一个超时令牌的编号到备份寄存器，然后停止喂狗（或立即软件复位），
+//!   复位后用`last_stall`读取，定位卡住的子系统
+//! 
+//! `tick`本身停止执行时IWDG同样得不到喂狗，由硬件复位兜底。
+//! IWDG在停止模式下继续计数，使用`idle`模块的停止模式时单次休眠必须短于`WatchdogConfig::timeout_ms`。
+//! 
+//! ```ignore
+//! watchdog::init(WatchdogConfig { tick_ms: 10, timeout_ms: 100, reset_on_stall: true })?;
+//! let sensor = watchdog::register(50)?;    // 采样任务至少每50ms签到一次
+//! let comm = watchdog::register(500)?;     // 通信任务至少每500ms签到一次
+//! 
+//! // 10ms定时器中断
+//! watchdog::tick();
+//! 
+//! // 采样任务循环
+//! sensor.check_in();
+//! ```
+
+#![allow(unused)]
+
+use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+
+use crate::bsp::bkp::BKP;
+use crate::bsp::iwdg::{IwdgPrescaler, IWDG};
+use crate::bsp::reg;
+
+/// 最多登记的令牌数（签到位图的位数）
+pub const MAX_WATCHDOG_TOKENS: usize = 32;
+
+/// 记录超时令牌的备份数据寄存器
+pub const STALL_BKP_REGISTER: u8 = 9;
+/// 记录超时次数的备份数据寄存器
+pub const STALL_COUNT_BKP_REGISTER: u8 = 10;
+/// 超时记录标记，低8位为令牌编号
+const STALL_MARKER: u16 = 0xA500;
+/// 超时记录标记掩码
+const STALL_MARKER_MASK: u16 = 0xFF00;
+
+/// AIRCR写入密钥
+const AIRCR_VECTKEY: u32 = 0x05FA_0000;
+/// AIRCR系统复位请求位
+const AIRCR_SYSRESETREQ: u32 = 1 << 2;
+
+/// IWDG时钟频率（LSI，Hz）
+const IWDG_CLOCK_HZ: u32 = 40_000;
+/// IWDG重载值上限（12位）
+const IWDG_MAX_RELOAD: u32 = 0x0FFF;
+
+/// 看门狗监督错误类型
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum WatchdogError {
+    /// 配置无效（周期为0、超时时间不大于周期或超出IWDG范围）
+    InvalidConfig,
+    /// 令牌已满
+    TooManyTokens,
+    /// 令牌超时时间无效（短于一个监督周期或超出计数范围）
+    InvalidPeriod,
+    /// 尚未调用`init`
+    NotInitialized,
+}
+
+/// 看门狗监督配置
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct WatchdogConfig {
+    /// `tick`的调用周期（毫秒），决定令牌超时的检测粒度
+    pub tick_ms: u32,
+    /// IWDG超时时间（毫秒），必须大于`tick_ms`
+    pub timeout_ms: u32,
+    /// 令牌超时后是否立即软件复位，`false`时停止喂狗，等待IWDG复位
+    pub reset_on_stall: bool,
+}
+
+/// 存活令牌，由`register`返回
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct WatchdogToken {
+    id: u8,
+}
+
+impl WatchdogToken {
+    /// 令牌编号（记录在备份寄存器中的值）
+    pub const fn id(&self) -> u8 {
+        self.id
+    }
+    
+    /// 签到，表示登记该令牌的任务仍在运行
+    pub fn check_in(&self) {
+        CHECKED.fetch_or(1 << self.id, Ordering::Release);
+    }
+}
+
+/// 已登记令牌位图
+static REGISTERED: AtomicU32 = AtomicU32::new(0);
+/// 上一次`tick`之后签到的令牌位图
+static CHECKED: AtomicU32 = AtomicU32::new(0);
+/// 是否已有令牌超时，置位后不再喂狗
+static STALLED: AtomicBool = AtomicBool::new(false);
+
+/// 监督配置，`init`之前为`None`；`init`可能在`tick`所在的中断之外改写，读写都必须在临界区内
+static mut CONFIG: Option<WatchdogConfig> = None;
+/// 各令牌的超时周期数
+static mut PERIODS: [u16; MAX_WATCHDOG_TOKENS] = [0; MAX_WATCHDOG_TOKENS];
+/// 各令牌距离超时剩余的周期数
+static mut REMAINING: [u16; MAX_WATCHDOG_TOKENS] = [0; MAX_WATCHDOG_TOKENS];
+
+/// 按超时时间选择IWDG预分频系数和重载值
+/// 
+/// # Returns
+/// 能表示该超时时间的最小预分频系数及对应的重载值，超出范围时返回`None`
+pub fn iwdg_timing(timeout_ms: u32) -> Option<(IwdgPrescaler, u16)> {
+    let prescalers = [
+        (IwdgPrescaler::Div4, 4),
+        (IwdgPrescaler::Div8, 8),
+        (IwdgPrescaler::Div16, 16),
+        (IwdgPrescaler::Div32, 32),
+        (IwdgPrescaler::Div64, 64),
+        (IwdgPrescaler::Div128, 128),
+        (IwdgPrescaler::Div256, 256),
+    ];
+    for &(prescaler, divider) in prescalers.iter() {
+        let reload = timeout_ms as u64 * (IWDG_CLOCK_HZ / divider) as u64 / 1000;
+        if reload == 0 {
+            return None;
+        }
+        if reload <= IWDG_MAX_RELOAD as u64 {
+            return Some((prescaler, reload as u16));
+        }
+    }
+    None
+}
+
+/// 初始化看门狗监督并启动IWDG
+/// 
+/// IWDG一旦启动只能由复位停止，之后必须按`tick_ms`周期调用`tick`
+/// 
+/// # Arguments
+/// * `config` - 监督配置
+/// 
+/// # Returns
+/// 配置无效时返回`WatchdogError::InvalidConfig`，IWDG不会启动
+/// 
+/// # Safety
+/// 直接访问硬件寄存器，需要确保在正确的上下文中调用
+pub unsafe fn init(config: WatchdogConfig) -> Result<(), WatchdogError> {
+    if config.tick_ms == 0 || config.timeout_ms <= config.tick_ms {
+        return Err(WatchdogError::InvalidConfig);
+    }
+    let (prescaler, reload) = iwdg_timing(config.timeout_ms).ok_or(WatchdogError::InvalidConfig)?;
+    
+    // 备份寄存器写访问，用于记录超时令牌
+    BKP.init();
+    
+    cortex_m::interrupt::free(|_| {
+        CONFIG = Some(config);
+        STALLED.store(false, Ordering::Release);
+        CHECKED.store(0, Ordering::Release);
+    });
+    IWDG.init(prescaler, reload);
+    Ok(())
+}
+
+/// 登记一个存活令牌
+/// 
+/// # Arguments
+/// * `period_ms` - 最长签到间隔（毫秒），按监督周期向上取整
+/// 
+/// # Returns
+/// 新的令牌，登记后立即开始计时
+pub fn register(period_ms: u32) -> Result<WatchdogToken, WatchdogError> {
+    cortex_m::interrupt::free(|_| unsafe {
+        let config = CONFIG.ok_or(WatchdogError::NotInitialized)?;
+        let ticks = (period_ms + config.tick_ms - 1) / config.tick_ms;
+        if period_ms == 0 || ticks >= u16::MAX as u32 {
+            return Err(WatchdogError::InvalidPeriod);
+        }
+        
+        let registered = REGISTERED.load(Ordering::Acquire);
+        if registered == u32::MAX {
+            return Err(WatchdogError::TooManyTokens);
+        }
+        let id = (!registered).trailing_zeros() as u8;
+        // 多留一个周期：签到可能刚好发生在一次`tick`之后
+        PERIODS[id as usize] = ticks as u16 + 1;
+        REMAINING[id as usize] = ticks as u16 + 1;
+        CHECKED.fetch_and(!(1 << id), Ordering::AcqRel);
+        REGISTERED.store(registered | (1 << id), Ordering::Release);
+        Ok(WatchdogToken { id })
+    })
+}
+
+/// 注销令牌，不再监督对应任务
+pub fn unregister(token: WatchdogToken) {
+    cortex_m::interrupt::free(|_| {
+        REGISTERED.fetch_and(!(1 << token.id), Ordering::AcqRel);
+        CHECKED.fetch_and(!(1 << token.id), Ordering::AcqRel);
+    });
+}
+
+/// 监督周期处理，按`WatchdogConfig::tick_ms`周期在定时器中断中调用
+/// 
+/// 所有令牌都已签到时（最常见的情况）只比较一次位图即可喂狗；
+/// 否则逐个倒计时未签到的令牌，有令牌超时则记录其编号并停止喂狗
+pub fn tick() {
+    // 整体复制一份，避免与`init`的写入交错读到一半新一半旧的配置
+    let config = match cortex_m::interrupt::free(|_| unsafe { CONFIG }) {
+        Some(config) => config,
+        None => return,
+    };
+    if STALLED.load(Ordering::Acquire) {
+        return;
+    }
+    
+    let registered = REGISTERED.load(Ordering::Acquire);
+    let checked = CHECKED.swap(0, Ordering::AcqRel) & registered;
+    let mut stalled: Option<u8> = None;
+    
+    cortex_m::interrupt::free(|_| unsafe {
+        if checked == registered {
+            if checked != 0 {
+                reload_tokens(checked);
+            }
+            return;
+        }
+        reload_tokens(checked);
+        
+        let mut waiting = registered & !checked;
+        while waiting != 0 {
+            let id = waiting.trailing_zeros() as usize;
+            waiting &= waiting - 1;
+            REMAINING[id] = REMAINING[id].saturating_sub(1);
+            if REMAINING[id] == 0 && stalled.is_none() {
+                stalled = Some(id as u8);
+            }
+        }
+    });
+    
+    match stalled {
+        None => unsafe { IWDG.feed() },
+        Some(id) => unsafe { handle_stall(&config, id) },
+    }
+}
+
+/// 签到的令牌重新开始计时
+unsafe fn reload_tokens(mut mask: u32) {
+    while mask != 0 {
+        let id = mask.trailing_zeros() as usize;
+        mask &= mask - 1;
+        REMAINING[id] = PERIODS[id];
+    }
+}
+
+/// 记录超时令牌并停止喂狗
+unsafe fn handle_stall(config: &WatchdogConfig, id: u8) {
+    STALLED.store(true, Ordering::Release);
+    BKP.write_data_register(STALL_BKP_REGISTER, STALL_MARKER | id as u16);
+    let count = BKP.read_data_register(STALL_COUNT_BKP_REGISTER);
+    BKP.write_data_register(STALL_COUNT_BKP_REGISTER, count.wrapping_add(1));
+    if config.reset_on_stall {
+        // 写AIRCR请求系统复位（SYSRESETREQ）
+        cortex_m::asm::dsb();
+        reg::SCB_AIRCR.write(AIRCR_VECTKEY | AIRCR_SYSRESETREQ);
+        cortex_m::asm::dsb();
+        loop {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// 是否已有令牌超时（IWDG即将复位系统）
+pub fn is_stalled() -> bool {
+    STALLED.load(Ordering::Acquire)
+}
+
+/// 读取复位前记录的超时令牌编号
+/// 
+/// # Returns
+/// 没有超时记录时返回`None`
+/// 
+/// 记录保存在备份寄存器中。`Rtc::init`只在RTC尚未运行时复位备份域，不会清除软件/看门狗复位前的记录；
+/// 自行复位备份域（BDRST）的代码必须在此之前读取。
+/// 
+/// # Safety
+/// 需要先调用`Bkp::init`（`init`会调用）使能备份域时钟
+pub unsafe fn last_stall() -> Option<u8> {
+    let record = BKP.read_data_register(STALL_BKP_REGISTER);
+    if (record & STALL_MARKER_MASK) == STALL_MARKER {
+        Some((record & 0xFF) as u8)
+    } else {
+        None
+    }
+}
+
+/// 读取累计的超时复位次数
+/// 
+/// # Safety
+/// 需要先调用`Bkp::init`使能备份域时钟
+pub unsafe fn stall_count() -> u16 {
+    BKP.read_data_register(STALL_COUNT_BKP_REGISTER)
+}
+
+/// 清除超时记录（超时次数保留）
+/// 
+/// # Safety
+/// 需要先调用`Bkp::init`使能备份域访问
+pub unsafe fn clear_stall_record() {
+    BKP.write_data_register(STALL_BKP_REGISTER, 0);
+}
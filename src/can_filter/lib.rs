@@ -0,0 +1,483 @@
+//! CAN过滤器编译
+//! 把一组ID和ID区间编译为bxCAN过滤器组的寄存器值，不依赖外设，可以在主机上运行单元测试（`cargo test-can-filter`）
+//!
+//! 固件通过`bsp::can`使用，编译结果由`Can::apply_filter_plan`写入硬件。
+
+#![cfg_attr(not(test), no_std)]
+// 屏蔽未使用代码警告
+#![allow(unused)]
+
+/// 过滤器组数量（非互联型产品）
+pub const CAN_FILTER_BANKS: u8 = 14;
+
+/// 标准帧最大ID
+pub const CAN_STD_ID_MAX: u32 = 0x7FF;
+
+/// 扩展帧最大ID
+pub const CAN_EXT_ID_MAX: u32 = 0x1FFF_FFFF;
+
+/// 标识符寄存器的RTR位（TIR/RIR和32位过滤器寄存器）
+pub const ID_RTR: u32 = 1 << 1;
+
+/// 标识符寄存器的IDE位（TIR/RIR和32位过滤器寄存器）
+pub const ID_IDE: u32 = 1 << 2;
+
+/// 过滤器编译错误枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum FilterError {
+    InvalidIdRange,   // 过滤ID超出范围或区间上下限颠倒
+    FilterOverflow,   // ID集合所需的过滤器组超过`CAN_FILTER_BANKS`
+}
+
+/// CAN过滤器模式枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CanFilterMode {
+    MaskMode = 0,
+    ListMode = 1,
+}
+
+/// CAN过滤器尺度枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CanFilterScale {
+    Scale16Bit = 0,
+    Scale32Bit = 1,
+}
+
+/// CAN过滤器FIFO分配枚举
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CanFilterFifo {
+    Fifo0 = 0,
+    Fifo1 = 1,
+}
+
+/// 按TIR/RIR和32位过滤器寄存器的格式编码标识符
+///
+/// 标准帧：`STID[10:0]`位于31~21位；扩展帧：`EXID[28:0]`位于31~3位，IDE=1
+///
+/// # Arguments
+/// * `id` - 标识符
+/// * `is_extended` - 是否为扩展帧
+/// * `rtr` - 是否为远程帧
+pub const fn can_id_register(id: u32, is_extended: bool, rtr: bool) -> u32 {
+    let mut value = if is_extended {
+        (id & CAN_EXT_ID_MAX) << 3 | ID_IDE
+    } else {
+        (id & CAN_STD_ID_MAX) << 21
+    };
+    if rtr {
+        value |= ID_RTR;
+    }
+    value
+}
+
+/// 过滤器编译器要接收的ID或ID区间（闭区间）
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CanIdMatch {
+    Standard(u32),              // 单个标准ID
+    Extended(u32),              // 单个扩展ID
+    StandardRange(u32, u32),    // 标准ID区间
+    ExtendedRange(u32, u32),    // 扩展ID区间
+}
+
+impl CanIdMatch {
+    /// (是否扩展帧, 下限, 上限)，用作排序键
+    fn bounds(&self) -> (bool, u32, u32) {
+        match *self {
+            CanIdMatch::Standard(id) => (false, id, id),
+            CanIdMatch::Extended(id) => (true, id, id),
+            CanIdMatch::StandardRange(low, high) => (false, low, high),
+            CanIdMatch::ExtendedRange(low, high) => (true, low, high),
+        }
+    }
+}
+
+/// 编译得到的一个过滤器组配置
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct CanFilterBank {
+    pub mode: CanFilterMode,
+    pub scale: CanFilterScale,
+    pub fifo: CanFilterFifo,
+    pub fr1: u32,     // FR1寄存器值
+    pub fr2: u32,     // FR2寄存器值
+    pub entries: u8,  // 该组包含的过滤条目数，用于FIFO负载均衡
+}
+
+/// 过滤器编译结果
+pub struct CanFilterPlan {
+    banks: [CanFilterBank; CAN_FILTER_BANKS as usize],
+    len: usize,
+}
+
+impl CanFilterPlan {
+    /// 使用的过滤器组
+    pub fn banks(&self) -> &[CanFilterBank] {
+        &self.banks[..self.len]
+    }
+    
+    /// 各FIFO分配到的过滤条目数
+    pub fn fifo_entries(&self) -> (u32, u32) {
+        self.banks().iter().fold((0, 0), |(fifo0, fifo1), bank| match bank.fifo {
+            CanFilterFifo::Fifo0 => (fifo0 + bank.entries as u32, fifo1),
+            CanFilterFifo::Fifo1 => (fifo0, fifo1 + bank.entries as u32),
+        })
+    }
+    
+    fn push(&mut self, mode: CanFilterMode, scale: CanFilterScale, fr1: u32, fr2: u32, entries: usize) -> Result<(), FilterError> {
+        if self.len >= self.banks.len() {
+            return Err(FilterError::FilterOverflow);
+        }
+        self.banks[self.len] = CanFilterBank {
+            mode,
+            scale,
+            fifo: CanFilterFifo::Fifo0,
+            fr1,
+            fr2,
+            entries: entries as u8,
+        };
+        self.len += 1;
+        Ok(())
+    }
+}
+
+/// 定长列表，容量即该类过滤条目在14个过滤器组中最多能放下的数量
+struct FilterList<T: Copy, const N: usize> {
+    items: [T; N],
+    len: usize,
+}
+
+impl<T: Copy, const N: usize> FilterList<T, N> {
+    fn new(fill: T) -> Self {
+        Self { items: [fill; N], len: 0 }
+    }
+    
+    fn push(&mut self, item: T) -> Result<(), FilterError> {
+        if self.len >= N {
+            return Err(FilterError::FilterOverflow);
+        }
+        self.items[self.len] = item;
+        self.len += 1;
+        Ok(())
+    }
+    
+    fn as_slice(&self) -> &[T] {
+        &self.items[..self.len]
+    }
+}
+
+/// 16位过滤器格式的标准ID：`STID[10:0]`位于15~5位
+const fn filter16_id(id: u32) -> u32 {
+    (id & CAN_STD_ID_MAX) << 5
+}
+
+/// 16位屏蔽位，IDE和RTR必须匹配（只接收标准数据帧）
+const FILTER16_IDE_RTR: u32 = 0x18;
+
+/// 32位屏蔽位，IDE和RTR必须匹配
+const FILTER32_IDE_RTR: u32 = ID_IDE | ID_RTR;
+
+const BANKS: usize = CAN_FILTER_BANKS as usize;
+
+/// 按类型分拣后的过滤条目
+struct FilterEntries {
+    /// 单个标准ID（16位列表，每组4个）
+    std_single: FilterList<u32, { 4 * BANKS }>,
+    /// 对齐的2个标准ID（可拆成2个列表条目或占1个16位屏蔽条目）
+    std_pair: FilterList<u32, { 2 * BANKS }>,
+    /// 对齐的2^k（k≥2）个标准ID：(基址, 11位屏蔽)，16位屏蔽，每组2个
+    std_block: FilterList<(u32, u32), { 2 * BANKS }>,
+    /// 单个扩展ID（32位列表，每组2个）
+    ext_single: FilterList<u32, { 2 * BANKS }>,
+    /// 对齐的2个扩展ID（可拆成2个列表条目或占1个32位屏蔽组）
+    ext_pair: FilterList<u32, BANKS>,
+    /// 对齐的2^k（k≥2）个扩展ID：(基址, 29位屏蔽)，32位屏蔽，每组1个
+    ext_block: FilterList<(u32, u32), BANKS>,
+}
+
+impl FilterEntries {
+    /// 把闭区间分解为最少的对齐2^k块
+    fn add_range(&mut self, extended: bool, mut low: u32, high: u32) -> Result<(), FilterError> {
+        let id_max = if extended { CAN_EXT_ID_MAX } else { CAN_STD_ID_MAX };
+        loop {
+            // 块大小受基址对齐和区间剩余长度两方面限制
+            let remaining = (high - low) as u64 + 1;
+            let mut size = if low == 0 { 1u64 << 32 } else { 1u64 << low.trailing_zeros() };
+            while size > remaining {
+                size >>= 1;
+            }
+            
+            let mask = !(size as u32 - 1) & id_max;
+            match (extended, size) {
+                (false, 1) => self.std_single.push(low)?,
+                (false, 2) => self.std_pair.push(low)?,
+                (false, _) => self.std_block.push((low, mask))?,
+                (true, 1) => self.ext_single.push(low)?,
+                (true, 2) => self.ext_pair.push(low)?,
+                (true, _) => self.ext_block.push((low, mask))?,
+            }
+            
+            if size == remaining {
+                return Ok(());
+            }
+            low += size as u32;
+        }
+    }
+}
+
+/// 选出拆成列表条目的“2个ID块”数量，使占用的过滤器组最少
+///
+/// # Arguments
+/// * `singles` - 列表条目数
+/// * `pairs` - 可拆分的2个ID块数
+/// * `per_list_bank` - 每组列表条目数
+/// * `per_mask_bank` - 每组屏蔽条目数
+/// * `masks` - 其它屏蔽条目数
+///
+/// # Returns
+/// (拆分的块数, 占用的过滤器组数)
+fn split_pairs(singles: usize, pairs: usize, masks: usize, per_list_bank: usize, per_mask_bank: usize) -> (usize, usize) {
+    let banks = |split: usize| {
+        (singles + 2 * split + per_list_bank - 1) / per_list_bank
+            + (masks + pairs - split + per_mask_bank - 1) / per_mask_bank
+    };
+    (0..=pairs).map(|split| (split, banks(split))).min_by_key(|&(_, count)| count).unwrap_or((0, banks(0)))
+}
+
+/// 把一组ID和ID区间编译为最少的硬件过滤器组
+///
+/// 重叠和相邻的区间先合并，再分解为对齐的2^k块：
+/// - 标准帧：单个ID用16位列表模式（每组4个），4个及以上的块用16位屏蔽模式（每组2个）
+/// - 扩展帧：单个ID用32位列表模式（每组2个），4个及以上的块用32位屏蔽模式（每组1个）
+/// - 2个ID的块在列表和屏蔽之间选择，以填满其它组的空位
+///
+/// 过滤结果与ID集合完全一致，不会放进多余的ID；只接收数据帧，远程帧被硬件丢弃。
+/// 各过滤器组按条目数从多到少交替分配给条目较少的FIFO，使FIFO0/FIFO1的负载大致均衡。
+///
+/// # Arguments
+/// * `matches` - 要接收的ID和区间（编译时会被原地排序）
+///
+/// # Returns
+/// ID超出范围或区间颠倒返回`InvalidIdRange`，需要超过14个过滤器组时返回`FilterOverflow`
+///
+/// ```ignore
+/// let mut ids = [
+///     CanIdMatch::StandardRange(0x100, 0x10F),
+///     CanIdMatch::Standard(0x321),
+///     CanIdMatch::Extended(0x18FF_50E5),
+/// ];
+/// let plan = compile_filters(&mut ids)?;
+/// CAN.apply_filter_plan(&plan)?;
+/// ```
+pub fn compile_filters(matches: &mut [CanIdMatch]) -> Result<CanFilterPlan, FilterError> {
+    for entry in matches.iter() {
+        let (extended, low, high) = entry.bounds();
+        let id_max = if extended { CAN_EXT_ID_MAX } else { CAN_STD_ID_MAX };
+        if low > high || high > id_max {
+            return Err(FilterError::InvalidIdRange);
+        }
+    }
+    matches.sort_unstable_by_key(|entry| entry.bounds());
+    
+    let mut entries = FilterEntries {
+        std_single: FilterList::new(0),
+        std_pair: FilterList::new(0),
+        std_block: FilterList::new((0, 0)),
+        ext_single: FilterList::new(0),
+        ext_pair: FilterList::new(0),
+        ext_block: FilterList::new((0, 0)),
+    };
+    
+    // 合并重叠和相邻的区间
+    let mut current: Option<(bool, u32, u32)> = None;
+    for entry in matches.iter() {
+        let (extended, low, high) = entry.bounds();
+        current = match current {
+            Some((cur_ext, cur_low, cur_high)) if cur_ext == extended && low <= cur_high.saturating_add(1) => {
+                Some((cur_ext, cur_low, cur_high.max(high)))
+            }
+            Some((cur_ext, cur_low, cur_high)) => {
+                entries.add_range(cur_ext, cur_low, cur_high)?;
+                Some((extended, low, high))
+            }
+            None => Some((extended, low, high)),
+        };
+    }
+    if let Some((extended, low, high)) = current {
+        entries.add_range(extended, low, high)?;
+    }
+    
+    let (std_split, std_banks) = split_pairs(
+        entries.std_single.len, entries.std_pair.len, entries.std_block.len, 4, 2,
+    );
+    let (ext_split, ext_banks) = split_pairs(
+        entries.ext_single.len, entries.ext_pair.len, entries.ext_block.len, 2, 1,
+    );
+    if std_banks + ext_banks > BANKS {
+        return Err(FilterError::FilterOverflow);
+    }
+    
+    let mut plan = CanFilterPlan {
+        banks: [CanFilterBank {
+            mode: CanFilterMode::MaskMode,
+            scale: CanFilterScale::Scale32Bit,
+            fifo: CanFilterFifo::Fifo0,
+            fr1: 0,
+            fr2: 0,
+            entries: 0,
+        }; BANKS],
+        len: 0,
+    };
+    
+    // 标准帧列表：单个ID加上拆开的2个ID块，每组4个，不足的位置重复最后一个ID
+    let std_pairs = entries.std_pair.as_slice();
+    let mut list = [0u32; 4 * BANKS];
+    let mut count = 0;
+    for &id in entries.std_single.as_slice() {
+        list[count] = filter16_id(id);
+        count += 1;
+    }
+    for &base in &std_pairs[..std_split] {
+        list[count] = filter16_id(base);
+        list[count + 1] = filter16_id(base + 1);
+        count += 2;
+    }
+    for chunk in list[..count].chunks(4) {
+        let at = |i: usize| chunk[i.min(chunk.len() - 1)];
+        plan.push(CanFilterMode::ListMode, CanFilterScale::Scale16Bit,
+            at(0) | at(1) << 16, at(2) | at(3) << 16, chunk.len())?;
+    }
+    
+    // 标准帧屏蔽：每个16位寄存器半字对为(ID, 屏蔽)，每组2个
+    let mut masks = [0u32; 2 * BANKS];
+    let mut count = 0;
+    for &(base, mask) in entries.std_block.as_slice() {
+        masks[count] = filter16_id(base) | (filter16_id(mask) | FILTER16_IDE_RTR) << 16;
+        count += 1;
+    }
+    for &base in &std_pairs[std_split..] {
+        masks[count] = filter16_id(base) | (filter16_id(!1 & CAN_STD_ID_MAX) | FILTER16_IDE_RTR) << 16;
+        count += 1;
+    }
+    for chunk in masks[..count].chunks(2) {
+        plan.push(CanFilterMode::MaskMode, CanFilterScale::Scale16Bit,
+            chunk[0], chunk[chunk.len() - 1], chunk.len())?;
+    }
+    
+    // 扩展帧列表：每组2个
+    let ext_pairs = entries.ext_pair.as_slice();
+    let mut list = [0u32; 2 * BANKS];
+    let mut count = 0;
+    for &id in entries.ext_single.as_slice() {
+        list[count] = can_id_register(id, true, false);
+        count += 1;
+    }
+    for &base in &ext_pairs[..ext_split] {
+        list[count] = can_id_register(base, true, false);
+        list[count + 1] = can_id_register(base + 1, true, false);
+        count += 2;
+    }
+    for chunk in list[..count].chunks(2) {
+        plan.push(CanFilterMode::ListMode, CanFilterScale::Scale32Bit,
+            chunk[0], chunk[chunk.len() - 1], chunk.len())?;
+    }
+    
+    // 扩展帧屏蔽：每组1个
+    for &(base, mask) in entries.ext_block.as_slice() {
+        plan.push(CanFilterMode::MaskMode, CanFilterScale::Scale32Bit,
+            can_id_register(base, true, false), mask << 3 | FILTER32_IDE_RTR, 1)?;
+    }
+    for &base in &ext_pairs[ext_split..] {
+        plan.push(CanFilterMode::MaskMode, CanFilterScale::Scale32Bit,
+            can_id_register(base, true, false), (!1 & CAN_EXT_ID_MAX) << 3 | FILTER32_IDE_RTR, 1)?;
+    }
+    
+    // 负载均衡：条目多的组先分配，每次分给当前条目较少的FIFO
+    let mut assigned = [false; BANKS];
+    let mut load = [0u32; 2];
+    for _ in 0..plan.len {
+        let mut next = 0;
+        let mut best: Option<u8> = None;
+        for index in 0..plan.len {
+            if !assigned[index] && best.map_or(true, |entries| plan.banks[index].entries > entries) {
+                best = Some(plan.banks[index].entries);
+                next = index;
+            }
+        }
+        assigned[next] = true;
+        let fifo = if load[1] < load[0] { 1 } else { 0 };
+        load[fifo] += plan.banks[next].entries as u32;
+        plan.banks[next].fifo = if fifo == 1 { CanFilterFifo::Fifo1 } else { CanFilterFifo::Fifo0 };
+    }
+    
+    Ok(plan)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    /// 测试标准帧：单个ID用16位列表，对齐区间用16位屏蔽，两组分到不同FIFO
+    #[test]
+    fn test_standard_list_and_mask() {
+        let mut ids = [CanIdMatch::Standard(0x321), CanIdMatch::StandardRange(0x100, 0x10F)];
+        let plan = compile_filters(&mut ids).unwrap();
+        let banks = plan.banks();
+        
+        assert_eq!(banks.len(), 2);
+        assert_eq!((banks[0].mode, banks[0].scale), (CanFilterMode::ListMode, CanFilterScale::Scale16Bit));
+        // 不足4个的列表重复最后一个ID
+        assert_eq!((banks[0].fr1, banks[0].fr2), (0x6420_6420, 0x6420_6420));
+        assert_eq!((banks[1].mode, banks[1].scale), (CanFilterMode::MaskMode, CanFilterScale::Scale16Bit));
+        // 低半字为ID，高半字为屏蔽（含IDE/RTR）
+        assert_eq!(banks[1].fr1, 0xFE18_2000);
+        assert_eq!((banks[0].fifo, banks[1].fifo), (CanFilterFifo::Fifo0, CanFilterFifo::Fifo1));
+        assert_eq!(plan.fifo_entries(), (1, 1));
+    }
+    
+    /// 测试扩展帧：单个ID用32位列表，对齐区间用32位屏蔽
+    #[test]
+    fn test_extended_list_and_mask() {
+        let mut ids = [CanIdMatch::Extended(0x18FF_50E5), CanIdMatch::ExtendedRange(0x1000, 0x1003)];
+        let plan = compile_filters(&mut ids).unwrap();
+        let banks = plan.banks();
+        
+        assert_eq!(banks.len(), 2);
+        assert_eq!((banks[0].mode, banks[0].scale), (CanFilterMode::ListMode, CanFilterScale::Scale32Bit));
+        assert_eq!((banks[0].fr1, banks[0].fr2), (0xC7FA_872C, 0xC7FA_872C));
+        assert_eq!(banks[0].fr1, can_id_register(0x18FF_50E5, true, false));
+        assert_eq!((banks[1].mode, banks[1].scale), (CanFilterMode::MaskMode, CanFilterScale::Scale32Bit));
+        assert_eq!((banks[1].fr1, banks[1].fr2), (0x0000_8004, 0xFFFF_FFE6));
+    }
+    
+    /// 测试相邻区间合并，以及2个ID的块拆成列表条目填满列表组
+    #[test]
+    fn test_merge_and_pair_split() {
+        let mut ids = [
+            CanIdMatch::Standard(0x30),
+            CanIdMatch::StandardRange(0x10, 0x10),
+            CanIdMatch::Standard(0x11),
+            CanIdMatch::Standard(0x20),
+        ];
+        let plan = compile_filters(&mut ids).unwrap();
+        let banks = plan.banks();
+        
+        assert_eq!(banks.len(), 1);
+        assert_eq!(banks[0].entries, 4);
+        assert_eq!((banks[0].mode, banks[0].scale), (CanFilterMode::ListMode, CanFilterScale::Scale16Bit));
+        // 单个ID在前（0x20、0x30），拆开的块在后（0x10、0x11）
+        assert_eq!((banks[0].fr1, banks[0].fr2), (0x0600_0400, 0x0220_0200));
+    }
+    
+    /// 测试参数检查和过滤器组溢出
+    #[test]
+    fn test_errors() {
+        assert_eq!(compile_filters(&mut [CanIdMatch::Standard(0x800)]).err(), Some(FilterError::InvalidIdRange));
+        assert_eq!(compile_filters(&mut [CanIdMatch::StandardRange(5, 4)]).err(), Some(FilterError::InvalidIdRange));
+        
+        // 29个不相邻的扩展ID需要15个32位列表组
+        let mut ids = [CanIdMatch::Extended(0); 29];
+        for (index, entry) in ids.iter_mut().enumerate() {
+            *entry = CanIdMatch::Extended(index as u32 * 2);
+        }
+        assert_eq!(compile_filters(&mut ids).err(), Some(FilterError::FilterOverflow));
+    }
+}
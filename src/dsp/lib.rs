@@ -0,0 +1,549 @@
+//! 定点DSP算法
+//! 面向ADC数据块的定点滤波、抽取和统计，不依赖外设，可以在主机上运行单元测试（`cargo test-dsp`）
+//!
+//! 所有算法只使用整数运算（Q15/Q31），适合没有FPU的Cortex-M3。
+//! 处理以数据块为单位进行，滤波器在块之间保留状态。
+//! 固件通过`bsp::dsp`使用，该模块另外提供从`AdcBlock`创建跨步视图的函数。
+
+#![cfg_attr(not(test), no_std)]
+// 屏蔽未使用代码警告
+#![allow(unused)]
+
+/// Q15定点数（1位符号位，15位小数位）
+pub type Q15 = i16;
+
+/// Q31定点数（1位符号位，31位小数位）
+pub type Q31 = i32;
+
+/// Q15格式下的1.0（饱和到最大正值）
+pub const Q15_ONE: Q15 = i16::MAX;
+
+/// Q31格式下的1.0（饱和到最大正值）
+pub const Q31_ONE: Q31 = i32::MAX;
+
+/// ADC满量程（12位）
+pub const ADC_FULL_SCALE: u16 = 4095;
+
+/// Q15乘法（带舍入和饱和）
+#[inline(always)]
+pub fn q15_mul(a: Q15, b: Q15) -> Q15 {
+    let product = ((a as i32 * b as i32) + (1 << 14)) >> 15;
+    q15_saturate(product)
+}
+
+/// Q31乘法（带舍入和饱和）
+#[inline(always)]
+pub fn q31_mul(a: Q31, b: Q31) -> Q31 {
+    let product = ((a as i64 * b as i64) + (1 << 30)) >> 31;
+    product.clamp(i32::MIN as i64, i32::MAX as i64) as Q31
+}
+
+/// 把32位中间结果饱和到Q15范围
+#[inline(always)]
+pub fn q15_saturate(value: i32) -> Q15 {
+    value.clamp(i16::MIN as i32, i16::MAX as i32) as Q15
+}
+
+/// 把12位右对齐ADC结果转换为以中点为零的Q15值
+///
+/// 0对应-1.0，2048对应0，4095对应接近+1.0
+#[inline(always)]
+pub fn adc_to_q15(sample: u16) -> Q15 {
+    ((sample as i32 - 2048) << 4) as Q15
+}
+
+/// 把12位右对齐ADC结果转换为0到1.0的Q31值
+#[inline(always)]
+pub fn adc_to_q31(sample: u16) -> Q31 {
+    ((sample as u32 & 0x0FFF) << 19) as Q31
+}
+
+/// 64位整数平方根（向下取整）
+pub fn isqrt(value: u64) -> u32 {
+    if value == 0 {
+        return 0;
+    }
+    
+    // 逐位确定结果，共32次迭代
+    let mut remainder = value;
+    let mut result: u64 = 0;
+    let mut bit: u64 = 1 << 62;
+    while bit > remainder {
+        bit >>= 2;
+    }
+    while bit != 0 {
+        if remainder >= result + bit {
+            remainder -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    result as u32
+}
+
+/// 交错数据中单个通道的跨步视图
+///
+/// ADC扫描数据按`[ch0, ch1, ..., ch0, ch1, ...]`交错存放，
+/// 视图按`offset + i * stride`访问某个通道，不复制数据。
+#[derive(Debug, Clone, Copy)]
+pub struct Strided<'a> {
+    data: &'a [u16],
+    offset: usize,
+    stride: usize,
+    len: usize,
+}
+
+impl<'a> Strided<'a> {
+    /// 创建跨步视图
+    ///
+    /// # Arguments
+    /// * `data` - 交错存放的数据
+    /// * `offset` - 第一个元素的下标
+    /// * `stride` - 相邻元素的间隔（不能为0）
+    pub fn new(data: &'a [u16], offset: usize, stride: usize) -> Self {
+        let stride = stride.max(1);
+        let len = if offset < data.len() {
+            (data.len() - offset + stride - 1) / stride
+        } else {
+            0
+        };
+        Self { data, offset, stride, len }
+    }
+    
+    /// 创建连续数据的视图
+    pub fn contiguous(data: &'a [u16]) -> Self {
+        Self::new(data, 0, 1)
+    }
+    
+    /// 获取元素个数
+    #[inline(always)]
+    pub fn len(&self) -> usize {
+        self.len
+    }
+    
+    /// 视图是否为空
+    #[inline(always)]
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+    
+    /// 获取第`i`个元素
+    #[inline(always)]
+    pub fn get(&self, i: usize) -> u16 {
+        self.data[self.offset + i * self.stride]
+    }
+    
+    /// 迭代全部元素
+    pub fn iter(&self) -> impl Iterator<Item = u16> + 'a {
+        let data = self.data;
+        let (offset, stride, len) = (self.offset, self.stride, self.len);
+        (0..len).map(move |i| data[offset + i * stride])
+    }
+}
+
+/// 块滤波器接口
+///
+/// 每次处理一整块输入，状态在块之间保持，因此多块连续处理的结果
+/// 与一次处理全部数据相同。
+pub trait BlockFilter {
+    /// 处理一块数据
+    ///
+    /// # Arguments
+    /// * `input` - 输入数据视图
+    /// * `output` - 输出缓冲区
+    ///
+    /// # Returns
+    /// 写入`output`的元素个数（输出缓冲区不足时截断输入）
+    fn process(&mut self, input: Strided<'_>, output: &mut [u16]) -> usize;
+    
+    /// 清除内部状态
+    fn reset(&mut self);
+}
+
+/// 滑动平均（矩形窗）滤波器
+///
+/// 窗口长度`N`必须是2的幂，除法由移位完成。
+/// 运行和在块之间保持，每个采样点只需一次加法和一次减法。
+pub struct BoxcarFilter<const N: usize> {
+    history: [u16; N],
+    index: usize,
+    sum: u32,
+}
+
+impl<const N: usize> BoxcarFilter<N> {
+    /// 编译期检查窗口长度
+    const SIZE_CHECK: () = assert!(N.is_power_of_two() && N <= 65536, "BoxcarFilter窗口长度必须是2的幂且不超过65536");
+    
+    /// 除法移位量
+    const SHIFT: u32 = N.trailing_zeros();
+    
+    /// 创建新的滑动平均滤波器
+    pub const fn new() -> Self {
+        let _ = Self::SIZE_CHECK;
+        Self {
+            history: [0; N],
+            index: 0,
+            sum: 0,
+        }
+    }
+    
+    /// 送入一个采样点并返回当前平均值
+    #[inline(always)]
+    fn step(&mut self, sample: u16) -> u16 {
+        let old = core::mem::replace(&mut self.history[self.index], sample);
+        self.index = (self.index + 1) & (N - 1);
+        self.sum = self.sum + sample as u32 - old as u32;
+        (self.sum >> Self::SHIFT) as u16
+    }
+}
+
+impl<const N: usize> BlockFilter for BoxcarFilter<N> {
+    fn process(&mut self, input: Strided<'_>, output: &mut [u16]) -> usize {
+        let count = input.len().min(output.len());
+        let (head, tail) = output[..count].split_at_mut(count & !3);
+        
+        // 4路展开
+        for (i, out) in head.chunks_exact_mut(4).enumerate() {
+            let base = i * 4;
+            out[0] = self.step(input.get(base));
+            out[1] = self.step(input.get(base + 1));
+            out[2] = self.step(input.get(base + 2));
+            out[3] = self.step(input.get(base + 3));
+        }
+        let base = head.len();
+        for (i, out) in tail.iter_mut().enumerate() {
+            *out = self.step(input.get(base + i));
+        }
+        
+        count
+    }
+    
+    fn reset(&mut self) {
+        self.history = [0; N];
+        self.index = 0;
+        self.sum = 0;
+    }
+}
+
+/// 指数移动平均滤波器
+///
+/// `y += alpha * (x - y)`，`alpha`为Q15系数。
+/// 内部状态保留15位小数，避免小系数时的截断误差累积。
+pub struct EmaFilter {
+    alpha: Q15,
+    /// 输出值（Q15小数）
+    state: i32,
+    primed: bool,
+}
+
+impl EmaFilter {
+    /// 创建新的指数移动平均滤波器
+    ///
+    /// # Arguments
+    /// * `alpha` - 平滑系数（Q15，0到`Q15_ONE`），越小越平滑
+    pub const fn new(alpha: Q15) -> Self {
+        Self {
+            alpha,
+            state: 0,
+            primed: false,
+        }
+    }
+    
+    /// 以`alpha = 2^-shift`创建滤波器
+    pub const fn from_shift(shift: u8) -> Self {
+        let alpha = (1i32 << 15) >> if shift > 15 { 15 } else { shift };
+        Self::new(if alpha > Q15_ONE as i32 { Q15_ONE } else { alpha as Q15 })
+    }
+    
+    /// 获取当前输出值
+    pub fn value(&self) -> u16 {
+        ((self.state + (1 << 14)) >> 15) as u16
+    }
+    
+    /// 送入一个采样点并返回当前输出值
+    #[inline(always)]
+    fn step(&mut self, sample: u16) -> u16 {
+        let x = (sample as i32) << 15;
+        if !self.primed {
+            // 第一个采样点直接作为初值，避免从0开始的长时间爬升
+            self.state = x;
+            self.primed = true;
+        } else {
+            let delta = ((x - self.state) as i64 * self.alpha as i64) >> 15;
+            self.state += delta as i32;
+        }
+        self.value()
+    }
+}
+
+impl BlockFilter for EmaFilter {
+    fn process(&mut self, input: Strided<'_>, output: &mut [u16]) -> usize {
+        let count = input.len().min(output.len());
+        let (head, tail) = output[..count].split_at_mut(count & !3);
+        
+        // 4路展开
+        for (i, out) in head.chunks_exact_mut(4).enumerate() {
+            let base = i * 4;
+            out[0] = self.step(input.get(base));
+            out[1] = self.step(input.get(base + 1));
+            out[2] = self.step(input.get(base + 2));
+            out[3] = self.step(input.get(base + 3));
+        }
+        let base = head.len();
+        for (i, out) in tail.iter_mut().enumerate() {
+            *out = self.step(input.get(base + i));
+        }
+        
+        count
+    }
+    
+    fn reset(&mut self) {
+        self.state = 0;
+        self.primed = false;
+    }
+}
+
+/// CIC抽取滤波器
+///
+/// `ORDER`级积分器和梳状器，差分延迟为1，抽取率`R`必须是2的幂。
+/// 积分器使用回绕算术，只要最终位宽`12 + ORDER * log2(R)`不超过32位结果就是正确的，
+/// 输出按增益`R^ORDER`移位归一化回12位范围。
+pub struct CicDecimator<const ORDER: usize> {
+    integrators: [u32; ORDER],
+    combs: [u32; ORDER],
+    decimation: u32,
+    shift: u32,
+    phase: u32,
+}
+
+impl<const ORDER: usize> CicDecimator<ORDER> {
+    /// 创建新的CIC抽取滤波器
+    ///
+    /// # Arguments
+    /// * `decimation` - 抽取率（2的幂，且满足`12 + ORDER * log2(R) <= 32`）
+    pub const fn new(decimation: u32) -> Self {
+        assert!(ORDER >= 1, "CIC阶数至少为1");
+        assert!(decimation.is_power_of_two(), "CIC抽取率必须是2的幂");
+        let shift = ORDER as u32 * decimation.trailing_zeros();
+        assert!(12 + shift <= 32, "CIC位宽增长超过32位");
+        Self {
+            integrators: [0; ORDER],
+            combs: [0; ORDER],
+            decimation,
+            shift,
+            phase: 0,
+        }
+    }
+    
+    /// 获取抽取率
+    pub const fn decimation(&self) -> u32 {
+        self.decimation
+    }
+    
+    /// 送入一个采样点，每`R`个采样点返回一个输出
+    #[inline(always)]
+    fn step(&mut self, sample: u16) -> Option<u16> {
+        let mut acc = sample as u32;
+        for integrator in self.integrators.iter_mut() {
+            *integrator = integrator.wrapping_add(acc);
+            acc = *integrator;
+        }
+        
+        self.phase += 1;
+        if self.phase < self.decimation {
+            return None;
+        }
+        self.phase = 0;
+        
+        for comb in self.combs.iter_mut() {
+            let delayed = core::mem::replace(comb, acc);
+            acc = acc.wrapping_sub(delayed);
+        }
+        Some((acc >> self.shift) as u16)
+    }
+}
+
+impl<const ORDER: usize> BlockFilter for CicDecimator<ORDER> {
+    fn process(&mut self, input: Strided<'_>, output: &mut [u16]) -> usize {
+        let mut written = 0;
+        for i in 0..input.len() {
+            if written == output.len() {
+                break;
+            }
+            if let Some(value) = self.step(input.get(i)) {
+                output[written] = value;
+                written += 1;
+            }
+        }
+        written
+    }
+    
+    fn reset(&mut self) {
+        self.integrators = [0; ORDER];
+        self.combs = [0; ORDER];
+        self.phase = 0;
+    }
+}
+
+/// 块统计（最小值、最大值、平均值、均方根）
+///
+/// 可以跨多个数据块累加，需要新的统计窗口时调用`reset`。
+#[derive(Debug, Clone, Copy)]
+pub struct BlockStats {
+    min: u16,
+    max: u16,
+    count: u32,
+    sum: u64,
+    sum_squares: u64,
+}
+
+impl BlockStats {
+    /// 创建新的统计器
+    pub const fn new() -> Self {
+        Self {
+            min: u16::MAX,
+            max: 0,
+            count: 0,
+            sum: 0,
+            sum_squares: 0,
+        }
+    }
+    
+    /// 清除统计结果
+    pub fn reset(&mut self) {
+        *self = Self::new();
+    }
+    
+    /// 累加一块数据
+    pub fn accumulate(&mut self, input: Strided<'_>) {
+        let mut min = self.min;
+        let mut max = self.max;
+        // 4路展开，每4个点合并一次到64位结果
+        let mut i = 0;
+        let len = input.len();
+        while i + 4 <= len {
+            let a = input.get(i);
+            let b = input.get(i + 1);
+            let c = input.get(i + 2);
+            let d = input.get(i + 3);
+            min = min.min(a).min(b).min(c).min(d);
+            max = max.max(a).max(b).max(c).max(d);
+            self.sum += (a as u32 + b as u32 + c as u32 + d as u32) as u64;
+            self.sum_squares += (a as u64 * a as u64) + (b as u64 * b as u64)
+                + (c as u64 * c as u64) + (d as u64 * d as u64);
+            i += 4;
+        }
+        while i < len {
+            let a = input.get(i);
+            min = min.min(a);
+            max = max.max(a);
+            self.sum += a as u64;
+            self.sum_squares += a as u64 * a as u64;
+            i += 1;
+        }
+        
+        self.min = min;
+        self.max = max;
+        self.count += len as u32;
+    }
+    
+    /// 获取采样点个数
+    pub fn count(&self) -> u32 {
+        self.count
+    }
+    
+    /// 获取最小值（无数据时返回`None`）
+    pub fn min(&self) -> Option<u16> {
+        if self.count == 0 { None } else { Some(self.min) }
+    }
+    
+    /// 获取最大值（无数据时返回`None`）
+    pub fn max(&self) -> Option<u16> {
+        if self.count == 0 { None } else { Some(self.max) }
+    }
+    
+    /// 获取峰峰值
+    pub fn peak_to_peak(&self) -> u16 {
+        if self.count == 0 { 0 } else { self.max - self.min }
+    }
+    
+    /// 获取平均值
+    pub fn mean(&self) -> u16 {
+        if self.count == 0 {
+            return 0;
+        }
+        (self.sum / self.count as u64) as u16
+    }
+    
+    /// 获取均方根（包含直流分量）
+    pub fn rms(&self) -> u16 {
+        if self.count == 0 {
+            return 0;
+        }
+        isqrt(self.sum_squares / self.count as u64) as u16
+    }
+    
+    /// 获取去除直流分量后的均方根（交流有效值）
+    pub fn ac_rms(&self) -> u16 {
+        if self.count == 0 {
+            return 0;
+        }
+        let n = self.count as u64;
+        // 方差 = E[x²] - E[x]²
+        let mean = self.sum / n;
+        let variance = (self.sum_squares / n).saturating_sub(mean * mean);
+        isqrt(variance) as u16
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    /// 测试分块处理与一次处理结果一致
+    #[test]
+    fn test_boxcar_across_blocks() {
+        let data: [u16; 16] = [0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60];
+        let mut whole = BoxcarFilter::<4>::new();
+        let mut split = BoxcarFilter::<4>::new();
+        let mut out_whole = [0u16; 16];
+        let mut out_split = [0u16; 16];
+        
+        whole.process(Strided::contiguous(&data), &mut out_whole);
+        let n = split.process(Strided::contiguous(&data[..7]), &mut out_split[..7]);
+        split.process(Strided::contiguous(&data[7..]), &mut out_split[n..]);
+        
+        assert_eq!(out_whole, out_split);
+        assert_eq!(out_whole[15], (48 + 52 + 56 + 60) / 4);
+    }
+    
+    /// 测试CIC抽取的直流增益归一化
+    #[test]
+    fn test_cic_dc_gain() {
+        let data = [1000u16; 64];
+        let mut cic = CicDecimator::<3>::new(8);
+        let mut out = [0u16; 8];
+        
+        let n = cic.process(Strided::contiguous(&data), &mut out);
+        
+        assert_eq!(n, 8);
+        // 前ORDER个输出为暂态，之后为直流值
+        assert_eq!(out[7], 1000);
+    }
+    
+    /// 测试跨步视图和统计
+    #[test]
+    fn test_strided_stats() {
+        let data: [u16; 8] = [1, 100, 3, 100, 5, 100, 7, 100];
+        let mut stats = BlockStats::new();
+        stats.accumulate(Strided::new(&data, 0, 2));
+        
+        assert_eq!(stats.count(), 4);
+        assert_eq!(stats.min(), Some(1));
+        assert_eq!(stats.max(), Some(7));
+        assert_eq!(stats.mean(), 4);
+        assert_eq!(isqrt(84 / 4), stats.rms() as u32);
+    }
+}
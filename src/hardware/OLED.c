@@ -33,6 +33,72 @@ volatile uint8_t OLED_DMA_TransferComplete = 0;
 static BufferSelect active_buffer = BUFFER_A;    // 当前绘制缓冲区
 static BufferSelect display_buffer = BUFFER_A;   // 当前显示缓冲区
 
+// 脏区记录 - 每个缓冲区每页记录一个与屏幕内容不一致的列区间[Start, End)
+// Start >= End 表示该页干净,更新时只传输脏区间
+static uint8_t OLED_DirtyStart[2][OLED_PAGE_COUNT];
+static uint8_t OLED_DirtyEnd[2][OLED_PAGE_COUNT];
+
+// 标记活动缓冲区指定页的列区间[x1, x2)为脏(调用者保证参数已裁剪到屏幕范围内)
+static inline void OLED_MarkDirtySpan(uint8_t page, uint8_t x1, uint8_t x2)
+{
+    if (x1 < OLED_DirtyStart[active_buffer][page]) OLED_DirtyStart[active_buffer][page] = x1;
+    if (x2 > OLED_DirtyEnd[active_buffer][page]) OLED_DirtyEnd[active_buffer][page] = x2;
+}
+
+// 标记活动缓冲区的一个矩形区域为脏,自动裁剪到屏幕范围
+static void OLED_MarkDirtyArea(int16_t X, int16_t Y, int16_t Width, int16_t Height)
+{
+    int16_t x2 = X + Width;
+    int16_t y2 = Y + Height;
+    if (X < 0) X = 0;
+    if (Y < 0) Y = 0;
+    if (x2 > OLED_WIDTH) x2 = OLED_WIDTH;
+    if (y2 > OLED_HEIGHT) y2 = OLED_HEIGHT;
+    if (X >= x2 || Y >= y2) return;
+    
+    for (uint8_t page = Y / 8; page <= (y2 - 1) / 8; page++) {
+        OLED_MarkDirtySpan(page, X, x2);
+    }
+}
+
+// 清除指定缓冲区的全部脏区记录
+static void OLED_ResetDirty(uint8_t buffer)
+{
+    memset(OLED_DirtyStart[buffer], OLED_COLUMN_COUNT, OLED_PAGE_COUNT);
+    memset(OLED_DirtyEnd[buffer], 0, OLED_PAGE_COUNT);
+}
+
+// 屏幕内容已经更新为buffer的内容,另一个缓冲区在这些区间上与屏幕不再一致,
+// 需要把buffer的脏区合并到另一个缓冲区,然后清除buffer的脏区
+static void OLED_CommitDirty(uint8_t buffer)
+{
+#if OLED_DOUBLE_BUFFER
+    uint8_t other = buffer ^ 1;
+    for (uint8_t page = 0; page < OLED_PAGE_COUNT; page++) {
+        if (OLED_DirtyStart[buffer][page] >= OLED_DirtyEnd[buffer][page]) continue;
+        if (OLED_DirtyStart[buffer][page] < OLED_DirtyStart[other][page])
+            OLED_DirtyStart[other][page] = OLED_DirtyStart[buffer][page];
+        if (OLED_DirtyEnd[buffer][page] > OLED_DirtyEnd[other][page])
+            OLED_DirtyEnd[other][page] = OLED_DirtyEnd[buffer][page];
+    }
+#endif
+    OLED_ResetDirty(buffer);
+}
+
+/**
+  * 函    数:将整个屏幕标记为需要刷新
+  * 参    数:无
+  * 返 回 值:无
+  * 说    明:屏幕内容被外部改变(如重新上电)后调用,下一次更新将传输全部显存
+  */
+void OLED_InvalidateAll(void)
+{
+    for (uint8_t buffer = 0; buffer < 2; buffer++) {
+        memset(OLED_DirtyStart[buffer], 0, OLED_PAGE_COUNT);
+        memset(OLED_DirtyEnd[buffer], OLED_COLUMN_COUNT, OLED_PAGE_COUNT);
+    }
+}
+
 // 根据选择的I2C类型包含不同的实现
 #if OLED_I2C_TYPE == 1
 // OLED地址和超时定义
@@ -46,7 +112,13 @@ uint8_t I2C_WaitEvent(uint32_t event);
 void I2C_SendAddress(uint8_t address, uint8_t direction);
 void I2C_SendByte(uint8_t data);
 void I2C_SendBytes(const uint8_t* data, uint16_t length);
+static uint8_t OLED_StartDMABurst(const uint8_t* data, uint16_t length);
+#if OLED_DMA_SINGLE_TRANSACTION
+static uint8_t OLED_StartDMATransferFrame(uint8_t buffer_select);
+#else
 static uint8_t OLED_StartDMATransferPage(uint8_t page, uint8_t buffer_select);
+static uint8_t OLED_StartNextDirtyPage(void);
+#endif
 
 // I2C起始信号
 void I2C_Start(void)
@@ -156,6 +228,29 @@ void Write_IIC_Data(const uint8_t *Data, uint8_t Len)
     I2C_Stop();
 }
 
+#if OLED_USE_DMA && OLED_DMA_SINGLE_TRANSACTION
+// 设置水平寻址模式下的列/页地址窗口
+// 优化说明：6个命令字节在一次I2C传输中连续发送,只需要一次起始/地址阶段
+void OLED_SetWindow(uint8_t x1, uint8_t x2, uint8_t page1, uint8_t page2)
+{
+    uint8_t command[] = {0x00, 0x21, x1, x2, 0x22, page1, page2};
+    uint32_t timeout = I2C_TIMEOUT;
+    while (I2C_GetFlagStatus(OLED_IIC, I2C_FLAG_BUSY)) {
+        if (--timeout == 0) return;
+    }
+    I2C_Start();
+    I2C_SendAddress(OLED_ADDRESS, I2C_Direction_Transmitter);
+    I2C_SendBytes(command, sizeof(command));
+    I2C_Stop();
+}
+
+// 设置OLED显示位置
+// 水平寻址模式下页地址命令(0xB0)无效,改为设置从(x, y)开始的窗口,单页内写入效果与页寻址模式相同
+void OLED_Set_Pos(unsigned char x, unsigned char y)
+{
+    OLED_SetWindow(x, OLED_COLUMN_COUNT - 1, y, OLED_PAGE_COUNT - 1);
+}
+#else
 // 设置OLED显示位置
 void OLED_Set_Pos(unsigned char x, unsigned char y)
 {
@@ -163,6 +258,7 @@ void OLED_Set_Pos(unsigned char x, unsigned char y)
     Write_IIC_Command(((x & 0xf0) >> 4) | 0x10);
     Write_IIC_Command(0x00 | (x & 0x0f));
 }
+#endif
 
 #else
 /* 软件I2C实现 */
@@ -275,11 +371,31 @@ void OLED_WR_Byte(uint8_t dat, uint8_t cmd)
 volatile uint8_t current_dma_page = 0;
 volatile uint8_t current_dma_buffer = 0;
 
+// 本次传输的各页列区间快照(启动传输时从脏区记录复制)
+static uint8_t dma_span_start[OLED_PAGE_COUNT];
+static uint8_t dma_span_end[OLED_PAGE_COUNT];
+
 // DMA传输时间记录
 volatile uint32_t dma_transfer_start_time = 0;  // DMA传输开始时间
 volatile uint32_t dma_transfer_end_time = 0;    // DMA传输结束时间
 volatile float dma_last_transfer_time = 0.0f;   // 上次DMA传输用时(ms)
 
+// 结束本次帧传输：记录用时并切换显示缓冲区
+static void OLED_DMA_FinishTransfer(void)
+{
+    extern volatile uint32_t system_time;  // 从Task.c导入系统时间变量
+    dma_transfer_end_time = system_time;  // 记录结束时间
+    // 计算差值并转换为两位小数的浮点值
+    dma_last_transfer_time = (dma_transfer_end_time - dma_transfer_start_time) / 100.0f;
+    dma_last_transfer_time = ((int)(dma_last_transfer_time * 100.0f + 0.5f)) / 100.0f; // 四舍五入
+    
+    OLED_DMA_TransferBusy = 0;
+    
+    #if OLED_DOUBLE_BUFFER
+    OLED_DISPLAY_GRAM = (current_dma_buffer == 0) ? OLED_GRAM1 : OLED_GRAM2;
+    #endif
+}
+
 // DMA中断处理函数 - 优化版本
 void OLED_DMA_IRQHandler(void)
 {
@@ -297,28 +413,18 @@ void OLED_DMA_IRQHandler(void)
         DMA_Cmd(OLED_DMA_CHANNEL, DISABLE);
         I2C_DMACmd(OLED_IIC, DISABLE);
         
-        // 处理下一页
+        #if OLED_DMA_SINGLE_TRANSACTION
+        // 单次传输模式下整帧在一次DMA中完成,中断内无需重新启动I2C传输
+        OLED_DMA_FinishTransfer();
+        #else
+        // 处理下一个脏页
         current_dma_page++;
-        if (current_dma_page < OLED_PAGE_COUNT)
+        if (!OLED_StartNextDirtyPage())
         {
-            // 自动传输下一页
-            OLED_StartDMATransferPage(current_dma_page, current_dma_buffer);
-        }
-        else
-        {
-            // 所有页面传输完成
-            extern volatile uint32_t system_time;  // 从Task.c导入系统时间变量
-            dma_transfer_end_time = system_time;  // 记录结束时间
-            // 计算差值并转换为两位小数的浮点值
-            dma_last_transfer_time = (dma_transfer_end_time - dma_transfer_start_time) / 100.0f;
-            dma_last_transfer_time = ((int)(dma_last_transfer_time * 100.0f + 0.5f)) / 100.0f; // 四舍五入
-            
-            OLED_DMA_TransferBusy = 0;
-            
-            #if OLED_DOUBLE_BUFFER
-            OLED_DISPLAY_GRAM = (current_dma_buffer == 0) ? OLED_GRAM1 : OLED_GRAM2;
-            #endif
+            // 所有脏页传输完成(启动失败时同样结束本次传输)
+            OLED_DMA_FinishTransfer();
         }
+        #endif
     }
 }
 
@@ -357,18 +463,20 @@ void OLED_DMA_Init(void)
     DMA_ITConfig(OLED_DMA_CHANNEL, DMA_IT_TC, ENABLE);
 }
 
-// 启动DMA传输指定页面
-static uint8_t OLED_StartDMATransferPage(uint8_t page, uint8_t buffer_select)
+// 获取指定缓冲区的显存首地址
+static inline const uint8_t* OLED_GetBufferBase(uint8_t buffer_select)
+{
+    #if OLED_DOUBLE_BUFFER
+    return (buffer_select == 0) ? &OLED_GRAM1[0][0] : &OLED_GRAM2[0][0];
+    #else
+    // 单缓冲区模式
+    return &OLED_GRAM[0][0];
+    #endif
+}
+
+// 发送起始信号、地址和数据控制字节,然后由DMA连续发送length字节显存数据
+static uint8_t OLED_StartDMABurst(const uint8_t* data, uint16_t length)
 {
-    // 仅在第一页时记录开始时间
-    if (page == 0) {
-        extern volatile uint32_t system_time;  // 从Task.c导入系统时间变量
-        dma_transfer_start_time = system_time;  // 记录开始时间
-    }
-    
-    // 设置显示位置
-    OLED_Set_Pos(0, page);
-    
     // 等待总线空闲
     uint32_t timeout = I2C_TIMEOUT;
     while (I2C_GetFlagStatus(OLED_IIC, I2C_FLAG_BUSY)) 
@@ -396,18 +504,8 @@ static uint8_t OLED_StartDMATransferPage(uint8_t page, uint8_t buffer_select)
     DMA_Cmd(OLED_DMA_CHANNEL, DISABLE);
     
     // 设置传输长度和源地址
-    OLED_DMA_CHANNEL->CNDTR = OLED_COLUMN_COUNT;  // 传输128字节
-    
-    #if OLED_DOUBLE_BUFFER
-    // 根据缓冲区选择设置源地址
-    if (buffer_select == 0)
-        OLED_DMA_CHANNEL->CMAR = (uint32_t)OLED_GRAM1[page];
-    else
-        OLED_DMA_CHANNEL->CMAR = (uint32_t)OLED_GRAM2[page];
-    #else
-    // 单缓冲区模式
-    OLED_DMA_CHANNEL->CMAR = (uint32_t)OLED_GRAM[page];
-    #endif
+    OLED_DMA_CHANNEL->CNDTR = length;
+    OLED_DMA_CHANNEL->CMAR = (uint32_t)data;
     
     // 清除传输完成标志
     OLED_DMA_TransferComplete = 0;
@@ -418,6 +516,71 @@ static uint8_t OLED_StartDMATransferPage(uint8_t page, uint8_t buffer_select)
     
     return 1; // 成功启动
 }
+
+#if !OLED_DMA_SINGLE_TRANSACTION
+// 从current_dma_page开始查找下一个脏页并启动传输
+// 返回值：1-已启动传输，0-没有剩余脏页或启动失败
+static uint8_t OLED_StartNextDirtyPage(void)
+{
+    while (current_dma_page < OLED_PAGE_COUNT &&
+           dma_span_start[current_dma_page] >= dma_span_end[current_dma_page]) {
+        current_dma_page++;
+    }
+    
+    if (current_dma_page >= OLED_PAGE_COUNT)
+        return 0;
+    
+    return OLED_StartDMATransferPage(current_dma_page, current_dma_buffer);
+}
+
+// 启动DMA传输指定页面的脏区间
+static uint8_t OLED_StartDMATransferPage(uint8_t page, uint8_t buffer_select)
+{
+    uint8_t x = dma_span_start[page];
+    
+    // 设置显示位置(窗口起始列)
+    OLED_Set_Pos(x, page);
+    
+    // 只传输脏区间
+    return OLED_StartDMABurst(OLED_GetBufferBase(buffer_select) + page * OLED_COLUMN_COUNT + x,
+                              dma_span_end[page] - x);
+}
+
+#else
+// 单次传输模式：水平寻址模式下只设置一次列/页地址窗口,所有脏页在一次DMA中发送
+// 只有一页脏时窗口收缩到该页的脏区间；多页脏时窗口为整行宽度,
+// 此时显存中从起始脏页到结束脏页是连续的,可以直接作为一次DMA的数据源
+static uint8_t OLED_StartDMATransferFrame(uint8_t buffer_select)
+{
+    uint8_t first_page = OLED_PAGE_COUNT;
+    uint8_t last_page = 0;
+    
+    for (uint8_t page = 0; page < OLED_PAGE_COUNT; page++) {
+        if (dma_span_start[page] < dma_span_end[page]) {
+            if (first_page == OLED_PAGE_COUNT) first_page = page;
+            last_page = page;
+        }
+    }
+    
+    if (first_page == OLED_PAGE_COUNT)
+        return 0;
+    
+    uint8_t x1 = 0;
+    uint8_t x2 = OLED_COLUMN_COUNT;
+    if (first_page == last_page) {
+        x1 = dma_span_start[first_page];
+        x2 = dma_span_end[first_page];
+    }
+    
+    OLED_SetWindow(x1, x2 - 1, first_page, last_page);
+    
+    uint16_t length = (first_page == last_page) ? (x2 - x1)
+                    : (uint16_t)(last_page - first_page + 1) * OLED_COLUMN_COUNT;
+    
+    return OLED_StartDMABurst(OLED_GetBufferBase(buffer_select) + first_page * OLED_COLUMN_COUNT + x1,
+                              length);
+}
+#endif
 #endif
 
 // 初始化SSD1306控制器(实际为I2C初始化)
@@ -485,20 +648,38 @@ void OLED_Init(void)
     OLED_WR_Byte(0x49, OLED_CMD);
     OLED_WR_Byte(0x8d, OLED_CMD); // 启用电荷泵
     OLED_WR_Byte(0x14, OLED_CMD); // 启用电荷泵
+#if OLED_I2C_TYPE == 1 && OLED_USE_DMA && OLED_DMA_SINGLE_TRANSACTION
+    OLED_WR_Byte(0x20, OLED_CMD); // 设置内存寻址模式
+    OLED_WR_Byte(0x00, OLED_CMD); // 水平寻址模式,整帧可在一次传输中写入
+#endif
     OLED_WR_Byte(0xaf, OLED_CMD); // 开OLED显示
 	
 	#if OLED_I2C_TYPE == 1 && OLED_USE_DMA
 		OLED_DMA_Init();  // 仅在启用DMA时初始化
 	#endif
+	
+	// 上电后屏幕内部显存内容不确定,第一次更新需要传输全部内容
+	OLED_InvalidateAll();
 }
 
 // 清空OLED显示
 // 优化说明：使用memset函数一次性清零整个显存区域，提高清空效率
+// 脏区说明：只有原本非零的字节会被改变,因此每页只把非零字节所在的列区间标记为脏,
+// 每帧先清屏再重绘时不会把整屏都标记为需要传输
 void OLED_Clear(void)
 {
-    // 使用memset直接清空整个活动缓冲区(8页×128列=1024字节)
-    // 比双重循环逐字节清零更高效，尤其在编译器优化开启时
-    memset(OLED_GRAM, 0x00, OLED_PAGE_COUNT * OLED_COLUMN_COUNT);
+    for (uint8_t page = 0; page < OLED_PAGE_COUNT; page++) {
+        uint8_t* gramPage = OLED_GRAM[page];
+        uint8_t x1 = 0;
+        uint8_t x2 = OLED_COLUMN_COUNT;
+        
+        while (x1 < OLED_COLUMN_COUNT && gramPage[x1] == 0) x1++;
+        if (x1 == OLED_COLUMN_COUNT) continue;  // 整页已经为空
+        while (gramPage[x2 - 1] == 0) x2--;
+        
+        memset(gramPage + x1, 0x00, x2 - x1);
+        OLED_MarkDirtySpan(page, x1, x2);
+    }
 }
 
 // 将OLED显存数组更新到OLED屏幕
@@ -518,11 +699,15 @@ void OLED_Update(void)
     OLED_UpdateAsync();
     while (OLED_DMA_TransferBusy);
 #elif OLED_I2C_TYPE == 1
-    // 使用普通更新(优化版)
+    // 使用普通更新(优化版) - 只传输脏区间
     uint8_t j;
     for (j = 0; j < OLED_PAGE_COUNT; j++)
     {
-        OLED_Set_Pos(0, j);
+        uint8_t x1 = OLED_DirtyStart[active_buffer][j];
+        uint8_t x2 = OLED_DirtyEnd[active_buffer][j];
+        if (x1 >= x2) continue;  // 该页没有变化
+        
+        OLED_Set_Pos(x1, j);
         
         // 等待总线空闲
         uint32_t timeout = I2C_TIMEOUT;
@@ -540,11 +725,11 @@ void OLED_Update(void)
         
         // 优化：使用指针访问显存，减少数组索引计算
         const uint8_t* gramPage = OLED_GRAM[j];
-        for (int i = 0; i < OLED_COLUMN_COUNT; i++) {
+        for (int i = x1; i < x2; i++) {
             I2C_SendData(OLED_IIC, gramPage[i]);
             
             // 优化：使用位运算替代条件分支
-            if (i == OLED_COLUMN_COUNT - 1) {
+            if (i == x2 - 1) {
                 if (!I2C_WaitEvent(I2C_EVENT_MASTER_BYTE_TRANSMITTED)) {
                     break;
                 }
@@ -557,19 +742,25 @@ void OLED_Update(void)
         
         I2C_Stop();
     }
+    OLED_ResetDirty(active_buffer);
 #else
-	// 软件I2C模式 - 优化：使用页指针
+	// 软件I2C模式 - 优化：使用页指针,只传输脏区间
     uint8_t page;
     for(page = 0; page < OLED_PAGE_COUNT; page++) {
-        OLED_Set_Pos(0, page);
+        uint8_t x1 = OLED_DirtyStart[active_buffer][page];
+        uint8_t x2 = OLED_DirtyEnd[active_buffer][page];
+        if (x1 >= x2) continue;  // 该页没有变化
+        
+        OLED_Set_Pos(x1, page);
         // 使用软件I2C的Write_IIC_Data函数，直接传递显存页地址
-        Write_IIC_Data(OLED_GRAM[page], OLED_COLUMN_COUNT);
+        Write_IIC_Data(&OLED_GRAM[page][x1], x2 - x1);
     }
+    OLED_ResetDirty(active_buffer);
 #endif
 }
 
-// 非阻塞式更新 - 启动DMA传输但不等待完成
-// 返回值：1-成功启动传输，0-传输已在进行中
+// 非阻塞式更新 - 启动DMA传输但不等待完成,只传输脏区间
+// 返回值：1-成功启动传输(或没有需要传输的内容)，0-传输已在进行中
 uint8_t OLED_UpdateAsync(void)
 {
 #if OLED_USE_DMA && OLED_I2C_TYPE == 1
@@ -577,7 +768,23 @@ uint8_t OLED_UpdateAsync(void)
     if (OLED_DMA_TransferBusy)
         return 0;
     
+    // 复制脏区快照,传输期间绘制到另一个缓冲区不会影响本次传输
+    uint8_t dirty = 0;
+    for (uint8_t page = 0; page < OLED_PAGE_COUNT; page++) {
+        dma_span_start[page] = OLED_DirtyStart[active_buffer][page];
+        dma_span_end[page] = OLED_DirtyEnd[active_buffer][page];
+        if (dma_span_start[page] < dma_span_end[page]) dirty = 1;
+    }
+    
+    // 屏幕已是最新内容,无需传输也无需切换缓冲区
+    if (!dirty)
+        return 1;
+    
     OLED_DMA_TransferBusy = 1;
+    OLED_CommitDirty(active_buffer);
+    
+    extern volatile uint32_t system_time;  // 从Task.c导入系统时间变量
+    dma_transfer_start_time = system_time;  // 记录开始时间
     
 #if OLED_DOUBLE_BUFFER
     // 设置要传输的缓冲区（当前活动缓冲区）
@@ -599,7 +806,11 @@ uint8_t OLED_UpdateAsync(void)
     
     current_dma_page = 0;
     
-    if (!OLED_StartDMATransferPage(0, current_dma_buffer))
+#if OLED_DMA_SINGLE_TRANSACTION
+    if (!OLED_StartDMATransferFrame(current_dma_buffer))
+#else
+    if (!OLED_StartNextDirtyPage())
+#endif
     {
         OLED_DMA_TransferBusy = 0;
         return 0;
@@ -934,6 +1145,8 @@ void OLED_DrawLineChart(int16_t x0, int16_t y0, int16_t width, int16_t height,
 // 3. 考虑使用编译器优化的循环展开
 void OLED_Reverse(void)
 {
+	OLED_MarkDirtyArea(0, 0, OLED_WIDTH, OLED_HEIGHT);
+	
 	// 使用指针访问显存，减少数组索引计算
 	for (uint8_t j = 0; j < OLED_PAGE_COUNT; j++) {
 		uint8_t* gramPage = OLED_GRAM[j];
@@ -1176,6 +1389,8 @@ void OLED_ReverseArea(int16_t X, int16_t Y, uint8_t Width, uint8_t Height)
 	if (X + Width > 128) {Width = 128 - X;}
 	if (Y + Height > 64) {Height = 64 - Y;}
 	
+	OLED_MarkDirtyArea(X, Y, Width, Height);
+	
 	// 计算起始页和结束页
 	uint8_t startPage = Y / 8;
 	uint8_t endPage = (Y + Height - 1) / 8;
@@ -1221,6 +1436,8 @@ void OLED_ClearArea(int16_t X, int16_t Y, uint8_t Width, uint8_t Height)
 	if (X + Width > 128) {Width = 128 - X;}
 	if (Y + Height > 64) {Height = 64 - Y;}
 	
+	OLED_MarkDirtyArea(X, Y, Width, Height);
+	
 	// 计算起始页和结束页
 	uint8_t startPage = Y / 8;
 	uint8_t endPage = (Y + Height - 1) / 8;
@@ -1312,6 +1529,13 @@ void OLED_ShowImage(int16_t X, int16_t Y, uint8_t Width, uint8_t Height, const u
     // 计算需要处理的页数
     uint8_t pageCount = (displayHeight + destStartBit + 7) / 8;
     
+    // 记录脏区(有位偏移时第一页的数据可能溢出到下一页)
+    uint8_t destEndPage = destStartPage + pageCount - 1 + (destStartBit ? 1 : 0);
+    if (destEndPage >= OLED_PAGE_COUNT) destEndPage = OLED_PAGE_COUNT - 1;
+    for (uint8_t page = destStartPage; page <= destEndPage; page++) {
+        OLED_MarkDirtySpan(page, displayX, displayX + displayWidth);
+    }
+    
     // 预计算图像总大小，用于边界检查
     uint16_t totalImageSize = (uint16_t)Width * Height;
     
@@ -1388,179 +1612,224 @@ void OLED_ShowImage(int16_t X, int16_t Y, uint8_t Width, uint8_t Height, const u
 }
     
 
-/**
-  * 函    数:OLED使用printf函数打印格式化字符串
-  * 参    数:X 指定格式化字符串左上角的横坐标,范围:0~127
-  * 参    数:Y 指定格式化字符串左上角的纵坐标,范围:0~63
-  * 参    数:FontSize 指定字体大小
-  *           范围:OLED_8X16		宽8像素,高16像素
-  *                 OLED_6X8		宽6像素,高8像素
-  * 参    数:format 指定要显示的格式化字符串,范围:ASCII码可见字符组成的字符串
-  * 参    数:... 格式化字符串参数列表
-  * 返 回 值:无
-  * 说    明:调用此函数后,要想真正地呈现在屏幕上,还需调用更新函数
-  */
-// ASCII字符快速渲染函数 - 直接操作OLED_GRAM (优化版) - 内联优化
-static inline void OLED_DrawASCIIFast(int16_t x, int16_t y, char c, uint8_t fontHeight) {
-    // 参数边界检查 - 使用早期返回模式减少嵌套
-    if (x < 0 || x >= 128 || y < 0 || y >= 64 || c < ' ' || c > '~') {
-        return;
-    }
+/*文本串渲染---------------------------------------------------------------------*/
+/*一段连续的ASCII字符作为一个文本串渲染:裁剪和脏区记录只在开头做一次。
+  字形每列拼成32位后按纵向位偏移一次移位,拆成逐页的字节;移位结果放在按字符
+  直接映射的小缓存中,同一Y偏移下重复出现的字符直接复用*/
+
+// 预移位字形缓存项
+typedef struct {
+    char c;                 // 缓存的字符,0表示空
+    uint8_t fontSize;       // 字体高度
+    uint8_t bitOffset;      // 纵向位偏移
+    uint8_t data[3][8];     // 移位后按目标页拆分的字形列
+} OLED_ShiftedGlyph;
+
+static OLED_ShiftedGlyph OLED_GlyphCache[OLED_GLYPH_CACHE_SIZE];
+
+// 取得按bitOffset移位后的字形,不可打印字符返回NULL
+static const OLED_ShiftedGlyph* OLED_GetShiftedGlyph(char c, uint8_t fontSize, uint8_t bitOffset)
+{
+    if (c < ' ' || c > '~') return NULL;
     
-    // 预计算常用值
-    uint8_t pageStart = y / 8;
-    uint8_t bitOffset = y % 8;
+    OLED_ShiftedGlyph* glyph = &OLED_GlyphCache[(uint8_t)c % OLED_GLYPH_CACHE_SIZE];
+    if (glyph->c == c && glyph->fontSize == fontSize && glyph->bitOffset == bitOffset) {
+        return glyph;
+    }
     
-    if (fontHeight == 16) {
-        // 快速渲染8x16字体
-        const uint8_t* fontData = OLED_F8x16[c - ' '];
-        uint8_t pageCount = 2; // 16像素高，需要2页
-        uint8_t page, col;
-        uint8_t* gramPtr; // 显存指针加速访问
-        
-        for (page = 0; page < pageCount; page++) {
-            uint8_t destPage = pageStart + page;
-            if (destPage >= 8) break;
-            
-            gramPtr = OLED_GRAM[destPage] + x; // 指向当前页的起始位置
-            
-            for (col = 0; col < 8; col++) {
-                if (x + col >= 128) break;
-                
-                uint8_t data = fontData[page * 8 + col];
-                // 考虑垂直偏移
-                if (bitOffset > 0 && page == 0) {
-                    *gramPtr++ |= data << bitOffset;
-                    // 如果有数据溢出到下一页
-                    if (destPage + 1 < 8 && (data >> (8 - bitOffset)) != 0) {
-                        OLED_GRAM[destPage + 1][x + col] |= data >> (8 - bitOffset);
-                    }
-                } else {
-                    *gramPtr++ |= data;
-                }
-            }
-        }
-    } else if (fontHeight == 8) {
-        // 快速渲染6x8字体 - 内联常用计算
-        const uint8_t* fontData = OLED_F6x8[c - ' '];
-        uint8_t destPage = pageStart;
-        uint8_t col;
-        uint8_t* gramPtr = OLED_GRAM[destPage] + x; // 指向当前页的起始位置
-        
-        for (col = 0; col < 6; col++) {
-            if (x + col >= 128) break;
-            
-            uint8_t data = fontData[col];
-            // 考虑垂直偏移
-            if (bitOffset > 0) {
-                *gramPtr++ |= data << bitOffset;
-                // 如果有数据溢出到下一页
-                if (destPage + 1 < 8 && (data >> (8 - bitOffset)) != 0) {
-                    OLED_GRAM[destPage + 1][x + col] |= data >> (8 - bitOffset);
-                }
-            } else {
-                *gramPtr++ |= data;
-            }
+    uint8_t width = (fontSize == 16) ? 8 : 6;
+    for (uint8_t col = 0; col < width; col++) {
+        uint32_t column;
+        if (fontSize == 16) {
+            column = OLED_F8x16[c - ' '][col] | ((uint32_t)OLED_F8x16[c - ' '][8 + col] << 8);
+        } else {
+            column = OLED_F6x8[c - ' '][col];
         }
+        column <<= bitOffset;
+        glyph->data[0][col] = (uint8_t)column;
+        glyph->data[1][col] = (uint8_t)(column >> 8);
+        glyph->data[2][col] = (uint8_t)(column >> 16);
     }
+    glyph->c = c;
+    glyph->fontSize = fontSize;
+    glyph->bitOffset = bitOffset;
+    return glyph;
 }
 
-// 快速检查字符串是否只包含ASCII字符 - 内联优化
-static inline bool OLED_IsPureASCII(const char* str) {
-    while (*str) {
-        if ((*str & 0x80) != 0) {
-            return false;
+// 渲染一段ASCII字符(不含换行),返回文本串之后的横坐标;坐标可以部分超出屏幕
+static int16_t OLED_DrawTextRun(int16_t X, int16_t Y, const char* str, uint8_t len, uint8_t fontSize)
+{
+    uint8_t width = (fontSize == 16) ? 8 : 6;
+    int16_t next = X + (int16_t)len * width;
+    
+    /*整串裁剪*/
+    if (len == 0 || X >= OLED_WIDTH || next <= 0 || Y >= OLED_HEIGHT || Y + fontSize <= 0) {
+        return next;
+    }
+    
+    uint8_t first = 0;
+    int16_t x = X;
+    if (x < 0) {
+        first = (-x) / width;       // 跳过完全在左侧之外的字符
+        x += first * width;
+    }
+    uint8_t xStart = (x < 0) ? 0 : x;
+    uint8_t xEnd = (next > OLED_WIDTH) ? OLED_WIDTH : next;
+    
+    /*Y可以为负,先平移到非负再求页号和位偏移*/
+    int8_t pageStart = (Y + OLED_HEIGHT) / 8 - OLED_PAGE_COUNT;
+    uint8_t bitOffset = (Y + OLED_HEIGHT) % 8;
+    uint8_t pages = (bitOffset + fontSize + 7) / 8;
+    uint8_t kFirst = (pageStart < 0) ? -pageStart : 0;
+    uint8_t kLast = (pageStart + pages > OLED_PAGE_COUNT) ? OLED_PAGE_COUNT - pageStart : pages;
+    
+    for (uint8_t k = kFirst; k < kLast; k++) {
+        OLED_MarkDirtySpan(pageStart + k, xStart, xEnd);
+    }
+    
+    for (uint8_t i = first; i < len && x < OLED_WIDTH; i++, x += width) {
+        const OLED_ShiftedGlyph* glyph = OLED_GetShiftedGlyph(str[i], fontSize, bitOffset);
+        if (glyph == NULL) continue;
+        
+        // 首尾字符可能只有部分列在屏幕内
+        uint8_t c0 = (x < 0) ? -x : 0;
+        uint8_t c1 = (x + width > OLED_WIDTH) ? OLED_WIDTH - x : width;
+        for (uint8_t k = kFirst; k < kLast; k++) {
+            uint8_t* row = OLED_GRAM[pageStart + k];
+            const uint8_t* src = glyph->data[k];
+            for (uint8_t col = c0; col < c1; col++) {
+                row[x + col] |= src[col];
+            }
         }
-        str++;
     }
-    return true;
+    return next;
 }
 
-// 汉字哈希表结构 - 优化版
-typedef struct {
-    const char* name;           // 汉字的名称
-    const uint8_t* data;        // 汉字的点阵数据
-    uint8_t isUsed;             // 该哈希表项是否被使用
-} ChineseCharHashTable;
-
-// 定义哈希表大小，选择质数以减少冲突
-#define HASH_TABLE_SIZE 131
-
-// 声明静态哈希表和初始化标志
-static ChineseCharHashTable chineseHashTable[HASH_TABLE_SIZE] = {0};
-static uint8_t isHashTableInitialized = 0;
-
-// 字符串哈希函数 - 针对UTF-8编码汉字优化 - 内联优化
-static inline uint16_t OLED_HashString(const char* str) {
-    uint16_t hash = 0;
-    // 处理UTF-8编码的汉字（通常占3个字节）
-    for (uint8_t i = 0; i < OLED_CHN_CHAR_WIDTH && str[i] != '\0'; i++) {
-        hash = (hash * 31) + (unsigned char)str[i];
+// UTF-8解码 - 内联优化
+// 返回字符的Unicode码点,并通过length返回占用的字节数；非法或不完整的序列返回0,length为1
+static inline uint32_t OLED_DecodeUTF8(const char* str, uint8_t* length) {
+    const uint8_t* s = (const uint8_t*)str;
+    
+    if (s[0] < 0x80) {
+        *length = 1;
+        return s[0];
     }
-    return hash % HASH_TABLE_SIZE;
+    if ((s[0] & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80) {
+        *length = 2;
+        return ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+    }
+    if ((s[0] & 0xF0) == 0xE0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+        *length = 3;
+        return ((uint32_t)(s[0] & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+    }
+    if ((s[0] & 0xF8) == 0xF0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) {
+        *length = 4;
+        return ((uint32_t)(s[0] & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) |
+               ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+    }
+    
+    *length = 1;
+    return 0;
 }
 
-// 初始化汉字哈希表
-static void OLED_InitChineseHashTable(void) {
-    if (isHashTableInitialized) return;
-    
-    // 清空哈希表
-    memset(chineseHashTable, 0, sizeof(chineseHashTable));
+// 按码点查找汉字点阵数据
+// 优化说明：在Flash中按码点升序排列的索引表上二分查找,无需RAM哈希表和首次调用初始化,也不需要字符串比较
+static const uint8_t* OLED_FindChineseChar(uint32_t codepoint) {
+    uint16_t low = 0;
+    uint16_t high = OLED_CF16x16_INDEX_COUNT;
     
-    // 遍历汉字字模库，将汉字添加到哈希表
-    // 注意：使用NULL检查而不是strcmp来避免处理NULL指针
-    for (uint8_t i = 0; OLED_CF16x16[i].Name != NULL && OLED_CF16x16[i].Name[0] != '\0'; i++) {
-        uint16_t hash = OLED_HashString(OLED_CF16x16[i].Name);
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        uint16_t key = OLED_CF16x16_INDEX[mid].Codepoint;
         
-        // 线性探测解决冲突
-        uint8_t attempts = 0;
-        while (chineseHashTable[hash].isUsed && attempts < HASH_TABLE_SIZE) {
-            hash = (hash + 1) % HASH_TABLE_SIZE;
-            attempts++;
-        }
-        
-        // 如果找到空位，添加到哈希表
-        if (!chineseHashTable[hash].isUsed) {
-            chineseHashTable[hash].name = OLED_CF16x16[i].Name;
-            chineseHashTable[hash].data = OLED_CF16x16[i].Data;
-            chineseHashTable[hash].isUsed = 1;
+        if (key == codepoint) {
+            return OLED_CF16x16[OLED_CF16x16_INDEX[mid].Index].Data;
+        } else if (key < codepoint) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
     
-    isHashTableInitialized = 1;
+    return NULL;  // 未找到
 }
 
-// 通过哈希表快速查找汉字点阵数据
-static const uint8_t* OLED_FindChineseChar(const char* chineseChar) {
-    if (!isHashTableInitialized) {
-        OLED_InitChineseHashTable();
-    }
-    
-    // 确保输入不是NULL
-    if (chineseChar == NULL || chineseChar[0] == '\0') {
+/**
+  * 函    数:查找汉字字模
+  * 参    数:ch 指向UTF-8编码汉字的指针
+  * 返 回 值:汉字的16x16点阵数据,字模库中没有该汉字时返回NULL
+  */
+const uint8_t *OLED_FindChinese(const char *ch) {
+    if (ch == NULL || ch[0] == '\0') {
         return NULL;
     }
     
-    uint16_t hash = OLED_HashString(chineseChar);
+    uint8_t length;
+    uint32_t codepoint = OLED_DecodeUTF8(ch, &length);
+    return (codepoint != 0) ? OLED_FindChineseChar(codepoint) : NULL;
+}
+
+// 渲染字符串:连续的ASCII字符按文本串整段渲染,汉字按码点查找字模
+static void OLED_DrawString(int16_t X, int16_t Y, uint8_t FontSize, const char* str)
+{
+    uint8_t lineHeight = (FontSize == 16) ? 16 : 8;
+    uint8_t charWidth = (lineHeight == 16) ? 8 : 6;
+    int16_t currentX = X;
+    int16_t currentY = Y;
+    const char* strPtr = str;
     
-    // 线性探测查找
-    uint8_t attempts = 0;
-    while (chineseHashTable[hash].isUsed && attempts < HASH_TABLE_SIZE) {
-        // 安全地比较哈希表中存储的汉字名称
-        if (chineseHashTable[hash].name != NULL) {
-            // 对于汉字，我们只比较前2-3个字符，因为字模库中的汉字通常是2字节表示
-            // 注意：这取决于实际的编码方式和字模库的设计
-            if (strncmp(chineseHashTable[hash].name, chineseChar, 3) == 0) {
-                return chineseHashTable[hash].data;
+    while (*strPtr != '\0') {
+        if (*strPtr == '\n') {
+            // 处理换行符
+            currentY += lineHeight;
+            currentX = X;
+            strPtr++;
+        } else if (*strPtr == '\r') {
+            // 处理回车符
+            currentX = X;
+            strPtr++;
+        } else if ((*strPtr & 0x80) == 0) {
+            // 到换行或非ASCII字符为止作为一个文本串
+            const char* runStart = strPtr;
+            while (*strPtr != '\0' && (*strPtr & 0x80) == 0 && *strPtr != '\n' && *strPtr != '\r' &&
+                   strPtr - runStart < 255) {
+                strPtr++;
             }
+            currentX = OLED_DrawTextRun(currentX, currentY, runStart, strPtr - runStart, lineHeight);
+        } else {  // 非ASCII字符处理
+            // 先解码出码点,再在索引表中查找汉字
+            uint8_t length;
+            uint32_t codepoint = OLED_DecodeUTF8(strPtr, &length);
+            const uint8_t* chineseData = (codepoint != 0) ? OLED_FindChineseChar(codepoint) : NULL;
+            
+            if (currentX >= 0 && currentY >= 0 && chineseData != NULL) {
+                // 显示找到的汉字
+                OLED_ShowImage(currentX, currentY, 16, 16, chineseData);
+                currentX += 16;
+            } else if (codepoint != 0) {
+                // 字模库中没有该字符,留出一个全角字符的空白
+                currentX += 16;
+            } else {
+                // 非法的UTF-8字节,按一个半角字符跳过
+                currentX += charWidth;
+            }
+            strPtr += length;
         }
-        hash = (hash + 1) % HASH_TABLE_SIZE;
-        attempts++;
     }
-    
-    return NULL;  // 未找到
 }
 
+/**
+  * 函    数:OLED使用printf函数打印格式化字符串
+  * 参    数:X 指定格式化字符串左上角的横坐标,范围:0~127
+  * 参    数:Y 指定格式化字符串左上角的纵坐标,范围:0~63
+  * 参    数:FontSize 指定字体大小
+  *           范围:OLED_8X16		宽8像素,高16像素
+  *                 OLED_6X8		宽6像素,高8像素
+  * 参    数:format 指定要显示的格式化字符串,范围:ASCII码可见字符组成的字符串
+  * 参    数:... 格式化字符串参数列表
+  * 返 回 值:无
+  * 说    明:调用此函数后,要想真正地呈现在屏幕上,还需调用更新函数
+  */
 // 优化的OLED_Printf函数 - 更高效的字符串处理
 void OLED_Printf(int16_t X, int16_t Y, uint8_t FontSize, const char *format, ...) {
     /*参数检查,保证指定位置不会超出屏幕范围*/
@@ -1572,12 +1841,6 @@ void OLED_Printf(int16_t X, int16_t Y, uint8_t FontSize, const char *format, ...
     /*参数检查,确保格式化字符串指针有效*/
     if (format == NULL) return;
     
-    // 预计算常用值 - 避免重复计算
-    uint8_t lineHeight = (FontSize == 16) ? 16 : 8;
-    uint8_t charWidth = (lineHeight == 16) ? 8 : 6;
-    int16_t currentX = X;
-    int16_t currentY = Y;
-    
     // 使用较小的缓冲区以减少内存占用
     char String[128];  
     va_list arg;
@@ -1585,80 +1848,37 @@ void OLED_Printf(int16_t X, int16_t Y, uint8_t FontSize, const char *format, ...
     vsnprintf(String, sizeof(String), format, arg);  // 使用vsnprintf避免缓冲区溢出
     va_end(arg);
 
-    // 快速路径：纯ASCII字符串 - 内联常用操作
-    if (OLED_IsPureASCII(String)) {
-        char* strPtr = String; // 使用指针直接访问字符串
-        while (*strPtr != '\0') {
-            if (*strPtr == '\n') {
-                // 处理换行符
-                currentY += lineHeight;
-                currentX = X;
-                strPtr++;
-                continue;
-            } else if (*strPtr == '\r') {
-                // 处理回车符
-                currentX = X;
-                strPtr++;
-                continue;
-            }
-            
-            // 使用快速ASCII渲染函数
-            OLED_DrawASCIIFast(currentX, currentY, *strPtr, lineHeight);
-            
-            // 更新X坐标 - 使用预计算的字符宽度
-            currentX += charWidth;
-            strPtr++;
-        }
-        return; // 快速路径结束，避免不必要的处理
-    }
+    OLED_DrawString(X, Y, FontSize, String);
+}
 
-    // 标准路径：包含非ASCII字符的情况 - 优化字符类型判断
-    char* strPtr = String;
-    while (*strPtr != '\0') {
-        if ((*strPtr & 0x80) == 0) {  // ASCII字符
-            if (*strPtr == '\n') {
-                // 处理换行符
-                currentY += lineHeight;
-                currentX = X;
-                strPtr++;
-                continue;
-            } else if (*strPtr == '\r') {
-                // 处理回车符
-                currentX = X;
-                strPtr++;
-                continue;
-            }
-            
-            // 使用快速ASCII渲染函数
-            OLED_DrawASCIIFast(currentX, currentY, *strPtr, lineHeight);
-            
-            // 更新X坐标
-            currentX += charWidth;
-            strPtr++;
-        } else {  // 非ASCII字符处理
-            // 尝试使用哈希表查找汉字
-            const uint8_t* chineseData = OLED_FindChineseChar(strPtr);
-            
-            if (currentX >= 0 && currentY >= 0 && chineseData != NULL) {
-                // 显示找到的汉字
-                OLED_ShowImage(currentX, currentY, 16, 16, chineseData);
-                currentX += 16;
-                // 跳过当前汉字（假设汉字在字模库中占2个字节）
-                // 注意：这里需要根据实际字模库的编码方式调整
-                if(strlen(strPtr) >= 3 && (strPtr[0] & 0x80) && (strPtr[1] & 0x80)) {
-                    strPtr += 3;
-                } else {
-                    // 如果不是标准的两字节汉字，至少跳过一个字节
-                    strPtr++;
-                }
-            } else {
-                // 如果没有找到汉字，尝试按字节处理
-                // 显示一个占位符或直接跳过
-                currentX += charWidth;
-                strPtr++;
-            }
-        }
-    }
+/**
+  * 函    数:OLED显示字符串
+  * 参    数:X 指定字符串左上角的横坐标,可以部分超出屏幕
+  * 参    数:Y 指定字符串左上角的纵坐标,可以部分超出屏幕
+  * 参    数:str 指定要显示的字符串,支持ASCII可见字符、换行和字模库中的汉字(UTF-8)
+  * 参    数:FontSize 指定字体大小,OLED_8X16或OLED_6X8
+  * 返 回 值:无
+  * 说    明:调用此函数后,要想真正地呈现在屏幕上,还需调用更新函数
+  */
+void OLED_ShowString(int16_t X, int16_t Y, const char *str, uint8_t FontSize)
+{
+    if (str == NULL || (FontSize != 8 && FontSize != 16)) return;
+    OLED_DrawString(X, Y, FontSize, str);
+}
+
+/**
+  * 函    数:OLED显示一个ASCII字符
+  * 参    数:X 指定字符左上角的横坐标,可以部分超出屏幕
+  * 参    数:Y 指定字符左上角的纵坐标,可以部分超出屏幕
+  * 参    数:c 指定要显示的字符,范围:ASCII可见字符
+  * 参    数:FontSize 指定字体大小,OLED_8X16或OLED_6X8
+  * 返 回 值:无
+  * 说    明:调用此函数后,要想真正地呈现在屏幕上,还需调用更新函数
+  */
+void OLED_ShowChar(int16_t X, int16_t Y, char c, uint8_t FontSize)
+{
+    if (FontSize != 8 && FontSize != 16) return;
+    OLED_DrawTextRun(X, Y, &c, 1, FontSize);
 }
 
 
@@ -1674,6 +1894,8 @@ static inline void OLED_DrawPoint(int16_t X, int16_t Y, uint8_t Color)
 	/*参数检查,保证指定位置不会超出屏幕范围*/
 	OLED_CHECK_COORDINATES(X, Y);
 	
+	OLED_MarkDirtySpan(Y / 8, X, X + 1);
+	
 	/*根据颜色参数设置或清除显存数组指定位置的一个Bit数据*/
 	if (Color == OLED_COLOR_WHITE) {
 		OLED_GRAM[Y / 8][X] |= 0x01 << (Y % 8);  // 设置位为1
@@ -1682,58 +1904,127 @@ static inline void OLED_DrawPoint(int16_t X, int16_t Y, uint8_t Color)
 	}
 }
 
-/**
-  * 函    数:判断指定点是否在指定多边形内部
-  * 参    数:nvert 多边形的顶点数
-  * 参    数:vertx verty 包含多边形顶点的x和y坐标的数组
-  * 参    数:testx testy 测试点的X和y坐标
-  * 返 回 值:指定点是否在指定多边形内部,1:在内部,0:不在内部
-  */
-static inline uint8_t OLED_pnpoly(uint8_t nvert, int16_t *vertx, int16_t *verty, int16_t testx, int16_t testy)
+/*填充光栅化核心----------------------------------------------------------------*/
+/*显存按页组织,每个字节是一列中纵向的8个像素,填充图形按列拆成纵向区间,
+  每个区间在每页只需一次字节读改写;矩形跨越的整页直接memset*/
+
+// 页内从第n位开始到第7位的掩码
+static const uint8_t OLED_PageMaskFrom[8] = {0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80};
+// 页内从第0位开始到第n位的掩码
+static const uint8_t OLED_PageMaskTo[8] = {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF};
+
+// 填充矩形区域[x1, x2] x [y1, y2](闭区间),自动裁剪到屏幕范围
+static void OLED_FillSpanRect(int16_t x1, int16_t x2, int16_t y1, int16_t y2)
 {
-	int16_t i, j, c = 0;
-	
-	/*此算法由W. Randolph Franklin提出*/
-	/*参考链接:https://wrfranklin.org/Research/Short_Notes/pnpoly.html*/
-	for (i = 0, j = nvert - 1; i < nvert; j = i++)
-	{
-		if (((verty[i] > testy) != (verty[j] > testy)) &&
-			(testx < (vertx[j] - vertx[i]) * (testy - verty[i]) / (verty[j] - verty[i]) + vertx[i]))
-		{
-			c = !c;
-		}
-	}
-	return c;
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 >= OLED_WIDTH) x2 = OLED_WIDTH - 1;
+    if (y2 >= OLED_HEIGHT) y2 = OLED_HEIGHT - 1;
+    if (x1 > x2 || y1 > y2) return;
+    
+    uint8_t page1 = y1 / 8;
+    uint8_t page2 = y2 / 8;
+    uint8_t len = x2 - x1 + 1;
+    
+    for (uint8_t page = page1; page <= page2; page++) {
+        uint8_t mask = 0xFF;
+        if (page == page1) mask &= OLED_PageMaskFrom[y1 % 8];
+        if (page == page2) mask &= OLED_PageMaskTo[y2 % 8];
+        
+        uint8_t* row = &OLED_GRAM[page][x1];
+        if (mask == 0xFF) {
+            memset(row, 0xFF, len);
+        } else {
+            for (uint8_t i = 0; i < len; i++) {
+                row[i] |= mask;
+            }
+        }
+        OLED_MarkDirtySpan(page, x1, x2 + 1);
+    }
 }
 
-/**
-  * 函    数:判断指定点是否在指定角度内部
-  * 参    数:X Y 指定点的坐标
-  * 参    数:StartAngle EndAngle 起始角度和终止角度,范围:-180~180
-  *           水平向右为0度,水平向左为180度或-180度,下方为正数,上方为负数,顺时针旋转
-  * 返 回 值:指定点是否在指定角度内部,1:在内部,0:不在内部
-  */
-static inline uint8_t OLED_IsInAngle(int16_t X, int16_t Y, int16_t StartAngle, int16_t EndAngle)
+// 填充一列中的纵向区间[y1, y2],自动裁剪
+static inline void OLED_FillVSpan(int16_t x, int16_t y1, int16_t y2)
 {
-	int16_t PointAngle;
-	PointAngle = atan2(Y, X) / 3.14 * 180;	//计算指定点的弧度,并转换为角度表示
-	if (StartAngle < EndAngle)	//起始角度小于终止角度的情况
-	{
-		/*如果指定角度在起始终止角度之间,则判定指定点在指定角度*/
-		if (PointAngle >= StartAngle && PointAngle <= EndAngle)
-		{
-			return 1;
-		}
-	}
-	else			//起始角度大于于终止角度的情况
-	{
-		/*如果指定角度大于起始角度或者小于终止角度,则判定指定点在指定角度*/
-		if (PointAngle >= StartAngle || PointAngle <= EndAngle)
-		{
-			return 1;
-		}
-	}
-	return 0;		//不满足以上条件,则判断判定指定点不在指定角度
+    if (x < 0 || x >= OLED_WIDTH) return;
+    OLED_FillSpanRect(x, x, y1, y2);
+}
+
+// 填充关于X对称的两列纵向区间[Y - h, Y + h]
+static inline void OLED_FillVSpanPair(int16_t X, int16_t dx, int16_t Y, int16_t h)
+{
+    OLED_FillVSpan(X + dx, Y - h, Y + h);
+    if (dx != 0) OLED_FillVSpan(X - dx, Y - h, Y + h);
+}
+
+// 四舍五入的整数除法,den必须大于0
+static inline int32_t OLED_DivRound(int32_t num, int32_t den)
+{
+    return (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+// 线段(ax, ay)-(bx, by)在横坐标x处的纵坐标,要求ax != bx
+static inline int16_t OLED_EdgeY(int16_t ax, int16_t ay, int16_t bx, int16_t by, int16_t x)
+{
+    if (bx < ax) {
+        int16_t t;
+        t = ax; ax = bx; bx = t;
+        t = ay; ay = by; by = t;
+    }
+    return ay + OLED_DivRound((int32_t)(by - ay) * (x - ax), bx - ax);
+}
+
+// 整数平方根(向下取整)
+static uint16_t OLED_ISqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// 方向向量放大倍数
+#define OLED_ANGLE_SCALE 1024
+
+// 扇形角度测试:起止方向的整数向量,每个像素只做两次叉积,不再调用atan2
+typedef struct {
+    int32_t sx, sy;     // 起始方向
+    int32_t ex, ey;     // 终止方向
+    uint8_t wide;       // 扫过的角度是否超过180度
+} OLED_AngleRange;
+
+static void OLED_AngleRangeInit(OLED_AngleRange* range, int16_t StartAngle, int16_t EndAngle)
+{
+    float s = StartAngle * 3.14159265f / 180.0f;
+    float e = EndAngle * 3.14159265f / 180.0f;
+    int16_t sweep = EndAngle - StartAngle;
+    if (sweep <= 0) sweep += 360;     // 起止角度相同时为整圆
+    
+    range->sx = (int32_t)(cosf(s) * OLED_ANGLE_SCALE);
+    range->sy = (int32_t)(sinf(s) * OLED_ANGLE_SCALE);
+    range->ex = (int32_t)(cosf(e) * OLED_ANGLE_SCALE);
+    range->ey = (int32_t)(sinf(e) * OLED_ANGLE_SCALE);
+    range->wide = sweep > 180;
+}
+
+// 点(x, y)(相对圆心)是否在扇形角度内,角度方向与OLED_IsInAngle相同
+static inline uint8_t OLED_AngleRangeContains(const OLED_AngleRange* range, int32_t x, int32_t y)
+{
+    int32_t fromStart = range->sx * y - range->sy * x;  // >= 0: 在起始方向顺时针一侧
+    int32_t toEnd = x * range->ey - y * range->ex;      // >= 0: 在终止方向逆时针一侧
+    if (range->wide) {
+        return fromStart >= 0 || toEnd >= 0;
+    }
+    return fromStart >= 0 && toEnd >= 0;
 }
 
 /**
@@ -1883,7 +2174,7 @@ void OLED_DrawRectangle(int16_t X, int16_t Y, int16_t Width, int16_t Height, uin
     if (Y >= 64) Y %= 64;
     if (Y < 0) Y = 64 + (Y % 64);
     
-    uint8_t i, j;
+    uint8_t i;
     if (!IsFilled)        // 指定矩形不填充
     {
         /*遍历上下X坐标,画矩形上下两条线*/
@@ -1901,16 +2192,21 @@ void OLED_DrawRectangle(int16_t X, int16_t Y, int16_t Width, int16_t Height, uin
     }
     else                  // 指定矩形填充
     {
-        /*遍历X坐标*/
-        for (i = X; i < X + Width; i++)
-        {
-            /*遍历Y坐标*/
-            for (j = Y; j < Y + Height; j++)
-            {
-                /*在指定区域画点,填充满矩形*/
-                OLED_DrawPoint(i % 128, j % 64, 1);
-
-            }
+        /*按页整段填充,跨越屏幕边界循环时拆成最多四块*/
+        int16_t xEnd = X + Width;
+        int16_t yEnd = Y + Height;
+        int16_t xFirst = (xEnd > OLED_WIDTH) ? OLED_WIDTH : xEnd;
+        int16_t yFirst = (yEnd > OLED_HEIGHT) ? OLED_HEIGHT : yEnd;
+        
+        OLED_FillSpanRect(X, xFirst - 1, Y, yFirst - 1);
+        if (xEnd > OLED_WIDTH) {
+            OLED_FillSpanRect(0, xEnd - OLED_WIDTH - 1, Y, yFirst - 1);
+        }
+        if (yEnd > OLED_HEIGHT) {
+            OLED_FillSpanRect(X, xFirst - 1, 0, yEnd - OLED_HEIGHT - 1);
+        }
+        if (xEnd > OLED_WIDTH && yEnd > OLED_HEIGHT) {
+            OLED_FillSpanRect(0, xEnd - OLED_WIDTH - 1, 0, yEnd - OLED_HEIGHT - 1);
         }
     }
 }
@@ -1945,6 +2241,13 @@ void OLED_ReverseRectangle(int16_t X, int16_t Y, uint8_t Width, uint8_t Height,
     uint8_t x2 = (X + Width - 1) % 128;  // 右边框X坐标
     uint8_t y2 = (Y + Height - 1) % 64;   // 下边框Y坐标
     
+    // 记录脏区,区域跨越屏幕边界循环时整屏标记
+    if (X + Width > OLED_WIDTH || Y + Height > OLED_HEIGHT) {
+        OLED_MarkDirtyArea(0, 0, OLED_WIDTH, OLED_HEIGHT);
+    } else {
+        OLED_MarkDirtyArea(X, Y, Width, Height);
+    }
+    
     if (!IsFilled)  // 反色空心矩形(仅边框)
     {
         /* 1. 反色上下两条横线(完整范围,包含四个角点) */
@@ -2036,10 +2339,7 @@ void OLED_ReverseRectangle(int16_t X, int16_t Y, uint8_t Width, uint8_t Height,
   */
 void OLED_DrawTriangle(int16_t X0, int16_t Y0, int16_t X1, int16_t Y1, int16_t X2, int16_t Y2, uint8_t IsFilled)
 {
-	uint8_t minx = X0, miny = Y0, maxx = X0, maxy = Y0;
-	uint8_t i, j;
-	int16_t vx[] = {X0, X1, X2};
-	int16_t vy[] = {Y0, Y1, Y2};
+	int16_t x, t, ya, yb, xStart, xEnd;
 	
 	if (!IsFilled)			//指定三角形不填充
 	{
@@ -2050,32 +2350,39 @@ void OLED_DrawTriangle(int16_t X0, int16_t Y0, int16_t X1, int16_t Y1, int16_t X
 	}
 	else					//指定三角形填充
 	{
-		/*找到三个点最小的X、Y坐标*/
-		if (X1 < minx) {minx = X1;}
-		if (X2 < minx) {minx = X2;}
-		if (Y1 < miny) {miny = Y1;}
-		if (Y2 < miny) {miny = Y2;}
+		/*按横坐标排序顶点,逐列求出长边和短边的纵坐标,两者之间整段填充*/
+		if (X1 < X0) {t = X0; X0 = X1; X1 = t; t = Y0; Y0 = Y1; Y1 = t;}
+		if (X2 < X0) {t = X0; X0 = X2; X2 = t; t = Y0; Y0 = Y2; Y2 = t;}
+		if (X2 < X1) {t = X1; X1 = X2; X2 = t; t = Y1; Y1 = Y2; Y2 = t;}
 		
-		/*找到三个点最大的X、Y坐标*/
-		if (X1 > maxx) {maxx = X1;}
-		if (X2 > maxx) {maxx = X2;}
-		if (Y1 > maxy) {maxy = Y1;}
-		if (Y2 > maxy) {maxy = Y2;}
+		if (X0 == X2)	//三点在同一列
+		{
+			ya = Y0; yb = Y0;
+			if (Y1 < ya) {ya = Y1;}
+			if (Y2 < ya) {ya = Y2;}
+			if (Y1 > yb) {yb = Y1;}
+			if (Y2 > yb) {yb = Y2;}
+			OLED_FillVSpan(X0, ya, yb);
+			return;
+		}
 		
-		/*最小最大坐标之间的矩形为可能需要填充的区域*/
-		/*遍历此区域中所有的点*/
-		/*遍历X坐标*/		
-		for (i = minx; i <= maxx; i ++)
+		xStart = (X0 < 0) ? 0 : X0;
+		xEnd = (X2 >= OLED_WIDTH) ? OLED_WIDTH - 1 : X2;
+		for (x = xStart; x <= xEnd; x ++)
 		{
-			/*遍历Y坐标*/	
-			for (j = miny; j <= maxy; j ++)
-			{
-				/*调用OLED_pnpoly,判断指定点是否在指定三角形之中*/
-				/*如果在,则画点,如果不在,则不做处理*/
-				if (OLED_pnpoly(3, vx, vy, i, j)) {OLED_DrawPoint(i, j, 1);}
-
-			}
+			ya = OLED_EdgeY(X0, Y0, X2, Y2, x);		//长边
+			if (x < X1) {yb = OLED_EdgeY(X0, Y0, X1, Y1, x);}
+			else if (X1 != X2) {yb = OLED_EdgeY(X1, Y1, X2, Y2, x);}
+			else {yb = Y1;}							//右侧为竖边,长边在此处的纵坐标为Y2
+			
+			if (ya > yb) {t = ya; ya = yb; yb = t;}
+			OLED_FillVSpan(x, ya, yb);
 		}
+		
+		/*陡峭的边在一列中跨越多行,逐列取样会漏掉部分边上的点,用画线补齐边框*/
+		OLED_DrawLine(X0, Y0, X1, Y1, 1);
+		OLED_DrawLine(X0, Y0, X2, Y2, 1);
+		OLED_DrawLine(X1, Y1, X2, Y2, 1);
 	}
 }
 
@@ -2093,7 +2400,7 @@ void OLED_DrawTriangle(int16_t X0, int16_t Y0, int16_t X1, int16_t Y1, int16_t X
 void OLED_DrawCircle(int16_t X, int16_t Y, int16_t Radius, uint8_t IsFilled)
 
 {
-	int16_t x, y, d, j;
+	int16_t x, y, d;
 	
 	/*使用Bresenham算法画圆,可以避免耗时的浮点运算,效率更高*/
 	/*参考文档:https://www.cs.montana.edu/courses/spring2009/425/dslectures/Bresenham.pdf*/
@@ -2103,23 +2410,35 @@ void OLED_DrawCircle(int16_t X, int16_t Y, int16_t Radius, uint8_t IsFilled)
 	x = 0;
 	y = Radius;
 	
-	/*画每个八分之一圆弧的起始点*/
-	OLED_DrawPoint(X + x, Y + y, 1);
-	OLED_DrawPoint(X - x, Y - y, 1);
-	OLED_DrawPoint(X + y, Y + x, 1);
-	OLED_DrawPoint(X - y, Y - x, 1);
-	
 	if (IsFilled)		//指定圆填充
 	{
-		/*遍历起始点Y坐标*/
-		for (j = -y; j < y; j ++)
+		/*逐列整段填充:X±x列的半高为y;X±y列在y即将减小时半高已确定为x-1*/
+		/*每列只填充一次,填充区域包含圆周,不再逐点画边框*/
+		OLED_FillVSpanPair(X, 0, Y, y);
+		while (x < y)
 		{
-			/*在指定区域画点,填充部分圆*/
-			OLED_DrawPoint(X, Y + j, 1);
-
+			x ++;
+			if (d < 0)
+			{
+				d += 2 * x + 1;
+			}
+			else
+			{
+				OLED_FillVSpanPair(X, y, Y, x - 1);
+				y --;
+				d += 2 * (x - y) + 1;
+			}
+			OLED_FillVSpanPair(X, x, Y, y);
 		}
+		return;
 	}
 	
+	/*画每个八分之一圆弧的起始点*/
+	OLED_DrawPoint(X + x, Y + y, 1);
+	OLED_DrawPoint(X - x, Y - y, 1);
+	OLED_DrawPoint(X + y, Y + x, 1);
+	OLED_DrawPoint(X - y, Y - x, 1);
+	
 	while (x < y)		//遍历X轴的每个点
 	{
 		x ++;
@@ -2142,25 +2461,6 @@ void OLED_DrawCircle(int16_t X, int16_t Y, int16_t Radius, uint8_t IsFilled)
 		OLED_DrawPoint(X + y, Y - x, 1);
 		OLED_DrawPoint(X - x, Y + y, 1);
 		OLED_DrawPoint(X - y, Y + x, 1);
-		
-		if (IsFilled)	//指定圆填充
-		{
-			/*遍历中间部分*/
-			for (j = -y; j < y; j ++)
-			{
-				/*在指定区域画点,填充部分圆*/
-				OLED_DrawPoint(X + x, Y + j, 1);
-				OLED_DrawPoint(X - x, Y + j, 1);
-			}
-			
-			/*遍历两侧部分*/
-			for (j = -x; j < x; j ++)
-			{
-				/*在指定区域画点,填充部分圆*/
-				OLED_DrawPoint(X - y, Y + j, 1);
-				OLED_DrawPoint(X + y, Y + j, 1);
-			}
-		}
 	}
 }
 
@@ -2178,98 +2478,87 @@ void OLED_DrawCircle(int16_t X, int16_t Y, int16_t Radius, uint8_t IsFilled)
   */
 void OLED_DrawEllipse(int16_t X, int16_t Y, uint8_t A, uint8_t B, uint8_t IsFilled)
 {
-	int16_t x, y, j;
-	int16_t a = A, b = B;
-	float d1, d2;
+	int16_t x, y;
+	int64_t a2 = (int32_t)A * A, b2 = (int32_t)B * B;
+	int64_t d1, d2;
 	
-	/*使用Bresenham算法画椭圆,可以避免部分耗时的浮点运算,效率更高*/
+	/*使用中点画椭圆算法,判别式整体乘以4消去0.5,全程只用整数运算*/
 	/*参考链接:https://blog.csdn.net/myf_666/article/details/128167392*/
+	/*填充时逐列整段填充,X±x列的半高为该列上最大的y*/
 	
 	x = 0;
-	y = b;
-	d1 = b * b + a * a * (-b + 0.5);
+	y = B;
+	d1 = 4 * b2 - 4 * a2 * B + 2 * a2;
 	
 	if (IsFilled)	//指定椭圆填充
 	{
-		/*遍历起始点Y坐标*/
-		for (j = -y; j < y; j ++)
-		{
-			/*在指定区域画点,填充部分椭圆*/
-			OLED_DrawPoint(X, Y + j, 1);
-		}
+		OLED_FillVSpanPair(X, 0, Y, y);
+	}
+	else
+	{
+		/*画椭圆弧的起始点*/
+		OLED_DrawPoint(X, Y + y, 1);
+		OLED_DrawPoint(X, Y - y, 1);
 	}
 	
-	/*画椭圆弧的起始点*/
-	OLED_DrawPoint(X + x, Y + y, 1);
-	OLED_DrawPoint(X - x, Y - y, 1);
-	OLED_DrawPoint(X - x, Y + y, 1);
-	OLED_DrawPoint(X + x, Y - y, 1);
-	
-	/*画椭圆中间部分*/
-	while (b * b * (x + 1) < a * a * (y - 0.5))
+	/*画椭圆中间部分:b^2(x+1) < a^2(y-0.5)*/
+	while (2 * b2 * (x + 1) < a2 * (2 * y - 1))
 	{
 		if (d1 <= 0)		//下一个点在当前点东方
 		{
-			d1 += b * b * (2 * x + 3);
+			d1 += 4 * b2 * (2 * x + 3);
 		}
 		else				//下一个点在当前点东南方
 		{
-			d1 += b * b * (2 * x + 3) + a * a * (-2 * y + 2);
+			d1 += 4 * b2 * (2 * x + 3) + 4 * a2 * (-2 * y + 2);
 			y --;
 		}
 		x ++;
 		
 		if (IsFilled)	//指定椭圆填充
 		{
-			/*遍历中间部分*/
-			for (j = -y; j < y; j ++)
-			{
-				/*在指定区域画点,填充部分椭圆*/
-				OLED_DrawPoint(X + x, Y + j, 1);
-				OLED_DrawPoint(X - x, Y + j, 1);
-			}
+			OLED_FillVSpanPair(X, x, Y, y);
+		}
+		else
+		{
+			/*画椭圆中间部分圆弧*/
+			OLED_DrawPoint(X + x, Y + y, 1);
+			OLED_DrawPoint(X - x, Y - y, 1);
+			OLED_DrawPoint(X - x, Y + y, 1);
+			OLED_DrawPoint(X + x, Y - y, 1);
 		}
-		
-		/*画椭圆中间部分圆弧*/
-		OLED_DrawPoint(X + x, Y + y, 1);
-		OLED_DrawPoint(X - x, Y - y, 1);
-		OLED_DrawPoint(X - x, Y + y, 1);
-		OLED_DrawPoint(X + x, Y - y, 1);
 	}
 	
 	/*画椭圆两侧部分*/
-	d2 = b * b * (x + 0.5) * (x + 0.5) + a * a * (y - 1) * (y - 1) - a * a * b * b;
+	d2 = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
 	
 	while (y > 0)
 	{
 		if (d2 <= 0)		//下一个点在当前点东方
 		{
-			d2 += b * b * (2 * x + 2) + a * a * (-2 * y + 3);
+			d2 += 4 * b2 * (2 * x + 2) + 4 * a2 * (-2 * y + 3);
 			x ++;
+			y --;
 			
+			if (IsFilled)	//新的一列,半高为当前y
+			{
+				OLED_FillVSpanPair(X, x, Y, y);
+			}
 		}
 		else				//下一个点在当前点东南方
 		{
-			d2 += a * a * (-2 * y + 3);
+			d2 += 4 * a2 * (-2 * y + 3);
+			y --;
 		}
-		y --;
 		
-		if (IsFilled)	//指定椭圆填充
+		if (!IsFilled)
 		{
-			/*遍历两侧部分*/
-			for (j = -y; j < y; j ++)
-			{
-				/*在指定区域画点,填充部分椭圆*/
-				OLED_DrawPoint(X + x, Y + j, 1);
-				OLED_DrawPoint(X - x, Y + j, 1);
-			}
+			/*画椭圆两侧部分圆弧*/
+			OLED_DrawPoint(X + x, Y + y, 1);
+			OLED_DrawPoint(X - x, Y - y, 1);
+			OLED_DrawPoint(X - x, Y + y, 1);
+			OLED_DrawPoint(X + x, Y - y, 1);
 		}
-		
-		/*画椭圆两侧部分圆弧*/
-		OLED_DrawPoint(X + x, Y + y, 1);
-		OLED_DrawPoint(X - x, Y - y, 1);
-		OLED_DrawPoint(X - x, Y + y, 1);
-		OLED_DrawPoint(X + x, Y - y, 1);
 	}
 }
 
@@ -2290,31 +2579,43 @@ void OLED_DrawEllipse(int16_t X, int16_t Y, uint8_t A, uint8_t B, uint8_t IsFill
   */
 void OLED_DrawArc(int16_t X, int16_t Y, uint8_t Radius, int16_t StartAngle, int16_t EndAngle, uint8_t IsFilled)
 {
-	int16_t x, y, d, j;
+	int16_t x, y, d, dx, dy, h, runStart;
+	uint8_t inside, inRun;
+	OLED_AngleRange range;
+	
+	/*起止角度换算为整数方向向量,之后每个点只需两次叉积即可判断是否在角度内*/
+	OLED_AngleRangeInit(&range, StartAngle, EndAngle);
+	
+	if (IsFilled)	//指定圆弧填充,填充后为扇形
+	{
+		/*逐列求出圆的半高,把列中落在角度内的连续像素整段填充*/
+		for (dx = -Radius; dx <= Radius; dx ++)
+		{
+			if (X + dx < 0 || X + dx >= OLED_WIDTH) {continue;}
+			
+			h = OLED_ISqrt((int32_t)Radius * Radius - (int32_t)dx * dx + Radius);
+			runStart = 0;
+			inRun = 0;
+			for (dy = -h; dy <= h + 1; dy ++)
+			{
+				inside = (dy <= h) && OLED_AngleRangeContains(&range, dx, dy);
+				if (inside && !inRun) {runStart = dy; inRun = 1;}
+				else if (!inside && inRun) {OLED_FillVSpan(X + dx, Y + runStart, Y + dy - 1); inRun = 0;}
+			}
+		}
+	}
 	
-	/*此函数借用Bresenham算法画圆的方法*/
+	/*此函数借用Bresenham算法画圆的方法画圆弧边框*/
 	
 	d = 1 - Radius;
 	x = 0;
 	y = Radius;
 	
 	/*在画圆的每个点时,判断指定点是否在指定角度内,在,则画点,不在,则不做处理*/
-	if (OLED_IsInAngle(x, y, StartAngle, EndAngle))	{OLED_DrawPoint(X + x, Y + y, 1);}
-	if (OLED_IsInAngle(-x, -y, StartAngle, EndAngle)) {OLED_DrawPoint(X - x, Y - y, 1);}
-	if (OLED_IsInAngle(y, x, StartAngle, EndAngle)) {OLED_DrawPoint(X + y, Y + x, 1);}
-	if (OLED_IsInAngle(-y, -x, StartAngle, EndAngle)) {OLED_DrawPoint(X - y, Y - x, 1);}
-
-	
-	if (IsFilled)	//指定圆弧填充
-	{
-		/*遍历起始点Y坐标*/
-		for (j = -y; j < y; j ++)
-		{
-			/*在填充圆的每个点时,判断指定点是否在指定角度内,在,则画点,不在,则不做处理*/
-			if (OLED_IsInAngle(0, j, StartAngle, EndAngle)) {OLED_DrawPoint(X, Y + j, 1);}
-
-		}
-	}
+	if (OLED_AngleRangeContains(&range, x, y)) {OLED_DrawPoint(X + x, Y + y, 1);}
+	if (OLED_AngleRangeContains(&range, -x, -y)) {OLED_DrawPoint(X - x, Y - y, 1);}
+	if (OLED_AngleRangeContains(&range, y, x)) {OLED_DrawPoint(X + y, Y + x, 1);}
+	if (OLED_AngleRangeContains(&range, -y, -x)) {OLED_DrawPoint(X - y, Y - x, 1);}
 	
 	while (x < y)		//遍历X轴的每个点
 	{
@@ -2330,32 +2631,207 @@ void OLED_DrawArc(int16_t X, int16_t Y, uint8_t Radius, int16_t StartAngle, int1
 		}
 		
 		/*在画圆的每个点时,判断指定点是否在指定角度内,在,则画点,不在,则不做处理*/
-		if (OLED_IsInAngle(x, y, StartAngle, EndAngle)) {OLED_DrawPoint(X + x, Y + y, 1);}
-		if (OLED_IsInAngle(y, x, StartAngle, EndAngle)) {OLED_DrawPoint(X + y, Y + x, 1);}
-		if (OLED_IsInAngle(-x, -y, StartAngle, EndAngle)) {OLED_DrawPoint(X - x, Y - y, 1);}
-		if (OLED_IsInAngle(-y, -x, StartAngle, EndAngle)) {OLED_DrawPoint(X - y, Y - x, 1);}
-		if (OLED_IsInAngle(x, -y, StartAngle, EndAngle)) {OLED_DrawPoint(X + x, Y  + y, 1);}
-		if (OLED_IsInAngle(y, -x, StartAngle, EndAngle)) {OLED_DrawPoint(X + y, Y - x, 1);}
-		if (OLED_IsInAngle(-x, y, StartAngle, EndAngle)) {OLED_DrawPoint(X - x, Y + y, 1);}
-		if (OLED_IsInAngle(-y, x, StartAngle, EndAngle)) {OLED_DrawPoint(X - y, Y + x, 1);}
-		
-		if (IsFilled)	//指定圆弧填充
-		{
-			/*遍历中间部分*/
-			for (j = -y; j < y; j ++)
-			{
-				/*在填充圆的每个点时,判断指定点是否在指定角度内,在,则画点,不在,则不做处理*/
-				if (OLED_IsInAngle(x, j, StartAngle, EndAngle)) {OLED_DrawPoint(X + x, Y + j, 1);}
-				if (OLED_IsInAngle(-x, j, StartAngle, EndAngle)) {OLED_DrawPoint(X - x, Y + j, 1);}
-			}
-			
-			/*遍历两侧部分*/
-			for (j = -x; j < x; j ++)
-			{
-				/*在填充圆的每个点时,判断指定点是否在指定角度内,在,则画点,不在,则不做处理*/
-				if (OLED_IsInAngle(-y, j, StartAngle, EndAngle)) {OLED_DrawPoint(X - y, Y + j, 1);}
-				if (OLED_IsInAngle(y, j, StartAngle, EndAngle)) {OLED_DrawPoint(X + y, Y + j, 1);}
-			}
-		}
+		if (OLED_AngleRangeContains(&range, x, y)) {OLED_DrawPoint(X + x, Y + y, 1);}
+		if (OLED_AngleRangeContains(&range, y, x)) {OLED_DrawPoint(X + y, Y + x, 1);}
+		if (OLED_AngleRangeContains(&range, -x, -y)) {OLED_DrawPoint(X - x, Y - y, 1);}
+		if (OLED_AngleRangeContains(&range, -y, -x)) {OLED_DrawPoint(X - y, Y - x, 1);}
+		if (OLED_AngleRangeContains(&range, x, -y)) {OLED_DrawPoint(X + x, Y - y, 1);}
+		if (OLED_AngleRangeContains(&range, y, -x)) {OLED_DrawPoint(X + y, Y - x, 1);}
+		if (OLED_AngleRangeContains(&range, -x, y)) {OLED_DrawPoint(X - x, Y + y, 1);}
+		if (OLED_AngleRangeContains(&range, -y, x)) {OLED_DrawPoint(X - y, Y + x, 1);}
 	}
 }
+
+/*滚动折线图----------------------------------------------------------------------*/
+/*每列对应一个样本,样本保存在环形缓冲区中。新样本到来时绘图区整体左移一列,
+  只画最新的一段折线;数据超出当前刻度范围时才重新计算定点刻度并整体重绘。
+  控件只改动绘图区内的显存,坐标轴、标签等静态内容由调用者绘制一次即可*/
+
+// 设置刻度范围并计算16.16定点比例
+static void OLED_ScrollChart_SetRange(OLED_ScrollChart* chart, int16_t minY, int16_t maxY)
+{
+    if (maxY <= minY) maxY = minY + 1;
+    chart->minY = minY;
+    chart->maxY = maxY;
+    chart->scale = ((uint32_t)(chart->height - 1) << 16) / (uint32_t)((int32_t)maxY - minY);
+}
+
+// 样本值换算为屏幕纵坐标,超出刻度范围时贴边
+static inline int16_t OLED_ScrollChart_Map(const OLED_ScrollChart* chart, int16_t value)
+{
+    if (value < chart->minY) value = chart->minY;
+    if (value > chart->maxY) value = chart->maxY;
+    uint32_t offset = ((uint32_t)((int32_t)value - chart->minY) * chart->scale) >> 16;
+    return chart->y0 + chart->height - 1 - (int16_t)offset;
+}
+
+// 按时间顺序取第index个样本(0为最早)
+static inline int16_t OLED_ScrollChart_Sample(const OLED_ScrollChart* chart, uint8_t index)
+{
+    uint16_t pos = chart->head + index;
+    if (pos >= chart->width) pos -= chart->width;
+    return chart->samples[pos];
+}
+
+// 根据缓冲区内的数据重新确定刻度范围,上下各留1/8余量
+static void OLED_ScrollChart_Rescale(OLED_ScrollChart* chart)
+{
+    int16_t minY = OLED_ScrollChart_Sample(chart, 0);
+    int16_t maxY = minY;
+    for (uint8_t i = 1; i < chart->count; i++) {
+        int16_t value = OLED_ScrollChart_Sample(chart, i);
+        if (value < minY) minY = value;
+        if (value > maxY) maxY = value;
+    }
+    
+    int32_t margin = ((int32_t)maxY - minY) / 8 + 1;
+    int32_t low = (int32_t)minY - margin;
+    int32_t high = (int32_t)maxY + margin;
+    if (low < INT16_MIN) low = INT16_MIN;
+    if (high > INT16_MAX) high = INT16_MAX;
+    OLED_ScrollChart_SetRange(chart, low, high);
+}
+
+// 绘图区左移一列并清空最右列,整页用memmove,部分页按掩码合并
+static void OLED_ScrollChart_Shift(const OLED_ScrollChart* chart)
+{
+    int16_t y1 = chart->y0;
+    int16_t y2 = chart->y0 + chart->height - 1;
+    uint8_t page1 = y1 / 8;
+    uint8_t page2 = y2 / 8;
+    uint8_t x1 = chart->x0;
+    uint8_t last = chart->x0 + chart->width - 1;
+    
+    for (uint8_t page = page1; page <= page2; page++) {
+        uint8_t mask = 0xFF;
+        if (page == page1) mask &= OLED_PageMaskFrom[y1 % 8];
+        if (page == page2) mask &= OLED_PageMaskTo[y2 % 8];
+        
+        uint8_t* row = OLED_GRAM[page];
+        if (mask == 0xFF) {
+            memmove(&row[x1], &row[x1 + 1], chart->width - 1);
+            row[last] = 0x00;
+        } else {
+            for (uint8_t x = x1; x < last; x++) {
+                row[x] = (row[x] & ~mask) | (row[x + 1] & mask);
+            }
+            row[last] &= ~mask;
+        }
+        OLED_MarkDirtySpan(page, x1, last + 1);
+    }
+}
+
+/**
+  * 函    数:初始化滚动折线图
+  * 参    数:chart 折线图控件
+  * 参    数:x0 y0 绘图区左上角坐标
+  * 参    数:width 绘图区宽度,即保留的样本数,范围:2~128
+  * 参    数:height 绘图区高度,范围:2~64
+  * 参    数:minY maxY 固定刻度范围;两者相等时根据数据自动调整刻度
+  * 返 回 值:无
+  * 说    明:绘图区超出屏幕的部分会被裁掉;初始化时清空绘图区
+  */
+void OLED_ScrollChart_Init(OLED_ScrollChart* chart, int16_t x0, int16_t y0, uint8_t width, uint8_t height,
+                           int16_t minY, int16_t maxY)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x0 > OLED_WIDTH - 2) x0 = OLED_WIDTH - 2;
+    if (y0 > OLED_HEIGHT - 2) y0 = OLED_HEIGHT - 2;
+    if (width > OLED_WIDTH - x0) width = OLED_WIDTH - x0;
+    if (height > OLED_HEIGHT - y0) height = OLED_HEIGHT - y0;
+    if (width < 2) width = 2;
+    if (height < 2) height = 2;
+    
+    chart->x0 = x0;
+    chart->y0 = y0;
+    chart->width = width;
+    chart->height = height;
+    chart->head = 0;
+    chart->count = 0;
+    chart->sinceRescale = 0;
+    chart->autoScale = (minY == maxY);
+    OLED_ScrollChart_SetRange(chart, minY, maxY);
+    
+    OLED_ClearArea(x0, y0, width, height);
+}
+
+/**
+  * 函    数:重绘滚动折线图的整个绘图区
+  * 参    数:chart 折线图控件
+  * 返 回 值:无
+  * 说    明:绘图区被其他绘制覆盖后调用;正常滚动时不需要调用
+  */
+void OLED_ScrollChart_Redraw(OLED_ScrollChart* chart)
+{
+    OLED_ClearArea(chart->x0, chart->y0, chart->width, chart->height);
+    if (chart->count == 0) return;
+    
+    // 样本靠右对齐,最新样本在最右列
+    int16_t x = chart->x0 + chart->width - chart->count;
+    int16_t prevY = OLED_ScrollChart_Map(chart, OLED_ScrollChart_Sample(chart, 0));
+    OLED_DrawPoint(x, prevY, OLED_COLOR_WHITE);
+    for (uint8_t i = 1; i < chart->count; i++) {
+        int16_t y = OLED_ScrollChart_Map(chart, OLED_ScrollChart_Sample(chart, i));
+        OLED_DrawLine(x, prevY, x + 1, y, OLED_COLOR_WHITE);
+        prevY = y;
+        x++;
+    }
+}
+
+/**
+  * 函    数:向滚动折线图追加一个样本
+  * 参    数:chart 折线图控件
+  * 参    数:value 样本值
+  * 返 回 值:无
+  * 说    明:1. 刻度不变时只左移绘图区并画最新一段,耗时与样本数无关
+  *           2. 自动刻度模式下样本超出范围时立即重新定标并重绘;
+  *              每滚过一屏检查一次,数据只占刻度范围1/4以下时收紧刻度
+  *           3. 改动的显存区域记入脏区,调用更新函数时只传输绘图区
+  */
+void OLED_ScrollChart_Push(OLED_ScrollChart* chart, int16_t value)
+{
+    int16_t prev = (chart->count > 0) ? OLED_ScrollChart_Sample(chart, chart->count - 1) : value;
+    
+    // 写入环形缓冲区,满时覆盖最早的样本
+    if (chart->count < chart->width) {
+        uint16_t pos = chart->head + chart->count;
+        if (pos >= chart->width) pos -= chart->width;
+        chart->samples[pos] = value;
+        chart->count++;
+    } else {
+        chart->samples[chart->head] = value;
+        chart->head = (chart->head + 1 < chart->width) ? chart->head + 1 : 0;
+    }
+    
+    if (chart->autoScale) {
+        uint8_t rescale = (value < chart->minY || value > chart->maxY || chart->count == 1);
+        if (++chart->sinceRescale >= chart->width) {
+            int16_t minY = OLED_ScrollChart_Sample(chart, 0);
+            int16_t maxY = minY;
+            for (uint8_t i = 1; i < chart->count; i++) {
+                int16_t sample = OLED_ScrollChart_Sample(chart, i);
+                if (sample < minY) minY = sample;
+                if (sample > maxY) maxY = sample;
+            }
+            if (((int32_t)maxY - minY) * 4 < (int32_t)chart->maxY - chart->minY) rescale = 1;
+            chart->sinceRescale = 0;
+        }
+        if (rescale) {
+            OLED_ScrollChart_Rescale(chart);
+            chart->sinceRescale = 0;
+            OLED_ScrollChart_Redraw(chart);
+            return;
+        }
+    }
+    
+    // 增量绘制:左移一列,在最后两列之间画最新一段
+    OLED_ScrollChart_Shift(chart);
+    int16_t last = chart->x0 + chart->width - 1;
+    int16_t y = OLED_ScrollChart_Map(chart, value);
+    if (chart->count > 1) {
+        OLED_DrawLine(last - 1, OLED_ScrollChart_Map(chart, prev), last, y, OLED_COLOR_WHITE);
+    } else {
+        OLED_DrawPoint(last, y, OLED_COLOR_WHITE);
+    }
+}
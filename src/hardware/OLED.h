@@ -15,6 +15,7 @@
 
 #define OLED_I2C_TYPE 1  // 使用硬件I2C
 #define OLED_USE_DMA 1   // 使用DMA传输
+#define OLED_DMA_SINGLE_TRANSACTION 1  // DMA整帧单次传输(水平寻址模式,每帧一次传输完成中断)
 /************************** 屏幕 连接引脚定义********************************/
 
 // I2C接口定义
@@ -35,6 +36,7 @@
 #define OLED_COLOR_WHITE      0x01    // 白色
 #define OLED_8X16             16      // 8x16字体
 #define OLED_6X8              8       // 6x8字体
+#define OLED_GLYPH_CACHE_SIZE 16      // 预移位字形缓存项数
 
 // 参数检查宏
 #define OLED_CHECK_COORDINATES(x, y) \
@@ -63,6 +65,7 @@ void OLED_Clear(void);
 void OLED_Update(void);
 uint8_t OLED_UpdateAsync(void);
 uint8_t OLED_IsUpdating(void);
+void OLED_InvalidateAll(void);
 static inline void OLED_DrawPoint(int16_t x, int16_t y, uint8_t Color);
 void OLED_DrawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t Color);
 void OLED_DrawRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t Color);
@@ -97,5 +100,25 @@ void OLED_DrawTimeLineChart(int16_t x0, int16_t y0, int16_t width, int16_t heigh
                             const void* yData, DataType dataType, uint8_t pointCount, uint16_t timeInterval, 
                             uint8_t color, uint8_t drawAxis, uint8_t showLatest);
 
+// 滚动折线图 - 实时数据逐点追加,增量绘制
+#define OLED_SCROLL_CHART_CAPACITY 128  // 最大样本数(每列一个样本)
+
+typedef struct {
+    int16_t x0, y0;            // 绘图区左上角
+    uint8_t width, height;     // 绘图区尺寸,width同时是保留的样本数
+    int16_t samples[OLED_SCROLL_CHART_CAPACITY];  // 样本环形缓冲区
+    uint8_t head;              // 最早样本的位置
+    uint8_t count;             // 有效样本数
+    uint8_t autoScale;         // 是否根据数据自动调整刻度
+    uint8_t sinceRescale;      // 距上次检查刻度已追加的样本数
+    int16_t minY, maxY;        // 当前刻度范围
+    uint32_t scale;            // 16.16定点比例:像素/单位
+} OLED_ScrollChart;
+
+void OLED_ScrollChart_Init(OLED_ScrollChart* chart, int16_t x0, int16_t y0, uint8_t width, uint8_t height,
+                           int16_t minY, int16_t maxY);
+void OLED_ScrollChart_Push(OLED_ScrollChart* chart, int16_t value);
+void OLED_ScrollChart_Redraw(OLED_ScrollChart* chart);
+
 #endif
 
@@ -344,6 +344,23 @@ const ChineseCell_t OLED_CF16x16[] = {
     {NULL, {0}, 0, 0} // 结束标志
 };
 
+/*汉字数量(不含结束标志)*/
+const uint16_t OLED_CF16x16_COUNT = sizeof(OLED_CF16x16) / sizeof(OLED_CF16x16[0]) - 1;
+
+/*汉字码点索引*********************/
+
+/*OLED_Printf按码点在此表中二分查找汉字,表放在Flash中,无需运行时初始化*/
+/*在OLED_CF16x16中增加汉字后,需要在此表中按码点从小到大的顺序插入对应的一项*/
+/*构建时build.rs会检查此表与OLED_CF16x16是否一致,不一致时构建失败*/
+const ChineseIndex_t OLED_CF16x16_INDEX[] = {
+    {0x4E16, 0},    // 世
+    {0x4F60, 1},    // 你
+    {0x597D, 2},    // 好
+    {0x754C, 3},    // 界
+};
+
+const uint16_t OLED_CF16x16_INDEX_COUNT = sizeof(OLED_CF16x16_INDEX) / sizeof(OLED_CF16x16_INDEX[0]);
+
 
 
 
@@ -11,6 +11,12 @@ typedef struct {
     uint8_t Height;            // 高度
 } ChineseCell_t;
 
+// 汉字索引结构体定义 - 按码点升序排列,用于二分查找
+typedef struct {
+    uint16_t Codepoint;        // 汉字的Unicode码点
+    uint16_t Index;            // 在OLED_CF16x16中的下标
+} ChineseIndex_t;
+
 // ASCII字模数据
 extern const uint8_t OLED_F8x16[][16];
 extern const uint8_t OLED_F6x8[][6];
@@ -18,6 +24,8 @@ extern const uint8_t OLED_F6x8[][6];
 // 汉字字模数据
 extern const ChineseCell_t OLED_CF16x16[];
 extern const uint16_t OLED_CF16x16_COUNT; // 汉字数量
+extern const ChineseIndex_t OLED_CF16x16_INDEX[];  // 汉字码点索引
+extern const uint16_t OLED_CF16x16_INDEX_COUNT;    // 索引项数量
 
 // 图像数据
 extern const uint8_t Diode[];